@@ -27,17 +27,22 @@
  */
 
 #include "Connection.h"
+#include "Http2Session.h"
 
 #include <Pt/Http/Request.h>
 #include <Pt/Http/Reply.h>
 #include <Pt/Http/HttpError.h>
 #include <Pt/System/EventLoop.h>
+#include <Pt/System/FileDevice.h>
 #include <Pt/System/Logger.h>
 #include <Pt/TextStream.h>
 #include <Pt/Base64Codec.h>
 #include <Pt/Convert.h>
 
 #include <iterator>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
 #include <cassert>
 
 log_define("Pt.Http.Connection")
@@ -46,6 +51,19 @@ namespace Pt {
 
 namespace Http {
 
+namespace {
+
+// bodies of at least this size are queued for output by reference
+const std::size_t MinQueueSize = 4096;
+
+// size of the file data copied at once, if the connection is encrypted
+const std::size_t FileCopySize = 16384;
+
+// pipelined replies are written once this many bytes are pending
+const std::size_t MaxBatchSize = 65536;
+
+}
+
 void Connection::ParseEvent::onMethod(const std::string& method)
 {
     _request->setMethod(method);
@@ -64,6 +82,24 @@ void Connection::ParseEvent::onUrlParam(const std::string& q)
 }
 
 
+void Connection::ParseEvent::onMethod(const char* method, std::size_t n)
+{
+    _request->setMethod(method, n);
+}
+
+
+void Connection::ParseEvent::onUrl(const char* url, std::size_t n)
+{
+    _request->setUrl(url, n);
+}
+
+
+void Connection::ParseEvent::onUrlParam(const char* q, std::size_t n)
+{
+    _request->setQParams(q, n);
+}
+
+
 void Connection::ReplyParseEvent::onHttpReturn(unsigned ret, const std::string& text)
 {
     _reply->setStatus(ret, text);
@@ -76,7 +112,7 @@ Connection::Connection()
 , _replyParser(_replyParseEvent, true)
 , _request(0)
 , _reply(0)
-, _sockbuf(8192, true)
+, _sockbuf()
 , _sockios(&_sockbuf)
 , _ssl(false)
 , _ctx(0)
@@ -86,12 +122,23 @@ Connection::Connection()
 , _timeout(WaitInfinite)
 , _keepaliveTimeout(WaitInfinite)
 , _maxReadSize( NoRequestSizeLimit )
+, _maxHeaderSize( MessageHeader::DefaultMaxSize )
+, _maxPipelined( DefaultMaxPipelined )
+, _pipelined(0)
+, _noDelay(true)
 , _readSize(0)
 , _readBytes(0)
+, _file(0)
+, _fileOffset(0)
+, _fileRemaining(0)
+, _sendingFile(false)
 , _state(NotConnected)
 , _chunked(false)
 , _keepAlive(false)
 , _onTimeout(false)
+, _session(0)
+, _maxStreams(DefaultMaxStreams)
+, _firstRequest(false)
 {
     _socket.connected() += slot(*this, &Connection::onConnect);
     _socket.outputPipelined() += slot(*this, &Connection::onOutput);
@@ -109,6 +156,7 @@ Connection::Connection()
 
 Connection::~Connection()
 {
+    delete _session;
 }
 
 
@@ -119,10 +167,18 @@ void Connection::accept(Net::TcpServer& tcpServer)
 
     _socket.accept(tcpServer);
 
+    // replies are collected in the buffer and written in one go, so the
+    // last segment of a batch should not wait for the previous one
+    if(_noDelay)
+        _socket.setNoDelay(true);
+
     if(_ssl)
         _state = SslNotAccepted;
     else
         _state = Accepted;
+
+    // the first request may switch the connection to HTTP/2
+    _firstRequest = true;
 }
 
 
@@ -184,6 +240,9 @@ void Connection::setActive(System::EventLoop& loop)
 void Connection::cancel()
 {
     log_debug("cancelling connection");
+    delete _session;
+    _session = 0;
+    _firstRequest = false;
     _timer.stop();
     _readSize = 0;
     _readBytes = 0;
@@ -192,6 +251,9 @@ void Connection::cancel()
     _sockios.clear();
     _reply = 0;
     _request = 0;
+    _file = 0;
+    _fileRemaining = 0;
+    _sendingFile = false;
     _state = NotConnected;
     _chunked = false;
     _keepAlive = false;
@@ -203,6 +265,40 @@ void Connection::cancel()
 }
 
 
+void Connection::attach(Request& request, Reply& reply)
+{
+    _exchanges.push_back( std::make_pair(&request, &reply) );
+
+    if(_session)
+        _session->attach(request, reply);
+}
+
+
+void Connection::resetStream(Request& request)
+{
+    if(_session)
+        _session->resetStream(request);
+}
+
+
+void Connection::beginSession()
+{
+    log_debug("switching to HTTP/2");
+
+    _firstRequest = false;
+    _timer.stop();
+    _request = 0;
+
+    _session = new Http2Session(*this, _maxStreams, _maxHeaderSize);
+
+    std::vector< std::pair<Request*, Reply*> >::iterator it;
+    for(it = _exchanges.begin(); it != _exchanges.end(); ++it)
+        _session->attach(*it->first, *it->second);
+
+    _session->start();
+}
+
+
 void Connection::sendRequest(Request& request)
 {
     log_debug("Connection::sendRequest");
@@ -251,7 +347,7 @@ void Connection::sendRequest(Request& request)
             if(mbuf.size() > 0)
             {
                 os << std::hex << mbuf.size() << std::dec << "\r\n";
-                os.write( mbuf.data(), mbuf.size() );
+                writeBody(os, mbuf);
                 os.write("\r\n", 2);
             }
             
@@ -262,7 +358,7 @@ void Connection::sendRequest(Request& request)
         {
             writeRequestHeader(os, request);
             log_debug("writing body: " << mbuf.size() << " bytes");
-            os.write( mbuf.data(), mbuf.size() );
+            writeBody(os, mbuf);
         }
     }
     else
@@ -279,7 +375,7 @@ void Connection::sendRequest(Request& request)
         if(mbuf.size() > 0)
         {
             os << std::hex << mbuf.size() << std::dec << "\r\n";
-            os.write( mbuf.data(), mbuf.size() );
+            writeBody(os, mbuf);
             os.write("\r\n", 2);
         }
     }
@@ -309,7 +405,7 @@ void Connection::receiveReply(Reply& reply)
         _replyParser.parse(ch);
     }
 
-    if( ! _parser.end() || _parser.fail() )
+    if( ! _replyParser.end() || _replyParser.fail() )
     {
         log_info("invalid HTTP reply");
         throw HttpError("invalid HTTP message");
@@ -429,7 +525,7 @@ void Connection::beginSendRequest(Request& request)
             if(mbuf.size() > 0)
             {
                 os << std::hex << mbuf.size() << std::dec << "\r\n";
-                os.write( mbuf.data(), mbuf.size() );
+                writeBody(os, mbuf);
                 os.write("\r\n", 2);
             }
             
@@ -442,7 +538,7 @@ void Connection::beginSendRequest(Request& request)
             
             log_debug("writing body: " << mbuf.size() << " bytes");
             if(mbuf.size() > 0)
-                os.write( mbuf.data(), mbuf.size() );
+                writeBody(os, mbuf);
         }
 
         log_debug("pipelining HTTP request");
@@ -467,7 +563,7 @@ void Connection::beginSendRequest(Request& request)
     if(mbuf.size() > 0)
     {
         os << std::hex << mbuf.size() << std::dec << "\r\n";
-        os.write( mbuf.data(), mbuf.size() );
+        writeBody(os, mbuf);
         os.write("\r\n", 2);
     }
 
@@ -536,6 +632,12 @@ void Connection::beginSendReply(Reply& reply)
 {
     log_trace("Connection::beginSendReply");
 
+    if(_session)
+    {
+        _session->beginSendReply(reply);
+        return;
+    }
+
     _reply = &reply;
 
     MessageHeader& header = _reply->header();
@@ -544,12 +646,26 @@ void Connection::beginSendReply(Reply& reply)
 
     _keepAlive = _keepAlive && header.isKeepAlive();
 
+    // continue sending the file body after the header was written
+    if( _file )
+    {
+        if( outputAvailable() )
+            beginWrite();
+        else
+            beginSendFile();
+
+        return;
+    }
+
     if( ! _keepAlive && outputAvailable() )
     {
         beginWrite();
         return;
     }
 
+    if( reply.file() && (_chunked || ! reply.isFinished()) )
+        throw std::logic_error("file body requires a finished reply");
+
     if( reply.isFinished() )
     {
         if(_chunked)
@@ -557,7 +673,7 @@ void Connection::beginSendReply(Reply& reply)
             if(mbuf.size() > 0)
             {
                 os << std::hex << mbuf.size() << std::dec << "\r\n";
-                os.write( mbuf.data(), mbuf.size() );
+                writeBody(os, mbuf);
                 os.write("\r\n", 2);
             }
 
@@ -570,7 +686,19 @@ void Connection::beginSendReply(Reply& reply)
 
             log_debug("writing body: " << mbuf.size() << " bytes");
             if(mbuf.size() > 0)
-                os.write( mbuf.data(), mbuf.size() );
+                writeBody(os, mbuf);
+
+            if( reply.file() )
+            {
+                log_debug("sending file body: " << reply.fileSize() << " bytes");
+                _file = reply.file();
+                _fileOffset = reply.fileOffset();
+                _fileRemaining = reply.fileSize();
+
+                // the header is written before the file is sent
+                beginWrite();
+                return;
+            }
         }
 
         log_debug("begin writing reply");
@@ -579,6 +707,7 @@ void Connection::beginSendReply(Reply& reply)
         {
             // signal that output was sent, so the reply data can be pipelined
             // until we begin receiving the next request from the client
+            ++_pipelined;
             _socket.setOutputPipelined(); 
         }
         else
@@ -597,7 +726,7 @@ void Connection::beginSendReply(Reply& reply)
     if(mbuf.size() > 0)
     {
         os << std::hex << mbuf.size() << std::dec << "\r\n";
-        os.write( mbuf.data(), mbuf.size() );
+        writeBody(os, mbuf);
         os.write("\r\n", 2);
     }
 
@@ -607,16 +736,37 @@ void Connection::beginSendReply(Reply& reply)
 }
 
 
-MessageProgress Connection::endSendReply()
+MessageProgress Connection::endSendReply(Reply& reply)
 {
     log_trace("Connection::endSendReply");
 
+    if(_session)
+        return _session->endSendReply(reply);
+
     MessageProgress progress;
     
     if(_onTimeout)
         throw System::IOError("timeout");
-        
-    if( ! _reply->isFinished() || ! _keepAlive)
+
+    if( _file )
+    {
+        if(_sendingFile)
+            endSendFile();
+        else
+            endWrite();
+
+        if( _socket.isEof() )
+            throw System::IOError("connection lost");
+
+        if( outputAvailable() || _fileRemaining > 0 )
+        {
+            log_debug("still file data to send: " << _fileRemaining);
+            return progress;
+        }
+
+        _file = 0;
+    }
+    else if( ! _reply->isFinished() || ! _keepAlive)
     {
         endWrite();
     }
@@ -663,6 +813,12 @@ void Connection::beginReceiveRequest(Request& request)
 {
     log_trace("Connection::beginReceiveRequest " << _state);
 
+    if(_session)
+    {
+        _session->beginReceiveRequest(request);
+        return;
+    }
+
     _request = &request;
 
     if(_state == SslNotAccepted)
@@ -725,9 +881,22 @@ void Connection::beginReceiveRequest(Request& request)
         _state = Accepted;
     }
 
-    // send remaining pipelined replies, if no further requests
-    // are in the pipeline.
-    if( outputAvailable() && ! inputAvailable() )
+    if(_ssl && _firstRequest)
+    {
+        _firstRequest = false;
+
+        // HTTP/2 was negotiated during the handshake
+        if( _sslbuf.applicationProtocol() == "h2" )
+        {
+            beginSession();
+            _session->beginReceiveRequest(request);
+            return;
+        }
+    }
+
+    // pipelined replies are collected and written together, when the
+    // next request can not be served from the buffered input
+    if( outputAvailable() && ! continueBatch() )
     {
         log_debug("sending remaining reply data");
         beginWrite();
@@ -737,6 +906,7 @@ void Connection::beginReceiveRequest(Request& request)
 
     log_debug("begin reading request");
     _parseEvent.init( request );
+    request.header().setMaxSize(_maxHeaderSize);
 
     // NOTE: the http header parser is also not at begin if data from the
     // last request has not been read. 
@@ -762,9 +932,13 @@ void Connection::beginReceiveRequest(Request& request)
 }
 
 
-MessageProgress Connection::endReceiveRequest()
+MessageProgress Connection::endReceiveRequest(Request& request)
 {
     log_trace("Connection::endReceiveRequest");
+
+    if(_session)
+        return _session->endReceiveRequest(request);
+
     MessageProgress progress;
 
     if(_onTimeout)
@@ -803,6 +977,28 @@ MessageProgress Connection::endReceiveRequest()
         throw System::IOError("connection lost");
     }
 
+    // clients with prior knowledge begin with the HTTP/2 preface
+    if(_firstRequest)
+    {
+        std::size_t n = 0;
+        const char* data = _sockbuf.sview(n);
+        std::size_t matched = Http2Session::matchPreface(data, n);
+
+        if(matched == Http2Session::PrefaceSize)
+        {
+            beginSession();
+            return progress;
+        }
+
+        if(matched == n)
+        {
+            log_debug("incomplete preface");
+            return progress;
+        }
+
+        _firstRequest = false;
+    }
+
     if( ! _parser.end() )
     {       
         // switch from keepalive timeout to receive timeout
@@ -991,6 +1187,12 @@ void Connection::onOutput()
 {
     log_trace("Connection::onOutput");
 
+    if(_session)
+    {
+        _session->onReady();
+        return;
+    }
+
     if(_request)
     {
         if( _request->isReceiving() )
@@ -1015,6 +1217,12 @@ void Connection::onInput()
 {
     log_trace("Connection::onInput");
 
+    if(_session)
+    {
+        _session->onReady();
+        return;
+    }
+
     if(_request)
     {
         if( _request->isReceiving() )
@@ -1038,24 +1246,43 @@ void Connection::onInput()
 void Connection::onTimeout()
 {
     log_trace("Connection::onTimeout");
+
+    if(_session)
+    {
+        _session->onTimeout();
+        return;
+    }
+
     _onTimeout = true;
 
     onInput();
 }
 
 
-void Connection::onHttpInput(System::IOBuffer&)
+void Connection::onHttpInput(System::ChainBuffer&)
 {
     log_trace("Connection::onHttpInput");
 
+    if(_session)
+    {
+        _session->onInput();
+        return;
+    }
+
     onInput();
 }
 
 
-void Connection::onHttpOutput(System::IOBuffer&)
+void Connection::onHttpOutput(System::ChainBuffer&)
 {
     log_trace("Connection::onHttpOutput");
 
+    if(_session)
+    {
+        _session->onOutput();
+        return;
+    }
+
     onOutput();
 }
 
@@ -1125,6 +1352,53 @@ bool Connection::inputAvailable()
 }
 
 
+bool Connection::continueBatch()
+{
+    if(_pipelined >= _maxPipelined)
+        return false;
+
+    if(_sockbuf.out_avail() >= static_cast<std::streamsize>(MaxBatchSize))
+        return false;
+
+    // a started request or body is continued from the buffered input,
+    // encrypted input can not be inspected before it is read
+    if( ! _parser.begin() || _ssl )
+        return inputAvailable();
+
+    // the replies are not held back, while the rest of the next
+    // request is read from the network
+    return headerBuffered();
+}
+
+
+bool Connection::headerBuffered()
+{
+    std::size_t n = 0;
+    const char* data = _sockbuf.sview(n);
+
+    // the header might span several slabs, assume it is complete
+    if(static_cast<std::streamsize>(n) < _sockbuf.in_avail())
+        return true;
+
+    const char* end = data + n;
+    for(const char* p = data; p != end; ++p)
+    {
+        p = static_cast<const char*>( std::memchr(p, '\n', end - p) );
+        if( ! p )
+            return false;
+
+        const char* next = p + 1;
+        if(next != end && *next == '\r')
+            ++next;
+
+        if(next != end && *next == '\n')
+            return true;
+    }
+
+    return false;
+}
+
+
 void Connection::beginWrite()
 {
     log_debug("Connection::beginWrite");
@@ -1137,6 +1411,7 @@ void Connection::beginWrite()
 
     log_debug("begin writing socket buffer: " << _sockbuf.out_avail());
     _timer.start(_timeout);
+    _pipelined = 0;
     _sockbuf.beginWrite();
 }
 
@@ -1148,6 +1423,50 @@ void Connection::endWrite()
 }
 
 
+void Connection::beginSendFile()
+{
+    _timer.start(_timeout);
+
+    if(_ssl)
+    {
+        // encrypted data is copied through the SSL buffer
+        char buffer[FileCopySize];
+        std::size_t n = _fileRemaining < FileCopySize ? static_cast<std::size_t>(_fileRemaining)
+                                                      : FileCopySize;
+
+        _file->seek(static_cast<System::FileDevice::off_type>(_fileOffset), std::ios::beg);
+        std::size_t r = _file->read(buffer, n);
+        if(r == 0)
+            throw System::IOError("end of file");
+
+        _fileOffset += r;
+        _fileRemaining -= r;
+
+        _os.write(buffer, r);
+        beginWrite();
+        return;
+    }
+
+    const Pt::uint64_t maxSize = std::numeric_limits<std::size_t>::max();
+    std::size_t n = _fileRemaining < maxSize ? static_cast<std::size_t>(_fileRemaining)
+                                             : static_cast<std::size_t>(maxSize);
+
+    _socket.beginSendFile(*_file, _fileOffset, n);
+    _sendingFile = true;
+}
+
+
+void Connection::endSendFile()
+{
+    _timer.stop();
+    _sendingFile = false;
+
+    std::size_t n = _socket.endWrite();
+    _fileOffset += n;
+    _fileRemaining -= n;
+}
+
+
 bool Connection::outputAvailable()
 {
     if(_ssl)
@@ -1156,7 +1475,21 @@ bool Connection::outputAvailable()
         _sslbuf.pubsync();
     }
 
-    return _sockbuf.out_avail() > 0;
+    return _sockbuf.out_avail() > 0 || _sockbuf.queued() > 0;
+}
+
+
+void Connection::writeBody(std::ostream& os, MessageBuffer& mbuf)
+{
+    // large bodies are sent with the header in one vectored write, unless
+    // they need to be encrypted
+    if( ! _ssl && mbuf.size() >= MinQueueSize )
+    {
+        mbuf.moveTo(_sockbuf);
+        return;
+    }
+
+    os.write( mbuf.data(), mbuf.size() );
 }
 
 
@@ -1255,8 +1588,12 @@ void Connection::writeReplyHeader(std::ostream& os, Reply& reply)
         os.write("Transfer-Encoding: chunked\r\n", 28);
     else
     {
+        Pt::uint64_t size = _reply->buffer().size();
+        if( _reply->file() )
+            size += _reply->fileSize();
+
         os.write("Content-Length: ", 16);
-        formatInt( oit, _reply->buffer().size() ); 
+        formatInt( oit, size );
         os.write("\r\n", 2);
     }
 
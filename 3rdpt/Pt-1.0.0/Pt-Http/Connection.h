@@ -37,13 +37,15 @@
 #include <Pt/Http/Reply.h>
 #include <Pt/Ssl/StreamBuffer.h>
 #include <Pt/Net/TcpSocket.h>
-#include <Pt/System/IOBuffer.h>
+#include <Pt/System/ChainBuffer.h>
 #include <Pt/System/Timer.h>
 #include <Pt/System/EventLoop.h>
 #include <Pt/Signal.h>
 #include <Pt/Connectable.h>
 
 #include <iostream>
+#include <vector>
+#include <utility>
 
 namespace Pt {
 
@@ -55,6 +57,7 @@ namespace Http {
 
 class Reply;
 class Request;
+class Http2Session;
 
 class Socket : public Net::TcpSocket
 {
@@ -130,6 +133,7 @@ class Connection : public Connectable
 {
     friend class Request;
     friend class Reply;
+    friend class Http2Session;
 
     class ParseEvent : public HeaderParser::MessageHeaderEvent
     {
@@ -150,6 +154,9 @@ class Connection : public Connectable
             virtual void onMethod(const std::string& method);
             virtual void onUrl(const std::string& url);
             virtual void onUrlParam(const std::string& q);
+            virtual void onMethod(const char* method, std::size_t n);
+            virtual void onUrl(const char* url, std::size_t n);
+            virtual void onUrlParam(const char* q, std::size_t n);
     };
 
     class ReplyParseEvent : public HeaderParser::MessageHeaderEvent
@@ -176,6 +183,10 @@ class Connection : public Connectable
 
         static const std::size_t NoRequestSizeLimit = static_cast<const std::size_t>(-1);
 
+        static const std::size_t DefaultMaxPipelined = 16;
+
+        static const std::size_t DefaultMaxStreams = 100;
+
     public:
         Connection();
 
@@ -209,9 +220,46 @@ class Connection : public Connectable
         void setMaxReadSize(std::size_t maxSize)
         { _maxReadSize = maxSize; }
 
+        void setMaxHeaderSize(std::size_t maxSize)
+        { _maxHeaderSize = maxSize; }
+
+        void setMaxPipelined(std::size_t n)
+        { _maxPipelined = n > 0 ? n : 1; }
+
+        //! @brief Sets TCP_NODELAY on accepted connections
+        void setNoDelay(bool noDelay)
+        { _noDelay = noDelay; }
+
+        //! @brief Sets the maximum number of concurrent HTTP/2 streams
+        void setMaxStreams(std::size_t n)
+        { _maxStreams = n > 0 ? n : 1; }
+
         bool isConnected() const
         { return _socket.isConnected(); }
 
+        //! @brief Returns true, if requests are multiplexed with HTTP/2
+        bool isMultiplexed() const
+        { return _session != 0; }
+
+        /** @brief Adds a request and reply pair for the server side.
+
+            A HTTP/2 connection binds each stream to one of the attached
+            pairs. The pair, which received the first request, must be
+            attached before the connection can switch to HTTP/2.
+        */
+        void attach(Request& request, Reply& reply);
+
+        //! @brief Resets the HTTP/2 stream, which is bound to a request
+        void resetStream(Request& request);
+
+        //! @brief Sent when a HTTP/2 stream waits for a request and reply pair
+        Signal<Connection&>& requestPending()
+        { return _requestPending; }
+
+        //! @brief Sent when a HTTP/2 connection was closed
+        Signal<Connection&>& sessionFinished()
+        { return _sessionFinished; }
+
         void cancel();
 
     protected:
@@ -225,11 +273,11 @@ class Connection : public Connectable
 
         void beginSendReply(Reply& r);
 
-        MessageProgress endSendReply();
+        MessageProgress endSendReply(Reply& r);
 
         void beginReceiveRequest(Request& r);
 
-        MessageProgress endReceiveRequest();
+        MessageProgress endReceiveRequest(Request& r);
 
         void beginReceiveReply(Reply& r);
 
@@ -246,9 +294,9 @@ class Connection : public Connectable
 
         void onTimeout();
 
-        void onHttpInput(System::IOBuffer& sb);
+        void onHttpInput(System::ChainBuffer& sb);
 
-        void onHttpOutput(System::IOBuffer& sb);
+        void onHttpOutput(System::ChainBuffer& sb);
 
         void beginRead();
 
@@ -258,14 +306,26 @@ class Connection : public Connectable
 
         void endWrite();
 
+        void beginSendFile();
+
+        void endSendFile();
+
         bool inputAvailable();
 
         bool outputAvailable();
+
+        bool continueBatch();
+
+        bool headerBuffered();
       
         void writeRequestHeader(std::ostream& os, Request& request);
 
         void writeReplyHeader(std::ostream& os, Reply& reply);
 
+        void writeBody(std::ostream& os, MessageBuffer& mbuf);
+
+        void beginSession();
+
     private:
         ParseEvent _parseEvent;
         HeaderParser _parser;
@@ -278,7 +338,7 @@ class Connection : public Connectable
 
         System::Timer _timer;
         Socket _socket;
-        System::IOBuffer _sockbuf;
+        System::ChainBuffer _sockbuf;
         std::iostream _sockios;
         Net::Endpoint _addrInfo;
         Net::TcpSocketOptions _tcpOptions;
@@ -293,9 +353,18 @@ class Connection : public Connectable
         std::size_t _timeout;
         std::size_t _keepaliveTimeout;
         std::size_t _maxReadSize;
+        std::size_t _maxHeaderSize;
+        std::size_t _maxPipelined;
+        std::size_t _pipelined;
+        bool _noDelay;
         std::size_t _readSize;
         std::streamsize _readBytes;
 
+        System::FileDevice* _file;
+        Pt::uint64_t _fileOffset;
+        Pt::uint64_t _fileRemaining;
+        bool _sendingFile;
+
         enum State
         {
             NotConnected = 0,
@@ -317,6 +386,13 @@ class Connection : public Connectable
         bool _chunked;
         bool _keepAlive;
         bool _onTimeout;
+
+        Http2Session* _session;
+        std::size_t _maxStreams;
+        bool _firstRequest;
+        std::vector< std::pair<Request*, Reply*> > _exchanges;
+        Signal<Connection&> _requestPending;
+        Signal<Connection&> _sessionFinished;
 };
 
 } // namespace Http
@@ -0,0 +1,747 @@
+/*
+ * Copyright (C) 2005-2013 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "Hpack.h"
+
+#include <cstring>
+
+namespace Pt {
+
+namespace Http {
+
+namespace {
+
+struct StaticField
+{
+    const char* name;
+    std::size_t nameSize;
+    const char* value;
+    std::size_t valueSize;
+};
+
+#define PT_HPACK_FIELD(name, value) { name, sizeof(name) - 1, value, sizeof(value) - 1 }
+
+// static table of RFC 7541, Appendix A
+const StaticField staticTable[] =
+{
+    PT_HPACK_FIELD(":authority", ""),
+    PT_HPACK_FIELD(":method", "GET"),
+    PT_HPACK_FIELD(":method", "POST"),
+    PT_HPACK_FIELD(":path", "/"),
+    PT_HPACK_FIELD(":path", "/index.html"),
+    PT_HPACK_FIELD(":scheme", "http"),
+    PT_HPACK_FIELD(":scheme", "https"),
+    PT_HPACK_FIELD(":status", "200"),
+    PT_HPACK_FIELD(":status", "204"),
+    PT_HPACK_FIELD(":status", "206"),
+    PT_HPACK_FIELD(":status", "304"),
+    PT_HPACK_FIELD(":status", "400"),
+    PT_HPACK_FIELD(":status", "404"),
+    PT_HPACK_FIELD(":status", "500"),
+    PT_HPACK_FIELD("accept-charset", ""),
+    PT_HPACK_FIELD("accept-encoding", "gzip, deflate"),
+    PT_HPACK_FIELD("accept-language", ""),
+    PT_HPACK_FIELD("accept-ranges", ""),
+    PT_HPACK_FIELD("accept", ""),
+    PT_HPACK_FIELD("access-control-allow-origin", ""),
+    PT_HPACK_FIELD("age", ""),
+    PT_HPACK_FIELD("allow", ""),
+    PT_HPACK_FIELD("authorization", ""),
+    PT_HPACK_FIELD("cache-control", ""),
+    PT_HPACK_FIELD("content-disposition", ""),
+    PT_HPACK_FIELD("content-encoding", ""),
+    PT_HPACK_FIELD("content-language", ""),
+    PT_HPACK_FIELD("content-length", ""),
+    PT_HPACK_FIELD("content-location", ""),
+    PT_HPACK_FIELD("content-range", ""),
+    PT_HPACK_FIELD("content-type", ""),
+    PT_HPACK_FIELD("cookie", ""),
+    PT_HPACK_FIELD("date", ""),
+    PT_HPACK_FIELD("etag", ""),
+    PT_HPACK_FIELD("expect", ""),
+    PT_HPACK_FIELD("expires", ""),
+    PT_HPACK_FIELD("from", ""),
+    PT_HPACK_FIELD("host", ""),
+    PT_HPACK_FIELD("if-match", ""),
+    PT_HPACK_FIELD("if-modified-since", ""),
+    PT_HPACK_FIELD("if-none-match", ""),
+    PT_HPACK_FIELD("if-range", ""),
+    PT_HPACK_FIELD("if-unmodified-since", ""),
+    PT_HPACK_FIELD("last-modified", ""),
+    PT_HPACK_FIELD("link", ""),
+    PT_HPACK_FIELD("location", ""),
+    PT_HPACK_FIELD("max-forwards", ""),
+    PT_HPACK_FIELD("proxy-authenticate", ""),
+    PT_HPACK_FIELD("proxy-authorization", ""),
+    PT_HPACK_FIELD("range", ""),
+    PT_HPACK_FIELD("referer", ""),
+    PT_HPACK_FIELD("refresh", ""),
+    PT_HPACK_FIELD("retry-after", ""),
+    PT_HPACK_FIELD("server", ""),
+    PT_HPACK_FIELD("set-cookie", ""),
+    PT_HPACK_FIELD("strict-transport-security", ""),
+    PT_HPACK_FIELD("transfer-encoding", ""),
+    PT_HPACK_FIELD("user-agent", ""),
+    PT_HPACK_FIELD("vary", ""),
+    PT_HPACK_FIELD("via", ""),
+    PT_HPACK_FIELD("www-authenticate", "")
+};
+
+#undef PT_HPACK_FIELD
+
+const std::size_t StaticTableSize = sizeof(staticTable) / sizeof(StaticField);
+
+// the size of the dynamic table, both sides start with
+const std::size_t DefaultTableSize = 4096;
+
+// code lengths of the Huffman code of RFC 7541, Appendix B. The code is
+// canonical, so the codes can be assigned in the order of the lengths.
+const Pt::uint8_t huffmanLengths[257] =
+{
+    13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+    28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+     6, 10, 10, 12, 13,  6,  8, 11, 10, 10,  8, 11,  8,  6,  6,  6,
+     5,  5,  5,  6,  6,  6,  6,  6,  6,  6,  7,  8, 15,  6, 12, 10,
+    13,  6,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,
+     7,  7,  7,  7,  7,  7,  7,  7,  8,  7,  8, 13, 19, 13, 14,  6,
+    15,  5,  6,  5,  6,  5,  6,  6,  6,  5,  7,  7,  6,  6,  6,  5,
+     6,  7,  6,  5,  5,  6,  7,  7,  7,  7,  7, 15, 11, 14, 13, 28,
+    20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+    24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+    22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+    21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+    26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+    19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+    20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+    26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+    30
+};
+
+const unsigned EndOfString = 256;
+
+/* Codes and decoding automaton of the Huffman code. The decoder reads
+   four bits at a time. Its states are the inner nodes of the code tree,
+   the transitions lead to the node reached after four bits and emit at
+   most one symbol, because no code is shorter than five bits.
+*/
+class HuffmanCode
+{
+    public:
+        struct Transition
+        {
+            Pt::uint8_t state;
+            Pt::uint8_t flags;
+            Pt::uint8_t symbol;
+        };
+
+        enum Flags
+        {
+            Emit = 1,
+            Fail = 2,
+            Accept = 4
+        };
+
+    public:
+        HuffmanCode();
+
+        Pt::uint32_t codes[257];
+        Transition transitions[256][16];
+};
+
+
+HuffmanCode::HuffmanCode()
+{
+    // assign canonical codes in the order of length and symbol
+    Pt::uint32_t code = 0;
+    unsigned length = 0;
+
+    for(unsigned len = 1; len <= 30; ++len)
+    {
+        for(unsigned sym = 0; sym < 257; ++sym)
+        {
+            if(huffmanLengths[sym] != len)
+                continue;
+
+            code <<= (len - length);
+            length = len;
+            codes[sym] = code++;
+        }
+    }
+
+    // build the code tree, leaves are stored as 256 + symbol
+    Pt::uint16_t tree[256][2];
+    std::memset(tree, 0, sizeof(tree));
+    unsigned nodes = 1;
+
+    for(unsigned sym = 0; sym < 257; ++sym)
+    {
+        unsigned node = 0;
+        unsigned len = huffmanLengths[sym];
+
+        for(unsigned bit = len; bit-- > 1; )
+        {
+            unsigned b = (codes[sym] >> bit) & 1;
+            if(tree[node][b] == 0)
+                tree[node][b] = static_cast<Pt::uint16_t>(nodes++);
+
+            node = tree[node][b];
+        }
+
+        tree[node][codes[sym] & 1] = static_cast<Pt::uint16_t>(256 + sym);
+    }
+
+    // nodes on the path of ones from the root can end a string, if the
+    // padding is shorter than a byte
+    bool accepting[256];
+    std::memset(accepting, 0, sizeof(accepting));
+    accepting[0] = true;
+
+    unsigned node = 0;
+    for(unsigned depth = 1; depth < 8; ++depth)
+    {
+        node = tree[node][1];
+        accepting[node] = true;
+    }
+
+    for(unsigned state = 0; state < 256; ++state)
+    {
+        for(unsigned nibble = 0; nibble < 16; ++nibble)
+        {
+            Transition& t = transitions[state][nibble];
+            t.flags = 0;
+            t.symbol = 0;
+
+            unsigned current = state;
+            for(unsigned bit = 4; bit-- > 0; )
+            {
+                unsigned next = tree[current][(nibble >> bit) & 1];
+                if(next >= 256)
+                {
+                    if(next - 256 == EndOfString)
+                    {
+                        t.flags = Fail;
+                        break;
+                    }
+
+                    t.flags |= Emit;
+                    t.symbol = static_cast<Pt::uint8_t>(next - 256);
+                    next = 0;
+                }
+
+                current = next;
+            }
+
+            t.state = static_cast<Pt::uint8_t>(current);
+            if( accepting[current] )
+                t.flags |= Accept;
+        }
+    }
+}
+
+const HuffmanCode huffmanCode;
+
+
+void encodeInteger(std::string& out, Pt::uint8_t flags, unsigned prefix, std::size_t value)
+{
+    const std::size_t max = (1u << prefix) - 1;
+
+    if(value < max)
+    {
+        out += static_cast<char>(flags | value);
+        return;
+    }
+
+    out += static_cast<char>(flags | max);
+    value -= max;
+
+    while(value >= 128)
+    {
+        out += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+
+    out += static_cast<char>(value);
+}
+
+
+bool decodeInteger(const char*& p, const char* e, unsigned prefix, std::size_t& value)
+{
+    if(p == e)
+        return false;
+
+    const std::size_t max = (1u << prefix) - 1;
+    value = static_cast<Pt::uint8_t>(*p++) & max;
+
+    if(value < max)
+        return true;
+
+    // larger values than 2^28 are not needed for any valid header
+    for(unsigned shift = 0; p != e && shift <= 21; shift += 7)
+    {
+        Pt::uint8_t b = static_cast<Pt::uint8_t>(*p++);
+        value += static_cast<std::size_t>(b & 0x7f) << shift;
+
+        if( (b & 0x80) == 0 )
+            return true;
+    }
+
+    return false;
+}
+
+
+void encodeString(std::string& out, const char* s, std::size_t n)
+{
+    std::size_t size = HpackHuffman::encodedSize(s, n);
+
+    if(size < n)
+    {
+        encodeInteger(out, 0x80, 7, size);
+        HpackHuffman::encode(out, s, n);
+        return;
+    }
+
+    encodeInteger(out, 0, 7, n);
+    out.append(s, n);
+}
+
+
+bool equals(const std::string& s, const char* str, std::size_t n)
+{
+    return s.size() == n && std::memcmp(s.data(), str, n) == 0;
+}
+
+
+// values of these fields differ from message to message
+bool isVolatile(const char* name, std::size_t n)
+{
+    switch(n)
+    {
+        case 4:
+            return std::memcmp(name, "etag", 4) == 0;
+
+        case 13:
+            return std::memcmp(name, "content-range", 13) == 0 ||
+                   std::memcmp(name, "last-modified", 13) == 0;
+
+        case 14:
+            return std::memcmp(name, "content-length", 14) == 0;
+    }
+
+    return false;
+}
+
+
+// these fields are sensitive and are not compressed by intermediaries
+bool isSensitive(const char* name, std::size_t n)
+{
+    return (n == 10 && std::memcmp(name, "set-cookie", 10) == 0) ||
+           (n == 13 && std::memcmp(name, "authorization", 13) == 0);
+}
+
+}
+
+
+std::size_t HpackHuffman::encodedSize(const char* s, std::size_t n)
+{
+    std::size_t bits = 0;
+    for(const char* e = s + n; s != e; ++s)
+        bits += huffmanLengths[ static_cast<Pt::uint8_t>(*s) ];
+
+    return (bits + 7) / 8;
+}
+
+
+void HpackHuffman::encode(std::string& out, const char* s, std::size_t n)
+{
+    Pt::uint64_t bits = 0;
+    unsigned count = 0;
+
+    for(const char* e = s + n; s != e; ++s)
+    {
+        Pt::uint8_t ch = static_cast<Pt::uint8_t>(*s);
+        bits = (bits << huffmanLengths[ch]) | huffmanCode.codes[ch];
+        count += huffmanLengths[ch];
+
+        while(count >= 8)
+        {
+            count -= 8;
+            out += static_cast<char>(bits >> count);
+        }
+
+        bits &= (Pt::uint64_t(1) << count) - 1;
+    }
+
+    // pad with the most significant bits of the EOS code
+    if(count > 0)
+    {
+        unsigned pad = 8 - count;
+        out += static_cast<char>( (bits << pad) | ((1u << pad) - 1) );
+    }
+}
+
+
+bool HpackHuffman::decode(std::string& out, const char* s, std::size_t n)
+{
+    unsigned state = 0;
+    unsigned flags = HuffmanCode::Accept;
+
+    for(const char* e = s + n; s != e; ++s)
+    {
+        Pt::uint8_t ch = static_cast<Pt::uint8_t>(*s);
+
+        const HuffmanCode::Transition& hi = huffmanCode.transitions[state][ch >> 4];
+        if(hi.flags & HuffmanCode::Fail)
+            return false;
+
+        if(hi.flags & HuffmanCode::Emit)
+            out += static_cast<char>(hi.symbol);
+
+        const HuffmanCode::Transition& lo = huffmanCode.transitions[hi.state][ch & 0x0f];
+        if(lo.flags & HuffmanCode::Fail)
+            return false;
+
+        if(lo.flags & HuffmanCode::Emit)
+            out += static_cast<char>(lo.symbol);
+
+        state = lo.state;
+        flags = lo.flags;
+    }
+
+    return (flags & HuffmanCode::Accept) != 0;
+}
+
+
+HpackTable::HpackTable(std::size_t maxSize)
+: _size(0)
+, _maxSize(maxSize)
+{
+}
+
+
+void HpackTable::setMaxSize(std::size_t n)
+{
+    _maxSize = n;
+    evict(0);
+}
+
+
+void HpackTable::add(const char* name, std::size_t nameSize,
+                     const char* value, std::size_t valueSize)
+{
+    const std::size_t required = nameSize + valueSize + 32;
+
+    // an entry larger than the table empties it
+    if(required > _maxSize)
+    {
+        clear();
+        return;
+    }
+
+    // the name and value may refer to an entry, which is evicted
+    Entry entry;
+    entry.name.assign(name, nameSize);
+    entry.value.assign(value, valueSize);
+
+    evict(required);
+
+    _entries.push_front( Entry() );
+    _entries.front().name.swap(entry.name);
+    _entries.front().value.swap(entry.value);
+    _size += required;
+}
+
+
+void HpackTable::clear()
+{
+    _entries.clear();
+    _size = 0;
+}
+
+
+void HpackTable::evict(std::size_t required)
+{
+    while( ! _entries.empty() && _size + required > _maxSize )
+    {
+        const Entry& entry = _entries.back();
+        _size -= entry.name.size() + entry.value.size() + 32;
+        _entries.pop_back();
+    }
+}
+
+
+HpackDecoder::HpackDecoder()
+: _table(DefaultTableSize)
+, _maxTableSize(DefaultTableSize)
+{
+}
+
+
+bool HpackDecoder::decode(const char* data, std::size_t n, Event& ev)
+{
+    const char* p = data;
+    const char* e = data + n;
+    bool hasFields = false;
+
+    while(p != e)
+    {
+        const Pt::uint8_t b = static_cast<Pt::uint8_t>(*p);
+        std::size_t index = 0;
+
+        // indexed header field
+        if(b & 0x80)
+        {
+            const char* name = 0;
+            const char* value = 0;
+            std::size_t nameSize = 0;
+            std::size_t valueSize = 0;
+
+            if( ! decodeInteger(p, e, 7, index) ||
+                ! field(index, name, nameSize, value, valueSize) )
+                return false;
+
+            ev.onField(name, nameSize, value, valueSize);
+            hasFields = true;
+            continue;
+        }
+
+        // dynamic table size update, only allowed before the first field
+        if( (b & 0xe0) == 0x20 )
+        {
+            if(hasFields || ! decodeInteger(p, e, 5, index) || index > _maxTableSize)
+                return false;
+
+            _table.setMaxSize(index);
+            continue;
+        }
+
+        // literal header field with or without indexing
+        const bool indexing = (b & 0xc0) == 0x40;
+        if( ! decodeInteger(p, e, indexing ? 6 : 4, index) )
+            return false;
+
+        const char* name = 0;
+        std::size_t nameSize = 0;
+
+        if(index > 0)
+        {
+            const char* v = 0;
+            std::size_t vn = 0;
+            if( ! field(index, name, nameSize, v, vn) )
+                return false;
+        }
+        else if( ! decodeString(p, e, _name, name, nameSize) )
+        {
+            return false;
+        }
+
+        const char* value = 0;
+        std::size_t valueSize = 0;
+
+        if( ! decodeString(p, e, _value, value, valueSize) )
+            return false;
+
+        ev.onField(name, nameSize, value, valueSize);
+        hasFields = true;
+
+        if(indexing)
+            _table.add(name, nameSize, value, valueSize);
+    }
+
+    return true;
+}
+
+
+bool HpackDecoder::decodeString(const char*& p, const char* e, std::string& buffer,
+                                const char*& s, std::size_t& n)
+{
+    if(p == e)
+        return false;
+
+    const bool huffman = (*p & 0x80) != 0;
+
+    std::size_t size = 0;
+    if( ! decodeInteger(p, e, 7, size) || static_cast<std::size_t>(e - p) < size )
+        return false;
+
+    if(huffman)
+    {
+        buffer.clear();
+        if( ! HpackHuffman::decode(buffer, p, size) )
+            return false;
+
+        s = buffer.data();
+        n = buffer.size();
+    }
+    else
+    {
+        s = p;
+        n = size;
+    }
+
+    p += size;
+    return true;
+}
+
+
+bool HpackDecoder::field(std::size_t index, const char*& name, std::size_t& nameSize,
+                         const char*& value, std::size_t& valueSize) const
+{
+    if(index == 0)
+        return false;
+
+    if(index <= StaticTableSize)
+    {
+        const StaticField& f = staticTable[index - 1];
+        name = f.name;
+        nameSize = f.nameSize;
+        value = f.value;
+        valueSize = f.valueSize;
+        return true;
+    }
+
+    index -= StaticTableSize + 1;
+    if(index >= _table.count())
+        return false;
+
+    const HpackTable::Entry& entry = _table[index];
+    name = entry.name.data();
+    nameSize = entry.name.size();
+    value = entry.value.data();
+    valueSize = entry.value.size();
+    return true;
+}
+
+
+HpackEncoder::HpackEncoder()
+: _table(DefaultTableSize)
+, _pendingSize(DefaultTableSize)
+, _sizeUpdate(false)
+{
+}
+
+
+void HpackEncoder::setMaxTableSize(std::size_t n)
+{
+    // a larger table than the default is not used
+    _pendingSize = n < DefaultTableSize ? n : DefaultTableSize;
+    _sizeUpdate = _pendingSize != _table.maxSize();
+}
+
+
+void HpackEncoder::beginBlock(std::string& out)
+{
+    if(_sizeUpdate)
+    {
+        encodeInteger(out, 0x20, 5, _pendingSize);
+        _table.setMaxSize(_pendingSize);
+        _sizeUpdate = false;
+    }
+}
+
+
+void HpackEncoder::encode(std::string& out, const char* name, std::size_t nameSize,
+                          const char* value, std::size_t valueSize)
+{
+    bool exact = false;
+    std::size_t index = find(name, nameSize, value, valueSize, exact);
+
+    if(exact)
+    {
+        encodeInteger(out, 0x80, 7, index);
+        return;
+    }
+
+    bool indexing = false;
+
+    if( isSensitive(name, nameSize) )
+    {
+        encodeInteger(out, 0x10, 4, index);
+    }
+    else if( isVolatile(name, nameSize) || nameSize + valueSize + 32 > _table.maxSize() / 2 )
+    {
+        encodeInteger(out, 0x00, 4, index);
+    }
+    else
+    {
+        encodeInteger(out, 0x40, 6, index);
+        indexing = true;
+    }
+
+    if(index == 0)
+        encodeString(out, name, nameSize);
+
+    encodeString(out, value, valueSize);
+
+    if(indexing)
+        _table.add(name, nameSize, value, valueSize);
+}
+
+
+std::size_t HpackEncoder::find(const char* name, std::size_t nameSize,
+                               const char* value, std::size_t valueSize, bool& exact) const
+{
+    std::size_t nameIndex = 0;
+
+    for(std::size_t n = 0; n < StaticTableSize; ++n)
+    {
+        const StaticField& f = staticTable[n];
+        if(f.nameSize != nameSize || std::memcmp(f.name, name, nameSize) != 0)
+            continue;
+
+        if(f.valueSize == valueSize && std::memcmp(f.value, value, valueSize) == 0)
+        {
+            exact = true;
+            return n + 1;
+        }
+
+        if(nameIndex == 0)
+            nameIndex = n + 1;
+    }
+
+    for(std::size_t n = 0; n < _table.count(); ++n)
+    {
+        const HpackTable::Entry& entry = _table[n];
+        if( ! equals(entry.name, name, nameSize) )
+            continue;
+
+        if( equals(entry.value, value, valueSize) )
+        {
+            exact = true;
+            return StaticTableSize + 1 + n;
+        }
+
+        if(nameIndex == 0)
+            nameIndex = StaticTableSize + 1 + n;
+    }
+
+    return nameIndex;
+}
+
+} // namespace Http
+
+} // namespace Pt
@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2005-2013 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef Pt_Http_Hpack_h
+#define Pt_Http_Hpack_h
+
+#include <Pt/Http/Api.h>
+#include <Pt/Types.h>
+#include <string>
+#include <deque>
+#include <cstddef>
+
+namespace Pt {
+
+namespace Http {
+
+/** @internal @brief Dynamic table of the HPACK header compression.
+
+    New fields are inserted at the front and the oldest fields are evicted
+    when the size of the table exceeds its maximum size. The size of an
+    entry is the length of its name and value plus 32 (RFC 7541, 4.1).
+*/
+class HpackTable
+{
+    public:
+        struct Entry
+        {
+            std::string name;
+            std::string value;
+        };
+
+    public:
+        explicit HpackTable(std::size_t maxSize = 4096);
+
+        std::size_t size() const
+        { return _size; }
+
+        std::size_t maxSize() const
+        { return _maxSize; }
+
+        void setMaxSize(std::size_t n);
+
+        std::size_t count() const
+        { return _entries.size(); }
+
+        //! @brief Returns the entry at \a n, starting with the newest one.
+        const Entry& operator[](std::size_t n) const
+        { return _entries[n]; }
+
+        void add(const char* name, std::size_t nameSize,
+                 const char* value, std::size_t valueSize);
+
+        void clear();
+
+    private:
+        void evict(std::size_t required);
+
+    private:
+        std::deque<Entry> _entries;
+        std::size_t _size;
+        std::size_t _maxSize;
+};
+
+/** @internal @brief Decodes HPACK header blocks.
+
+    The decoder must see all header blocks of a connection in the order
+    they were received, because each block may modify the dynamic table.
+    Decoded fields are reported to an event handler with pointers to the
+    name and value, which are only valid during the call.
+*/
+class HpackDecoder
+{
+    public:
+        class Event
+        {
+            public:
+                virtual ~Event()
+                {}
+
+                virtual void onField(const char* name, std::size_t nameSize,
+                                     const char* value, std::size_t valueSize) = 0;
+        };
+
+    public:
+        HpackDecoder();
+
+        //! @brief Sets the table size the peer is allowed to use.
+        void setMaxTableSize(std::size_t n)
+        { _maxTableSize = n; }
+
+        /** @brief Decodes a complete header block.
+
+            Returns false, if the block is not valid. In this case the
+            state of the decoder is undefined and the connection must be
+            closed with a compression error.
+        */
+        bool decode(const char* data, std::size_t n, Event& ev);
+
+    private:
+        bool decodeString(const char*& p, const char* e, std::string& buffer,
+                          const char*& s, std::size_t& n);
+
+        bool field(std::size_t index, const char*& name, std::size_t& nameSize,
+                   const char*& value, std::size_t& valueSize) const;
+
+    private:
+        HpackTable _table;
+        std::size_t _maxTableSize;
+        std::string _name;
+        std::string _value;
+};
+
+/** @internal @brief Encodes HPACK header blocks.
+
+    Fields are encoded as indexed fields, if they are found in the static
+    or dynamic table. Otherwise they are added to the dynamic table, unless
+    their value is not expected to repeat. Strings are Huffman coded, if
+    this makes them shorter.
+*/
+class HpackEncoder
+{
+    public:
+        HpackEncoder();
+
+        //! @brief Limits the table size to the size the peer allows.
+        void setMaxTableSize(std::size_t n);
+
+        //! @brief Begins a header block and signals table size changes.
+        void beginBlock(std::string& out);
+
+        //! @brief Encodes a field, the name must be lower case.
+        void encode(std::string& out, const char* name, std::size_t nameSize,
+                    const char* value, std::size_t valueSize);
+
+        void encode(std::string& out, const char* name, const std::string& value)
+        { encode(out, name, std::char_traits<char>::length(name), value.data(), value.size()); }
+
+    private:
+        std::size_t find(const char* name, std::size_t nameSize,
+                         const char* value, std::size_t valueSize, bool& exact) const;
+
+    private:
+        HpackTable _table;
+        std::size_t _pendingSize;
+        bool _sizeUpdate;
+};
+
+/** @internal @brief Huffman code of the HPACK string literals.
+*/
+class HpackHuffman
+{
+    public:
+        //! @brief Returns the size of the encoded string in bytes.
+        static std::size_t encodedSize(const char* s, std::size_t n);
+
+        static void encode(std::string& out, const char* s, std::size_t n);
+
+        //! @brief Appends the decoded string or returns false, if invalid.
+        static bool decode(std::string& out, const char* s, std::size_t n);
+};
+
+} // namespace Http
+
+} // namespace Pt
+
+#endif // Pt_Http_Hpack_h
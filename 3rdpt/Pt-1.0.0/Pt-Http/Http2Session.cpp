@@ -0,0 +1,2486 @@
+/*
+ * Copyright (C) 2005-2013 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "Http2Session.h"
+#include "Connection.h"
+
+#include <Pt/Http/Request.h>
+#include <Pt/Http/Reply.h>
+#include <Pt/Http/HttpError.h>
+#include <Pt/System/FileDevice.h>
+#include <Pt/System/IOError.h>
+#include <Pt/System/Logger.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cassert>
+
+log_define("Pt.Http.Http2Session")
+
+namespace Pt {
+
+namespace Http {
+
+namespace {
+
+const char Preface[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+enum FrameType
+{
+    DataFrame = 0x0,
+    HeadersFrame = 0x1,
+    PriorityFrame = 0x2,
+    ResetStreamFrame = 0x3,
+    SettingsFrame = 0x4,
+    PushPromiseFrame = 0x5,
+    PingFrame = 0x6,
+    GoAwayFrame = 0x7,
+    WindowUpdateFrame = 0x8,
+    ContinuationFrame = 0x9
+};
+
+enum FrameFlag
+{
+    EndStreamFlag = 0x1,
+    AckFlag = 0x1,
+    EndHeadersFlag = 0x4,
+    PaddedFlag = 0x8,
+    PriorityFlag = 0x20
+};
+
+enum ErrorCode
+{
+    NoError = 0x0,
+    ProtocolError = 0x1,
+    InternalError = 0x2,
+    FlowControlError = 0x3,
+    StreamClosed = 0x5,
+    FrameSizeError = 0x6,
+    RefusedStream = 0x7,
+    CompressionError = 0x9,
+    EnhanceYourCalm = 0xb
+};
+
+enum Setting
+{
+    HeaderTableSizeSetting = 0x1,
+    EnablePushSetting = 0x2,
+    MaxConcurrentStreamsSetting = 0x3,
+    InitialWindowSizeSetting = 0x4,
+    MaxFrameSizeSetting = 0x5,
+    MaxHeaderListSizeSetting = 0x6
+};
+
+const Pt::int64_t MaxWindowSize = 0x7fffffff;
+
+// receive window of the connection, streams have the default size
+const Pt::uint32_t ConnectionWindowSize = 1048576;
+
+// received data is acknowledged in steps of this size
+const std::size_t WindowUpdateSize = 32768;
+
+// DATA frames are scheduled until this much output is buffered and
+// a reply chunk is complete, when less than this is left to frame
+const std::size_t MaxOutputSize = 65536;
+
+inline Pt::uint32_t readUInt32(const char* p)
+{
+    const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+    return (Pt::uint32_t(u[0]) << 24) | (Pt::uint32_t(u[1]) << 16) |
+           (Pt::uint32_t(u[2]) << 8) | Pt::uint32_t(u[3]);
+}
+
+
+inline void appendUInt32(std::string& out, Pt::uint32_t v)
+{
+    out += static_cast<char>(v >> 24);
+    out += static_cast<char>(v >> 16);
+    out += static_cast<char>(v >> 8);
+    out += static_cast<char>(v);
+}
+
+
+inline bool isEqual(const char* s, std::size_t n, const char* cs)
+{
+    return std::strlen(cs) == n && std::memcmp(s, cs, n) == 0;
+}
+
+
+// fields, which are only meaningful for HTTP/1 connections
+bool isConnectionField(const char* name, std::size_t n)
+{
+    return isEqual(name, n, "connection") ||
+           isEqual(name, n, "keep-alive") ||
+           isEqual(name, n, "proxy-connection") ||
+           isEqual(name, n, "transfer-encoding") ||
+           isEqual(name, n, "upgrade");
+}
+
+
+inline bool isHexDigit(char ch)
+{
+    return (ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'f') || (ch >= 'A' && ch <= 'F');
+}
+
+
+inline unsigned valueOfHexDigit(char ch)
+{
+    if(ch >= 'a')
+        return ch - 'a' + 10;
+
+    if(ch >= 'A')
+        return ch - 'A' + 10;
+
+    return ch - '0';
+}
+
+
+// decodes the path like the HTTP/1 parser
+bool decodeUrl(std::string& url, const char* s, std::size_t n)
+{
+    url.clear();
+    url.reserve(n);
+
+    for(std::size_t i = 0; i < n; ++i)
+    {
+        if(s[i] == '+')
+        {
+            url += ' ';
+        }
+        else if(s[i] == '%')
+        {
+            if(i + 2 >= n)
+                return false;
+
+            if( ! isHexDigit(s[i + 1]) || ! isHexDigit(s[i + 2]) )
+                return false;
+
+            url += static_cast<char>( (valueOfHexDigit(s[i + 1]) << 4) | valueOfHexDigit(s[i + 2]) );
+            i += 2;
+        }
+        else
+        {
+            url += s[i];
+        }
+    }
+
+    return true;
+}
+
+
+class HeaderCollector : public HpackDecoder::Event
+{
+    public:
+        HeaderCollector(Http2Stream* stream, bool trailer, std::size_t maxSize)
+        : _stream(stream)
+        , _trailer(trailer)
+        , _regular(false)
+        , _malformed(false)
+        , _size(0)
+        , _maxSize(maxSize)
+        { }
+
+        bool isMalformed() const
+        { return _malformed; }
+
+        bool isTooLarge() const
+        { return _size > _maxSize; }
+
+        bool isComplete() const
+        {
+            if( ! _stream || _stream->_method.empty() || _stream->_method == "CONNECT" )
+                return false;
+
+            return ! _stream->_path.empty() && ! _scheme.empty();
+        }
+
+        virtual void onField(const char* name, std::size_t nameSize,
+                             const char* value, std::size_t valueSize);
+
+    private:
+        Http2Stream* _stream;
+        bool _trailer;
+        bool _regular;
+        bool _malformed;
+        std::string _scheme;
+        std::size_t _size;
+        std::size_t _maxSize;
+};
+
+
+void HeaderCollector::onField(const char* name, std::size_t nameSize,
+                              const char* value, std::size_t valueSize)
+{
+    // counted like the raw header of a HTTP/1 message
+    _size += nameSize + valueSize + 3;
+
+    if( ! _stream || _malformed || isTooLarge() )
+        return;
+
+    for(std::size_t n = 0; n < nameSize; ++n)
+    {
+        const char ch = name[n];
+        if( (ch >= 'A' && ch <= 'Z') || ch == '\0' || ch == '\r' || ch == '\n' || (ch == ':' && n > 0) )
+        {
+            _malformed = true;
+            return;
+        }
+    }
+
+    for(std::size_t n = 0; n < valueSize; ++n)
+    {
+        const char ch = value[n];
+        if(ch == '\0' || ch == '\r' || ch == '\n')
+        {
+            _malformed = true;
+            return;
+        }
+    }
+
+    if(nameSize > 0 && name[0] == ':')
+    {
+        // pseudo-header fields must precede the regular fields
+        std::string* field = 0;
+
+        if(_trailer || _regular)
+            field = 0;
+        else if( isEqual(name, nameSize, ":method") )
+            field = &_stream->_method;
+        else if( isEqual(name, nameSize, ":path") )
+            field = &_stream->_path;
+        else if( isEqual(name, nameSize, ":authority") )
+            field = &_stream->_authority;
+        else if( isEqual(name, nameSize, ":scheme") )
+            field = &_scheme;
+
+        if( ! field || ! field->empty() || valueSize == 0 )
+        {
+            _malformed = true;
+            return;
+        }
+
+        field->assign(value, valueSize);
+        return;
+    }
+
+    _regular = true;
+
+    if( nameSize == 0 || isConnectionField(name, nameSize) ||
+        (isEqual(name, nameSize, "te") && ! isEqual(value, valueSize, "trailers")) )
+    {
+        _malformed = true;
+        return;
+    }
+
+    // trailer fields are not passed to the request
+    if(_trailer)
+        return;
+
+    _stream->_fields.append(name, nameSize);
+    _stream->_fields += '\0';
+    _stream->_fields.append(value, valueSize);
+    _stream->_fields += '\0';
+}
+
+}
+
+
+Http2Body::Http2Body()
+: _received(0)
+, _consumed(0)
+{
+    setg(0, 0, 0);
+}
+
+
+void Http2Body::clear()
+{
+    _data.clear();
+    _received = 0;
+    _consumed = 0;
+    setg(0, 0, 0);
+}
+
+
+void Http2Body::append(const char* data, std::size_t n)
+{
+    if(n == 0)
+        return;
+
+    // consumed data is removed, before the buffer grows
+    const std::size_t avail = gptr() ? egptr() - gptr() : 0;
+    if(avail > 0 && gptr() != eback())
+        std::memmove(&_data[0], gptr(), avail);
+
+    _data.resize(avail + n);
+    std::memcpy(&_data[avail], data, n);
+    _received += n;
+
+    char* p = &_data[0];
+    setg(p, p, p + avail + n);
+}
+
+
+std::size_t Http2Body::consume()
+{
+    const std::size_t avail = gptr() ? egptr() - gptr() : 0;
+    const Pt::uint64_t consumed = _received - avail;
+
+    std::size_t n = static_cast<std::size_t>(consumed - _consumed);
+    _consumed = consumed;
+    return n;
+}
+
+
+Http2Body::int_type Http2Body::underflow()
+{
+    if( gptr() < egptr() )
+        return traits_type::to_int_type( *gptr() );
+
+    return traits_type::eof();
+}
+
+
+Http2Stream::Http2Stream()
+{
+    clear();
+}
+
+
+void Http2Stream::clear()
+{
+    _id = 0;
+    _state = Idle;
+    _parent = 0;
+    _weight = 16;
+    _vtime = 0;
+    _active = false;
+    _request = 0;
+    _reply = 0;
+    _queued = false;
+    _method.clear();
+    _path.clear();
+    _authority.clear();
+    _fields.clear();
+    _body.clear();
+    _bodyReported = 0;
+    _recvWindow = 0;
+    _recvUnacked = 0;
+    _headerReceived = false;
+    _headerReported = false;
+    _endStream = false;
+    _endReported = false;
+    _output.clear();
+    _outputPos = 0;
+    _file = 0;
+    _fileOffset = 0;
+    _fileRemaining = 0;
+    _sendWindow = 0;
+    _headersSent = false;
+    _finished = false;
+    _endSent = false;
+    _replyPending = false;
+    _reset = false;
+}
+
+
+const Pt::uint32_t Http2Session::DefaultWindowSize;
+
+const Pt::uint32_t Http2Session::DefaultFrameSize;
+
+const std::size_t Http2Session::PrefaceSize;
+
+
+Http2Session::Http2Session(Connection& conn, std::size_t maxStreams, std::size_t maxHeaderSize)
+: _conn(conn)
+, _maxStreams(maxStreams)
+, _maxHeaderSize(maxHeaderSize)
+, _inputState(ReadPreface)
+, _headerSize(0)
+, _frameLength(0)
+, _frameType(0)
+, _frameFlags(0)
+, _frameStream(0)
+, _remaining(0)
+, _padding(0)
+, _dataStream(0)
+, _headerStream(0)
+, _headerError(0)
+, _continuation(0)
+, _headerTrailer(false)
+, _headerEndStream(false)
+, _peerFrameSize(DefaultFrameSize)
+, _peerWindowSize(DefaultWindowSize)
+, _sendWindow(DefaultWindowSize)
+, _recvWindow(DefaultWindowSize)
+, _recvUnacked(0)
+, _lastStream(0)
+, _openStreams(0)
+, _idleStreams(0)
+, _vtime(0)
+, _readyPending(false)
+, _goingAway(false)
+, _closing(false)
+, _closed(false)
+{
+}
+
+
+Http2Session::~Http2Session()
+{
+    // closed streams are only referenced by their exchange
+    for(std::vector<Binding>::iterator it = _bindings.begin(); it != _bindings.end(); ++it)
+    {
+        if(it->stream && it->stream->_state == Http2Stream::Closed)
+            delete it->stream;
+    }
+
+    for(StreamMap::iterator it = _streams.begin(); it != _streams.end(); ++it)
+        delete it->second;
+
+    for(std::size_t n = 0; n < _freeStreams.size(); ++n)
+        delete _freeStreams[n];
+}
+
+
+std::size_t Http2Session::matchPreface(const char* data, std::size_t n)
+{
+    std::size_t matched = 0;
+    while(matched < n && matched < PrefaceSize && data[matched] == Preface[matched])
+        ++matched;
+
+    return matched;
+}
+
+
+void Http2Session::attach(Request& request, Reply& reply)
+{
+    Binding b;
+    b.request = &request;
+    b.reply = &reply;
+    b.stream = 0;
+    b.waiting = false;
+    _bindings.push_back(b);
+}
+
+
+void Http2Session::start()
+{
+    log_debug("starting HTTP/2 session");
+
+    _inputState = ReadPreface;
+    _headerSize = 0;
+
+    // the server preface is sent without waiting for the client preface
+    writeSettings();
+    writeWindowUpdate(0, ConnectionWindowSize - DefaultWindowSize);
+    _recvWindow = ConnectionWindowSize;
+
+    // input, which was read with the preface, is parsed in the next cycle
+    setReady();
+}
+
+
+Http2Session::Binding* Http2Session::findBinding(const Request& request)
+{
+    for(std::vector<Binding>::iterator it = _bindings.begin(); it != _bindings.end(); ++it)
+    {
+        if(it->request == &request)
+            return &*it;
+    }
+
+    return 0;
+}
+
+
+Http2Session::Binding* Http2Session::findBinding(const Reply& reply)
+{
+    for(std::vector<Binding>::iterator it = _bindings.begin(); it != _bindings.end(); ++it)
+    {
+        if(it->reply == &reply)
+            return &*it;
+    }
+
+    return 0;
+}
+
+
+void Http2Session::bind(Binding& b, Http2Stream* s)
+{
+    log_debug("bind stream " << s->_id);
+
+    b.stream = s;
+    b.waiting = false;
+    s->_request = b.request;
+    s->_reply = b.reply;
+}
+
+
+void Http2Session::unbind(Binding& b)
+{
+    Http2Stream* s = b.stream;
+    log_debug("unbind stream " << s->_id);
+
+    b.stream = 0;
+    b.waiting = false;
+    s->_request = 0;
+    s->_reply = 0;
+
+    if(s->_queued)
+    {
+        _ready.erase( std::find(_ready.begin(), _ready.end(), s) );
+        s->_queued = false;
+    }
+
+    if(s->_state == Http2Stream::Closed)
+    {
+        releaseStream(s);
+        return;
+    }
+
+    // a stream, which has sent its reply, does not need the rest of the
+    // request, otherwise it is closed after the reply is sent
+    if(s->_endSent)
+        resetStream(s, NoError);
+}
+
+
+void Http2Session::resetStream(Request& request)
+{
+    Binding* b = findBinding(request);
+    if( ! b || ! b->stream )
+        return;
+
+    Http2Stream* s = b->stream;
+    if(s->_state != Http2Stream::Closed)
+        resetStream(s, InternalError);
+
+    unbind(*b);
+    update();
+}
+
+
+void Http2Session::beginReceiveRequest(Request& request)
+{
+    log_trace("Http2Session::beginReceiveRequest");
+
+    Binding* b = findBinding(request);
+    if( ! b )
+        throw std::logic_error("request not attached to connection");
+
+    Http2Stream* s = b->stream;
+
+    // the exchange begins a new request, when the reply was sent
+    if( s && (s->_reset || (s->_finished && ! s->_replyPending)) )
+    {
+        unbind(*b);
+        s = 0;
+    }
+
+    if( ! s )
+    {
+        if( _pending.empty() )
+        {
+            b->waiting = true;
+            update();
+            return;
+        }
+
+        s = _pending.front();
+        _pending.pop_front();
+        bind(*b, s);
+    }
+
+    request.setBuffer(s->_body);
+
+    // acknowledge the data consumed by the responder
+    replenish(s);
+    notify(s);
+    update();
+}
+
+
+MessageProgress Http2Session::endReceiveRequest(Request& request)
+{
+    log_trace("Http2Session::endReceiveRequest");
+
+    MessageProgress progress;
+
+    Binding* b = findBinding(request);
+    Http2Stream* s = b ? b->stream : 0;
+    if( ! s )
+        return progress;
+
+    if(s->_reset)
+        throw System::IOError("stream reset");
+
+    if( s->_headerReceived && ! s->_headerReported )
+    {
+        s->_headerReported = true;
+        applyHeader(s, request);
+        progress.setHeader();
+    }
+
+    request.setBuffer(s->_body);
+
+    if( ! s->_headerReported )
+        return progress;
+
+    if(s->_body.received() > s->_bodyReported)
+    {
+        s->_bodyReported = s->_body.received();
+        progress.setBody();
+    }
+
+    if( s->_endStream && ! s->_endReported )
+    {
+        log_debug("request on stream " << s->_id << " finished");
+        s->_endReported = true;
+        progress.setFinished();
+    }
+
+    return progress;
+}
+
+
+void Http2Session::applyHeader(Http2Stream* s, Request& request)
+{
+    std::string::size_type q = s->_path.find('?');
+    std::size_t pathSize = q != std::string::npos ? q : s->_path.size();
+
+    std::string url;
+    if( ! decodeUrl(url, s->_path.data(), pathSize) )
+        throw HttpError("invalid HTTP message");
+
+    request.setMethod(s->_method);
+    request.setUrl(url);
+
+    if(q != std::string::npos)
+        request.setQParams(s->_path.data() + q + 1, s->_path.size() - q - 1);
+    else
+        request.setQParams("", 0);
+
+    MessageHeader& header = request.header();
+    header.setMaxSize(_maxHeaderSize);
+    header.setVersion(2, 0);
+
+    if( ! s->_authority.empty() )
+        header.add("Host", 4, s->_authority.data(), s->_authority.size());
+
+    // cookies may be split into several fields (RFC 7540, 8.1.2.5)
+    std::string cookie;
+
+    const char* p = s->_fields.data();
+    const char* end = p + s->_fields.size();
+    while(p < end)
+    {
+        const char* name = p;
+        std::size_t nameSize = std::strlen(name);
+        const char* value = name + nameSize + 1;
+        std::size_t valueSize = std::strlen(value);
+        p = value + valueSize + 1;
+
+        if( isEqual(name, nameSize, "cookie") )
+        {
+            if( ! cookie.empty() )
+                cookie += "; ";
+
+            cookie.append(value, valueSize);
+            continue;
+        }
+
+        if( ! s->_authority.empty() && isEqual(name, nameSize, "host") )
+            continue;
+
+        header.add(name, nameSize, value, valueSize);
+    }
+
+    if( ! cookie.empty() )
+        header.add("cookie", 6, cookie.data(), cookie.size());
+
+    std::string().swap(s->_fields);
+}
+
+
+void Http2Session::beginSendReply(Reply& reply)
+{
+    log_trace("Http2Session::beginSendReply");
+
+    Binding* b = findBinding(reply);
+    Http2Stream* s = b ? b->stream : 0;
+    if( ! s )
+        throw std::logic_error("reply not bound to a stream");
+
+    // the exchange is notified, when the reply was framed or the
+    // stream was reset and continues with endSendReply()
+    if( s->_reset || s->_replyPending )
+    {
+        notify(s);
+        update();
+        return;
+    }
+
+    if( reply.file() && ! reply.isFinished() )
+        throw std::logic_error("file body requires a finished reply");
+
+    if( ! s->_headersSent )
+        writeHeaders(s, reply);
+
+    MessageBuffer& mbuf = reply.buffer();
+    if(mbuf.size() > 0 && ! s->_endSent)
+    {
+        if(s->_outputPos > 0)
+        {
+            s->_output.erase(0, s->_outputPos);
+            s->_outputPos = 0;
+        }
+
+        s->_output.append(mbuf.data(), mbuf.size());
+    }
+
+    if( reply.file() && ! s->_endSent )
+    {
+        s->_file = reply.file();
+        s->_fileOffset = reply.fileOffset();
+        s->_fileRemaining = reply.fileSize();
+    }
+
+    if( reply.isFinished() )
+        s->_finished = true;
+
+    s->_replyPending = true;
+
+    activate(s);
+    update();
+    notify(s);
+}
+
+
+MessageProgress Http2Session::endSendReply(Reply& reply)
+{
+    log_trace("Http2Session::endSendReply");
+
+    MessageProgress progress;
+
+    Binding* b = findBinding(reply);
+    Http2Stream* s = b ? b->stream : 0;
+
+    if( ! s || s->_reset )
+        throw System::IOError("stream reset");
+
+    if( ! isReplySent(s) )
+        return progress;
+
+    s->_replyPending = false;
+    progress.setFinished();
+    return progress;
+}
+
+
+std::streambuf& Http2Session::input()
+{
+    if(_conn._ssl)
+        return _conn._sslbuf;
+
+    return _conn._sockbuf;
+}
+
+
+std::streambuf& Http2Session::output()
+{
+    if(_conn._ssl)
+        return _conn._sslbuf;
+
+    return _conn._sockbuf;
+}
+
+
+void Http2Session::readInput()
+{
+    BasicStreamBuffer<char>& in = _conn._ssl ? static_cast<BasicStreamBuffer<char>&>(_conn._sslbuf)
+                                             : static_cast<BasicStreamBuffer<char>&>(_conn._sockbuf);
+
+    // all available input is consumed, incomplete frames are
+    // continued when more data is read
+    while( ! _closing )
+    {
+        std::size_t n = 0;
+        const char* data = in.sview(n);
+
+        // the socket buffer keeps its input in slabs, the get area
+        // moves on to the next slab when the current one is consumed
+        if(n == 0 && in.in_avail() > 0)
+        {
+            in.sgetc();
+            data = in.sview(n);
+        }
+
+        if(n == 0)
+        {
+            if( ! _conn._ssl )
+                break;
+
+            _conn._sslbuf.import();
+
+            data = in.sview(n);
+            if(n == 0)
+                break;
+        }
+
+        parse(data, n);
+        in.sskip(n);
+    }
+}
+
+
+void Http2Session::parse(const char* data, std::size_t n)
+{
+    const char* p = data;
+    const char* end = data + n;
+
+    while(p < end && ! _closing)
+    {
+        std::size_t avail = static_cast<std::size_t>(end - p);
+
+        switch(_inputState)
+        {
+            case ReadPreface:
+            {
+                std::size_t k = std::min(avail, PrefaceSize - _headerSize);
+                if( std::memcmp(p, Preface + _headerSize, k) != 0 )
+                {
+                    log_warn("invalid HTTP/2 preface");
+                    connectionError(ProtocolError);
+                    return;
+                }
+
+                p += k;
+                _headerSize += k;
+
+                if(_headerSize == PrefaceSize)
+                {
+                    _headerSize = 0;
+                    _inputState = ReadHeader;
+                }
+
+                break;
+            }
+
+            case ReadHeader:
+            {
+                std::size_t k = std::min(avail, sizeof(_header) - _headerSize);
+                std::memcpy(_header + _headerSize, p, k);
+                p += k;
+                _headerSize += k;
+
+                if(_headerSize == sizeof(_header))
+                {
+                    _headerSize = 0;
+                    beginFrame();
+                }
+
+                break;
+            }
+
+            case ReadPayload:
+            {
+                std::size_t k = std::min(avail, _remaining);
+                _payload.append(p, k);
+                p += k;
+                _remaining -= k;
+
+                if(_remaining == 0)
+                {
+                    _inputState = ReadHeader;
+                    endFrame();
+                }
+
+                break;
+            }
+
+            case ReadPadLength:
+            {
+                _padding = static_cast<unsigned char>(*p++);
+                --_remaining;
+
+                if(_padding > _remaining)
+                {
+                    connectionError(ProtocolError);
+                    return;
+                }
+
+                _remaining -= _padding;
+                _inputState = ReadData;
+
+                // the padding is not passed to the stream
+                Http2Stream* s = findStream(_dataStream);
+                if(s)
+                    s->_recvUnacked += _padding + 1;
+
+                break;
+            }
+
+            case ReadData:
+            {
+                std::size_t k = std::min(avail, _remaining);
+                onData(p, k);
+                p += k;
+                _remaining -= k;
+                break;
+            }
+
+            case SkipPayload:
+            {
+                std::size_t k = std::min(avail, _remaining);
+                p += k;
+                _remaining -= k;
+
+                if(_remaining == 0)
+                    _inputState = ReadHeader;
+
+                break;
+            }
+        }
+
+        if(_inputState == ReadData && _remaining == 0)
+        {
+            if(_padding > 0)
+            {
+                _remaining = _padding;
+                _padding = 0;
+                _inputState = SkipPayload;
+            }
+            else
+            {
+                _inputState = ReadHeader;
+            }
+
+            endData();
+        }
+    }
+}
+
+
+void Http2Session::beginFrame()
+{
+    const unsigned char* h = _header;
+    _frameLength = (std::size_t(h[0]) << 16) | (std::size_t(h[1]) << 8) | std::size_t(h[2]);
+    _frameType = h[3];
+    _frameFlags = h[4];
+    _frameStream = readUInt32(reinterpret_cast<const char*>(h) + 5) & 0x7fffffff;
+
+    log_debug("frame type " << _frameType << ", length " << _frameLength << ", stream " << _frameStream);
+
+    if(_frameLength > DefaultFrameSize)
+    {
+        connectionError(FrameSizeError);
+        return;
+    }
+
+    // a header block must not be interleaved with other frames
+    if( _continuation && (_frameType != ContinuationFrame || _frameStream != _continuation) )
+    {
+        connectionError(ProtocolError);
+        return;
+    }
+
+    if(_frameType == DataFrame)
+    {
+        beginData();
+        return;
+    }
+
+    _payload.clear();
+    _remaining = _frameLength;
+    _inputState = ReadPayload;
+
+    if(_remaining == 0)
+    {
+        _inputState = ReadHeader;
+        endFrame();
+    }
+}
+
+
+void Http2Session::beginData()
+{
+    _remaining = _frameLength;
+    _padding = 0;
+    _dataStream = 0;
+    _inputState = (_frameFlags & PaddedFlag) ? ReadPadLength : ReadData;
+
+    if( _frameStream == 0 || ((_frameFlags & PaddedFlag) && _frameLength == 0) )
+    {
+        connectionError(ProtocolError);
+        return;
+    }
+
+    // the whole frame counts against the flow control windows
+    _recvWindow -= _frameLength;
+    if(_recvWindow < 0)
+    {
+        connectionError(FlowControlError);
+        return;
+    }
+
+    // the connection window is replenished on receipt, because the
+    // stream windows limit the amount of buffered data
+    _recvUnacked += _frameLength;
+    if(_recvUnacked >= WindowUpdateSize)
+    {
+        writeWindowUpdate(0, static_cast<Pt::uint32_t>(_recvUnacked));
+        _recvWindow += _recvUnacked;
+        _recvUnacked = 0;
+    }
+
+    Http2Stream* s = findStream(_frameStream);
+    if( ! s || s->_state == Http2Stream::Idle )
+    {
+        // data of closed streams is discarded
+        if(_frameStream > _lastStream || s)
+            connectionError(ProtocolError);
+
+        return;
+    }
+
+    if(s->_state != Http2Stream::Open)
+    {
+        resetStream(s, StreamClosed);
+        return;
+    }
+
+    s->_recvWindow -= _frameLength;
+    if(s->_recvWindow < 0)
+    {
+        resetStream(s, FlowControlError);
+        return;
+    }
+
+    _dataStream = s->_id;
+}
+
+
+void Http2Session::onData(const char* data, std::size_t n)
+{
+    Http2Stream* s = findStream(_dataStream);
+    if(s)
+        s->_body.append(data, n);
+}
+
+
+void Http2Session::endData()
+{
+    Http2Stream* s = findStream(_dataStream);
+    _dataStream = 0;
+
+    if( ! s )
+        return;
+
+    if(_frameFlags & EndStreamFlag)
+        onEndStream(s);
+
+    notify(s);
+}
+
+
+void Http2Session::endFrame()
+{
+    switch(_frameType)
+    {
+        case HeadersFrame:
+            onHeaders();
+            break;
+
+        case PriorityFrame:
+            onPriority();
+            break;
+
+        case ResetStreamFrame:
+            onResetStream();
+            break;
+
+        case SettingsFrame:
+            onSettings();
+            break;
+
+        case PushPromiseFrame:
+            // clients must not push streams
+            connectionError(ProtocolError);
+            break;
+
+        case PingFrame:
+            onPing();
+            break;
+
+        case GoAwayFrame:
+            onGoAway();
+            break;
+
+        case WindowUpdateFrame:
+            onWindowUpdate();
+            break;
+
+        case ContinuationFrame:
+            onContinuation();
+            break;
+
+        default:
+            // unknown frame types are ignored
+            break;
+    }
+}
+
+
+void Http2Session::onHeaders()
+{
+    const Pt::uint32_t id = _frameStream;
+
+    if( id == 0 || (id & 1) == 0 )
+    {
+        connectionError(ProtocolError);
+        return;
+    }
+
+    const char* p = _payload.data();
+    std::size_t n = _payload.size();
+    std::size_t padding = 0;
+
+    if(_frameFlags & PaddedFlag)
+    {
+        if(n < 1)
+        {
+            connectionError(FrameSizeError);
+            return;
+        }
+
+        padding = static_cast<unsigned char>(*p);
+        ++p;
+        --n;
+    }
+
+    Pt::uint32_t dependency = 0;
+    unsigned weight = 16;
+    bool exclusive = false;
+
+    if(_frameFlags & PriorityFlag)
+    {
+        if(n < 5)
+        {
+            connectionError(FrameSizeError);
+            return;
+        }
+
+        Pt::uint32_t v = readUInt32(p);
+        exclusive = (v & 0x80000000) != 0;
+        dependency = v & 0x7fffffff;
+        weight = static_cast<unsigned char>(p[4]) + 1;
+        p += 5;
+        n -= 5;
+    }
+
+    if(padding > n)
+    {
+        connectionError(ProtocolError);
+        return;
+    }
+
+    n -= padding;
+
+    _headerStream = id;
+    _headerError = NoError;
+    _headerTrailer = false;
+    _headerEndStream = (_frameFlags & EndStreamFlag) != 0;
+
+    Http2Stream* s = findStream(id);
+
+    if( s && s->_state != Http2Stream::Idle )
+    {
+        // trailer of a request, the block is decoded to keep the
+        // HPACK state in sync, even if the stream is already closed
+        _headerTrailer = true;
+
+        if(s->_state != Http2Stream::Open)
+            _headerError = StreamClosed;
+    }
+    else if(id <= _lastStream)
+    {
+        connectionError(ProtocolError);
+        return;
+    }
+    else
+    {
+        _lastStream = id;
+
+        if( _goingAway || _openStreams >= _maxStreams )
+        {
+            log_debug("refusing stream " << id);
+            _headerError = RefusedStream;
+        }
+        else
+        {
+            if( ! s )
+                s = createStream(id);
+
+            --_idleStreams;
+            ++_openStreams;
+            s->_state = Http2Stream::Open;
+
+            if(_frameFlags & PriorityFlag)
+            {
+                if(dependency == id)
+                    _headerError = ProtocolError;
+                else
+                    prioritize(s, dependency, weight, exclusive);
+            }
+        }
+    }
+
+    _headerBlock.assign(p, n);
+
+    if(_frameFlags & EndHeadersFlag)
+        endHeaders();
+    else
+        _continuation = id;
+}
+
+
+void Http2Session::onContinuation()
+{
+    if(_continuation == 0)
+    {
+        connectionError(ProtocolError);
+        return;
+    }
+
+    // the whole block must be buffered before it can be decoded
+    if(_headerBlock.size() + _payload.size() > 2 * _maxHeaderSize + DefaultFrameSize)
+    {
+        connectionError(EnhanceYourCalm);
+        return;
+    }
+
+    _headerBlock += _payload;
+
+    if(_frameFlags & EndHeadersFlag)
+    {
+        _continuation = 0;
+        endHeaders();
+    }
+}
+
+
+void Http2Session::endHeaders()
+{
+    Http2Stream* s = _headerError ? 0 : findStream(_headerStream);
+
+    HeaderCollector fields(s, _headerTrailer, _maxHeaderSize);
+    if( ! _decoder.decode(_headerBlock.data(), _headerBlock.size(), fields) )
+    {
+        log_warn("invalid HPACK header block");
+        connectionError(CompressionError);
+        return;
+    }
+
+    _headerBlock.clear();
+
+    if(_headerError)
+    {
+        s = findStream(_headerStream);
+        if(s)
+            resetStream(s, _headerError);
+        else
+            writeResetStream(_headerStream, _headerError);
+
+        return;
+    }
+
+    if( ! s )
+        return;
+
+    if( fields.isTooLarge() )
+    {
+        log_warn("header of stream " << s->_id << " too large");
+        resetStream(s, EnhanceYourCalm);
+        return;
+    }
+
+    if( fields.isMalformed() || (_headerTrailer && ! _headerEndStream) ||
+        ( ! _headerTrailer && ! fields.isComplete()) )
+    {
+        log_warn("malformed header on stream " << s->_id);
+        resetStream(s, ProtocolError);
+        return;
+    }
+
+    if( ! _headerTrailer )
+    {
+        s->_headerReceived = true;
+        _pending.push_back(s);
+    }
+
+    if(_headerEndStream)
+        onEndStream(s);
+
+    notify(s);
+}
+
+
+void Http2Session::onPriority()
+{
+    const Pt::uint32_t id = _frameStream;
+
+    if(id == 0)
+    {
+        connectionError(ProtocolError);
+        return;
+    }
+
+    if(_payload.size() != 5)
+    {
+        writeResetStream(id, FrameSizeError);
+        return;
+    }
+
+    Pt::uint32_t v = readUInt32(_payload.data());
+    bool exclusive = (v & 0x80000000) != 0;
+    Pt::uint32_t dependency = v & 0x7fffffff;
+    unsigned weight = static_cast<unsigned char>(_payload[4]) + 1;
+
+    Http2Stream* s = findStream(id);
+    if( ! s )
+    {
+        // closed streams are removed from the tree and the number of
+        // idle streams, which only serve as a parent, is limited
+        if(id <= _lastStream || _idleStreams >= _maxStreams)
+            return;
+
+        s = createStream(id);
+    }
+
+    if(dependency == id)
+    {
+        if(s->_state == Http2Stream::Idle)
+            writeResetStream(id, ProtocolError);
+        else
+            resetStream(s, ProtocolError);
+
+        return;
+    }
+
+    prioritize(s, dependency, weight, exclusive);
+}
+
+
+void Http2Session::onResetStream()
+{
+    const Pt::uint32_t id = _frameStream;
+
+    if(id == 0)
+    {
+        connectionError(ProtocolError);
+        return;
+    }
+
+    if(_payload.size() != 4)
+    {
+        connectionError(FrameSizeError);
+        return;
+    }
+
+    Http2Stream* s = findStream(id);
+    if( ! s || s->_state == Http2Stream::Idle )
+    {
+        if(id > _lastStream)
+            connectionError(ProtocolError);
+
+        return;
+    }
+
+    log_debug("stream " << id << " reset by peer: " << readUInt32(_payload.data()));
+    s->_reset = true;
+    closeStream(s);
+}
+
+
+void Http2Session::onSettings()
+{
+    if(_frameStream != 0)
+    {
+        connectionError(ProtocolError);
+        return;
+    }
+
+    if(_frameFlags & AckFlag)
+    {
+        if( ! _payload.empty() )
+            connectionError(FrameSizeError);
+
+        return;
+    }
+
+    if(_payload.size() % 6 != 0)
+    {
+        connectionError(FrameSizeError);
+        return;
+    }
+
+    for(std::size_t n = 0; n < _payload.size(); n += 6)
+    {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(_payload.data() + n);
+        unsigned id = (unsigned(p[0]) << 8) | p[1];
+        Pt::uint32_t value = readUInt32(_payload.data() + n + 2);
+
+        switch(id)
+        {
+            case HeaderTableSizeSetting:
+                _encoder.setMaxTableSize(value);
+                break;
+
+            case EnablePushSetting:
+                if(value > 1)
+                {
+                    connectionError(ProtocolError);
+                    return;
+                }
+                break;
+
+            case InitialWindowSizeSetting:
+            {
+                if(value > MaxWindowSize)
+                {
+                    connectionError(FlowControlError);
+                    return;
+                }
+
+                // the change applies to the windows of all open streams
+                Pt::int64_t delta = Pt::int64_t(value) - _peerWindowSize;
+                _peerWindowSize = value;
+
+                for(StreamMap::iterator it = _streams.begin(); it != _streams.end(); ++it)
+                {
+                    Http2Stream* s = it->second;
+                    s->_sendWindow += delta;
+
+                    if(s->_sendWindow > MaxWindowSize)
+                    {
+                        connectionError(FlowControlError);
+                        return;
+                    }
+
+                    activate(s);
+                }
+
+                break;
+            }
+
+            case MaxFrameSizeSetting:
+                if(value < DefaultFrameSize || value > 16777215)
+                {
+                    connectionError(ProtocolError);
+                    return;
+                }
+
+                _peerFrameSize = value;
+                break;
+
+            default:
+                // other settings do not affect the server
+                break;
+        }
+    }
+
+    writeFrameHeader(0, SettingsFrame, AckFlag, 0);
+}
+
+
+void Http2Session::onPing()
+{
+    if(_frameStream != 0)
+    {
+        connectionError(ProtocolError);
+        return;
+    }
+
+    if(_payload.size() != 8)
+    {
+        connectionError(FrameSizeError);
+        return;
+    }
+
+    if(_frameFlags & AckFlag)
+        return;
+
+    writeFrameHeader(8, PingFrame, AckFlag, 0);
+    _out += _payload;
+}
+
+
+void Http2Session::onGoAway()
+{
+    if(_frameStream != 0)
+    {
+        connectionError(ProtocolError);
+        return;
+    }
+
+    if(_payload.size() < 8)
+    {
+        connectionError(FrameSizeError);
+        return;
+    }
+
+    // streams in progress are completed, new streams are refused
+    log_debug("client is going away: " << readUInt32(_payload.data() + 4));
+    _goingAway = true;
+}
+
+
+void Http2Session::onWindowUpdate()
+{
+    const Pt::uint32_t id = _frameStream;
+
+    if(_payload.size() != 4)
+    {
+        connectionError(FrameSizeError);
+        return;
+    }
+
+    Pt::uint32_t increment = readUInt32(_payload.data()) & 0x7fffffff;
+
+    if(id == 0)
+    {
+        _sendWindow += increment;
+
+        if(increment == 0 || _sendWindow > MaxWindowSize)
+            connectionError(increment == 0 ? ProtocolError : FlowControlError);
+
+        return;
+    }
+
+    Http2Stream* s = findStream(id);
+    if( ! s )
+    {
+        if(id > _lastStream)
+            connectionError(ProtocolError);
+
+        return;
+    }
+
+    if(s->_state == Http2Stream::Idle)
+    {
+        connectionError(ProtocolError);
+        return;
+    }
+
+    if(increment == 0)
+    {
+        resetStream(s, ProtocolError);
+        return;
+    }
+
+    s->_sendWindow += increment;
+
+    if(s->_sendWindow > MaxWindowSize)
+    {
+        resetStream(s, FlowControlError);
+        return;
+    }
+
+    activate(s);
+}
+
+
+Http2Stream* Http2Session::findStream(Pt::uint32_t id)
+{
+    if(id == 0)
+        return 0;
+
+    StreamMap::iterator it = _streams.find(id);
+    return it != _streams.end() ? it->second : 0;
+}
+
+
+Http2Stream* Http2Session::createStream(Pt::uint32_t id)
+{
+    Http2Stream* s = 0;
+
+    if( _freeStreams.empty() )
+    {
+        s = new Http2Stream;
+    }
+    else
+    {
+        s = _freeStreams.back();
+        _freeStreams.pop_back();
+    }
+
+    s->_id = id;
+    s->_state = Http2Stream::Idle;
+    s->_vtime = _vtime;
+    s->_recvWindow = DefaultWindowSize;
+    s->_sendWindow = _peerWindowSize;
+
+    _streams[id] = s;
+    ++_idleStreams;
+    return s;
+}
+
+
+void Http2Session::releaseStream(Http2Stream* s)
+{
+    if(s->_queued)
+        _ready.erase( std::find(_ready.begin(), _ready.end(), s) );
+
+    if(_freeStreams.size() >= _maxStreams)
+    {
+        delete s;
+        return;
+    }
+
+    s->clear();
+    _freeStreams.push_back(s);
+}
+
+
+void Http2Session::prioritize(Http2Stream* s, Pt::uint32_t dependency,
+                              unsigned weight, bool exclusive)
+{
+    Http2Stream* parent = findStream(dependency);
+
+    // a dependency on an unknown stream results in the default priority
+    if(dependency && ! parent)
+    {
+        weight = 16;
+        exclusive = false;
+    }
+
+    // a stream, which depends on its own descendant, takes its place
+    for(Http2Stream* p = parent; p; p = p->_parent)
+    {
+        if(p == s)
+        {
+            parent->_parent = s->_parent;
+            break;
+        }
+    }
+
+    if(exclusive)
+    {
+        for(StreamMap::iterator it = _streams.begin(); it != _streams.end(); ++it)
+        {
+            if(it->second != s && it->second->_parent == parent)
+                it->second->_parent = s;
+        }
+    }
+
+    s->_parent = parent;
+    s->_weight = weight;
+}
+
+
+void Http2Session::closeStream(Http2Stream* s)
+{
+    if(s->_state == Http2Stream::Closed)
+        return;
+
+    log_debug("closing stream " << s->_id);
+
+    if(s->_state == Http2Stream::Idle)
+        --_idleStreams;
+    else
+        --_openStreams;
+
+    s->_state = Http2Stream::Closed;
+    _streams.erase(s->_id);
+
+    // the children of a closed stream depend on its parent now
+    for(StreamMap::iterator it = _streams.begin(); it != _streams.end(); ++it)
+    {
+        if(it->second->_parent == s)
+            it->second->_parent = s->_parent;
+    }
+
+    s->_parent = 0;
+
+    if(s->_active)
+    {
+        _active.erase( std::find(_active.begin(), _active.end(), s) );
+        s->_active = false;
+    }
+
+    if( ! s->_request )
+    {
+        std::deque<Http2Stream*>::iterator it = std::find(_pending.begin(), _pending.end(), s);
+        if( it != _pending.end() )
+            _pending.erase(it);
+
+        releaseStream(s);
+        return;
+    }
+
+    notify(s);
+}
+
+
+void Http2Session::resetStream(Http2Stream* s, Pt::uint32_t error)
+{
+    if(s->_state == Http2Stream::Closed)
+        return;
+
+    log_debug("resetting stream " << s->_id << ": " << error);
+
+    writeResetStream(s->_id, error);
+    s->_reset = true;
+    closeStream(s);
+}
+
+
+void Http2Session::onEndStream(Http2Stream* s)
+{
+    s->_endStream = true;
+
+    if(s->_endSent)
+        closeStream(s);
+    else
+        s->_state = Http2Stream::HalfClosedRemote;
+}
+
+
+void Http2Session::onEndSent(Http2Stream* s)
+{
+    s->_endSent = true;
+
+    if(s->_endStream)
+        closeStream(s);
+    else if( ! s->_request )
+        resetStream(s, NoError);
+}
+
+
+void Http2Session::connectionError(Pt::uint32_t error)
+{
+    if(_closing)
+        return;
+
+    log_warn("HTTP/2 connection error: " << error);
+    writeGoAway(error);
+    _closing = true;
+}
+
+
+void Http2Session::replenish(Http2Stream* s)
+{
+    s->_recvUnacked += s->_body.consume();
+
+    // no window is needed, if the request is complete
+    if(s->_state != Http2Stream::Open)
+    {
+        s->_recvUnacked = 0;
+        return;
+    }
+
+    if(s->_recvUnacked >= DefaultWindowSize / 2)
+    {
+        writeWindowUpdate(s->_id, static_cast<Pt::uint32_t>(s->_recvUnacked));
+        s->_recvWindow += s->_recvUnacked;
+        s->_recvUnacked = 0;
+    }
+}
+
+
+void Http2Session::dispatch()
+{
+    while( ! _pending.empty() && ! _closing )
+    {
+        Binding* b = 0;
+        for(std::vector<Binding>::iterator it = _bindings.begin(); it != _bindings.end(); ++it)
+        {
+            if(it->waiting)
+            {
+                b = &*it;
+                break;
+            }
+        }
+
+        if(b)
+        {
+            Http2Stream* s = _pending.front();
+            _pending.pop_front();
+            bind(*b, s);
+            notify(s);
+            continue;
+        }
+
+        // the new exchange begins to receive and takes a pending stream
+        std::size_t count = _bindings.size();
+        if(count >= _maxStreams)
+            break;
+
+        _conn._requestPending.send(_conn);
+
+        if(_bindings.size() == count)
+            break;
+    }
+}
+
+
+void Http2Session::notify(Http2Stream* s)
+{
+    if(s->_queued || ! s->_request)
+        return;
+
+    if( (s->_request->isReceiving() && hasInput(s)) ||
+        (s->_reply->isSending() && isReplySent(s)) )
+    {
+        s->_queued = true;
+        _ready.push_back(s);
+        setReady();
+    }
+}
+
+
+void Http2Session::deliver()
+{
+    while( ! _ready.empty() && ! _closed )
+    {
+        Http2Stream* s = _ready.front();
+        _ready.pop_front();
+        s->_queued = false;
+
+        // the stream may be released by the handlers
+        if( s->_reply->isSending() )
+        {
+            if( isReplySent(s) )
+                s->_reply->onOutput();
+        }
+        else if( s->_request->isReceiving() && hasInput(s) )
+        {
+            s->_request->onInput();
+        }
+    }
+}
+
+
+bool Http2Session::hasInput(const Http2Stream* s) const
+{
+    return s->_reset ||
+           (s->_headerReceived && ! s->_headerReported) ||
+           (s->_headerReported && s->_body.received() > s->_bodyReported) ||
+           (s->_headerReported && s->_endStream && ! s->_endReported);
+}
+
+
+bool Http2Session::isReplySent(const Http2Stream* s) const
+{
+    if(s->_reset)
+        return true;
+
+    if( ! s->_replyPending )
+        return false;
+
+    // a file is read while the stream is sent
+    if(s->_file)
+        return s->_fileRemaining == 0;
+
+    return s->_finished || s->_output.size() - s->_outputPos < MaxOutputSize;
+}
+
+
+void Http2Session::activate(Http2Stream* s)
+{
+    if( s->_active || ! s->_headersSent || s->_endSent || s->_state == Http2Stream::Closed )
+        return;
+
+    // a stream does not gain from being idle
+    if(s->_vtime < _vtime)
+        s->_vtime = _vtime;
+
+    s->_active = true;
+    _active.push_back(s);
+}
+
+
+bool Http2Session::isSendable(const Http2Stream* s) const
+{
+    if( ! s->_active || s->_endSent )
+        return false;
+
+    if(s->pending() == 0)
+        return s->_finished;
+
+    return s->_sendWindow > 0 && _sendWindow > 0;
+}
+
+
+Http2Stream* Http2Session::nextStream()
+{
+    Http2Stream* next = 0;
+
+    for(std::vector<Http2Stream*>::iterator it = _active.begin(); it != _active.end(); ++it)
+    {
+        Http2Stream* s = *it;
+        if( ! isSendable(s) )
+            continue;
+
+        if( next && next->_vtime <= s->_vtime )
+            continue;
+
+        // streams only get resources, when the streams they depend on
+        // can not proceed
+        bool blocked = false;
+        for(Http2Stream* p = s->_parent; p; p = p->_parent)
+        {
+            if( isSendable(p) )
+            {
+                blocked = true;
+                break;
+            }
+        }
+
+        if( ! blocked )
+            next = s;
+    }
+
+    return next;
+}
+
+
+void Http2Session::schedule()
+{
+    while(_out.size() < MaxOutputSize)
+    {
+        Http2Stream* s = nextStream();
+        if( ! s || ! writeData(s) )
+            break;
+    }
+
+    // streams without data are activated again, when the reply continues
+    std::vector<Http2Stream*>::iterator it = _active.begin();
+    while( it != _active.end() )
+    {
+        Http2Stream* s = *it;
+        if( s->_endSent || (s->pending() == 0 && ! s->_finished) )
+        {
+            s->_active = false;
+            it = _active.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+
+bool Http2Session::writeData(Http2Stream* s)
+{
+    const Pt::uint64_t pending = s->pending();
+    std::size_t n = 0;
+
+    if(pending > 0)
+    {
+        Pt::int64_t window = std::min(s->_sendWindow, _sendWindow);
+        if(window <= 0)
+            return false;
+
+        Pt::uint64_t size = std::min<Pt::uint64_t>(pending, static_cast<Pt::uint64_t>(window));
+        n = static_cast<std::size_t>( std::min<Pt::uint64_t>(size, _peerFrameSize) );
+    }
+
+    const bool end = s->_finished && n == pending;
+    const std::size_t fromOutput = std::min(n, s->_output.size() - s->_outputPos);
+    const std::size_t fromFile = n - fromOutput;
+
+    // file data is read first, so a read error does not leave a partial frame
+    if(fromFile > 0)
+    {
+        if(_fileBuffer.size() < fromFile)
+            _fileBuffer.resize(fromFile);
+
+        std::size_t r = 0;
+
+        try
+        {
+            s->_file->seek(static_cast<System::FileDevice::off_type>(s->_fileOffset), std::ios::beg);
+
+            while(r < fromFile)
+            {
+                std::size_t k = s->_file->read(&_fileBuffer[r], fromFile - r);
+                if(k == 0)
+                    break;
+
+                r += k;
+            }
+        }
+        catch(const System::IOError& e)
+        {
+            log_warn("reading file failed: " << e.what());
+            r = 0;
+        }
+
+        if(r < fromFile)
+        {
+            resetStream(s, InternalError);
+            return true;
+        }
+    }
+
+    writeFrameHeader(n, DataFrame, end ? EndStreamFlag : 0, s->_id);
+
+    if(fromOutput > 0)
+    {
+        _out.append(s->_output, s->_outputPos, fromOutput);
+        s->_outputPos += fromOutput;
+
+        if(s->_outputPos == s->_output.size())
+        {
+            s->_output.clear();
+            s->_outputPos = 0;
+        }
+    }
+
+    if(fromFile > 0)
+    {
+        _out.append(&_fileBuffer[0], fromFile);
+        s->_fileOffset += fromFile;
+        s->_fileRemaining -= fromFile;
+    }
+
+    s->_sendWindow -= n;
+    _sendWindow -= n;
+
+    // the virtual time advances in inverse proportion to the weight
+    if(s->_vtime > _vtime)
+        _vtime = s->_vtime;
+
+    s->_vtime += (Pt::uint64_t(n) + 1) * 256 / s->_weight;
+
+    // bound streams are never released here
+    const bool bound = s->_request != 0;
+
+    if(end)
+        onEndSent(s);
+
+    if(bound)
+        notify(s);
+
+    return true;
+}
+
+
+void Http2Session::writeHeaders(Http2Stream* s, Reply& reply)
+{
+    const MessageHeader& header = reply.header();
+
+    _block.clear();
+    _encoder.beginBlock(_block);
+
+    unsigned code = reply.statusCode();
+    if(code < 100 || code > 999)
+        code = 500;
+
+    char status[3];
+    status[0] = static_cast<char>('0' + code / 100);
+    status[1] = static_cast<char>('0' + code / 10 % 10);
+    status[2] = static_cast<char>('0' + code % 10);
+    _encoder.encode(_block, ":status", 7, status, 3);
+
+    // field names are lower case in HTTP/2
+    MessageHeader::ConstIterator it;
+    for(it = header.begin(); it != header.end(); ++it)
+    {
+        _name = it->name();
+        std::transform(_name.begin(), _name.end(), _name.begin(), ::tolower);
+
+        if( isConnectionField(_name.data(), _name.size()) )
+            continue;
+
+        const char* value = it->value();
+        _encoder.encode(_block, _name.data(), _name.size(), value, std::strlen(value));
+    }
+
+    Pt::uint64_t size = reply.buffer().size();
+    if( reply.file() )
+        size += reply.fileSize();
+
+    if( reply.isFinished() && ! header.has("Content-Length") )
+    {
+        char buffer[24];
+        char* p = buffer + sizeof(buffer);
+        do
+        {
+            *--p = static_cast<char>('0' + size % 10);
+            size /= 10;
+        }
+        while(size > 0);
+
+        _encoder.encode(_block, "content-length", 14, p, buffer + sizeof(buffer) - p);
+    }
+
+    if( ! header.has("Server") )
+    {
+        _encoder.encode(_block, "server", 6, "Platinum 1.0", 12);
+    }
+
+    if( ! header.has("Date") )
+    {
+        char buffer[50];
+        const char* date = MessageHeader::htdateCurrent(buffer);
+        _encoder.encode(_block, "date", 4, date, std::strlen(date));
+    }
+
+    const bool end = reply.isFinished() && reply.buffer().size() == 0 &&
+                     ( ! reply.file() || reply.fileSize() == 0 );
+
+    // blocks, which exceed the frame size, are continued
+    std::size_t pos = 0;
+    do
+    {
+        std::size_t n = std::min<std::size_t>(_block.size() - pos, _peerFrameSize);
+        unsigned flags = pos + n == _block.size() ? EndHeadersFlag : 0;
+
+        if(pos == 0)
+            writeFrameHeader(n, HeadersFrame, end ? (flags | EndStreamFlag) : flags, s->_id);
+        else
+            writeFrameHeader(n, ContinuationFrame, flags, s->_id);
+
+        _out.append(_block, pos, n);
+        pos += n;
+    }
+    while(pos < _block.size());
+
+    s->_headersSent = true;
+
+    if(end)
+        onEndSent(s);
+}
+
+
+void Http2Session::writeFrameHeader(std::size_t length, unsigned type,
+                                    unsigned flags, Pt::uint32_t id)
+{
+    _out += static_cast<char>(length >> 16);
+    _out += static_cast<char>(length >> 8);
+    _out += static_cast<char>(length);
+    _out += static_cast<char>(type);
+    _out += static_cast<char>(flags);
+    appendUInt32(_out, id);
+}
+
+
+void Http2Session::writeSettings()
+{
+    writeFrameHeader(12, SettingsFrame, 0, 0);
+
+    _out += '\0';
+    _out += static_cast<char>(MaxConcurrentStreamsSetting);
+    appendUInt32(_out, static_cast<Pt::uint32_t>(_maxStreams));
+
+    _out += '\0';
+    _out += static_cast<char>(MaxHeaderListSizeSetting);
+    appendUInt32(_out, static_cast<Pt::uint32_t>(_maxHeaderSize));
+}
+
+
+void Http2Session::writeWindowUpdate(Pt::uint32_t id, Pt::uint32_t increment)
+{
+    writeFrameHeader(4, WindowUpdateFrame, 0, id);
+    appendUInt32(_out, increment);
+}
+
+
+void Http2Session::writeResetStream(Pt::uint32_t id, Pt::uint32_t error)
+{
+    writeFrameHeader(4, ResetStreamFrame, 0, id);
+    appendUInt32(_out, error);
+}
+
+
+void Http2Session::writeGoAway(Pt::uint32_t error)
+{
+    writeFrameHeader(8, GoAwayFrame, 0, 0);
+    appendUInt32(_out, _lastStream);
+    appendUInt32(_out, error);
+}
+
+
+void Http2Session::onInput()
+{
+    log_trace("Http2Session::onInput");
+
+    try
+    {
+        endRead();
+
+        if( _conn._socket.isEof() )
+        {
+            log_debug("connection closed by client");
+            finish();
+            return;
+        }
+
+        process();
+    }
+    catch(const System::IOError& e)
+    {
+        log_warn("HTTP/2 I/O error: " << e.what());
+        finish();
+    }
+}
+
+
+void Http2Session::onOutput()
+{
+    log_trace("Http2Session::onOutput");
+
+    try
+    {
+        _conn.endWrite();
+
+        if( _conn._socket.isEof() )
+        {
+            finish();
+            return;
+        }
+
+        // continue with the rest of a partial write
+        if( _conn.outputAvailable() )
+        {
+            _conn.beginWrite();
+            return;
+        }
+
+        process();
+    }
+    catch(const System::IOError& e)
+    {
+        log_warn("HTTP/2 I/O error: " << e.what());
+        finish();
+    }
+}
+
+
+void Http2Session::onReady()
+{
+    log_trace("Http2Session::onReady");
+
+    _readyPending = false;
+
+    try
+    {
+        process();
+    }
+    catch(const System::IOError& e)
+    {
+        log_warn("HTTP/2 I/O error: " << e.what());
+        finish();
+    }
+}
+
+
+void Http2Session::onTimeout()
+{
+    log_debug("HTTP/2 session timeout");
+
+    if( isWriting() )
+    {
+        finish();
+        return;
+    }
+
+    // the client is told that no further streams are processed
+    connectionError(NoError);
+
+    try
+    {
+        process();
+    }
+    catch(const System::IOError& e)
+    {
+        log_warn("HTTP/2 I/O error: " << e.what());
+        finish();
+    }
+}
+
+
+void Http2Session::process()
+{
+    readInput();
+    dispatch();
+    deliver();
+
+    if(_closed)
+        return;
+
+    update();
+
+    if( _closing && ! isWriting() && _out.empty() )
+        finish();
+}
+
+
+void Http2Session::update()
+{
+    if( _closed || isWriting() )
+        return;
+
+    schedule();
+
+    if( ! _out.empty() )
+    {
+        suspendRead();
+        beginWrite();
+        return;
+    }
+
+    // all streams are completed after the client went away
+    if( _goingAway && _openStreams == 0 && _pending.empty() )
+        _closing = true;
+
+    if(_closing)
+    {
+        setReady();
+        return;
+    }
+
+    // the I/O timeout applies while requests are received,
+    // the keep-alive timeout while no stream is open
+    bool receiving = false;
+    for(StreamMap::iterator it = _streams.begin(); it != _streams.end(); ++it)
+    {
+        if(it->second->_state == Http2Stream::Open)
+        {
+            receiving = true;
+            break;
+        }
+    }
+
+    if(receiving)
+        _conn._timer.start(_conn._timeout);
+    else if(_openStreams == 0)
+        _conn._timer.start(_conn._keepaliveTimeout);
+    else
+        _conn._timer.stop();
+
+    beginRead();
+}
+
+
+void Http2Session::beginRead()
+{
+    if( _conn._sockbuf.isReading() )
+        return;
+
+    if(_conn._ssl)
+    {
+        _conn._sslbuf.import();
+
+        if(_conn._sslbuf.in_avail() > 0)
+        {
+            setReady();
+            return;
+        }
+    }
+
+    _conn._sockbuf.beginRead();
+}
+
+
+void Http2Session::endRead()
+{
+    _conn._sockbuf.endRead();
+
+    if(_conn._ssl)
+        _conn._sslbuf.import();
+}
+
+
+void Http2Session::suspendRead()
+{
+    // the socket can not read and write at the same time
+    if( ! _conn._sockbuf.isReading() )
+        return;
+
+    if( _conn._socket.ravail() > 0 || _conn._socket.isEof() )
+    {
+        // the read has already completed
+        endRead();
+        setReady();
+        return;
+    }
+
+    _conn._socket.cancel();
+
+    // cancelling discards a scheduled notification
+    if(_readyPending)
+        _conn._socket.setInputPipelined();
+}
+
+
+void Http2Session::beginWrite()
+{
+    output().sputn(_out.data(), static_cast<std::streamsize>(_out.size()));
+    _out.clear();
+
+    _conn.beginWrite();
+}
+
+
+bool Http2Session::isWriting() const
+{
+    return _conn._sockbuf.isWriting();
+}
+
+
+void Http2Session::setReady()
+{
+    if(_readyPending)
+        return;
+
+    _readyPending = true;
+    _conn._socket.setInputPipelined();
+}
+
+
+void Http2Session::finish()
+{
+    log_debug("HTTP/2 session finished");
+
+    _closed = true;
+    _readyPending = false;
+    _conn._timer.stop();
+    _conn._socket.close();
+
+    // the connection and session may be destroyed by the receiver
+    _conn._sessionFinished.send(_conn);
+}
+
+} // namespace Http
+
+} // namespace Pt
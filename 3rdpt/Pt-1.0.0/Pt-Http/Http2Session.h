@@ -0,0 +1,413 @@
+/*
+ * Copyright (C) 2005-2013 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef Pt_Http_Http2Session_h
+#define Pt_Http_Http2Session_h
+
+#include "Hpack.h"
+
+#include <Pt/Http/Api.h>
+#include <Pt/Http/Message.h>
+#include <Pt/Types.h>
+
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <cstddef>
+
+namespace Pt {
+
+namespace System {
+    class FileDevice;
+}
+
+namespace Http {
+
+class Connection;
+class Request;
+class Reply;
+
+/** @internal @brief Buffers the request body received on a HTTP/2 stream.
+
+    Received data is appended at the end of the get area. Consumed data
+    is removed when new data is appended, so the buffer does not grow
+    beyond the flow control window of the stream.
+*/
+class Http2Body : public std::streambuf
+{
+    public:
+        Http2Body();
+
+        void clear();
+
+        void append(const char* data, std::size_t n);
+
+        //! @brief Returns the total number of bytes appended.
+        Pt::uint64_t received() const
+        { return _received; }
+
+        //! @brief Returns the number of bytes consumed since the last call.
+        std::size_t consume();
+
+    protected:
+        virtual int_type underflow();
+
+    private:
+        std::vector<char> _data;
+        Pt::uint64_t _received;
+        Pt::uint64_t _consumed;
+};
+
+/** @internal @brief State of a HTTP/2 stream.
+*/
+struct Http2Stream
+{
+    enum State
+    {
+        Idle = 0,
+        Open = 1,
+        HalfClosedRemote = 2,
+        Closed = 3
+    };
+
+    Http2Stream();
+
+    void clear();
+
+    //! @brief Returns the number of body bytes, which are not framed yet.
+    Pt::uint64_t pending() const
+    { return (_output.size() - _outputPos) + _fileRemaining; }
+
+    Pt::uint32_t _id;
+    State _state;
+
+    // priority tree
+    Http2Stream* _parent;
+    unsigned _weight;
+    Pt::uint64_t _vtime;
+    bool _active;
+
+    // bound exchange
+    Request* _request;
+    Reply* _reply;
+    bool _queued;
+
+    // request
+    std::string _method;
+    std::string _path;
+    std::string _authority;
+    std::string _fields;
+    Http2Body _body;
+    Pt::uint64_t _bodyReported;
+    Pt::int64_t _recvWindow;
+    std::size_t _recvUnacked;
+    bool _headerReceived;
+    bool _headerReported;
+    bool _endStream;
+    bool _endReported;
+
+    // reply
+    std::string _output;
+    std::size_t _outputPos;
+    System::FileDevice* _file;
+    Pt::uint64_t _fileOffset;
+    Pt::uint64_t _fileRemaining;
+    Pt::int64_t _sendWindow;
+    bool _headersSent;
+    bool _finished;
+    bool _endSent;
+    bool _replyPending;
+    bool _reset;
+};
+
+/** @internal @brief Serves a connection with the HTTP/2 protocol.
+
+    The session multiplexes the streams of a client over the socket and
+    I/O buffers of a Connection. Each stream is bound to a pair of a
+    Request and a Reply, which the server attached to the connection.
+    When a new stream arrives and no attached pair is waiting for one,
+    the connection requests another pair, until the maximum number of
+    concurrent streams is reached. Streams, which exceed this number, are
+    refused.
+
+    All frames are collected in an output buffer and written together.
+    While a write is pending, DATA frames are only scheduled when the
+    output buffer runs low. The next stream to send is the one with the
+    smallest virtual time among those, which do not depend on a stream
+    that can send itself. Its virtual time advances by the size of each
+    frame divided by its weight, so siblings share the connection in
+    proportion to their weights.
+*/
+class Http2Session
+{
+    public:
+        //! @brief Default size of the flow control windows (RFC 7540, 6.9.2).
+        static const Pt::uint32_t DefaultWindowSize = 65535;
+
+        //! @brief Default and smallest maximum frame size (RFC 7540, 6.5.2).
+        static const Pt::uint32_t DefaultFrameSize = 16384;
+
+        //! @brief Size of the client connection preface.
+        static const std::size_t PrefaceSize = 24;
+
+    public:
+        Http2Session(Connection& conn, std::size_t maxStreams, std::size_t maxHeaderSize);
+
+        ~Http2Session();
+
+        //! @brief Returns the number of bytes, which match the client preface.
+        static std::size_t matchPreface(const char* data, std::size_t n);
+
+        //! @brief Adds a request and reply pair, which can serve a stream.
+        void attach(Request& request, Reply& reply);
+
+        //! @brief Starts the session, the client preface is read first.
+        void start();
+
+        //! @brief Resets the stream bound to a request.
+        void resetStream(Request& request);
+
+        void beginReceiveRequest(Request& request);
+
+        MessageProgress endReceiveRequest(Request& request);
+
+        void beginSendReply(Reply& reply);
+
+        MessageProgress endSendReply(Reply& reply);
+
+        void onInput();
+
+        void onOutput();
+
+        void onReady();
+
+        void onTimeout();
+
+    private:
+        struct Binding
+        {
+            Request* request;
+            Reply* reply;
+            Http2Stream* stream;
+            bool waiting;
+        };
+
+        Binding* findBinding(const Request& request);
+
+        Binding* findBinding(const Reply& reply);
+
+        void bind(Binding& b, Http2Stream* s);
+
+        void unbind(Binding& b);
+
+        std::streambuf& input();
+
+        std::streambuf& output();
+
+        void readInput();
+
+        void parse(const char* data, std::size_t n);
+
+        void beginFrame();
+
+        void beginData();
+
+        void onData(const char* data, std::size_t n);
+
+        void endData();
+
+        void endFrame();
+
+        void onHeaders();
+
+        void onContinuation();
+
+        void endHeaders();
+
+        void applyHeader(Http2Stream* s, Request& request);
+
+        void onPriority();
+
+        void onResetStream();
+
+        void onSettings();
+
+        void onPing();
+
+        void onGoAway();
+
+        void onWindowUpdate();
+
+        Http2Stream* findStream(Pt::uint32_t id);
+
+        Http2Stream* createStream(Pt::uint32_t id);
+
+        void releaseStream(Http2Stream* s);
+
+        void prioritize(Http2Stream* s, Pt::uint32_t dependency,
+                        unsigned weight, bool exclusive);
+
+        void closeStream(Http2Stream* s);
+
+        void onEndStream(Http2Stream* s);
+
+        void onEndSent(Http2Stream* s);
+
+        void resetStream(Http2Stream* s, Pt::uint32_t error);
+
+        void connectionError(Pt::uint32_t error);
+
+        void replenish(Http2Stream* s);
+
+        void dispatch();
+
+        void notify(Http2Stream* s);
+
+        void deliver();
+
+        bool hasInput(const Http2Stream* s) const;
+
+        bool isReplySent(const Http2Stream* s) const;
+
+        void activate(Http2Stream* s);
+
+        bool isSendable(const Http2Stream* s) const;
+
+        Http2Stream* nextStream();
+
+        void schedule();
+
+        bool writeData(Http2Stream* s);
+
+        void writeHeaders(Http2Stream* s, Reply& reply);
+
+        void writeFrameHeader(std::size_t length, unsigned type,
+                              unsigned flags, Pt::uint32_t id);
+
+        void writeSettings();
+
+        void writeWindowUpdate(Pt::uint32_t id, Pt::uint32_t increment);
+
+        void writeResetStream(Pt::uint32_t id, Pt::uint32_t error);
+
+        void writeGoAway(Pt::uint32_t error);
+
+        void process();
+
+        void update();
+
+        void beginRead();
+
+        void endRead();
+
+        void suspendRead();
+
+        void beginWrite();
+
+        bool isWriting() const;
+
+        void setReady();
+
+        void finish();
+
+    private:
+        Connection& _conn;
+        std::size_t _maxStreams;
+        std::size_t _maxHeaderSize;
+
+        // input
+        enum InputState
+        {
+            ReadPreface,
+            ReadHeader,
+            ReadPayload,
+            ReadPadLength,
+            ReadData,
+            SkipPayload
+        } _inputState;
+
+        unsigned char _header[9];
+        std::size_t _headerSize;
+        std::size_t _frameLength;
+        unsigned _frameType;
+        unsigned _frameFlags;
+        Pt::uint32_t _frameStream;
+        std::size_t _remaining;
+        std::size_t _padding;
+        std::string _payload;
+        Pt::uint32_t _dataStream;
+
+        // header block, which may continue in CONTINUATION frames
+        std::string _headerBlock;
+        Pt::uint32_t _headerStream;
+        Pt::uint32_t _headerError;
+        Pt::uint32_t _continuation;
+        bool _headerTrailer;
+        bool _headerEndStream;
+        HpackDecoder _decoder;
+
+        // output
+        std::string _out;
+        std::string _block;
+        std::string _name;
+        std::vector<char> _fileBuffer;
+        HpackEncoder _encoder;
+        Pt::uint32_t _peerFrameSize;
+        Pt::int64_t _peerWindowSize;
+
+        // flow control of the connection
+        Pt::int64_t _sendWindow;
+        Pt::int64_t _recvWindow;
+        std::size_t _recvUnacked;
+
+        // streams
+        typedef std::map<Pt::uint32_t, Http2Stream*> StreamMap;
+        StreamMap _streams;
+        std::vector<Http2Stream*> _freeStreams;
+        std::vector<Http2Stream*> _active;
+        std::deque<Http2Stream*> _pending;
+        std::deque<Http2Stream*> _ready;
+        std::vector<Binding> _bindings;
+        Pt::uint32_t _lastStream;
+        std::size_t _openStreams;
+        std::size_t _idleStreams;
+        Pt::uint64_t _vtime;
+
+        bool _readyPending;
+        bool _goingAway;
+        bool _closing;
+        bool _closed;
+};
+
+} // namespace Http
+
+} // namespace Pt
+
+#endif // Pt_Http_Http2Session_h
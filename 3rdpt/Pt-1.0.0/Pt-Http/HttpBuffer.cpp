@@ -28,6 +28,7 @@
 #include <algorithm>
 #include "HttpBuffer.h"
 #include <Pt/Http/HttpError.h>
+#include <Pt/StreamBuffer.h>
 #include <Pt/System/Logger.h>
 #include <stdexcept>
 #include <sstream>
@@ -88,6 +89,33 @@ void ChunkParser::parse(char ch)
 }
 
 
+std::size_t ChunkParser::parse(const char* data, std::size_t n)
+{
+    const char* p = data;
+    const char* const e = data + n;
+
+    while(p != e && _state)
+    {
+        // chunk extensions and trailer fields are skipped in one go
+        if(_state == &ChunkParser::onExtension || _state == &ChunkParser::onTrailerData)
+        {
+            while(p != e && *p != '\r' && *p != '\n')
+                ++p;
+
+            if(p == e)
+                break;
+        }
+
+        (this->*_state)(*p++);
+
+        if( hasChunk() )
+            break;
+    }
+
+    return p - data;
+}
+
+
 void ChunkParser::onBegin(char ch)
 {
     log_trace("onBegin, ch=" << charToPrint(ch));
@@ -306,10 +334,31 @@ void HttpBuffer::import(std::streamsize n)
     {
         log_debug("getting next chunk");
         _contentLength = 0;
-        while(n-- && ! _chunkParser.end())
+
+        // parse the get area of the underlying buffer in place, if possible
+        BasicStreamBuffer<char>* sb = dynamic_cast<BasicStreamBuffer<char>*>(_sbuf);
+
+        while(n > 0 && ! _chunkParser.end())
         {
-            char ch = _sbuf->sbumpc();
-            _chunkParser.parse(ch);
+            std::size_t avail = 0;
+            const char* data = sb ? sb->sview(avail) : 0;
+
+            if(avail > 0)
+            {
+                if(avail > static_cast<std::size_t>(n))
+                    avail = static_cast<std::size_t>(n);
+
+                std::size_t used = _chunkParser.parse(data, avail);
+                sb->sskip(used);
+                n -= used;
+            }
+            else
+            {
+                char ch = _sbuf->sbumpc();
+                _chunkParser.parse(ch);
+                --n;
+            }
+
             if( _chunkParser.hasChunk() )
             {
                 _contentLength = _chunkParser.chunkSize();
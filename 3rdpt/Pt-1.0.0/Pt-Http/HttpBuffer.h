@@ -51,6 +51,13 @@ class ChunkParser
 
         void parse(char ch);
 
+        /** @brief Parses the chunk framing in a buffer.
+
+            Parsing stops after the size line of the next chunk, or at the
+            end of the body. Returns the number of characters used.
+        */
+        std::size_t parse(const char* data, std::size_t n);
+
         bool hasChunk() const
         { return _state == &ChunkParser::onData; }
 
@@ -29,6 +29,10 @@
 #include <Pt/Http/Message.h>
 #include <Pt/Http/HttpError.h>
 #include <Pt/System/Clock.h>
+#include <Pt/System/IOBuffer.h>
+#include <Pt/System/ChainBuffer.h>
+#include <Pt/System/Mutex.h>
+#include <Pt/RefCounted.h>
 #include <cctype>
 #include <sstream>
 #include <stdio.h>
@@ -45,6 +49,11 @@ log_define("Pt.Http.Message")
 
 namespace {
 
+inline char foldCase(char ch)
+{
+    return (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch + ('a' - 'A')) : ch;
+}
+
 int compareIgnoreCase(const char* s1, const char* s2)
 {
     const char* it1 = s1;
@@ -53,8 +62,8 @@ int compareIgnoreCase(const char* s1, const char* s2)
     {
         if (*it1 != *it2)
         {
-            char c1 = std::toupper(*it1);
-            char c2 = std::toupper(*it2);
+            char c1 = foldCase(*it1);
+            char c2 = foldCase(*it2);
             if (c1 < c2)
                 return -1;
             else if (c2 < c1)
@@ -68,6 +77,117 @@ int compareIgnoreCase(const char* s1, const char* s2)
                 : *it2 ? -1 : 0;
 }
 
+// compares n characters of s1 with the null-terminated s2
+inline bool equalsIgnoreCase(const char* s1, const char* s2, std::size_t n)
+{
+    for(std::size_t i = 0; i < n; ++i)
+    {
+        if( s1[i] != s2[i] && foldCase(s1[i]) != foldCase(s2[i]) )
+            return false;
+    }
+
+    return s2[n] == '\0';
+}
+
+// FNV-1a over the lower case characters
+inline Pt::uint32_t hashKey(const char* s, std::size_t n)
+{
+    Pt::uint32_t h = 2166136261u;
+    for(std::size_t i = 0; i < n; ++i)
+    {
+        h ^= static_cast<unsigned char>( foldCase(s[i]) );
+        h *= 16777619u;
+    }
+
+    return h;
+}
+
+char emptyFields[2] = { '\0', '\0' };
+
+const std::size_t MinBlockSize = 1024;
+const std::size_t BlockClasses = 5; // 1K to 16K
+
+// pool for the blocks of the header fields
+class HeaderPool : private Pt::NonCopyable
+{
+    public:
+        static HeaderPool& instance()
+        {
+            // never destroyed, headers may outlive static destruction
+            static HeaderPool* pool = new HeaderPool;
+            return *pool;
+        }
+
+        // returns a block of at least size bytes and sets size to its capacity
+        char* acquire(std::size_t& size)
+        {
+            std::size_t cls = 0;
+            std::size_t blockSize = MinBlockSize;
+            while(blockSize < size)
+            {
+                blockSize *= 2;
+                ++cls;
+            }
+
+            size = blockSize;
+
+            if(cls < BlockClasses)
+            {
+                Pt::System::MutexLock lock(_mutex);
+                char* block = _free[cls];
+                if(block)
+                {
+                    std::memcpy(&_free[cls], block, sizeof(char*));
+                    --_count[cls];
+                    return block;
+                }
+            }
+
+            return new char[blockSize];
+        }
+
+        void release(char* block, std::size_t size)
+        {
+            std::size_t cls = 0;
+            std::size_t blockSize = MinBlockSize;
+            while(blockSize < size)
+            {
+                blockSize *= 2;
+                ++cls;
+            }
+
+            if(cls < BlockClasses)
+            {
+                Pt::System::MutexLock lock(_mutex);
+                if(_count[cls] < MaxFree)
+                {
+                    std::memcpy(block, &_free[cls], sizeof(char*));
+                    _free[cls] = block;
+                    ++_count[cls];
+                    return;
+                }
+            }
+
+            delete [] block;
+        }
+
+    private:
+        HeaderPool()
+        {
+            for(std::size_t n = 0; n < BlockClasses; ++n)
+            {
+                _free[n] = 0;
+                _count[n] = 0;
+            }
+        }
+
+    private:
+        static const std::size_t MaxFree = 256;
+        Pt::System::Mutex _mutex;
+        char* _free[BlockClasses];
+        std::size_t _count[BlockClasses];
+};
+
 } 
 
 namespace Pt {
@@ -75,28 +195,29 @@ namespace Pt {
 namespace Http {
 
 MessageHeader::MessageHeader()
-: _endOffset(0)
+: _rawdata(emptyFields)
+, _capacity(0)
+, _maxSize(DefaultMaxSize)
+, _endOffset(0)
 , _httpVersionMajor(1)
 , _httpVersionMinor(1)
 {
-    _rawdata[0] = _rawdata[1] = '\0';
+    clearIndex();
 }
 
 
 MessageHeader::~MessageHeader()  
 {
+    if(_capacity)
+        HeaderPool::instance().release(_rawdata, _capacity);
 }
 
 
 const char* MessageHeader::get(const char* key) const
 {
-    for (ConstIterator it = begin(); it != end(); ++it)
-    {
-        if (compareIgnoreCase(key, it->name()) == 0)
-            return it->value();
-    }
-
-    return 0;
+    const std::size_t n = std::strlen(key);
+    const char* name = find(key, n);
+    return name ? name + n + 1 : 0;
 }
 
 
@@ -111,10 +232,13 @@ bool MessageHeader::isSet(const char* key, const char* value) const
 
 void MessageHeader::clear()
 {
-    _rawdata[0] = _rawdata[1] = '\0';
+    if(_capacity)
+        _rawdata[0] = _rawdata[1] = '\0';
+
     _endOffset = 0;
     _httpVersionMajor = 1;
     _httpVersionMinor = 1;
+    clearIndex();
 }
 
 
@@ -130,44 +254,60 @@ void MessageHeader::add(const char* key, const char* value)
 { 
     log_debug("MessageHeader::add(\"" << key << "\", \"" << value << "\", " << replace << ')');
 
-    if( ! *key)
-        throw std::invalid_argument("header key is NULL");
+    add(key, std::strlen(key), value, std::strlen(value));
+}
 
-    char* p = eptr();
 
-    std::size_t lk = std::strlen(key);     // length of key
-    std::size_t lv = std::strlen(value);   // length of value
+void MessageHeader::add(const char* key, std::size_t lk, const char* value, std::size_t lv)
+{
+    if(lk == 0)
+        throw std::invalid_argument("header key is NULL");
 
-    if (p - _rawdata + lk + lv + 2 > MaxHeaderSize)
+    // key, value and end marker, each followed by a null
+    const std::size_t size = _endOffset + lk + lv + 3;
+    if (size > _maxSize)
         throw HttpError("message header too big");
 
-    std::strcpy(p, key);   // copy key
+    if (size > _capacity)
+        reserve(size);
+
+    char* p = eptr();
+    std::memcpy(p, key, lk);   // copy key
+    p[lk] = '\0';
     p += lk + 1;
-    std::strcpy(p, value); // copy value
-    p[lv + 1] = '\0';      // put new message end marker in place
+    std::memcpy(p, value, lv); // copy value
+    p[lv] = '\0';
+    p[lv + 1] = '\0';          // put new message end marker in place
 
+    index(_endOffset, lk);
     _endOffset = (p + lv + 1) - _rawdata;
 }
 
 
 void MessageHeader::remove(const char* key)
 {
-    if( ! *key)
+    const std::size_t n = std::strlen(key);
+
+    if(n == 0)
         throw std::invalid_argument("header key is NULL");
 
+    if( ! find(key, n) )
+        return;
+
     char* p = eptr();
 
     ConstIterator it = begin();
     while (it != end())
     {
-        if (compareIgnoreCase(key, it->name()) == 0)
+        if (equalsIgnoreCase(key, it->name(), n))
         {
             std::size_t slen = it->value() - it->name() + std::strlen(it->value()) + 1;
 
-            std::memcpy(
+            // move the following fields and the end marker
+            std::memmove(
                 const_cast<char*>(it->name()),
                 it->name() + slen,
-                p - it->name() + slen);
+                p - it->name() - slen + 1);
 
             p -= slen;
 
@@ -178,18 +318,133 @@ void MessageHeader::remove(const char* key)
     }
 
     _endOffset = p - _rawdata;
+    rebuildIndex();
+}
+
+
+void MessageHeader::reserve(std::size_t n)
+{
+    std::size_t capacity = n < _capacity * 2 ? _capacity * 2 : n;
+    char* data = HeaderPool::instance().acquire(capacity);
+
+    std::memcpy(data, _rawdata, _endOffset);
+    data[_endOffset] = data[_endOffset + 1] = '\0';
+
+    if(_capacity)
+        HeaderPool::instance().release(_rawdata, _capacity);
+
+    _rawdata = data;
+    _capacity = capacity;
+}
+
+
+const char* MessageHeader::find(const char* key, std::size_t n) const
+{
+    if(_endOffset == 0)
+        return 0;
+
+    const Pt::uint32_t h = hashKey(key, n);
+
+    // the index is never full, so there is always an empty slot
+    for(std::size_t i = h & (IndexSize - 1); _index[i].offset; i = (i + 1) & (IndexSize - 1))
+    {
+        const char* name = _rawdata + _index[i].offset - 1;
+        if(_index[i].hash == h && equalsIgnoreCase(key, name, n))
+            return name;
+    }
+
+    if( ! _indexFull )
+        return 0;
+
+    for(ConstIterator it = begin(); it != end(); ++it)
+    {
+        if( equalsIgnoreCase(key, it->name(), n) )
+            return it->name();
+    }
+
+    return 0;
+}
+
+
+void MessageHeader::index(std::size_t offset, std::size_t n)
+{
+    const char* name = _rawdata + offset;
+
+    KnownField f = KnownFieldCount;
+    switch(n)
+    {
+        case 10:
+            if( equalsIgnoreCase(name, "connection", n) )
+                f = ConnectionField;
+            break;
+
+        case 14:
+            if( equalsIgnoreCase(name, "content-length", n) )
+                f = ContentLength;
+            break;
+
+        case 17:
+            if( equalsIgnoreCase(name, "transfer-encoding", n) )
+                f = TransferEncoding;
+            break;
+    }
+
+    // the first field of a name counts
+    if(f != KnownFieldCount && _known[f] == 0)
+        _known[f] = static_cast<Pt::uint32_t>(offset + n + 2);
+
+    const Pt::uint32_t h = hashKey(name, n);
+
+    std::size_t i = h & (IndexSize - 1);
+    for( ; _index[i].offset; i = (i + 1) & (IndexSize - 1))
+    {
+        if(_index[i].hash == h && equalsIgnoreCase(name, _rawdata + _index[i].offset - 1, n))
+            return;
+    }
+
+    // further names are found by a linear search
+    if(_indexed >= MaxIndexed)
+    {
+        _indexFull = true;
+        return;
+    }
+
+    _index[i].hash = h;
+    _index[i].offset = static_cast<Pt::uint32_t>(offset + 1);
+    ++_indexed;
+}
+
+
+void MessageHeader::clearIndex()
+{
+    std::memset(_index, 0, sizeof(_index));
+    std::memset(_known, 0, sizeof(_known));
+    _indexed = 0;
+    _indexFull = false;
+}
+
+
+void MessageHeader::rebuildIndex()
+{
+    clearIndex();
+
+    for(ConstIterator it = begin(); it != end(); ++it)
+    {
+        index(it->name() - _rawdata, it->value() - it->name() - 1);
+    }
 }
 
 
 bool MessageHeader::isChunked() const
 {
-    return isSet("Transfer-Encoding", "chunked");
+    const char* s = known(TransferEncoding);
+    return s && compareIgnoreCase(s, "chunked") == 0;
 }
 
 
 std::size_t MessageHeader::contentLength() const
 {
-    const char* s = get("Content-Length");
+    const char* s = known(ContentLength);
     if (s == 0)
         return 0;
 
@@ -203,11 +458,12 @@ std::size_t MessageHeader::contentLength() const
 
 bool MessageHeader::isKeepAlive() const
 {
-    const char* ch = get("Connection");
+    const char* ch = known(ConnectionField);
 
+    // HTTP/2 connections are always persistent
     if (ch == 0)
-        return versionMajor() == 1
-            && versionMinor() >= 1;
+        return versionMajor() > 1
+            || (versionMajor() == 1 && versionMinor() >= 1);
     else
         return compareIgnoreCase(ch, "keep-alive") == 0;
 }
@@ -291,6 +547,81 @@ MessageBuffer::int_type MessageBuffer::overflow(int_type ch)
 }
 
 
+namespace {
+
+// keeps the data of a MessageBuffer alive until it was written
+class MessageData : public RefCounted
+{
+    public:
+        explicit MessageData(char* data)
+        : _data(data)
+        { }
+
+        ~MessageData()
+        { delete [] _data; }
+
+        const char* data() const
+        { return _data; }
+
+    private:
+        char* _data;
+};
+
+
+template <typename BufferT>
+void queueData(BufferT& ob, char* data, std::size_t n)
+{
+    MessageData* md = new MessageData(data);
+    md->addRef();
+
+    try
+    {
+        ob.queue(md->data(), n, *md);
+    }
+    catch(...)
+    {
+        md->release();
+        throw;
+    }
+
+    md->release();
+}
+
+}
+
+
+void MessageBuffer::moveTo(System::IOBuffer& ob)
+{
+    std::size_t n = size();
+    if(n == 0)
+        return;
+
+    char* data = _buffer;
+    _buffer = 0;
+    _bufferSize = 0;
+    this->setp(0, 0);
+    this->setg(0, 0, 0);
+
+    queueData(ob, data, n);
+}
+
+
+void MessageBuffer::moveTo(System::ChainBuffer& ob)
+{
+    std::size_t n = size();
+    if(n == 0)
+        return;
+
+    char* data = _buffer;
+    _buffer = 0;
+    _bufferSize = 0;
+    this->setp(0, 0);
+    this->setg(0, 0, 0);
+
+    queueData(ob, data, n);
+}
+
+
 MessageBuffer::int_type MessageBuffer::underflow()
 { 
     if( this->gptr() < this->pptr() )
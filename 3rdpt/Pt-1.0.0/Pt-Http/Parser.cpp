@@ -27,10 +27,21 @@
  */
 
 #include "Parser.h"
+#include <Pt/StreamBuffer.h>
 #include <cctype>
 #include <algorithm>
 #include <string.h>
 
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define PT_HTTP_SCAN_AVX2
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define PT_HTTP_SCAN_SSE2
+#endif
+
 #define log_debug(e)
 #define log_warn(e)
 
@@ -69,6 +80,120 @@ namespace Http {
                  : ch >= 'A' && ch <= 'Z' ? ch - 'A' + 10
                  : 0;
         }
+
+        inline bool isDelimiter(char ch, char a, char b, char c, bool ctl)
+        {
+            const unsigned char uch = static_cast<unsigned char>(ch);
+            return ch == a || ch == b || ch == c || (ctl && (uch <= 32 || uch >= 127));
+        }
+
+        inline unsigned countTrailingZeros(unsigned mask)
+        {
+#if defined(_MSC_VER)
+            unsigned long n;
+            _BitScanForward(&n, mask);
+            return n;
+#else
+            return __builtin_ctz(mask);
+#endif
+        }
+
+        /* Returns the first character in [p, e), which is equal to a, b
+           or c. If ctl is set, spaces, control characters and characters
+           outside of 7-bit ASCII are delimiters, too.
+        */
+        const char* findDelimiter(const char* p, const char* e,
+                                  char a, char b, char c, bool ctl)
+        {
+#if defined(PT_HTTP_SCAN_AVX2)
+            const __m256i a32 = _mm256_set1_epi8(a);
+            const __m256i b32 = _mm256_set1_epi8(b);
+            const __m256i c32 = _mm256_set1_epi8(c);
+            const __m256i space32 = _mm256_set1_epi8(33);
+            const __m256i del32 = _mm256_set1_epi8(127);
+
+            for( ; e - p >= 32; p += 32)
+            {
+                const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                __m256i m = _mm256_or_si256( _mm256_cmpeq_epi8(v, a32),
+                            _mm256_or_si256( _mm256_cmpeq_epi8(v, b32),
+                                             _mm256_cmpeq_epi8(v, c32) ) );
+                if(ctl)
+                {
+                    // signed compare, so that characters above 127 are below 33
+                    m = _mm256_or_si256(m, _mm256_or_si256( _mm256_cmpgt_epi8(space32, v),
+                                                            _mm256_cmpeq_epi8(v, del32) ) );
+                }
+
+                const unsigned mask = static_cast<unsigned>( _mm256_movemask_epi8(m) );
+                if(mask)
+                    return p + countTrailingZeros(mask);
+            }
+#endif
+
+#if defined(PT_HTTP_SCAN_SSE2)
+            const __m128i a16 = _mm_set1_epi8(a);
+            const __m128i b16 = _mm_set1_epi8(b);
+            const __m128i c16 = _mm_set1_epi8(c);
+            const __m128i space16 = _mm_set1_epi8(33);
+            const __m128i del16 = _mm_set1_epi8(127);
+
+            for( ; e - p >= 16; p += 16)
+            {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                __m128i m = _mm_or_si128( _mm_cmpeq_epi8(v, a16),
+                            _mm_or_si128( _mm_cmpeq_epi8(v, b16),
+                                          _mm_cmpeq_epi8(v, c16) ) );
+                if(ctl)
+                {
+                    m = _mm_or_si128(m, _mm_or_si128( _mm_cmplt_epi8(v, space16),
+                                                      _mm_cmpeq_epi8(v, del16) ) );
+                }
+
+                const unsigned mask = static_cast<unsigned>( _mm_movemask_epi8(m) );
+                if(mask)
+                    return p + countTrailingZeros(mask);
+            }
+#endif
+
+            for( ; p != e; ++p)
+            {
+                if( isDelimiter(*p, a, b, c, ctl) )
+                    break;
+            }
+
+            return p;
+        }
+    }
+
+    void HeaderParser::Event::onMethod(const char* method, std::size_t n)
+    {
+        onMethod( std::string(method, n) );
+    }
+
+    void HeaderParser::Event::onUrl(const char* url, std::size_t n)
+    {
+        onUrl( std::string(url, n) );
+    }
+
+    void HeaderParser::Event::onUrlParam(const char* q, std::size_t n)
+    {
+        onUrlParam( std::string(q, n) );
+    }
+
+    void HeaderParser::Event::onKey(const char* key, std::size_t n)
+    {
+        onKey( std::string(key, n) );
+    }
+
+    void HeaderParser::Event::onValue(const char* value, std::size_t n)
+    {
+        onValue( std::string(value, n) );
+    }
+
+    void HeaderParser::Event::onHttpReturn(unsigned ret, const char* text, std::size_t n)
+    {
+        onHttpReturn( ret, std::string(text, n) );
     }
 
     void HeaderParser::Event::onMethod(const std::string& method)
@@ -110,36 +235,161 @@ namespace Http {
 
     void HeaderParser::MessageHeaderEvent::onKey(const std::string& key)
     {
-        strncpy(_key, key.c_str(), MaxKeySize);
+        onKey( key.data(), key.size() );
     }
 
     void HeaderParser::MessageHeaderEvent::onValue(const std::string& value)
     {
-        _header->add(_key, value.c_str());
+        onValue( value.data(), value.size() );
+    }
+
+    void HeaderParser::MessageHeaderEvent::onKey(const char* key, std::size_t n)
+    {
+        if(n >= MaxKeySize)
+            n = MaxKeySize - 1;
+
+        memcpy(_key, key, n);
+        _key[n] = '\0';
+    }
+
+    void HeaderParser::MessageHeaderEvent::onValue(const char* value, std::size_t n)
+    {
+        _header->add(_key, strlen(_key), value, n);
     }
 
     void HeaderParser::advance(std::streambuf& sb)
     {
-        std::streamsize avail = sb.in_avail();
-        
-        if(avail < 0)
+        if(sb.in_avail() < 0)
         {
             state = &HeaderParser::state_error;
+            return;
         }
 
-        while(avail > 0)
+        // parse the get area in place, if the buffer allows to access it
+        BasicStreamBuffer<char>* buf = dynamic_cast<BasicStreamBuffer<char>*>(&sb);
+
+        while( ! end() )
+        {
+            std::size_t n = 0;
+            const char* data = buf ? buf->sview(n) : 0;
+
+            if(n > 0)
+            {
+                buf->sskip( parse(data, n) );
+                continue;
+            }
+
+            if(sb.in_avail() <= 0)
+                break;
+
+            parse( std::char_traits<char>::to_char_type( sb.sbumpc() ) );
+        }
+    }
+
+    std::size_t HeaderParser::parse(const char* data, std::size_t n)
+    {
+        const char* p = data;
+        const char* const e = data + n;
+
+        while(p != e && ! end())
         {
-            if( parse(sb.sbumpc()) )
+            // skip runs of ordinary characters in long tokens
+            if(state == &HeaderParser::state_hfieldbody)
+            {
+                const char* d = findDelimiter(p, e, '\r', '\n', '\n', false);
+                appendToken(p, d);
+                p = d;
+            }
+            else if(state == &HeaderParser::state_hfieldname)
+            {
+                const char* d = findDelimiter(p, e, ':', ':', ':', true);
+                appendToken(p, d);
+                p = d;
+            }
+            else if(state == &HeaderParser::state_url)
+            {
+                const char* d = findDelimiter(p, e, '?', '+', '%', true);
+                appendToken(p, d);
+                p = d;
+            }
+            else if(state == &HeaderParser::state_qparam)
+            {
+                const char* d = findDelimiter(p, e, ' ', '\t', '\t', false);
+                appendToken(p, d);
+                p = d;
+            }
+
+            if(p == e)
                 break;
+
+            _pos = p;
+            (this->*state)(*p++);
+        }
+
+        // the buffer might be modified before the next call
+        copyToken();
+        _pos = 0;
+
+        return p - data;
+    }
+
+    void HeaderParser::clearToken()
+    {
+        token.clear();
+        _tbegin = _tend = 0;
+    }
+
+    void HeaderParser::beginToken(char ch)
+    {
+        clearToken();
+        appendToken(ch);
+    }
+
+    void HeaderParser::appendToken(char ch)
+    {
+        if(_pos)
+            appendToken(_pos, _pos + 1);
+        else
+            token += ch;
+    }
+
+    void HeaderParser::appendToken(const char* begin, const char* end)
+    {
+        if(begin == end)
+            return;
+
+        // extend the view, if the characters follow the token
+        if(_tbegin && _tend == begin)
+        {
+            _tend = end;
+            return;
         }
-   }
+
+        if( ! _tbegin && token.empty() )
+        {
+            _tbegin = begin;
+            _tend = end;
+            return;
+        }
+
+        copyToken();
+        token.append(begin, end);
+    }
+
+    void HeaderParser::copyToken()
+    {
+        if(_tbegin)
+        {
+            token.assign(_tbegin, _tend);
+            _tbegin = _tend = 0;
+        }
+    }
 
     void HeaderParser::state_cmd0(char ch)
     {
         if (istokenchar(ch))
         {
-            token.reserve(32);
-            token = ch;
+            beginToken(ch);
             state = &HeaderParser::state_cmd;
             return;
         }
@@ -151,6 +401,7 @@ namespace Http {
         }
         else
         {
+            clearToken();
             state = &HeaderParser::state_cmd;
             return;
         }
@@ -160,13 +411,12 @@ namespace Http {
     {
         if (istokenchar(ch))
         {
-            token += ch;
+            appendToken(ch);
             return;
         }
         else if (ch == ' ')
         {
-            log_debug("method=" << token);
-            ev.onMethod(token);
+            ev.onMethod(tokenData(), tokenSize());
             state = &HeaderParser::state_url0;
             return;
         }
@@ -186,8 +436,7 @@ namespace Http {
         }
         else if (ch > ' ')
         {
-            token.reserve(32);
-            token = ch;
+            beginToken(ch);
             state = &HeaderParser::state_url;
             return;
         }
@@ -203,36 +452,34 @@ namespace Http {
     {
         if (ch == '?')
         {
-            log_debug("url=" << token);
-            ev.onUrl(token);
-            token.clear();
-            token.reserve(32);
+            ev.onUrl(tokenData(), tokenSize());
+            clearToken();
             state = &HeaderParser::state_qparam;
             return;
         }
         else if (ch == ' ' || ch == '\t')
         {
-            log_debug("url=" << token);
-            ev.onUrl(token);
-            token.clear();
-            token.reserve(32);
+            ev.onUrl(tokenData(), tokenSize());
+            clearToken();
             state = &HeaderParser::state_protocol0;
             return;
         }
         else if (ch == '+')
         {
+            copyToken();
             token += ' ';
             return;
         }
         else if (ch == '%')
         {
+            copyToken();
             token += ch;
             state = &HeaderParser::state_urlesc;
             return;
         }
         else if (ch > ' ')
         {
-            token += ch;
+            appendToken(ch);
             return;
         }
         else
@@ -273,16 +520,14 @@ namespace Http {
     {
         if (ch == ' ' || ch == '\t')
         {
-            log_debug("queryString=" << token);
-            ev.onUrlParam(token);
-            token.clear();
-            token.reserve(32);
+            ev.onUrlParam(tokenData(), tokenSize());
+            clearToken();
             state = &HeaderParser::state_protocol0;
             return;
         }
         else
         {
-            token += ch;
+            appendToken(ch);
             return;
         }
     }
@@ -442,8 +687,7 @@ namespace Http {
         }
         else if (ch > 32 && ch < 127)
         {
-            token.reserve(32);
-            token = ch;
+            beginToken(ch);
             state = &HeaderParser::state_hfieldname;
             return;
         }
@@ -486,19 +730,21 @@ namespace Http {
     {
         if (ch == ':')
         {
-            ev.onKey(token);
+            ev.onKey(tokenData(), tokenSize());
+            clearToken();
             state = &HeaderParser::state_hfieldbody0;
             return;
         }
         else if (ch == ' ' || ch == '\t')
         {
-            ev.onKey(token);
+            ev.onKey(tokenData(), tokenSize());
+            clearToken();
             state = &HeaderParser::state_hfieldnamespace;
             return;
         }
         else if (ch > 32 && ch < 127)
         {
-            token += ch;
+            appendToken(ch);
             return;
         }
         else
@@ -546,8 +792,7 @@ namespace Http {
         }
         else if (!std::isspace(ch))
         {
-            token.reserve(32);
-            token = ch;
+            beginToken(ch);
             state = &HeaderParser::state_hfieldbody;
             return;
         }
@@ -567,7 +812,7 @@ namespace Http {
         }
         else
         {
-            token += ch;
+            appendToken(ch);
             return;
         }
     }
@@ -592,28 +837,31 @@ namespace Http {
     {
         if (ch == '\r')
         {
-            ev.onValue(token);
+            ev.onValue(tokenData(), tokenSize());
+            clearToken();
             state = &HeaderParser::state_hend_cr;
             return;
         }
         else if (ch == '\n')
         {
-            ev.onValue(token);
+            ev.onValue(tokenData(), tokenSize());
+            clearToken();
             ev.onEnd();
             state = &HeaderParser::state_end;
             return;
         }
         else if (ch == ' ' || ch == '\t')
         {
+            // folded field value
+            copyToken();
             token += ch;
             state = &HeaderParser::state_hfieldbody;
             return;
         }
         else if (ch > 32 && ch < 127)
         {
-            ev.onValue(token);
-            token.reserve(32);
-            token = ch;
+            ev.onValue(tokenData(), tokenSize());
+            beginToken(ch);
             state = &HeaderParser::state_hfieldname;
             return;
         }
@@ -798,8 +1046,7 @@ namespace Http {
         }
         else if (ch == ' ' || ch == '\t')
         {
-            token.clear();
-            token.reserve(32);
+            clearToken();
             state = &HeaderParser::state_cl_httpresulttext;
         }
     }
@@ -808,23 +1055,25 @@ namespace Http {
     {
         if (ch == '\r')
         {
-            ev.onHttpReturn(value, token);
+            ev.onHttpReturn(value, tokenData(), tokenSize());
+            clearToken();
             state = &HeaderParser::state_cl_httpresult_cr;
             return;
         }
         else if (ch == '\n')
         {
-            ev.onHttpReturn(value, token);
+            ev.onHttpReturn(value, tokenData(), tokenSize());
+            clearToken();
             state = &HeaderParser::state_h0;
             return;
         }
-        else if (token.empty() && (ch == ' ' || ch == '\t'))
+        else if (tokenSize() == 0 && (ch == ' ' || ch == '\t'))
         {
             return;
         }
         else
         {
-            token += ch;
+            appendToken(ch);
             return;
         }
     }
@@ -38,9 +38,24 @@ namespace Pt {
 
 namespace Http {
 
+/** @internal @brief Parses HTTP message headers.
+
+    The parser is a state machine, which can be fed one character at a
+    time or a whole buffer at once. When a buffer is parsed, runs of
+    ordinary characters in the URL, field names and field values are
+    skipped with SIMD scans for the delimiters and the tokens are reported
+    as views into the buffer. Tokens are only copied, if they span two
+    buffers or need to be decoded.
+*/
 class PT_HTTP_API HeaderParser
 {
     public:
+        /** @brief Receives the parsed tokens.
+
+            The overloads taking a pointer and a size receive views into the
+            parsed buffer, which are only valid during the call. By default,
+            they forward to the overloads taking a string.
+        */
         class PT_HTTP_API Event
         {
             public:
@@ -53,6 +68,13 @@ class PT_HTTP_API HeaderParser
                 virtual void onValue(const std::string& value);
                 virtual void onHttpReturn(unsigned ret, const std::string& text);
                 virtual void onEnd();
+
+                virtual void onMethod(const char* method, std::size_t n);
+                virtual void onUrl(const char* url, std::size_t n);
+                virtual void onUrlParam(const char* q, std::size_t n);
+                virtual void onKey(const char* key, std::size_t n);
+                virtual void onValue(const char* value, std::size_t n);
+                virtual void onHttpReturn(unsigned ret, const char* text, std::size_t n);
         };
 
         class PT_HTTP_API MessageHeaderEvent : public Event
@@ -76,6 +98,8 @@ class PT_HTTP_API HeaderParser
                 virtual void onHttpVersion(unsigned major, unsigned minor);
                 virtual void onKey(const std::string& key);
                 virtual void onValue(const std::string& value);
+                virtual void onKey(const char* key, std::size_t n);
+                virtual void onValue(const char* value, std::size_t n);
         };
 
     private:
@@ -118,16 +142,36 @@ class PT_HTTP_API HeaderParser
         void state_end(char ch);
         void state_error(char ch);
 
+        void clearToken();
+        void beginToken(char ch);
+        void appendToken(char ch);
+        void appendToken(const char* begin, const char* end);
+        void copyToken();
+
+        const char* tokenData() const
+        { return _tbegin ? _tbegin : token.data(); }
+
+        std::size_t tokenSize() const
+        { return _tbegin ? _tend - _tbegin : token.size(); }
+
         state_type state;
         Event& ev;
 
         std::string token;
         unsigned value;
 
+        // current character and token view, if a buffer is parsed
+        const char* _pos;
+        const char* _tbegin;
+        const char* _tend;
+
     public:
         HeaderParser(Event& ev_, bool client)
             : state(client ? &HeaderParser::state_cl_protocol0 : &HeaderParser::state_cmd0),
-              ev(ev_)
+              ev(ev_),
+              _pos(0),
+              _tbegin(0),
+              _tend(0)
             { }
 
         /// parse as many characters as available in buffer without blocking
@@ -143,6 +187,9 @@ class PT_HTTP_API HeaderParser
             return state == &HeaderParser::state_end || state == &HeaderParser::state_error;
         }
 
+        /// parses a buffer until the message is finished and returns the number of characters used
+        std::size_t parse(const char* data, std::size_t n);
+
         bool begin() const  { return state == &HeaderParser::state_cl_protocol0
                                 || state == &HeaderParser::state_cmd0; }
 
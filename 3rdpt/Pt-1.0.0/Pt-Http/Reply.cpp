@@ -28,6 +28,7 @@
 
 #include "Connection.h"
 #include <Pt/Http/Reply.h>
+#include <Pt/System/FileDevice.h>
 #include <cassert>
 
 namespace Pt {
@@ -68,7 +69,17 @@ void Reply::beginSend(bool finish)
 MessageProgress Reply::endSend()
 { 
     setSending(false);
-    return connection().endSendReply(); 
+    return connection().endSendReply(*this); 
+}
+
+
+void Reply::setFile(System::FileDevice& file)
+{
+    System::FileDevice::pos_type pos = file.position();
+    System::FileDevice::pos_type end = file.seek(0, std::ios::end);
+    file.seek(pos, std::ios::beg);
+
+    setFile(file, static_cast<Pt::uint64_t>(pos), static_cast<Pt::uint64_t>(end - pos));
 }
 
 
@@ -76,6 +87,9 @@ void Reply::clear()
 {
     _statusCode = 200;
     _statusText = "OK";
+    _file = 0;
+    _fileOffset = 0;
+    _fileSize = 0;
     Message::header().clear();
     Message::body().clear();
     Message::discard();
@@ -30,10 +30,51 @@
 #include <Pt/Http/Request.h>
 #include <cassert>
 
+namespace {
+
+const std::string emptyParam;
+
+}
+
 namespace Pt {
 
 namespace Http {
 
+const std::string& Request::pathParam(const std::string& name) const
+{
+    std::vector< std::pair<std::string, std::string> >::const_iterator it;
+    for(it = _pathParams.begin(); it != _pathParams.end(); ++it)
+    {
+        if(it->first == name)
+            return it->second;
+    }
+
+    return emptyParam;
+}
+
+
+void Request::setPathParam(const std::string& name, const std::string& value)
+{
+    setPathParam(name, value.data(), value.size());
+}
+
+
+void Request::setPathParam(const std::string& name, const char* value, std::size_t n)
+{
+    std::vector< std::pair<std::string, std::string> >::iterator it;
+    for(it = _pathParams.begin(); it != _pathParams.end(); ++it)
+    {
+        if(it->first == name)
+        {
+            it->second.assign(value, n);
+            return;
+        }
+    }
+
+    _pathParams.push_back( std::make_pair(name, std::string(value, n)) );
+}
+
+
 void Request::beginReceive()
 { 
     setReceiving(true);
@@ -53,7 +94,7 @@ void Request::send(bool finish)
 MessageProgress Request::endReceive()
 { 
     setReceiving(false);
-    return connection().endReceiveRequest(); 
+    return connection().endReceiveRequest(*this); 
 }
 
 
@@ -77,6 +118,7 @@ void Request::clear()
 {
     _method = "GET";
     _qparams.clear();
+    _pathParams.clear();
     Message::header().clear();
     Message::body().clear();
     Message::discard();
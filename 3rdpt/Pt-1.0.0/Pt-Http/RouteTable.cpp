@@ -0,0 +1,584 @@
+/*
+ * Copyright (C) 2005-2013 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RouteTable.h"
+#include <Pt/Http/Servlet.h>
+#include <Pt/Http/Request.h>
+#include <stdexcept>
+#include <algorithm>
+#include <typeinfo>
+#include <cstring>
+
+namespace {
+
+const std::size_t npos = static_cast<std::size_t>(-1);
+
+enum SegmentType
+{
+    Literal,
+    Parameter,
+    Wildcard
+};
+
+
+SegmentType segmentType(const std::string& segment)
+{
+    if(segment == "*")
+        return Wildcard;
+
+    if(segment.size() >= 2 && segment[0] == '{' && segment[segment.size() - 1] == '}')
+        return Parameter;
+
+    return Literal;
+}
+
+
+// The segments of a path are separated by slashes. The leading slash does
+// not start a segment, so "/a/b" has the segments "a" and "b", and "/a/"
+// has the segments "a" and "".
+void splitPath(const std::string& path, std::vector<std::string>& segments)
+{
+    std::string::size_type pos = 1;
+
+    while(true)
+    {
+        std::string::size_type slash = path.find('/', pos);
+        if(slash == std::string::npos)
+        {
+            segments.push_back( path.substr(pos) );
+            return;
+        }
+
+        segments.push_back( path.substr(pos, slash - pos) );
+        pos = slash + 1;
+    }
+}
+
+
+bool isPattern(const std::vector<std::string>& segments)
+{
+    for(std::size_t n = 0; n < segments.size(); ++n)
+    {
+        if(segmentType(segments[n]) != Literal)
+            return true;
+    }
+
+    return false;
+}
+
+
+// FNV-1a
+Pt::uint32_t hashPath(const char* s, std::size_t n)
+{
+    Pt::uint32_t h = 2166136261u;
+
+    for(std::size_t i = 0; i < n; ++i)
+    {
+        h ^= static_cast<unsigned char>(s[i]);
+        h *= 16777619u;
+    }
+
+    return h;
+}
+
+
+bool compareSegment(const std::string& segment, const char* s, std::size_t n)
+{
+    return segment.size() == n && std::memcmp(segment.data(), s, n) == 0;
+}
+
+} // namespace
+
+
+namespace Pt {
+
+namespace Http {
+
+RouteTable::Node::Node()
+: param(0)
+, minOrder(npos)
+{
+}
+
+
+RouteTable::Node::~Node()
+{
+    for(std::size_t n = 0; n < children.size(); ++n)
+        delete children[n].second;
+
+    delete param;
+}
+
+
+RouteTable::RouteTable()
+: _root(0)
+, _count(0)
+{
+}
+
+
+RouteTable::~RouteTable()
+{
+    delete _root;
+}
+
+
+void RouteTable::addServlet(Servlet& servlet)
+{
+    std::size_t order = _count++;
+
+    if( ! isRouted(servlet) )
+    {
+        _fallbacks.push_back( std::make_pair(&servlet, order) );
+        return;
+    }
+
+    addRoute(servlet, order);
+}
+
+
+bool RouteTable::isRouted(const Servlet& servlet)
+{
+    if(servlet._routeType == Servlet::NoRoute)
+        return false;
+
+    // MapUrl and MapRoute set their route in the constructor, but a
+    // derived class might override onRequest(), so it is asked instead
+    if( dynamic_cast<const MapUrl*>(&servlet) )
+        return typeid(servlet) == typeid(MapUrl);
+
+    if( dynamic_cast<const MapRoute*>(&servlet) )
+        return typeid(servlet) == typeid(MapRoute);
+
+    return true;
+}
+
+
+void RouteTable::addRoute(Servlet& servlet, std::size_t order)
+{
+    Entry entry;
+    entry.servlet = &servlet;
+    entry.order = order;
+    entry.method = servlet._routeMethod;
+
+    std::vector<std::string> segments;
+    if(servlet._routeType == Servlet::PatternRoute)
+        splitPath(servlet._route, segments);
+
+    // URLs and patterns without parameters are looked up by their hash
+    if( ! isPattern(segments) )
+    {
+        std::vector<Path>::iterator it;
+        for(it = _paths.begin(); it != _paths.end(); ++it)
+        {
+            if(it->path == servlet._route)
+                break;
+        }
+
+        if(it == _paths.end())
+        {
+            _paths.push_back( Path() );
+            it = _paths.end() - 1;
+            it->path = servlet._route;
+        }
+
+        it->entries.push_back(entry);
+        return;
+    }
+
+    if( ! _root)
+        _root = new Node;
+
+    Node* node = _root;
+
+    for(std::size_t n = 0; n < segments.size(); ++n)
+    {
+        const std::string& segment = segments[n];
+
+        switch( segmentType(segment) )
+        {
+            case Wildcard:
+                entry.params.push_back("*");
+                node->wildcards.push_back(entry);
+                return;
+
+            case Parameter:
+                entry.params.push_back( segment.substr(1, segment.size() - 2) );
+                if( ! node->param)
+                    node->param = new Node;
+
+                node = node->param;
+                break;
+
+            case Literal:
+                node = insertChild(node, segment);
+                break;
+        }
+    }
+
+    node->entries.push_back(entry);
+}
+
+
+RouteTable::Node* RouteTable::insertChild(Node* node, const std::string& segment)
+{
+    std::vector< std::pair<std::string, Node*> >::iterator it;
+    for(it = node->children.begin(); it != node->children.end(); ++it)
+    {
+        if(it->first == segment)
+            return it->second;
+
+        if(segment < it->first)
+            break;
+    }
+
+    Node* child = new Node;
+    node->children.insert(it, std::make_pair(segment, child));
+    return child;
+}
+
+
+const RouteTable::Node* RouteTable::findChild(const Node* node, const char* segment, std::size_t n)
+{
+    // the children are sorted by their segment
+    std::size_t lo = 0;
+    std::size_t hi = node->children.size();
+
+    while(lo < hi)
+    {
+        std::size_t mid = (lo + hi) / 2;
+        const std::string& s = node->children[mid].first;
+
+        int cmp = s.compare(0, std::string::npos, segment, n);
+        if(cmp == 0)
+            return node->children[mid].second;
+
+        if(cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return 0;
+}
+
+
+std::size_t RouteTable::updateOrder(Node* node)
+{
+    std::size_t order = npos;
+
+    if( ! node->entries.empty() )
+        order = node->entries.front().order;
+
+    if( ! node->wildcards.empty() )
+        order = std::min(order, node->wildcards.front().order);
+
+    for(std::size_t n = 0; n < node->children.size(); ++n)
+        order = std::min(order, updateOrder(node->children[n].second));
+
+    if(node->param)
+        order = std::min(order, updateOrder(node->param));
+
+    node->minOrder = order;
+    return order;
+}
+
+
+void RouteTable::commit()
+{
+    if(_root)
+        updateOrder(_root);
+
+    // the hash index is at most half full
+    std::size_t size = 8;
+    while(size < _paths.size() * 2)
+        size *= 2;
+
+    Slot empty;
+    empty.hash = 0;
+    empty.index = npos;
+
+    _slots.assign(size, empty);
+
+    for(std::size_t n = 0; n < _paths.size(); ++n)
+    {
+        const std::string& path = _paths[n].path;
+        Pt::uint32_t h = hashPath(path.data(), path.size());
+
+        std::size_t i = h & (size - 1);
+        while(_slots[i].index != npos)
+            i = (i + 1) & (size - 1);
+
+        _slots[i].hash = h;
+        _slots[i].index = n;
+    }
+}
+
+
+const RouteTable::Path* RouteTable::findPath(const std::string& path) const
+{
+    if( _slots.empty() )
+        return 0;
+
+    const std::size_t mask = _slots.size() - 1;
+    const Pt::uint32_t h = hashPath(path.data(), path.size());
+
+    for(std::size_t i = h & mask; _slots[i].index != npos; i = (i + 1) & mask)
+    {
+        const Path& p = _paths[ _slots[i].index ];
+
+        if(_slots[i].hash == h && p.path == path)
+            return &p;
+    }
+
+    return 0;
+}
+
+
+const RouteTable::Entry* RouteTable::select(const std::vector<Entry>& entries,
+                                            const std::string& method)
+{
+    for(std::size_t n = 0; n < entries.size(); ++n)
+    {
+        if(entries[n].method.empty() || entries[n].method == method)
+            return &entries[n];
+    }
+
+    return 0;
+}
+
+
+void RouteTable::findNode(const Node* node, const char* p, const char* end, bool done,
+                          const std::string& method, Capture* captures,
+                          std::size_t ncaptures, Match& best) const
+{
+    // routes, which were added later than the best match, are skipped
+    std::size_t bestOrder = best.entry ? best.entry->order : npos;
+    if(node->minOrder >= bestOrder)
+        return;
+
+    // a trailing "*" matches the rest of the path
+    if( ! node->wildcards.empty() )
+    {
+        const Entry* e = select(node->wildcards, method);
+        if(e && e->order < bestOrder)
+        {
+            best.entry = e;
+            std::copy(captures, captures + ncaptures, best.captures);
+            best.captures[ncaptures].data = p;
+            best.captures[ncaptures].size = static_cast<std::size_t>(end - p);
+            bestOrder = e->order;
+        }
+    }
+
+    if(done)
+    {
+        const Entry* e = select(node->entries, method);
+        if(e && e->order < bestOrder)
+        {
+            best.entry = e;
+            std::copy(captures, captures + ncaptures, best.captures);
+        }
+
+        return;
+    }
+
+    const char* q = p;
+    while(q != end && *q != '/')
+        ++q;
+
+    const std::size_t n = static_cast<std::size_t>(q - p);
+    const bool last = (q == end);
+    const char* next = last ? end : q + 1;
+
+    const Node* child = findChild(node, p, n);
+    if(child)
+        findNode(child, next, end, last, method, captures, ncaptures, best);
+
+    // parameters do not match empty segments
+    if(node->param && n > 0 && ncaptures < MaxParams)
+    {
+        captures[ncaptures].data = p;
+        captures[ncaptures].size = n;
+        findNode(node->param, next, end, last, method, captures, ncaptures + 1, best);
+    }
+}
+
+
+Servlet* RouteTable::findServlet(const Request& request, Match& best) const
+{
+    const std::string& url = request.url();
+    const std::string& method = request.method();
+
+    best.entry = 0;
+
+    const Path* path = findPath(url);
+    if(path)
+        best.entry = select(path->entries, method);
+
+    if(_root && ! url.empty() && url[0] == '/')
+    {
+        Capture captures[MaxParams + 1];
+        const char* begin = url.data() + 1;
+        const char* end = url.data() + url.size();
+
+        findNode(_root, begin, end, false, method, captures, 0, best);
+    }
+
+    // servlets without a route are asked, if they were added before
+    // the servlet of the best route
+    const std::size_t order = best.entry ? best.entry->order : npos;
+
+    std::vector< std::pair<Servlet*, std::size_t> >::const_iterator it;
+    for(it = _fallbacks.begin(); it != _fallbacks.end() && it->second < order; ++it)
+    {
+        if( it->first->isMapped(request) )
+        {
+            best.entry = 0;
+            return it->first;
+        }
+    }
+
+    return best.entry ? best.entry->servlet : 0;
+}
+
+
+Servlet* RouteTable::find(Request& request) const
+{
+    Match best;
+    Servlet* servlet = findServlet(request, best);
+
+    if(best.entry)
+    {
+        const std::vector<std::string>& params = best.entry->params;
+        for(std::size_t n = 0; n < params.size(); ++n)
+        {
+            request.setPathParam(params[n], best.captures[n].data, best.captures[n].size);
+        }
+    }
+
+    return servlet;
+}
+
+
+Servlet* RouteTable::find(const Request& request) const
+{
+    Match best;
+    return findServlet(request, best);
+}
+
+
+bool RouteTable::matches(const std::string& pattern, const std::string& path)
+{
+    if(path.empty() || path[0] != '/')
+        return false;
+
+    std::vector<std::string> segments;
+    splitPath(pattern, segments);
+
+    const char* p = path.data() + 1;
+    const char* end = path.data() + path.size();
+    bool done = false;
+
+    for(std::size_t n = 0; n < segments.size(); ++n)
+    {
+        const SegmentType type = segmentType(segments[n]);
+
+        if(type == Wildcard)
+            return true;
+
+        if(done)
+            return false;
+
+        const char* q = p;
+        while(q != end && *q != '/')
+            ++q;
+
+        if(type == Parameter)
+        {
+            if(q == p)
+                return false;
+        }
+        else if( ! compareSegment(segments[n], p, static_cast<std::size_t>(q - p)) )
+        {
+            return false;
+        }
+
+        done = (q == end);
+        p = done ? end : q + 1;
+    }
+
+    return done;
+}
+
+
+void RouteTable::validate(const std::string& pattern)
+{
+    if(pattern.empty() || pattern[0] != '/')
+        throw std::invalid_argument("route must begin with a slash");
+
+    std::vector<std::string> segments;
+    splitPath(pattern, segments);
+
+    std::size_t params = 0;
+
+    for(std::size_t n = 0; n < segments.size(); ++n)
+    {
+        const std::string& segment = segments[n];
+
+        switch( segmentType(segment) )
+        {
+            case Wildcard:
+                if(n + 1 != segments.size())
+                    throw std::invalid_argument("route wildcard must be the last segment");
+
+                ++params;
+                break;
+
+            case Parameter:
+                if(segment.size() < 3 || segment.find_first_of("{}", 1) != segment.size() - 1)
+                    throw std::invalid_argument("invalid route parameter");
+
+                ++params;
+                break;
+
+            case Literal:
+                if(segment.find_first_of("{}*") != std::string::npos)
+                    throw std::invalid_argument("invalid route segment");
+
+                break;
+        }
+    }
+
+    if(params > MaxParams)
+        throw std::invalid_argument("too many route parameters");
+}
+
+} // namespace Http
+
+} // namespace Pt
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2005-2013 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef Pt_Http_RouteTable_h
+#define Pt_Http_RouteTable_h
+
+#include <Pt/Http/Api.h>
+#include <Pt/NonCopyable.h>
+#include <Pt/Types.h>
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+namespace Pt {
+
+namespace Http {
+
+class Request;
+class Servlet;
+
+/** @internal @brief Routing table of the servlets of a server.
+
+    Servlets with a route are found by their URL path instead of asking
+    each servlet if it wants to process the request. Routes without
+    parameters are kept in a hash index of the complete path. Routes with
+    parameters, such as "/player/{id}/inventory", or with a trailing "*",
+    which matches the rest of the path, are kept in a trie of the path
+    segments. Servlets without a route, and classes derived from MapUrl
+    or MapRoute, are matched by Servlet::isMapped().
+
+    If several servlets match a request, the one which was added first
+    is selected, as if all servlets were tested in order. The table is
+    not modified after it was built, so it can be used by many threads
+    at the same time.
+*/
+class RouteTable : private NonCopyable
+{
+    public:
+        //! @brief Maximum number of parameters of a route.
+        static const std::size_t MaxParams = 16;
+
+    public:
+        RouteTable();
+
+        ~RouteTable();
+
+        /** @brief Adds a servlet.
+
+            The servlet is added with its route, if it has one. The
+            servlets must be added in the order in which they are tried.
+        */
+        void addServlet(Servlet& servlet);
+
+        //! @brief Builds the hash index, after all servlets were added.
+        void commit();
+
+        /** @brief Returns the servlet for a request.
+
+            The parameters of the route of the selected servlet are set
+            in the request. Null is returned if no servlet is found.
+        */
+        Servlet* find(Request& request) const;
+
+        //! @brief Returns the servlet for a request without setting parameters.
+        Servlet* find(const Request& request) const;
+
+        //! @brief Returns true, if a path is matched by a route pattern.
+        static bool matches(const std::string& pattern, const std::string& path);
+
+        //! @brief Throws std::invalid_argument, if a route pattern is malformed.
+        static void validate(const std::string& pattern);
+
+    private:
+        struct Entry
+        {
+            Servlet* servlet;
+            std::size_t order;
+            std::string method;
+            std::vector<std::string> params;
+        };
+
+        struct Node
+        {
+            Node();
+
+            ~Node();
+
+            std::vector< std::pair<std::string, Node*> > children;
+            Node* param;
+            std::vector<Entry> entries;
+            std::vector<Entry> wildcards;
+            std::size_t minOrder;
+        };
+
+        struct Path
+        {
+            std::string path;
+            std::vector<Entry> entries;
+        };
+
+        struct Slot
+        {
+            Pt::uint32_t hash;
+            std::size_t index;
+        };
+
+        struct Capture
+        {
+            const char* data;
+            std::size_t size;
+        };
+
+        struct Match
+        {
+            const Entry* entry;
+            Capture captures[MaxParams + 1];
+        };
+
+        static bool isRouted(const Servlet& servlet);
+
+        void addRoute(Servlet& servlet, std::size_t order);
+
+        static Node* insertChild(Node* node, const std::string& segment);
+
+        static const Node* findChild(const Node* node, const char* segment, std::size_t n);
+
+        static std::size_t updateOrder(Node* node);
+
+        Servlet* findServlet(const Request& request, Match& best) const;
+
+        const Path* findPath(const std::string& path) const;
+
+        void findNode(const Node* node, const char* p, const char* end, bool done,
+                      const std::string& method, Capture* captures,
+                      std::size_t ncaptures, Match& best) const;
+
+        static const Entry* select(const std::vector<Entry>& entries,
+                                   const std::string& method);
+
+    private:
+        std::vector<Path> _paths;
+        std::vector<Slot> _slots;
+        Node* _root;
+        std::vector< std::pair<Servlet*, std::size_t> > _fallbacks;
+        std::size_t _count;
+};
+
+} // namespace Http
+
+} // namespace Pt
+
+#endif // Pt_Http_RouteTable_h
@@ -138,6 +138,54 @@ void Server::setMaxRequestSize(std::size_t maxSize)
 }
 
 
+std::size_t Server::maxHeaderSize() const
+{
+    return _impl->maxHeaderSize();
+}
+
+
+void Server::setMaxHeaderSize(std::size_t maxSize)
+{
+    _impl->setMaxHeaderSize(maxSize);
+}
+
+
+std::size_t Server::maxPipelined() const
+{
+    return _impl->maxPipelined();
+}
+
+
+void Server::setMaxPipelined(std::size_t n)
+{
+    _impl->setMaxPipelined(n);
+}
+
+
+bool Server::noDelay() const
+{
+    return _impl->noDelay();
+}
+
+
+void Server::setNoDelay(bool noDelay)
+{
+    _impl->setNoDelay(noDelay);
+}
+
+
+std::size_t Server::maxConcurrentStreams() const
+{
+    return _impl->maxConcurrentStreams();
+}
+
+
+void Server::setMaxConcurrentStreams(std::size_t n)
+{
+    _impl->setMaxConcurrentStreams(n);
+}
+
+
 void Server::listen(const Pt::Net::Endpoint& ep)
 {
     Net::TcpServerOptions opts;
@@ -34,6 +34,7 @@
 #include <Pt/Http/Authorizer.h>
 #include <Pt/Http/HttpError.h>
 #include <Pt/System/Logger.h>
+#include <Pt/Atomicity.h>
 
 #include <limits>
 #include <memory>
@@ -45,22 +46,22 @@ namespace Pt {
 
 namespace Http {
 
-Acceptor::Acceptor(ServerImpl& server, Net::TcpServer& tcpServer)
-: _server(server)
+Exchange::Exchange(Acceptor& acceptor, ServerImpl& server, Connection& conn)
+: _acceptor(acceptor)
+, _server(server)
+, _conn(conn)
 , _auth(0)
 , _servlet(0)
 , _responder(0)
-, _conn()
-, _request(_conn)
-, _reply(_conn)
+, _request(conn)
+, _reply(conn)
 {
-    _conn.accept(tcpServer);
-    _request.inputReceived() += Pt::slot(*this, &Acceptor::onRequestReceived);
-    _reply.outputSent() += Pt::slot(*this, &Acceptor::onReplySent);
+    _request.inputReceived() += Pt::slot(*this, &Exchange::onRequestReceived);
+    _reply.outputSent() += Pt::slot(*this, &Exchange::onReplySent);
 }
 
 
-Acceptor::~Acceptor()
+Exchange::~Exchange()
 {
     releaseResponder();
     
@@ -73,9 +74,9 @@ Acceptor::~Acceptor()
 }
 
 
-void Acceptor::releaseResponder()
+void Exchange::releaseResponder()
 {
-    log_trace("Acceptor::releaseResponder " << _responder);
+    log_trace("Exchange::releaseResponder " << _responder);
     if( _responder )
     {
         assert(_servlet);
@@ -86,21 +87,26 @@ void Acceptor::releaseResponder()
 }
 
 
-void Acceptor::beginServe(System::EventLoop& loop)
-{  
-    log_trace("Acceptor::beginServe");
+void Exchange::begin()
+{
+    releaseResponder();
 
-    _conn.setActive(loop);
+    if(_auth)
+    {
+        _servlet->authorizer()->cancelAuthorization(_auth);
+        _auth = 0;
+    }
 
+    _servlet = 0;
     _reply.clear();
     _request.clear();
     _request.beginReceive();
 }
 
 
-void Acceptor::onRequestReceived(Request& req)
+void Exchange::onRequestReceived(Request& req)
 {
-    log_trace("Acceptor::onRequestReceived");
+    log_trace("Exchange::onRequestReceived");
     
     try
     {
@@ -130,7 +136,7 @@ void Acceptor::onRequestReceived(Request& req)
                 {
                     log_debug("authorization started");
                     _auth->beginAuthorize(_request, _reply);
-                    _auth->finished() += Pt::slot(*this, &Acceptor::onAuthorization);
+                    _auth->finished() += Pt::slot(*this, &Exchange::onAuthorization);
                     return;
                 }
                 
@@ -154,21 +160,19 @@ void Acceptor::onRequestReceived(Request& req)
     catch(const HttpError& e)
     {
         log_warn("EXCEPTION: " << e.what());
-
-        replyError();
-        _finished.send(*this);
+        _acceptor.abortExchange(*this, true);
     }
     catch(const System::IOError& e)
     {
         log_warn("EXCEPTION: " << e.what());
-        _finished.send(*this);
+        _acceptor.abortExchange(*this, false);
     }
 }
 
 
-void Acceptor::onAuthorization(Authorization& auth)
+void Exchange::onAuthorization(Authorization& auth)
 {
-    log_trace("Acceptor::onAuthorization");
+    log_trace("Exchange::onAuthorization");
 
     try
     {
@@ -192,21 +196,19 @@ void Acceptor::onAuthorization(Authorization& auth)
     catch(const HttpError& e)
     {
         log_warn("EXCEPTION: " << e.what());
-
-        replyError();
-        _finished.send(*this);
+        _acceptor.abortExchange(*this, true);
     }
     catch(const System::IOError& e) 
     {
         log_warn("EXCEPTION: " << e.what());
-        _finished.send(*this);
+        _acceptor.abortExchange(*this, false);
     }
 }
 
 
-void Acceptor::onRequest(MessageProgress progress)
+void Exchange::onRequest(MessageProgress progress)
 {
-    log_trace("Acceptor::onRequest");
+    log_trace("Exchange::onRequest");
 
     if( progress.header() )
     {
@@ -250,7 +252,7 @@ void Acceptor::onRequest(MessageProgress progress)
         if( ! _conn.isConnected() )
         {
             log_debug("not connected anymore");
-            _finished.send(*this);
+            _acceptor.abortExchange(*this, false);
             return;
         }
 
@@ -270,9 +272,9 @@ void Acceptor::onRequest(MessageProgress progress)
 }
 
 
-void Acceptor::onReplySent(Reply& r)
+void Exchange::onReplySent(Reply& r)
 {
-    log_trace("Acceptor::onReplySent");
+    log_trace("Exchange::onReplySent");
 
     try
     {
@@ -297,7 +299,7 @@ void Acceptor::onReplySent(Reply& r)
             if( ! _conn.isConnected() )
             {
                 log_debug("not connected anymore");
-                _finished.send(*this);
+                _acceptor.abortExchange(*this, false);
                 return;
             }
 
@@ -322,12 +324,12 @@ void Acceptor::onReplySent(Reply& r)
     catch(const System::IOError& e) // TODO: HttpError is also an IOError
     {
         log_warn("EXCEPTION: " << e.what());
-        _finished.send(*this);
+        _acceptor.abortExchange(*this, false);
     }
 }
 
 
-void Acceptor::replyError()
+void Exchange::replyError()
 {
     _reply.clear();
 
@@ -342,16 +344,103 @@ void Acceptor::replyError()
 
 
 
-ServerThread::ServerThread()
-: _ssl(false)
-, _thread(_loop)
+Acceptor::Acceptor(ServerImpl& server, Net::TcpServer& tcpServer)
+: _server(server)
+, _conn()
+{
+    _conn.accept(tcpServer);
+    _conn.requestPending() += Pt::slot(*this, &Acceptor::onRequestPending);
+    _conn.sessionFinished() += Pt::slot(*this, &Acceptor::onSessionFinished);
+
+    Exchange* ex = new Exchange(*this, _server, _conn);
+    _exchanges.push_back(ex);
+    _conn.attach(ex->request(), ex->reply());
+}
+
+
+Acceptor::~Acceptor()
+{
+    std::vector<Exchange*>::iterator it;
+    for(it = _exchanges.begin(); it != _exchanges.end(); ++it)
+    {
+        delete *it;
+    }
+}
+
+
+void Acceptor::beginServe(System::EventLoop& loop)
+{  
+    log_trace("Acceptor::beginServe");
+
+    _conn.setActive(loop);
+    _exchanges.front()->begin();
+}
+
+
+bool Acceptor::hasServlet(const Servlet* servlet) const
+{
+    std::vector<Exchange*>::const_iterator it;
+    for(it = _exchanges.begin(); it != _exchanges.end(); ++it)
+    {
+        if( (*it)->servlet() == servlet )
+            return true;
+    }
+
+    return false;
+}
+
+
+void Acceptor::abortExchange(Exchange& ex, bool errorReply)
+{
+    if( _conn.isMultiplexed() && _conn.isConnected() )
+    {
+        log_debug("resetting stream");
+        _conn.resetStream( ex.request() );
+        ex.begin();
+        return;
+    }
+
+    if(errorReply)
+        ex.replyError();
+
+    _finished.send(*this);
+}
+
+
+void Acceptor::onRequestPending(Connection& conn)
+{
+    log_trace("Acceptor::onRequestPending");
+
+    Exchange* ex = new Exchange(*this, _server, _conn);
+    _exchanges.push_back(ex);
+    _conn.attach(ex->request(), ex->reply());
+
+    ex->begin();
+}
+
+
+void Acceptor::onSessionFinished(Connection& conn)
+{
+    log_trace("Acceptor::onSessionFinished");
+    _finished.send(*this);
+}
+
+
+
+
+ServerThread::ServerThread(ServerImpl& server, System::MainLoop& loop)
+: _server(server)
+, _loop(loop)
+, _listening(false)
+, _ssl(false)
 , _isReturned(false)
 , _isServletIdle(false)
 {
     _loop.eventReceived() += Pt::slot(*this, &ServerThread::onAccept);
     _loop.eventReceived() += Pt::slot(*this, &ServerThread::onRemoveServlet);
     _loop.eventReceived() += Pt::slot(*this, &ServerThread::onIsServletIdle);
-    _thread.start();
+    _loop.eventReceived() += Pt::slot(*this, &ServerThread::onSynchronize);
+    _serverSocket.connectionPending() += Pt::slot(*this, &ServerThread::onConnectionPending);
 }
 
 
@@ -366,6 +455,26 @@ void ServerThread::setSecure(Ssl::Context& ctx)
     _sslctx.assign(ctx);
     _ssl = true;
 }
+
+
+bool ServerThread::listen(const Net::Endpoint& ep, const Net::TcpServerOptions& opts)
+{
+    // the loop is not running yet, so the socket can be attached here
+    try
+    {
+        _serverSocket.listen(ep, opts);
+    }
+    catch(const System::IOError& e)
+    {
+        log_debug("worker can not share address: " << e.what());
+        return false;
+    }
+
+    _serverSocket.setActive(_loop);
+    _serverSocket.beginAccept();
+    _listening = true;
+    return true;
+}
         
 
 void ServerThread::serve(Acceptor* conn)
@@ -377,8 +486,9 @@ void ServerThread::serve(Acceptor* conn)
 
 void ServerThread::stop()
 {
-    _loop.exit();
-    _thread.join();
+    // called when the loop has exited
+    _serverSocket.close();
+    _listening = false;
 
     std::vector<Acceptor*>::iterator it;
     for(it = _handlers.begin(); it != _handlers.end(); ++it)
@@ -392,12 +502,14 @@ void ServerThread::stop()
 
 void ServerThread::removeServlet(Servlet& servlet)
 {
-    RemoveServletEvent ev(&servlet);
-    _loop.commitEvent(ev);
-
+    // reset the flag before the event is committed, because the worker
+    // might handle it before the lock is taken
     System::MutexLock lock(_invokeMutex);
     _isReturned = false;
 
+    RemoveServletEvent ev(&servlet);
+    _loop.commitEvent(ev);
+
     while( ! _isReturned)
         _hasReturned.wait(lock);
 }
@@ -405,14 +517,14 @@ void ServerThread::removeServlet(Servlet& servlet)
 
 bool ServerThread::isServletIdle(Servlet& servlet)
 {
-    ServletInfoEvent ev(&servlet);
-    _loop.commitEvent(ev);
-
     System::MutexLock lock(_invokeMutex);
 
     _isServletIdle = false;
     _isReturned = false;
 
+    ServletInfoEvent ev(&servlet);
+    _loop.commitEvent(ev);
+
     while( ! _isReturned)
         _hasReturned.wait(lock);
 
@@ -420,6 +532,19 @@ bool ServerThread::isServletIdle(Servlet& servlet)
 }
 
 
+void ServerThread::synchronize()
+{
+    System::MutexLock lock(_invokeMutex);
+    _isReturned = false;
+
+    SyncEvent ev;
+    _loop.commitEvent(ev);
+
+    while( ! _isReturned)
+        _hasReturned.wait(lock);
+}
+
+
 void ServerThread::onAccept(const AcceptEvent& ev)
 {
     Acceptor* handler = ev.connection();
@@ -440,7 +565,7 @@ void ServerThread::onRemoveServlet(const RemoveServletEvent& ev)
     while( it != _handlers.end() )
     {
         Acceptor* rh = *it;
-        if( rh->servlet() == ev.servlet() )
+        if( rh->hasServlet( ev.servlet() ) )
         {
             delete rh;
             it = _handlers.erase(it);
@@ -462,7 +587,7 @@ void ServerThread::onIsServletIdle(const ServletInfoEvent& ev)
     std::vector<Acceptor*>::iterator it;
     for( it  = _handlers.begin(); it != _handlers.end(); ++it )
     {
-        if( (*it)->servlet() == ev.servlet() )
+        if( (*it)->hasServlet( ev.servlet() ) )
         {
             break;
         }
@@ -475,6 +600,14 @@ void ServerThread::onIsServletIdle(const ServletInfoEvent& ev)
 }
 
 
+void ServerThread::onSynchronize(const SyncEvent& ev)
+{
+    System::MutexLock lock(_invokeMutex);
+    _isReturned = true;
+    _hasReturned.signal();
+}
+
+
 void ServerThread::onHandlerFinished(Acceptor& handler)
 {
     std::vector<Acceptor*>::iterator it;
@@ -490,15 +623,38 @@ void ServerThread::onHandlerFinished(Acceptor& handler)
 }
 
 
+void ServerThread::onConnectionPending(Net::TcpServer& server)
+{
+    log_trace("ServerThread::onConnectionPending");
+
+    try
+    {
+        onAccept( AcceptEvent( _server.createAcceptor(server) ) );
+    }
+    catch(const System::IOError& e)
+    {
+        log_warn("accept failed: " << e.what());
+    }
+
+    _serverSocket.beginAccept();
+}
+
+
 
 
 ServerImpl::ServerImpl()
 : _sslctx(0)
+, _pool(0)
 , _useWorker(0)
 , _maxThreads(1)
 , _timeout(30000)
 , _keepAliveTimeout(30000)
 , _maxRequestSize( std::numeric_limits<std::size_t>::max() )
+, _maxHeaderSize(MessageHeader::DefaultMaxSize)
+, _maxPipelined(Connection::DefaultMaxPipelined)
+, _noDelay(true)
+, _maxStreams(Connection::DefaultMaxStreams)
+, _routes(0)
 {
     _serverSocket.connectionPending() += Pt::slot(*this, &ServerImpl::onAccept);
 }
@@ -512,40 +668,68 @@ ServerImpl::~ServerImpl()
     {
         _servlets.front().servlet()->detach();
     }
+
+    reclaimRoutes();
+    delete static_cast<RouteTable*>(_routes);
 }
 
 
 void ServerImpl::listen(const Pt::Net::Endpoint& addr, const Net::TcpServerOptions& opts)
 {
-    std::vector<ServerThread*>::iterator thread;
-    for(thread = _serverThreads.begin(); thread != _serverThreads.end(); ++thread)
-    {
-        (*thread)->stop();
-        delete *thread;
-    }
-
-    _serverThreads.clear();
+    stopWorkers();
 
     _serverSocket.listen(addr, opts);
     _serverSocket.beginAccept();
 
-    for(std::size_t n = 1; n < _maxThreads; ++n)
+    if(_maxThreads > 1)
     {
-        ServerThread* st = new ServerThread();
+        // the worker loops run like the loop of the server
+        System::MainLoopOptions loopOpts;
+        const System::MainLoop* mainLoop = dynamic_cast<const System::MainLoop*>( this->loop() );
+        if(mainLoop)
+            loopOpts = mainLoop->options();
+
+        // if the address may be shared, the workers listen on the address
+        // the server is bound to, which has the port chosen by the system
+        // if port 0 was requested. Otherwise connections are accepted here 
+        // and passed to the workers
+        Net::Endpoint boundAddr;
+        if( opts.reusePort() )
+            _serverSocket.localEndpoint(boundAddr);
+
+        try
+        {
+            _pool = new System::EventLoopPool(_maxThreads - 1, loopOpts);
 
-        if(_sslctx)
-            st->setSecure(*_sslctx);
+            for(std::size_t n = 0; n < _pool->size(); ++n)
+            {
+                ServerThread* st = new ServerThread(*this, _pool->loop(n));
+                _serverThreads.push_back(st);
+
+                if(_sslctx)
+                    st->setSecure(*_sslctx);
+
+                if( opts.reusePort() )
+                    st->listen(boundAddr, opts);
+            }
 
-        _serverThreads.push_back(st);
+            _pool->start();
+        }
+        catch(...)
+        {
+            stopWorkers();
+            throw;
+        }
     }
 
     _useWorker = _serverThreads.size();
 }
 
 
-void ServerImpl::cancel()
+void ServerImpl::stopWorkers()
 {
-    _serverSocket.cancel();
+    if(_pool)
+        _pool->stop();
 
     std::vector<ServerThread*>::iterator threadIt;
     for(threadIt = _serverThreads.begin(); threadIt != _serverThreads.end(); ++threadIt)
@@ -556,6 +740,83 @@ void ServerImpl::cancel()
 
     _serverThreads.clear();
 
+    delete _pool;
+    _pool = 0;
+
+    reclaimRoutes();
+}
+
+
+void ServerImpl::publishRoutes()
+{
+    // must be called with the service mutex locked for writing
+    std::auto_ptr<RouteTable> table( new RouteTable );
+
+    ServletList::iterator it;
+    for(it = _servlets.begin(); it != _servlets.end(); ++it)
+    {
+        if( ! it->isShutdown() )
+            table->addServlet( *it->servlet() );
+    }
+
+    table->commit();
+
+    void* old = atomicExchange(_routes, table.release());
+    if(old)
+        _retiredRoutes.push_back( static_cast<RouteTable*>(old) );
+}
+
+
+void ServerImpl::reclaimRoutes()
+{
+    // must be called without the service mutex locked. Only the tables
+    // replaced so far are freed, tables which are replaced while waiting
+    // for the workers are left to the next call
+    std::vector<RouteTable*> retired;
+
+    {
+        System::WriteLock serviceLock(_serviceMutex);
+        retired.swap(_retiredRoutes);
+    }
+
+    // each worker returns to its event loop, after which it no longer
+    // uses a replaced table
+    std::vector<ServerThread*>::iterator threadIt;
+    for(threadIt = _serverThreads.begin(); threadIt != _serverThreads.end(); ++threadIt)
+    {
+        (*threadIt)->synchronize();
+    }
+
+    deleteRoutes(retired);
+}
+
+
+void ServerImpl::deleteRoutes(std::vector<RouteTable*>& tables)
+{
+    std::vector<RouteTable*>::iterator it;
+    for(it = tables.begin(); it != tables.end(); ++it)
+    {
+        delete *it;
+    }
+
+    tables.clear();
+}
+
+
+const RouteTable* ServerImpl::routes() const
+{
+    // the table is published with a full barrier and never modified,
+    // so it can be read without a lock
+    return static_cast<const RouteTable*>(_routes);
+}
+
+
+void ServerImpl::cancel()
+{
+    _serverSocket.cancel();
+
+    stopWorkers();
+
     std::vector<Acceptor*>::iterator it;
     for(it = _handlers.begin(); it != _handlers.end(); ++it)
     {
@@ -571,6 +832,11 @@ void ServerImpl::addServlet(Servlet& servlet)
     System::WriteLock serviceLock(_serviceMutex);
     ServletListEntry entry(&servlet);
     _servlets.push_back(entry);
+
+    publishRoutes();
+    serviceLock.unlock();
+
+    reclaimRoutes();
 }
 
 
@@ -589,6 +855,12 @@ void ServerImpl::removeServlet(Servlet& servlet)
         }
     }
 
+    publishRoutes();
+
+    // the replaced tables are freed after the round-trip to the workers
+    std::vector<RouteTable*> retired;
+    retired.swap(_retiredRoutes);
+
     serviceLock.unlock();
 
     // close all connections in this thread, which use the servlet
@@ -597,7 +869,7 @@ void ServerImpl::removeServlet(Servlet& servlet)
     {
         std::vector<Acceptor*>::iterator handler = hit++;
         
-        if( (*handler)->servlet() == &servlet )
+        if( (*handler)->hasServlet(&servlet) )
         {
             delete *handler;
             hit = _handlers.erase(handler);
@@ -612,6 +884,10 @@ void ServerImpl::removeServlet(Servlet& servlet)
         (*threadIt)->removeServlet(servlet);
     }
 
+    // each worker has returned to its event loop and no longer uses
+    // the routes, which were replaced before
+    deleteRoutes(retired);
+
     //NOTE: in case of an exception, terminate the worker thread
 }
 
@@ -629,6 +905,11 @@ void ServerImpl::shutdownServlet(Servlet& servlet, bool shutdown)
             break;
         }
     }
+
+    publishRoutes();
+    serviceLock.unlock();
+
+    reclaimRoutes();
 }
 
 
@@ -638,7 +919,7 @@ bool ServerImpl::isServletIdle(Servlet& servlet)
     std::vector<Acceptor*>::iterator it;
     for( it = _handlers.begin(); it != _handlers.end(); ++it)
     {      
-        if( (*it)->servlet() == &servlet )
+        if( (*it)->hasServlet(&servlet) )
         {
             return false;
         }
@@ -659,20 +940,15 @@ bool ServerImpl::isServletIdle(Servlet& servlet)
 }
 
 
-Servlet* ServerImpl::getServlet(const Request& request)
+Servlet* ServerImpl::getServlet(Request& request)
 {
-    System::ReadLock serviceLock(_serviceMutex);
+    const RouteTable* table = routes();
+    Servlet* servlet = table ? table->find(request) : 0;
 
-    for(ServletList::iterator it = _servlets.begin(); it != _servlets.end(); ++it)
+    if(servlet)
     {
-        if( it->isShutdown() )
-            continue;
-
-        if( ! it->servlet()->isMapped(request) )
-            continue;
-
         log_info("serving: " << request.url());
-        return it->servlet();
+        return servlet;
     }
 
     log_warn("not found: " << request.url());
@@ -680,19 +956,42 @@ Servlet* ServerImpl::getServlet(const Request& request)
 }
 
 
-void ServerImpl::onAccept(Net::TcpServer& server)
+Servlet* ServerImpl::getServlet(const Request& request)
 {
-    log_trace("Server::onAccept");
+    const RouteTable* table = routes();
+    return table ? table->find(request) : 0;
+}
 
-    // TODO: we should only pass the TcpSocket to the worker thread so that 
-    // an Acceptor can be constructed with an event loop there
 
+Acceptor* ServerImpl::createAcceptor(Net::TcpServer& server)
+{
     std::auto_ptr<Acceptor> handler( new Acceptor(*this, server) );
 
     log_debug("handler timeouts: " << _timeout << ", " << _keepAliveTimeout);
     handler->setTimeout(_timeout);
     handler->setKeepAliveTimeout(_keepAliveTimeout);
     handler->setMaxReadSize(_maxRequestSize);
+    handler->setMaxHeaderSize(_maxHeaderSize);
+    handler->setMaxPipelined(_maxPipelined);
+    handler->setNoDelay(_noDelay);
+    handler->setMaxStreams(_maxStreams);
+
+    return handler.release();
+}
+
+
+void ServerImpl::onAccept(Net::TcpServer& server)
+{
+    log_trace("Server::onAccept");
+
+    // TODO: we should only pass the TcpSocket to the worker thread so that 
+    // an Acceptor can be constructed with an event loop there
+
+    std::auto_ptr<Acceptor> handler( createAcceptor(server) );
+
+    // workers with their own listening socket accept by themselves
+    while( _useWorker < _serverThreads.size() && _serverThreads[_useWorker]->isListening() )
+        ++_useWorker;
 
     if( _useWorker < _serverThreads.size() ) // worker thread
     {
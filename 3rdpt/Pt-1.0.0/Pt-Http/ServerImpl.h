@@ -30,6 +30,7 @@
 #define Pt_Http_ServerImpl_h
 
 #include "Connection.h"
+#include "RouteTable.h"
 
 #include <Pt/Http/Api.h>
 #include <Pt/Http/Request.h>
@@ -38,7 +39,7 @@
 #include <Pt/Ssl/Context.h>
 #include <Pt/Net/TcpServer.h>
 #include <Pt/System/MainLoop.h>
-#include <Pt/System/Thread.h>
+#include <Pt/System/EventLoopPool.h>
 #include <Pt/System/Mutex.h>
 #include <Pt/System/Condition.h>
 #include <Pt/Connectable.h>
@@ -59,6 +60,58 @@ class Servlet;
 class ServerImpl;
 class ServerThread;
 
+class Acceptor;
+
+/** @brief Serves the requests of a connection with a servlet.
+
+    A HTTP/1 connection is served by a single exchange, which receives
+    one request after the other. A HTTP/2 connection has an exchange for
+    each stream, which is processed concurrently.
+*/
+class Exchange : public Pt::Connectable
+{
+    public:
+        Exchange(Acceptor& acceptor, ServerImpl& server, Connection& conn);
+
+        ~Exchange();
+
+        Request& request()
+        { return _request; }
+
+        Reply& reply()
+        { return _reply; }
+
+        Servlet* servlet()
+        { return _servlet; }
+
+        //! @brief Begins to receive the next request.
+        void begin();
+
+        void replyError();
+
+    protected:
+        void releaseResponder();
+
+        void onRequestReceived(Request& req);
+
+        void onAuthorization(Authorization& auth);
+
+        void onRequest(MessageProgress progress);
+
+        void onReplySent(Reply& r);
+
+    private:
+        Acceptor& _acceptor;
+        ServerImpl& _server;
+        Connection& _conn;
+        Authorization* _auth;
+        Servlet* _servlet;
+        Responder* _responder;
+        Request _request;
+        Reply _reply;
+        MessageProgress _requestProgress;
+};
+
 class Acceptor : public Pt::Connectable
 {
     public:
@@ -78,36 +131,43 @@ class Acceptor : public Pt::Connectable
         void setMaxReadSize(std::size_t maxSize)
         { _conn.setMaxReadSize(maxSize); }
 
+        void setMaxHeaderSize(std::size_t maxSize)
+        { _conn.setMaxHeaderSize(maxSize); }
+
+        void setMaxPipelined(std::size_t n)
+        { _conn.setMaxPipelined(n); }
+
+        void setNoDelay(bool noDelay)
+        { _conn.setNoDelay(noDelay); }
+
+        void setMaxStreams(std::size_t n)
+        { _conn.setMaxStreams(n); }
+
         void beginServe(System::EventLoop& loop);
 
         Signal<Acceptor&>& finished()
         { return _finished; }
 
-        Servlet* servlet()
-        { return _servlet; }
+        //! @brief Returns true, if a request is served by the servlet.
+        bool hasServlet(const Servlet* servlet) const;
 
-    protected:
-        void releaseResponder();
+        /** @brief Ends an exchange, which can not continue.
 
-        void onRequestReceived(Request& req);
-
-        void onAuthorization(Authorization& auth);
+            Only the stream of the exchange is reset, if the connection
+            is multiplexed. Otherwise the connection is finished, after
+            an error reply was sent, if requested.
+        */
+        void abortExchange(Exchange& ex, bool errorReply);
 
-        void onRequest(MessageProgress progress);
-
-        void onReplySent(Reply& r);
+    protected:
+        void onRequestPending(Connection& conn);
 
-        void replyError();
+        void onSessionFinished(Connection& conn);
 
     private:
         ServerImpl& _server;
-        Authorization* _auth;
-        Servlet* _servlet;
-        Responder* _responder;
         Connection _conn;
-        Request _request;
-        Reply _reply;
-        MessageProgress _requestProgress;
+        std::vector<Exchange*> _exchanges;
         Signal<Acceptor&> _finished;
 };
 
@@ -156,12 +216,24 @@ class ServerThread : public Connectable
                 Servlet* _servlet;
         };
 
+        class SyncEvent : public Pt::BasicEvent<SyncEvent>
+        {
+            public:
+                SyncEvent()
+                { }
+        };
+
     public:
-        ServerThread();
+        ServerThread(ServerImpl& server, System::MainLoop& loop);
 
         ~ServerThread();
 
         void setSecure(Ssl::Context& ctx);
+
+        bool listen(const Net::Endpoint& ep, const Net::TcpServerOptions& opts);
+
+        bool isListening() const
+        { return _listening; }
         
         void serve(Acceptor* conn);
 
@@ -171,6 +243,9 @@ class ServerThread : public Connectable
 
         bool isServletIdle(Servlet& servlet);
 
+        //! @brief Returns when the worker has returned to its event loop
+        void synchronize();
+
     private:
         void onAccept(const AcceptEvent& ev);
 
@@ -178,15 +253,21 @@ class ServerThread : public Connectable
 
         void onIsServletIdle(const ServletInfoEvent& ev);
 
+        void onSynchronize(const SyncEvent& ev);
+
         void onHandlerFinished(Acceptor& handler);
 
+        void onConnectionPending(Net::TcpServer& server);
+
     private:
-        Pt::System::MainLoop _loop;
+        ServerImpl& _server;
+        Pt::System::MainLoop& _loop;
+        Net::TcpServer _serverSocket;
+        bool _listening;
         
         bool _ssl;
         Ssl::Context _sslctx;
 
-        Pt::System::AttachedThread _thread;
         std::vector<Acceptor*> _handlers;
 
         bool _isReturned;
@@ -236,6 +317,30 @@ class ServerImpl : public Connectable
         void setMaxRequestSize(std::size_t maxSize)
         { _maxRequestSize = maxSize; }
 
+        std::size_t maxHeaderSize() const
+        { return _maxHeaderSize; }
+
+        void setMaxHeaderSize(std::size_t maxSize)
+        { _maxHeaderSize = maxSize; }
+
+        std::size_t maxPipelined() const
+        { return _maxPipelined; }
+
+        void setMaxPipelined(std::size_t n)
+        { _maxPipelined = n; }
+
+        bool noDelay() const
+        { return _noDelay; }
+
+        void setNoDelay(bool noDelay)
+        { _noDelay = noDelay; }
+
+        std::size_t maxConcurrentStreams() const
+        { return _maxStreams; }
+
+        void setMaxConcurrentStreams(std::size_t n)
+        { _maxStreams = n; }
+
         void listen(const Pt::Net::Endpoint& addr, const Net::TcpServerOptions& opts);
 
         void cancel();
@@ -248,9 +353,23 @@ class ServerImpl : public Connectable
 
         bool isServletIdle(Servlet& servlet);
 
+        Servlet* getServlet(Request& request);
+
         Servlet* getServlet(const Request& request);
 
+        Acceptor* createAcceptor(Net::TcpServer& server);
+
     private:
+        void stopWorkers();
+
+        void publishRoutes();
+
+        void reclaimRoutes();
+
+        static void deleteRoutes(std::vector<RouteTable*>& tables);
+
+        const RouteTable* routes() const;
+
         void onAccept(Net::TcpServer& server);
 
         void onHandlerFinished(Acceptor& conn);
@@ -278,6 +397,7 @@ class ServerImpl : public Connectable
 
         Net::TcpServer _serverSocket;
         Ssl::Context* _sslctx;
+        System::EventLoopPool* _pool;
         std::vector<ServerThread*> _serverThreads;
         std::vector<Acceptor*> _handlers;
         std::size_t _useWorker;
@@ -285,9 +405,17 @@ class ServerImpl : public Connectable
         std::size_t _timeout;
         std::size_t _keepAliveTimeout;
         std::size_t _maxRequestSize;
+        std::size_t _maxHeaderSize;
+        std::size_t _maxPipelined;
+        bool _noDelay;
+        std::size_t _maxStreams;
         System::ReadWriteMutex _serviceMutex;
         typedef std::vector<ServletListEntry> ServletList;
         ServletList _servlets;
+
+        // routing table of the servlets, which is read without a lock
+        void* volatile _routes;
+        std::vector<RouteTable*> _retiredRoutes;
 };
 
 } // namespace Http
@@ -32,6 +32,7 @@
 #include <Pt/Http/Service.h>
 #include <Pt/Http/Request.h>
 #include <Pt/Http/Reply.h>
+#include "RouteTable.h"
 
 namespace Pt {
 
@@ -41,6 +42,7 @@ Servlet::Servlet(Service& s)
 : _server(0)
 , _service(&s)
 , _auth(0)
+, _routeType(NoRoute)
 {
 }
 
@@ -49,6 +51,7 @@ Servlet::Servlet(Service& s, Authorizer& a)
 : _server(0)
 , _service(&s)
 , _auth(&a)
+, _routeType(NoRoute)
 {
 }
 
@@ -98,12 +101,57 @@ void Servlet::unregisterServer(Server& server)
 }
 
 
+void Servlet::setUrlRoute(const std::string& url, const std::string& method)
+{
+    _routeType = UrlRoute;
+    _route = url;
+    _routeMethod = method;
+}
+
+
+void Servlet::setPatternRoute(const std::string& pattern, const std::string& method)
+{
+    RouteTable::validate(pattern);
+
+    _routeType = PatternRoute;
+    _route = pattern;
+    _routeMethod = method;
+}
+
+
+bool Servlet::matchesRoute(const Request& request) const
+{
+    if( ! _routeMethod.empty() && _routeMethod != request.method() )
+        return false;
+
+    switch(_routeType)
+    {
+        case UrlRoute:
+            return _route == request.url();
+
+        case PatternRoute:
+            return RouteTable::matches(_route, request.url());
+
+        default:
+            break;
+    }
+
+    return false;
+}
+
+
 bool MapUrl::onRequest(const Request& request) const
 { 
     return _url == request.url(); 
 }
 
 
+bool MapRoute::onRequest(const Request& request) const
+{ 
+    return matchesRoute(request); 
+}
+
+
 bool MapAny::onRequest(const Request& request) const
 { 
     return true; 
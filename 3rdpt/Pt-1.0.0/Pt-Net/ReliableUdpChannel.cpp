@@ -0,0 +1,1342 @@
+/*
+ * Copyright (C) 2005-2013 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <Pt/Net/ReliableUdpChannel.h>
+#include <Pt/Net/UdpSocket.h>
+#include <Pt/System/EventLoop.h>
+#include <Pt/System/Timer.h>
+#include <Pt/System/Clock.h>
+#include <Pt/System/IOError.h>
+#include <Pt/System/Logger.h>
+#include <Pt/Connectable.h>
+#include <Pt/Types.h>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include <deque>
+#include <cstring>
+
+log_define("Pt.Net.ReliableUdpChannel");
+
+namespace {
+
+// packet header: protocol id, flags, sequence, ack and ack bits
+const Pt::uint16_t ProtocolId = 0x5052;
+const std::size_t PacketHeaderSize = 11;
+
+// the ack fields are valid, set once a packet of the peer was received
+const Pt::uint8_t AckFlag = 1;
+
+// chunk header: lane, flags, message sequence and length
+const std::size_t ChunkHeaderSize = 6;
+
+// fragment index and count follow the chunk header of fragments
+const std::size_t FragmentHeaderSize = 2;
+const std::size_t MaxFragments = 255;
+const Pt::uint8_t FragmentFlag = 1;
+
+// sent packets which can be acknowledged, must exceed the ack bits
+const std::size_t PacketWindow = 1024;
+
+// reliable messages per lane which can be in flight
+const std::size_t MessageWindow = 512;
+
+// packets received or sent with one system call
+const std::size_t MaxBatch = 32;
+
+// a packet is lost if this many newer packets were acknowledged
+const Pt::uint16_t ReorderThreshold = 3;
+
+const std::size_t MinPacketSize = 64;
+const std::size_t MaxPacketSize = 65507;
+const std::size_t DefaultPacketSize = 1200;
+const std::size_t DefaultTickInterval = 10;
+const std::size_t DefaultTimeout = 10000;
+
+// times in microseconds
+const Pt::int64_t InitialRtt = 100000;
+const Pt::int64_t MinRto = 20000;
+const Pt::int64_t MaxRto = 2000000;
+const Pt::int64_t KeepAliveInterval = 1000000;
+
+// sequence numbers wrap around, a is newer if it is less than half
+// of the sequence space ahead of b
+inline bool isNewer(Pt::uint16_t a, Pt::uint16_t b)
+{
+    return a != b && static_cast<Pt::uint16_t>(a - b) < 0x8000;
+}
+
+
+inline void put16(char* p, Pt::uint16_t n)
+{
+    p[0] = static_cast<char>(n >> 8);
+    p[1] = static_cast<char>(n);
+}
+
+
+inline void put32(char* p, Pt::uint32_t n)
+{
+    put16(p, static_cast<Pt::uint16_t>(n >> 16));
+    put16(p + 2, static_cast<Pt::uint16_t>(n));
+}
+
+
+inline Pt::uint16_t get16(const char* p)
+{
+    const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+    return static_cast<Pt::uint16_t>( (u[0] << 8) | u[1] );
+}
+
+
+inline Pt::uint32_t get32(const char* p)
+{
+    return (static_cast<Pt::uint32_t>( get16(p) ) << 16) | get16(p + 2);
+}
+
+
+inline Pt::int64_t monotonicTime()
+{
+    return Pt::System::Clock::getMonotonicTime() / 1000;
+}
+
+}
+
+namespace Pt {
+
+namespace Net {
+
+class ReliableUdpChannelImpl : public Connectable
+{
+    public:
+        ReliableUdpChannelImpl(ReliableUdpChannel& channel);
+
+        ~ReliableUdpChannelImpl();
+
+        std::size_t addLane(ReliableUdpChannel::Delivery delivery);
+
+        std::size_t laneCount() const
+        { return _lanes.size(); }
+
+        void open(const Endpoint& local, const Endpoint& peer);
+
+        void close();
+
+        bool isOpen() const
+        { return _isOpen; }
+
+        void setActive(System::EventLoop& loop);
+
+        void detach();
+
+        std::size_t tickInterval() const
+        { return _tickInterval; }
+
+        void setTickInterval(std::size_t msecs);
+
+        std::size_t maxPacketSize() const
+        { return _maxPacketSize; }
+
+        void setMaxPacketSize(std::size_t n);
+
+        std::size_t timeout() const
+        { return _timeout; }
+
+        void setTimeout(std::size_t msecs)
+        { _timeout = msecs; }
+
+        void send(std::size_t lane, const char* data, std::size_t n);
+
+        bool receive(std::string& data, std::size_t& lane);
+
+        void update();
+
+        Pt::int64_t roundTripTime() const
+        { return _srtt; }
+
+        std::size_t congestionWindow() const
+        { return _cwnd; }
+
+        std::size_t bytesInFlight() const
+        { return _inFlight; }
+
+        Pt::uint64_t packetsLost() const
+        { return _packetsLost; }
+
+        UdpSocket& socket()
+        { return _socket; }
+
+    private:
+        struct Fragment
+        {
+            Fragment()
+            : sentAt(0), acked(false), lost(false)
+            {}
+
+            Pt::int64_t sentAt;
+            bool acked;
+            bool lost;
+        };
+
+        struct OutMessage
+        {
+            Pt::uint16_t seq;
+            std::string data;
+            std::vector<Fragment> frags;
+            std::size_t unacked;
+        };
+
+        struct InMessage
+        {
+            InMessage()
+            : used(false), delivered(false), seq(0), received(0)
+            {}
+
+            bool used;
+            bool delivered;
+            Pt::uint16_t seq;
+            std::size_t received;
+            std::vector<std::string> parts;
+            std::vector<bool> have;
+        };
+
+        struct Lane
+        {
+            Lane(ReliableUdpChannel::Delivery d)
+            : delivery(d), nextSeq(0), base(0), hasLast(false), lastSeq(0)
+            {}
+
+            bool isReliable() const
+            { return delivery != ReliableUdpChannel::UnreliableSequenced; }
+
+            ReliableUdpChannel::Delivery delivery;
+            Pt::uint16_t nextSeq;
+            std::deque<OutMessage> out;
+            Pt::uint16_t base;
+            std::vector<InMessage> in;
+            bool hasLast;
+            Pt::uint16_t lastSeq;
+        };
+
+        struct Unit
+        {
+            Pt::uint8_t lane;
+            Pt::uint8_t frag;
+            Pt::uint16_t seq;
+        };
+
+        struct SentPacket
+        {
+            SentPacket()
+            : inFlight(false), seq(0), sentAt(0), bytes(0)
+            {}
+
+            bool inFlight;
+            Pt::uint16_t seq;
+            Pt::int64_t sentAt;
+            std::size_t bytes;
+            std::vector<Unit> units;
+        };
+
+        struct Unsent
+        {
+            Pt::uint8_t lane;
+            Pt::uint16_t seq;
+            std::string data;
+        };
+
+        struct Received
+        {
+            std::size_t lane;
+            std::string data;
+        };
+
+    private:
+        void onTimer();
+
+        void reset();
+
+        void receivePackets(Pt::int64_t now);
+
+        void processPacket(const char* data, std::size_t n, Pt::int64_t now);
+
+        bool recordReceived(Pt::uint16_t seq);
+
+        void processChunk(Lane& lane, std::size_t index, Pt::uint16_t seq,
+                          const char* data, std::size_t n,
+                          std::size_t frag, std::size_t count);
+
+        void deliver(Lane& lane, InMessage& msg, std::size_t index);
+
+        void pushReceived(InMessage& msg, std::size_t index);
+
+        void ackPacket(Pt::uint16_t seq, Pt::int64_t now);
+
+        void detectLosses(Pt::int64_t now);
+
+        void onPacketLost(SentPacket& packet, Pt::int64_t now);
+
+        Fragment* findFragment(const Unit& unit);
+
+        void sendPackets(Pt::int64_t now);
+
+        bool sendReliable(Pt::int64_t now);
+
+        bool writeChunk(const Unit& unit, const char* data, std::size_t n,
+                        std::size_t count, Pt::int64_t now);
+
+        bool beginPacket(bool congestionControlled);
+
+        void finishPacket(Pt::int64_t now);
+
+        void flushPackets(Pt::int64_t now);
+
+        std::size_t fragmentSize() const
+        { return _maxPacketSize - PacketHeaderSize - ChunkHeaderSize - FragmentHeaderSize; }
+
+    private:
+        ReliableUdpChannel& _channel;
+        UdpSocket _socket;
+        System::Timer _timer;
+        bool _isOpen;
+        bool _timedOut;
+        std::size_t _tickInterval;
+        std::size_t _maxPacketSize;
+        std::size_t _timeout;
+        std::vector<Lane> _lanes;
+        std::size_t _nextLane;
+        std::deque<Unsent> _unsent;
+        std::deque<Received> _received;
+
+        // receive state
+        bool _hasRemoteSeq;
+        Pt::uint16_t _remoteSeq;
+        Pt::uint32_t _remoteBits;
+        bool _ackPending;
+        Pt::int64_t _lastReceive;
+        std::vector<char> _recvBuffer;
+
+        // send state
+        Pt::uint16_t _localSeq;
+        std::vector<SentPacket> _sent;
+        std::deque<Pt::uint16_t> _flight;
+        bool _hasLargestAcked;
+        Pt::uint16_t _largestAcked;
+        Pt::int64_t _lastSend;
+        std::vector<char> _sendBuffer;
+        std::size_t _batchSize;
+        std::size_t _packetSize;
+        bool _packetTracked;
+        std::vector<Unit> _packetUnits;
+        std::size_t _batchBytes[MaxBatch];
+        bool _batchTracked[MaxBatch];
+        Pt::uint16_t _batchSeq[MaxBatch];
+
+        // round trip time and congestion control
+        Pt::int64_t _srtt;
+        Pt::int64_t _rttvar;
+        Pt::int64_t _rto;
+        bool _hasRtt;
+        std::size_t _cwnd;
+        std::size_t _ssthresh;
+        std::size_t _inFlight;
+        Pt::int64_t _recoveryStart;
+        Pt::int64_t _budget;
+        Pt::int64_t _lastRefill;
+        Pt::uint64_t _packetsLost;
+};
+
+
+ReliableUdpChannelImpl::ReliableUdpChannelImpl(ReliableUdpChannel& channel)
+: _channel(channel)
+, _isOpen(false)
+, _timedOut(false)
+, _tickInterval(DefaultTickInterval)
+, _maxPacketSize(DefaultPacketSize)
+, _timeout(DefaultTimeout)
+, _nextLane(0)
+, _packetsLost(0)
+{
+    _timer.timeout() += slot(*this, &ReliableUdpChannelImpl::onTimer);
+    reset();
+}
+
+
+ReliableUdpChannelImpl::~ReliableUdpChannelImpl()
+{
+}
+
+
+std::size_t ReliableUdpChannelImpl::addLane(ReliableUdpChannel::Delivery delivery)
+{
+    if(_isOpen)
+        throw std::logic_error("channel is open");
+
+    if(_lanes.size() >= ReliableUdpChannel::MaxLanes)
+        throw std::length_error("too many lanes");
+
+    _lanes.push_back( Lane(delivery) );
+    return _lanes.size() - 1;
+}
+
+
+void ReliableUdpChannelImpl::open(const Endpoint& local, const Endpoint& peer)
+{
+    close();
+
+    _socket.bind(local);
+    _socket.connect(peer);
+
+    reset();
+    _isOpen = true;
+    _lastReceive = monotonicTime();
+    _lastRefill = _lastReceive;
+
+    if( _timer.loop() )
+        _timer.start(_tickInterval);
+
+    log_debug("opened channel to " << peer.toString());
+}
+
+
+void ReliableUdpChannelImpl::close()
+{
+    _timer.stop();
+    _socket.close();
+    _isOpen = false;
+
+    reset();
+}
+
+
+void ReliableUdpChannelImpl::reset()
+{
+    for(std::vector<Lane>::iterator it = _lanes.begin(); it != _lanes.end(); ++it)
+    {
+        *it = Lane(it->delivery);
+
+        if( it->isReliable() )
+            it->in.resize(MessageWindow);
+    }
+
+    _unsent.clear();
+    _received.clear();
+    _nextLane = 0;
+    _timedOut = false;
+
+    _hasRemoteSeq = false;
+    _remoteSeq = 0;
+    _remoteBits = 0;
+    _ackPending = false;
+    _lastReceive = 0;
+
+    _localSeq = 0;
+    _sent.assign(PacketWindow, SentPacket());
+    _flight.clear();
+    _hasLargestAcked = false;
+    _largestAcked = 0;
+    _lastSend = 0;
+    _batchSize = 0;
+    _packetSize = 0;
+    _packetTracked = false;
+    _packetUnits.clear();
+
+    _srtt = InitialRtt;
+    _rttvar = InitialRtt / 2;
+    _rto = std::min(MaxRto, _srtt + 4 * _rttvar);
+    _hasRtt = false;
+    _cwnd = 10 * _maxPacketSize;
+    _ssthresh = static_cast<std::size_t>(-1);
+    _inFlight = 0;
+    _recoveryStart = 0;
+    _budget = static_cast<Pt::int64_t>(_cwnd);
+    _lastRefill = 0;
+    _packetsLost = 0;
+
+    _recvBuffer.resize(MaxBatch * _maxPacketSize);
+    _sendBuffer.resize(MaxBatch * _maxPacketSize);
+}
+
+
+void ReliableUdpChannelImpl::setActive(System::EventLoop& loop)
+{
+    _timer.setActive(loop);
+
+    if(_isOpen)
+        _timer.start(_tickInterval);
+}
+
+
+void ReliableUdpChannelImpl::detach()
+{
+    _timer.stop();
+    _timer.detach();
+}
+
+
+void ReliableUdpChannelImpl::setTickInterval(std::size_t msecs)
+{
+    _tickInterval = msecs > 0 ? msecs : 1;
+
+    if( _timer.isStarted() )
+        _timer.start(_tickInterval);
+}
+
+
+void ReliableUdpChannelImpl::setMaxPacketSize(std::size_t n)
+{
+    if(_isOpen)
+        throw std::logic_error("channel is open");
+
+    if(n < MinPacketSize || n > MaxPacketSize)
+        throw std::out_of_range("invalid packet size");
+
+    _maxPacketSize = n;
+    reset();
+}
+
+
+void ReliableUdpChannelImpl::send(std::size_t index, const char* data, std::size_t n)
+{
+    if( ! _isOpen )
+        throw std::logic_error("channel not open");
+
+    if(index >= _lanes.size())
+        throw std::out_of_range("invalid lane");
+
+    Lane& lane = _lanes[index];
+
+    if( ! lane.isReliable() )
+    {
+        if(n > _maxPacketSize - PacketHeaderSize - ChunkHeaderSize)
+            throw std::length_error("unreliable message exceeds packet size");
+
+        Unsent msg;
+        msg.lane = static_cast<Pt::uint8_t>(index);
+        msg.seq = lane.nextSeq++;
+        msg.data.assign(data, n);
+        _unsent.push_back(msg);
+        return;
+    }
+
+    std::size_t count = 1;
+    if(n > _maxPacketSize - PacketHeaderSize - ChunkHeaderSize)
+        count = (n + fragmentSize() - 1) / fragmentSize();
+
+    if(count > MaxFragments)
+        throw std::length_error("message too large");
+
+    lane.out.push_back( OutMessage() );
+
+    OutMessage& msg = lane.out.back();
+    msg.seq = lane.nextSeq++;
+    msg.data.assign(data, n);
+    msg.frags.resize(count);
+    msg.unacked = count;
+}
+
+
+bool ReliableUdpChannelImpl::receive(std::string& data, std::size_t& lane)
+{
+    if( _received.empty() )
+        return false;
+
+    Received& msg = _received.front();
+    data.swap(msg.data);
+    lane = msg.lane;
+    _received.pop_front();
+    return true;
+}
+
+
+void ReliableUdpChannelImpl::onTimer()
+{
+    update();
+}
+
+
+void ReliableUdpChannelImpl::update()
+{
+    if( ! _isOpen )
+        return;
+
+    Pt::int64_t now = monotonicTime();
+
+    receivePackets(now);
+    detectLosses(now);
+    sendPackets(now);
+
+    bool timedOut = false;
+    if( ! _timedOut && now - _lastReceive > static_cast<Pt::int64_t>(_timeout) * 1000 )
+    {
+        log_debug("peer timed out");
+        _timedOut = true;
+        timedOut = true;
+    }
+
+    // the channel may be closed or destroyed by the receivers,
+    // so only one signal is sent
+    if(timedOut)
+        _channel.timedOut().send(_channel);
+    else if( ! _received.empty() )
+        _channel.inputReady().send(_channel);
+}
+
+
+void ReliableUdpChannelImpl::receivePackets(Pt::int64_t now)
+{
+    Datagram dgrams[MaxBatch];
+    for(std::size_t n = 0; n < MaxBatch; ++n)
+        dgrams[n] = Datagram(&_recvBuffer[n * _maxPacketSize], _maxPacketSize);
+
+    for(;;)
+    {
+        std::size_t count = 0;
+        try
+        {
+            count = _socket.receive(dgrams, MaxBatch);
+        }
+        catch(const System::IOError& e)
+        {
+            // for example, the peer port is not open yet
+            log_debug("receive failed: " << e.what());
+            break;
+        }
+
+        for(std::size_t n = 0; n < count; ++n)
+            processPacket(dgrams[n].data, dgrams[n].received, now);
+
+        if(count < MaxBatch)
+            break;
+    }
+}
+
+
+void ReliableUdpChannelImpl::processPacket(const char* data, std::size_t n, Pt::int64_t now)
+{
+    if(n < PacketHeaderSize || get16(data) != ProtocolId)
+        return;
+
+    _lastReceive = now;
+
+    Pt::uint8_t packetFlags = static_cast<Pt::uint8_t>(data[2]);
+    Pt::uint16_t seq = get16(data + 3);
+    Pt::uint16_t ack = get16(data + 5);
+    Pt::uint32_t bits = get32(data + 7);
+
+    // the peer acknowledges nothing before it received a packet and
+    // acks for packets which were not sent yet are ignored
+    if( (packetFlags & AckFlag) && isNewer(_localSeq, ack) )
+    {
+        ackPacket(ack, now);
+        for(Pt::uint16_t i = 0; i < 32; ++i)
+        {
+            if( bits & (Pt::uint32_t(1) << i) )
+                ackPacket(static_cast<Pt::uint16_t>(ack - i - 1), now);
+        }
+    }
+
+    if( ! recordReceived(seq) )
+        return;
+
+    std::size_t pos = PacketHeaderSize;
+    while(pos < n)
+    {
+        if(n - pos < ChunkHeaderSize)
+            return;
+
+        std::size_t lane = static_cast<unsigned char>(data[pos]);
+        Pt::uint8_t flags = static_cast<Pt::uint8_t>(data[pos + 1]);
+        Pt::uint16_t mseq = get16(data + pos + 2);
+        std::size_t len = get16(data + pos + 4);
+        pos += ChunkHeaderSize;
+
+        std::size_t frag = 0;
+        std::size_t count = 1;
+        if(flags & FragmentFlag)
+        {
+            if(n - pos < FragmentHeaderSize)
+                return;
+
+            frag = static_cast<unsigned char>(data[pos]);
+            count = static_cast<unsigned char>(data[pos + 1]);
+            pos += FragmentHeaderSize;
+        }
+
+        if(n - pos < len || lane >= _lanes.size() || frag >= count)
+        {
+            log_warn("malformed packet received");
+            return;
+        }
+
+        processChunk(_lanes[lane], lane, mseq, data + pos, len, frag, count);
+        pos += len;
+
+        _ackPending = true;
+    }
+}
+
+
+bool ReliableUdpChannelImpl::recordReceived(Pt::uint16_t seq)
+{
+    if( ! _hasRemoteSeq )
+    {
+        _hasRemoteSeq = true;
+        _remoteSeq = seq;
+        _remoteBits = 0;
+        return true;
+    }
+
+    if( isNewer(seq, _remoteSeq) )
+    {
+        Pt::uint16_t diff = seq - _remoteSeq;
+        Pt::uint32_t bits = diff < 32 ? (_remoteBits << diff) : 0;
+
+        if(diff <= 32)
+            bits |= Pt::uint32_t(1) << (diff - 1);
+
+        _remoteBits = bits;
+        _remoteSeq = seq;
+        return true;
+    }
+
+    Pt::uint16_t diff = _remoteSeq - seq;
+    if(diff == 0)
+        return false;
+
+    // too old to be acknowledged, the messages are deduplicated
+    if(diff > 32)
+        return true;
+
+    Pt::uint32_t bit = Pt::uint32_t(1) << (diff - 1);
+    if(_remoteBits & bit)
+        return false;
+
+    _remoteBits |= bit;
+    return true;
+}
+
+
+void ReliableUdpChannelImpl::processChunk(Lane& lane, std::size_t index, Pt::uint16_t seq,
+                                          const char* data, std::size_t n,
+                                          std::size_t frag, std::size_t count)
+{
+    if( ! lane.isReliable() )
+    {
+        if( lane.hasLast && ! isNewer(seq, lane.lastSeq) )
+            return;
+
+        lane.hasLast = true;
+        lane.lastSeq = seq;
+
+        _received.push_back( Received() );
+        _received.back().lane = index;
+        _received.back().data.assign(data, n);
+        return;
+    }
+
+    // messages before the window were delivered, those beyond it
+    // were sent before ours was acknowledged and are sent again
+    Pt::uint16_t offset = seq - lane.base;
+    if(offset >= MessageWindow)
+        return;
+
+    InMessage& msg = lane.in[seq % MessageWindow];
+
+    if( ! msg.used )
+    {
+        msg.used = true;
+        msg.delivered = false;
+        msg.seq = seq;
+        msg.received = 0;
+        msg.parts.assign(count, std::string());
+        msg.have.assign(count, false);
+    }
+
+    if(msg.delivered || msg.parts.size() != count || msg.have[frag])
+        return;
+
+    msg.parts[frag].assign(data, n);
+    msg.have[frag] = true;
+
+    if(++msg.received == count)
+        deliver(lane, msg, index);
+}
+
+
+void ReliableUdpChannelImpl::deliver(Lane& lane, InMessage& msg, std::size_t index)
+{
+    if(lane.delivery == ReliableUdpChannel::ReliableUnordered)
+    {
+        msg.delivered = true;
+        pushReceived(msg, index);
+    }
+
+    for(;;)
+    {
+        InMessage& next = lane.in[lane.base % MessageWindow];
+        if( ! next.used || next.seq != lane.base || next.received != next.parts.size() )
+            break;
+
+        if( ! next.delivered )
+            pushReceived(next, index);
+
+        next.used = false;
+        next.delivered = false;
+        next.parts.clear();
+        next.have.clear();
+        ++lane.base;
+    }
+}
+
+
+void ReliableUdpChannelImpl::pushReceived(InMessage& msg, std::size_t index)
+{
+    _received.push_back( Received() );
+    _received.back().lane = index;
+
+    std::string& data = _received.back().data;
+    data.swap(msg.parts[0]);
+
+    for(std::size_t n = 1; n < msg.parts.size(); ++n)
+        data += msg.parts[n];
+}
+
+
+void ReliableUdpChannelImpl::ackPacket(Pt::uint16_t seq, Pt::int64_t now)
+{
+    SentPacket& packet = _sent[seq % PacketWindow];
+    if( ! packet.inFlight || packet.seq != seq )
+        return;
+
+    packet.inFlight = false;
+    _inFlight -= packet.bytes;
+
+    if( ! _hasLargestAcked || isNewer(seq, _largestAcked) )
+    {
+        _hasLargestAcked = true;
+        _largestAcked = seq;
+    }
+
+    // RFC 6298 round trip time estimation
+    Pt::int64_t sample = std::max(now - packet.sentAt, Pt::int64_t(1));
+    if( ! _hasRtt )
+    {
+        _hasRtt = true;
+        _srtt = sample;
+        _rttvar = sample / 2;
+    }
+    else
+    {
+        Pt::int64_t delta = _srtt > sample ? _srtt - sample : sample - _srtt;
+        _rttvar = (3 * _rttvar + delta) / 4;
+        _srtt = (7 * _srtt + sample) / 8;
+    }
+
+    Pt::int64_t granularity = static_cast<Pt::int64_t>(_tickInterval) * 1000;
+    _rto = _srtt + std::max(granularity, 4 * _rttvar);
+    _rto = std::min(std::max(_rto, MinRto), MaxRto);
+
+    // slow start, then additive increase
+    if(_cwnd < _ssthresh)
+        _cwnd += packet.bytes;
+    else
+        _cwnd += std::max<std::size_t>(1, _maxPacketSize * packet.bytes / _cwnd);
+
+    // the packets in flight must fit into the window of sent packets
+    _cwnd = std::min(_cwnd, PacketWindow / 2 * _maxPacketSize);
+
+    for(std::vector<Unit>::iterator it = packet.units.begin(); it != packet.units.end(); ++it)
+    {
+        Fragment* frag = findFragment(*it);
+        if( ! frag || frag->acked )
+            continue;
+
+        frag->acked = true;
+
+        Lane& lane = _lanes[it->lane];
+        OutMessage& msg = lane.out[static_cast<Pt::uint16_t>(it->seq - lane.out.front().seq)];
+        --msg.unacked;
+
+        while( ! lane.out.empty() && lane.out.front().unacked == 0 )
+            lane.out.pop_front();
+    }
+
+    packet.units.clear();
+}
+
+
+void ReliableUdpChannelImpl::detectLosses(Pt::int64_t now)
+{
+    while( ! _flight.empty() )
+    {
+        const SentPacket& packet = _sent[_flight.front() % PacketWindow];
+        if(packet.inFlight && packet.seq == _flight.front())
+            break;
+
+        _flight.pop_front();
+    }
+
+    for(std::deque<Pt::uint16_t>::iterator it = _flight.begin(); it != _flight.end(); ++it)
+    {
+        SentPacket& packet = _sent[*it % PacketWindow];
+        if( ! packet.inFlight || packet.seq != *it )
+            continue;
+
+        bool reordered = _hasLargestAcked && isNewer(_largestAcked, packet.seq) &&
+                         static_cast<Pt::uint16_t>(_largestAcked - packet.seq) >= ReorderThreshold;
+
+        if( reordered || now - packet.sentAt > _rto )
+            onPacketLost(packet, now);
+    }
+}
+
+
+void ReliableUdpChannelImpl::onPacketLost(SentPacket& packet, Pt::int64_t now)
+{
+    packet.inFlight = false;
+    _inFlight -= packet.bytes;
+    ++_packetsLost;
+
+    for(std::vector<Unit>::iterator it = packet.units.begin(); it != packet.units.end(); ++it)
+    {
+        Fragment* frag = findFragment(*it);
+        if(frag && ! frag->acked)
+            frag->lost = true;
+    }
+
+    packet.units.clear();
+
+    // reduce the window once per round trip
+    if(packet.sentAt > _recoveryStart)
+    {
+        _ssthresh = std::max(_cwnd / 2, 2 * _maxPacketSize);
+        _cwnd = _ssthresh;
+        _recoveryStart = now;
+
+        log_debug("packet " << packet.seq << " lost, cwnd " << _cwnd);
+    }
+}
+
+
+ReliableUdpChannelImpl::Fragment* ReliableUdpChannelImpl::findFragment(const Unit& unit)
+{
+    Lane& lane = _lanes[unit.lane];
+    if( lane.out.empty() )
+        return 0;
+
+    Pt::uint16_t index = unit.seq - lane.out.front().seq;
+    if(index >= lane.out.size())
+        return 0;
+
+    OutMessage& msg = lane.out[index];
+    if(msg.seq != unit.seq || unit.frag >= msg.frags.size())
+        return 0;
+
+    return &msg.frags[unit.frag];
+}
+
+
+void ReliableUdpChannelImpl::sendPackets(Pt::int64_t now)
+{
+    // refill the pacing budget at 1.25 times the window per round trip
+    Pt::int64_t elapsed = now - _lastRefill;
+    _lastRefill = now;
+
+    Pt::int64_t rate = static_cast<Pt::int64_t>(_cwnd) * elapsed * 5 / (4 * _srtt);
+    Pt::int64_t burst = static_cast<Pt::int64_t>( std::max(_cwnd, 2 * _maxPacketSize) );
+    _budget = std::min(_budget + rate, burst);
+
+    // unreliable messages are sent first, they are only valid for
+    // this update, while reliable messages can wait for the next one
+    bool sent = true;
+    while( ! _unsent.empty() )
+    {
+        if(sent)
+        {
+            Unsent& msg = _unsent.front();
+
+            Unit unit;
+            unit.lane = msg.lane;
+            unit.frag = 0;
+            unit.seq = msg.seq;
+
+            sent = writeChunk(unit, msg.data.data(), msg.data.size(), 1, now);
+        }
+
+        _unsent.pop_front();
+    }
+
+    if(sent)
+        sendReliable(now);
+
+    if(_packetSize > 0)
+        finishPacket(now);
+
+    // acknowledge or keep the peer alive without data
+    if(_batchSize == 0 && (_ackPending || now - _lastSend > KeepAliveInterval))
+    {
+        beginPacket(false);
+        finishPacket(now);
+    }
+
+    flushPackets(now);
+}
+
+
+bool ReliableUdpChannelImpl::sendReliable(Pt::int64_t now)
+{
+    const std::size_t laneCount = _lanes.size();
+
+    for(std::size_t l = 0; l < laneCount; ++l)
+    {
+        // start with another lane in each update
+        std::size_t index = (_nextLane + l) % laneCount;
+        Lane& lane = _lanes[index];
+
+        std::size_t window = std::min(lane.out.size(), MessageWindow);
+        for(std::size_t m = 0; m < window; ++m)
+        {
+            OutMessage& msg = lane.out[m];
+            if(msg.unacked == 0)
+                continue;
+
+            const std::size_t count = msg.frags.size();
+            for(std::size_t f = 0; f < count; ++f)
+            {
+                Fragment& frag = msg.frags[f];
+                if( frag.acked )
+                    continue;
+
+                if(frag.sentAt != 0 && ! frag.lost && now - frag.sentAt <= _rto)
+                    continue;
+
+                std::size_t offset = f * fragmentSize();
+                std::size_t len = count == 1 ? msg.data.size()
+                                             : std::min(fragmentSize(), msg.data.size() - offset);
+
+                Unit unit;
+                unit.lane = static_cast<Pt::uint8_t>(index);
+                unit.frag = static_cast<Pt::uint8_t>(f);
+                unit.seq = msg.seq;
+
+                if( ! writeChunk(unit, msg.data.data() + offset, len, count, now) )
+                {
+                    _nextLane = (index + 1) % laneCount;
+                    return false;
+                }
+
+                frag.sentAt = now;
+                frag.lost = false;
+            }
+        }
+    }
+
+    if(laneCount > 0)
+        _nextLane = (_nextLane + 1) % laneCount;
+
+    return true;
+}
+
+
+bool ReliableUdpChannelImpl::writeChunk(const Unit& unit, const char* data, std::size_t n,
+                                        std::size_t count, Pt::int64_t now)
+{
+    std::size_t size = ChunkHeaderSize + n;
+    if(count > 1)
+        size += FragmentHeaderSize;
+
+    if(_packetSize > 0 && _packetSize + size > _maxPacketSize)
+        finishPacket(now);
+
+    if(_packetSize == 0 && ! beginPacket(true))
+        return false;
+
+    char* p = &_sendBuffer[_batchSize * _maxPacketSize] + _packetSize;
+    p[0] = static_cast<char>(unit.lane);
+    p[1] = static_cast<char>(count > 1 ? FragmentFlag : 0);
+    put16(p + 2, unit.seq);
+    put16(p + 4, static_cast<Pt::uint16_t>(n));
+    p += ChunkHeaderSize;
+
+    if(count > 1)
+    {
+        p[0] = static_cast<char>(unit.frag);
+        p[1] = static_cast<char>(count);
+        p += FragmentHeaderSize;
+    }
+
+    if(n > 0)
+        std::memcpy(p, data, n);
+
+    _packetSize += size;
+
+    if( _lanes[unit.lane].isReliable() )
+        _packetUnits.push_back(unit);
+
+    return true;
+}
+
+
+bool ReliableUdpChannelImpl::beginPacket(bool congestionControlled)
+{
+    if(congestionControlled)
+    {
+        // one packet may always be in flight, so that the window can recover
+        bool windowFull = _inFlight > 0 && _inFlight + _maxPacketSize > _cwnd;
+        if(windowFull || _budget < static_cast<Pt::int64_t>(_maxPacketSize))
+            return false;
+    }
+
+    if(_batchSize == MaxBatch)
+        flushPackets(monotonicTime());
+
+    // the packet which used the slot before is considered lost
+    SentPacket& previous = _sent[_localSeq % PacketWindow];
+    if(previous.inFlight)
+        onPacketLost(previous, monotonicTime());
+
+    char* p = &_sendBuffer[_batchSize * _maxPacketSize];
+    put16(p, ProtocolId);
+    p[2] = static_cast<char>(_hasRemoteSeq ? AckFlag : 0);
+    put16(p + 3, _localSeq);
+    put16(p + 5, _remoteSeq);
+    put32(p + 7, _remoteBits);
+
+    _packetSize = PacketHeaderSize;
+    _packetTracked = congestionControlled;
+    _ackPending = false;
+    return true;
+}
+
+
+void ReliableUdpChannelImpl::finishPacket(Pt::int64_t now)
+{
+    const Pt::uint16_t seq = _localSeq++;
+
+    if(_packetTracked)
+    {
+        SentPacket& packet = _sent[seq % PacketWindow];
+        packet.inFlight = true;
+        packet.seq = seq;
+        packet.sentAt = now;
+        packet.bytes = _packetSize;
+        packet.units.swap(_packetUnits);
+
+        _flight.push_back(seq);
+        _inFlight += _packetSize;
+        _budget -= static_cast<Pt::int64_t>(_packetSize);
+    }
+
+    _packetUnits.clear();
+
+    _batchBytes[_batchSize] = _packetSize;
+    _batchTracked[_batchSize] = _packetTracked;
+    _batchSeq[_batchSize] = seq;
+    ++_batchSize;
+
+    _packetSize = 0;
+    _lastSend = now;
+}
+
+
+void ReliableUdpChannelImpl::flushPackets(Pt::int64_t now)
+{
+    if(_batchSize == 0)
+        return;
+
+    Datagram dgrams[MaxBatch];
+    for(std::size_t n = 0; n < _batchSize; ++n)
+        dgrams[n] = Datagram(&_sendBuffer[n * _maxPacketSize], _batchBytes[n]);
+
+    std::size_t sent = 0;
+    try
+    {
+        sent = _socket.send(dgrams, _batchSize);
+    }
+    catch(const System::IOError& e)
+    {
+        // for example, the peer port is not open yet
+        log_debug("send failed: " << e.what());
+    }
+
+    // packets that did not fit into the socket buffer are lost
+    for(std::size_t n = sent; n < _batchSize; ++n)
+    {
+        SentPacket& packet = _sent[_batchSeq[n] % PacketWindow];
+        if(_batchTracked[n] && packet.inFlight && packet.seq == _batchSeq[n])
+            onPacketLost(packet, now);
+    }
+
+    _batchSize = 0;
+}
+
+//
+// ReliableUdpChannel
+//
+
+ReliableUdpChannel::ReliableUdpChannel()
+: _impl(0)
+{
+    _impl = new ReliableUdpChannelImpl(*this);
+}
+
+
+ReliableUdpChannel::~ReliableUdpChannel()
+{
+    delete _impl;
+}
+
+
+std::size_t ReliableUdpChannel::addLane(Delivery delivery)
+{
+    return _impl->addLane(delivery);
+}
+
+
+std::size_t ReliableUdpChannel::laneCount() const
+{
+    return _impl->laneCount();
+}
+
+
+void ReliableUdpChannel::open(const Endpoint& local, const Endpoint& peer)
+{
+    _impl->open(local, peer);
+}
+
+
+void ReliableUdpChannel::close()
+{
+    _impl->close();
+}
+
+
+bool ReliableUdpChannel::isOpen() const
+{
+    return _impl->isOpen();
+}
+
+
+void ReliableUdpChannel::setActive(System::EventLoop& loop)
+{
+    _impl->setActive(loop);
+}
+
+
+void ReliableUdpChannel::detach()
+{
+    _impl->detach();
+}
+
+
+std::size_t ReliableUdpChannel::tickInterval() const
+{
+    return _impl->tickInterval();
+}
+
+
+void ReliableUdpChannel::setTickInterval(std::size_t msecs)
+{
+    _impl->setTickInterval(msecs);
+}
+
+
+std::size_t ReliableUdpChannel::maxPacketSize() const
+{
+    return _impl->maxPacketSize();
+}
+
+
+void ReliableUdpChannel::setMaxPacketSize(std::size_t n)
+{
+    _impl->setMaxPacketSize(n);
+}
+
+
+std::size_t ReliableUdpChannel::timeout() const
+{
+    return _impl->timeout();
+}
+
+
+void ReliableUdpChannel::setTimeout(std::size_t msecs)
+{
+    _impl->setTimeout(msecs);
+}
+
+
+void ReliableUdpChannel::send(std::size_t lane, const char* data, std::size_t n)
+{
+    _impl->send(lane, data, n);
+}
+
+
+bool ReliableUdpChannel::receive(std::string& data, std::size_t& lane)
+{
+    return _impl->receive(data, lane);
+}
+
+
+void ReliableUdpChannel::update()
+{
+    _impl->update();
+}
+
+
+Pt::int64_t ReliableUdpChannel::roundTripTime() const
+{
+    return _impl->roundTripTime();
+}
+
+
+std::size_t ReliableUdpChannel::congestionWindow() const
+{
+    return _impl->congestionWindow();
+}
+
+
+std::size_t ReliableUdpChannel::bytesInFlight() const
+{
+    return _impl->bytesInFlight();
+}
+
+
+Pt::uint64_t ReliableUdpChannel::packetsLost() const
+{
+    return _impl->packetsLost();
+}
+
+
+UdpSocket& ReliableUdpChannel::socket()
+{
+    return _impl->socket();
+}
+
+} // namespace Net
+
+} // namespace Pt
@@ -41,6 +41,10 @@ TcpServerOptions::TcpServerOptions(int backlog)
 : _flags(0)
 , _backlog(backlog)
 , _deferAccept(-1)
+, _acceptBatch(32)
+, _sndbufSize(0)
+, _rcvbufSize(0)
+, _incomingCpu(-1)
 {}
 
 
@@ -48,6 +52,10 @@ TcpServerOptions::TcpServerOptions(const TcpServerOptions& opts)
 : _flags(opts._flags)
 , _backlog(opts._backlog)
 , _deferAccept(opts._deferAccept)
+, _acceptBatch(opts._acceptBatch)
+, _sndbufSize(opts._sndbufSize)
+, _rcvbufSize(opts._rcvbufSize)
+, _incomingCpu(opts._incomingCpu)
 {
 }
 
@@ -62,6 +70,10 @@ TcpServerOptions& TcpServerOptions::operator=(const TcpServerOptions& opts)
     _flags = opts._flags;
     _backlog = opts._backlog;
     _deferAccept = opts._deferAccept;
+    _acceptBatch = opts._acceptBatch;
+    _sndbufSize = opts._sndbufSize;
+    _rcvbufSize = opts._rcvbufSize;
+    _incomingCpu = opts._incomingCpu;
     return *this;
 }
 
@@ -145,6 +157,12 @@ void TcpServer::close()
 }
 
 
+void TcpServer::localEndpoint(Endpoint& ep) const
+{
+    _impl->localEndpoint(ep);
+}
+
+
 void TcpServer::onAttach(System::EventLoop& loop)
 {
     _loop = &loop;
@@ -29,6 +29,7 @@
 #include "TcpSocketImpl.h"
 #include <Pt/Net/TcpSocket.h>
 #include <Pt/System/EventLoop.h>
+#include <Pt/System/IOError.h>
 #include <stdexcept>
 #include <memory>
 #include <cassert>
@@ -39,11 +40,28 @@ namespace Net {
 
 TcpSocketOptions::TcpSocketOptions()
 : _flags(0)
+, _sndbufSize(0)
+, _rcvbufSize(0)
+, _busyPoll(0)
+, _notSentLowat(0)
+, _incomingCpu(-1)
+, _keepIdle(0)
+, _keepInterval(0)
+, _keepCount(0)
 {
 }
 
 
 TcpSocketOptions::TcpSocketOptions(const TcpSocketOptions& opts)
+: _flags(opts._flags)
+, _sndbufSize(opts._sndbufSize)
+, _rcvbufSize(opts._rcvbufSize)
+, _busyPoll(opts._busyPoll)
+, _notSentLowat(opts._notSentLowat)
+, _incomingCpu(opts._incomingCpu)
+, _keepIdle(opts._keepIdle)
+, _keepInterval(opts._keepInterval)
+, _keepCount(opts._keepCount)
 {
 }
 
@@ -55,6 +73,15 @@ TcpSocketOptions::~TcpSocketOptions()
 
 TcpSocketOptions& TcpSocketOptions::operator=(const TcpSocketOptions& opts)
 {
+    _flags = opts._flags;
+    _sndbufSize = opts._sndbufSize;
+    _rcvbufSize = opts._rcvbufSize;
+    _busyPoll = opts._busyPoll;
+    _notSentLowat = opts._notSentLowat;
+    _incomingCpu = opts._incomingCpu;
+    _keepIdle = opts._keepIdle;
+    _keepInterval = opts._keepInterval;
+    _keepCount = opts._keepCount;
     return *this;
 }
 
@@ -65,6 +92,8 @@ TcpSocket::TcpSocket()
 : _impl(0)
 , _connecting(false)
 , _isConnected(false)
+, _sendFile(0)
+, _sendFileOffset(0)
 {
     _impl = new TcpSocketImpl(*this);
 }
@@ -74,6 +103,8 @@ TcpSocket::TcpSocket(System::EventLoop& loop)
 : _impl(0)
 , _connecting(false)
 , _isConnected(false)
+, _sendFile(0)
+, _sendFileOffset(0)
 {
     _impl = new TcpSocketImpl(*this);
     std::auto_ptr<TcpSocketImpl> impl(_impl);
@@ -87,6 +118,8 @@ TcpSocket::TcpSocket(TcpServer& server)
 : _impl(0)
 , _connecting(false)
 , _isConnected(false)
+, _sendFile(0)
+, _sendFileOffset(0)
 {
     _impl = new TcpSocketImpl(*this);
     std::auto_ptr<TcpSocketImpl> impl(_impl);
@@ -100,6 +133,8 @@ TcpSocket::TcpSocket(const Endpoint& ep)
 : _impl(0)
 , _connecting(false)
 , _isConnected(false)
+, _sendFile(0)
+, _sendFileOffset(0)
 {
     _impl = new TcpSocketImpl(*this);
     std::auto_ptr<TcpSocketImpl> impl(_impl);
@@ -216,8 +251,76 @@ void TcpSocket::remoteEndpoint(Endpoint& ep) const
 }
 
 
+void TcpSocket::beginSendFile(System::FileDevice& file, Pt::uint64_t offset, std::size_t length)
+{
+    System::EventLoop* loop = this->loop();
+    if( ! loop )
+        throw std::logic_error("I/O device not active");
+
+    if( _rbuf || _wbuf )
+        throw System::IOPending("I/O operation pending");
+
+    std::size_t r = _impl->beginSendFile(*loop, file, offset, length);
+
+    if(r > 0)
+    {
+        loop->setReady(*this);
+    }
+    else
+    {
+        _sendFile = &file;
+        _sendFileOffset = offset;
+    }
+
+    // the write buffer only marks the pending operation
+    _wbuf = reinterpret_cast<const char*>(&file);
+    _wbuflen = length;
+    _wavail = r;
+}
+
+
+std::size_t TcpSocket::sendFile(System::FileDevice& file, Pt::uint64_t offset, std::size_t length)
+{
+    if( _rbuf || _wbuf )
+        throw System::IOPending("I/O operation pending");
+
+    return _impl->sendFile(file, offset, length);
+}
+
+
+void TcpSocket::setNoDelay(bool on)
+{
+    _impl->setNoDelay(on);
+}
+
+
+void TcpSocket::setCork(bool on)
+{
+    _impl->setCork(on);
+}
+
+
+void TcpSocket::setQuickAck(bool on)
+{
+    _impl->setQuickAck(on);
+}
+
+
+void TcpSocket::options(TcpSocketOptions& o) const
+{
+    _impl->options(o);
+}
+
+
+bool TcpSocket::tcpInfo(TcpInfo& info) const
+{
+    return _impl->tcpInfo(info);
+}
+
+
 void TcpSocket::onClose()
 {
+    _sendFile = 0;
     _impl->close();
     _connecting = false;
     _isConnected = false;
@@ -291,6 +394,13 @@ std::size_t TcpSocket::onBeginWrite(System::EventLoop& loop, const char* buffer,
 
 std::size_t TcpSocket::onEndWrite(System::EventLoop& loop, const char* buffer, std::size_t n)
 {
+    if(_sendFile)
+    {
+        System::FileDevice* file = _sendFile;
+        _sendFile = 0;
+        return _impl->endSendFile(loop, *file, _sendFileOffset, n);
+    }
+
     return _impl->endWrite(loop, buffer, n);
 }
 
@@ -301,6 +411,42 @@ std::size_t TcpSocket::onWrite(const char* buffer, std::size_t count)
 }
 
 
+std::size_t TcpSocket::onBeginReadv(System::EventLoop& loop, System::IOVec* vec, std::size_t count, bool& eof)
+{
+    return _impl->beginReadv(loop, vec, count, eof);
+}
+
+
+std::size_t TcpSocket::onEndReadv(System::EventLoop& loop, System::IOVec* vec, std::size_t count, bool& eof)
+{
+    return _impl->endReadv(loop, vec, count, eof);
+}
+
+
+std::size_t TcpSocket::onReadv(System::IOVec* vec, std::size_t count, bool& eof)
+{
+    return _impl->readv(vec, count, eof);
+}
+
+
+std::size_t TcpSocket::onBeginWritev(System::EventLoop& loop, const System::IOVec* vec, std::size_t count)
+{
+    return _impl->beginWritev(loop, vec, count);
+}
+
+
+std::size_t TcpSocket::onEndWritev(System::EventLoop& loop, const System::IOVec* vec, std::size_t count)
+{
+    return _impl->endWritev(loop, vec, count);
+}
+
+
+std::size_t TcpSocket::onWritev(const System::IOVec* vec, std::size_t count)
+{
+    return _impl->writev(vec, count);
+}
+
+
 void TcpSocket::onCancel()
 {
     System::EventLoop* loop = this->loop();
@@ -310,6 +456,8 @@ void TcpSocket::onCancel()
         _connecting = false;
     }
 
+    _sendFile = 0;
+
     IODevice::onCancel();
 }
 
@@ -70,6 +70,7 @@ UdpSocket::UdpSocket()
 : _impl(0)
 , _connecting(false)
 , _binding(false)
+, _sendingTo(false)
 {
     _impl = new UdpSocketImpl(*this);
 }
@@ -79,6 +80,7 @@ UdpSocket::UdpSocket(System::EventLoop& loop)
 : _impl(0)
 , _connecting(false)
 , _binding(false)
+, _sendingTo(false)
 {
     _impl = new UdpSocketImpl(*this);
     std::auto_ptr<UdpSocketImpl> impl(_impl);
@@ -267,6 +269,59 @@ const Endpoint& UdpSocket::remoteEndpoint() const
 }
 
 
+std::size_t UdpSocket::sendTo(const Endpoint& ep, const char* buffer, std::size_t n)
+{
+    if( isReading() || isWriting() )
+        throw System::IOPending("I/O operation pending");
+
+    _impl->setDestination(ep);
+    _sendingTo = true;
+
+    return this->write(buffer, n);
+}
+
+
+void UdpSocket::beginSendTo(const Endpoint& ep, const char* buffer, std::size_t n)
+{
+    if( ! this->loop() )
+        throw std::logic_error( PT_ERROR_MSG("socket not active") );
+
+    if( isReading() || isWriting() )
+        throw System::IOPending("I/O operation pending");
+
+    _impl->setDestination(ep);
+    _sendingTo = true;
+
+    this->beginWrite(buffer, n);
+}
+
+
+std::size_t UdpSocket::receiveFrom(char* buffer, std::size_t n, Endpoint& from)
+{
+    std::size_t ret = this->read(buffer, n);
+    from = _impl->remoteEndpoint();
+    return ret;
+}
+
+
+std::size_t UdpSocket::receive(Datagram* dgrams, std::size_t count)
+{
+    if( isReading() || isWriting() )
+        throw System::IOPending("I/O operation pending");
+
+    return _impl->receive(dgrams, count);
+}
+
+
+std::size_t UdpSocket::send(const Datagram* dgrams, std::size_t count)
+{
+    if( isReading() || isWriting() )
+        throw System::IOPending("I/O operation pending");
+
+    return _impl->send(dgrams, count);
+}
+
+
 void UdpSocket::onClose()
 {
     _impl->close();
@@ -348,6 +403,11 @@ std::size_t UdpSocket::onRead(char* buffer, std::size_t count, bool& eof)
 
 std::size_t UdpSocket::onBeginWrite(System::EventLoop& loop, const char* buffer, std::size_t n)
 {
+    // a plain write goes to the target, unless started by beginSendTo()
+    if( ! _sendingTo )
+        _impl->clearDestination();
+
+    _sendingTo = false;
     return _impl->beginWrite(loop, buffer, n);
 }
 
@@ -360,6 +420,10 @@ std::size_t UdpSocket::onEndWrite(System::EventLoop& loop, const char* buffer, s
 
 std::size_t UdpSocket::onWrite(const char* buffer, std::size_t count)
 {
+    if( ! _sendingTo )
+        _impl->clearDestination();
+
+    _sendingTo = false;
     return _impl->write(buffer, count);
 }
 
@@ -50,6 +50,28 @@ EndpointImpl::EndpointImpl(const std::string& ipaddr, unsigned short port)
     std::stringstream ss;
     ss << port;
     ss >> _service;
+
+    // numeric addresses are kept as sockaddr, so that sockets can use
+    // them without a lookup. Host names are resolved when used.
+    if( _host.empty() )
+        return;
+
+    struct addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_flags = AI_NUMERICHOST;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    struct addrinfo* result = 0;
+    if( 0 != ::getaddrinfo(_host.c_str(), _service.c_str(), &hints, &result) )
+        return;
+
+    if(result && result->ai_addrlen <= sizeof(_addr))
+    {
+        std::memcpy(&_addr, result->ai_addr, result->ai_addrlen);
+        _addrlen = result->ai_addrlen;
+    }
+
+    ::freeaddrinfo(result);
 }
 
 
@@ -27,6 +27,7 @@
  */
 
 #include "AddrInfo.h"
+#include "EndpointImpl.h"
 #include "TcpServerImpl.h"
 #include "MainLoopImpl.h"
 #include "IODeviceImpl.h"
@@ -53,7 +54,7 @@ TcpServerImpl::TcpServerImpl(TcpServer& server)
 : _server(server)
 , _ioh(server)
 , _timeout(Pt::System::EventLoop::WaitInfinite)
-, _acceptedFd(-1)
+, _acceptBatch(1)
 {
 }
 
@@ -76,11 +77,7 @@ void TcpServerImpl::create(int domain, int type, int protocol)
 
 void TcpServerImpl::close()
 {
-    if(_acceptedFd != -1)
-    {
-        ::close(_acceptedFd);
-        _acceptedFd = -1;
-    }
+    clearAccepted();
 
     if (_ioh.fd < 0)
       return;
@@ -92,6 +89,22 @@ void TcpServerImpl::close()
 }
 
 
+void TcpServerImpl::localEndpoint(Endpoint& ep) const
+{
+    struct sockaddr_storage addr;
+    socklen_t slen = sizeof(addr);
+
+    int ret = -1;
+    if(_ioh.fd >= 0)
+        ret = ::getsockname(_ioh.fd, reinterpret_cast<struct sockaddr*>(&addr), &slen);
+
+    if(ret == 0)
+        ep.impl()->init( (sockaddr*)&addr, slen );
+    else
+        ep.clear();
+}
+
+
 void TcpServerImpl::listen(const Endpoint& ep, const TcpServerOptions& options)
 {
     static const int on = 1;
@@ -119,6 +132,43 @@ void TcpServerImpl::listen(const Endpoint& ep, const TcpServerOptions& options)
             throw System::SystemError("setsockopt SO_REUSEADDR");
         }
 
+#ifdef SO_REUSEPORT
+        if( options.reusePort() )
+        {
+            log_debug("setsockopt SO_REUSEPORT");
+            if (::setsockopt(this->fd(), SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0)
+            {
+                close();
+                throw System::SystemError("setsockopt SO_REUSEPORT");
+            }
+        }
+#endif
+
+        // buffer sizes are inherited by accepted sockets and must be
+        // set before listen to affect the window scaling
+        int sndbuf = options.sendBufferSize();
+        if( sndbuf > 0 && ::setsockopt(this->fd(), SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf)) < 0 )
+        {
+            close();
+            throw System::SystemError("setsockopt SO_SNDBUF");
+        }
+
+        int rcvbuf = options.receiveBufferSize();
+        if( rcvbuf > 0 && ::setsockopt(this->fd(), SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf)) < 0 )
+        {
+            close();
+            throw System::SystemError("setsockopt SO_RCVBUF");
+        }
+
+#ifdef SO_INCOMING_CPU
+        int cpu = options.incomingCpu();
+        if( cpu >= 0 && ::setsockopt(this->fd(), SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu)) < 0 )
+        {
+            close();
+            throw System::SystemError("setsockopt SO_INCOMING_CPU");
+        }
+#endif
+
 #ifdef IPPROTO_IPV6
         if (it->ai_family == AF_INET6)
         {
@@ -155,8 +205,12 @@ void TcpServerImpl::listen(const Endpoint& ep, const TcpServerOptions& options)
             // save our information
             std::memmove(&_servaddr, it->ai_addr, it->ai_addrlen);
 
-            log_debug("listen " << this->fd());
-            if( ::listen(this->fd(), options.backlog()) < 0 )
+            _acceptBatch = options.acceptBatch();
+
+            int backlog = options.backlog() < 0 ? SOMAXCONN : options.backlog();
+
+            log_debug("listen " << this->fd() << " backlog " << backlog);
+            if( ::listen(this->fd(), backlog) < 0 )
             {
                 close();
 
@@ -212,27 +266,78 @@ void TcpServerImpl::beginAccept(System::EventLoop& loop)
 
     log_debug("begin accept " << this->fd());
 
-    sockaddr_storage peeraddr;
-    socklen_t peeraddr_len = sizeof(peeraddr);
-    int fd = ::accept(this->fd(), reinterpret_cast <struct sockaddr*>(&peeraddr), &peeraddr_len);
-    log_debug("accepted: " << fd);
+    // drain the pending connections, so that a storm of connections
+    // does not need one wakeup of the loop per connection
+    while(_accepted.size() < _acceptBatch)
+    {
+        int fd = acceptConnection();
+        if(fd < 0)
+            break;
+
+        _accepted.push_back(fd);
+    }
 
-    if(fd != -1)
+    if( ! _accepted.empty() )
     {
-        _acceptedFd = fd;
-        log_debug("immediate accept " << this->fd());
+        log_debug("immediate accept " << this->fd() << ", " << _accepted.size() << " queued");
         loop.setReady(_server);
         return;
     }
 
-    if(errno != EAGAIN && errno != EINPROGRESS) // EWOULDBLOCK
+    log_debug("wait for accept " << this->fd());
+
+    System::Selector& selector = loop.selector();
+    if( ! selector.submitAccept(&_ioh) )
+        selector.beginRead( &_ioh );
+}
+
+
+int TcpServerImpl::acceptConnection()
+{
+    sockaddr_storage peeraddr;
+    socklen_t peeraddr_len = sizeof(peeraddr);
+    sockaddr* addr = reinterpret_cast<struct sockaddr*>(&peeraddr);
+
+    for(;;)
     {
+#if defined(SOCK_NONBLOCK) && defined(SOCK_CLOEXEC)
+        int fd = ::accept4(this->fd(), addr, &peeraddr_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+        int fd = ::accept(this->fd(), addr, &peeraddr_len);
+        if(fd >= 0)
+        {
+            int flags = ::fcntl(fd, F_GETFL);
+            ::fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+
+            flags = ::fcntl(fd, F_GETFD);
+            ::fcntl(fd, F_SETFD, flags | FD_CLOEXEC);
+        }
+#endif
+        if(fd >= 0)
+        {
+            log_debug("accepted: " << fd);
+            return fd;
+        }
+
+        // the connection was reset while it was pending
+        if(errno == EINTR || errno == ECONNABORTED)
+            continue;
+
+        if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINPROGRESS)
+            return -1;
+
         log_debug("accept failed " << this->fd());
         throw System::IOError("accept");
     }
+}
 
-    log_debug("wait for accept " << this->fd());
-    loop.selector().beginRead( &_ioh );
+
+void TcpServerImpl::clearAccepted()
+{
+    for(std::deque<int>::iterator it = _accepted.begin(); it != _accepted.end(); ++it)
+        ::close(*it);
+
+    _accepted.clear();
 }
 
 
@@ -240,11 +345,11 @@ int TcpServerImpl::accept(const TcpSocketOptions& o)
 {
     log_debug( "accept " << this->fd() );
 
-    // connection immediately accepted in beginAccept
-    if(_acceptedFd != -1)
+    // connections accepted in beginAccept
+    if( ! _accepted.empty() )
     {
-        int fd = _acceptedFd;
-        _acceptedFd = -1;
+        int fd = _accepted.front();
+        _accepted.pop_front();
         return fd;
     }
 
@@ -253,27 +358,32 @@ int TcpServerImpl::accept(const TcpSocketOptions& o)
     {
          log_debug("end accept " << this->fd());
         _server.loop()->selector().endRead( &_ioh );
+
+        // connection accepted by a completion-based selector
+        ssize_t result = 0;
+        if( _ioh.takeResult(System::IOHandle::Read, result) )
+        {
+            if(result >= 0)
+                return static_cast<int>(result);
+
+            if(result != -EAGAIN && result != -ECONNABORTED && result != -EINTR)
+            {
+                log_debug("accept failed " << this->fd());
+                throw System::IOError("accept");
+            }
+        }
     }
 
     // in any case block until connection is accepted
     
-    //TODO ECONNABORTED EINTR EPERM    
-    sockaddr_storage peeraddr;
-    socklen_t peeraddr_len = sizeof(peeraddr);
     int fd = -1;
 
     while(fd < 0)
     {
-        fd = ::accept(this->fd(), reinterpret_cast <struct sockaddr*>(&peeraddr), &peeraddr_len);
+        fd = acceptConnection();
         if(fd >= 0)
             break;
 
-        if(errno != EAGAIN && errno != EINPROGRESS)
-        {
-            log_debug("accept failed " << this->fd());
-            throw System::IOError("accept");
-        }
-        
         fd_set rfds;
         FD_ZERO(&rfds);
         FD_SET(this->fd(), &rfds);
@@ -288,11 +398,7 @@ int TcpServerImpl::accept(const TcpSocketOptions& o)
 
 void TcpServerImpl::cancel(System::EventLoop& loop)
 {
-    if(_acceptedFd != -1)
-    {
-        ::close(_acceptedFd);
-        _acceptedFd = -1;
-    }
+    clearAccepted();
 
     if( this->fd() < 0 )
         return;
@@ -306,7 +412,7 @@ bool TcpServerImpl::run(System::EventLoop& loop)
     if(this->fd() < 0)
         return false;
 
-    if(_acceptedFd != -1)
+    if( ! _accepted.empty() )
     {
         return true;
     }
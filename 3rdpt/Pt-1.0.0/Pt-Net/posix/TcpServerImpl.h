@@ -34,6 +34,7 @@
 #include <Pt/Net/TcpSocket.h>
 #include "Selector.h"
 #include <string>
+#include <deque>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/select.h>
@@ -57,7 +58,8 @@ class TcpServerImpl
         TcpServer& _server;
         System::IOHandle _ioh;
         size_t _timeout;
-        int _acceptedFd;
+        std::size_t _acceptBatch;
+        std::deque<int> _accepted;
         struct sockaddr_storage _servaddr;
 
     public:
@@ -76,6 +78,8 @@ class TcpServerImpl
 
         void close();
 
+        void localEndpoint(Endpoint& ep) const;
+
         void listen(const std::string& ipaddr,
                     unsigned short int port,
                     const TcpServerOptions& options);
@@ -90,11 +94,17 @@ class TcpServerImpl
         int fd() const
         { return _ioh.fd; }
 
+        //! Returns a non-blocking, close-on-exec descriptor
         int accept(const TcpSocketOptions& o);
 
         void cancel(System::EventLoop& s);
     
         bool run(System::EventLoop& loop);
+
+    private:
+        int acceptConnection();
+
+        void clearAccepted();
 };
 
 } // namespace Net
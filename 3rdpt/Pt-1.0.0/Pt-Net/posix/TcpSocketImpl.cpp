@@ -31,6 +31,7 @@
 #include "TcpSocketImpl.h"
 #include "TcpServerImpl.h"
 #include "MainLoopImpl.h"
+#include "FileDeviceImpl.h"
 #include "Pt/Net/Endpoint.h"
 #include "Pt/Net/TcpServer.h"
 #include "Pt/Net/TcpSocket.h"
@@ -43,8 +44,16 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <sys/select.h>
 #include <sys/time.h>
+#include <fcntl.h>
+#include <poll.h>
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#endif
 
 log_define("Pt.Net.TcpSocket");
 
@@ -52,10 +61,74 @@ namespace Pt {
 
 namespace Net {
 
+namespace {
+
+void setSocketOption(int fd, int level, int name, int value, const char* what)
+{
+    if( ::setsockopt(fd, level, name, &value, sizeof(value)) < 0 )
+    {
+        log_debug("setsockopt " << what << " failed " << fd);
+        throw System::SystemError(what);
+    }
+}
+
+
+int getSocketOption(int fd, int level, int name, const char* what)
+{
+    int value = 0;
+    socklen_t len = sizeof(value);
+
+    if( ::getsockopt(fd, level, name, &value, &len) < 0 )
+    {
+        log_debug("getsockopt " << what << " failed " << fd);
+        throw System::SystemError(what);
+    }
+
+    return value;
+}
+
+
+// sends a file through a buffer, if the system can not send it directly
+ssize_t copyFile(int out, int in, Pt::uint64_t offset, std::size_t n)
+{
+    char buffer[16384];
+    std::size_t len = n < sizeof(buffer) ? n : sizeof(buffer);
+
+    ssize_t ret = ::pread(in, buffer, len, static_cast<off_t>(offset));
+    if(ret <= 0)
+        return ret;
+
+    // the data is read again at the same offset, if it could not be written
+    return ::write(out, buffer, static_cast<std::size_t>(ret));
+}
+
+
+// true if a pipe has data or its writer was closed
+bool hasInput(int fd)
+{
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    int ret = 0;
+    do
+    {
+        ret = ::poll(&pfd, 1, 0);
+    }
+    while(ret == -1 && errno == EINTR);
+
+    return ret != 0;
+}
+
+}
+
 TcpSocketImpl::TcpSocketImpl(TcpSocket& socket)
 : System::IODeviceImpl(socket)
 , _socket(socket)
 , _errorPending(false)
+, _source(socket)
+, _sourcePending(false)
 {
 }
 
@@ -85,6 +158,13 @@ void TcpSocketImpl::cancel(System::EventLoop& loop)
         IODeviceImpl::cancel(loop);
     }
 
+    if(_sourcePending)
+    {
+        loop.selector().cancel(_source);
+        _source.fd = -1;
+        _sourcePending = false;
+    }
+
     _errorPending = false;
 }
 
@@ -92,18 +172,316 @@ void TcpSocketImpl::cancel(System::EventLoop& loop)
 void TcpSocketImpl::accept(TcpServer& server, const TcpSocketOptions& o)
 {
     int fd = server.impl().accept(o);
+    System::IODeviceImpl::adopt(fd);
 
-    bool inherit = false;
-    System::IODeviceImpl::open(fd, inherit);
+    this->setOptions(o);
 
     log_debug( "accepted " << server.impl().fd() << " => " << this->fd() );
 }
 
 
-void TcpSocketImpl::connect(const Endpoint& ep, const TcpSocketOptions&)
+void TcpSocketImpl::setOptions(const TcpSocketOptions& o)
+{
+    const int fd = this->fd();
+
+    if( o.isNoDelay() )
+        setSocketOption(fd, IPPROTO_TCP, TCP_NODELAY, 1, "setsockopt TCP_NODELAY");
+
+    if( o.isQuickAck() )
+        this->setQuickAck(true);
+
+    if( o.isCork() )
+        this->setCork(true);
+
+    if( o.sendBufferSize() > 0 )
+        setSocketOption(fd, SOL_SOCKET, SO_SNDBUF, o.sendBufferSize(), "setsockopt SO_SNDBUF");
+
+    if( o.receiveBufferSize() > 0 )
+        setSocketOption(fd, SOL_SOCKET, SO_RCVBUF, o.receiveBufferSize(), "setsockopt SO_RCVBUF");
+
+#ifdef SO_BUSY_POLL
+    if( o.busyPoll() > 0 )
+        setSocketOption(fd, SOL_SOCKET, SO_BUSY_POLL, o.busyPoll(), "setsockopt SO_BUSY_POLL");
+#endif
+
+#ifdef TCP_NOTSENT_LOWAT
+    if( o.notSentLowWatermark() > 0 )
+        setSocketOption(fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, o.notSentLowWatermark(), "setsockopt TCP_NOTSENT_LOWAT");
+#endif
+
+#ifdef SO_INCOMING_CPU
+    if( o.incomingCpu() >= 0 )
+        setSocketOption(fd, SOL_SOCKET, SO_INCOMING_CPU, o.incomingCpu(), "setsockopt SO_INCOMING_CPU");
+#endif
+
+    if( o.isKeepAlive() )
+    {
+        setSocketOption(fd, SOL_SOCKET, SO_KEEPALIVE, 1, "setsockopt SO_KEEPALIVE");
+
+#if defined(TCP_KEEPIDLE)
+        if( o.keepAliveIdle() > 0 )
+            setSocketOption(fd, IPPROTO_TCP, TCP_KEEPIDLE, o.keepAliveIdle(), "setsockopt TCP_KEEPIDLE");
+#elif defined(TCP_KEEPALIVE)
+        if( o.keepAliveIdle() > 0 )
+            setSocketOption(fd, IPPROTO_TCP, TCP_KEEPALIVE, o.keepAliveIdle(), "setsockopt TCP_KEEPALIVE");
+#endif
+
+#ifdef TCP_KEEPINTVL
+        if( o.keepAliveInterval() > 0 )
+            setSocketOption(fd, IPPROTO_TCP, TCP_KEEPINTVL, o.keepAliveInterval(), "setsockopt TCP_KEEPINTVL");
+#endif
+
+#ifdef TCP_KEEPCNT
+        if( o.keepAliveCount() > 0 )
+            setSocketOption(fd, IPPROTO_TCP, TCP_KEEPCNT, o.keepAliveCount(), "setsockopt TCP_KEEPCNT");
+#endif
+    }
+}
+
+
+void TcpSocketImpl::setNoDelay(bool on)
+{
+    setSocketOption(this->fd(), IPPROTO_TCP, TCP_NODELAY, on ? 1 : 0, "setsockopt TCP_NODELAY");
+}
+
+
+void TcpSocketImpl::setCork(bool on)
+{
+#if defined(TCP_CORK)
+    setSocketOption(this->fd(), IPPROTO_TCP, TCP_CORK, on ? 1 : 0, "setsockopt TCP_CORK");
+#elif defined(TCP_NOPUSH)
+    setSocketOption(this->fd(), IPPROTO_TCP, TCP_NOPUSH, on ? 1 : 0, "setsockopt TCP_NOPUSH");
+#endif
+}
+
+
+void TcpSocketImpl::setQuickAck(bool on)
+{
+#ifdef TCP_QUICKACK
+    setSocketOption(this->fd(), IPPROTO_TCP, TCP_QUICKACK, on ? 1 : 0, "setsockopt TCP_QUICKACK");
+#endif
+}
+
+
+std::size_t TcpSocketImpl::beginSendFile(System::EventLoop& loop, System::FileDevice& file, Pt::uint64_t offset, std::size_t n)
+{
+    log_debug("begin send file on fd:" << this->fd());
+
+    bool sourceEmpty = false;
+    std::size_t ret = this->trySendFile(file, offset, n, sourceEmpty);
+    if(ret > 0)
+        return ret;
+
+    // an empty pipe is waited for instead of the socket, which is
+    // writable and would complete the operation right away
+    if(sourceEmpty)
+    {
+        log_debug("wait for source fd:" << file.impl()->fd());
+
+        _source.fd = file.impl()->fd();
+        _sourcePending = true;
+        loop.selector().beginRead( &_source );
+        return 0;
+    }
+
+    loop.selector().beginWrite( &_ioh );
+    return 0;
+}
+
+
+std::size_t TcpSocketImpl::endSendFile(System::EventLoop& loop, System::FileDevice& file, Pt::uint64_t offset, std::size_t n)
+{
+    log_debug("end send file on fd:" << this->fd());
+
+    if(_sourcePending)
+    {
+        loop.selector().endRead( &_source );
+        _source.fd = -1;
+        _sourcePending = false;
+    }
+    else
+    {
+        loop.selector().endWrite( &_ioh );
+    }
+
+    if(IODeviceImpl::_errorPending)
+    {
+        IODeviceImpl::_errorPending = false;
+        throw System::IOError("write error");
+    }
+
+    return this->sendFile(file, offset, n);
+}
+
+
+std::size_t TcpSocketImpl::sendFile(System::FileDevice& file, Pt::uint64_t offset, std::size_t n)
+{
+    for(;;)
+    {
+        bool sourceEmpty = false;
+        std::size_t ret = this->trySendFile(file, offset, n, sourceEmpty);
+        if(ret > 0)
+            return ret;
+
+        fd_set rfds;
+        fd_set wfds;
+        FD_ZERO(&rfds);
+        FD_ZERO(&wfds);
+
+        if(sourceEmpty)
+            FD_SET(file.impl()->fd(), &rfds);
+        else
+            FD_SET(this->fd(), &wfds);
+
+        if( ! this->wait(timeout(), &rfds, &wfds, 0) )
+            throw System::IOError("send file");
+    }
+}
+
+
+bool TcpSocketImpl::runWrite(System::EventLoop& loop)
+{
+    if( ! _sourcePending )
+        return IODeviceImpl::runWrite(loop);
+
+    System::Selector& selector = loop.selector();
+    return selector.isReadable(&_source) || selector.isError(&_source);
+}
+
+
+std::size_t TcpSocketImpl::trySendFile(System::FileDevice& file, Pt::uint64_t offset, std::size_t n, bool& sourceEmpty)
+{
+    const int in = file.impl()->fd();
+    bool isPipe = false;
+
+    sourceEmpty = false;
+
+    for(;;)
+    {
+#if defined(__linux__)
+        off_t off = static_cast<off_t>(offset);
+        ssize_t ret = ::sendfile(this->fd(), in, &off, n);
+
+        if(ret < 0 && (errno == EINVAL || errno == ESPIPE || errno == ENOSYS))
+        {
+            // pipes can not be mapped, but spliced into the socket
+            struct stat st;
+            isPipe = ::fstat(in, &st) == 0 && S_ISFIFO(st.st_mode);
+
+            if(isPipe)
+                ret = ::splice(in, 0, this->fd(), 0, n, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            else
+                ret = copyFile(this->fd(), in, offset, n);
+        }
+#else
+        ssize_t ret = copyFile(this->fd(), in, offset, n);
+#endif
+
+        if(ret > 0)
+        {
+            log_debug("sent file:" << ret << " bytes");
+            return static_cast<std::size_t>(ret);
+        }
+
+        if(ret == 0)
+            throw System::IOError("end of file");
+
+        if(errno == EINTR)
+            continue;
+
+        if(errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            // splice fails alike for an empty pipe and a full socket
+            sourceEmpty = isPipe && ! hasInput(in);
+            return 0;
+        }
+
+        if(errno == ECONNRESET || errno == EPIPE)
+            throw System::IOError("lost connection to peer");
+
+        throw System::IOError("send file failed");
+    }
+}
+
+
+void TcpSocketImpl::options(TcpSocketOptions& o) const
+{
+    const int fd = this->fd();
+    o = TcpSocketOptions();
+
+    if( getSocketOption(fd, IPPROTO_TCP, TCP_NODELAY, "getsockopt TCP_NODELAY") )
+        o.setNoDelay();
+
+#if defined(TCP_CORK)
+    if( getSocketOption(fd, IPPROTO_TCP, TCP_CORK, "getsockopt TCP_CORK") )
+        o.setCork();
+#elif defined(TCP_NOPUSH)
+    if( getSocketOption(fd, IPPROTO_TCP, TCP_NOPUSH, "getsockopt TCP_NOPUSH") )
+        o.setCork();
+#endif
+
+    o.setSendBufferSize( getSocketOption(fd, SOL_SOCKET, SO_SNDBUF, "getsockopt SO_SNDBUF") );
+    o.setReceiveBufferSize( getSocketOption(fd, SOL_SOCKET, SO_RCVBUF, "getsockopt SO_RCVBUF") );
+
+    if( getSocketOption(fd, SOL_SOCKET, SO_KEEPALIVE, "getsockopt SO_KEEPALIVE") )
+    {
+        int idle = 0;
+        int interval = 0;
+        int count = 0;
+
+#if defined(TCP_KEEPIDLE)
+        idle = getSocketOption(fd, IPPROTO_TCP, TCP_KEEPIDLE, "getsockopt TCP_KEEPIDLE");
+#elif defined(TCP_KEEPALIVE)
+        idle = getSocketOption(fd, IPPROTO_TCP, TCP_KEEPALIVE, "getsockopt TCP_KEEPALIVE");
+#endif
+
+#ifdef TCP_KEEPINTVL
+        interval = getSocketOption(fd, IPPROTO_TCP, TCP_KEEPINTVL, "getsockopt TCP_KEEPINTVL");
+#endif
+
+#ifdef TCP_KEEPCNT
+        count = getSocketOption(fd, IPPROTO_TCP, TCP_KEEPCNT, "getsockopt TCP_KEEPCNT");
+#endif
+
+        o.setKeepAlive(idle, interval, count);
+    }
+}
+
+
+bool TcpSocketImpl::tcpInfo(TcpInfo& info) const
+{
+#if defined(TCP_INFO) && defined(__linux__)
+    if( ! this->isOpen() )
+        return false;
+
+    struct tcp_info ti;
+    socklen_t len = sizeof(ti);
+    std::memset(&ti, 0, sizeof(ti));
+
+    if( ::getsockopt(this->fd(), IPPROTO_TCP, TCP_INFO, &ti, &len) < 0 )
+        return false;
+
+    info.rtt = ti.tcpi_rtt;
+    info.rttVariance = ti.tcpi_rttvar;
+    info.congestionWindow = ti.tcpi_snd_cwnd;
+    info.slowStartThreshold = ti.tcpi_snd_ssthresh;
+    info.mss = ti.tcpi_snd_mss;
+    info.unacked = ti.tcpi_unacked;
+    info.lost = ti.tcpi_lost;
+    info.retransmits = ti.tcpi_total_retrans;
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+void TcpSocketImpl::connect(const Endpoint& ep, const TcpSocketOptions& o)
 {
     log_trace("connect");
 
+    _options = o;
+
     _addrInfo.resolve(ep);
     _addrInfoPtr = _addrInfo.begin();
 
@@ -131,6 +509,8 @@ void TcpSocketImpl::connect()
         IODeviceImpl::open(fd, false);
         log_info("created socket " << this->fd());
 
+        this->setOptions(_options);
+
         if( ::connect(this->fd(), _addrInfoPtr->ai_addr, _addrInfoPtr->ai_addrlen) == 0 )
         {
             log_debug("connect imediately sucessful " << this->fd());
@@ -172,11 +552,12 @@ void TcpSocketImpl::connect()
 }
 
 
-bool TcpSocketImpl::beginConnect(System::EventLoop& loop, const Endpoint& ep, const TcpSocketOptions&)
+bool TcpSocketImpl::beginConnect(System::EventLoop& loop, const Endpoint& ep, const TcpSocketOptions& o)
 {
     log_trace("begin connect");
 
     _errorPending = false;
+    _options = o;
     
     _addrInfo.resolve(ep);
     _addrInfoPtr = _addrInfo.begin();
@@ -206,6 +587,8 @@ bool TcpSocketImpl::beginConnect(System::EventLoop& loop)
     
         IODeviceImpl::open(fd, false);
         log_debug("created socket " << this->fd());
+
+        this->setOptions(_options);
     
         if( ::connect(this->fd(), _addrInfoPtr->ai_addr, _addrInfoPtr->ai_addrlen) == 0 )
         {
@@ -54,6 +54,9 @@ class TcpSocketImpl : public System::IODeviceImpl
 
         bool runConnect(System::EventLoop& loop, bool& isConnected);
 
+        //! @brief Also completes a send file operation waiting for its source
+        bool runWrite(System::EventLoop& loop);
+
         void localEndpoint(Endpoint& ep) const;
 
         void remoteEndpoint(Endpoint& ep) const;
@@ -66,14 +69,43 @@ class TcpSocketImpl : public System::IODeviceImpl
 
         void accept(TcpServer& server, const TcpSocketOptions& o);
 
+        //! @brief Applies the socket options to the open socket
+        void setOptions(const TcpSocketOptions& o);
+
+        void setNoDelay(bool on);
+
+        void setCork(bool on);
+
+        void setQuickAck(bool on);
+
+        void options(TcpSocketOptions& o) const;
+
+        bool tcpInfo(TcpInfo& info) const;
+
+        std::size_t beginSendFile(System::EventLoop& loop, System::FileDevice& file, Pt::uint64_t offset, std::size_t n);
+
+        std::size_t endSendFile(System::EventLoop& loop, System::FileDevice& file, Pt::uint64_t offset, std::size_t n);
+
+        std::size_t sendFile(System::FileDevice& file, Pt::uint64_t offset, std::size_t n);
+
     protected:
         void connect();
         
         bool beginConnect(System::EventLoop& loop);
 
+        /** @brief Sends a part of a file, returns 0 if it would block
+
+            \a sourceEmpty is set if the file is a pipe without data,
+            otherwise the socket is full.
+        */
+        std::size_t trySendFile(System::FileDevice& file, Pt::uint64_t offset, std::size_t n, bool& sourceEmpty);
+
     private:
         TcpSocket& _socket;
         bool _errorPending;
+        System::IOHandle _source;
+        bool _sourcePending;
+        TcpSocketOptions _options;
         AddrInfo _addrInfo;
         AddrInfo::const_iterator _addrInfoPtr;
 };
@@ -39,23 +39,54 @@
 #include <cerrno>
 #include <stdio.h>
 #include <errno.h>
+#include <algorithm>
 #include <cstring>
 #include <cassert>
 #include <fcntl.h>
 #include <netinet/in.h>
+#include <netinet/udp.h>
 #include <arpa/inet.h>
 
+#if defined(__linux__)
+    #define PT_NET_HAVE_MMSG 1
+
+    #ifndef SOL_UDP
+    #define SOL_UDP 17
+    #endif
+
+    #ifndef UDP_SEGMENT
+    #define UDP_SEGMENT 103
+    #endif
+
+    #ifndef UDP_GRO
+    #define UDP_GRO 104
+    #endif
+#endif
+
 log_define("Pt.Net.UdpSocket");
 
 namespace Pt {
 
 namespace Net {
 
+namespace {
+
+// maximum number of messages per recvmmsg/sendmmsg call
+const std::size_t MaxBatch = 64;
+
+// the kernel accepts at most 64 segments per GSO send
+const std::size_t MaxSegments = 64;
+
+}
+
 UdpSocketImpl::UdpSocketImpl(UdpSocket& socket)
 : System::IODeviceImpl(socket)
 , _isConnected(false)
 , _isBound(false)
+, _gro(false)
+, _gso(-1)
 , _sendaddrLen(0)
+, _destaddrLen(0)
 {
 }
 
@@ -75,8 +106,11 @@ void UdpSocketImpl::close()
     System::IODeviceImpl::close();
     _isConnected = false;
     _isBound = false;
+    _gro = false;
+    _gso = -1;
     
     _sendaddrLen = 0;
+    _destaddrLen = 0;
 }
 
 
@@ -162,6 +196,12 @@ void UdpSocketImpl::bind(const Endpoint& ep, const UdpSocketOptions& opts)
         {
             _isBound = true;
             std::memmove(&_servaddr, it->ai_addr, it->ai_addrlen);
+
+#if defined(PT_NET_HAVE_MMSG)
+            // receive offload is optional, older kernels reject UDP_GRO
+            if( opts.isReceiveOffload() )
+                _gro = ::setsockopt(this->fd(), SOL_UDP, UDP_GRO, (char*)&on, sizeof(on)) == 0;
+#endif
             return;
         }
 
@@ -209,12 +249,12 @@ void UdpSocketImpl::connect(const Endpoint& ep, const UdpSocketOptions& opts)
     {
         if( _isBound )
         {
-            if(it->ai_family != _servaddr.ss_family);
+            if(it->ai_family != _servaddr.ss_family)
                 continue;
         }
         else if( _isConnected )
         {
-            if(it->ai_family != _sendaddr.ss_family);
+            if(it->ai_family != _sendaddr.ss_family)
                 this->close();
         }
 
@@ -497,14 +537,28 @@ std::size_t UdpSocketImpl::read( char* buffer, std::size_t count, bool& eof )
 }
 
 
-std::size_t UdpSocketImpl::beginWrite(System::EventLoop& loop, const char* buffer, std::size_t n)
+void UdpSocketImpl::setDestination(const Endpoint& ep)
 {
-    ssize_t ret = 0;
+    _destaddrLen = 0;
+    _destaddrLen = this->resolve(ep, _destaddr);
+}
+
+
+ssize_t UdpSocketImpl::sendDatagram(const char* buffer, std::size_t n)
+{
+    if(_destaddrLen > 0)
+        return ::sendto( this->fd(), buffer, n, 0, (sockaddr*)&_destaddr, _destaddrLen);
 
     if(_isConnected)
-        ret = ::write( this->fd(), buffer, n);
-    else
-        ret = ::sendto( this->fd(), buffer, n, 0, (sockaddr*)&_sendaddr, _sendaddrLen);
+        return ::write( this->fd(), buffer, n);
+
+    return ::sendto( this->fd(), buffer, n, 0, (sockaddr*)&_sendaddr, _sendaddrLen);
+}
+
+
+std::size_t UdpSocketImpl::beginWrite(System::EventLoop& loop, const char* buffer, std::size_t n)
+{
+    ssize_t ret = this->sendDatagram(buffer, n);
 
     if (ret > 0)
         return static_cast<std::size_t>(ret);
@@ -524,10 +578,7 @@ std::size_t UdpSocketImpl::write( const char* buffer, std::size_t count )
 
     while(true)
     {
-        if(_isConnected)
-            ret = ::write( this->fd(), buffer, count);
-        else
-            ret = ::sendto( this->fd(), buffer, count, 0, (sockaddr*)&_sendaddr, _sendaddrLen);
+        ret = this->sendDatagram(buffer, count);
 
         if(ret >= 0)
             break;
@@ -553,6 +604,398 @@ std::size_t UdpSocketImpl::write( const char* buffer, std::size_t count )
     return ret;
 }
 
+
+std::size_t UdpSocketImpl::receive(Datagram* dgrams, std::size_t count)
+{
+    if(this->fd() < 0)
+        throw System::IOError("UDP socket not open");
+
+    if(count > MaxBatch)
+        count = MaxBatch;
+
+    if(count == 0)
+        return 0;
+
+#if defined(PT_NET_HAVE_MMSG)
+    struct mmsghdr msgs[MaxBatch];
+    struct iovec iov[MaxBatch];
+    sockaddr_storage addrs[MaxBatch];
+
+    // control data must be aligned for cmsghdr
+    union Control
+    {
+        cmsghdr align;
+        char data[CMSG_SPACE(sizeof(int))];
+    };
+
+    Control control[MaxBatch];
+
+    for(std::size_t n = 0; n < count; ++n)
+    {
+        iov[n].iov_base = dgrams[n].data;
+        iov[n].iov_len = dgrams[n].size;
+
+        msghdr& hdr = msgs[n].msg_hdr;
+        std::memset(&hdr, 0, sizeof(hdr));
+        hdr.msg_name = &addrs[n];
+        hdr.msg_namelen = sizeof(addrs[n]);
+        hdr.msg_iov = &iov[n];
+        hdr.msg_iovlen = 1;
+
+        if(_gro)
+        {
+            hdr.msg_control = control[n].data;
+            hdr.msg_controllen = sizeof(control[n].data);
+        }
+    }
+
+    int ret = 0;
+    do
+    {
+        ret = ::recvmmsg(this->fd(), msgs, static_cast<unsigned>(count), 0, 0);
+    }
+    while(ret == -1 && errno == EINTR);
+
+    if(ret < 0)
+    {
+        if(errno == EAGAIN || errno == EWOULDBLOCK)
+            return 0;
+
+        throw System::IOError("receive failed");
+    }
+
+    for(int n = 0; n < ret; ++n)
+    {
+        Datagram& dgram = dgrams[n];
+        msghdr& hdr = msgs[n].msg_hdr;
+
+        dgram.received = msgs[n].msg_len;
+        dgram.segmentSize = 0;
+        dgram.truncated = (hdr.msg_flags & MSG_TRUNC) != 0;
+
+        if(dgram.truncated)
+        {
+            log_warn("datagram truncated to " << dgram.received << " bytes");
+        }
+
+        if(_gro)
+        {
+            for(cmsghdr* cm = CMSG_FIRSTHDR(&hdr); cm; cm = CMSG_NXTHDR(&hdr, cm))
+            {
+                if(cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO)
+                {
+                    int segment = 0;
+                    std::memcpy(&segment, CMSG_DATA(cm), sizeof(segment));
+                    if(static_cast<std::size_t>(segment) < dgram.received)
+                        dgram.segmentSize = segment;
+                }
+            }
+        }
+
+        if(dgram.endpoint)
+            dgram.endpoint->impl()->init( (sockaddr*)&addrs[n], hdr.msg_namelen );
+    }
+
+    if(ret > 0)
+    {
+        const msghdr& last = msgs[ret - 1].msg_hdr;
+        _peerAddr.impl()->init( (sockaddr*)last.msg_name, last.msg_namelen );
+    }
+
+    log_debug("received " << ret << " datagrams");
+    return static_cast<std::size_t>(ret);
+
+#else
+    std::size_t n = 0;
+    while(n < count)
+    {
+        Datagram& dgram = dgrams[n];
+
+        sockaddr_storage peerAddr;
+        sockaddr* addr = reinterpret_cast<sockaddr*>(&peerAddr);
+
+        // recvmsg reports truncated datagrams, unlike recvfrom
+        struct iovec iov;
+        iov.iov_base = dgram.data;
+        iov.iov_len = dgram.size;
+
+        msghdr hdr;
+        std::memset(&hdr, 0, sizeof(hdr));
+        hdr.msg_name = addr;
+        hdr.msg_namelen = sizeof(peerAddr);
+        hdr.msg_iov = &iov;
+        hdr.msg_iovlen = 1;
+
+        ssize_t ret = ::recvmsg( this->fd(), &hdr, 0 );
+        if(ret < 0)
+        {
+            if(errno == EINTR)
+                continue;
+
+            if(errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+
+            throw System::IOError("receive failed");
+        }
+
+        dgram.received = static_cast<std::size_t>(ret);
+        dgram.segmentSize = 0;
+        dgram.truncated = (hdr.msg_flags & MSG_TRUNC) != 0;
+
+        if(dgram.truncated)
+        {
+            log_warn("datagram truncated to " << dgram.received << " bytes");
+        }
+
+        if(dgram.endpoint)
+            dgram.endpoint->impl()->init(addr, hdr.msg_namelen);
+
+        _peerAddr.impl()->init(addr, hdr.msg_namelen);
+        ++n;
+    }
+
+    return n;
+#endif
+}
+
+
+std::size_t UdpSocketImpl::send(const Datagram* dgrams, std::size_t count)
+{
+    if(this->fd() < 0)
+        throw System::IOError("UDP socket not open");
+
+    if(count > MaxBatch)
+        count = MaxBatch;
+
+    if(count == 0)
+        return 0;
+
+#if defined(PT_NET_HAVE_MMSG)
+    struct mmsghdr msgs[MaxBatch];
+    struct iovec iov[MaxBatch];
+    sockaddr_storage addrs[MaxBatch];
+
+    union Control
+    {
+        cmsghdr align;
+        char data[CMSG_SPACE(sizeof(Pt::uint16_t))];
+    };
+
+    Control control[MaxBatch];
+
+    // datagram for each message, segmented data without GSO support
+    // is sent as several messages
+    std::size_t owner[MaxBatch];
+    std::size_t nmsgs = 0;
+    std::size_t n = 0;
+
+    for( ; n < count && nmsgs < MaxBatch; ++n)
+    {
+        const Datagram& dgram = dgrams[n];
+
+        sockaddr* name = 0;
+        socklen_t namelen = 0;
+
+        if(dgram.endpoint)
+        {
+            namelen = this->resolve(*dgram.endpoint, addrs[nmsgs]);
+            name = (sockaddr*)&addrs[nmsgs];
+        }
+        else if( ! _isConnected )
+        {
+            name = (sockaddr*)&_sendaddr;
+            namelen = _sendaddrLen;
+        }
+
+        bool segmented = dgram.segmentSize > 0 && dgram.segmentSize < dgram.size;
+
+        if( segmented && this->hasSegmentation() )
+        {
+            if( (dgram.size + dgram.segmentSize - 1) / dgram.segmentSize > MaxSegments )
+                throw System::IOError("too many segments");
+
+            segmented = false;
+        }
+        else if(segmented)
+        {
+            std::size_t parts = (dgram.size + dgram.segmentSize - 1) / dgram.segmentSize;
+            if(parts > MaxBatch)
+                throw System::IOError("too many segments");
+
+            if(nmsgs + parts > MaxBatch)
+                break;
+
+            // the destination was resolved into the first message
+            for(std::size_t off = 0; off < dgram.size; off += dgram.segmentSize)
+            {
+                std::size_t len = std::min(dgram.segmentSize, dgram.size - off);
+
+                iov[nmsgs].iov_base = dgram.data + off;
+                iov[nmsgs].iov_len = len;
+
+                msghdr& hdr = msgs[nmsgs].msg_hdr;
+                std::memset(&hdr, 0, sizeof(hdr));
+                hdr.msg_name = name;
+                hdr.msg_namelen = namelen;
+                hdr.msg_iov = &iov[nmsgs];
+                hdr.msg_iovlen = 1;
+
+                owner[nmsgs++] = n;
+            }
+
+            continue;
+        }
+
+        iov[nmsgs].iov_base = dgram.data;
+        iov[nmsgs].iov_len = dgram.size;
+
+        msghdr& hdr = msgs[nmsgs].msg_hdr;
+        std::memset(&hdr, 0, sizeof(hdr));
+        hdr.msg_name = name;
+        hdr.msg_namelen = namelen;
+        hdr.msg_iov = &iov[nmsgs];
+        hdr.msg_iovlen = 1;
+
+        if(dgram.segmentSize > 0 && dgram.segmentSize < dgram.size)
+        {
+            hdr.msg_control = control[nmsgs].data;
+            hdr.msg_controllen = sizeof(control[nmsgs].data);
+
+            cmsghdr* cm = CMSG_FIRSTHDR(&hdr);
+            cm->cmsg_level = SOL_UDP;
+            cm->cmsg_type = UDP_SEGMENT;
+            cm->cmsg_len = CMSG_LEN(sizeof(Pt::uint16_t));
+
+            Pt::uint16_t segment = static_cast<Pt::uint16_t>(dgram.segmentSize);
+            std::memcpy(CMSG_DATA(cm), &segment, sizeof(segment));
+        }
+
+        owner[nmsgs++] = n;
+    }
+
+    int ret = 0;
+    do
+    {
+        ret = ::sendmmsg(this->fd(), msgs, static_cast<unsigned>(nmsgs), 0);
+    }
+    while(ret == -1 && errno == EINTR);
+
+    if(ret < 0)
+    {
+        if(errno == EAGAIN || errno == EWOULDBLOCK)
+            return 0;
+
+        throw System::IOError("send failed");
+    }
+
+    // a datagram counts as sent if all of its messages were sent
+    std::size_t sent = static_cast<std::size_t>(ret);
+    if(sent == 0)
+        return 0;
+
+    std::size_t complete = owner[sent - 1] + 1;
+    if(sent < nmsgs && owner[sent] == owner[sent - 1])
+        --complete;
+
+    log_debug("sent " << complete << " datagrams");
+    return complete;
+
+#else
+    std::size_t n = 0;
+    for( ; n < count; ++n)
+    {
+        const Datagram& dgram = dgrams[n];
+
+        sockaddr_storage addr;
+        const sockaddr* name = (const sockaddr*)&_sendaddr;
+        socklen_t namelen = _sendaddrLen;
+
+        if(dgram.endpoint)
+        {
+            namelen = this->resolve(*dgram.endpoint, addr);
+            name = (const sockaddr*)&addr;
+        }
+
+        std::size_t segment = dgram.segmentSize > 0 ? dgram.segmentSize : dgram.size;
+        std::size_t off = 0;
+
+        for(;;)
+        {
+            std::size_t len = std::min(segment, dgram.size - off);
+
+            ssize_t ret = 0;
+            if(_isConnected && ! dgram.endpoint)
+                ret = ::send( this->fd(), dgram.data + off, len, 0);
+            else
+                ret = ::sendto( this->fd(), dgram.data + off, len, 0, name, namelen);
+
+            if(ret < 0)
+            {
+                if(errno == EINTR)
+                    continue;
+
+                // partially sent segmented data counts as not sent
+                if(errno == EAGAIN || errno == EWOULDBLOCK)
+                    return n;
+
+                throw System::IOError("send failed");
+            }
+
+            off += len;
+            if(off >= dgram.size)
+                break;
+        }
+    }
+
+    return n;
+#endif
+}
+
+
+socklen_t UdpSocketImpl::resolve(const Endpoint& ep, sockaddr_storage& addr) const
+{
+    const EndpointImpl* impl = ep.impl();
+
+    if(impl->addrlen() > 0)
+    {
+        std::memcpy(&addr, impl->addr(), impl->addrlen());
+        return static_cast<socklen_t>( impl->addrlen() );
+    }
+
+    int family = _isBound ? _servaddr.ss_family : _sendaddr.ss_family;
+
+    AddrInfo ainfo;
+    ainfo.resolve(ep);
+
+    for(AddrInfo::const_iterator it = ainfo.begin(); it != ainfo.end(); ++it)
+    {
+        if( (_isBound || _sendaddrLen > 0) && it->ai_family != family)
+            continue;
+
+        std::memcpy(&addr, it->ai_addr, it->ai_addrlen);
+        return it->ai_addrlen;
+    }
+
+    throw System::AccessFailed( ep.toString() );
+}
+
+
+bool UdpSocketImpl::hasSegmentation()
+{
+#if defined(PT_NET_HAVE_MMSG)
+    if(_gso < 0)
+    {
+        int segment = 0;
+        socklen_t len = sizeof(segment);
+        _gso = ::getsockopt(this->fd(), SOL_UDP, UDP_SEGMENT, &segment, &len) == 0 ? 1 : 0;
+    }
+
+    return _gso > 0;
+#else
+    return false;
+#endif
+}
+
 } // namespace Net
 
 } // namespace Pt
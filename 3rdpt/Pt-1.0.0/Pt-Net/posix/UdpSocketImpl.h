@@ -86,6 +86,11 @@ class UdpSocketImpl : public System::IODeviceImpl
 
         const Endpoint& remoteEndpoint() const;
 
+        void setDestination(const Endpoint& ep);
+
+        void clearDestination()
+        { _destaddrLen = 0; }
+
         size_t beginRead(System::EventLoop& loop, char* buffer, size_t n, bool& eof);
 
         size_t read(char* buffer, size_t count, bool& eof);
@@ -94,13 +99,28 @@ class UdpSocketImpl : public System::IODeviceImpl
 
         size_t write(const char* buffer, size_t n);
 
+        size_t receive(Datagram* dgrams, size_t count);
+
+        size_t send(const Datagram* dgrams, size_t count);
+
+    private:
+        socklen_t resolve(const Endpoint& ep, sockaddr_storage& addr) const;
+
+        bool hasSegmentation();
+
+        ssize_t sendDatagram(const char* buffer, size_t n);
+
     private:
         bool             _isConnected;
         bool             _isBound;
+        bool             _gro;
+        int              _gso;
         Endpoint         _peerAddr;
         sockaddr_storage _servaddr;
         sockaddr_storage _sendaddr;
         socklen_t        _sendaddrLen;
+        sockaddr_storage _destaddr;
+        socklen_t        _destaddrLen;
 };
 
 } // namespace Net
@@ -29,6 +29,7 @@
 
 #include "TcpServerImpl.h"
 #include "AddrInfo.h"
+#include "EndpointImpl.h"
 #include <Pt/Net/Endpoint.h>
 #include <Pt/Net/AddressInUse.h>
 #include <Pt/Net/TcpServer.h>
@@ -104,6 +105,22 @@ void TcpServerImpl::close()
 }
 
 
+void TcpServerImpl::localEndpoint(Endpoint& ep) const
+{
+    sockaddr_storage sockadr;
+    int l = sizeof(sockadr);
+
+    int ret = SOCKET_ERROR;
+    if(_fd != INVALID_SOCKET)
+        ret = getsockname(_fd, (sockaddr*)&sockadr, &l);
+
+    if(ret == 0)
+        ep.impl()->init( (sockaddr*)&sockadr, l );
+    else
+        ep.clear();
+}
+
+
 void TcpServerImpl::cancel(System::EventLoop& loop)
 {
     // not yet listening
@@ -153,6 +170,20 @@ void TcpServerImpl::listen(const Endpoint& ep, const TcpServerOptions& options)
             close();
             throw System::SystemError("setsockopt");
         }
+
+        int sndbuf = options.sendBufferSize();
+        if( sndbuf > 0 && ::setsockopt(_fd, SOL_SOCKET, SO_SNDBUF, (const char*) &sndbuf, sizeof(sndbuf)) < 0 )
+        {
+            close();
+            throw System::SystemError("setsockopt SO_SNDBUF");
+        }
+
+        int rcvbuf = options.receiveBufferSize();
+        if( rcvbuf > 0 && ::setsockopt(_fd, SOL_SOCKET, SO_RCVBUF, (const char*) &rcvbuf, sizeof(rcvbuf)) < 0 )
+        {
+            close();
+            throw System::SystemError("setsockopt SO_RCVBUF");
+        }
     
 #if defined(IPV6_V6ONLY)
         if (it->ai_family == AF_INET6)
@@ -174,7 +205,8 @@ void TcpServerImpl::listen(const Endpoint& ep, const TcpServerOptions& options)
    
             log_debug("listen ");
     
-            if (::listen(_fd, options.backlog()) == SOCKET_ERROR)
+            int backlog = options.backlog() < 0 ? SOMAXCONN : options.backlog();
+            if (::listen(_fd, backlog) == SOCKET_ERROR)
             {
                 close();
     
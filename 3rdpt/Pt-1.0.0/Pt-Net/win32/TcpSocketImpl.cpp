@@ -36,6 +36,8 @@
 #include <Pt/Net/TcpSocket.h>
 #include <Pt/System/Logger.h>
 #include <Pt/System/SystemError.h>
+#include <Pt/System/IOError.h>
+#include <mstcpip.h>
 #include <limits>
 #include <cstring>
 #include <cassert>
@@ -53,6 +55,7 @@ TcpSocketImpl::TcpSocketImpl(TcpSocket& socket)
 , _eventFlags(FD_CLOSE)
 , _timeout(System::EventLoop::WaitInfinite)
 , _ioh(socket)
+, _fileBufferSize(0)
 {
 }
 
@@ -104,17 +107,137 @@ void TcpSocketImpl::close()
 }
 
 
-void TcpSocketImpl::accept(TcpServer& server, const TcpSocketOptions&)
+void TcpSocketImpl::accept(TcpServer& server, const TcpSocketOptions& o)
 {
     _fd = server.impl().accept();
     log_debug("accepted " << _fd);
+
+    this->setOptions(o);
+}
+
+
+void TcpSocketImpl::setOptions(const TcpSocketOptions& o)
+{
+    // TCP_QUICKACK, TCP_CORK, SO_BUSY_POLL, TCP_NOTSENT_LOWAT and
+    // SO_INCOMING_CPU are not available on windows
+
+    if( o.isNoDelay() )
+        this->setNoDelay(true);
+
+    int sndbuf = o.sendBufferSize();
+    if( sndbuf > 0 && ::setsockopt(_fd, SOL_SOCKET, SO_SNDBUF, (const char*) &sndbuf, sizeof(sndbuf)) != 0 )
+        throw System::SystemError("setsockopt SO_SNDBUF");
+
+    int rcvbuf = o.receiveBufferSize();
+    if( rcvbuf > 0 && ::setsockopt(_fd, SOL_SOCKET, SO_RCVBUF, (const char*) &rcvbuf, sizeof(rcvbuf)) != 0 )
+        throw System::SystemError("setsockopt SO_RCVBUF");
+
+    if( o.isKeepAlive() )
+    {
+        BOOL on = TRUE;
+        if( ::setsockopt(_fd, SOL_SOCKET, SO_KEEPALIVE, (const char*) &on, sizeof(on)) != 0 )
+            throw System::SystemError("setsockopt SO_KEEPALIVE");
+
+        if( o.keepAliveIdle() > 0 || o.keepAliveInterval() > 0 )
+        {
+            tcp_keepalive ka;
+            ka.onoff = 1;
+            ka.keepalivetime = o.keepAliveIdle() > 0 ? o.keepAliveIdle() * 1000 : 7200000;
+            ka.keepaliveinterval = o.keepAliveInterval() > 0 ? o.keepAliveInterval() * 1000 : 1000;
+
+            DWORD n = 0;
+            if( ::WSAIoctl(_fd, SIO_KEEPALIVE_VALS, &ka, sizeof(ka), NULL, 0, &n, NULL, NULL) != 0 )
+                throw System::SystemError("WSAIoctl SIO_KEEPALIVE_VALS");
+        }
+    }
+}
+
+
+void TcpSocketImpl::setNoDelay(bool on)
+{
+    BOOL value = on ? TRUE : FALSE;
+    if( ::setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, (const char*) &value, sizeof(value)) != 0 )
+        throw System::SystemError("setsockopt TCP_NODELAY");
+}
+
+
+void TcpSocketImpl::setCork(bool)
+{
+}
+
+
+void TcpSocketImpl::setQuickAck(bool)
+{
+}
+
+
+void TcpSocketImpl::options(TcpSocketOptions& o) const
+{
+    // the keepalive times can be set, but not read back on windows
+    o = TcpSocketOptions();
+
+    BOOL flag = FALSE;
+    int len = sizeof(flag);
+    if( ::getsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, (char*) &flag, &len) != 0 )
+        throw System::SystemError("getsockopt TCP_NODELAY");
+
+    if(flag)
+        o.setNoDelay();
+
+    int size = 0;
+    len = sizeof(size);
+    if( ::getsockopt(_fd, SOL_SOCKET, SO_SNDBUF, (char*) &size, &len) != 0 )
+        throw System::SystemError("getsockopt SO_SNDBUF");
+
+    o.setSendBufferSize(size);
+
+    len = sizeof(size);
+    if( ::getsockopt(_fd, SOL_SOCKET, SO_RCVBUF, (char*) &size, &len) != 0 )
+        throw System::SystemError("getsockopt SO_RCVBUF");
+
+    o.setReceiveBufferSize(size);
+
+    flag = FALSE;
+    len = sizeof(flag);
+    if( ::getsockopt(_fd, SOL_SOCKET, SO_KEEPALIVE, (char*) &flag, &len) != 0 )
+        throw System::SystemError("getsockopt SO_KEEPALIVE");
+
+    if(flag)
+        o.setKeepAlive();
+}
+
+
+bool TcpSocketImpl::tcpInfo(TcpInfo& info) const
+{
+#ifdef SIO_TCP_INFO
+    if(_fd == INVALID_SOCKET)
+        return false;
+
+    DWORD version = 0;
+    TCP_INFO_v0 ti;
+    DWORD n = 0;
+
+    if( ::WSAIoctl(_fd, SIO_TCP_INFO, &version, sizeof(version), &ti, sizeof(ti), &n, NULL, NULL) != 0 )
+        return false;
+
+    info.rtt = ti.RttUs;
+    info.mss = ti.Mss;
+    info.congestionWindow = ti.Mss > 0 ? ti.Cwnd / ti.Mss : 0;
+    info.unacked = ti.Mss > 0 ? ti.BytesInFlight / ti.Mss : 0;
+    info.retransmits = ti.Mss > 0 ? static_cast<Pt::uint32_t>(ti.BytesRetrans / ti.Mss) : 0;
+    return true;
+#else
+    return false;
+#endif
 }
 
 
-void TcpSocketImpl::connect(const Endpoint& ep, const TcpSocketOptions&)
+void TcpSocketImpl::connect(const Endpoint& ep, const TcpSocketOptions& o)
 {
     log_debug("connect");
 
+    _options = o;
+
     _addrInfo.resolve( ep );
     _addrInfoPtr = _addrInfo.begin();
 
@@ -143,6 +266,8 @@ void TcpSocketImpl::connect()
         u_long argp = 0;
         ::ioctlsocket(_fd, FIONBIO, &argp);
         log_debug("created socket " << _fd);
+
+        this->setOptions(_options);
         
         socklen_t addrlen = static_cast<socklen_t>(_addrInfoPtr->ai_addrlen);
 
@@ -159,11 +284,12 @@ void TcpSocketImpl::connect()
 }
 
 
-bool TcpSocketImpl::beginConnect(System::EventLoop& loop, const Endpoint& ep, const TcpSocketOptions&)
+bool TcpSocketImpl::beginConnect(System::EventLoop& loop, const Endpoint& ep, const TcpSocketOptions& o)
 {
     log_debug("begin connect");
 
     _errorPending = false;
+    _options = o;
 
     if(_ioh.handle() == INVALID_HANDLE_VALUE)
     {
@@ -194,6 +320,8 @@ bool TcpSocketImpl::beginConnect()
     
         log_debug("created socket " << _fd);
 
+        this->setOptions(_options);
+
         socklen_t addrlen = static_cast<socklen_t>(_addrInfoPtr->ai_addrlen);
 
         if( ::connect(_fd, _addrInfoPtr->ai_addr, addrlen) == 0 )
@@ -363,10 +491,10 @@ bool TcpSocketImpl::wait(std::size_t msecs)
 {
     log_debug(_fd << " wait " << msecs);
 
-    DWORD maxTimeout = std::numeric_limits<DWORD>::max() - 1;
+    DWORD maxTimeout = std::numeric_limits<DWORD>::max() - 1;
             
-    DWORD timeout = (msecs == System::EventLoop::WaitInfinite) ? INFINITE
-                      : (msecs > maxTimeout) ? maxTimeout 
+    DWORD timeout = (msecs == System::EventLoop::WaitInfinite) ? INFINITE
+                      : (msecs > maxTimeout) ? maxTimeout 
                           : static_cast<DWORD>(msecs);
 
     HANDLE h = _ioh.handle();
@@ -566,6 +694,41 @@ std::size_t TcpSocketImpl::endWrite(System::EventLoop& loop, const char* buffer,
 }
 
 
+std::size_t TcpSocketImpl::beginSendFile(System::EventLoop& loop, System::FileDevice& file, Pt::uint64_t offset, std::size_t n)
+{
+    // files are sent through a buffer, TransmitFile is not used yet
+    std::size_t len = this->readFile(file, offset, n);
+    return this->beginWrite(loop, &_fileBuffer[0], len);
+}
+
+
+std::size_t TcpSocketImpl::endSendFile(System::EventLoop& loop, System::FileDevice&, Pt::uint64_t, std::size_t)
+{
+    return this->endWrite(loop, &_fileBuffer[0], _fileBufferSize);
+}
+
+
+std::size_t TcpSocketImpl::sendFile(System::FileDevice& file, Pt::uint64_t offset, std::size_t n)
+{
+    std::size_t len = this->readFile(file, offset, n);
+    return this->write(&_fileBuffer[0], len);
+}
+
+
+std::size_t TcpSocketImpl::readFile(System::FileDevice& file, Pt::uint64_t offset, std::size_t n)
+{
+    _fileBuffer.resize(65536);
+
+    file.seek(static_cast<System::FileDevice::off_type>(offset), std::ios::beg);
+    _fileBufferSize = file.read(&_fileBuffer[0], n < _fileBuffer.size() ? n : _fileBuffer.size());
+
+    if(_fileBufferSize == 0)
+        throw System::IOError("end of file");
+
+    return _fileBufferSize;
+}
+
+
 std::size_t TcpSocketImpl::write(const char* buffer, std::size_t n)
 {
     log_debug(_fd << " write");
@@ -41,6 +41,7 @@
 #include <Pt/Net/TcpSocket.h>
 
 #include <string>
+#include <vector>
 #include <windows.h>
 #include <winsock2.h>
 #include <ws2tcpip.h>
@@ -70,6 +71,24 @@ class TcpSocketImpl
 
         void accept(TcpServer& server, const TcpSocketOptions& o);
 
+        void setOptions(const TcpSocketOptions& o);
+
+        void setNoDelay(bool on);
+
+        void setCork(bool on);
+
+        void setQuickAck(bool on);
+
+        void options(TcpSocketOptions& o) const;
+
+        bool tcpInfo(TcpInfo& info) const;
+
+        std::size_t beginSendFile(System::EventLoop& loop, System::FileDevice& file, Pt::uint64_t offset, std::size_t n);
+
+        std::size_t endSendFile(System::EventLoop& loop, System::FileDevice& file, Pt::uint64_t offset, std::size_t n);
+
+        std::size_t sendFile(System::FileDevice& file, Pt::uint64_t offset, std::size_t n);
+
         void connect(const Endpoint& addrinfo, const TcpSocketOptions&);
 
         bool beginConnect(System::EventLoop& loop, const Endpoint& addrinfo, const TcpSocketOptions&);
@@ -94,6 +113,26 @@ class TcpSocketImpl
 
         size_t write(const char* buffer, size_t count);
 
+        // vectored I/O is done on the first segment only
+
+        size_t beginReadv(System::EventLoop& loop, System::IOVec* vec, size_t, bool& eof)
+        { return this->beginRead(loop, vec->base, vec->size, eof); }
+
+        size_t endReadv(System::EventLoop& loop, System::IOVec* vec, size_t, bool& eof)
+        { return this->endRead(loop, vec->base, vec->size, eof); }
+
+        size_t readv(System::IOVec* vec, size_t, bool& eof)
+        { return this->read(vec->base, vec->size, eof); }
+
+        size_t beginWritev(System::EventLoop& loop, const System::IOVec* vec, size_t)
+        { return this->beginWrite(loop, vec->base, vec->size); }
+
+        size_t endWritev(System::EventLoop& loop, const System::IOVec* vec, size_t)
+        { return this->endWrite(loop, vec->base, vec->size); }
+
+        size_t writev(const System::IOVec* vec, size_t)
+        { return this->write(vec->base, vec->size); }
+
         void localEndpoint(Endpoint& ep) const;
 
         void remoteEndpoint(Endpoint& ep) const;
@@ -110,11 +149,13 @@ class TcpSocketImpl
         void setEventFlags(HANDLE ev, long events);
         bool wait(std::size_t msecs);
         int waitSelect(fd_set* rfds, fd_set* wfds, fd_set* efds, size_t timeout);
+        std::size_t readFile(System::FileDevice& file, Pt::uint64_t offset, std::size_t n);
 
     private:
         AddrInfo _addrInfo;
         AddrInfo::const_iterator _addrInfoPtr;
         bool _errorPending;
+        TcpSocketOptions _options;
         SOCKET _fd;
         std::size_t _timeout;
         System::IOHandle _ioh;
@@ -122,6 +163,8 @@ class TcpSocketImpl
         WSABUF _receiveBuffer;
         bool _fdClose;
         long _eventFlags;
+        std::vector<char> _fileBuffer;
+        std::size_t _fileBufferSize;
 };
 
 } // namespace Net
@@ -36,6 +36,7 @@
 #include <Pt/System/SystemError.h>
 #include <Pt/System/IOError.h>
 #include <Pt/System/Logger.h>
+#include <algorithm>
 #include <limits>
 #include <cstring>
 #include <cassert>
@@ -56,6 +57,7 @@ UdpSocketImpl::UdpSocketImpl(UdpSocket& socket)
 , _hopLimit(DefaultHopLimit)
 , _eventFlags(FD_CLOSE)
 , _timeout(Pt::System::EventLoop::WaitInfinite)
+, _destAddrLen(0)
 {
 }
 
@@ -98,6 +100,7 @@ void UdpSocketImpl::close()
     _fd = INVALID_SOCKET;
     _isConnected = false;
     _isBound = false;
+    _destAddrLen = 0;
 
     _hopLimit = DefaultHopLimit;
 }
@@ -621,14 +624,57 @@ std::size_t UdpSocketImpl::endRead(System::EventLoop& loop, char* buffer, std::s
 }
 
 
+void UdpSocketImpl::setDestination(const Endpoint& ep)
+{
+    _destAddrLen = 0;
+    _destAddrLen = this->resolve(ep, _destAddr);
+}
+
+
+int UdpSocketImpl::resolve(const Endpoint& ep, sockaddr_storage& addr) const
+{
+    const EndpointImpl* impl = ep.impl();
+
+    if(impl->addrlen() > 0)
+    {
+        std::memcpy(&addr, impl->addr(), impl->addrlen());
+        return static_cast<int>( impl->addrlen() );
+    }
+
+    AddrInfo ainfo;
+    ainfo.resolve(ep);
+
+    AddrInfo::const_iterator it = ainfo.begin();
+    if( it == ainfo.end() )
+        throw System::AccessFailed( ep.toString() );
+
+    std::memcpy(&addr, it->ai_addr, it->ai_addrlen);
+    return static_cast<int>(it->ai_addrlen);
+}
+
+
+const sockaddr* UdpSocketImpl::destination(int& addrlen) const
+{
+    if(_destAddrLen > 0)
+    {
+        addrlen = _destAddrLen;
+        return (const sockaddr*)&_destAddr;
+    }
+
+    addrlen = sizeof(_sendAddr);
+    return (const sockaddr*)&_sendAddr;
+}
+
+
 std::size_t UdpSocketImpl::write(const char* buffer, std::size_t n)
 {
     unsigned int maxLen = std::numeric_limits<int>::max();
     int buflen = n > maxLen ? static_cast<int>(maxLen) : static_cast<int>(n);
 
-    int addrlen = sizeof(_sendAddr);
+    int addrlen = 0;
+    const sockaddr* addr = this->destination(addrlen);
     int len = sendto( _fd, buffer, buflen, 
-                      0, (sockaddr*)&_sendAddr, addrlen );
+                      0, addr, addrlen );
 
     if( len == -1 && WSAGetLastError() == WSAEWOULDBLOCK)
     {
@@ -639,7 +685,7 @@ std::size_t UdpSocketImpl::write(const char* buffer, std::size_t n)
         this->waitSelect(0, &fds, 0, _timeout);
 
         len = sendto( _fd, buffer, buflen, 0,
-                        (sockaddr*) &_sendAddr, addrlen );
+                        addr, addrlen );
 
         if(len < 0)
             throw System::IOError("sendto");
@@ -650,6 +696,100 @@ std::size_t UdpSocketImpl::write(const char* buffer, std::size_t n)
 
 
 
+std::size_t UdpSocketImpl::receive(Datagram* dgrams, std::size_t count)
+{
+    if(_fd == INVALID_SOCKET)
+        throw System::IOError("UDP socket not open");
+
+    // no batched receive on windows, datagrams are received one by one
+    std::size_t n = 0;
+    for( ; n < count; ++n)
+    {
+        Datagram& dgram = dgrams[n];
+
+        unsigned int maxLen = std::numeric_limits<int>::max();
+        int buflen = dgram.size > maxLen ? static_cast<int>(maxLen) : static_cast<int>(dgram.size);
+
+        sockaddr_storage peerAddr;
+        int addrlen = sizeof(peerAddr);
+        sockaddr* addr = reinterpret_cast<sockaddr*>(&peerAddr);
+
+        dgram.truncated = false;
+
+        int len = recvfrom( _fd, dgram.data, buflen, 0, addr, &addrlen );
+        if(len < 0)
+        {
+            int err = WSAGetLastError();
+            if(err == WSAEWOULDBLOCK)
+                break;
+
+            // the buffer was filled with the first part of the datagram
+            if(err != WSAEMSGSIZE)
+                throw System::IOError("recvfrom");
+
+            len = buflen;
+            dgram.truncated = true;
+        }
+
+        dgram.received = len;
+        dgram.segmentSize = 0;
+
+        if(dgram.endpoint)
+            dgram.endpoint->impl()->init(addr, addrlen);
+
+        _peerAddr.impl()->init(addr, addrlen);
+    }
+
+    return n;
+}
+
+
+std::size_t UdpSocketImpl::send(const Datagram* dgrams, std::size_t count)
+{
+    if(_fd == INVALID_SOCKET)
+        throw System::IOError("UDP socket not open");
+
+    std::size_t n = 0;
+    for( ; n < count; ++n)
+    {
+        const Datagram& dgram = dgrams[n];
+
+        sockaddr_storage addr;
+        const sockaddr* name = (const sockaddr*)&_sendAddr;
+        int namelen = sizeof(_sendAddr);
+
+        if(dgram.endpoint)
+        {
+            namelen = this->resolve(*dgram.endpoint, addr);
+            name = (const sockaddr*)&addr;
+        }
+
+        // no segmentation offload on windows, segments are sent one by one
+        std::size_t segment = dgram.segmentSize > 0 ? dgram.segmentSize : dgram.size;
+        std::size_t off = 0;
+
+        do
+        {
+            int len = static_cast<int>( std::min(segment, dgram.size - off) );
+
+            if( sendto(_fd, dgram.data + off, len, 0, name, namelen) < 0 )
+            {
+                // partially sent segmented data counts as not sent
+                if(WSAGetLastError() == WSAEWOULDBLOCK)
+                    return n;
+
+                throw System::IOError("sendto");
+            }
+
+            off += len;
+        }
+        while(off < dgram.size);
+    }
+
+    return n;
+}
+
+
 std::size_t UdpSocketImpl::beginWrite(System::EventLoop& loop, const char* buffer, std::size_t n)
 {
     if(_ioh.handle() == INVALID_HANDLE_VALUE)
@@ -663,8 +803,10 @@ std::size_t UdpSocketImpl::beginWrite(System::EventLoop& loop, const char* buffe
 
     DWORD numberOfBytesSent = 0;
 
+    int addrlen = 0;
+    const sockaddr* addr = this->destination(addrlen);
     int rc = WSASendTo( _fd, &_sendBuffer, 1, &numberOfBytesSent, 0,
-                        (sockaddr*)&_sendAddr, sizeof(_sendAddr), NULL, NULL);
+                        addr, addrlen, NULL, NULL);
 
     if(rc == SOCKET_ERROR)
     {
@@ -696,8 +838,10 @@ std::size_t UdpSocketImpl::endWrite(System::EventLoop& loop, const char* buffer,
     ::ioctlsocket(_fd, FIONBIO, &argp);
 
     DWORD bytesSend = 0;
+    int addrlen = 0;
+    const sockaddr* addr = this->destination(addrlen);
     int rc = WSASendTo(_fd, &_sendBuffer, 1, &bytesSend, 0, 
-                       (sockaddr*)&_sendAddr, sizeof(_sendAddr), NULL, NULL);
+                       addr, addrlen, NULL, NULL);
 
     //Set socket to non-blocking mode
     argp = 1;
@@ -92,6 +92,11 @@ class UdpSocketImpl
 
         const Endpoint& remoteEndpoint() const;
 
+        void setDestination(const Endpoint& ep);
+
+        void clearDestination()
+        { _destAddrLen = 0; }
+
         void setTimeout(std::size_t msecs)
         { _timeout = msecs; }
 
@@ -108,6 +113,10 @@ class UdpSocketImpl
 
         size_t write(const char* buffer, size_t n);
 
+        size_t receive(Datagram* dgrams, size_t count);
+
+        size_t send(const Datagram* dgrams, size_t count);
+
         size_t endWrite(System::EventLoop& loop, const char* buffer, size_t n);
 
         bool runRead(System::EventLoop& loop);
@@ -119,6 +128,10 @@ class UdpSocketImpl
 
         int waitSelect(fd_set* rfds, fd_set* wfds, fd_set* efds, size_t timeout);
 
+        int resolve(const Endpoint& ep, sockaddr_storage& addr) const;
+
+        const sockaddr* destination(int& addrlen) const;
+
     private:
         System::IOHandle _ioh;
         SOCKET           _fd;
@@ -126,6 +139,8 @@ class UdpSocketImpl
         bool             _isBound;
         Endpoint         _peerAddr;
         sockaddr_storage _sendAddr;
+        sockaddr_storage _destAddr;
+        int              _destAddrLen;
         mutable sockaddr_storage _servaddr;
         unsigned int     _hopLimit;
         long             _eventFlags;
@@ -107,6 +107,21 @@ void TcpServerImpl::close()
 }
 
 
+void TcpServerImpl::localEndpoint(Endpoint& ep) const
+{
+    // the listener only reports the port, the host is the one it
+    // was bound to
+    if( ! _bindOp )
+    {
+        ep.clear();
+        return;
+    }
+
+    String^ service = _listener->Information->LocalPort;
+    ep.impl()->init(_host, service);
+}
+
+
 void TcpServerImpl::cancel(System::EventLoop& loop)
 {
     System::MutexLock lock(_mtx);
@@ -137,6 +152,8 @@ void TcpServerImpl::listen(const Endpoint& ep, const TcpServerOptions& options)
     std::wstring wservice(service.begin(), service.end());
     String^ serviceName = ref new String( wservice.c_str() );
 
+    _host = shost;
+
     if( shost->IsEmpty() )
         _bindOp = _listener->BindServiceNameAsync(serviceName);
     else
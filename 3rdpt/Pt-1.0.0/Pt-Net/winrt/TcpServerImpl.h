@@ -48,6 +48,8 @@ class TcpServerImpl
 
         void close();
 
+        void localEndpoint(Endpoint& ep) const;
+
         void cancel(System::EventLoop& loop);
 
         void beginAccept(System::EventLoop& loop);
@@ -76,6 +78,7 @@ class TcpServerImpl
         System::EventLoop* _loop;
         Windows::Networking::Sockets::StreamSocketListener^ _listener;
         Windows::Foundation::IAsyncAction^ _bindOp;
+        Platform::String^ _host;
         System::Mutex _mtx;
         std::vector<Windows::Networking::Sockets::StreamSocket^> _backlog;
 };
@@ -114,6 +114,54 @@ void TcpSocketImpl::accept(TcpServer& server, const TcpSocketOptions&)
 }
 
 
+void TcpSocketImpl::setNoDelay(bool)
+{
+}
+
+
+void TcpSocketImpl::setCork(bool)
+{
+}
+
+
+void TcpSocketImpl::setQuickAck(bool)
+{
+}
+
+
+void TcpSocketImpl::options(TcpSocketOptions& o) const
+{
+    o = TcpSocketOptions();
+}
+
+
+bool TcpSocketImpl::tcpInfo(TcpInfo&) const
+{
+    return false;
+}
+
+
+std::size_t TcpSocketImpl::beginSendFile(System::EventLoop&, System::FileDevice&, Pt::uint64_t, std::size_t)
+{
+    throw System::IOError("sending files not supported");
+    return 0;
+}
+
+
+std::size_t TcpSocketImpl::endSendFile(System::EventLoop&, System::FileDevice&, Pt::uint64_t, std::size_t)
+{
+    throw System::IOError("sending files not supported");
+    return 0;
+}
+
+
+std::size_t TcpSocketImpl::sendFile(System::FileDevice&, Pt::uint64_t, std::size_t)
+{
+    throw System::IOError("sending files not supported");
+    return 0;
+}
+
+
 void TcpSocketImpl::connect(const Endpoint& ep, const TcpSocketOptions&)
 {
     log_debug( "connecting socket to " << ep.toString() );
@@ -123,7 +171,7 @@ void TcpSocketImpl::connect(const Endpoint& ep, const TcpSocketOptions&)
 }
 
 
-bool TcpSocketImpl::beginConnect(System::EventLoop& loop, const Endpoint& ep, const TcpSocketOptions&)
+bool TcpSocketImpl::beginConnect(System::EventLoop& loop, const Endpoint& ep, const TcpSocketOptions& o)
 {
     assert( ! _isConnected );
     log_debug( "begin connecting socket to " << ep.toString() );
@@ -135,6 +183,13 @@ bool TcpSocketImpl::beginConnect(System::EventLoop& loop, const Endpoint& ep, co
         _socket = ref new StreamSocket();
     }
 
+    // the stream socket control can only be changed before connecting
+    _socket->Control->NoDelay = o.isNoDelay();
+    _socket->Control->KeepAlive = o.isKeepAlive();
+
+    if( o.sendBufferSize() > 0 )
+        _socket->Control->OutboundBufferSizeInBytes = o.sendBufferSize();
+
     const std::string& host = _ep.impl()->host();
     std::wstring whost(host.begin(), host.end());
     String^ shost = ref new String(whost.c_str());
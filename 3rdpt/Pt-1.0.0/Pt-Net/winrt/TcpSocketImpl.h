@@ -59,6 +59,22 @@ class TcpSocketImpl
 
         void connect(const Endpoint& ep, const TcpSocketOptions&);
 
+        void setNoDelay(bool on);
+
+        void setCork(bool on);
+
+        void setQuickAck(bool on);
+
+        void options(TcpSocketOptions& o) const;
+
+        bool tcpInfo(TcpInfo& info) const;
+
+        std::size_t beginSendFile(System::EventLoop& loop, System::FileDevice& file, Pt::uint64_t offset, std::size_t n);
+
+        std::size_t endSendFile(System::EventLoop& loop, System::FileDevice& file, Pt::uint64_t offset, std::size_t n);
+
+        std::size_t sendFile(System::FileDevice& file, Pt::uint64_t offset, std::size_t n);
+
         bool beginConnect(System::EventLoop& loop, const Endpoint& ep, const TcpSocketOptions&);
 
         void endConnect(System::EventLoop& loop);
@@ -81,6 +97,26 @@ class TcpSocketImpl
 
         size_t write(const char* buffer, size_t count);
 
+        // vectored I/O is done on the first segment only
+
+        size_t beginReadv(System::EventLoop& loop, System::IOVec* vec, size_t, bool& eof)
+        { return this->beginRead(loop, vec->base, vec->size, eof); }
+
+        size_t endReadv(System::EventLoop& loop, System::IOVec* vec, size_t, bool& eof)
+        { return this->endRead(loop, vec->base, vec->size, eof); }
+
+        size_t readv(System::IOVec* vec, size_t, bool& eof)
+        { return this->read(vec->base, vec->size, eof); }
+
+        size_t beginWritev(System::EventLoop& loop, const System::IOVec* vec, size_t)
+        { return this->beginWrite(loop, vec->base, vec->size); }
+
+        size_t endWritev(System::EventLoop& loop, const System::IOVec* vec, size_t)
+        { return this->endWrite(loop, vec->base, vec->size); }
+
+        size_t writev(const System::IOVec* vec, size_t)
+        { return this->write(vec->base, vec->size); }
+
         void localEndpoint(Endpoint& ep) const;
 
         void remoteEndpoint(Endpoint& ep) const;
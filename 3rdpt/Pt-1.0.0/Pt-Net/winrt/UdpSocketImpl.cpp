@@ -44,6 +44,21 @@ using namespace Windows::Networking::Sockets;
 
 log_define("Pt.System.UdpSocket");
 
+namespace {
+
+void toHostName(const Pt::Net::Endpoint& ep, HostName^& address, String^& port)
+{
+    const std::string& host = ep.impl()->host();
+    std::wstring whost(host.begin(), host.end());
+    address = ref new HostName( ref new String(whost.c_str()) );
+
+    const std::string& service = ep.impl()->service();
+    std::wstring wservice(service.begin(), service.end());
+    port = ref new String(wservice.c_str());
+}
+
+}
+
 namespace Pt {
 
 namespace Net {
@@ -116,6 +131,7 @@ void UdpSocketImpl::close()
 
     delete _writer;
     _writer = nullptr;
+    this->clearDestination();
 
     delete _socket;
     _socket = ref new DatagramSocket();
@@ -293,16 +309,7 @@ void UdpSocketImpl::connect(const Endpoint& ep, const UdpSocketOptions& o)
 
 void UdpSocketImpl::setTarget(const Endpoint& ep, const UdpSocketOptions& o)
 {
-    const std::string& host = ep.impl()->host();
-    std::wstring whost(host.begin(), host.end());
-    String^ shost = ref new String(whost.c_str());
-
-    const std::string& service = ep.impl()->service();
-    std::wstring wservice(service.begin(), service.end());
-    String^ serviceName = ref new String(wservice.c_str());
-
-    _sendAddress = ref new HostName(shost);
-    _sendPort = serviceName;
+    toHostName(ep, _sendAddress, _sendPort);
 
     // next beginWrite must create new output stream
     _writer = nullptr;
@@ -365,6 +372,23 @@ void UdpSocketImpl::localEndpoint(Endpoint& ep) const
 }
 
 
+void UdpSocketImpl::setDestination(const Endpoint& ep)
+{
+    // the destination gets its own output stream, the stream of the
+    // target is kept for the next plain write
+    toHostName(ep, _destAddress, _destPort);
+    _destWriter = nullptr;
+}
+
+
+void UdpSocketImpl::clearDestination()
+{
+    _destAddress = nullptr;
+    _destPort = nullptr;
+    _destWriter = nullptr;
+}
+
+
 const Endpoint& UdpSocketImpl::remoteEndpoint() const
 {
     return _peerAddr;
@@ -448,18 +472,27 @@ std::size_t UdpSocketImpl::beginWrite(System::EventLoop& loop,
 {
     log_debug("beginWrite " << bufSize);
 
+    // a datagram sent to a destination uses the stream of the destination
+    const bool toDestination = _destAddress != nullptr;
+    DataWriter^ writer = toDestination ? _destWriter : _writer;
+
     // no writer means neither connect nor setTarget was called
-    if( ! _writer )
+    if( ! writer )
     {
-        _getOutputOp = _socket->GetOutputStreamAsync(_sendAddress, _sendPort);
+        _getOutputOp = toDestination ? _socket->GetOutputStreamAsync(_destAddress, _destPort)
+                                     : _socket->GetOutputStreamAsync(_sendAddress, _sendPort);
 
         _getOutputOp->Completed = ref new AsyncOperationCompletedHandler<IOutputStream^>
         (
-            [&, buffer, bufSize](IAsyncOperation<IOutputStream^>^ output, AsyncStatus asyncStatus)
+            [&, buffer, bufSize, toDestination](IAsyncOperation<IOutputStream^>^ output, AsyncStatus asyncStatus)
             {
-                // access to _writer reference itself is atomic, so we do not
-                // have to lock when setting the reference.
-                _writer = ref new DataWriter(output->GetResults());
+                // access to the writer reference itself is atomic, so we do
+                // not have to lock when setting the reference.
+                if(toDestination)
+                    _destWriter = ref new DataWriter(output->GetResults());
+                else
+                    _writer = ref new DataWriter(output->GetResults());
+
                 _getOutputOp = nullptr;
 
                 this->beginWrite(loop, buffer, bufSize);
@@ -475,11 +508,11 @@ std::size_t UdpSocketImpl::beginWrite(System::EventLoop& loop,
     unsigned n = 0;
     for( ; n < bufSize; ++n)
     {
-        _writer->WriteByte( ubuffer[n] );
+        writer->WriteByte( ubuffer[n] );
     }
 
     _storeCount = n;
-    _storeOp = _writer->StoreAsync();
+    _storeOp = writer->StoreAsync();
                                   
     _storeOp->Completed = ref new AsyncOperationCompletedHandler<unsigned int>
     (
@@ -518,6 +551,20 @@ std::size_t UdpSocketImpl::write(const char* buffer, std::size_t n)
     return 0;
 }
 
+
+std::size_t UdpSocketImpl::receive(Datagram* dgrams, std::size_t count)
+{
+    throw System::IOError("batched I/O not supported");
+    return 0;
+}
+
+
+std::size_t UdpSocketImpl::send(const Datagram* dgrams, std::size_t count)
+{
+    throw System::IOError("batched I/O not supported");
+    return 0;
+}
+
 } // namespace Net
 
 } // namespace Pt
@@ -86,6 +86,10 @@ class UdpSocketImpl
 
         const Endpoint& remoteEndpoint() const;
 
+        void setDestination(const Endpoint& ep);
+
+        void clearDestination();
+
         void setTimeout(std::size_t msecs)
         { _timeout = msecs; }
 
@@ -112,6 +116,10 @@ class UdpSocketImpl
 
         size_t write(const char* buffer, size_t n);
 
+        size_t receive(Datagram* dgrams, size_t count);
+
+        size_t send(const Datagram* dgrams, size_t count);
+
     private:
         struct Message
         {
@@ -137,6 +145,9 @@ class UdpSocketImpl
         Windows::Networking::HostName^ _sendAddress;
         Platform::String^ _sendPort;
         Windows::Storage::Streams::DataWriter^ _writer;
+        Windows::Networking::HostName^ _destAddress;
+        Platform::String^ _destPort;
+        Windows::Storage::Streams::DataWriter^ _destWriter;
         Windows::Storage::Streams::DataWriterStoreOperation^ _storeOp;
         size_t _storeCount;
 };
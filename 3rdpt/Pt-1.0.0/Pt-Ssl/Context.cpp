@@ -122,6 +122,12 @@ void Context::addCertificate(const Certificate& cert)
 }
 
 
+void Context::addApplicationProtocol(const std::string& name)
+{
+    _impl->addApplicationProtocol(name);
+}
+
+
 ContextImpl* Context::impl()
 { 
     return _impl; 
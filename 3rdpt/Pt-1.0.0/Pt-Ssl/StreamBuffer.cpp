@@ -110,6 +110,15 @@ const char* StreamBuffer::currentCipher() const
 }
 
 
+std::string StreamBuffer::applicationProtocol() const
+{
+    if(_connection)
+        return _connection->applicationProtocol();
+
+    return std::string();
+}
+
+
 bool StreamBuffer::isConnected() const
 { 
     return _connection && _connection->connected(); 
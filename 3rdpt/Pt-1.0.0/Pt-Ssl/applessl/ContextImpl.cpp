@@ -198,6 +198,13 @@ void ContextImpl::addCertificate(const Certificate& certificate)
 }
 
 
+void ContextImpl::addApplicationProtocol(const std::string& name)
+{
+    // protocol negotiation is not supported by this implementation, so
+    // connections use the default protocol of the application
+}
+
+
 SecIdentityRef ContextImpl::copyIdentity(SecIdentityRef ident) const
 {
     SecIdentityRef foundIdent = NULL;
@@ -74,6 +74,8 @@ class ContextImpl
         
         void addCertificate(const Certificate& cert);
 
+        void addApplicationProtocol(const std::string& name);
+
         CFArrayRef certificates()
         { return _identity ? _certs : NULL; }
         
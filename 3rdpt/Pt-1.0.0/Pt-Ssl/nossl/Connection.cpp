@@ -55,6 +55,12 @@ const char* Connection::currentCipher() const
 }
 
 
+std::string Connection::applicationProtocol() const
+{
+    return std::string();
+}
+
+
 bool Connection::writeHandshake()
 {
     log_trace("Connection::writeHandshake");
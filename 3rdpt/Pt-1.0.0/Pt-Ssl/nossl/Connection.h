@@ -32,6 +32,7 @@
 #include <Pt/Ssl/Api.h>
 #include <Pt/Ssl/Context.h>
 #include <ios>
+#include <string>
 #include <cstddef>
 
 namespace Pt {
@@ -50,6 +51,8 @@ class Connection
 
         const char* currentCipher() const;
 
+        std::string applicationProtocol() const;
+
         bool writeHandshake();
 
         bool readHandshake();
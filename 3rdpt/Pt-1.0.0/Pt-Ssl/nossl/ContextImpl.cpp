@@ -102,6 +102,11 @@ void ContextImpl::addCertificate(const Certificate& certificate)
 {
 }
 
+
+void ContextImpl::addApplicationProtocol(const std::string& name)
+{
+}
+
 } // namespace Ssl
 
 } // namespace Pt
@@ -69,6 +69,8 @@ class ContextImpl
         
         void addCertificate(const Certificate& cert);
 
+        void addApplicationProtocol(const std::string& name);
+
     private:
         Protocol          _protocol;
         VerifyMode        _verify;
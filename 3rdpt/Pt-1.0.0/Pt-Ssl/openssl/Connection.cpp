@@ -130,6 +130,21 @@ const char* Connection::currentCipher() const
 }
 
 
+std::string Connection::applicationProtocol() const
+{
+#if (OPENSSL_VERSION_NUMBER >= 0x10002000L)
+    const unsigned char* data = 0;
+    unsigned int len = 0;
+    SSL_get0_alpn_selected(_ssl, &data, &len);
+
+    if(data)
+        return std::string(reinterpret_cast<const char*>(data), len);
+#endif
+
+    return std::string();
+}
+
+
 bool Connection::writeHandshake()
 {
     log_trace("Connection::writeHandshake");
@@ -276,16 +291,20 @@ bool Connection::shutdown()
     // read shutdown notify
     log_debug("read shutdown notify");
 
-    BUF_MEM* bm = 0;
-    BIO_get_mem_ptr(_in, &bm);
+    const std::streamsize bufsize = 2000;
+    char buf[bufsize];
 
-    std::streamsize avail = sb->in_avail();
-    std::streamsize refill = std::min(static_cast<std::streamsize>(bm->max - bm->length), avail);
+    std::streamsize refill = std::min(sb->in_avail(), bufsize);
     log_debug("refill " << refill << " bytes");
-        
-    std::streamsize gcount = sb->sgetn(bm->data + bm->length, refill);
-    bm->length += static_cast<int>( gcount );
-    log_debug("got " << gcount << " bytes from input stream");
+
+    if(refill > 0)
+    {
+        std::streamsize gcount = sb->sgetn(buf, refill);
+        if(gcount > 0)
+            BIO_write(_in, buf, static_cast<int>(gcount));
+
+        log_debug("got " << gcount << " bytes from input stream");
+    }
 
     int r = SSL_shutdown(_ssl);
     log_debug("SSL_shutdown() = " << r);
@@ -332,7 +351,9 @@ std::streamsize Connection::write(const char* buf, std::size_t n)
     {
         sb->sputn(bm->data, bm->length);
         log_debug("wrote " << bm->length << " bytes to output");
-        bm->length = 0;
+
+        // the memory BIO keeps its own read position
+        BIO_reset(_out);
     }
 
     return written;
@@ -383,22 +404,24 @@ std::streamsize Connection::read(char* buf, std::size_t n, std::streamsize maxIm
         if(maxImport == 0)
             return 0;
 
-        // Refill the BIO with encoded bytes for decoding
-        BUF_MEM* bm = 0;
-        BIO_get_mem_ptr(_in, &bm);
-
-        if(bm->max == bm->length)
-            continue;
+        // Refill the BIO with encoded bytes for decoding. The memory BIO
+        // must be written with BIO_write, because it keeps its own read
+        // position apart from the BUF_MEM
+        const std::streamsize bufsize = 2000;
+        char refillBuf[bufsize];
 
-        const std::streamsize refill = std::min(static_cast<std::streamsize>(bm->max - bm->length), maxImport);
+        const std::streamsize refill = std::min(bufsize, maxImport);
         log_debug("get " << refill << " bytes from _ios");
         
-        std::streamsize gcount = sb->sgetn(bm->data + bm->length, refill);
+        std::streamsize gcount = sb->sgetn(refillBuf, refill);
         if(gcount <= 0)
             return 0;
 
-        bm->length += static_cast<int>( gcount );
-        log_debug("Wrote " << gcount << " bytes from _ios to _in BUF_MEM");
+        const int written = BIO_write(_in, refillBuf, static_cast<int>(gcount));
+        if(written != gcount)
+            throw SslError("BIO_write");
+
+        log_debug("Wrote " << gcount << " bytes from _ios to _in BIO");
 
         maxImport -= gcount;
     }
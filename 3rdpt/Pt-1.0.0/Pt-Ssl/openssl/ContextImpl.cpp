@@ -116,6 +116,31 @@ void SSLExitImpl()
 }
 
 
+#if (OPENSSL_VERSION_NUMBER >= 0x10002000L)
+
+int selectApplicationProtocol(SSL* ssl, const unsigned char** out, unsigned char* outlen,
+                              const unsigned char* in, unsigned int inlen, void* arg)
+{
+    const ContextImpl* ctx = static_cast<const ContextImpl*>(arg);
+    const std::string& protocols = ctx->applicationProtocols();
+
+    // selects the first protocol of the server, which the client offers
+    unsigned char* selected = 0;
+    int ret = SSL_select_next_proto(&selected, outlen,
+                                    reinterpret_cast<const unsigned char*>(protocols.data()),
+                                    static_cast<unsigned int>(protocols.size()),
+                                    in, inlen);
+
+    if(ret != OPENSSL_NPN_NEGOTIATED)
+        return SSL_TLSEXT_ERR_NOACK;
+
+    *out = selected;
+    return SSL_TLSEXT_ERR_OK;
+}
+
+#endif
+
+
 X509* copyX509(X509* from)
 {   
     return X509_dup(from);
@@ -164,7 +189,7 @@ ContextImpl::ContextImpl(Protocol protocol)
 
         default:
         case SSLv3: 
-            _ctx = SSL_CTX_new( SSLv3_method () ); 
+            _ctx = SSL_CTX_new( SSLv23_method () ); 
             break;
         
         case TLSv1: 
@@ -183,6 +208,10 @@ ContextImpl::ContextImpl(Protocol protocol)
     //SSL_CTX_set_read_ahead(_ctx, 1);
 
     SSL_CTX_set_session_cache_mode(_ctx, SSL_SESS_CACHE_OFF);
+
+#if (OPENSSL_VERSION_NUMBER >= 0x10002000L)
+    SSL_CTX_set_alpn_select_cb(_ctx, selectApplicationProtocol, this);
+#endif
 }
 
 
@@ -228,7 +257,7 @@ void ContextImpl::setProtocol(Protocol protocol)
 
         default:
         case SSLv3: 
-            SSL_CTX_set_ssl_version( _ctx, SSLv3_method() ); 
+            SSL_CTX_set_ssl_version( _ctx, SSLv23_method() ); 
             break;
         
         case TLSv1: 
@@ -359,6 +388,14 @@ void ContextImpl::assign(const ContextImpl& ctx)
 
     SSL_CTX_set_cert_store( _ctx, store );
     storePtr.release();
+
+    // copy protocols for application layer protocol negotiation
+    _protocols = ctx._protocols;
+
+#if (OPENSSL_VERSION_NUMBER >= 0x10002000L)
+    SSL_CTX_set_alpn_protos(_ctx, reinterpret_cast<const unsigned char*>(_protocols.data()),
+                            static_cast<unsigned int>(_protocols.size()) );
+#endif
 }
 
 
@@ -414,6 +451,22 @@ void ContextImpl::addCertificate(const Certificate& certificate)
 }
 
 
+void ContextImpl::addApplicationProtocol(const std::string& name)
+{
+    if( name.empty() || name.size() > 255 )
+        throw SslError("invalid application protocol");
+
+    // protocols are kept in the wire format, prefixed by their length
+    _protocols += static_cast<char>( name.size() );
+    _protocols += name;
+
+#if (OPENSSL_VERSION_NUMBER >= 0x10002000L)
+    SSL_CTX_set_alpn_protos(_ctx, reinterpret_cast<const unsigned char*>(_protocols.data()),
+                            static_cast<unsigned int>(_protocols.size()) );
+#endif
+}
+
+
 void ContextImpl::addCACertificate(const Certificate& trustedCert)
 {
     log_trace("adding CA certificate:" << trustedCert.subject());
@@ -33,6 +33,7 @@
 #include <Pt/Ssl/Api.h>
 #include <Pt/Ssl/Context.h>
 #include <Pt/Ssl/Certificate.h>
+#include <string>
 #include <vector>
 
 namespace Pt {
@@ -68,9 +69,15 @@ class ContextImpl
 
         void addCertificate(const Certificate& certificate);
 
+        void addApplicationProtocol(const std::string& name);
+
         //! @internal
         SSL_CTX* ctx() const;
 
+        //! @internal
+        const std::string& applicationProtocols() const
+        { return _protocols; }
+
     private:
         SSL_CTX*        _ctx;
         Protocol           _protocol;
@@ -80,6 +87,7 @@ class ContextImpl
         EVP_PKEY*          _pkey;
         std::vector<X509*> _extraCerts;
         std::vector<X509*> _caCerts;
+        std::string        _protocols;
 };
 
 } // namespace Ssl
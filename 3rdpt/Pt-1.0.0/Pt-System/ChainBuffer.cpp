@@ -0,0 +1,691 @@
+/*
+ * Copyright (C) 2005-2013 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <Pt/System/ChainBuffer.h>
+#include <Pt/System/IOError.h>
+#include <Pt/System/Mutex.h>
+#include <Pt/NonCopyable.h>
+#include <cstring>
+
+namespace Pt {
+
+namespace System {
+
+struct ChainBuffer::Segment
+{
+    Segment* next;
+
+    // start of the memory of the segment
+    char* base;
+
+    // first byte not consumed or written yet
+    std::size_t begin;
+
+    // end of the valid data
+    std::size_t end;
+
+    // owner of queued data or 0 for a slab
+    RefCounted* owner;
+};
+
+
+struct ChainBuffer::Slab : public ChainBuffer::Segment
+{
+    Slab* nextSlab() const
+    { return static_cast<Slab*>(next); }
+
+    char data[ChainBuffer::SlabSize];
+};
+
+
+/** @internal Process-wide free list of slabs.
+
+    Up to MaxFree slabs are kept for reuse, further slabs are deleted
+    when they are returned.
+*/
+class SlabPool : private NonCopyable
+{
+    public:
+        static SlabPool& instance()
+        {
+            // never destroyed, buffers may outlive static destruction
+            static SlabPool* pool = new SlabPool;
+            return *pool;
+        }
+
+        ChainBuffer::Slab* acquire()
+        {
+            ChainBuffer::Slab* slab = 0;
+
+            {
+                MutexLock lock(_mutex);
+                if(_free)
+                {
+                    slab = _free;
+                    _free = slab->nextSlab();
+                    --_count;
+                }
+            }
+
+            if( ! slab )
+                slab = new ChainBuffer::Slab;
+
+            slab->next = 0;
+            slab->base = slab->data;
+            slab->begin = 0;
+            slab->end = 0;
+            slab->owner = 0;
+            return slab;
+        }
+
+        void release(ChainBuffer::Slab* slab)
+        {
+            MutexLock lock(_mutex);
+            if(_count < MaxFree)
+            {
+                slab->next = _free;
+                _free = slab;
+                ++_count;
+                return;
+            }
+
+            lock.unlock();
+            delete slab;
+        }
+
+    private:
+        SlabPool()
+        : _free(0)
+        , _count(0)
+        { }
+
+    private:
+        static const std::size_t MaxFree = 256;
+        Mutex _mutex;
+        ChainBuffer::Slab* _free;
+        std::size_t _count;
+};
+
+
+ChainBuffer::ChainBuffer()
+: _ioDevice(0)
+, _ihead(0)
+, _itail(0)
+, _iread(0)
+, _ireadIdle(false)
+, _ohead(0)
+, _otail(0)
+, _oput(0)
+, _oqueued(0)
+{
+    setg(0, 0, 0);
+    setp(0, 0);
+}
+
+
+ChainBuffer::ChainBuffer(IODevice& ioDevice)
+: _ioDevice(0)
+, _ihead(0)
+, _itail(0)
+, _iread(0)
+, _ireadIdle(false)
+, _ohead(0)
+, _otail(0)
+, _oput(0)
+, _oqueued(0)
+{
+    setg(0, 0, 0);
+    setp(0, 0);
+    attach(ioDevice);
+}
+
+
+ChainBuffer::~ChainBuffer()
+{
+    clearInput();
+    clearOutput();
+}
+
+
+void ChainBuffer::attach(IODevice& ioDevice)
+{
+    if( ioDevice.isReading() || ioDevice.isWriting() )
+        throw IOPending("IODevice in use");
+
+    this->detach();
+
+    _ioDevice = &ioDevice;
+    ioDevice.inputReady() += slot(*this, &ChainBuffer::onRead);
+    ioDevice.outputReady() += slot(*this, &ChainBuffer::onWrite);
+}
+
+
+void ChainBuffer::detach()
+{
+    if( ! _ioDevice)
+        return;
+
+    if( _ioDevice->isReading() || _ioDevice->isWriting() )
+        throw IOPending("IODevice in use");
+
+    _ioDevice->inputReady() -= slot(*this, &ChainBuffer::onRead);
+    _ioDevice->outputReady() -= slot(*this, &ChainBuffer::onWrite);
+    _ioDevice = 0;
+}
+
+
+void ChainBuffer::reset()
+{
+    discard();
+    detach();
+}
+
+
+void ChainBuffer::discard()
+{
+    if(_ioDevice && (_ioDevice->isReading() || _ioDevice->isWriting()))
+        throw IOPending("ChainBuffer in use");
+
+    clearInput();
+    clearOutput();
+}
+
+
+void ChainBuffer::queue(const char* data, std::size_t n, RefCounted& owner)
+{
+    if(n == 0)
+        return;
+
+    // data written afterwards continues in a new slab
+    syncOutput();
+    _oput = 0;
+    setp(0, 0);
+
+    Segment* seg = new Segment;
+    seg->next = 0;
+    seg->base = const_cast<char*>(data);
+    seg->begin = 0;
+    seg->end = n;
+    seg->owner = &owner;
+
+    owner.addRef();
+    appendOutput(seg);
+    _oqueued += n;
+}
+
+
+void ChainBuffer::beginRead()
+{
+    if(_ioDevice == 0 || _ioDevice->isReading())
+        return;
+
+    trimInput();
+
+    // an empty buffer does not take a slab before data has arrived
+    if( ! _ihead )
+    {
+        _ioDevice->beginRead(_iidle, IdleReadSize);
+        _ireadIdle = true;
+        return;
+    }
+
+    Slab* slab = inputSlab();
+    _ioDevice->beginRead(slab->data + slab->end, SlabSize - slab->end);
+    _iread = slab;
+}
+
+
+void ChainBuffer::onRead(IODevice& dev)
+{
+    _inputReady.send(*this);
+}
+
+
+std::size_t ChainBuffer::endRead()
+{
+    Slab* slab = _iread;
+    _iread = 0;
+
+    const bool idle = _ireadIdle;
+    _ireadIdle = false;
+
+    std::size_t n = _ioDevice->endRead();
+    if(slab)
+    {
+        fillInput(slab, n);
+    }
+    else if(idle && n > 0)
+    {
+        slab = inputSlab();
+        std::memcpy(slab->data + slab->end, _iidle, n);
+        fillInput(slab, n);
+    }
+
+    return n;
+}
+
+
+void ChainBuffer::beginWrite()
+{
+    if(_ioDevice == 0 || _ioDevice->isWriting())
+        return;
+
+    syncOutput();
+
+    if(_ohead)
+    {
+        initOutputVector();
+        if( ! _ovec.empty() )
+            _ioDevice->beginWritev(&_ovec[0], _ovec.size());
+    }
+}
+
+
+void ChainBuffer::onWrite(IODevice& dev)
+{
+    _outputReady.send(*this);
+}
+
+
+std::size_t ChainBuffer::endWrite()
+{
+    if( ! _ioDevice)
+        return 0;
+
+    std::size_t n = _ioDevice->endWrite();
+    consumeOutput(n);
+    return n;
+}
+
+
+bool ChainBuffer::isReading() const
+{
+    return _ioDevice ? _ioDevice->isReading() : false;
+}
+
+
+bool ChainBuffer::isWriting() const
+{
+    return _ioDevice ? _ioDevice->isWriting() : false;
+}
+
+
+std::size_t ChainBuffer::slabCount() const
+{
+    std::size_t n = 0;
+
+    for(const Slab* slab = _ihead; slab; slab = slab->nextSlab())
+        ++n;
+
+    for(const Segment* seg = _ohead; seg; seg = seg->next)
+    {
+        if( ! seg->owner )
+            ++n;
+    }
+
+    return n;
+}
+
+
+ChainBuffer::Slab* ChainBuffer::inputSlab()
+{
+    if(_itail && _itail->end < SlabSize)
+        return _itail;
+
+    Slab* slab = SlabPool::instance().acquire();
+
+    if(_itail)
+    {
+        _itail->next = slab;
+        _itail = slab;
+    }
+    else
+    {
+        _ihead = _itail = slab;
+        setg(slab->data, slab->data, slab->data);
+    }
+
+    return slab;
+}
+
+
+void ChainBuffer::fillInput(Slab* slab, std::size_t n)
+{
+    slab->end += n;
+
+    if(slab == _ihead)
+        setg(eback(), gptr(), slab->data + slab->end);
+}
+
+
+void ChainBuffer::trimInput()
+{
+    // return consumed slabs, unless a read into the slab is pending
+    while(_ihead && gptr() == egptr() && _ihead != _iread)
+    {
+        Slab* slab = _ihead;
+        _ihead = slab->nextSlab();
+        SlabPool::instance().release(slab);
+
+        if(_ihead)
+        {
+            setg(_ihead->data, _ihead->data, _ihead->data + _ihead->end);
+        }
+        else
+        {
+            _itail = 0;
+            setg(0, 0, 0);
+        }
+    }
+}
+
+
+void ChainBuffer::appendOutput(Segment* seg)
+{
+    if(_otail)
+        _otail->next = seg;
+    else
+        _ohead = seg;
+
+    _otail = seg;
+}
+
+
+void ChainBuffer::releaseOutput(Segment* seg)
+{
+    if(seg->owner)
+    {
+        _oqueued -= seg->end - seg->begin;
+        seg->owner->release();
+        delete seg;
+        return;
+    }
+
+    SlabPool::instance().release( static_cast<Slab*>(seg) );
+}
+
+
+void ChainBuffer::syncOutput()
+{
+    if(_oput)
+        _oput->end = pptr() - _oput->data;
+}
+
+
+void ChainBuffer::consumeOutput(std::size_t n)
+{
+    syncOutput();
+
+    // segments, which were written completely, are released
+    while(_ohead)
+    {
+        Segment* seg = _ohead;
+        std::size_t size = seg->end - seg->begin;
+
+        if(n < size)
+        {
+            seg->begin += n;
+            if(seg->owner)
+                _oqueued -= n;
+
+            break;
+        }
+
+        n -= size;
+        _ohead = seg->next;
+
+        if(seg == _otail)
+            _otail = 0;
+
+        if(seg == _oput)
+            _oput = 0;
+
+        releaseOutput(seg);
+    }
+
+    if(_oput)
+    {
+        setp(_oput->data + _oput->begin, _oput->data + SlabSize);
+        pbump( static_cast<int>(_oput->end - _oput->begin) );
+    }
+    else
+    {
+        setp(0, 0);
+    }
+}
+
+
+void ChainBuffer::initOutputVector()
+{
+    _ovec.clear();
+
+    for(Segment* seg = _ohead; seg; seg = seg->next)
+    {
+        if(seg->end > seg->begin)
+            _ovec.push_back( IOVec(seg->base + seg->begin, seg->end - seg->begin) );
+    }
+}
+
+
+void ChainBuffer::clearInput()
+{
+    while(_ihead)
+    {
+        Slab* slab = _ihead;
+        _ihead = slab->nextSlab();
+        SlabPool::instance().release(slab);
+    }
+
+    _itail = 0;
+    _iread = 0;
+    _ireadIdle = false;
+    setg(0, 0, 0);
+}
+
+
+void ChainBuffer::clearOutput()
+{
+    while(_ohead)
+    {
+        Segment* seg = _ohead;
+        _ohead = seg->next;
+        releaseOutput(seg);
+    }
+
+    _otail = 0;
+    _oput = 0;
+    _oqueued = 0;
+    setp(0, 0);
+}
+
+
+std::streamsize ChainBuffer::showmanyc()
+{
+    std::streamsize n = 0;
+
+    if(_ihead)
+    {
+        for(const Slab* slab = _ihead->nextSlab(); slab; slab = slab->nextSlab())
+            n += slab->end;
+    }
+
+    if(n > 0)
+        return n;
+
+    if( ! _ioDevice || _ioDevice->isEof() )
+        return -1;
+
+    return 0;
+}
+
+
+std::streamsize ChainBuffer::showfull()
+{
+    syncOutput();
+
+    std::streamsize n = 0;
+    for(const Segment* seg = _ohead; seg; seg = seg->next)
+        n += seg->end - seg->begin;
+
+    return n;
+}
+
+
+int ChainBuffer::sync()
+{
+    typedef ChainBuffer::traits_type traits_type;
+
+    if( ! _ioDevice )
+        return 0;
+
+    syncOutput();
+
+    while(_ohead)
+    {
+        const ChainBuffer::int_type ch = overflow(traits_type::eof());
+        if(ch == traits_type::eof())
+            return -1;
+
+        _ioDevice->sync();
+    }
+
+    return 0;
+}
+
+
+ChainBuffer::int_type ChainBuffer::underflow()
+{
+    typedef ChainBuffer::traits_type traits_type;
+
+    if( ! _ioDevice)
+        return traits_type::eof();
+
+    if(_ioDevice->isReading())
+        endRead();
+
+    trimInput();
+
+    if( gptr() < egptr() )
+        return traits_type::to_int_type( *gptr() );
+
+    if(_ioDevice->isEof())
+        return traits_type::eof();
+
+    Slab* slab = inputSlab();
+    std::size_t n = _ioDevice->read(slab->data + slab->end, SlabSize - slab->end);
+    fillInput(slab, n);
+
+    if( gptr() < egptr() )
+        return traits_type::to_int_type( *gptr() );
+
+    trimInput();
+    return traits_type::eof();
+}
+
+
+ChainBuffer::int_type ChainBuffer::overflow(int_type ch)
+{
+    typedef ChainBuffer::traits_type traits_type;
+
+    if( ! _ioDevice)
+        return traits_type::eof();
+
+    if( traits_type::eq_int_type(ch, traits_type::eof()) )
+    {
+        // blocking flush, called by sync
+        if(_ioDevice->isWriting())
+            endWrite();
+
+        syncOutput();
+
+        if(_ohead)
+        {
+            initOutputVector();
+            if( _ovec.empty() )
+                consumeOutput(0);
+            else
+                consumeOutput( _ioDevice->writev(&_ovec[0], _ovec.size()) );
+        }
+
+        return traits_type::not_eof(ch);
+    }
+
+    // the put area is full, continue in a new slab. Slabs in the chain
+    // are never moved, so this is safe while a write is pending
+    syncOutput();
+
+    Slab* slab = SlabPool::instance().acquire();
+    appendOutput(slab);
+
+    _oput = slab;
+    setp(slab->data, slab->data + SlabSize);
+
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+
+    return traits_type::not_eof(ch);
+}
+
+
+ChainBuffer::pos_type ChainBuffer::seekoff(off_type off, std::ios::seekdir dir, std::ios::openmode)
+{
+    pos_type ret = pos_type(off_type(-1));
+
+    if( ! _ioDevice || ! _ioDevice->seekable() || off == 0)
+        return ret;
+
+    if(_ioDevice->isWriting())
+        endWrite();
+
+    if(_ioDevice->isReading())
+        endRead();
+
+    ret = _ioDevice->seek(off, dir);
+
+    // Eliminate currently buffered sequence
+    discard();
+
+    return ret;
+}
+
+
+ChainBuffer::pos_type ChainBuffer::seekpos(pos_type p, std::ios::openmode mode)
+{
+    return seekoff(p, std::ios::beg, mode);
+}
+
+
+ChainBuffer::int_type ChainBuffer::pbackfail(int_type)
+{
+    typedef ChainBuffer::traits_type traits_type;
+    return traits_type::eof();
+}
+
+} // namespace System
+
+} // namespace Pt
@@ -68,6 +68,21 @@ Timespan Clock::getSystemTicks()
     return ClockImpl::getSystemTicks();
 }
 
+Pt::int64_t Clock::getMonotonicTime()
+{
+    return ClockImpl::getMonotonicTime();
+}
+
+Timespan Clock::getMonotonicTicks()
+{
+    return Timespan( ClockImpl::getMonotonicTime() / 1000 );
+}
+
+bool Clock::setMonotonicSource(MonotonicSource source)
+{
+    return ClockImpl::setMonotonicSource(source);
+}
+
 } //namespace System
 
 } //namespace Pt
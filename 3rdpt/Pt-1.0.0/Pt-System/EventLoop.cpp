@@ -31,9 +31,48 @@
 #include <Pt/System/Timer.h>
 #include <Pt/System/Clock.h>
 #include <Pt/System/Logger.h>
+#include <limits>
 
 log_define("Pt.System.EventLoop")
 
+namespace {
+
+inline Pt::int64_t toTicks(const Pt::Timespan& ts)
+{
+    Pt::int64_t usecs = ts.toUSecs();
+    Pt::int64_t msecs = usecs / 1000;
+    return (usecs % 1000 > 0) ? msecs + 1 : msecs;
+}
+
+
+inline int lowestBit(Pt::uint64_t word)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#else
+    int n = 0;
+    while( (word & 1) == 0 )
+    {
+        word >>= 1;
+        ++n;
+    }
+
+    return n;
+#endif
+}
+
+
+// Returns the number of steps from start to the next bit set in a
+// 64 bit word, wrapping around at the end
+inline int nextBit(Pt::uint64_t word, int start)
+{
+    Pt::uint64_t rotated = start ? (word >> start) | (word << (64 - start))
+                                 : word;
+    return lowestBit(rotated);
+}
+
+}
+
 namespace Pt {
 
 namespace System {
@@ -61,21 +100,67 @@ void EventLoop::exit()
 }
 
 
+Timespan EventLoop::onLoopTime() const
+{
+    return Clock::getMonotonicTicks();
+}
+
+
 //////////////////////////////////////////////////////////////////////////
 // EventQueue
 //////////////////////////////////////////////////////////////////////////
 
+// Allocates the queue node in front of the cloned event
+class EventQueue::NodeAllocator : public Allocator
+{
+    public:
+        // keeps the events aligned for any type
+        static const std::size_t HeaderSize = ((sizeof(Node) + 15) / 16) * 16;
+
+        NodeAllocator(Allocator& a)
+        : _alloc(&a)
+        , _node(0)
+        { }
+
+        Node* node()
+        { return _node; }
+
+        static Node* toNode(void* p)
+        { return reinterpret_cast<Node*>(static_cast<char*>(p) - HeaderSize); }
+
+        virtual void* allocate(std::size_t size)
+        {
+            char* mem = static_cast<char*>( _alloc->allocate(size + HeaderSize) );
+            _node = reinterpret_cast<Node*>(mem);
+            return mem + HeaderSize;
+        }
+
+        virtual void deallocate(void* p, std::size_t size)
+        {
+            _alloc->deallocate(toNode(p), size + HeaderSize);
+        }
+
+    private:
+        Allocator* _alloc;
+        Node* _node;
+};
+
+
 EventQueue::EventQueue()
 : _allocator(/*255, 64*/)
 , _usedalloc(&_allocator)
-, _exited(false)
+, _head(0)
+, _pending(0)
+, _exited(0)
 {}
 
 
 EventQueue::EventQueue(Allocator& a)
 : _allocator(/*255, 64*/)
 , _usedalloc(&a)
-, _exited(false)
+, _head(0)
+, _pending(0)
+, _exited(0)
 {}
 
 
@@ -83,13 +168,19 @@ EventQueue::~EventQueue()
 {
     try
     {
-        MutexLock lock(_mutex);
+        Node* node = static_cast<Node*>( atomicExchange(_head, 0) );
+        while(node)
+        {
+            Node* next = node->next;
+            destroy(node);
+            node = next;
+        }
 
-        while ( ! _eventQueue.empty() )
+        while(_pending)
         {
-            Event* ev = _eventQueue.front();
-            _eventQueue.pop_front();
-            ev->destroy( this->allocator() );
+            Node* next = _pending->next;
+            destroy(_pending);
+            _pending = next;
         }
     }
     catch(...)
@@ -99,62 +190,97 @@ EventQueue::~EventQueue()
 
 void EventQueue::exit()
 {
+    atomicSet(_exited, 1);
+}
+
+
+void EventQueue::destroy(Node* node)
+{
+    NodeAllocator na( this->allocator() );
+
+    if(_usedalloc == &_allocator)
+    {
+        node->event->destroy(na);
+        return;
+    }
+
     MutexLock lock(_mutex);
-    _exited = true;
+    node->event->destroy(na);
 }
 
 
 void EventQueue::pushEvent(const Event& ev)
 { 
-    MutexLock lock(_mutex);
-
-    Event& clonedEvent = ev.clone( this->allocator() );
+    NodeAllocator na( this->allocator() );
+    Event* clonedEvent = 0;
 
-    try
+    if(_usedalloc == &_allocator)
     {
-        _eventQueue.push_back(&clonedEvent);
+        clonedEvent = &ev.clone(na);
     }
-    catch(...)
+    else
+    {
+        MutexLock lock(_mutex);
+        clonedEvent = &ev.clone(na);
+    }
+
+    Node* node = na.node();
+    node->event = clonedEvent;
+
+    void* head = _head;
+    while(true)
     {
-        clonedEvent.destroy( this->allocator() );
-        throw;
+        node->next = static_cast<Node*>(head);
+
+        void* prev = atomicCompareExchange(_head, node, head);
+        if(prev == head)
+            break;
+
+        head = prev;
     }
 }
 
 
 bool EventQueue::processEvents(Signal<const Event&>& eventSignal)
 { 
-    bool isActive = true;
-
-    MutexLock lock(_mutex);
-
     while( true )
     {    
-        isActive = ! _exited;
+        if( atomicGet(_exited) )
+            return false;
 
-        if ( _eventQueue.empty() || _exited )
-            break;
+        if( ! _pending )
+        {
+            // take all queued events and restore the order they were added
+            Node* node = static_cast<Node*>( atomicExchange(_head, 0) );
+            if( ! node )
+                break;
+
+            while(node)
+            {
+                Node* next = node->next;
+                node->next = _pending;
+                _pending = node;
+                node = next;
+            }
+        }
 
-        Event* ev = _eventQueue.front();
-        _eventQueue.pop_front();
-        lock.unlock();
+        Node* node = _pending;
+        _pending = node->next;
 
         try
         {
-            eventSignal.send(*ev);
+            eventSignal.send(*node->event);
         }
         catch(...)
         {
-            lock.lock();
-            ev->destroy( this->allocator() );
+            destroy(node);
             throw;
         }
 
-		lock.lock();
-        ev->destroy( this->allocator() );
+        destroy(node);
     }
 
-    return isActive;
+    return true;
 }
 
 
@@ -167,6 +293,18 @@ TimerQueue::TimerQueue()
 
 
 TimerQueue::~TimerQueue()
+{}
+
+
+//////////////////////////////////////////////////////////////////////////
+// SortedTimerQueue
+//////////////////////////////////////////////////////////////////////////
+
+SortedTimerQueue::SortedTimerQueue()
+{}
+
+
+SortedTimerQueue::~SortedTimerQueue()
 {
     while( _timers.size() )
     {
@@ -176,7 +314,7 @@ TimerQueue::~TimerQueue()
 }
 
 
-void TimerQueue::addTimer(Timer& timer)
+void SortedTimerQueue::addTimer(Timer& timer)
 {
     if( timer.isStarted() )
     {
@@ -186,7 +324,7 @@ void TimerQueue::addTimer(Timer& timer)
 }
 
 
-void TimerQueue::removeTimer( Timer& timer )
+void SortedTimerQueue::removeTimer( Timer& timer )
 {
     std::multimap<Timespan, Timer*>::iterator it;
     for(it = _timers.begin(); it != _timers.end(); ++it)
@@ -200,9 +338,9 @@ void TimerQueue::removeTimer( Timer& timer )
 }
 
 
-std::size_t TimerQueue::processTimers()
+std::size_t SortedTimerQueue::processTimers(const Timespan& now)
 {
-    log_trace("TimerQueue::processTimers");
+    log_trace("SortedTimerQueue::processTimers");
 
     std::size_t lowestTimeout = EventLoop::WaitInfinite;
 
@@ -212,8 +350,8 @@ std::size_t TimerQueue::processTimers()
         return lowestTimeout;
     }
 
-    Timespan now = Clock::getSystemTicks();
     Timer* timer = _timers.begin()->second;
+    bool fired = false;
 
     log_trace("now: " << now.toMSecs());
     log_trace("first timer at: " << timer->finished().toMSecs());
@@ -225,7 +363,11 @@ std::size_t TimerQueue::processTimers()
 
         if( now < timer->finished() )
         {
-            Pt::int64_t remaining = (timer->finished() - now).toUSecs();
+            // the handlers of expired timers might have taken a while
+            Timespan current = fired ? Clock::getMonotonicTicks() : now;
+            Pt::int64_t remaining = (timer->finished() - current).toUSecs();
+            if(remaining < 0)
+                remaining = 0;
             
             Pt::uint64_t remainingMSecs = static_cast<Pt::uint64_t>(remaining / 1000);
             if(remaining % 1000 > 0) 
@@ -240,6 +382,7 @@ std::size_t TimerQueue::processTimers()
 
         log_trace("updating expired timer");
         timer->update(now);
+        fired = true;
 
         if( ! _timers.empty() )
         {
@@ -252,7 +395,334 @@ std::size_t TimerQueue::processTimers()
         }
     }
 
-    log_trace("TimerQueue::processTimers returns: " << lowestTimeout);
+    log_trace("SortedTimerQueue::processTimers returns: " << lowestTimeout);
+    return lowestTimeout;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// TimerWheel
+//////////////////////////////////////////////////////////////////////////
+
+TimerWheel::TimerWheel()
+: _current(0)
+, _count(0)
+, _running(0)
+{
+    for(int n = 0; n <= SlotCount; ++n)
+        _slots[n] = 0;
+
+    for(std::size_t n = 0; n < sizeof(_bitmap) / sizeof(_bitmap[0]); ++n)
+        _bitmap[n] = 0;
+}
+
+
+TimerWheel::~TimerWheel()
+{
+    for(int n = 0; n <= SlotCount; ++n)
+    {
+        while( _slots[n] )
+        {
+            Timer* timer = _slots[n];
+            timer->detach();
+
+            // detaching a timer of another loop does not unlink it
+            if(_slots[n] == timer)
+                unlink(*timer);
+        }
+    }
+}
+
+
+void TimerWheel::addTimer(Timer& timer)
+{
+    unlink(timer);
+
+    if( ! timer.isStarted() )
+        return;
+
+    if(_count == 0 && ! _running)
+        _current = toTicks( Clock::getMonotonicTicks() );
+
+    place(timer);
+}
+
+
+void TimerWheel::removeTimer(Timer& timer)
+{
+    if(_running == &timer)
+        _running = 0;
+
+    unlink(timer);
+}
+
+
+void TimerWheel::place(Timer& timer)
+{
+    Pt::int64_t expires = toTicks( timer.finished() );
+    if(expires < _current)
+        expires = _current;
+
+    Pt::uint64_t delta = static_cast<Pt::uint64_t>(expires - _current);
+
+    if(delta < RootSize)
+    {
+        link(timer, static_cast<int>(expires & (RootSize - 1)));
+        return;
+    }
+
+    int level = 1;
+    int shift = RootBits;
+    for( ; level < Levels - 1; ++level, shift += LevelBits)
+    {
+        if( delta < (Pt::uint64_t(1) << (shift + LevelBits)) )
+            break;
+    }
+
+    // timers beyond the range of the wheel are parked in the last level
+    // and placed again when they are cascaded down
+    const Pt::uint64_t maxDelta = (Pt::uint64_t(1) << (shift + LevelBits)) - 1;
+    if(delta > maxDelta)
+        expires = _current + static_cast<Pt::int64_t>(maxDelta);
+
+    int index = static_cast<int>( (expires >> shift) & (LevelSize - 1) );
+    link(timer, RootSize + (level - 1) * LevelSize + index);
+}
+
+
+void TimerWheel::link(Timer& timer, int slot)
+{
+    timer._slot = slot;
+    timer._slotPrev = 0;
+    timer._slotNext = _slots[slot];
+
+    if(_slots[slot])
+        _slots[slot]->_slotPrev = &timer;
+
+    _slots[slot] = &timer;
+    ++_count;
+
+    if(slot < SlotCount)
+        _bitmap[slot / 64] |= Pt::uint64_t(1) << (slot % 64);
+}
+
+
+void TimerWheel::unlink(Timer& timer)
+{
+    if(timer._slot < 0)
+        return;
+
+    const int slot = timer._slot;
+
+    if(timer._slotPrev)
+        timer._slotPrev->_slotNext = timer._slotNext;
+    else
+        _slots[slot] = timer._slotNext;
+
+    if(timer._slotNext)
+        timer._slotNext->_slotPrev = timer._slotPrev;
+
+    timer._slot = -1;
+    timer._slotNext = 0;
+    timer._slotPrev = 0;
+    --_count;
+
+    if(slot < SlotCount && _slots[slot] == 0)
+        _bitmap[slot / 64] &= ~(Pt::uint64_t(1) << (slot % 64));
+}
+
+
+void TimerWheel::cascade(int level)
+{
+    const int shift = RootBits + (level - 1) * LevelBits;
+    const int index = static_cast<int>( (_current >> shift) & (LevelSize - 1) );
+    const int slot = RootSize + (level - 1) * LevelSize + index;
+
+    Timer* timer = _slots[slot];
+    _slots[slot] = 0;
+    _bitmap[slot / 64] &= ~(Pt::uint64_t(1) << (slot % 64));
+
+    while(timer)
+    {
+        Timer* next = timer->_slotNext;
+        timer->_slot = -1;
+        timer->_slotNext = 0;
+        timer->_slotPrev = 0;
+        --_count;
+
+        place(*timer);
+        timer = next;
+    }
+}
+
+
+Pt::int64_t TimerWheel::nextTick() const
+{
+    const Pt::int64_t never = std::numeric_limits<Pt::int64_t>::max();
+    Pt::int64_t next = never;
+
+    // root level, slots before the current index belong to the next round
+    const int index = static_cast<int>(_current & (RootSize - 1));
+    const Pt::int64_t base = _current - index;
+
+    for(int n = 0; n < RootSize / 64; ++n)
+    {
+        Pt::uint64_t word = _bitmap[n];
+        if(word == 0)
+            continue;
+
+        const int first = n * 64;
+        Pt::uint64_t ahead = word;
+        if(index >= first + 64)
+            ahead = 0;
+        else if(index > first)
+            ahead &= ~Pt::uint64_t(0) << (index - first);
+
+        Pt::int64_t tick = ahead ? base + first + lowestBit(ahead)
+                                 : base + RootSize + first + lowestBit(word);
+
+        if(tick < next)
+            next = tick;
+    }
+
+    // upper levels expire when they are cascaded down
+    for(int level = 1; level < Levels; ++level)
+    {
+        Pt::uint64_t word = _bitmap[RootSize / 64 + level - 1];
+        if(word == 0)
+            continue;
+
+        const int shift = RootBits + (level - 1) * LevelBits;
+        const Pt::int64_t span = Pt::int64_t(1) << shift;
+        const Pt::int64_t aligned = (_current + span - 1) & ~(span - 1);
+        const int start = static_cast<int>( (aligned >> shift) & (LevelSize - 1) );
+
+        Pt::int64_t tick = aligned + nextBit(word, start) * span;
+        if(tick < next)
+            next = tick;
+    }
+
+    return next;
+}
+
+
+std::size_t TimerWheel::processTimers(const Timespan& now)
+{
+    log_trace("TimerWheel::processTimers");
+
+    std::size_t lowestTimeout = EventLoop::WaitInfinite;
+
+    if(_count == 0)
+    {
+        log_trace("no timers, returning: " << lowestTimeout);
+        return lowestTimeout;
+    }
+
+    const Pt::int64_t nowTick = now.toUSecs() / 1000;
+    bool fired = false;
+
+    log_trace("now: " << now.toMSecs());
+
+    while(true)
+    {
+        Pt::int64_t tick = nextTick();
+        if(tick > nowTick)
+            break;
+
+        _current = tick;
+
+        const int index = static_cast<int>(_current & (RootSize - 1));
+        if(index == 0)
+        {
+            for(int level = 1; level < Levels; ++level)
+            {
+                cascade(level);
+
+                const int shift = RootBits + (level - 1) * LevelBits;
+                if( (_current >> shift) & (LevelSize - 1) )
+                    break;
+            }
+        }
+
+        // move the due slot to the expired batch, timers started from
+        // within a handler are queued after the current tick
+        Timer* expired = _slots[index];
+        _slots[index] = 0;
+        _bitmap[index / 64] &= ~(Pt::uint64_t(1) << (index % 64));
+        _slots[ExpiredSlot] = 0;
+
+        // slots are linked last-in first, sort the batch by expiry time
+        // so timers of one tick fire in the same order as with the
+        // SortedTimerQueue, the usual reversed input inserts at the head
+        while(expired)
+        {
+            Timer* timer = expired;
+            expired = timer->_slotNext;
+
+            Timer* prev = 0;
+            Timer* pos = _slots[ExpiredSlot];
+            while( pos && pos->finished() < timer->finished() )
+            {
+                prev = pos;
+                pos = pos->_slotNext;
+            }
+
+            timer->_slot = ExpiredSlot;
+            timer->_slotPrev = prev;
+            timer->_slotNext = pos;
+
+            if(pos)
+                pos->_slotPrev = timer;
+
+            if(prev)
+                prev->_slotNext = timer;
+            else
+                _slots[ExpiredSlot] = timer;
+        }
+
+        ++_current;
+
+        while( _slots[ExpiredSlot] )
+        {
+            Timer* timer = _slots[ExpiredSlot];
+            unlink(*timer);
+
+            log_trace("updating expired timer");
+            _running = timer;
+            timer->update(now);
+            fired = true;
+
+            // the timer might have been stopped, restarted or
+            // destroyed by the handler
+            if(_running == timer)
+            {
+                _running = 0;
+                if( timer->isStarted() )
+                    place(*timer);
+            }
+        }
+
+        if(_count == 0)
+            break;
+    }
+
+    if(_count > 0)
+    {
+        // the handlers of expired timers might have taken a while
+        Timespan current = fired ? Clock::getMonotonicTicks() : now;
+        Pt::int64_t remaining = nextTick() * 1000 - current.toUSecs();
+        if(remaining < 0)
+            remaining = 0;
+
+        Pt::uint64_t remainingMSecs = static_cast<Pt::uint64_t>(remaining / 1000);
+        if(remaining % 1000 > 0)
+            ++remainingMSecs;
+
+        lowestTimeout = (remainingMSecs <= EventLoop::WaitMax) ? static_cast<std::size_t>(remainingMSecs)
+                                                               : EventLoop::WaitMax ;
+    }
+
+    log_trace("TimerWheel::processTimers returns: " << lowestTimeout);
     return lowestTimeout;
 }
 
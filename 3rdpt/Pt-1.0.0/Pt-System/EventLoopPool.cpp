@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include <Pt/System/EventLoopPool.h>
+#include <Pt/System/Thread.h>
+#include <Pt/Connectable.h>
+#include <Pt/Event.h>
+#include <stdexcept>
+#include <memory>
+
+namespace Pt {
+
+namespace System {
+
+namespace {
+
+class InvokeEvent : public BasicEvent<InvokeEvent>
+{
+    public:
+        explicit InvokeEvent(const Callable<void>& cb)
+        : _cb( cb.clone() )
+        { }
+
+        InvokeEvent(const InvokeEvent& ev)
+        : _cb( ev._cb->clone() )
+        { }
+
+        ~InvokeEvent()
+        { delete _cb; }
+
+        void invoke() const
+        { _cb->call(); }
+
+    private:
+        InvokeEvent& operator=(const InvokeEvent&);
+
+        Callable<void>* _cb;
+};
+
+}
+
+class EventLoopPool::Worker : public Connectable
+{
+    public:
+        explicit Worker(const MainLoopOptions& opts)
+        : _loop(opts)
+        , _thread(_loop)
+        {
+            _loop.eventReceived() += Pt::slot(*this, &Worker::onInvoke);
+        }
+
+        MainLoop& loop()
+        { return _loop; }
+
+        void start(std::size_t cpu)
+        {
+            _thread.start();
+            _thread.setAffinity(cpu);
+        }
+
+        void stop()
+        {
+            if( _thread.isJoinable() )
+            {
+                _loop.exit();
+                _thread.join();
+            }
+        }
+
+    private:
+        void onInvoke(const InvokeEvent& ev)
+        { ev.invoke(); }
+
+    private:
+        MainLoop _loop;
+        AttachedThread _thread;
+};
+
+
+EventLoopPool::EventLoopPool(std::size_t size)
+: _running(false)
+{
+    init( size, MainLoopOptions() );
+}
+
+
+EventLoopPool::EventLoopPool(std::size_t size, const MainLoopOptions& opts)
+: _running(false)
+{
+    init(size, opts);
+}
+
+
+EventLoopPool::~EventLoopPool()
+{
+    stop();
+
+    std::vector<Worker*>::iterator it;
+    for(it = _workers.begin(); it != _workers.end(); ++it)
+    {
+        delete *it;
+    }
+}
+
+
+void EventLoopPool::init(std::size_t size, const MainLoopOptions& opts)
+{
+    if(size == 0)
+        size = Thread::processorCount();
+
+    _workers.reserve(size);
+
+    try
+    {
+        for(std::size_t n = 0; n < size; ++n)
+        {
+            std::auto_ptr<Worker> worker( new Worker(opts) );
+            _workers.push_back( worker.get() );
+            worker.release();
+        }
+    }
+    catch(...)
+    {
+        std::vector<Worker*>::iterator it;
+        for(it = _workers.begin(); it != _workers.end(); ++it)
+        {
+            delete *it;
+        }
+
+        throw;
+    }
+}
+
+
+MainLoop& EventLoopPool::loop(std::size_t n)
+{
+    if( n >= _workers.size() )
+        throw std::out_of_range("invalid loop index");
+
+    return _workers[n]->loop();
+}
+
+
+void EventLoopPool::start()
+{
+    if(_running)
+        return;
+
+    const std::size_t cpus = Thread::processorCount();
+
+    _running = true;
+
+    try
+    {
+        for(std::size_t n = 0; n < _workers.size(); ++n)
+        {
+            _workers[n]->start(n % cpus);
+        }
+    }
+    catch(...)
+    {
+        stop();
+        throw;
+    }
+}
+
+
+void EventLoopPool::stop()
+{
+    if( ! _running )
+        return;
+
+    std::vector<Worker*>::iterator it;
+    for(it = _workers.begin(); it != _workers.end(); ++it)
+    {
+        (*it)->stop();
+    }
+
+    _running = false;
+}
+
+
+void EventLoopPool::post(std::size_t n, const Callable<void>& cb)
+{
+    InvokeEvent ev(cb);
+    loop(n).commitEvent(ev);
+}
+
+} // namespace System
+
+} // namespace Pt
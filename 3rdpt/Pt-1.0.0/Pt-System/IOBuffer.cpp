@@ -43,6 +43,8 @@ IOBuffer::IOBuffer(std::size_t bufferSize, bool extend)
 , _obufferSize(0)
 , _obuffer    (0)
 , _oextend    (false)
+, _osealed    (0)
+, _oqueued    (0)
 {
     init(bufferSize, extend);
 }
@@ -54,6 +56,8 @@ IOBuffer::IOBuffer(IODevice& ioDevice, std::size_t bufferSize, bool extend)
 , _obufferSize(0)
 , _obuffer    (0)
 , _oextend    (false)
+, _osealed    (0)
+, _oqueued    (0)
 {
     init(bufferSize, extend);
     attach(ioDevice); 
@@ -62,8 +66,9 @@ IOBuffer::IOBuffer(IODevice& ioDevice, std::size_t bufferSize, bool extend)
 
 IOBuffer::~IOBuffer()
 {
-    delete _ibuffer;
-    delete _obuffer;
+    clearQueue();
+    delete [] _ibuffer;
+    delete [] _obuffer;
 }
 
 
@@ -123,6 +128,7 @@ void IOBuffer::discard()
         throw IOPending("IOBuffer in use");
 
     setg(0, 0, 0);
+    clearQueue();
 
     if(_obuffer)
         setp(_obuffer, _obuffer + _obufferSize);
@@ -131,6 +137,27 @@ void IOBuffer::discard()
 }
 
 
+void IOBuffer::queue(const char* data, std::size_t n, RefCounted& owner)
+{
+    if(n == 0)
+        return;
+
+    // data in the put area is sent before the queued data
+    std::size_t used = pptr() ? pptr() - pbase() : 0;
+    if(used > _osealed)
+    {
+        OutputRef ref = { 0, 0, _osealed, used };
+        _oqueue.push_back(ref);
+        _osealed = used;
+    }
+
+    OutputRef ref = { &owner, data, 0, n };
+    _oqueue.push_back(ref);
+    owner.addRef();
+    _oqueued += n;
+}
+
+
 void IOBuffer::beginRead()
 {
     if(_ioDevice == 0 || _ioDevice->isReading())
@@ -189,6 +216,13 @@ void IOBuffer::beginWrite()
     if(_ioDevice == 0 || _ioDevice->isWriting())
         return;
 
+    if( ! _oqueue.empty() )
+    {
+        initOutputVector();
+        _ioDevice->beginWritev(&_ovec[0], _ovec.size());
+        return;
+    }
+
     if( pptr() )
     {
         std::size_t avail = pptr() - pbase();
@@ -207,26 +241,93 @@ void IOBuffer::onWrite(IODevice& dev)
 
 
 std::size_t IOBuffer::endWrite()
+{
+    std::size_t written = 0;
+
+    if( pptr() || ! _oqueue.empty() )
+        written = _ioDevice->endWrite();
+
+    consumeOutput(written);
+    return written;
+}
+
+
+void IOBuffer::initOutputVector()
+{
+    _ovec.clear();
+
+    std::deque<OutputRef>::const_iterator it;
+    for(it = _oqueue.begin(); it != _oqueue.end(); ++it)
+    {
+        const char* data = it->owner ? it->data : _obuffer;
+        _ovec.push_back( IOVec(data + it->begin, it->end - it->begin) );
+    }
+
+    std::size_t used = pptr() ? pptr() - pbase() : 0;
+    if(used > _osealed)
+        _ovec.push_back( IOVec(_obuffer + _osealed, used - _osealed) );
+}
+
+
+void IOBuffer::consumeOutput(std::size_t n)
 {
     typedef IOBuffer::traits_type traits_type;
 
+    while( ! _oqueue.empty() )
+    {
+        OutputRef& ref = _oqueue.front();
+        std::size_t size = ref.end - ref.begin;
+
+        if(n < size)
+        {
+            ref.begin += n;
+            if(ref.owner)
+                _oqueued -= n;
+
+            return;
+        }
+
+        n -= size;
+
+        if(ref.owner)
+        {
+            _oqueued -= size;
+            ref.owner->release();
+        }
+
+        _oqueue.pop_front();
+    }
+
+    // the remaining bytes were written from the put area after the
+    // last queued range, the rest is moved to the front of the buffer
     std::size_t leftover = 0;
-    std::size_t written  = 0;
 
     if( pptr() )
     {
-        std::size_t avail = pptr() - pbase();
-        written      = _ioDevice->endWrite();
-
-        leftover = avail - written;
+        std::size_t start = _osealed + n;
+        leftover = (pptr() - pbase()) - start;
         if(leftover > 0)
-            traits_type::move(_obuffer, _obuffer + written, leftover);
+            traits_type::move(_obuffer, _obuffer + start, leftover);
     }
 
+    _osealed = 0;
     setp(_obuffer, _obuffer + _obufferSize);
     pbump( static_cast<int>(leftover) );
+}
 
-    return written;
+
+void IOBuffer::clearQueue()
+{
+    std::deque<OutputRef>::iterator it;
+    for(it = _oqueue.begin(); it != _oqueue.end(); ++it)
+    {
+        if(it->owner)
+            it->owner->release();
+    }
+
+    _oqueue.clear();
+    _osealed = 0;
+    _oqueued = 0;
 }
 
 
@@ -266,16 +367,13 @@ int IOBuffer::sync()
     if(!_ioDevice )
         return 0;
 
-    if( pptr() )
+    while( ! _oqueue.empty() || pptr() > pbase() )
     {
-        while(pptr() > pbase())
-        {
-            const IOBuffer::int_type ch = overflow(traits_type::eof());
-            if(ch == traits_type::eof())
-                return -1;
+        const IOBuffer::int_type ch = overflow(traits_type::eof());
+        if(ch == traits_type::eof())
+            return -1;
 
-            _ioDevice->sync();
-        }
+        _ioDevice->sync();
     }
 
     return 0;
@@ -339,19 +437,24 @@ std::streambuf::int_type IOBuffer::overflow(std::streambuf::int_type ch)
     else if(_ioDevice->isWriting()) // beginWrite is unfinished
     {
         endWrite();
+
+        // the write may have consumed queued data only
+        if( pptr() == epptr() )
+            return overflow(ch);
     }
     else if(traits_type::eq_int_type(ch, traits_type::eof()) || ! _oextend)
     {
-        // normal blocking overflow case
-        std::size_t avail    = pptr() - _obuffer;
-        std::size_t written  = _ioDevice->write(_obuffer, avail);
-        std::size_t leftover = avail - written;
-
-        if(leftover > 0)
-            traits_type::move(_obuffer, _obuffer + written, leftover);
+        // queued data has to be written before the put area
+        while( ! _oqueue.empty() )
+        {
+            initOutputVector();
+            consumeOutput( _ioDevice->writev(&_ovec[0], _ovec.size()) );
+        }
 
-        setp(_obuffer, _obuffer + _obufferSize);
-        pbump( static_cast<int>(leftover) );
+        // normal blocking overflow case
+        std::size_t avail = pptr() - _obuffer;
+        if(avail > 0)
+            consumeOutput( _ioDevice->write(_obuffer, avail) );
     }
     else
     {
@@ -33,6 +33,24 @@ namespace Pt {
 
 namespace System {
 
+namespace {
+
+// skips leading empty segments, so the first segment can be used
+// by devices which do not support vectored I/O
+template <typename VecT>
+VecT* skipEmpty(VecT* vec, std::size_t& count)
+{
+    while(count > 1 && vec->size == 0)
+    {
+        ++vec;
+        --count;
+    }
+
+    return vec;
+}
+
+}
+
 IODevice::IODevice()
 : _loop(0)
 , _rbuf(0)
@@ -41,6 +59,10 @@ IODevice::IODevice()
 , _wbuf(0)
 , _wbuflen(0)
 , _wavail(0)
+, _rvec(0)
+, _rveclen(0)
+, _wvec(0)
+, _wveclen(0)
 , _eof(false)
 { }
 
@@ -97,24 +119,33 @@ std::size_t IODevice::endRead()
         _rbuf = 0;
         _rbuflen = 0;
         _ravail = 0;
+        _rvec = 0;
+        _rveclen = 0;
         return n;
     }
 
     try
     {
-        n = this->onEndRead(*_loop, _rbuf, _rbuflen, _eof);
+        if(_rvec)
+            n = this->onEndReadv(*_loop, _rvec, _rveclen, _eof);
+        else
+            n = this->onEndRead(*_loop, _rbuf, _rbuflen, _eof);
     }
     catch (...)
     {
         _rbuf = 0;
         _rbuflen = 0;
         _ravail = 0;
+        _rvec = 0;
+        _rveclen = 0;
         throw;
     }
 
     _rbuf = 0;
     _rbuflen = 0;
     _ravail = 0;
+    _rvec = 0;
+    _rveclen = 0;
 
     return n;
 }
@@ -162,24 +193,33 @@ std::size_t IODevice::endWrite()
         _wbuf = 0;
         _wbuflen = 0;
         _wavail = 0;
+        _wvec = 0;
+        _wveclen = 0;
         return n;
     }
 
     try
     {
-        n = onEndWrite(*_loop, _wbuf, _wbuflen);
+        if(_wvec)
+            n = onEndWritev(*_loop, _wvec, _wveclen);
+        else
+            n = onEndWrite(*_loop, _wbuf, _wbuflen);
     }
     catch (...)
     {
         _wbuf = 0;
         _wbuflen = 0;
         _wavail = 0;
+        _wvec = 0;
+        _wveclen = 0;
         throw;
     }
 
     _wbuf = 0;
     _wbuflen = 0;
     _wavail = 0;
+    _wvec = 0;
+    _wveclen = 0;
 
     return n;
 }
@@ -194,6 +234,108 @@ std::size_t IODevice::write(const char* buffer, std::size_t n)
 }
 
 
+void IODevice::beginReadv(IOVec* vec, std::size_t count)
+{
+    EventLoop* loop = this->loop();
+    if( ! loop )
+        throw std::logic_error("I/O device not active");
+
+    if (_rbuf || _wbuf)
+        throw IOPending("I/O operation pending");
+
+    vec = skipEmpty(vec, count);
+    std::size_t r = this->onBeginReadv(*loop, vec, count, _eof);
+
+    if(r > 0 || _eof)
+        loop->setReady(*this); 
+
+    _rbuf = vec->base;
+    _rbuflen = vec->size;
+    _ravail = r;
+    _rvec = vec;
+    _rveclen = count;
+}
+
+
+std::size_t IODevice::readv(IOVec* vec, std::size_t count)
+{
+    if( _rbuf || _wbuf)
+        throw IOPending("I/O operation pending");
+
+    vec = skipEmpty(vec, count);
+    return this->onReadv(vec, count, _eof);
+}
+
+
+void IODevice::beginWritev(const IOVec* vec, std::size_t count)
+{
+    EventLoop* loop = this->loop();
+    if( ! loop )
+        throw std::logic_error("I/O device not active");
+
+    if (_wbuf || _rbuf)
+        throw IOPending("I/O operation pending");
+
+    vec = skipEmpty(vec, count);
+    std::size_t r = this->onBeginWritev(*loop, vec, count);
+
+    if(r > 0)
+        loop->setReady(*this); 
+
+    _wbuf = vec->base;
+    _wbuflen = vec->size;
+    _wavail = r;
+    _wvec = vec;
+    _wveclen = count;
+}
+
+
+std::size_t IODevice::writev(const IOVec* vec, std::size_t count)
+{
+    if( _rbuf || _wbuf)
+        throw IOPending("I/O operation pending");
+
+    vec = skipEmpty(vec, count);
+    return this->onWritev(vec, count);
+}
+
+
+std::size_t IODevice::onBeginReadv(EventLoop& loop, IOVec* vec, std::size_t, bool& eof)
+{
+    return this->onBeginRead(loop, vec->base, vec->size, eof);
+}
+
+
+std::size_t IODevice::onEndReadv(EventLoop& loop, IOVec* vec, std::size_t, bool& eof)
+{
+    return this->onEndRead(loop, vec->base, vec->size, eof);
+}
+
+
+std::size_t IODevice::onReadv(IOVec* vec, std::size_t, bool& eof)
+{
+    return this->onRead(vec->base, vec->size, eof);
+}
+
+
+std::size_t IODevice::onBeginWritev(EventLoop& loop, const IOVec* vec, std::size_t)
+{
+    return this->onBeginWrite(loop, vec->base, vec->size);
+}
+
+
+std::size_t IODevice::onEndWritev(EventLoop& loop, const IOVec* vec, std::size_t)
+{
+    return this->onEndWrite(loop, vec->base, vec->size);
+}
+
+
+std::size_t IODevice::onWritev(const IOVec* vec, std::size_t)
+{
+    return this->onWrite(vec->base, vec->size);
+}
+
+
 bool IODevice::seekable() const
 {
     return onSeekable();
@@ -261,6 +403,11 @@ void IODevice::onCancel()
     _wbuf = 0;
     _wbuflen = 0;
     _wavail = 0;
+
+    _rvec = 0;
+    _rveclen = 0;
+    _wvec = 0;
+    _wveclen = 0;
 }
 
 } // namespace System
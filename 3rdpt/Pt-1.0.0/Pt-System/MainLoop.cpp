@@ -33,11 +33,34 @@ namespace Pt {
 
 namespace System {
 
+MainLoopOptions::MainLoopOptions()
+: _flags(0)
+{}
+
+
+MainLoopOptions::MainLoopOptions(const MainLoopOptions& opts)
+: _flags(opts._flags)
+{
+}
+
+
+MainLoopOptions::~MainLoopOptions()
+{
+}
+
+
+MainLoopOptions& MainLoopOptions::operator=(const MainLoopOptions& opts)
+{
+    _flags = opts._flags;
+    return *this;
+}
+
+
 MainLoop::MainLoop()
 : EventLoop()
 , _impl(0)
 {
-    _impl = new MainLoopImpl( this->eventReceived() );
+    _impl = new MainLoopImpl( this->eventReceived(), MainLoopOptions() );
 }
 
 
@@ -45,7 +68,25 @@ MainLoop::MainLoop(Allocator& a)
 : EventLoop()
 , _impl(0)
 {
-    _impl = new MainLoopImpl(this->eventReceived(), a);
+    _impl = new MainLoopImpl(this->eventReceived(), a, MainLoopOptions());
+}
+
+
+MainLoop::MainLoop(const MainLoopOptions& opts)
+: EventLoop()
+, _options(opts)
+, _impl(0)
+{
+    _impl = new MainLoopImpl(this->eventReceived(), opts);
+}
+
+
+MainLoop::MainLoop(Allocator& a, const MainLoopOptions& opts)
+: EventLoop()
+, _options(opts)
+, _impl(0)
+{
+    _impl = new MainLoopImpl(this->eventReceived(), a, opts);
 }
 
 
@@ -132,6 +173,12 @@ void MainLoop::onDetachTimer( Timer& timer )
     _impl->detach(timer);
 }
 
+
+Timespan MainLoop::onLoopTime() const
+{
+    return _impl->loopTime();
+}
+
 } // namespace System
 
 } // namespace Pt
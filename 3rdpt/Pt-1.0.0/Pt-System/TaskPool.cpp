@@ -0,0 +1,518 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include <Pt/System/TaskPool.h>
+#include <Pt/System/EventLoop.h>
+#include <Pt/System/Thread.h>
+#include <Pt/System/Logger.h>
+#include <exception>
+#include <memory>
+
+log_define("Pt.System.TaskPool")
+
+#if defined(_MSC_VER)
+    #define PT_TASKPOOL_TLS __declspec(thread)
+#else
+    #define PT_TASKPOOL_TLS __thread
+#endif
+
+namespace Pt {
+
+namespace System {
+
+namespace {
+
+// queue indices wrap around, differences are computed modulo 2^n
+inline int indexAdd(int i, int n)
+{
+    return static_cast<int>( static_cast<unsigned>(i) + static_cast<unsigned>(n) );
+}
+
+inline int indexDiff(int a, int b)
+{
+    return static_cast<int>( static_cast<unsigned>(a) - static_cast<unsigned>(b) );
+}
+
+class CallableTask : public Task
+{
+    public:
+        explicit CallableTask(const Callable<void>& cb)
+        : _cb( cb.clone() )
+        { }
+
+        ~CallableTask()
+        { delete _cb; }
+
+        virtual void run()
+        { _cb->call(); }
+
+    private:
+        Callable<void>* _cb;
+};
+
+}
+
+/** @internal Worker thread of a TaskPool.
+
+    Each worker owns a Chase-Lev deque. The owner pushes and pops at
+    the bottom, other threads steal from the top. The capacity is fixed,
+    tasks which do not fit are put into the shared queue of the pool.
+*/
+class TaskWorker : private NonCopyable
+{
+    public:
+        enum
+        {
+            Capacity = 4096,
+            Mask = Capacity - 1
+        };
+
+        TaskWorker(TaskPool& pool, std::size_t index)
+        : _pool(pool)
+        , _index(index)
+        , _top(0)
+        , _bottom(0)
+        , _thread( Pt::callable(*this, &TaskWorker::run) )
+        { }
+
+        TaskPool& pool()
+        { return _pool; }
+
+        std::size_t index() const
+        { return _index; }
+
+        void start()
+        { _thread.start(); }
+
+        void join()
+        { _thread.join(); }
+
+        bool isEmpty()
+        {
+            int t = atomicGet(_top);
+            int b = atomicGet(_bottom);
+            return indexDiff(b, t) <= 0;
+        }
+
+        bool push(Task* task)
+        {
+            int b = atomicGet(_bottom);
+            int t = atomicGet(_top);
+
+            if( indexDiff(b, t) >= Capacity )
+                return false;
+
+            _tasks[b & Mask] = task;
+            atomicExchange(_bottom, indexAdd(b, 1));
+            return true;
+        }
+
+        Task* pop()
+        {
+            int b = indexAdd(atomicGet(_bottom), -1);
+            atomicExchange(_bottom, b);
+            int t = atomicGet(_top);
+
+            int size = indexDiff(b, t);
+            if(size < 0)
+            {
+                atomicSet(_bottom, t);
+                return 0;
+            }
+
+            Task* task = _tasks[b & Mask];
+            if(size > 0)
+                return task;
+
+            // last task, race against thieves
+            if( atomicCompareExchange(_top, indexAdd(t, 1), t) != t )
+                task = 0;
+
+            atomicSet(_bottom, indexAdd(t, 1));
+            return task;
+        }
+
+        Task* steal(bool& retry)
+        {
+            int t = atomicGet(_top);
+            int b = atomicGet(_bottom);
+
+            if( indexDiff(b, t) <= 0 )
+                return 0;
+
+            Task* task = _tasks[t & Mask];
+            if( atomicCompareExchange(_top, indexAdd(t, 1), t) != t )
+            {
+                retry = true;
+                return 0;
+            }
+
+            return task;
+        }
+
+    private:
+        void run()
+        { _pool.work(*this); }
+
+    private:
+        TaskPool& _pool;
+        std::size_t _index;
+        atomic_t _top;
+        char _pad[64];
+        atomic_t _bottom;
+        Task* volatile _tasks[Capacity];
+        AttachedThread _thread;
+};
+
+static PT_TASKPOOL_TLS TaskWorker* currentWorker = 0;
+
+
+TaskPool::TaskPool(std::size_t threads)
+: _idle(0)
+, _stopped(false)
+{
+    if(threads == 0)
+        threads = Thread::processorCount();
+
+    _workers.reserve(threads);
+
+    std::size_t started = 0;
+
+    try
+    {
+        for(std::size_t n = 0; n < threads; ++n)
+        {
+            std::auto_ptr<TaskWorker> worker( new TaskWorker(*this, n) );
+            _workers.push_back( worker.get() );
+            worker.release();
+        }
+
+        // workers access the list of workers to steal tasks
+        for(; started < _workers.size(); ++started)
+        {
+            _workers[started]->start();
+        }
+    }
+    catch(...)
+    {
+        stop(started);
+        throw;
+    }
+}
+
+
+TaskPool::~TaskPool()
+{
+    stop( _workers.size() );
+}
+
+
+void TaskPool::stop(std::size_t started)
+{
+    {
+        MutexLock lock(_mutex);
+        _stopped = true;
+        _wake.broadcast();
+    }
+
+    // workers steal from each other until they have finished, so no
+    // worker is deleted before all were joined
+    for(std::size_t n = 0; n < started; ++n)
+    {
+        _workers[n]->join();
+    }
+
+    for(std::size_t n = 0; n < _workers.size(); ++n)
+    {
+        delete _workers[n];
+    }
+
+    _workers.clear();
+}
+
+
+bool TaskPool::runPending()
+{
+    TaskWorker* self = currentWorker;
+    if(self && &self->pool() != this)
+        self = 0;
+
+    Task* task = take(self);
+    if( ! task )
+        return false;
+
+    execute(task);
+    return true;
+}
+
+
+void TaskPool::spawn(Task* task)
+{
+    TaskWorker* self = currentWorker;
+
+    if( ! self || &self->pool() != this || ! self->push(task) )
+    {
+        MutexLock lock(_mutex);
+        _shared.push_back(task);
+        _wake.signal();
+        return;
+    }
+
+    if( atomicGet(_idle) > 0 )
+    {
+        MutexLock lock(_mutex);
+        _wake.signal();
+    }
+}
+
+
+Task* TaskPool::take(TaskWorker* self)
+{
+    if(self)
+    {
+        Task* task = self->pop();
+        if(task)
+            return task;
+    }
+
+    const std::size_t count = _workers.size();
+    const std::size_t first = self ? self->index() + 1 : 0;
+
+    bool retry = true;
+    while(retry)
+    {
+        retry = false;
+
+        for(std::size_t n = 0; n < count; ++n)
+        {
+            TaskWorker* victim = _workers[ (first + n) % count ];
+            if(victim == self)
+                continue;
+
+            Task* task = victim->steal(retry);
+            if(task)
+                return task;
+        }
+
+        MutexLock lock(_mutex);
+        if( ! _shared.empty() )
+        {
+            Task* task = _shared.front();
+            _shared.pop_front();
+            return task;
+        }
+    }
+
+    return 0;
+}
+
+
+void TaskPool::execute(Task* task)
+{
+    TaskGroup* group = task->_group;
+
+    try
+    {
+        task->run();
+    }
+    catch(const std::exception& e)
+    {
+        log_error("task failed: " << e.what());
+    }
+    catch(...)
+    {
+        log_error("task failed");
+    }
+
+    delete task;
+
+    if(group)
+        group->finishTask();
+}
+
+
+bool TaskPool::hasWork()
+{
+    if( ! _shared.empty() )
+        return true;
+
+    std::vector<TaskWorker*>::iterator it;
+    for(it = _workers.begin(); it != _workers.end(); ++it)
+    {
+        if( ! (*it)->isEmpty() )
+            return true;
+    }
+
+    return false;
+}
+
+
+void TaskPool::work(TaskWorker& worker)
+{
+    currentWorker = &worker;
+
+    while(true)
+    {
+        Task* task = take(&worker);
+        if(task)
+        {
+            execute(task);
+            continue;
+        }
+
+        MutexLock lock(_mutex);
+        if(_stopped)
+            break;
+
+        // spawners check the idle count after publishing a task, so
+        // either they signal or the task is seen here
+        atomicIncrement(_idle);
+
+        if( ! hasWork() )
+            _wake.wait(lock);
+
+        atomicDecrement(_idle);
+    }
+
+    currentWorker = 0;
+}
+
+
+
+
+TaskGroup::TaskGroup(TaskPool& pool)
+: _pool(pool)
+, _pending(0)
+, _busy(false)
+, _loop(0)
+, _event(0)
+{
+}
+
+
+TaskGroup::~TaskGroup()
+{
+    wait();
+    clearEvent();
+}
+
+
+void TaskGroup::run(const Callable<void>& cb)
+{
+    run( new CallableTask(cb) );
+}
+
+
+void TaskGroup::run(Task* task)
+{
+    task->_group = this;
+
+    if( atomicIncrement(_pending) == 1 )
+    {
+        MutexLock lock(_mutex);
+        _busy = true;
+    }
+
+    _pool.spawn(task);
+}
+
+
+void TaskGroup::wait()
+{
+    while( atomicGet(_pending) != 0 )
+    {
+        if( ! _pool.runPending() )
+            break;
+    }
+
+    MutexLock lock(_mutex);
+    while(_busy)
+        _finished.wait(lock);
+}
+
+
+bool TaskGroup::isFinished() const
+{
+    MutexLock lock(_mutex);
+    return ! _busy;
+}
+
+
+void TaskGroup::commitWhenFinished(EventLoop& loop, const Event& ev)
+{
+    MutexLock lock(_mutex);
+    clearEvent();
+
+    if( ! _busy )
+    {
+        loop.commitEvent(ev);
+        return;
+    }
+
+    _event = &ev.clone(_allocator);
+    _loop = &loop;
+}
+
+
+void TaskGroup::finishTask()
+{
+    if( atomicDecrement(_pending) != 0 )
+        return;
+
+    MutexLock lock(_mutex);
+
+    // a task might have been added in the meantime
+    if( atomicGet(_pending) != 0 )
+        return;
+
+    _busy = false;
+
+    if(_event)
+    {
+        _loop->commitEvent(*_event);
+        clearEvent();
+    }
+
+    _finished.broadcast();
+}
+
+
+void TaskGroup::clearEvent()
+{
+    if(_event)
+    {
+        _event->destroy(_allocator);
+        _event = 0;
+        _loop = 0;
+    }
+}
+
+} // namespace System
+
+} // namespace Pt
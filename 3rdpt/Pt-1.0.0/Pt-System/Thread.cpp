@@ -121,6 +121,15 @@ void Thread::join()
 }
 
 
+bool Thread::setAffinity(std::size_t cpu)
+{
+    if( _state != Running )
+        return false;
+
+    return _impl->setAffinity(cpu);
+}
+
+
 void Thread::exit()
 {
     ThreadImpl::exit();
@@ -139,13 +148,24 @@ void Thread::sleep(unsigned int ms)
 }
 
 
+std::size_t Thread::processorCount()
+{
+    return ThreadImpl::processorCount();
+}
+
+
 bool Thread::joinNoThrow()
 {
+    // a thread can only be joined once
+    if( _state != Running )
+        return _state == Joined;
+
     bool ret = true;
 
     try
     {
         _impl->join();
+        _state = Thread::Joined;
     }
     catch(...)
     {
@@ -86,6 +86,9 @@ Timer::Timer()
 , _interval(0)
 , _finished(0)
 , _reserved(0)
+, _slotNext(0)
+, _slotPrev(0)
+, _slot(-1)
 { }
 
 
@@ -122,7 +125,7 @@ void Timer::start(std::size_t interval)
     _interval = interval;
     log_debug("Timer started, interval: " << _interval);
     
-    Timespan now = Clock::getSystemTicks();
+    Timespan now = Clock::getMonotonicTicks();
     
     bool overrun = checkInterval(_interval, now);
     if(overrun)
@@ -159,7 +162,7 @@ bool Timer::update()
     if(isStarted() == false)
         return false;
 
-    Timespan now = Clock::getSystemTicks();
+    Timespan now = Clock::getMonotonicTicks();
     return this->update(now);
 }
 
@@ -25,14 +25,107 @@
  */
 #include "ClockImpl.h"
 #include "Pt/SourceInfo.h"
+#include <Pt/System/Clock.h>
+#include <Pt/System/Mutex.h>
+#include <Pt/Atomicity.h>
 #include <sys/time.h>
 #include <time.h>
+#include <fstream>
+#include <string>
+
+namespace {
+
+#if defined(__linux__) && defined(__x86_64__) && defined(__GNUC__) && defined(__SIZEOF_INT128__)
+    #define PT_WITH_TSC_CLOCK
+#endif
+
+// The source is switched atomically, so the clock can be read while
+// another thread selects the source. The time stamp counter is only
+// calibrated once, before it is selected for the first time.
+Pt::atomic_t monotonicSource(Pt::System::Clock::Monotonic);
+Pt::System::Mutex sourceMutex;
+
+inline Pt::int64_t readClock(clockid_t id)
+{
+    struct timespec ts;
+    clock_gettime(id, &ts);
+    return Pt::int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+#ifdef PT_WITH_TSC_CLOCK
+
+// The time stamp counter is converted to nanoseconds relative to a base
+// reading of the monotonic clock. The factor is a 32.32 fixed point number.
+struct TscClock
+{
+    bool calibrated;
+    Pt::uint64_t baseCount;
+    Pt::int64_t baseTime;
+    Pt::uint64_t factor;
+};
+
+TscClock tscClock = { false, 0, 0, 0 };
+
+inline Pt::uint64_t readTsc()
+{
+    Pt::uint32_t lo, hi;
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return (Pt::uint64_t(hi) << 32) | lo;
+}
+
+inline Pt::int64_t readTscClock()
+{
+    unsigned __int128 delta = readTsc() - tscClock.baseCount;
+    return tscClock.baseTime + static_cast<Pt::int64_t>( (delta * tscClock.factor) >> 32 );
+}
+
+// the kernel only uses the TSC as its clock source, if it is
+// invariant and synchronized between all CPUs
+bool isTscStable()
+{
+    std::ifstream ifs("/sys/devices/system/clocksource/clocksource0/current_clocksource");
+    std::string source;
+    ifs >> source;
+    return source == "tsc";
+}
+
+bool calibrateTsc()
+{
+    if( ! isTscStable() )
+        return false;
+
+    const Pt::int64_t startTime = readClock(CLOCK_MONOTONIC);
+    const Pt::uint64_t startCount = readTsc();
+
+    struct timespec ts = { 0, 20000000 };
+    while( nanosleep(&ts, &ts) != 0 )
+        ;
+
+    const Pt::int64_t stopTime = readClock(CLOCK_MONOTONIC);
+    const Pt::uint64_t stopCount = readTsc();
+
+    if(stopCount <= startCount)
+        return false;
+
+    unsigned __int128 elapsed = stopTime - startTime;
+    tscClock.factor = static_cast<Pt::uint64_t>( (elapsed << 32) / (stopCount - startCount) );
+    tscClock.baseCount = stopCount;
+    tscClock.baseTime = stopTime;
+    tscClock.calibrated = true;
+    return true;
+}
+
+#endif
+
+}
 
 namespace Pt {
 
 namespace System {
 
 ClockImpl::ClockImpl()
+: _startTime(0)
+, _stopTime(0)
 {}
 
 
@@ -42,18 +135,14 @@ ClockImpl::~ClockImpl()
 
 void ClockImpl::start()
 {
-   gettimeofday( &_startTime, 0 );
+    _startTime = getMonotonicTime();
 }
 
 
 Timespan ClockImpl::stop()
 {
-    gettimeofday( &_stopTime, 0 );
-
-    time_t secs = _stopTime.tv_sec - _startTime.tv_sec;
-    suseconds_t usecs = _stopTime.tv_usec - _startTime.tv_usec;
-
-    return Timespan(secs, usecs);
+    _stopTime = getMonotonicTime();
+    return Timespan( (_stopTime - _startTime) / 1000 );
 }
 
 
@@ -104,6 +193,57 @@ Timespan ClockImpl::getSystemTicks()
     return Timespan(tv.tv_sec, tv.tv_usec);
 }
 
+
+Pt::int64_t ClockImpl::getMonotonicTime()
+{
+    switch( atomicGet(monotonicSource) )
+    {
+#ifdef CLOCK_MONOTONIC_COARSE
+        case Clock::MonotonicCoarse:
+            return readClock(CLOCK_MONOTONIC_COARSE);
+#endif
+
+#ifdef PT_WITH_TSC_CLOCK
+        case Clock::TimestampCounter:
+            return readTscClock();
+#endif
+    }
+
+    return readClock(CLOCK_MONOTONIC);
+}
+
+
+bool ClockImpl::setMonotonicSource(int source)
+{
+    MutexLock lock(sourceMutex);
+
+    bool supported = false;
+    switch(source)
+    {
+        case Clock::Monotonic:
+            supported = true;
+            break;
+
+        case Clock::MonotonicCoarse:
+#ifdef CLOCK_MONOTONIC_COARSE
+            {
+                struct timespec ts;
+                supported = clock_gettime(CLOCK_MONOTONIC_COARSE, &ts) == 0;
+            }
+#endif
+            break;
+
+        case Clock::TimestampCounter:
+#ifdef PT_WITH_TSC_CLOCK
+            supported = tscClock.calibrated || calibrateTsc();
+#endif
+            break;
+    }
+
+    atomicSet(monotonicSource, supported ? source : Clock::Monotonic);
+    return supported;
+}
+
 } // namespace Pt
 
 } // namespace System
@@ -1,5 +1,6 @@
 #include "Pt/DateTime.h"
 #include "Pt/Timespan.h"
+#include "Pt/Types.h"
 #include <sys/time.h>
 #include <time.h>
 
@@ -24,10 +25,13 @@ class ClockImpl
 
         static Timespan getSystemTicks();
 
+        static Pt::int64_t getMonotonicTime();
+
+        static bool setMonotonicSource(int source);
+
     private:
-        struct timeval  _startTime;
-        struct timeval  _stopTime;
-        struct timezone _timeZone;
+        Pt::int64_t _startTime;
+        Pt::int64_t _stopTime;
 };
 
 } // namespace Pt
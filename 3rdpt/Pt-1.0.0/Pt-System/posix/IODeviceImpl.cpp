@@ -31,6 +31,7 @@
 #include "Pt/System/IOError.h"
 #include "Pt/System/Logger.h"
 #include "Pt/System/EventLoop.h"
+#include <sys/uio.h>
 #include <cerrno>
 #include <cassert>
 
@@ -40,6 +41,62 @@ namespace Pt {
 
 namespace System {
 
+namespace {
+
+// number of segments passed to a single readv/writev call, well
+// below IOV_MAX. Longer vectors are transferred partially.
+const std::size_t MaxIOVec = 64;
+
+std::size_t toIOVec(struct iovec* iov, const IOVec* vec, std::size_t count)
+{
+    if(count > MaxIOVec)
+        count = MaxIOVec;
+
+    for(std::size_t n = 0; n < count; ++n)
+    {
+        iov[n].iov_base = vec[n].base;
+        iov[n].iov_len = vec[n].size;
+    }
+
+    return count;
+}
+
+// result of a read, which was completed by the selector
+std::size_t readResult(ssize_t result, bool& eof)
+{
+    if(result > 0)
+    {
+        log_debug("read:" << result << " bytes");
+        return static_cast<std::size_t>(result);
+    }
+
+    if(result == 0 || result == -ECONNRESET)
+    {
+        eof = true;
+        log_debug("read: EOF");
+        return 0;
+    }
+
+    throw IOError("read failed");
+}
+
+// result of a write, which was completed by the selector
+std::size_t writeResult(ssize_t result)
+{
+    if(result > 0)
+    {
+        log_debug("wrote:" << result << " bytes");
+        return static_cast<std::size_t>(result);
+    }
+
+    if(result == 0 || result == -ECONNRESET || result == -EPIPE)
+        throw IOError("lost connection to peer");
+
+    throw IOError("write failed");
+}
+
+}
+
 IODeviceImpl::IODeviceImpl(IODevice& device)
 : _ioh(device)
 , _timeout(System::EventLoop::WaitInfinite)
@@ -164,7 +221,10 @@ std::size_t IODeviceImpl::beginRead(EventLoop& loop, char* buffer, std::size_t n
             throw IOError("read failed");
     }
 
-    loop.selector().beginRead( &_ioh );
+    Selector& selector = loop.selector();
+    if( ! selector.submitRead(&_ioh, buffer, n) )
+        selector.beginRead( &_ioh );
+
     return 0;
 }
 
@@ -181,6 +241,10 @@ std::size_t IODeviceImpl::endRead(EventLoop& loop, char* buffer, std::size_t n,
         throw IOError("read error");
     }
 
+    ssize_t result = 0;
+    if( _ioh.takeResult(IOHandle::Read, result) )
+        return readResult(result, eof);
+
     return this->read( buffer, n, eof );
 }
 
@@ -246,7 +310,10 @@ std::size_t IODeviceImpl::beginWrite(EventLoop& loop, const char* buffer, std::s
             throw System::IOError("write failed");
     }
     
-    loop.selector().beginWrite( &_ioh );
+    Selector& selector = loop.selector();
+    if( ! selector.submitWrite(&_ioh, buffer, n) )
+        selector.beginWrite( &_ioh );
+
     return 0;
 }
 
@@ -263,6 +330,10 @@ std::size_t IODeviceImpl::endWrite(EventLoop& loop, const char* buffer, std::siz
         throw IOError("write error");
     }
 
+    ssize_t result = 0;
+    if( _ioh.takeResult(IOHandle::Write, result) )
+        return writeResult(result);
+
     return this->write( buffer, n );
 }
 
@@ -301,6 +372,196 @@ std::size_t IODeviceImpl::write( const char* buffer, std::size_t count )
 }
 
 
+std::size_t IODeviceImpl::beginReadv(EventLoop& loop, IOVec* vec, std::size_t count, bool& eof)
+{
+    log_debug("begin readv on fd:" << _ioh.fd);
+
+    struct iovec iov[MaxIOVec];
+    int iovcnt = static_cast<int>( toIOVec(iov, vec, count) );
+
+    for(;;)
+    {
+        ssize_t ret = ::readv( _ioh.fd, iov, iovcnt);
+        if (ret > 0)
+        {
+            log_debug("read:" << ret << " bytes");
+            return static_cast<std::size_t>(ret);
+        }
+
+        if(ret == 0 || errno == ECONNRESET)
+        {
+            eof = true;
+            log_debug("read: EOF");
+            return 0;
+        }
+
+        if(errno == EAGAIN)
+            break;
+
+        if(errno != EINTR)
+            throw IOError("read failed");
+    }
+
+    Selector& selector = loop.selector();
+    if( ! selector.submitReadv(&_ioh, vec, count) )
+        selector.beginRead( &_ioh );
+
+    return 0;
+}
+
+
+std::size_t IODeviceImpl::endReadv(EventLoop& loop, IOVec* vec, std::size_t count, bool& eof)
+{
+    log_debug("end readv on fd:" << _ioh.fd);
+
+    loop.selector().endRead( &_ioh );
+
+    if (_errorPending)
+    {
+        _errorPending = false;
+        throw IOError("read error");
+    }
+
+    ssize_t result = 0;
+    if( _ioh.takeResult(IOHandle::Read, result) )
+        return readResult(result, eof);
+
+    return this->readv(vec, count, eof);
+}
+
+
+std::size_t IODeviceImpl::readv(IOVec* vec, std::size_t count, bool& eof)
+{
+    struct iovec iov[MaxIOVec];
+    int iovcnt = static_cast<int>( toIOVec(iov, vec, count) );
+
+    ssize_t ret = 0;
+
+    while(true)
+    {
+        ret = ::readv( _ioh.fd, iov, iovcnt);
+        if(ret > 0)
+            break;
+
+        if(ret == 0 || errno == ECONNRESET)
+        {
+            eof = true;
+            log_debug("read: EOF");
+            return 0;
+        }
+
+        if(errno == EINTR)
+            continue;
+
+        if(errno != EAGAIN)
+            throw IOError("read failed");
+
+        fd_set rfds;
+        FD_ZERO(&rfds);
+        FD_SET(this->fd(), &rfds);
+        bool ret = this->wait(_timeout, &rfds, 0, 0);
+        if(false == ret)
+        {
+            throw System::IOError("read");
+        }
+    }
+
+    log_debug("read: " << ret << " bytes");
+    return ret;
+}
+
+
+std::size_t IODeviceImpl::beginWritev(EventLoop& loop, const IOVec* vec, std::size_t count)
+{
+    log_debug("begin writev on fd:" << _ioh.fd);
+
+    struct iovec iov[MaxIOVec];
+    int iovcnt = static_cast<int>( toIOVec(iov, vec, count) );
+
+    for(;;)
+    {
+        ssize_t ret = ::writev(_ioh.fd, iov, iovcnt);
+        if (ret > 0)
+        {
+            log_debug("wrote:" << ret << " bytes");
+            return static_cast<std::size_t>(ret);
+        }
+
+        if (ret == 0 || errno == ECONNRESET || errno == EPIPE)
+            throw System::IOError("lost connection to peer");
+
+        if(errno == EAGAIN)
+            break;
+
+        if(errno != EINTR)
+            throw System::IOError("write failed");
+    }
+
+    Selector& selector = loop.selector();
+    if( ! selector.submitWritev(&_ioh, vec, count) )
+        selector.beginWrite( &_ioh );
+
+    return 0;
+}
+
+
+std::size_t IODeviceImpl::endWritev(EventLoop& loop, const IOVec* vec, std::size_t count)
+{
+    log_debug("end writev on fd:" << _ioh.fd);
+
+    loop.selector().endWrite( &_ioh );
+
+    if (_errorPending)
+    {
+        _errorPending = false;
+        throw IOError("write error");
+    }
+
+    ssize_t result = 0;
+    if( _ioh.takeResult(IOHandle::Write, result) )
+        return writeResult(result);
+
+    return this->writev(vec, count);
+}
+
+
+std::size_t IODeviceImpl::writev(const IOVec* vec, std::size_t count)
+{
+    struct iovec iov[MaxIOVec];
+    int iovcnt = static_cast<int>( toIOVec(iov, vec, count) );
+
+    ssize_t ret = 0;
+
+    while(true)
+    {
+        ret = ::writev(_ioh.fd, iov, iovcnt);
+        if(ret > 0)
+            break;
+
+        if(ret == 0 || errno == ECONNRESET || errno == EPIPE)
+            throw IOError("lost connection to peer");
+
+        if(errno == EINTR)
+            continue;
+
+        if(errno != EAGAIN)
+            throw IOError("Could not write to file handle");
+
+        fd_set wfds;
+        FD_ZERO(&wfds);
+        FD_SET(this->fd(), &wfds);
+        bool ret = this->wait(_timeout, 0, &wfds, 0);
+        if(false == ret)
+        {
+            throw System::IOError("write");
+        }
+    }
+
+    log_debug("wrote: " << ret << " bytes");
+    return ret;
+}
+
+
 bool IODeviceImpl::wait(std::size_t msecs, fd_set* rfds, fd_set* wfds, fd_set* efds)
 {
     struct timeval* timeout = 0;
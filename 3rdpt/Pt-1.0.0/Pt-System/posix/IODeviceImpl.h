@@ -80,6 +80,10 @@ namespace System {
 
             void open(int fd, bool closeOnExec);
 
+            //! Opens a descriptor which is already non-blocking and close-on-exec
+            void adopt(int fd)
+            { _ioh.fd = fd; }
+
             bool isOpen() const;
 
             virtual void cancel(EventLoop& loop);
@@ -97,6 +101,18 @@ namespace System {
             virtual size_t endWrite(EventLoop& loop, const char* buffer, size_t n);
 
             virtual size_t write( const char* buffer, size_t count );
+
+            virtual size_t beginReadv(EventLoop& loop, IOVec* vec, size_t count, bool& eof);
+
+            virtual size_t endReadv(EventLoop& loop, IOVec* vec, size_t count, bool& eof);
+
+            virtual size_t readv(IOVec* vec, size_t count, bool& eof);
+
+            virtual size_t beginWritev(EventLoop& loop, const IOVec* vec, size_t count);
+
+            virtual size_t endWritev(EventLoop& loop, const IOVec* vec, size_t count);
+
+            virtual size_t writev(const IOVec* vec, size_t count);
             
             virtual void sync() const;
 
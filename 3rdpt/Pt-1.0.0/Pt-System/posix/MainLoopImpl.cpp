@@ -28,25 +28,76 @@
 
 #include "MainLoopImpl.h"
 #include <Pt/System/Logger.h>
+#include <memory>
 
 log_define("Pt.System.MainLoop")
 
+namespace {
+
+Pt::System::TimerQueue* createTimerQueue(const Pt::System::MainLoopOptions& opts)
+{
+    if( opts.useTimerWheel() )
+        return new Pt::System::TimerWheel();
+
+    return new Pt::System::SortedTimerQueue();
+}
+
+
+Pt::System::Selector* createSelector(const Pt::System::MainLoopOptions& opts)
+{
+#if defined(PT_WITH_LINUX_IO_URING)
+    if( opts.useIoUring() )
+    {
+        std::auto_ptr<Pt::System::UringSelector> selector( new Pt::System::UringSelector() );
+        if( selector->open() )
+            return selector.release();
+
+        log_info("io_uring not supported, using epoll");
+    }
+#endif
+
+#if defined(PT_WITH_LINUX_EPOLL_OPTION)
+    if( opts.isEdgeTriggered() || opts.useIoUring() )
+    {
+        Pt::System::EpollSelector* selector = new Pt::System::EpollSelector();
+
+        if( opts.isEdgeTriggered() )
+            selector->setEdgeTriggered();
+
+        return selector;
+    }
+#endif
+
+    return new Pt::System::SelectorImpl();
+}
+
+}
+
 namespace Pt {
 
 namespace System {
 
-MainLoopImpl::MainLoopImpl(Signal<const Event&>& eventSignal)
+MainLoopImpl::MainLoopImpl(Signal<const Event&>& eventSignal, const MainLoopOptions& opts)
 : _event(&eventSignal)
-{ }
+, _timerQueue( createTimerQueue(opts) )
+, _selector( createSelector(opts) )
+{
+}
 
-MainLoopImpl::MainLoopImpl(Signal<const Event&>& eventSignal, Allocator& a)
+MainLoopImpl::MainLoopImpl(Signal<const Event&>& eventSignal, Allocator& a, const MainLoopOptions& opts)
 : _event(&eventSignal)
+, _timerQueue( createTimerQueue(opts) )
 , _eventQueue(a)
-{ }
+, _selector( createSelector(opts) )
+{
+}
 
 
 MainLoopImpl::~MainLoopImpl()
-{ }
+{
+    delete _timerQueue;
+    delete _selector;
+}
 
 
 void MainLoopImpl::avail(Selectable& s)
@@ -110,7 +161,9 @@ bool MainLoopImpl::waitNext()
     log_trace("MainLoopImpl::waitNext");
 
     bool isActive = true;
-    std::size_t msecs = _timerQueue.processTimers();
+
+    _loopTime = Clock::getMonotonicTicks();
+    std::size_t msecs = _timerQueue->processTimers(_loopTime);
 
     log_debug("next timer expires in: " << msecs << " msecs");
 
@@ -130,8 +183,11 @@ bool MainLoopImpl::waitNext()
         selectable->run();
     }
 
+    // the loop time is read again, when it is requested after waiting
+    _loopTime.setNull();
+
     log_debug("waiting for events");
-    if( _selector.waitForWake(msecs) )
+    if( _selector->waitForWake(msecs) )
         isActive = _eventQueue.processEvents(*_event);
 
     log_trace("returning activity: " << isActive);
@@ -32,6 +32,8 @@
 #include "Pt/System/Api.h"
 #include <Pt/System/Mutex.h>
 #include <Pt/System/EventLoop.h>
+#include <Pt/System/MainLoop.h>
+#include <Pt/System/Clock.h>
 #include "Pt/Signal.h"
 #include <vector>
 
@@ -43,6 +45,9 @@
 #ifdef __linux__
     //#define PT_WITH_LINUX_EPOLL
     #define PT_WITH_POSIX_POLL
+
+    // epoll is selected at runtime for edge-triggered loops
+    #define PT_WITH_LINUX_EPOLL_OPTION
 #endif
 
 #if defined (PT_WITH_LINUX_EPOLL)
@@ -55,6 +60,14 @@
     #include "Selector_select.h"
 #endif
 
+#if defined(PT_WITH_LINUX_EPOLL_OPTION)
+    #include "Selector_epoll.h"
+#endif
+
+#if defined(PT_WITH_LINUX_IO_URING)
+    #include "Selector_uring.h"
+#endif
+
 namespace Pt {
 
 namespace System {
@@ -62,20 +75,20 @@ namespace System {
 class MainLoopImpl
 {
     public:
-        MainLoopImpl(Signal<const Event&>& eventSignal);
+        MainLoopImpl(Signal<const Event&>& eventSignal, const MainLoopOptions& opts);
 
-        MainLoopImpl(Signal<const Event&>& eventSignal, Allocator& a);
+        MainLoopImpl(Signal<const Event&>& eventSignal, Allocator& a, const MainLoopOptions& opts);
 
         ~MainLoopImpl();
 
         Selector& selector()
-        { return _selector; }
+        { return *_selector; }
 
         void attach(Selectable& s)
-        { _selector.attach(s); }
+        { _selector->attach(s); }
         
         void detach(Selectable& s)
-        { _selector.detach(s); }
+        { _selector->detach(s); }
 
         void idle(Selectable& s);
 
@@ -86,7 +99,7 @@ class MainLoopImpl
         void exit();
 
         void wake()
-        { _selector.wake(); }
+        { _selector->wake(); }
 
         void commitEvent(const Event& event);
 
@@ -95,20 +108,29 @@ class MainLoopImpl
         bool processEvents();
 
         void attach(Timer& timer)
-        { _timerQueue.addTimer(timer); }
+        { _timerQueue->addTimer(timer); }
 
         void detach( Timer& timer )
-        { _timerQueue.removeTimer(timer); }
+        { _timerQueue->removeTimer(timer); }
 
         bool waitNext();
 
+        const Timespan& loopTime() const
+        {
+            if( _loopTime.isNull() )
+                _loopTime = Clock::getMonotonicTicks();
+
+            return _loopTime;
+        }
+
     private:
         Mutex _mutex;
         Signal<const Event&>* _event;
-        TimerQueue _timerQueue;
+        TimerQueue* _timerQueue;
         EventQueue _eventQueue;
         std::vector<Selectable*> _avail;
-        SelectorImpl _selector;
+        Selector* _selector;
+        mutable Timespan _loopTime;
 };
 
 } //namespace System
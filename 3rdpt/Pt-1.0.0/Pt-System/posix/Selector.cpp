@@ -41,6 +41,36 @@ Selector::~Selector()
 { 
 }
 
+
+bool Selector::submitRead(IOHandle*, char*, size_t)
+{
+    return false;
+}
+
+
+bool Selector::submitReadv(IOHandle*, IOVec*, size_t)
+{
+    return false;
+}
+
+
+bool Selector::submitWrite(IOHandle*, const char*, size_t)
+{
+    return false;
+}
+
+
+bool Selector::submitWritev(IOHandle*, const IOVec*, size_t)
+{
+    return false;
+}
+
+
+bool Selector::submitAccept(IOHandle*)
+{
+    return false;
+}
+
 } //namespace System
 
 } //namespace Pt
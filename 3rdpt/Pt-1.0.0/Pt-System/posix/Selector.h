@@ -32,19 +32,31 @@
 #include "Pt/System/Api.h"
 #include "Pt/System/IOError.h"
 #include "Pt/System/SystemError.h"
+#include "Pt/Atomicity.h"
 #include <iostream>
 #include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
 
+#if defined(__linux__)
+    #define PT_WITH_LINUX_EVENTFD
+    #include <sys/eventfd.h>
+#endif
+
 namespace Pt {
 
 namespace System {
 
+/** @internal Wakes a selector from another thread through a pipe.
+
+    Multiple wakes are coalesced until the selector has seen the
+    pending wake, so only the first one writes to the pipe.
+*/
 class WakePipe
 {
     public:
         WakePipe()
+        : _pending(0)
         {
             //Open a pipe to send wake up message.
             if( ::pipe( _wakePipe ) )
@@ -78,8 +90,10 @@ class WakePipe
 
         void wake()
         {
+            if( atomicCompareExchange(_pending, 1, 0) != 0 )
+                return;
+
             ::write( _wakePipe[1], "W", 1);
-            ::fsync( _wakePipe[1] );
         }
 
         bool isReady()
@@ -106,6 +120,14 @@ class WakePipe
                 throw IOError( PT_ERROR_MSG("pipe read failed") );
             }
 
+            // the flag is cleared after draining, otherwise the byte of
+            // a concurrent wake could be drained while the flag is set
+            // again and all later wakes were dropped. A wake coalesced
+            // before the flag was cleared did not write, but its work is
+            // already queued, so it is reported here
+            if( atomicExchange(_pending, 0) != 0 )
+                isWake = true;
+
             return isWake;
         }
 
@@ -114,7 +136,111 @@ class WakePipe
 
     private:
         int _wakePipe[2];
-        char _buffer[1024];
+        atomic_t _pending;
+        char _buffer[16];
+};
+
+#if defined(PT_WITH_LINUX_EVENTFD)
+
+/** @internal Wakes a selector from another thread through an eventfd.
+
+    Like the WakePipe, multiple wakes are coalesced until the selector
+    has seen the pending wake.
+*/
+class WakeEventFd
+{
+    public:
+        WakeEventFd()
+        : _pending(0)
+        {
+            _fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if(-1 == _fd)
+                throw SystemError( PT_ERROR_MSG("eventfd failed") );
+        }
+
+        ~WakeEventFd()
+        {
+            ::close(_fd);
+        }
+
+        void wake()
+        {
+            if( atomicCompareExchange(_pending, 1, 0) != 0 )
+                return;
+
+            const eventfd_t one = 1;
+            ::write(_fd, &one, sizeof(one));
+        }
+
+        bool isReady()
+        {
+            bool isWake = false;
+            while(true)
+            {
+                eventfd_t value = 0;
+                ssize_t ret = ::read(_fd, &value, sizeof(value));
+                if(ret == sizeof(value))
+                {
+                    isWake = true;
+                    break;
+                }
+
+                if(ret == -1)
+                {
+                    if(errno == EINTR)
+                        continue;
+
+                    if(errno == EAGAIN)
+                        break;
+                }
+
+                throw IOError( PT_ERROR_MSG("eventfd read failed") );
+            }
+
+            // cleared after reading the counter, see WakePipe::isReady()
+            if( atomicExchange(_pending, 0) != 0 )
+                isWake = true;
+
+            return isWake;
+        }
+
+        int readFd()
+        { return _fd; }
+
+    private:
+        int _fd;
+        atomic_t _pending;
+};
+
+typedef WakeEventFd Waker;
+
+#else
+
+typedef WakePipe Waker;
+
+#endif
+
+struct IOVec;
+
+/** @internal Operation submitted to a completion-based selector.
+
+    The selector keeps the parameters to resubmit the operation and
+    stores the result, which is the number of bytes transferred, the
+    accepted fd or a negative errno value.
+*/
+struct IOOperation
+{
+    IOOperation()
+    : code(0)
+    , addr(0)
+    , len(0)
+    , result(0)
+    { }
+
+    int code;
+    void* addr;
+    size_t len;
+    ssize_t result;
 };
 
 struct IOHandle
@@ -135,6 +261,9 @@ struct IOHandle
     , events(0)
     , changed(0)
     , ready(0)
+    , pending(0)
+    , completed(0)
+    , queued(false)
     { }
 
     IOHandle(Selectable& sel)
@@ -144,6 +273,9 @@ struct IOHandle
     , events(0)
     , changed(0)
     , ready(0)
+    , pending(0)
+    , completed(0)
+    , queued(false)
     { }
 
     IOHandle()
@@ -153,6 +285,9 @@ struct IOHandle
     , events(0)
     , changed(0)
     , ready(0)
+    , pending(0)
+    , completed(0)
+    , queued(false)
     { }
 
     bool isOpen() const
@@ -161,12 +296,35 @@ struct IOHandle
     bool isActive() const
     { return id != InvalidId; }
 
+    /** @brief Takes the result of a completed read or write.
+
+        Returns false if no operation of the kind @a op has completed,
+        which is always the case with readiness-based selectors.
+    */
+    bool takeResult(short op, ssize_t& result)
+    {
+        if( ! (completed & op) )
+            return false;
+
+        completed &= ~op;
+        ready &= ~op;
+        result = (op == Read) ? readOp.result : writeOp.result;
+        return true;
+    }
+
     Selectable* sel;
     int fd;
     size_t id;
     short events;
     short changed;
     short ready;
+
+    // state of completion-based selectors
+    short pending;
+    short completed;
+    bool queued;
+    IOOperation readOp;
+    IOOperation writeOp;
 };
 
 
@@ -177,6 +335,14 @@ class Selector
 
         virtual ~Selector();
 
+        virtual void attach(Selectable& s) = 0;
+
+        virtual void detach(Selectable& s) = 0;
+
+        virtual void wake() = 0;
+
+        virtual bool waitForWake(size_t msecs) = 0;
+
         virtual void cancel(IOHandle& h) = 0;
 
         virtual void beginRead(IOHandle* h) = 0;
@@ -192,6 +358,32 @@ class Selector
         virtual bool isWritable(IOHandle* h) = 0;
 
         virtual bool isError(IOHandle* h) = 0;
+
+        /** @brief Submits a read to complete in the background.
+
+            Completion-based selectors read into @a buffer without
+            waiting for readiness first. The buffer must stay valid until
+            the read is ended. The result is taken from the handle with
+            IOHandle::takeResult() after endRead(). Returns false, if the
+            selector only reports readiness.
+        */
+        virtual bool submitRead(IOHandle* h, char* buffer, size_t n);
+
+        //! @brief Submits a vectored read, see submitRead().
+        virtual bool submitReadv(IOHandle* h, IOVec* vec, size_t count);
+
+        //! @brief Submits a write, see submitRead().
+        virtual bool submitWrite(IOHandle* h, const char* buffer, size_t n);
+
+        //! @brief Submits a vectored write, see submitRead().
+        virtual bool submitWritev(IOHandle* h, const IOVec* vec, size_t count);
+
+        /** @brief Submits an accept on a listening socket.
+
+            The accepted fd is non-blocking and close-on-exec. It is
+            taken as the result of a read, see submitRead().
+        */
+        virtual bool submitAccept(IOHandle* h);
 };
 
 } //namespace System
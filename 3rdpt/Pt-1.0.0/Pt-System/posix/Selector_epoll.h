@@ -34,6 +34,8 @@
 #include "Pt/System/Selectable.h"
 
 #include <set>
+#include <vector>
+#include <algorithm>
 #include <limits>
 #include <cassert>
 #include <cstddef>
@@ -45,23 +47,29 @@ namespace Pt {
 
 namespace System {
 
-class SelectorImpl  : public Selector
+/** @internal Selector based on epoll.
+
+    It is the default selector if PT_WITH_LINUX_EPOLL is defined,
+    otherwise it is only used for loops with edge-triggered notification.
+*/
+class EpollSelector : public Selector
 {
     public:
-        SelectorImpl()
+        EpollSelector()
         : _epfd(-1)
         , _avail(0)
+        , _edgeTriggered(false)
         {
             _epfd = epoll_create(16);
 
             epoll_event ev;
             ev.events = EPOLLIN;
-            ev.data.ptr = &_wakePipe;
+            ev.data.ptr = &_waker;
 
-            epoll_ctl(_epfd, EPOLL_CTL_ADD, _wakePipe.readFd(), &ev);
+            epoll_ctl(_epfd, EPOLL_CTL_ADD, _waker.readFd(), &ev);
         }
 
-        ~SelectorImpl()
+        ~EpollSelector()
         {         
             while( ! _selectables.empty() )
             {
@@ -81,6 +89,20 @@ class SelectorImpl  : public Selector
             SelectableList::unlink(s);
         }
 
+        /** @brief Switch to edge-triggered notification.
+
+            Each fd is registered once for reading and writing, begin and
+            end operations only update the interest of the handle, which
+            saves an epoll_ctl per operation. The I/O devices try their
+            operation until it fails with EAGAIN before they wait, so no
+            edge is lost.
+        */
+        void setEdgeTriggered()
+        { _edgeTriggered = true; }
+
+        bool isEdgeTriggered() const
+        { return _edgeTriggered; }
+
         void cancel(IOHandle& h)
         {
             if(h.fd < 0)
@@ -109,6 +131,12 @@ class SelectorImpl  : public Selector
 
         void beginRead(IOHandle* h)
         {
+            if(_edgeTriggered)
+            {
+                beginEdge(h, IOHandle::Read);
+                return;
+            }
+
             bool isAdded = h->changed != h->events;
             if(! isAdded)
                 _changelist.push_back(h);
@@ -119,6 +147,12 @@ class SelectorImpl  : public Selector
 
         void endRead(IOHandle* h)
         {
+            if(_edgeTriggered)
+            {
+                endEdge(h, IOHandle::Read);
+                return;
+            }
+
             bool isAdded = h->changed != h->events;
             if(! isAdded)
                 _changelist.push_back(h);
@@ -129,6 +163,12 @@ class SelectorImpl  : public Selector
 
         void beginWrite(IOHandle* h)
         {
+            if(_edgeTriggered)
+            {
+                beginEdge(h, IOHandle::Write);
+                return;
+            }
+
             bool isAdded = h->changed != h->events;
             if(! isAdded)
                 _changelist.push_back(h);
@@ -139,6 +179,12 @@ class SelectorImpl  : public Selector
 
         void endWrite(IOHandle* h)
         {
+            if(_edgeTriggered)
+            {
+                endEdge(h, IOHandle::Write);
+                return;
+            }
+
             bool isAdded = h->changed != h->events;
             if(! isAdded)
                 _changelist.push_back(h);
@@ -179,7 +225,7 @@ class SelectorImpl  : public Selector
 
         void wake()
         {
-            _wakePipe.wake();
+            _waker.wake();
         }
 
     public:
@@ -193,18 +239,31 @@ class SelectorImpl  : public Selector
             for( std::vector<IOHandle*>::iterator it = _changelist.begin(); it != _changelist.end(); ++it)
             {
                 IOHandle* h = *it;
+
+                epoll_event ev;
+                ev.events = 0;
+                ev.data.ptr = h;
+
+                if(_edgeTriggered)
+                {
+                    // registered once, the interest is kept in the handle
+                    if(h->events == 0)
+                    {
+                        ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+                        epoll_ctl(_epfd, EPOLL_CTL_ADD, h->fd, &ev);
+                        h->events = IOHandle::Read | IOHandle::Write;
+                    }
+
+                    continue;
+                }
         
                 if(h->changed == h->events)
                     continue;
 
-                epoll_event ev;
-
                 if(h->changed & IOHandle::Read)
                     ev.events |= EPOLLIN;
                 if(h->changed & IOHandle::Write)
                     ev.events |= EPOLLOUT;
- 
-                ev.data.ptr = h;
 
                 if(h->events)
                     epoll_ctl(_epfd, EPOLL_CTL_MOD, h->fd, &ev);
@@ -265,9 +324,9 @@ class SelectorImpl  : public Selector
                 {
                     continue;
                 }
-                else if( p == &_wakePipe )
+                else if( p == &_waker )
                 {
-                    isWake = _wakePipe.isReady();
+                    isWake = _waker.isReady();
                 }
                 else
                 {
@@ -286,6 +345,10 @@ class SelectorImpl  : public Selector
                         h->ready |= IOHandle::Error;
                     }
 
+                    // edges without a pending operation are only recorded
+                    if(_edgeTriggered && (h->changed & (IOHandle::Read|IOHandle::Write)) == 0)
+                        continue;
+
                     h->sel->run();
                 }
             }
@@ -293,17 +356,42 @@ class SelectorImpl  : public Selector
             return isWake;
         }
 
+    private:
+        void beginEdge(IOHandle* h, short flag)
+        {
+            if(h->id == IOHandle::InvalidId)
+            {
+                _changelist.push_back(h);
+                h->id = 1;
+            }
+
+            // the operation was just tried and failed with EAGAIN
+            h->ready &= ~flag;
+            h->changed |= flag;
+        }
+
+        void endEdge(IOHandle* h, short flag)
+        {
+            h->ready &= ~(flag | IOHandle::Error);
+            h->changed &= ~flag;
+        }
+
     private:
         SelectableList _selectables;
         Clock _clock;
-        WakePipe _wakePipe;
+        Waker _waker;
         int _epfd;
         std::vector<IOHandle*> _changelist;
         static const unsigned EVENTS_SIZE = 32;
         struct epoll_event _events[EVENTS_SIZE];
         int _avail;
+        bool _edgeTriggered;
 };
 
+#if defined(PT_WITH_LINUX_EPOLL)
+typedef EpollSelector SelectorImpl;
+#endif
+
 } //namespace System
 
 } //namespace Pt
@@ -57,7 +57,7 @@ class SelectorImpl : public Selector
             _kd = kqueue();
 
             struct kevent kev;
-            EV_SET(&kev, _wakePipe.readFd(), EVFILT_READ, EV_ADD, 0, 0, &_wakePipe);
+            EV_SET(&kev, _waker.readFd(), EVFILT_READ, EV_ADD, 0, 0, &_waker);
 
             timespec ts;
             ts.tv_sec = 0;
@@ -176,7 +176,7 @@ class SelectorImpl : public Selector
 
         void wake()
         {
-            _wakePipe.wake();
+            _waker.wake();
         }
 
         bool waitForWake(std::size_t msecs)
@@ -287,9 +287,9 @@ class SelectorImpl : public Selector
                 {
                     continue;
                 }
-                else if( p == &_wakePipe )
+                else if( p == &_waker )
                 {
-                    isWake = _wakePipe.isReady();
+                    isWake = _waker.isReady();
                 }
                 else
                 {
@@ -315,7 +315,7 @@ class SelectorImpl : public Selector
     private:
         SelectableList _selectables;
         Clock _clock;
-        WakePipe _wakePipe;
+        Waker _waker;
         int _kd;
         std::vector<IOHandle*> _changelist;
         static const unsigned EVENTS_SIZE = 32;
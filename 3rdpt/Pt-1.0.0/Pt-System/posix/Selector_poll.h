@@ -53,7 +53,7 @@ class SelectorImpl : public Selector
             _current = 0;
         
             pollfd pfd;
-            pfd.fd = _wakePipe.readFd();
+            pfd.fd = _waker.readFd();
             pfd.events = POLLIN;
             pfd.revents = 0;
             _pollfds.push_back(pfd);
@@ -192,7 +192,7 @@ class SelectorImpl : public Selector
 
         void wake()
         {
-            _wakePipe.wake();
+            _waker.wake();
         }
 
     public:
@@ -233,7 +233,7 @@ class SelectorImpl : public Selector
             if( _pollfds[0].revents & POLLIN )
             {
                 --avail;
-                isWake = _wakePipe.isReady();
+                isWake = _waker.isReady();
             }
 
             try
@@ -268,7 +268,7 @@ class SelectorImpl : public Selector
         }
 
     private:
-        WakePipe _wakePipe;
+        Waker _waker;
         std::vector<pollfd> _pollfds;
         std::vector<IOHandle*> _iohandles;
         SelectableList _selectables;
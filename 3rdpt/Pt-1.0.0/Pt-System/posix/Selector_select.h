@@ -60,7 +60,7 @@ class SelectorImpl : public Selector
             FD_ZERO(&_wfdsOut);
             FD_ZERO(&_efdsOut);
         
-            FD_SET(_wakePipe.readFd(), &_rfds);
+            FD_SET(_waker.readFd(), &_rfds);
         }
 
         ~SelectorImpl()
@@ -160,7 +160,7 @@ class SelectorImpl : public Selector
 
         void wake()
         {
-            _wakePipe.wake();
+            _waker.wake();
         }
 
     public:
@@ -210,10 +210,10 @@ class SelectorImpl : public Selector
                 }
             }
         
-            if( FD_ISSET(_wakePipe.readFd(), &_rfdsOut) )
+            if( FD_ISSET(_waker.readFd(), &_rfdsOut) )
             {
                 --avail;
-                isWake = _wakePipe.isReady();
+                isWake = _waker.isReady();
             }
         
             try
@@ -248,7 +248,7 @@ class SelectorImpl : public Selector
         }
 
     private:
-        WakePipe _wakePipe;
+        Waker _waker;
         SelectableList _selectables;
         SelectableList _devices;
         Selectable* _current;
@@ -0,0 +1,745 @@
+/*
+ * Copyright (C) 2006-2013 Marc Boris Duerner
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PT_SYSTEM_SELECTOR_URING_H
+#define PT_SYSTEM_SELECTOR_URING_H
+
+#include "Selector.h"
+#include "../SelectableList.h"
+#include "Pt/Types.h"
+#include "Pt/System/IOError.h"
+#include "Pt/System/IODevice.h"
+#include "Pt/System/Selectable.h"
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <poll.h>
+#include <unistd.h>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cstring>
+#include <cstdlib>
+#include <errno.h>
+
+namespace Pt {
+
+namespace System {
+
+/** @internal Minimal io_uring submission and completion rings.
+
+    open() fails if the kernel does not support the operations used by
+    the UringSelector.
+*/
+class IoUring
+{
+    public:
+        IoUring()
+        : _fd(-1)
+        , _sqRing(0)
+        , _sqRingSize(0)
+        , _cqRing(0)
+        , _cqRingSize(0)
+        , _sqes(0)
+        , _sqesSize(0)
+        , _pending(0)
+        { }
+
+        ~IoUring()
+        {
+            close();
+        }
+
+        bool isOpen() const
+        { return _fd != -1; }
+
+        bool open(unsigned entries)
+        {
+            io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+
+            _fd = static_cast<int>( ::syscall(__NR_io_uring_setup, entries, &params) );
+            if(_fd < 0)
+            {
+                _fd = -1;
+                return false;
+            }
+
+            const unsigned features = IORING_FEAT_EXT_ARG | IORING_FEAT_RW_CUR_POS | IORING_FEAT_NODROP;
+            if( (params.features & features) != features || ! probe() )
+            {
+                close();
+                return false;
+            }
+
+            _sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            _cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+            const bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if(singleMap)
+            {
+                if(_cqRingSize > _sqRingSize)
+                    _sqRingSize = _cqRingSize;
+
+                _cqRingSize = 0;
+            }
+
+            _sqRing = map(_sqRingSize, IORING_OFF_SQ_RING);
+            _cqRing = singleMap ? _sqRing : map(_cqRingSize, IORING_OFF_CQ_RING);
+
+            _sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+            _sqes = static_cast<io_uring_sqe*>( map(_sqesSize, IORING_OFF_SQES) );
+
+            if( ! _sqRing || ! _cqRing || ! _sqes )
+            {
+                close();
+                return false;
+            }
+
+            char* sq = static_cast<char*>(_sqRing);
+            _sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+            _sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+            _sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+            _sqEntries = params.sq_entries;
+            _sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+            char* cq = static_cast<char*>(_cqRing);
+            _cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+            _cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+            _cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+            _cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+            return true;
+        }
+
+        void close()
+        {
+            if(_sqes)
+                ::munmap(_sqes, _sqesSize);
+
+            if(_cqRing && _cqRing != _sqRing)
+                ::munmap(_cqRing, _cqRingSize);
+
+            if(_sqRing)
+                ::munmap(_sqRing, _sqRingSize);
+
+            if(_fd != -1)
+                ::close(_fd);
+
+            _fd = -1;
+            _sqRing = 0;
+            _cqRing = 0;
+            _sqes = 0;
+            _pending = 0;
+        }
+
+        /** @brief Queues a one-shot poll of @a fd.
+
+            If @a link is true, the next queued entry is started when
+            the poll completes.
+        */
+        void pollAdd(int fd, unsigned events, Pt::uint64_t userData, bool link = false)
+        {
+            io_uring_sqe* sqe = nextSqe();
+            sqe->opcode = IORING_OP_POLL_ADD;
+            sqe->fd = fd;
+            sqe->poll32_events = events;
+            sqe->user_data = userData;
+            if(link)
+                sqe->flags = IOSQE_IO_LINK;
+            push();
+        }
+
+        /** @brief Queues a read, write or accept.
+
+            Reads and writes use the current file position. For accept,
+            @a flags are the flags of accept4, otherwise @a addr and
+            @a len describe the buffer or I/O vector.
+        */
+        void transfer(int opcode, int fd, void* addr, unsigned len, 
+                      unsigned flags, Pt::uint64_t userData)
+        {
+            io_uring_sqe* sqe = nextSqe();
+            sqe->opcode = opcode;
+            sqe->fd = fd;
+            sqe->addr = reinterpret_cast<unsigned long>(addr);
+            sqe->len = len;
+            sqe->off = static_cast<Pt::uint64_t>(-1);
+            sqe->accept_flags = flags;
+            sqe->user_data = userData;
+            push();
+        }
+
+        //! @brief Queues the cancellation of the entry with @a target.
+        void cancel(Pt::uint64_t target, Pt::uint64_t userData)
+        {
+            io_uring_sqe* sqe = nextSqe();
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = -1;
+            sqe->addr = target;
+            sqe->user_data = userData;
+            push();
+        }
+
+        /** @brief Submits queued entries and waits for @a count completions.
+
+            A negative @a msecs waits without timeout. Returns false if
+            the wait timed out or was interrupted.
+        */
+        bool submitAndWait(unsigned count, int msecs)
+        {
+            __kernel_timespec ts;
+            ts.tv_sec = msecs / 1000;
+            ts.tv_nsec = (msecs % 1000) * 1000000L;
+
+            io_uring_getevents_arg arg;
+            std::memset(&arg, 0, sizeof(arg));
+            if(msecs >= 0)
+                arg.ts = reinterpret_cast<Pt::uint64_t>(&ts);
+
+            unsigned toSubmit = _pending;
+            _pending = 0;
+
+            int ret = static_cast<int>( ::syscall(__NR_io_uring_enter, _fd, toSubmit, count,
+                                                  IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                                                  &arg, sizeof(arg)) );
+            if(ret >= 0)
+                return true;
+
+            if(errno == ETIME || errno == EINTR)
+                return false;
+
+            throw IOError( PT_ERROR_MSG("io_uring_enter failed") );
+        }
+
+        //! @brief Returns the next completion or 0.
+        io_uring_cqe* peek()
+        {
+            unsigned head = *_cqHead;
+            if( head == __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE) )
+                return 0;
+
+            return &_cqes[head & _cqMask];
+        }
+
+        //! @brief Consumes the completion returned by peek().
+        void advance()
+        {
+            __atomic_store_n(_cqHead, *_cqHead + 1, __ATOMIC_RELEASE);
+        }
+
+    private:
+        void* map(std::size_t size, off_t offset)
+        {
+            void* p = ::mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, offset);
+            return p == MAP_FAILED ? 0 : p;
+        }
+
+        bool probe()
+        {
+            const unsigned ops = 256;
+            std::size_t size = sizeof(io_uring_probe) + ops * sizeof(io_uring_probe_op);
+            io_uring_probe* probe = static_cast<io_uring_probe*>( std::calloc(1, size) );
+            if( ! probe )
+                return false;
+
+            bool ok = false;
+            if( ::syscall(__NR_io_uring_register, _fd, IORING_REGISTER_PROBE, probe, ops) == 0 )
+            {
+                ok = isSupported(probe, IORING_OP_POLL_ADD) &&
+                     isSupported(probe, IORING_OP_ASYNC_CANCEL) &&
+                     isSupported(probe, IORING_OP_READ) &&
+                     isSupported(probe, IORING_OP_WRITE) &&
+                     isSupported(probe, IORING_OP_READV) &&
+                     isSupported(probe, IORING_OP_WRITEV) &&
+                     isSupported(probe, IORING_OP_ACCEPT);
+            }
+
+            std::free(probe);
+            return ok;
+        }
+
+        static bool isSupported(const io_uring_probe* probe, unsigned op)
+        {
+            return op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+        }
+
+        io_uring_sqe* nextSqe()
+        {
+            unsigned tail = *_sqTail;
+
+            // the ring is full, let the kernel consume what we have
+            if(tail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE) >= _sqEntries)
+            {
+                ::syscall(__NR_io_uring_enter, _fd, _pending, 0, 0, 0, 0);
+                _pending = 0;
+            }
+
+            io_uring_sqe* sqe = &_sqes[tail & _sqMask];
+            std::memset(sqe, 0, sizeof(io_uring_sqe));
+            return sqe;
+        }
+
+        void push()
+        {
+            unsigned tail = *_sqTail;
+            unsigned index = tail & _sqMask;
+
+            _sqArray[index] = index;
+            __atomic_store_n(_sqTail, tail + 1, __ATOMIC_RELEASE);
+            ++_pending;
+        }
+
+    private:
+        int _fd;
+        void* _sqRing;
+        std::size_t _sqRingSize;
+        void* _cqRing;
+        std::size_t _cqRingSize;
+        io_uring_sqe* _sqes;
+        std::size_t _sqesSize;
+        unsigned _pending;
+
+        unsigned* _sqHead;
+        unsigned* _sqTail;
+        unsigned _sqMask;
+        unsigned _sqEntries;
+        unsigned* _sqArray;
+
+        unsigned* _cqHead;
+        unsigned* _cqTail;
+        unsigned _cqMask;
+        io_uring_cqe* _cqes;
+};
+
+/** @internal Completion-based selector on io_uring.
+
+    Reads, writes and accepts, which would block, are submitted as
+    operations to the ring and the devices take their results when the
+    completion arrives, so no readiness check and second system call is
+    needed per transfer. Since the devices are non-blocking, each
+    operation is linked to a one-shot poll of its fd. Selectables which
+    only wait for readiness use the one-shot poll alone.
+
+    Ending or cancelling a pending operation cancels it synchronously,
+    because the kernel may still write to the buffer or the handle
+    until the completion was reaped.
+*/
+class UringSelector : public Selector
+{
+    public:
+        UringSelector()
+        : _wakeArmed(false)
+        , _isWake(false)
+        { }
+
+        ~UringSelector()
+        {
+            while( ! _selectables.empty() )
+            {
+                _selectables.first()->detach();
+            }
+        }
+
+        //! @brief Opens the ring, returns false if io_uring is not supported.
+        bool open()
+        {
+            return _ring.open(RingSize);
+        }
+
+        void attach(Selectable& s)
+        {
+            _selectables.insert(s);
+        }
+        
+        void detach(Selectable& s)
+        {
+            SelectableList::unlink(s);
+        }
+
+        void cancel(IOHandle& h)
+        {
+            if(h.fd < 0)
+                return;
+
+            h.events = 0;
+            cancelPending(&h);
+
+            // an accepted connection, which was never taken
+            if( (h.completed & IOHandle::Read) && h.readOp.code == IORING_OP_ACCEPT && h.readOp.result >= 0 )
+                ::close( static_cast<int>(h.readOp.result) );
+
+            std::vector<IOHandle*>::iterator it = std::remove(_avail.begin(), _avail.end(), &h);
+            _avail.erase(it, _avail.end());
+
+            h.id = IOHandle::InvalidId;
+            h.changed = 0;
+            h.ready = 0;
+            h.completed = 0;
+            h.queued = false;
+        }
+
+        void beginRead(IOHandle* h)
+        {
+            beginPoll(h, IOHandle::Read);
+        }
+
+        void endRead(IOHandle* h)
+        {
+            endOperation(h, IOHandle::Read);
+        }
+
+        void beginWrite(IOHandle* h)
+        {
+            beginPoll(h, IOHandle::Write);
+        }
+
+        void endWrite(IOHandle* h)
+        {
+            endOperation(h, IOHandle::Write);
+        }
+
+        bool isReadable(IOHandle* h)
+        {
+            return h->ready & IOHandle::Read;
+        }
+
+        bool isWritable(IOHandle* h)
+        {
+            return h->ready & IOHandle::Write;
+        }
+
+        bool isError(IOHandle* h)
+        {
+            return h->ready & IOHandle::Error;
+        }
+
+        bool submitRead(IOHandle* h, char* buffer, size_t n)
+        {
+            return submit(h, IOHandle::Read, IORING_OP_READ, buffer, n);
+        }
+
+        bool submitReadv(IOHandle* h, IOVec* vec, size_t count)
+        {
+            // IOVec has the layout of struct iovec
+            return submit(h, IOHandle::Read, IORING_OP_READV, vec, std::min(count, size_t(MaxIOVec)));
+        }
+
+        bool submitWrite(IOHandle* h, const char* buffer, size_t n)
+        {
+            return submit(h, IOHandle::Write, IORING_OP_WRITE, const_cast<char*>(buffer), n);
+        }
+
+        bool submitWritev(IOHandle* h, const IOVec* vec, size_t count)
+        {
+            return submit(h, IOHandle::Write, IORING_OP_WRITEV, const_cast<IOVec*>(vec), std::min(count, size_t(MaxIOVec)));
+        }
+
+        bool submitAccept(IOHandle* h)
+        {
+            return submit(h, IOHandle::Read, IORING_OP_ACCEPT, 0, 0);
+        }
+
+        void wake()
+        {
+            _waker.wake();
+        }
+
+        bool waitForWake(size_t umsecs)
+        {
+            // process completions which are left over from the last 
+            // iteration because of an exception
+            if( ! _avail.empty() )
+            {
+                processAvail();
+                return takeWake();
+            }
+
+            if( ! _wakeArmed )
+            {
+                _ring.pollAdd(_waker.readFd(), POLLIN, WakeData);
+                _wakeArmed = true;
+            }
+
+            int msecs = -1;
+            if(umsecs != EventLoop::WaitInfinite)
+            {
+                const size_t maxMSecs = std::numeric_limits<int>::max();
+                msecs = umsecs > maxMSecs ? maxMSecs : static_cast<int>(umsecs);
+            }
+
+            _ring.submitAndWait(msecs == 0 ? 0 : 1, msecs);
+            
+            reap();
+            processAvail();
+            return takeWake();
+        }
+
+    private:
+        // kinds of entries, stored in the low bits of the user data
+        enum Kind
+        {
+            ReadPoll = 0,
+            WritePoll = 1,
+            ReadOp = 2,
+            WriteOp = 3
+        };
+
+        static const Pt::uint64_t KindMask = 3;
+        static const Pt::uint64_t WakeData = 1;
+        static const unsigned RingSize = 256;
+        static const size_t MaxIOVec = 64;
+
+        static Pt::uint64_t userData(IOHandle* h, int kind)
+        {
+            return reinterpret_cast<Pt::uint64_t>(h) | kind;
+        }
+
+        static IOOperation& operation(IOHandle* h, short op)
+        {
+            return op == IOHandle::Read ? h->readOp : h->writeOp;
+        }
+
+        void beginPoll(IOHandle* h, short op)
+        {
+            h->id = 1;
+            h->events |= op;
+            h->ready &= ~op;
+
+            const int kind = (op == IOHandle::Read) ? ReadPoll : WritePoll;
+            if( h->pending & (1 << kind) )
+                return;
+
+            IOOperation& io = operation(h, op);
+            io.code = IORING_OP_POLL_ADD;
+
+            _ring.pollAdd(h->fd, op == IOHandle::Read ? POLLIN : POLLOUT, userData(h, kind));
+            h->pending |= (1 << kind);
+        }
+
+        bool submit(IOHandle* h, short op, int code, void* addr, size_t len)
+        {
+            h->id = 1;
+            h->events |= op;
+            h->ready &= ~op;
+            h->completed &= ~op;
+
+            IOOperation& io = operation(h, op);
+            io.code = code;
+            io.addr = addr;
+            io.len = len;
+            io.result = 0;
+
+            link(h, op);
+            return true;
+        }
+
+        // the fd is non-blocking, so the operation is started when the
+        // fd becomes ready
+        void link(IOHandle* h, short op)
+        {
+            const bool isRead = (op == IOHandle::Read);
+            const int pollKind = isRead ? ReadPoll : WritePoll;
+            const int opKind = isRead ? ReadOp : WriteOp;
+
+            IOOperation& io = operation(h, op);
+            const unsigned len = static_cast<unsigned>( std::min<size_t>(io.len, std::numeric_limits<int>::max()) );
+            const unsigned flags = (io.code == IORING_OP_ACCEPT) ? (SOCK_NONBLOCK | SOCK_CLOEXEC) : 0;
+
+            _ring.pollAdd(h->fd, isRead ? POLLIN : POLLOUT, userData(h, pollKind), true);
+            _ring.transfer(io.code, h->fd, io.addr, len, flags, userData(h, opKind));
+            h->pending |= (1 << pollKind) | (1 << opKind);
+        }
+
+        void endOperation(IOHandle* h, short op)
+        {
+            h->events &= ~op;
+
+            const short mask = (op == IOHandle::Read) ? ((1 << ReadPoll) | (1 << ReadOp))
+                                                       : ((1 << WritePoll) | (1 << WriteOp));
+            if(h->pending & mask)
+                cancelPending(h);
+
+            if( ! (h->completed & op) )
+                h->ready &= ~op;
+
+            h->ready &= ~IOHandle::Error;
+        }
+
+        void cancelPending(IOHandle* h)
+        {
+            // only entries of operations which were ended are cancelled
+            short mask = 0;
+            if( ! (h->events & IOHandle::Read) )
+                mask |= (1 << ReadPoll) | (1 << ReadOp);
+            if( ! (h->events & IOHandle::Write) )
+                mask |= (1 << WritePoll) | (1 << WriteOp);
+
+            while(h->pending & mask)
+            {
+                for(int kind = ReadPoll; kind <= WriteOp; ++kind)
+                {
+                    if(h->pending & mask & (1 << kind))
+                        _ring.cancel(userData(h, kind), 0);
+                }
+
+                // an operation, which was already started, might not
+                // be found and completes shortly
+                _ring.submitAndWait(1, 10);
+                reap();
+            }
+        }
+
+        void reap()
+        {
+            while( io_uring_cqe* cqe = _ring.peek() )
+            {
+                const Pt::uint64_t data = cqe->user_data;
+                const int res = cqe->res;
+                _ring.advance();
+
+                if(data == 0)
+                    continue;
+
+                if(data == WakeData)
+                {
+                    _wakeArmed = false;
+                    _isWake = _waker.isReady() || _isWake;
+                    continue;
+                }
+
+                IOHandle* h = reinterpret_cast<IOHandle*>(data & ~KindMask);
+                const int kind = static_cast<int>(data & KindMask);
+                h->pending &= ~(1 << kind);
+
+                switch(kind)
+                {
+                    case ReadPoll:
+                    case WritePoll:
+                        onPoll(h, kind == ReadPoll ? IOHandle::Read : IOHandle::Write, res);
+                        break;
+
+                    case ReadOp:
+                        onComplete(h, IOHandle::Read, res);
+                        break;
+
+                    case WriteOp:
+                        onComplete(h, IOHandle::Write, res);
+                        break;
+                }
+            }
+        }
+
+        void onPoll(IOHandle* h, short op, int res)
+        {
+            // the head of a linked operation
+            if(operation(h, op).code != IORING_OP_POLL_ADD)
+                return;
+
+            if( res < 0 || ! (h->events & op) )
+                return;
+
+            if(res & (POLLIN | POLLHUP))
+                h->ready |= IOHandle::Read;
+            if(res & (POLLOUT | POLLHUP))
+                h->ready |= IOHandle::Write;
+            if(res & POLLERR)
+                h->ready |= IOHandle::Error;
+
+            queue(h);
+        }
+
+        void onComplete(IOHandle* h, short op, int res)
+        {
+            const bool isEnded = ! (h->events & op);
+
+            if(res == -EAGAIN || res == -EINTR)
+            {
+                if( ! isEnded )
+                    link(h, op);
+
+                return;
+            }
+
+            if(res == -ECANCELED && isEnded)
+                return;
+
+            // the result is kept, even if the operation was cancelled
+            // too late, the data was transferred
+            operation(h, op).result = res;
+            h->completed |= op;
+            h->ready |= op;
+
+            if( ! isEnded )
+                queue(h);
+        }
+
+        void queue(IOHandle* h)
+        {
+            if(h->queued)
+                return;
+
+            h->queued = true;
+            _avail.push_back(h);
+        }
+
+        void processAvail()
+        {
+            while( ! _avail.empty() )
+            {
+                IOHandle* h = _avail.back();
+                _avail.pop_back();
+                h->queued = false;
+
+                h->sel->run();
+            }
+        }
+
+        bool takeWake()
+        {
+            bool isWake = _isWake;
+            _isWake = false;
+            return isWake;
+        }
+
+    private:
+        IoUring _ring;
+        SelectableList _selectables;
+        Waker _waker;
+        bool _wakeArmed;
+        bool _isWake;
+        std::vector<IOHandle*> _avail;
+};
+
+} //namespace System
+
+} //namespace Pt
+
+#endif
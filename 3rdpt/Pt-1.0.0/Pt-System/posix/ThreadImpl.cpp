@@ -98,6 +98,20 @@ void ThreadImpl::detach()
 }
 
 
+bool ThreadImpl::setAffinity(std::size_t cpu)
+{
+#if defined(__linux__)
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu % CPU_SETSIZE, &cpus);
+
+    return pthread_setaffinity_np(_id, sizeof(cpus), &cpus) == 0;
+#else
+    return false;
+#endif
+}
+
+
 void ThreadImpl::join()
 {
     void* threadRet = 0;
@@ -54,6 +54,8 @@ class ThreadImpl
 
         void join();
 
+        bool setAffinity(std::size_t cpu);
+
         static void exit()
         {
             ::pthread_exit( NULL );
@@ -69,6 +71,12 @@ class ThreadImpl
             usleep(ms * 1000);
         }
 
+        static std::size_t processorCount()
+        {
+            long n = ::sysconf(_SC_NPROCESSORS_ONLN);
+            return n > 0 ? static_cast<std::size_t>(n) : 1;
+        }
+
         const Callable<void>* cb()
         { return _cb; }
 
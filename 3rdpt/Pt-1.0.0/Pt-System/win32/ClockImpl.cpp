@@ -26,6 +26,7 @@
 #include "ClockImpl.h"
 #include "Pt/SourceInfo.h"
 #include "Pt/System/SystemError.h"
+#include "Pt/System/Clock.h"
 #include <stdexcept>
 #include <time.h>
 
@@ -152,6 +153,29 @@ Timespan ClockImpl::getSystemTicks()
     //return Timespan( Pt::int64_t(1000) * GetTickCount() );
 }
 
+
+Pt::int64_t ClockImpl::getMonotonicTime()
+{
+    static LARGE_INTEGER frequency = { 0 };
+    if(frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+
+    // split to avoid an overflow of the multiplication
+    const Pt::int64_t secs = counter.QuadPart / frequency.QuadPart;
+    const Pt::int64_t rest = counter.QuadPart % frequency.QuadPart;
+    return secs * 1000000000 + (rest * 1000000000) / frequency.QuadPart;
+}
+
+
+bool ClockImpl::setMonotonicSource(int source)
+{
+    // the performance counter already uses the invariant TSC, if available
+    return source == Clock::Monotonic;
+}
+
 } // namespace Pt
 
 } // namespace System
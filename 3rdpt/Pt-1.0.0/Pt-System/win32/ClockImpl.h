@@ -28,6 +28,10 @@ class ClockImpl
 
         static Timespan getSystemTicks();
 
+        static Pt::int64_t getMonotonicTime();
+
+        static bool setMonotonicSource(int source);
+
     private:
         LARGE_INTEGER   _frequency;
         LARGE_INTEGER   _startValue;
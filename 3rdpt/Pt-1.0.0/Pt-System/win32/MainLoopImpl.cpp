@@ -27,17 +27,31 @@
  */
 #include "MainLoopImpl.h"
 
+namespace {
+
+Pt::System::TimerQueue* createTimerQueue(const Pt::System::MainLoopOptions& opts)
+{
+    if( opts.useTimerWheel() )
+        return new Pt::System::TimerWheel();
+
+    return new Pt::System::SortedTimerQueue();
+}
+
+}
+
 namespace Pt {
 
 namespace System {
 
-MainLoopImpl::MainLoopImpl(Signal<const Pt::Event&>& eventSignal)
-: _event(&eventSignal)
+MainLoopImpl::MainLoopImpl(Signal<const Pt::Event&>& eventSignal, const MainLoopOptions& opts)
+: _timerQueue( createTimerQueue(opts) )
+, _event(&eventSignal)
 {
 }
 
-MainLoopImpl::MainLoopImpl(Signal<const Pt::Event&>& eventSignal, Allocator& a)
-: _eventQueue(a)
+MainLoopImpl::MainLoopImpl(Signal<const Pt::Event&>& eventSignal, Allocator& a, const MainLoopOptions& opts)
+: _timerQueue( createTimerQueue(opts) )
+, _eventQueue(a)
 , _event(&eventSignal)
 {
 }
@@ -45,6 +59,7 @@ MainLoopImpl::MainLoopImpl(Signal<const Pt::Event&>& eventSignal, Allocator& a)
 
 MainLoopImpl::~MainLoopImpl()
 {
+    delete _timerQueue;
 }
 
 
@@ -99,7 +114,8 @@ void MainLoopImpl::queueEvent(const Event& event)
 
 bool MainLoopImpl::waitNext()
 {
-    std::size_t timeout = _timerQueue.processTimers();
+    _loopTime = Clock::getMonotonicTicks();
+    std::size_t timeout = _timerQueue->processTimers(_loopTime);
 
     // check all selectables that did not require waiting
     while( true )
@@ -117,6 +133,9 @@ bool MainLoopImpl::waitNext()
         s->run();
     }
 
+    // the loop time is read again, when it is requested after waiting
+    _loopTime.setNull();
+
     bool isActive = true;
     if( _selector.waitForWake(timeout) )
         isActive = _eventQueue.processEvents(*_event);
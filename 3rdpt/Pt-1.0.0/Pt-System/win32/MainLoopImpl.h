@@ -24,6 +24,8 @@
 #include "Selector.h"
 #include "Pt/WinVer.h"
 #include "Pt/System/Api.h"
+#include "Pt/System/MainLoop.h"
+#include "Pt/System/Clock.h"
 
 namespace Pt {
 
@@ -32,9 +34,9 @@ namespace System {
 class PT_SYSTEM_API MainLoopImpl
 {
     public:
-        MainLoopImpl(Signal<const Pt::Event&>& eventSignal);
+        MainLoopImpl(Signal<const Pt::Event&>& eventSignal, const MainLoopOptions& opts);
 
-        MainLoopImpl(Signal<const Pt::Event&>& eventSignal, Allocator& a);
+        MainLoopImpl(Signal<const Pt::Event&>& eventSignal, Allocator& a, const MainLoopOptions& opts);
 
         ~MainLoopImpl();
 
@@ -55,10 +57,10 @@ class PT_SYSTEM_API MainLoopImpl
         bool processEvents();
 
         void attach(Timer& timer)
-        { _timerQueue.addTimer(timer); }
+        { _timerQueue->addTimer(timer); }
 
         void detach(Timer& timer)
-        { _timerQueue.removeTimer(timer); }
+        { _timerQueue->removeTimer(timer); }
 
         void attach(Selectable& s)
         { _selector.attach(s); }
@@ -72,13 +74,22 @@ class PT_SYSTEM_API MainLoopImpl
 
         bool waitNext();
 
+        const Timespan& loopTime() const
+        {
+            if( _loopTime.isNull() )
+                _loopTime = Clock::getMonotonicTicks();
+
+            return _loopTime;
+        }
+
     private:
         Mutex _mutex;
-        TimerQueue _timerQueue;
+        TimerQueue* _timerQueue;
         EventQueue _eventQueue;
         Signal<const Event&>* _event;
         std::vector<Selectable*> _avail;
         Selector _selector;
+        mutable Timespan _loopTime;
 };
 
 }//namespace System
@@ -78,6 +78,15 @@ void ThreadImpl::join()
 }
 
 
+bool ThreadImpl::setAffinity(std::size_t cpu)
+{
+    const std::size_t bits = sizeof(DWORD_PTR) * 8;
+    DWORD_PTR mask = DWORD_PTR(1) << (cpu % bits);
+
+    return ::SetThreadAffinityMask(_handle, mask) != 0;
+}
+
+
 void ThreadImpl::exit()
 {
     DWORD status = 0;
@@ -99,6 +108,14 @@ void ThreadImpl::sleep(unsigned int ms)
 #endif
 }
 
+
+std::size_t ThreadImpl::processorCount()
+{
+    SYSTEM_INFO info;
+    ::GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? info.dwNumberOfProcessors : 1;
+}
+
 } // namespace System
 
 } // namespace Pt
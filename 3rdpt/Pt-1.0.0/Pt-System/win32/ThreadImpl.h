@@ -70,6 +70,8 @@ namespace System {
 
             void join();
 
+            bool setAffinity(std::size_t cpu);
+
             static void exit();
 
             static void yield()
@@ -77,6 +79,8 @@ namespace System {
 
             static void sleep(unsigned int ms);
 
+            static std::size_t processorCount();
+
             const Callable<void>* cb()
             { return _cb; }
 
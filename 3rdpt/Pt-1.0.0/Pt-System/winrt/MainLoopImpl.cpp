@@ -29,18 +29,32 @@
 #include "MainLoopImpl.h"
 #include <windows.h>
 
+namespace {
+
+Pt::System::TimerQueue* createTimerQueue(const Pt::System::MainLoopOptions& opts)
+{
+    if( opts.useTimerWheel() )
+        return new Pt::System::TimerWheel();
+
+    return new Pt::System::SortedTimerQueue();
+}
+
+}
+
 namespace Pt {
 
 namespace System {
 
-MainLoopImpl::MainLoopImpl(Signal<const Pt::Event&>& eventSignal)
-: _event(&eventSignal)
+MainLoopImpl::MainLoopImpl(Signal<const Pt::Event&>& eventSignal, const MainLoopOptions& opts)
+: _timerQueue( createTimerQueue(opts) )
+, _event(&eventSignal)
 {
 }
 
 
-MainLoopImpl::MainLoopImpl(Signal<const Pt::Event&>& eventSignal, Allocator& a)
-: _eventQueue(a)
+MainLoopImpl::MainLoopImpl(Signal<const Pt::Event&>& eventSignal, Allocator& a, const MainLoopOptions& opts)
+: _timerQueue( createTimerQueue(opts) )
+, _eventQueue(a)
 , _event(&eventSignal)
 {
 }
@@ -48,18 +62,19 @@ MainLoopImpl::MainLoopImpl(Signal<const Pt::Event&>& eventSignal, Allocator& a)
 
 MainLoopImpl::~MainLoopImpl()
 {
+    delete _timerQueue;
 }
 
 
 void MainLoopImpl::attach(Timer& timer)
 { 
-    _timerQueue.addTimer(timer); 
+    _timerQueue->addTimer(timer); 
 }
 
 
 void MainLoopImpl::detach(Timer& timer)
 { 
-    _timerQueue.removeTimer(timer); 
+    _timerQueue->removeTimer(timer); 
 }
 
 
@@ -140,7 +155,8 @@ bool MainLoopImpl::processEvents()
 // TODO: rename runNext, wait for next activity and run it
 bool MainLoopImpl::waitNext()
 {
-    std::size_t timeout = _timerQueue.processTimers();
+    _loopTime = Clock::getMonotonicTicks();
+    std::size_t timeout = _timerQueue->processTimers(_loopTime);
 
     // check all selectables that did not require waiting, but
     // for fairness reasons check only as many selectables as
@@ -171,6 +187,9 @@ bool MainLoopImpl::waitNext()
             break;
     }
 
+    // the loop time is read again, when it is requested after waiting
+    _loopTime.setNull();
+
     bool isActive = true;
     if( _selector.waitForWake(timeout) )
         isActive = _eventQueue.processEvents(*_event);
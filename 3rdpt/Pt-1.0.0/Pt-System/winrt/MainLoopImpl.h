@@ -31,6 +31,8 @@
 
 #include "Selector.h"
 #include "Pt/System/Api.h"
+#include "Pt/System/MainLoop.h"
+#include "Pt/System/Clock.h"
 
 namespace Pt {
 
@@ -39,9 +41,9 @@ namespace System {
 class PT_SYSTEM_API MainLoopImpl
 {
     public:
-        MainLoopImpl(Signal<const Pt::Event&>& eventSignal);
+        MainLoopImpl(Signal<const Pt::Event&>& eventSignal, const MainLoopOptions& opts);
 
-        MainLoopImpl(Signal<const Pt::Event&>& eventSignal, Allocator& a);
+        MainLoopImpl(Signal<const Pt::Event&>& eventSignal, Allocator& a, const MainLoopOptions& opts);
 
         ~MainLoopImpl();
 
@@ -74,13 +76,22 @@ class PT_SYSTEM_API MainLoopImpl
 
         bool waitNext();
 
+        const Timespan& loopTime() const
+        {
+            if( _loopTime.isNull() )
+                _loopTime = Clock::getMonotonicTicks();
+
+            return _loopTime;
+        }
+
     private:
         Mutex _mutex;
-        TimerQueue _timerQueue;
+        TimerQueue* _timerQueue;
         EventQueue _eventQueue;
         Signal<const Event&>* _event;
         std::vector<Selectable*> _avail;
         Selector _selector;
+        mutable Timespan _loopTime;
 };
 
 }//namespace System
@@ -99,6 +99,13 @@ void ThreadImpl::sleep(unsigned int ms)
     std::this_thread::sleep_for(msecs);
 }
 
+
+std::size_t ThreadImpl::processorCount()
+{
+    unsigned n = std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
 } // namespace System
 
 } // namespace Pt
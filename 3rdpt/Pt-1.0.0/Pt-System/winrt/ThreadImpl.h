@@ -64,12 +64,17 @@ class ThreadImpl
 
         void join();
 
+        bool setAffinity(std::size_t cpu)
+        { return false; }
+
         static void exit();
 
         static void yield();
 
         static void sleep(unsigned int ms);
 
+        static std::size_t processorCount();
+
     private:
         const Callable<void>* _cb;
         std::thread* _thread;
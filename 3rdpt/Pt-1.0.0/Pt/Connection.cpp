@@ -60,7 +60,9 @@ Connection::Connection(const Connection& connection)
 : _data(0)
 {
     _data = connection._data;
-    _data->ref();
+
+    if(_data)
+        _data->ref();
 }
 
 
@@ -76,6 +78,9 @@ Connection::~Connection()
 
 Connection& Connection::operator=(const Connection& connection)
 {
+    if(connection._data)
+        connection._data->ref();
+
     if( _data && 0 == _data->unref() ) 
     {
         this->close();
@@ -83,7 +88,6 @@ Connection& Connection::operator=(const Connection& connection)
     }
 
     _data = connection._data;
-    _data->ref();
     return *this;
 }
 
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include <Pt/Event.h>
+#include <Pt/Atomicity.h>
+#include <map>
+
+#if defined(_WIN32) || defined(WIN32) || defined(_WIN32_WCE)
+    #include <windows.h>
+#else
+    #include <sched.h>
+#endif
+
+namespace {
+
+struct CompareTypeInfo
+{
+    bool operator()(const std::type_info* t1, const std::type_info* t2) const
+    { return t1->before(*t2) != 0; }
+};
+
+typedef std::map<const std::type_info*, std::size_t, CompareTypeInfo> TypeMap;
+
+TypeMap& typeMap()
+{
+    static TypeMap types;
+    return types;
+}
+
+Pt::atomic_t typeLock(0);
+
+inline void cpuRelax()
+{
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+    __asm__ __volatile__("pause");
+#elif defined(__GNUC__) && (defined(__aarch64__) || defined(__ARM_ARCH_7A__))
+    __asm__ __volatile__("yield");
+#elif defined(_MSC_VER)
+    YieldProcessor();
+#endif
+}
+
+inline void yieldThread()
+{
+#if defined(_WIN32) || defined(WIN32) || defined(_WIN32_WCE)
+    ::SwitchToThread();
+#else
+    ::sched_yield();
+#endif
+}
+
+// the type registry is only accessed, when an event type is registered
+// or when events without a type index are dispatched. The lock is held
+// only for a map lookup, so waiters spin briefly and then give up their
+// time slice, in case the holder was preempted
+class TypeLock
+{
+    public:
+        TypeLock()
+        {
+            unsigned spins = 0;
+            while( Pt::atomicGet(typeLock) != 0 || 
+                   Pt::atomicCompareExchange(typeLock, 1, 0) != 0 )
+            {
+                if(++spins < 64)
+                    cpuRelax();
+                else
+                    yieldThread();
+            }
+        }
+
+        ~TypeLock()
+        { Pt::atomicExchange(typeLock, 0); }
+};
+
+}
+
+namespace Pt {
+
+std::size_t Event::registerType(const std::type_info& ti)
+{
+    TypeLock lock;
+    TypeMap& types = typeMap();
+
+    TypeMap::iterator it = types.find(&ti);
+    if( it != types.end() )
+        return it->second;
+
+    // index 0 is reserved for unregistered types
+    std::size_t idx = types.size() + 1;
+    types.insert( TypeMap::value_type(&ti, idx) );
+    return idx;
+}
+
+
+std::size_t Event::findType(const std::type_info& ti)
+{
+    TypeLock lock;
+    TypeMap& types = typeMap();
+
+    TypeMap::const_iterator it = types.find(&ti);
+    return it != types.end() ? it->second : 0;
+}
+
+} // namespace Pt
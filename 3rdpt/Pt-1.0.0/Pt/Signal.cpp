@@ -30,81 +30,65 @@
 
 namespace Pt {
 
-SignalBase::Sentry::Sentry(SignalBase* signal)
-: _signal(signal)
-{
-    _signal->_sentry = this;
-    _signal->_sending = true;
-    _signal->_dirty = false;
-}
+SignalBase::SignalBase()
+: _slots(&_localSlot)
+, _slotCount(0)
+, _slotCapacity(1)
+, _sentry(0)
+, _sending(0)
+, _dirty(false)
+{ }
 
 
-SignalBase::Sentry::~Sentry()
+SignalBase::SignalBase(const SignalBase& other)
+: Connectable()
+, _slots(&_localSlot)
+, _slotCount(0)
+, _slotCapacity(1)
+, _sentry(0)
+, _sending(0)
+, _dirty(false)
 {
-    if( _signal )
-        this->detach();
+    SignalBase::operator=(other);
 }
 
 
-void SignalBase::Sentry::detach()
+SignalBase::~SignalBase()
 {
-    _signal->_sending = false;
-
-    if( _signal->_dirty == false )
+    while(_sentry)
     {
-        _signal->_sentry = 0;
-        _signal = 0;
-        return;
+        _sentry->detach();
     }
 
-    std::list<Connection>::iterator it = _signal->connections().begin();
-    while( it != _signal->connections().end() )
+    // close the connections to the slots, the slot table is emptied
+    // from the back, so the closing connection is not found again
+    while(_slotCount > 0)
     {
-        if( it->isValid() )
-        {
-            ++it;
-        }
-        else
-        {
-            it = _signal->connections().erase(it);
-        }
-    }
-
-    _signal->_dirty = false;
-    _signal->_sentry = 0;
-    _signal = 0;
-}
-
+        SlotEntry& entry = _slots[--_slotCount];
+        Connection connection = entry.connection;
+        entry.connection = Connection();
+        entry.callable = 0;
 
-SignalBase::SignalBase()
-: _sentry(0)
-, _sending(false)
-, _dirty(false)
-{ }
-
-
-SignalBase::~SignalBase()
-{
-    if(_sentry)
-    {
-        _sentry->detach();
+        connection.close();
     }
+
+    if(_slots != &_localSlot)
+        delete [] _slots;
 }
 
 
 SignalBase& SignalBase::operator=(const SignalBase& other)
 {
-    this->disconnectAll();
+    this->disconnectSlots();
 
-    std::list<Connection>::const_iterator it = other.connections().begin();
-    std::list<Connection>::const_iterator end = other.connections().end();
-
-    for( ; it != end; ++it)
+    // the slot table might grow while slots are cloned
+    const std::size_t count = other._slotCount;
+    for(std::size_t n = 0; n < count; ++n)
     {
-        const Connectable* signal = it->sender();
-        if( signal == &other)
+        const SlotEntry& entry = other._slots[n];
+        if( entry.callable )
         {
-            const Slot* slot = it->slot();
+            const Slot* slot = entry.connection.slot();
             Connection connection( *this, slot->clone()  );
         }
     }
@@ -115,19 +99,22 @@ SignalBase& SignalBase::operator=(const SignalBase& other)
 
 void SignalBase::onConnectionOpen(const Connection& c)
 {
-    Connectable::onConnectionOpen(c);
+    if( c.sender() == this )
+    {
+        this->addSlot(c);
+    }
+    else
+    {
+        Connectable::onConnectionOpen(c);
+    }
 }
 
 
 void SignalBase::onConnectionClose(const Connection& c)
 {
-    // if the signal is currently calling its slots, do not
-    // remove the connection now, but only set the cleanup flag
-    // Any invalid connection objects will be removed after
-    // the signal has finished calling its slots by the Sentry.
-    if( _sending )
+    if( c.sender() == this )
     {
-        _dirty = true;
+        this->removeSlot(c);
     }
     else
     {
@@ -138,173 +125,249 @@ void SignalBase::onConnectionClose(const Connection& c)
 
 void SignalBase::disconnectSlots()
 {
-    std::list<Connection>::iterator it = connections().begin();
-    while( it != connections().end() )
+    std::size_t n = 0;
+    while( n < _slotCount )
     {
-        if( ! it->isValid() || it->sender() != this ) 
+        // closing the connection might remove the entry from the table
+        // if the signal is not sending
+        SlotEntry& entry = _slots[n];
+        if( ! entry.callable )
         {
+            ++n;
             continue;
         }
 
-        Connection connection = *it;
-        ++it;
+        Connection connection = entry.connection;
         connection.close();
+
+        if( _sending )
+            ++n;
     }
 }
 
 
 void SignalBase::disconnectSlot(const Slot& slot)
 {
-    std::list<Connection>::iterator it = Connectable::connections().begin();
-    std::list<Connection>::iterator end = Connectable::connections().end();
-
-    for(; it != end; ++it)
+    for(std::size_t n = 0; n < _slotCount; ++n)
     {
-        if( it->slot()->equals(slot) )
+        SlotEntry& entry = _slots[n];
+        if( entry.callable && entry.connection.slot()->equals(slot) )
         {
-            it->close();
+            Connection connection = entry.connection;
+            connection.close();
             return;
         }
     }
 }
 
 
-bool CompareEventTypeInfo::operator()(const std::type_info* t1,
-                                      const std::type_info* t2) const
+void SignalBase::addSlot(const Connection& c)
 {
-    if(t2 == 0)
-        return false;
+    if(_slotCount == _slotCapacity)
+    {
+        std::size_t capacity = _slotCapacity * 2;
+        SlotEntry* slots = new SlotEntry[capacity];
 
-    if(t1 == 0)
-        return true;
+        for(std::size_t n = 0; n < _slotCount; ++n)
+        {
+            slots[n].callable = _slots[n].callable;
+            slots[n].connection = _slots[n].connection;
+        }
 
-    return t1->before(*t2) != 0;
-}
+        if(_slots != &_localSlot)
+        {
+            delete [] _slots;
+        }
+        else
+        {
+            _localSlot.callable = 0;
+            _localSlot.connection = Connection();
+        }
 
+        _slots = slots;
+        _slotCapacity = capacity;
+    }
 
-Signal<const Pt::Event&>::Sentry::Sentry(Signal* signal)
-: _signal(signal)
-{
-    _signal->_sentry = this;
-    _signal->_sending = true;
-    _signal->_dirty = false;
+    SlotEntry& entry = _slots[_slotCount];
+    entry.callable = c.slot()->callable();
+    entry.connection = c;
+    ++_slotCount;
 }
 
 
-Signal<const Pt::Event&>::Sentry::~Sentry()
+void SignalBase::removeSlot(const Connection& c)
 {
-    if( _signal )
-        this->detach();
+    for(std::size_t n = 0; n < _slotCount; ++n)
+    {
+        if( _slots[n].connection == c )
+        {
+            // if the signal is currently calling its slots, do not
+            // remove the entry now, but only set the cleanup flag.
+            // Invalid entries will be removed by the Sentry after
+            // the signal has finished calling its slots.
+            _slots[n].callable = 0;
+
+            if( _sending )
+            {
+                _dirty = true;
+                return;
+            }
+
+            for(++n; n < _slotCount; ++n)
+            {
+                _slots[n - 1].callable = _slots[n].callable;
+                _slots[n - 1].connection = _slots[n].connection;
+            }
+
+            --_slotCount;
+            _slots[_slotCount].callable = 0;
+            _slots[_slotCount].connection = Connection();
+            return;
+        }
+    }
 }
 
 
-void Signal<const Pt::Event&>::Sentry::detach()
+void SignalBase::compactSlots()
 {
-    _signal->_sending = false;
+    _dirty = false;
 
-    if( _signal->_dirty == false )
+    std::size_t count = 0;
+    for(std::size_t n = 0; n < _slotCount; ++n)
     {
-        _signal->_sentry = 0;
-        _signal = 0;
-        return;
-    }
+        if( ! _slots[n].callable )
+            continue;
 
-    Signal::RouteMap::iterator it = _signal->_routes.begin();
-    while( it != _signal->_routes.end() )
-    {
-        if( it->second->isValid() )
+        if(count != n)
         {
-            ++it;
-        }
-        else
-        {
-            delete it->second;
-            _signal->_routes.erase(it++);
+            _slots[count].callable = _slots[n].callable;
+            _slots[count].connection = _slots[n].connection;
         }
+
+        ++count;
+    }
+
+    // releasing the connections might close the last reference to
+    // a slot, so the table must be consistent before
+    std::size_t end = _slotCount;
+    _slotCount = count;
+
+    for(std::size_t n = count; n < end; ++n)
+    {
+        _slots[n].callable = 0;
+        _slots[n].connection = Connection();
     }
+}
+
 
-    _signal->_dirty = false;
-    _signal->_sentry = 0;
-    _signal = 0;
+bool CompareEventTypeInfo::operator()(const std::type_info* t1,
+                                      const std::type_info* t2) const
+{
+    if(t2 == 0)
+        return false;
+
+    if(t1 == 0)
+        return true;
+
+    return t1->before(*t2) != 0;
 }
 
 
 Signal<const Pt::Event&>::Signal()
-: _sentry(0)
-, _sending(false)
+: _routeCount(0)
+, _sentry(0)
+, _sending(0)
 , _dirty(false)
 {}
 
 
 Signal<const Pt::Event&>::~Signal()
 {
-    if(_sentry)
+    while(_sentry)
         _sentry->detach();
 
-    while( ! _routes.empty() )
-    {
-        IEventRoute* route = _routes.begin()->second;
-        route->connection().close();
-    }
+    this->disconnect();
 }
 
 
 void Signal<const Pt::Event&>::send(const Pt::Event& ev)
 {
-    if( _routes.empty() )
+    if( _routeCount == 0 )
         return;
 
     // The sentry will set the Signal to the sending state and reset it to not-sending upon destruction.
-    // In the sending state, removing connection will leave invalid connections in the connection list
-    // to keep the iterator valid, but mark the Signal dirty. If the Signal is dirty, all invalid connections
+    // In the sending state, removing connection will leave invalid routes in the route table
+    // to keep the indices valid, but mark the Signal dirty. If the Signal is dirty, all invalid routes
     // will be removed by the Sentry when it destructs.
     Signal::Sentry sentry(this);
 
-    std::pair<RouteMap::iterator, RouteMap::iterator> eqr0 = _routes.equal_range(0);
-    std::pair<RouteMap::iterator, RouteMap::iterator> eqr1 = _routes.equal_range(&ev.typeInfo());
+    if( ! this->routeEvent(0, ev, sentry) )
+        return;
 
-    for(RouteMap::iterator it  = eqr0.first; it != eqr0.second; ++it) 
+    // only look up the type index, if there are routes for specific events
+    if( _routes.size() > 1 )
+    {
+        std::size_t idx = ev.typeIndex();
+        if(idx != 0)
+            this->routeEvent(idx, ev, sentry);
+    }
+}
+
+
+bool Signal<const Pt::Event&>::routeEvent(std::size_t idx, const Pt::Event& ev, const Sentry& sentry)
+{
+    if( idx >= _routes.size() )
+        return true;
+
+    // routes added while sending are not called
+    const std::size_t count = _routes[idx].size();
+
+    for(std::size_t n = 0; n < count; ++n)
     {
         // The following scenarios must be considered when the slot is called:
         // - The slot might get deleted and thus disconnected from this signal
         // - The slot might delete this signal and we must end calling any slots
         //   immediately
-        // - A new Connection might get added to this Signal in the slot
-        IEventRoute* route = it->second;
-        if(route->isValid()) 
+        // - A new Connection might get added to this Signal in the slot, which
+        //   can reallocate the route table
+        IEventRoute* route = _routes[idx][n];
+        if( route->isValid() )
             route->route(ev);
-        
+
         // If this signal gets deleted by the slot, the Sentry will be 
         // detached. In this case we bail out immediately
-        if( ! sentry ) 
-            return;
+        if( ! sentry )
+            return false;
     }
 
-    for(RouteMap::iterator it  = eqr1.first; it != eqr1.second; ++it) 
-    {
-        IEventRoute* route = it->second;
-        if(route->isValid()) route->route(ev);
-
-        if(!sentry) return;
-    }
+    return true;
 }
 
 
 void Signal<const Pt::Event&>::disconnect()
 {
-    RouteMap::iterator it = _routes.begin();
-    while( it != _routes.end() )
-    {
-        IEventRoute* route = it->second;
+    // closing a connection removes the route from the table, so the
+    // connections are collected first
+    std::vector<Connection> connections;
+    connections.reserve(_routeCount);
 
-        if( ! route->isValid() || route->connection().sender() != this ) 
+    RouteTable::iterator it;
+    for(it = _routes.begin(); it != _routes.end(); ++it)
+    {
+        RouteList::iterator rit;
+        for(rit = it->begin(); rit != it->end(); ++rit)
         {
-            continue;
+            IEventRoute* route = *rit;
+
+            if( route->isValid() && route->connection().sender() == this )
+                connections.push_back( route->connection() );
         }
+    }
 
-        Connection connection = route->connection();
-        ++it;
-        connection.close();
+    std::vector<Connection>::iterator cit;
+    for(cit = connections.begin(); cit != connections.end(); ++cit)
+    {
+        cit->close();
     }
 }
 
@@ -323,63 +386,84 @@ void Signal<const Pt::Event&>::onConnectionClose(const Connection& c)
 {
     // if the signal is currently calling its slots, do not
     // remove the connection now, but only set the cleanup flag
-    // Any invalid connection objects will be removed after
-    // the signal has finished calling its slots by the Sentry.
+    // Any invalid routes will be removed after the signal has
+    // finished calling its slots by the Sentry.
     if( _sending )
     {
         _dirty = true;
+        return;
     }
-    else
+
+    RouteTable::iterator it;
+    for(it = _routes.begin(); it != _routes.end(); ++it)
     {
-        RouteMap::iterator it;
-        for(it = _routes.begin(); it != _routes.end(); ++it )
+        RouteList::iterator rit;
+        for(rit = it->begin(); rit != it->end(); ++rit)
         {
-            IEventRoute* route = it->second;
+            IEventRoute* route = *rit;
             if(route->connection() == c )
             {
+                it->erase(rit);
+                --_routeCount;
                 delete route;
-                _routes.erase(it++);
                 return;
             }
         }
-
-        Connectable::onConnectionClose(c);
     }
+
+    Connectable::onConnectionClose(c);
 }
 
 
-void Signal<const Pt::Event&>::addRoute(const std::type_info* ti, IEventRoute* route)
+void Signal<const Pt::Event&>::addRoute(std::size_t idx, IEventRoute* route)
 {
-    RouteMap::value_type elem(ti, route);
-    _routes.insert( elem );
+    if( idx >= _routes.size() )
+        _routes.resize(idx + 1);
+
+    _routes[idx].push_back(route);
+    ++_routeCount;
 }
 
 
-void Signal<const Pt::Event&>::removeRoute(const Slot& slot)
+void Signal<const Pt::Event&>::removeRoute(std::size_t idx, const Slot& slot)
 {
-    RouteMap::iterator it = _routes.begin();
-    while( it != _routes.end() && it->first == 0 )
+    if( idx >= _routes.size() )
+        return;
+
+    RouteList& routes = _routes[idx];
+    for(std::size_t n = 0; n < routes.size(); ++n)
     {
-        IEventRoute* route = it->second;
-        if(route->connection().slot()->equals(slot) )
+        IEventRoute* route = routes[n];
+        if( route->isValid() && route->connection().slot()->equals(slot) )
         {
-            route->connection().close();
+            Connection connection = route->connection();
+            connection.close();
             break;
         }
     }
 }
 
 
-void Signal<const Pt::Event&>::removeRoute(const std::type_info* ti, const Slot& slot)
+void Signal<const Pt::Event&>::compactRoutes()
 {
-    RouteMap::iterator it = _routes.lower_bound( ti );
-    while(it != _routes.end() && *(it->first) == *ti)
+    _dirty = false;
+
+    RouteTable::iterator it;
+    for(it = _routes.begin(); it != _routes.end(); ++it)
     {
-        IEventRoute* route = it->second;
-        if(route->connection().slot()->equals(slot) )
+        RouteList::iterator rit = it->begin();
+        while( rit != it->end() )
         {
-            route->connection().close();
-            break;
+            IEventRoute* route = *rit;
+            if( route->isValid() )
+            {
+                ++rit;
+                continue;
+            }
+
+            rit = it->erase(rit);
+            --_routeCount;
+            delete route;
         }
     }
 }
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Opens and closes loopback TCP connections in a client thread as fast
+// as possible, while a server in an event loop accepts them. The server
+// accepts one pending connection per wakeup, or drains up to a batch of
+// connections with accept4 and hands them out without waiting again.
+// Prints the accepted connections per second.
+//
+// Usage: AcceptBench [connections]
+
+#include <Pt/Net/TcpServer.h>
+#include <Pt/Net/TcpSocket.h>
+#include <Pt/Net/Endpoint.h>
+#include <Pt/System/MainLoop.h>
+#include <Pt/System/Thread.h>
+#include <Pt/System/Clock.h>
+#include <Pt/Connectable.h>
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+
+namespace {
+
+struct Storm
+{
+    Storm(const Pt::Net::Endpoint& ep, std::size_t count)
+    : ep(ep)
+    , count(count)
+    {}
+
+    void run()
+    {
+        for(std::size_t n = 0; n < count; ++n)
+        {
+            Pt::Net::TcpSocket socket(ep);
+        }
+    }
+
+    Pt::Net::Endpoint ep;
+    std::size_t count;
+};
+
+
+class Acceptor : public Pt::Connectable
+{
+    public:
+        Acceptor(Pt::System::MainLoop& loop, std::size_t count)
+        : _loop(&loop)
+        , _count(count)
+        , _accepted(0)
+        {}
+
+        void onConnectionPending(Pt::Net::TcpServer& server)
+        {
+            Pt::Net::TcpSocket socket;
+            socket.accept(server);
+
+            if(++_accepted < _count)
+                server.beginAccept();
+            else
+                _loop->exit();
+        }
+
+    private:
+        Pt::System::MainLoop* _loop;
+        std::size_t _count;
+        std::size_t _accepted;
+};
+
+
+double run(std::size_t count, std::size_t batch)
+{
+    Pt::System::MainLoop loop;
+
+    Pt::Net::TcpServerOptions opts;
+    opts.setAcceptBatch(batch);
+
+    Pt::Net::TcpServer server(loop);
+    server.listen(Pt::Net::Endpoint::ip4Loopback(0), opts);
+
+    Pt::Net::Endpoint ep;
+    server.localEndpoint(ep);
+
+    Acceptor acceptor(loop, count);
+    server.connectionPending() += Pt::slot(acceptor, &Acceptor::onConnectionPending);
+    server.beginAccept();
+
+    Storm storm(ep, count);
+    Pt::System::AttachedThread thread( Pt::callable(storm, &Storm::run) );
+
+    Pt::int64_t start = Pt::System::Clock::getMonotonicTime();
+
+    thread.start();
+    loop.run();
+    thread.join();
+
+    Pt::int64_t ns = Pt::System::Clock::getMonotonicTime() - start;
+
+    return double(count) * 1000000000.0 / double(ns);
+}
+
+}
+
+
+int main(int argc, char** argv)
+{
+    std::size_t count = argc > 1 ? std::strtoul(argv[1], 0, 10) : 5000;
+
+    const std::size_t batches[] = { 1, 8, 32, 128 };
+
+    std::cout << std::setw(8) << "batch"
+              << std::setw(16) << "accepts/s" << std::endl;
+
+    for(std::size_t n = 0; n < sizeof(batches) / sizeof(batches[0]); ++n)
+    {
+        double rate = run(count, batches[n]);
+
+        std::cout << std::setw(8) << batches[n]
+                  << std::setw(16) << std::fixed << std::setprecision(0) << rate << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,248 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Echoes messages over loopback TCP connections, which are all served
+// by one loop. Each client writes a message, waits until the peer has
+// echoed it and starts the next round trip. The default poll selector
+// is compared with the edge-triggered epoll selector and the
+// completion-based io_uring selector.
+//
+// Usage: EchoBench [roundtrips]
+
+#include <Pt/Net/TcpServer.h>
+#include <Pt/Net/TcpSocket.h>
+#include <Pt/Net/Endpoint.h>
+#include <Pt/System/MainLoop.h>
+#include <Pt/System/Clock.h>
+#include <Pt/Connectable.h>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+
+namespace {
+
+class EchoPair : public Pt::Connectable
+{
+    public:
+        EchoPair(Pt::System::EventLoop& loop, std::size_t size, std::size_t& done)
+        : _client(loop)
+        , _peer(loop)
+        , _message(size, 'x')
+        , _reply(size)
+        , _peerBuffer(size)
+        , _done(&done)
+        , _rounds(0)
+        {
+            _client.inputReady() += Pt::slot(*this, &EchoPair::onClientInput);
+            _client.outputReady() += Pt::slot(*this, &EchoPair::onClientOutput);
+            _peer.inputReady() += Pt::slot(*this, &EchoPair::onPeerInput);
+            _peer.outputReady() += Pt::slot(*this, &EchoPair::onPeerOutput);
+        }
+
+        void connect(Pt::Net::TcpServer& server, const Pt::Net::Endpoint& ep)
+        {
+            _client.connect(ep);
+            _peer.accept(server);
+            _client.setNoDelay(true);
+            _peer.setNoDelay(true);
+        }
+
+        void start(std::size_t rounds)
+        {
+            _rounds = rounds;
+            _peer.beginRead(&_peerBuffer[0], _peerBuffer.size());
+            beginRound();
+        }
+
+        void close()
+        {
+            _client.close();
+            _peer.close();
+        }
+
+    private:
+        void beginRound()
+        {
+            _written = 0;
+            _received = 0;
+            _client.beginWrite(&_message[0], _message.size());
+        }
+
+        void onClientOutput(Pt::System::IODevice& dev)
+        {
+            _written += dev.endWrite();
+            if(_written < _message.size())
+            {
+                dev.beginWrite(&_message[_written], _message.size() - _written);
+                return;
+            }
+
+            dev.beginRead(&_reply[0], _reply.size());
+        }
+
+        void onClientInput(Pt::System::IODevice& dev)
+        {
+            _received += dev.endRead();
+            if(dev.isEof())
+                return;
+
+            if(_received < _reply.size())
+            {
+                dev.beginRead(&_reply[_received], _reply.size() - _received);
+                return;
+            }
+
+            ++*_done;
+            if(--_rounds > 0)
+                beginRound();
+        }
+
+        void onPeerInput(Pt::System::IODevice& dev)
+        {
+            std::size_t n = dev.endRead();
+            if(dev.isEof())
+                return;
+
+            _peerPending = n;
+            _peerWritten = 0;
+            dev.beginWrite(&_peerBuffer[0], n);
+        }
+
+        void onPeerOutput(Pt::System::IODevice& dev)
+        {
+            _peerWritten += dev.endWrite();
+            if(_peerWritten < _peerPending)
+            {
+                dev.beginWrite(&_peerBuffer[_peerWritten], _peerPending - _peerWritten);
+                return;
+            }
+
+            dev.beginRead(&_peerBuffer[0], _peerBuffer.size());
+        }
+
+    private:
+        Pt::Net::TcpSocket _client;
+        Pt::Net::TcpSocket _peer;
+        std::vector<char> _message;
+        std::vector<char> _reply;
+        std::vector<char> _peerBuffer;
+        std::size_t* _done;
+        std::size_t _rounds;
+        std::size_t _written;
+        std::size_t _received;
+        std::size_t _peerPending;
+        std::size_t _peerWritten;
+};
+
+
+// returns round trips per second
+double run(const Pt::System::MainLoopOptions& opts, unsigned short port,
+           std::size_t connections, std::size_t size, std::size_t roundtrips)
+{
+    Pt::System::MainLoop loop(opts);
+
+    Pt::Net::Endpoint ep = Pt::Net::Endpoint::ip4Loopback(port);
+    Pt::Net::TcpServer server(loop);
+    server.listen(ep);
+
+    std::size_t done = 0;
+    std::vector<EchoPair*> pairs;
+    for(std::size_t n = 0; n < connections; ++n)
+    {
+        pairs.push_back( new EchoPair(loop, size, done) );
+        pairs.back()->connect(server, ep);
+    }
+
+    const std::size_t perConnection = roundtrips / connections;
+    const std::size_t total = perConnection * connections;
+
+    Pt::int64_t start = Pt::System::Clock::getMonotonicTime();
+
+    for(std::size_t n = 0; n < connections; ++n)
+        pairs[n]->start(perConnection);
+
+    while(done < total)
+        loop.waitNext();
+
+    Pt::int64_t ns = Pt::System::Clock::getMonotonicTime() - start;
+
+    for(std::size_t n = 0; n < connections; ++n)
+    {
+        pairs[n]->close();
+        delete pairs[n];
+    }
+
+    server.close();
+
+    return double(total) * 1000000000.0 / double(ns);
+}
+
+}
+
+
+int main(int argc, char** argv)
+{
+    std::size_t roundtrips = argc > 1 ? std::strtoul(argv[1], 0, 10) : 20000;
+
+    Pt::System::MainLoopOptions poll;
+
+    Pt::System::MainLoopOptions edge;
+    edge.setEdgeTriggered();
+
+    Pt::System::MainLoopOptions uring;
+    uring.setIoUring();
+
+    std::cout << std::setw(12) << "connections"
+              << std::setw(10) << "size"
+              << std::setw(14) << "poll rt/s"
+              << std::setw(14) << "epoll-ET rt/s"
+              << std::setw(14) << "io_uring rt/s" << std::endl;
+
+    const std::size_t connections[] = { 1, 16, 128 };
+    const std::size_t sizes[] = { 64, 4096, 65536 };
+
+    unsigned short port = 27200;
+    for(std::size_t c = 0; c < sizeof(connections) / sizeof(connections[0]); ++c)
+    {
+        for(std::size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+        {
+            double p = run(poll, port++, connections[c], sizes[s], roundtrips);
+            double e = run(edge, port++, connections[c], sizes[s], roundtrips);
+            double u = run(uring, port++, connections[c], sizes[s], roundtrips);
+
+            std::cout << std::setw(12) << connections[c]
+                      << std::setw(10) << sizes[s]
+                      << std::setw(14) << std::fixed << std::setprecision(0) << p
+                      << std::setw(14) << e
+                      << std::setw(14) << u << std::endl;
+        }
+    }
+
+    return 0;
+}
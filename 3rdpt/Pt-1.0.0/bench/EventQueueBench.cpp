@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+// Pushes events from 1 to 32 producer threads while the main thread
+// drains them. The lock-free EventQueue is compared with a queue built
+// like the previous one, a std::deque guarded by a mutex, which is
+// locked for every push and every pop.
+//
+// Usage: EventQueueBench [events]
+
+#include <Pt/System/EventLoop.h>
+#include <Pt/System/Thread.h>
+#include <Pt/System/Mutex.h>
+#include <Pt/System/Clock.h>
+#include <Pt/Event.h>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <deque>
+#include <cstdlib>
+
+namespace {
+
+struct BenchEvent : public Pt::BasicEvent<BenchEvent>
+{
+    explicit BenchEvent(std::size_t value)
+    : value(value)
+    {}
+
+    std::size_t value;
+};
+
+
+class LockedEventQueue
+{
+    public:
+        ~LockedEventQueue()
+        {
+            while( ! _events.empty() )
+            {
+                _events.front()->destroy(_allocator);
+                _events.pop_front();
+            }
+        }
+
+        void pushEvent(const Pt::Event& ev)
+        {
+            Pt::System::MutexLock lock(_mutex);
+            Pt::Event& cloned = ev.clone(_allocator);
+            _events.push_back(&cloned);
+        }
+
+        bool processEvents(Pt::Signal<const Pt::Event&>& eventSignal)
+        {
+            while(true)
+            {
+                Pt::Event* ev = 0;
+                {
+                    Pt::System::MutexLock lock(_mutex);
+                    if( _events.empty() )
+                        break;
+
+                    ev = _events.front();
+                    _events.pop_front();
+                }
+
+                eventSignal.send(*ev);
+
+                Pt::System::MutexLock lock(_mutex);
+                ev->destroy(_allocator);
+            }
+
+            return true;
+        }
+
+    private:
+        Pt::System::Mutex _mutex;
+        Pt::Allocator _allocator;
+        std::deque<Pt::Event*> _events;
+};
+
+
+template <typename QueueT>
+struct Producer
+{
+    Producer(QueueT& queue, std::size_t count)
+    : queue(&queue)
+    , count(count)
+    {}
+
+    void run()
+    {
+        for(std::size_t n = 0; n < count; ++n)
+            queue->pushEvent( BenchEvent(n) );
+    }
+
+    QueueT* queue;
+    std::size_t count;
+};
+
+
+std::size_t received = 0;
+
+void onEvent(const Pt::Event&)
+{
+    ++received;
+}
+
+
+template <typename QueueT>
+double run(std::size_t producerCount, std::size_t events)
+{
+    QueueT queue;
+    Pt::Signal<const Pt::Event&> signal;
+    signal += Pt::slot(onEvent);
+
+    const std::size_t perProducer = events / producerCount;
+    const std::size_t total = perProducer * producerCount;
+
+    std::vector< Producer<QueueT> > producers;
+    for(std::size_t n = 0; n < producerCount; ++n)
+        producers.push_back( Producer<QueueT>(queue, perProducer) );
+
+    received = 0;
+    Pt::int64_t start = Pt::System::Clock::getMonotonicTime();
+
+    std::vector<Pt::System::AttachedThread*> threads;
+    for(std::size_t n = 0; n < producerCount; ++n)
+    {
+        threads.push_back( new Pt::System::AttachedThread( Pt::callable(producers[n], &Producer<QueueT>::run) ) );
+        threads.back()->start();
+    }
+
+    while(received < total)
+        queue.processEvents(signal);
+
+    Pt::int64_t ns = Pt::System::Clock::getMonotonicTime() - start;
+
+    for(std::size_t n = 0; n < producerCount; ++n)
+    {
+        threads[n]->join();
+        delete threads[n];
+    }
+
+    return double(total) * 1000.0 / double(ns);
+}
+
+}
+
+
+int main(int argc, char** argv)
+{
+    std::size_t events = argc > 1 ? std::strtoul(argv[1], 0, 10) : 2000000;
+
+    std::cout << std::setw(10) << "producers"
+              << std::setw(16) << "locked Mev/s"
+              << std::setw(16) << "lockfree Mev/s" << std::endl;
+
+    for(std::size_t producers = 1; producers <= 32; producers *= 2)
+    {
+        double locked = run<LockedEventQueue>(producers, events);
+        double lockfree = run<Pt::System::EventQueue>(producers, events);
+
+        std::cout << std::setw(10) << producers
+                  << std::setw(16) << std::fixed << std::setprecision(2) << locked
+                  << std::setw(16) << lockfree << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Parses HTTP request headers into a MessageHeader, either character by
+// character as the parser was driven before, or a whole buffer at once,
+// which skips over URLs, names and values with the vectorized delimiter
+// search. Prints thousands of requests per second and the throughput for
+// a short request and a typical browser request.
+//
+// Usage: HttpParseBench [requests]
+
+#include "Parser.h"
+#include <Pt/Http/Message.h>
+#include <Pt/System/Clock.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <stdexcept>
+#include <cstdlib>
+
+namespace {
+
+const char ShortRequest[] =
+    "GET / HTTP/1.1\r\n"
+    "Host: localhost\r\n"
+    "\r\n";
+
+const char BrowserRequest[] =
+    "GET /search?q=http+header+parser&source=hp&ei=6Z7uY4m2AbGV9u8P HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+    "Accept-Language: en-US,en;q=0.9,de;q=0.8\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Referer: https://www.example.com/\r\n"
+    "Cookie: session=8f2b1c9d4e5a6b7c8d9e0f1a2b3c4d5e; theme=dark; consent=yes\r\n"
+    "Connection: keep-alive\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "\r\n";
+
+double run(const std::string& msg, std::size_t requests, bool buffered)
+{
+    Pt::Http::MessageHeader header;
+    Pt::Http::HeaderParser::MessageHeaderEvent ev(header);
+    Pt::Http::HeaderParser parser(ev, false);
+
+    Pt::int64_t start = Pt::System::Clock::getMonotonicTime();
+
+    for(std::size_t r = 0; r < requests; ++r)
+    {
+        header.clear();
+        parser.reset(false);
+
+        if(buffered)
+        {
+            parser.parse(msg.data(), msg.size());
+        }
+        else
+        {
+            for(std::size_t n = 0; n < msg.size(); ++n)
+            {
+                if( parser.parse(msg[n]) )
+                    break;
+            }
+        }
+
+        if( ! parser.end() || parser.fail() )
+            throw std::runtime_error("parse failed");
+    }
+
+    Pt::int64_t ns = Pt::System::Clock::getMonotonicTime() - start;
+
+    return double(requests) * 1000000.0 / double(ns);
+}
+
+}
+
+
+int main(int argc, char** argv)
+{
+    std::size_t requests = argc > 1 ? std::strtoul(argv[1], 0, 10) : 1000000;
+
+    const std::string messages[] = { ShortRequest, BrowserRequest };
+
+    std::cout << std::setw(8) << "size"
+              << std::setw(16) << "char kreq/s"
+              << std::setw(16) << "buffer kreq/s"
+              << std::setw(12) << "char MB/s"
+              << std::setw(14) << "buffer MB/s" << std::endl;
+
+    for(std::size_t m = 0; m < sizeof(messages) / sizeof(messages[0]); ++m)
+    {
+        double single = run(messages[m], requests, false);
+        double buffered = run(messages[m], requests, true);
+
+        const double size = double(messages[m].size());
+
+        std::cout << std::setw(8) << messages[m].size()
+                  << std::setw(16) << std::fixed << std::setprecision(1) << single
+                  << std::setw(16) << buffered
+                  << std::setw(12) << single * size / 1000.0
+                  << std::setw(14) << buffered * size / 1000.0 << std::endl;
+    }
+
+    return 0;
+}
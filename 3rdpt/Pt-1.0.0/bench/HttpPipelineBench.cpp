@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Sends small GET requests to a local HTTP server over one keep-alive
+// connection. The client writes a window of requests at once and reads
+// all replies before it writes the next window, so the server reads
+// several requests at once and writes their replies in batches. A window
+// of 1 does not pipeline. Prints thousands of requests per second for
+// the default batch limit, for replies written one by one and with
+// TCP_NODELAY disabled.
+//
+// Usage: HttpPipelineBench [requests] [port]
+
+#include <Pt/Http/Server.h>
+#include <Pt/Http/Service.h>
+#include <Pt/Http/Servlet.h>
+#include <Pt/Http/Responder.h>
+#include <Pt/Http/Request.h>
+#include <Pt/Http/Reply.h>
+#include <Pt/Net/TcpSocket.h>
+#include <Pt/Net/Endpoint.h>
+#include <Pt/System/MainLoop.h>
+#include <Pt/System/Thread.h>
+#include <Pt/System/Clock.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <stdexcept>
+#include <cstdlib>
+
+namespace {
+
+const char Request[] =
+    "GET /stats HTTP/1.1\r\n"
+    "Host: localhost\r\n"
+    "Accept: application/json\r\n"
+    "\r\n";
+
+class StatsResponder : public Pt::Http::Responder
+{
+    public:
+        explicit StatsResponder(Pt::Http::Service& service)
+        : Pt::Http::Responder(service)
+        {}
+
+    protected:
+        void onBeginRequest(Pt::Http::Request& request, Pt::Http::Reply& reply, Pt::System::EventLoop& loop)
+        {}
+
+        void onReadRequest(Pt::Http::Request& request, Pt::Http::Reply& reply, Pt::System::EventLoop& loop)
+        {
+            request.discard();
+        }
+
+        void onBeginReply(const Pt::Http::Request& request, Pt::Http::Reply& reply, Pt::System::EventLoop& loop)
+        {
+            reply.header().set("Content-Type", "application/json");
+            reply.body() << "{\"level\":12,\"score\":4711}";
+            reply.beginSend(true);
+        }
+
+        void onWriteReply(const Pt::Http::Request& request, Pt::Http::Reply& reply, Pt::System::EventLoop& loop)
+        {
+            reply.beginSend(true);
+        }
+};
+
+
+class PipelineClient
+{
+    public:
+        PipelineClient(Pt::System::EventLoop& loop, unsigned short port, std::size_t requests, std::size_t window)
+        : _loop(&loop)
+        , _port(port)
+        , _requests(requests)
+        , _window(window)
+        , _ns(0)
+        , _failed(false)
+        {}
+
+        void run()
+        {
+            try
+            {
+                Pt::Net::TcpSocket socket( Pt::Net::Endpoint::ip4Loopback(_port) );
+                socket.setNoDelay(true);
+
+                std::string window;
+                for(std::size_t n = 0; n < _window; ++n)
+                    window += Request;
+
+                Pt::int64_t start = Pt::System::Clock::getMonotonicTime();
+
+                for(std::size_t sent = 0; sent < _requests; sent += _window)
+                {
+                    std::size_t written = 0;
+                    while(written < window.size())
+                        written += socket.write(window.data() + written, window.size() - written);
+
+                    readReplies(socket, _window);
+                }
+
+                _ns = Pt::System::Clock::getMonotonicTime() - start;
+            }
+            catch(const std::exception& e)
+            {
+                std::cerr << "client failed: " << e.what() << std::endl;
+                _failed = true;
+            }
+
+            _loop->exit();
+        }
+
+        // thousands of requests per second
+        double rate() const
+        {
+            std::size_t rounds = (_requests + _window - 1) / _window;
+            return _failed ? 0.0 : double(rounds * _window) * 1000000.0 / double(_ns);
+        }
+
+    private:
+        // all replies have a body of the same size
+        void readReplies(Pt::Net::TcpSocket& socket, std::size_t count)
+        {
+            char buffer[8192];
+
+            while(count > 0)
+            {
+                std::size_t n = socket.read(buffer, sizeof(buffer));
+                if(n == 0)
+                    throw std::runtime_error("connection lost");
+
+                _input.append(buffer, n);
+
+                std::string::size_type end = std::string::npos;
+                while( count > 0 && (end = _input.find("\r\n\r\n")) != std::string::npos )
+                {
+                    const std::size_t size = end + 4 + 25;
+                    if(_input.size() < size)
+                        break;
+
+                    _input.erase(0, size);
+                    --count;
+                }
+            }
+        }
+
+    private:
+        Pt::System::EventLoop* _loop;
+        unsigned short _port;
+        std::size_t _requests;
+        std::size_t _window;
+        Pt::int64_t _ns;
+        bool _failed;
+        std::string _input;
+};
+
+
+double run(unsigned short port, std::size_t requests, std::size_t window,
+           std::size_t maxPipelined, bool noDelay)
+{
+    Pt::System::MainLoop loop;
+
+    Pt::Http::BasicService<StatsResponder> service;
+    Pt::Http::MapUrl servlet("/stats", service);
+
+    Pt::Http::Server server(loop, Pt::Net::Endpoint::ip4Loopback(port));
+    server.setMaxPipelined(maxPipelined);
+    server.setNoDelay(noDelay);
+    server.addServlet(servlet);
+
+    PipelineClient client(loop, port, requests, window);
+    Pt::System::AttachedThread thread( Pt::callable(client, &PipelineClient::run) );
+    thread.start();
+
+    loop.run();
+
+    thread.join();
+    server.removeServlet(servlet);
+
+    return client.rate();
+}
+
+}
+
+
+int main(int argc, char** argv)
+{
+    std::size_t requests = argc > 1 ? std::strtoul(argv[1], 0, 10) : 200000;
+    unsigned short port = argc > 2 ? static_cast<unsigned short>(std::strtoul(argv[2], 0, 10)) : 27310;
+
+    const std::size_t windows[] = { 1, 4, 16, 64 };
+
+    std::cout << std::setw(8) << "window"
+              << std::setw(16) << "batched kreq/s"
+              << std::setw(16) << "single kreq/s"
+              << std::setw(16) << "delay kreq/s" << std::endl;
+
+    for(std::size_t w = 0; w < sizeof(windows) / sizeof(windows[0]); ++w)
+    {
+        double batched = run(port, requests, windows[w], 16, true);
+        double single = run(port, requests, windows[w], 1, true);
+        double delayed = run(port, requests, windows[w], 16, false);
+
+        std::cout << std::setw(8) << windows[w]
+                  << std::setw(16) << std::fixed << std::setprecision(1) << batched
+                  << std::setw(16) << single
+                  << std::setw(16) << delayed << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Hands integers from producer threads to consumer threads through a
+// bounded queue. The mutex and condition based Queue is compared with
+// the ring buffer SpscQueue for one producer and one consumer and with
+// MpmcQueue for 1 to 8 producers and as many consumers.
+//
+// Usage: QueueBench [items] [capacity]
+
+#include <Pt/System/Queue.h>
+#include <Pt/System/SpscQueue.h>
+#include <Pt/System/MpmcQueue.h>
+#include <Pt/System/Thread.h>
+#include <Pt/System/Clock.h>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+
+namespace {
+
+class BoundedQueue : public Pt::System::Queue<std::size_t>
+{
+    public:
+        explicit BoundedQueue(std::size_t capacity)
+        {
+            this->maxSize(capacity);
+        }
+};
+
+
+template <typename QueueT>
+struct Producer
+{
+    Producer(QueueT& queue, std::size_t count)
+    : queue(&queue)
+    , count(count)
+    {}
+
+    void run()
+    {
+        for(std::size_t n = 0; n < count; ++n)
+            queue->put(n);
+    }
+
+    QueueT* queue;
+    std::size_t count;
+};
+
+
+template <typename QueueT>
+struct Consumer
+{
+    Consumer(QueueT& queue, std::size_t count)
+    : queue(&queue)
+    , count(count)
+    , sum(0)
+    {}
+
+    void run()
+    {
+        for(std::size_t n = 0; n < count; ++n)
+            sum += queue->get();
+    }
+
+    QueueT* queue;
+    std::size_t count;
+    std::size_t sum;
+};
+
+
+template <typename QueueT>
+double run(std::size_t threadCount, std::size_t items, std::size_t capacity)
+{
+    QueueT queue(capacity);
+
+    const std::size_t perThread = items / threadCount;
+    const std::size_t total = perThread * threadCount;
+
+    std::vector< Producer<QueueT> > producers;
+    std::vector< Consumer<QueueT> > consumers;
+    for(std::size_t n = 0; n < threadCount; ++n)
+    {
+        producers.push_back( Producer<QueueT>(queue, perThread) );
+        consumers.push_back( Consumer<QueueT>(queue, perThread) );
+    }
+
+    Pt::int64_t start = Pt::System::Clock::getMonotonicTime();
+
+    std::vector<Pt::System::AttachedThread*> threads;
+    for(std::size_t n = 0; n < threadCount; ++n)
+    {
+        threads.push_back( new Pt::System::AttachedThread( Pt::callable(consumers[n], &Consumer<QueueT>::run) ) );
+        threads.back()->start();
+
+        threads.push_back( new Pt::System::AttachedThread( Pt::callable(producers[n], &Producer<QueueT>::run) ) );
+        threads.back()->start();
+    }
+
+    for(std::size_t n = 0; n < threads.size(); ++n)
+    {
+        threads[n]->join();
+        delete threads[n];
+    }
+
+    Pt::int64_t ns = Pt::System::Clock::getMonotonicTime() - start;
+
+    return double(total) * 1000.0 / double(ns);
+}
+
+}
+
+
+int main(int argc, char** argv)
+{
+    std::size_t items = argc > 1 ? std::strtoul(argv[1], 0, 10) : 1000000;
+    std::size_t capacity = argc > 2 ? std::strtoul(argv[2], 0, 10) : 1024;
+
+    std::cout << std::setw(10) << "threads"
+              << std::setw(16) << "Queue Mops/s"
+              << std::setw(16) << "Spsc Mops/s"
+              << std::setw(16) << "Mpmc Mops/s" << std::endl;
+
+    for(std::size_t threads = 1; threads <= 8; threads *= 2)
+    {
+        double locked = run<BoundedQueue>(threads, items, capacity);
+        double mpmc = run< Pt::System::MpmcQueue<std::size_t> >(threads, items, capacity);
+
+        std::cout << std::setw(10) << threads
+                  << std::setw(16) << std::fixed << std::setprecision(2) << locked;
+
+        if(threads == 1)
+        {
+            double spsc = run< Pt::System::SpscQueue<std::size_t> >(threads, items, capacity);
+            std::cout << std::setw(16) << spsc;
+        }
+        else
+        {
+            std::cout << std::setw(16) << "-";
+        }
+
+        std::cout << std::setw(16) << mpmc << std::endl;
+    }
+
+    return 0;
+}
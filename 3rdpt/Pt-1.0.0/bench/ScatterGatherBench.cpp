@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Sends messages made of a 32 byte header, a payload and an 8 byte
+// trailer over a loopback TCP connection, while a second thread drains
+// the connection. The parts are either copied into one buffer and sent
+// with write(), or sent in place with a vectored writev().
+//
+// Usage: ScatterGatherBench [megabytes]
+
+#include <Pt/Net/TcpServer.h>
+#include <Pt/Net/TcpSocket.h>
+#include <Pt/Net/Endpoint.h>
+#include <Pt/System/IODevice.h>
+#include <Pt/System/Thread.h>
+#include <Pt/System/Clock.h>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+
+namespace {
+
+struct Drain
+{
+    Drain(Pt::Net::TcpSocket& socket, std::size_t total)
+    : socket(&socket)
+    , total(total)
+    {}
+
+    void run()
+    {
+        std::vector<char> buffer(64 * 1024);
+
+        std::size_t received = 0;
+        while(received < total)
+        {
+            std::size_t n = socket->read(&buffer[0], buffer.size());
+            if(n == 0)
+                break;
+
+            received += n;
+        }
+    }
+
+    Pt::Net::TcpSocket* socket;
+    std::size_t total;
+};
+
+
+void writeAll(Pt::Net::TcpSocket& socket, const char* data, std::size_t size)
+{
+    std::size_t written = 0;
+    while(written < size)
+        written += socket.write(data + written, size - written);
+}
+
+
+void writeAll(Pt::Net::TcpSocket& socket, Pt::System::IOVec* vec, std::size_t count)
+{
+    std::size_t first = 0;
+    while(first < count)
+    {
+        std::size_t n = socket.writev(vec + first, count - first);
+
+        while(first < count && n >= vec[first].size)
+        {
+            n -= vec[first].size;
+            ++first;
+        }
+
+        if(first < count)
+        {
+            vec[first].base += n;
+            vec[first].size -= n;
+        }
+    }
+}
+
+
+double run(std::size_t payloadSize, std::size_t messages, bool vectored)
+{
+    Pt::Net::TcpServer server;
+    server.listen( Pt::Net::Endpoint::ip4Loopback(0) );
+
+    Pt::Net::Endpoint ep;
+    server.localEndpoint(ep);
+
+    Pt::Net::TcpSocket client(ep);
+    Pt::Net::TcpSocket peer(server);
+
+    std::vector<char> header(32, 'h');
+    std::vector<char> payload(payloadSize, 'p');
+    std::vector<char> trailer(8, 't');
+    std::vector<char> message;
+
+    const std::size_t messageSize = header.size() + payload.size() + trailer.size();
+
+    Drain drain(peer, messageSize * messages);
+    Pt::System::AttachedThread thread( Pt::callable(drain, &Drain::run) );
+    thread.start();
+
+    Pt::int64_t start = Pt::System::Clock::getMonotonicTime();
+
+    for(std::size_t n = 0; n < messages; ++n)
+    {
+        if(vectored)
+        {
+            Pt::System::IOVec vec[3] = {
+                Pt::System::IOVec(&header[0], header.size()),
+                Pt::System::IOVec(&payload[0], payload.size()),
+                Pt::System::IOVec(&trailer[0], trailer.size())
+            };
+
+            writeAll(client, vec, 3);
+        }
+        else
+        {
+            message.resize(messageSize);
+            std::memcpy(&message[0], &header[0], header.size());
+            std::memcpy(&message[header.size()], &payload[0], payload.size());
+            std::memcpy(&message[header.size() + payload.size()], &trailer[0], trailer.size());
+
+            writeAll(client, &message[0], message.size());
+        }
+    }
+
+    thread.join();
+
+    Pt::int64_t ns = Pt::System::Clock::getMonotonicTime() - start;
+
+    return double(messageSize * messages) * 1000.0 / double(ns);
+}
+
+}
+
+
+int main(int argc, char** argv)
+{
+    std::size_t megabytes = argc > 1 ? std::strtoul(argv[1], 0, 10) : 256;
+
+    const std::size_t payloadSizes[] = { 64, 1024, 16 * 1024, 256 * 1024 };
+
+    std::cout << std::setw(10) << "payload"
+              << std::setw(16) << "copy MB/s"
+              << std::setw(16) << "writev MB/s" << std::endl;
+
+    for(std::size_t n = 0; n < sizeof(payloadSizes) / sizeof(payloadSizes[0]); ++n)
+    {
+        const std::size_t payloadSize = payloadSizes[n];
+        const std::size_t messages = megabytes * 1024 * 1024 / (payloadSize + 40);
+
+        double copy = run(payloadSize, messages, false);
+        double vectored = run(payloadSize, messages, true);
+
+        std::cout << std::setw(10) << payloadSize
+                  << std::setw(16) << std::fixed << std::setprecision(1) << copy
+                  << std::setw(16) << vectored << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Sends a large temporary file over a loopback TCP connection, while a
+// second thread drains the connection. The file is either read into a
+// buffer and written to the socket, or sent with TcpSocket::sendFile(),
+// which does not copy the data to user space on Linux.
+//
+// Usage: SendFileBench [megabytes]
+
+#include <Pt/Net/TcpServer.h>
+#include <Pt/Net/TcpSocket.h>
+#include <Pt/Net/Endpoint.h>
+#include <Pt/System/FileDevice.h>
+#include <Pt/System/Thread.h>
+#include <Pt/System/Clock.h>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+namespace {
+
+struct Drain
+{
+    Drain(Pt::Net::TcpSocket& socket, std::size_t total)
+    : socket(&socket)
+    , total(total)
+    {}
+
+    void run()
+    {
+        std::vector<char> buffer(256 * 1024);
+
+        std::size_t received = 0;
+        while(received < total)
+        {
+            std::size_t n = socket->read(&buffer[0], buffer.size());
+            if(n == 0)
+                break;
+
+            received += n;
+        }
+    }
+
+    Pt::Net::TcpSocket* socket;
+    std::size_t total;
+};
+
+
+double run(const std::string& path, std::size_t size, bool sendFile)
+{
+    Pt::Net::TcpServer server;
+    server.listen( Pt::Net::Endpoint::ip4Loopback(0) );
+
+    Pt::Net::Endpoint ep;
+    server.localEndpoint(ep);
+
+    Pt::Net::TcpSocket client(ep);
+    Pt::Net::TcpSocket peer(server);
+
+    Pt::System::FileDevice file(path, std::ios::in);
+    std::vector<char> buffer(64 * 1024);
+
+    Drain drain(peer, size);
+    Pt::System::AttachedThread thread( Pt::callable(drain, &Drain::run) );
+    thread.start();
+
+    Pt::int64_t start = Pt::System::Clock::getMonotonicTime();
+
+    std::size_t sent = 0;
+    while(sent < size)
+    {
+        if(sendFile)
+        {
+            sent += client.sendFile(file, sent, size - sent);
+            continue;
+        }
+
+        std::size_t n = file.read(&buffer[0], buffer.size());
+        if(n == 0)
+            break;
+
+        std::size_t written = 0;
+        while(written < n)
+            written += client.write(&buffer[written], n - written);
+
+        sent += n;
+    }
+
+    thread.join();
+
+    Pt::int64_t ns = Pt::System::Clock::getMonotonicTime() - start;
+
+    return double(sent) * 1000.0 / double(ns);
+}
+
+}
+
+
+int main(int argc, char** argv)
+{
+    std::size_t megabytes = argc > 1 ? std::strtoul(argv[1], 0, 10) : 256;
+    const std::size_t size = megabytes * 1024 * 1024;
+
+    std::ostringstream os;
+    os << "/tmp/SendFileBench." << ::getpid();
+    const std::string path = os.str();
+
+    {
+        std::vector<char> chunk(1024 * 1024, 'f');
+        std::ofstream file(path.c_str(), std::ios::binary);
+        for(std::size_t n = 0; n < megabytes; ++n)
+            file.write(&chunk[0], static_cast<std::streamsize>(chunk.size()));
+    }
+
+    // the first run warms the page cache
+    run(path, size, false);
+
+    double copy = run(path, size, false);
+    double sendFile = run(path, size, true);
+
+    std::remove( path.c_str() );
+
+    std::cout << std::setw(10) << "megabytes"
+              << std::setw(16) << "copy MB/s"
+              << std::setw(16) << "sendFile MB/s" << std::endl;
+
+    std::cout << std::setw(10) << megabytes
+              << std::setw(16) << std::fixed << std::setprecision(1) << copy
+              << std::setw(16) << sendFile << std::endl;
+
+    return 0;
+}
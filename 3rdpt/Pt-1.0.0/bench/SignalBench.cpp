@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Measures the cost of Signal::send with 0, 1, 4 and 32 connected
+// slots. The cases with none or one slot use the inline slot of the
+// signal, the others the slot table on the heap.
+//
+// Usage: SignalBench [sends]
+
+#include <Pt/Signal.h>
+#include <Pt/Connectable.h>
+#include <Pt/System/Clock.h>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+
+namespace {
+
+class Receiver : public Pt::Connectable
+{
+    public:
+        Receiver()
+        : sum(0)
+        {}
+
+        void onSignal(std::size_t value)
+        {
+            sum += value;
+        }
+
+        std::size_t sum;
+};
+
+
+double run(std::size_t slots, std::size_t sends)
+{
+    std::vector<Receiver> receivers(slots);
+
+    Pt::Signal<std::size_t> signal;
+    for(std::size_t n = 0; n < slots; ++n)
+        signal += Pt::slot(receivers[n], &Receiver::onSignal);
+
+    Pt::int64_t start = Pt::System::Clock::getMonotonicTime();
+
+    for(std::size_t n = 0; n < sends; ++n)
+        signal.send(n);
+
+    Pt::int64_t ns = Pt::System::Clock::getMonotonicTime() - start;
+
+    return double(ns) / double(sends);
+}
+
+}
+
+
+int main(int argc, char** argv)
+{
+    std::size_t sends = argc > 1 ? std::strtoul(argv[1], 0, 10) : 10000000;
+
+    const std::size_t slotCounts[] = { 0, 1, 4, 32 };
+
+    std::cout << std::setw(10) << "slots"
+              << std::setw(16) << "ns/send"
+              << std::setw(16) << "ns/slot" << std::endl;
+
+    for(std::size_t n = 0; n < sizeof(slotCounts) / sizeof(slotCounts[0]); ++n)
+    {
+        const std::size_t slots = slotCounts[n];
+
+        // fewer sends for many slots to keep the run time similar
+        double perSend = run(slots, sends / (slots > 1 ? slots : 1));
+
+        std::cout << std::setw(10) << slots
+                  << std::setw(16) << std::fixed << std::setprecision(2) << perSend;
+
+        if(slots > 0)
+            std::cout << std::setw(16) << perSend / double(slots);
+        else
+            std::cout << std::setw(16) << "-";
+
+        std::cout << std::endl;
+    }
+
+    return 0;
+}
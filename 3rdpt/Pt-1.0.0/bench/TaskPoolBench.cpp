@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Updates a set of synthetic entities for a number of ticks with
+// parallelFor on pools of 1 to 64 threads. Each entity integrates its
+// position and steers towards a target, which costs about a hundred
+// floating point operations. The speedup is relative to a serial loop.
+//
+// Usage: TaskPoolBench [entities] [ticks]
+
+#include <Pt/System/TaskPool.h>
+#include <Pt/System/Thread.h>
+#include <Pt/System/Clock.h>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <cmath>
+
+namespace {
+
+struct Entity
+{
+    float x, y, z;
+    float vx, vy, vz;
+    float tx, ty, tz;
+};
+
+
+void updateEntity(Entity& e)
+{
+    const float dt = 0.016f;
+
+    for(int step = 0; step < 4; ++step)
+    {
+        float dx = e.tx - e.x;
+        float dy = e.ty - e.y;
+        float dz = e.tz - e.z;
+        float dist = std::sqrt(dx * dx + dy * dy + dz * dz) + 0.001f;
+
+        e.vx += dx / dist * dt;
+        e.vy += dy / dist * dt;
+        e.vz += dz / dist * dt;
+
+        e.x += e.vx * dt;
+        e.y += e.vy * dt;
+        e.z += e.vz * dt;
+    }
+}
+
+
+struct UpdateEntities
+{
+    explicit UpdateEntities(std::vector<Entity>& entities)
+    : entities(&entities)
+    {}
+
+    void operator()(std::size_t n)
+    { updateEntity( (*entities)[n] ); }
+
+    std::vector<Entity>* entities;
+};
+
+
+std::vector<Entity> makeEntities(std::size_t count)
+{
+    std::vector<Entity> entities(count);
+    for(std::size_t n = 0; n < count; ++n)
+    {
+        Entity& e = entities[n];
+        e.x = float(n % 100);
+        e.y = float(n % 37);
+        e.z = float(n % 11);
+        e.vx = e.vy = e.vz = 0.0f;
+        e.tx = float(n % 13) * 10.0f;
+        e.ty = float(n % 17) * 10.0f;
+        e.tz = float(n % 19) * 10.0f;
+    }
+
+    return entities;
+}
+
+
+// returns milliseconds per tick
+double runSerial(std::size_t count, std::size_t ticks)
+{
+    std::vector<Entity> entities = makeEntities(count);
+
+    Pt::int64_t start = Pt::System::Clock::getMonotonicTime();
+
+    for(std::size_t tick = 0; tick < ticks; ++tick)
+    {
+        for(std::size_t n = 0; n < entities.size(); ++n)
+            updateEntity(entities[n]);
+    }
+
+    Pt::int64_t ns = Pt::System::Clock::getMonotonicTime() - start;
+    return double(ns) / 1000000.0 / double(ticks);
+}
+
+
+double runPool(std::size_t threads, std::size_t count, std::size_t ticks)
+{
+    std::vector<Entity> entities = makeEntities(count);
+    Pt::System::TaskPool pool(threads);
+
+    Pt::int64_t start = Pt::System::Clock::getMonotonicTime();
+
+    for(std::size_t tick = 0; tick < ticks; ++tick)
+        Pt::System::parallelFor(pool, 0, entities.size(), UpdateEntities(entities));
+
+    Pt::int64_t ns = Pt::System::Clock::getMonotonicTime() - start;
+    return double(ns) / 1000000.0 / double(ticks);
+}
+
+}
+
+
+int main(int argc, char** argv)
+{
+    std::size_t entities = argc > 1 ? std::strtoul(argv[1], 0, 10) : 100000;
+    std::size_t ticks = argc > 2 ? std::strtoul(argv[2], 0, 10) : 20;
+
+    std::cout << "processors: " << Pt::System::Thread::processorCount() << std::endl;
+
+    double serial = runSerial(entities, ticks);
+
+    std::cout << std::setw(10) << "threads"
+              << std::setw(14) << "ms/tick"
+              << std::setw(12) << "speedup" << std::endl;
+
+    std::cout << std::setw(10) << "serial"
+              << std::setw(14) << std::fixed << std::setprecision(3) << serial
+              << std::setw(12) << std::setprecision(2) << 1.0 << std::endl;
+
+    for(std::size_t threads = 1; threads <= 64; threads *= 2)
+    {
+        double ms = runPool(threads, entities, ticks);
+
+        std::cout << std::setw(10) << threads
+                  << std::setw(14) << std::setprecision(3) << ms
+                  << std::setw(12) << std::setprecision(2) << serial / ms << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+// Compares the SortedTimerQueue with the TimerWheel. For each size the
+// timers are started and inserted, a sample of them is restarted and
+// all timers due within one second are expired in ticks of 1 ms.
+//
+// Usage: TimerQueueBench [timers...]
+
+#include <Pt/System/EventLoop.h>
+#include <Pt/System/Timer.h>
+#include <Pt/System/Clock.h>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+
+namespace {
+
+const std::size_t Restarts = 100;
+
+std::size_t fired = 0;
+
+void onTimeout()
+{
+    ++fired;
+}
+
+
+bool finishedBefore(const Pt::System::Timer* a, const Pt::System::Timer* b)
+{
+    return a->finished() < b->finished();
+}
+
+
+double elapsedNs(Pt::int64_t start, std::size_t ops)
+{
+    Pt::int64_t ns = Pt::System::Clock::getMonotonicTime() - start;
+    return ops ? double(ns) / double(ops) : 0.0;
+}
+
+
+void run(const char* name, Pt::System::TimerQueue& queue, std::size_t count)
+{
+    std::vector<Pt::System::Timer*> timers(count);
+    for(std::size_t n = 0; n < count; ++n)
+    {
+        timers[n] = new Pt::System::Timer;
+        timers[n]->timeout() += Pt::slot(onTimeout);
+    }
+
+    std::srand(1);
+
+    // intervals of 1000 to 1999 ms, each timer fires at most once
+    // while the queue is advanced by one second
+    const Pt::Timespan base = Pt::System::Clock::getMonotonicTicks();
+    Pt::int64_t start = Pt::System::Clock::getMonotonicTime();
+    for(std::size_t n = 0; n < count; ++n)
+    {
+        timers[n]->start(1000 + std::rand() % 1000);
+        queue.addTimer(*timers[n]);
+    }
+    double insertNs = elapsedNs(start, count);
+
+    const std::size_t restarts = std::min(Restarts, count);
+    start = Pt::System::Clock::getMonotonicTime();
+    for(std::size_t n = 0; n < restarts; ++n)
+    {
+        Pt::System::Timer* timer = timers[std::rand() % count];
+        queue.removeTimer(*timer);
+        timer->start(1000 + std::rand() % 1000);
+        queue.addTimer(*timer);
+    }
+    double restartNs = elapsedNs(start, restarts);
+
+    fired = 0;
+    Pt::Timespan now = base + Pt::Timespan(1000 * 1000);
+    start = Pt::System::Clock::getMonotonicTime();
+    for(int tick = 0; tick < 1000; ++tick)
+    {
+        queue.processTimers(now);
+        now += Pt::Timespan(1000);
+    }
+    double expireNs = elapsedNs(start, fired);
+
+    std::cout << std::setw(8) << name
+              << std::setw(10) << count
+              << std::setw(14) << std::fixed << std::setprecision(1) << insertNs
+              << std::setw(14) << restartNs
+              << std::setw(14) << expireNs
+              << std::setw(10) << fired << std::endl;
+
+    // remove in expiry order, the sorted queue finds each timer first
+    std::sort(timers.begin(), timers.end(), finishedBefore);
+    for(std::size_t n = 0; n < count; ++n)
+    {
+        queue.removeTimer(*timers[n]);
+        delete timers[n];
+    }
+}
+
+}
+
+
+int main(int argc, char** argv)
+{
+    std::vector<std::size_t> sizes;
+    for(int n = 1; n < argc; ++n)
+        sizes.push_back( std::strtoul(argv[n], 0, 10) );
+
+    if( sizes.empty() )
+    {
+        sizes.push_back(1000);
+        sizes.push_back(100000);
+        sizes.push_back(1000000);
+    }
+
+    std::cout << std::setw(8) << "queue"
+              << std::setw(10) << "timers"
+              << std::setw(14) << "insert ns/op"
+              << std::setw(14) << "restart ns/op"
+              << std::setw(14) << "expire ns/op"
+              << std::setw(10) << "fired" << std::endl;
+
+    for(std::size_t n = 0; n < sizes.size(); ++n)
+    {
+        {
+            Pt::System::SortedTimerQueue queue;
+            run("sorted", queue, sizes[n]);
+        }
+
+        {
+            Pt::System::TimerWheel queue;
+            run("wheel", queue, sizes[n]);
+        }
+    }
+
+    return 0;
+}
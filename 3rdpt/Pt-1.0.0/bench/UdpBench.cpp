@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Sends datagrams over loopback UDP in rounds of a fixed batch size and
+// receives each round before sending the next one, so the socket buffer
+// never overflows. The datagrams are either transferred one by one with
+// write() and read(), or with the batched send() and receive(). Prints
+// thousands of packets per second for both.
+//
+// Usage: UdpBench [packets]
+
+#include <Pt/Net/UdpSocket.h>
+#include <Pt/Net/Endpoint.h>
+#include <Pt/System/Clock.h>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+
+namespace {
+
+double run(std::size_t size, std::size_t batch, std::size_t packets, bool batched)
+{
+    Pt::Net::UdpSocket server;
+    server.bind( Pt::Net::Endpoint::ip4Loopback(0) );
+
+    Pt::Net::Endpoint ep;
+    server.localEndpoint(ep);
+
+    Pt::Net::UdpSocket client;
+    client.setTarget(ep);
+
+    std::vector<char> payload(size, 'p');
+    std::vector<char> buffers(batch * size);
+    std::vector<Pt::Net::Endpoint> sources(batch);
+
+    std::vector<Pt::Net::Datagram> out;
+    std::vector<Pt::Net::Datagram> in;
+    for(std::size_t n = 0; n < batch; ++n)
+    {
+        out.push_back( Pt::Net::Datagram(&payload[0], payload.size()) );
+        in.push_back( Pt::Net::Datagram(&buffers[n * size], size, &sources[n]) );
+    }
+
+    const std::size_t rounds = packets / batch;
+
+    Pt::int64_t start = Pt::System::Clock::getMonotonicTime();
+
+    for(std::size_t r = 0; r < rounds; ++r)
+    {
+        if(batched)
+        {
+            std::size_t sent = 0;
+            while(sent < batch)
+                sent += client.send(&out[sent], batch - sent);
+
+            std::size_t received = 0;
+            while(received < batch)
+                received += server.receive(&in[received], batch - received);
+        }
+        else
+        {
+            for(std::size_t n = 0; n < batch; ++n)
+                client.write(&payload[0], payload.size());
+
+            for(std::size_t n = 0; n < batch; ++n)
+                server.receiveFrom(&buffers[n * size], size, sources[n]);
+        }
+    }
+
+    Pt::int64_t ns = Pt::System::Clock::getMonotonicTime() - start;
+
+    return double(rounds * batch) * 1000000.0 / double(ns);
+}
+
+}
+
+
+int main(int argc, char** argv)
+{
+    std::size_t packets = argc > 1 ? std::strtoul(argv[1], 0, 10) : 1000000;
+
+    const std::size_t sizes[] = { 64, 1200 };
+    const std::size_t batches[] = { 1, 8, 32, 64 };
+
+    std::cout << std::setw(8) << "size"
+              << std::setw(8) << "batch"
+              << std::setw(16) << "single kpps"
+              << std::setw(16) << "batched kpps" << std::endl;
+
+    for(std::size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+    {
+        for(std::size_t b = 0; b < sizeof(batches) / sizeof(batches[0]); ++b)
+        {
+            double single = run(sizes[s], batches[b], packets, false);
+            double batched = run(sizes[s], batches[b], packets, true);
+
+            std::cout << std::setw(8) << sizes[s]
+                      << std::setw(8) << batches[b]
+                      << std::setw(16) << std::fixed << std::setprecision(1) << single
+                      << std::setw(16) << batched << std::endl;
+        }
+    }
+
+    return 0;
+}
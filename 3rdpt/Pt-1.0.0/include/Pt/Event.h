@@ -33,6 +33,7 @@
 #include <Pt/Types.h>
 #include <Pt/Allocator.h>
 #include <typeinfo>
+#include <cstddef>
 
 namespace Pt {
 
@@ -68,6 +69,26 @@ class Event
         const std::type_info& typeInfo() const
         { return onTypeInfo(); }
 
+        /** @brief Returns the type index for this class of events.
+
+            Event types are assigned a process-wide index when they are
+            registered, which is used to dispatch events without a lookup
+            by type info. The index 0 is returned for event types, which
+            are not registered.
+        */
+        std::size_t typeIndex() const
+        { return onTypeIndex(); }
+
+        /** @brief Registers an event type and returns its type index.
+
+            Registering the same type again returns the same index.
+        */
+        PT_API static std::size_t registerType(const std::type_info& ti);
+
+        /** @brief Returns the type index of a registered event type or 0.
+        */
+        PT_API static std::size_t findType(const std::type_info& ti);
+
     protected:
         /** \brief Constructor.
          */
@@ -86,6 +107,14 @@ class Event
         */
         virtual const std::type_info& onTypeInfo() const = 0;
 
+        /** @brief Returns the type index for this class of events.
+
+            The default implementation looks up the type info of the
+            event in the registered types.
+        */
+        virtual std::size_t onTypeIndex() const
+        { return Event::findType( this->typeInfo() ); }
+
     public:
         /** @brief Copies an event using an allocator.
         */
@@ -107,6 +136,20 @@ class Event
         }
 };
 
+/** @brief Type index of an event class.
+
+    The index is registered once, when it is first requested.
+*/
+template <typename EventT>
+struct EventType
+{
+    static std::size_t index()
+    {
+        static const std::size_t idx = Event::registerType( typeid(EventT) );
+        return idx;
+    }
+};
+
 template <typename T>
 class BasicEvent : public Event
 {
@@ -117,6 +160,9 @@ class BasicEvent : public Event
         virtual const std::type_info& onTypeInfo() const
         { return typeid(T); }
 
+        virtual std::size_t onTypeIndex() const
+        { return EventType<T>::index(); }
+
         virtual Event& onClone(Allocator& allocator) const
         {
             void* pEvent = allocator.allocate(sizeof(T));
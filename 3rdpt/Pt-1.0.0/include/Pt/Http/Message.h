@@ -31,6 +31,7 @@
 
 #include <Pt/Http/Api.h>
 #include <Pt/NonCopyable.h>
+#include <Pt/Types.h>
 #include <iostream>
 #include <streambuf>
 #include <string>
@@ -39,13 +40,33 @@
 
 namespace Pt {
 
+namespace System {
+
+class IOBuffer;
+class ChainBuffer;
+
+}
+
 namespace Http {
 
 class Connection;
+class Http2Session;
+
+/** @brief HTTP message header fields.
 
+    The fields are stored one after another in a single block, which is
+    taken from a process-wide pool and grows as fields are added, up to
+    the maximum size. The block is kept when the header is cleared. Field
+    names are indexed by a case-insensitive hash when the fields are
+    added, so lookups do not need to scan all fields. The fields which
+    determine the message framing are resolved directly.
+*/
 class PT_HTTP_API MessageHeader : private Pt::NonCopyable
 {
     public:
+        //! @brief Default maximum size of the header fields in bytes
+        static const std::size_t DefaultMaxSize = 4096;
+
         class Field
         {
             public:
@@ -150,6 +171,21 @@ class PT_HTTP_API MessageHeader : private Pt::NonCopyable
 
         void add(const char* key, const char* value);
 
+        //! @brief Adds a field, the key and value need not be null-terminated
+        void add(const char* key, std::size_t keySize, const char* value, std::size_t valueSize);
+
+        //! @brief Returns the maximum size of the header fields in bytes
+        std::size_t maxSize() const
+        { return _maxSize; }
+
+        /** @brief Sets the maximum size of the header fields in bytes
+
+            Adding a field throws an HttpError, if the fields would not
+            fit anymore. Fields already added are not affected.
+        */
+        void setMaxSize(std::size_t n)
+        { _maxSize = n; }
+
         void remove(const char* key);
 
         const char* get(const char* key) const;
@@ -188,15 +224,52 @@ class PT_HTTP_API MessageHeader : private Pt::NonCopyable
         static char* htdateCurrent(char* buffer);
 
     private:
+        //! @internal Well-known fields with pre-resolved values
+        enum KnownField
+        {
+            ContentLength = 0,
+            TransferEncoding = 1,
+            ConnectionField = 2,
+            KnownFieldCount = 3
+        };
+
+        //! @internal Hash and offset + 1 of an indexed field name
+        struct Slot
+        {
+            Pt::uint32_t hash;
+            Pt::uint32_t offset;
+        };
+
+        static const std::size_t IndexSize = 32;
+        static const std::size_t MaxIndexed = 24;
+
         char* eptr() 
         { return _rawdata + _endOffset; }
 
+        void reserve(std::size_t n);
+
+        const char* find(const char* key, std::size_t n) const;
+
+        const char* known(KnownField f) const
+        { return _known[f] ? _rawdata + _known[f] - 1 : 0; }
+
+        void index(std::size_t offset, std::size_t n);
+
+        void clearIndex();
+
+        void rebuildIndex();
+
     private:
-        static const unsigned MaxHeaderSize = 4096;
-        char _rawdata[MaxHeaderSize];  // key_1\0value_1\0key_2\0value_2\0...key_n\0value_n\0\0
+        char* _rawdata;  // key_1\0value_1\0key_2\0value_2\0...key_n\0value_n\0\0
+        std::size_t _capacity;
+        std::size_t _maxSize;
         std::size_t _endOffset;
         unsigned _httpVersionMajor;
         unsigned _httpVersionMinor;
+        Slot _index[IndexSize];
+        std::size_t _indexed;
+        bool _indexFull;
+        Pt::uint32_t _known[KnownFieldCount];  // value offset + 1
 };
 
 
@@ -275,6 +348,18 @@ class MessageBuffer : public std::streambuf
         const char* data() const
         { return _buffer; }
 
+        //! @internal
+        //! @brief Hands the buffered data over to an I/O buffer.
+        /**
+            The data is queued for output in the I/O buffer without
+            copying it. This message buffer is empty afterwards.
+        */
+        void moveTo(System::IOBuffer& ob);
+
+        //! @internal
+        //! @brief Hands the buffered data over to a chain buffer.
+        void moveTo(System::ChainBuffer& ob);
+
     protected:
         // @internal
         virtual int_type overflow(int_type ch);
@@ -292,6 +377,7 @@ class MessageBuffer : public std::streambuf
 class PT_HTTP_API Message
 {
     friend class Connection;
+    friend class Http2Session;
 
     public:
         explicit Message(Http::Connection& conn);
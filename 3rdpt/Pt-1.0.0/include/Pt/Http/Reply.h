@@ -32,15 +32,23 @@
 #include <Pt/Http/Api.h>
 #include <Pt/Http/Message.h>
 #include <Pt/Signal.h>
+#include <Pt/Types.h>
 #include <string>
 
 namespace Pt {
 
+namespace System {
+
+class FileDevice;
+
+}
+
 namespace Http {
 
 class PT_HTTP_API Reply : public Message
 {
     friend class Connection;
+    friend class Http2Session;
 
     public:
         enum StatusCode
@@ -59,6 +67,9 @@ class PT_HTTP_API Reply : public Message
         : Message(conn)
         , _statusCode(200)
         , _statusText("OK")
+        , _file(0)
+        , _fileOffset(0)
+        , _fileSize(0)
         { }
         
         void setStatus(unsigned code, const std::string& txt)
@@ -79,6 +90,36 @@ class PT_HTTP_API Reply : public Message
         const std::string& statusText() const
         { return _statusText; }
 
+        /** @brief Sends a part of a file as the body of the reply.
+
+            The \a length bytes of the \a file at \a offset are sent
+            after the data written to the body. Unless the connection is
+            encrypted, the file is sent without copying it to user space.
+            The reply must be finished by the first call to beginSend()
+            and the file must stay open until the reply was sent.
+        */
+        void setFile(System::FileDevice& file, Pt::uint64_t offset, Pt::uint64_t length)
+        {
+            _file = &file;
+            _fileOffset = offset;
+            _fileSize = length;
+        }
+
+        //! @brief Sends the file from the current position to the end.
+        void setFile(System::FileDevice& file);
+
+        //! @brief Returns the file sent as body or a null pointer.
+        System::FileDevice* file() const
+        { return _file; }
+
+        //! @brief Returns the offset of the data sent from the file.
+        Pt::uint64_t fileOffset() const
+        { return _fileOffset; }
+
+        //! @brief Returns the number of bytes sent from the file.
+        Pt::uint64_t fileSize() const
+        { return _fileSize; }
+
         void receive();
 
         void beginReceive();
@@ -109,6 +150,9 @@ class PT_HTTP_API Reply : public Message
         std::string _statusText;
         Signal<Reply&> _inputReceived;
         Signal<Reply&> _outputSent;
+        System::FileDevice* _file;
+        Pt::uint64_t _fileOffset;
+        Pt::uint64_t _fileSize;
 };
 
 } // namespace Http
@@ -33,6 +33,8 @@
 #include <Pt/Http/Message.h>
 #include <Pt/Signal.h>
 #include <string>
+#include <vector>
+#include <utility>
 
 namespace Pt {
 
@@ -41,6 +43,7 @@ namespace Http {
 class PT_HTTP_API Request : public Message
 {
     friend class Connection;
+    friend class Http2Session;
 
     public:
         explicit Request(Http::Connection& conn)
@@ -70,6 +73,9 @@ class PT_HTTP_API Request : public Message
         void setUrl(const char* u)
         { _url = u; }
 
+        void setUrl(const char* u, std::size_t n)
+        { _url.assign(u, n); }
+
         const std::string& method() const
         { return _method; }
         
@@ -79,6 +85,9 @@ class PT_HTTP_API Request : public Message
         void setMethod(const char* m)
         { _method = m; }
 
+        void setMethod(const char* m, std::size_t n)
+        { _method.assign(m, n); }
+
         const std::string& qparams() const
         { return _qparams; }
 
@@ -88,6 +97,21 @@ class PT_HTTP_API Request : public Message
         void setQParams(const char* p)
         { _qparams = p; }
 
+        void setQParams(const char* p, std::size_t n)
+        { _qparams.assign(p, n); }
+
+        /** @brief Returns a parameter of the route of the servlet.
+
+            The parameters are set, when the request is routed to a
+            servlet with a pattern such as "/player/{id}/inventory".
+            An empty string is returned, if the parameter is not set.
+        */
+        const std::string& pathParam(const std::string& name) const;
+
+        void setPathParam(const std::string& name, const std::string& value);
+
+        void setPathParam(const std::string& name, const char* value, std::size_t n);
+
         void beginReceive();
 
         MessageProgress endReceive();
@@ -117,6 +141,7 @@ class PT_HTTP_API Request : public Message
         std::string _url;
         std::string _method;
         std::string _qparams;
+        std::vector< std::pair<std::string, std::string> > _pathParams;
         Signal<Request&> _inputReceived;
         Signal<Request&> _outputSent;
 };
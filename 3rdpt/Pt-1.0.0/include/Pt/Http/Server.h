@@ -73,6 +73,12 @@ class PT_HTTP_API Server : public Connectable
 
         void setTimeout(std::size_t ms);
 
+        /** @brief Serves connections over SSL
+
+            Clients negotiate HTTP/2 over SSL, if "h2" was added as an
+            application protocol to the context \a ctx. All other
+            clients are served with HTTP/1.x.
+        */
         void setSecure(Ssl::Context& ctx);
 
         std::size_t maxThreads() const;
@@ -87,8 +93,59 @@ class PT_HTTP_API Server : public Connectable
 
         void setMaxRequestSize(std::size_t maxSize);
 
+        //! @brief Returns the maximum size of the request header fields
+        std::size_t maxHeaderSize() const;
+
+        //! @brief Sets the maximum size of the request header fields
+        void setMaxHeaderSize(std::size_t maxSize);
+
+        //! @brief Returns the maximum number of pipelined requests in flight
+        std::size_t maxPipelined() const;
+
+        /** @brief Sets the maximum number of pipelined requests in flight
+
+            Requests, which a client sends without waiting for the replies,
+            are read from the same input and answered in order. The replies
+            are collected and written together in a single vectored write
+            when no further complete request is buffered, when \a n replies
+            or 64 KB of reply data are pending. A value of 1 writes each
+            reply before the next request is read.
+        */
+        void setMaxPipelined(std::size_t n);
+
+        //! @brief Returns true if TCP_NODELAY is set on accepted connections
+        bool noDelay() const;
+
+        /** @brief Sets TCP_NODELAY on accepted connections
+
+            Enabled by default, so that a batch of replies is not delayed
+            until the previous one was acknowledged. Disabling it lets the
+            kernel coalesce small writes of clients which do not pipeline.
+        */
+        void setNoDelay(bool noDelay);
+
+        //! @brief Returns the maximum number of concurrent HTTP/2 streams
+        std::size_t maxConcurrentStreams() const;
+
+        /** @brief Sets the maximum number of concurrent HTTP/2 streams
+
+            The limit is announced to HTTP/2 clients, which must not open
+            more than \a n streams at the same time. Each stream is served
+            by its own responder.
+        */
+        void setMaxConcurrentStreams(std::size_t n);
+
         void listen(const Net::Endpoint& ep);
 
+        /** @brief Listens on an address with options
+
+            With more than one thread, connections are accepted by the
+            loop of the server and passed to the worker threads. If the
+            reuse port option is set in \a opts, each worker listens on
+            the address of the server instead and accepts connections by
+            itself. The worker loops are created with the options of the
+            server loop, if it is a System::MainLoop.
+        */
         void listen(const Net::Endpoint& ep, const Net::TcpServerOptions& opts);
 
         void cancel();
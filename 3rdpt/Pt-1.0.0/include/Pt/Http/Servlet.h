@@ -48,6 +48,9 @@ class PT_HTTP_API Servlet : private NonCopyable
     // @internal
     friend class Server;
 
+    // @internal
+    friend class RouteTable;
+
     public:
         Servlet(Service& s);
 
@@ -75,6 +78,34 @@ class PT_HTTP_API Servlet : private NonCopyable
         */
         virtual bool onRequest(const Request& request) const = 0;
 
+        /** @brief Routes requests for a URL to the servlet.
+
+            The server finds the servlet by a hash of the URL instead of
+            calling onRequest(). If a method is given, only requests with
+            this method are routed. The route must be set before the
+            servlet is added to a server. Classes derived from MapUrl or
+            MapRoute are not routed, because they might override
+            onRequest().
+        */
+        void setUrlRoute(const std::string& url,
+                         const std::string& method = std::string());
+
+        /** @brief Routes requests matching a pattern to the servlet.
+
+            A segment of the pattern in braces, such as "{id}" in
+            "/player/{id}/inventory", matches any non-empty path segment,
+            which is then available as Request::pathParam(). A trailing
+            "*" matches the rest of the path. If a method is given, only
+            requests with this method are routed. The route must be set
+            before the servlet is added to a server. A malformed pattern
+            throws a std::invalid_argument.
+        */
+        void setPatternRoute(const std::string& pattern,
+                             const std::string& method = std::string());
+
+        //! @brief Returns true if the request matches the route.
+        bool matchesRoute(const Request& request) const;
+
     private:
         // @internal
         void registerServer(Server& server);
@@ -83,24 +114,39 @@ class PT_HTTP_API Servlet : private NonCopyable
         void unregisterServer(Server& server);
 
     private:
+        enum RouteType
+        {
+            NoRoute,
+            UrlRoute,
+            PatternRoute
+        };
+
         Server* _server;
         Service* _service;
         Authorizer* _auth;
+        RouteType _routeType;
+        std::string _route;
+        std::string _routeMethod;
 };
 
 
+/** @brief Servlet for a URL.
+
+    Requests for the URL are found by a hash of the URL. A class derived
+    from MapUrl is asked by onRequest() instead, so it can override it.
+*/
 class PT_HTTP_API MapUrl : public Servlet
 {
     public:
         MapUrl(const std::string& url, Service& s)
         : Servlet(s)
         , _url(url)
-        {}
+        { setUrlRoute(url); }
 
         MapUrl(const std::string& url, Service& s, Authorizer& a)
         : Servlet(s, a)
         , _url(url)
-        {}
+        { setUrlRoute(url); }
 
     protected:
         bool onRequest(const Request& request) const;
@@ -110,6 +156,38 @@ class PT_HTTP_API MapUrl : public Servlet
 };
 
 
+/** @brief Servlet for a route pattern.
+
+    The pattern may contain parameters, such as "/player/{id}/inventory",
+    and a trailing "*". If a method is given, only requests with this
+    method are processed. See Servlet::setPatternRoute(). Like for
+    MapUrl, a derived class is asked by onRequest() instead.
+*/
+class PT_HTTP_API MapRoute : public Servlet
+{
+    public:
+        MapRoute(const std::string& pattern, Service& s)
+        : Servlet(s)
+        { setPatternRoute(pattern); }
+
+        MapRoute(const std::string& pattern, Service& s, Authorizer& a)
+        : Servlet(s, a)
+        { setPatternRoute(pattern); }
+
+        MapRoute(const std::string& method, const std::string& pattern, Service& s)
+        : Servlet(s)
+        { setPatternRoute(pattern, method); }
+
+        MapRoute(const std::string& method, const std::string& pattern,
+                 Service& s, Authorizer& a)
+        : Servlet(s, a)
+        { setPatternRoute(pattern, method); }
+
+    protected:
+        bool onRequest(const Request& request) const;
+};
+
+
 class PT_HTTP_API MapAny : public Servlet
 {
     public:
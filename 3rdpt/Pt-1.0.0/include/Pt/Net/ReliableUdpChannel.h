@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2005-2013 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef Pt_Net_ReliableUdpChannel_h
+#define Pt_Net_ReliableUdpChannel_h
+
+#include <Pt/Net/Api.h>
+#include <Pt/Net/Endpoint.h>
+#include <Pt/Signal.h>
+#include <Pt/NonCopyable.h>
+#include <string>
+#include <cstddef>
+
+namespace Pt {
+
+namespace System {
+
+class EventLoop;
+
+}
+
+namespace Net {
+
+class UdpSocket;
+class ReliableUdpChannelImpl;
+
+/** @brief Message channel with selectable reliability over UDP.
+
+    The %ReliableUdpChannel exchanges messages with a single peer over
+    one UDP socket. The messages are sent on lanes, each of which has its
+    own delivery guarantee, so that losing an unreliable state update does
+    not delay a reliable chat message and the other way round. Both peers
+    must add the same lanes in the same order:
+
+    - ReliableOrdered lanes deliver every message once, in the order sent.
+    - ReliableUnordered lanes deliver every message once, as it arrives.
+    - UnreliableSequenced lanes drop lost messages and those older than
+      the last delivered message.
+
+    Messages of several lanes are packed into packets of at most
+    maxPacketSize() bytes. Every packet acknowledges the recently received
+    packets of the peer, from which the channel measures the round trip
+    time and detects losses. Lost reliable messages are sent again in new
+    packets. Reliable messages larger than a packet are fragmented and
+    reassembled. The amount of data in flight is limited by a congestion
+    window, which is halved on loss, and packets are paced across the
+    round trip time instead of sent in bursts.
+
+    The channel does all its work in update(), which is called in regular
+    intervals by a timer when the channel is active in an event loop. It
+    can also be called manually, for example once per simulation tick.
+    Messages passed to send() are transmitted by the next update and
+    received messages are reported by the inputReady signal:
+
+    @code
+    Pt::Net::ReliableUdpChannel channel;
+    std::size_t chat = channel.addLane(Pt::Net::ReliableUdpChannel::ReliableOrdered);
+    std::size_t state = channel.addLane(Pt::Net::ReliableUdpChannel::UnreliableSequenced);
+
+    channel.open(Pt::Net::Endpoint("0.0.0.0", 4000), Pt::Net::Endpoint("192.168.1.10", 4000));
+    channel.inputReady() += Pt::slot(onInput);
+    channel.setActive(loop);
+
+    channel.send(chat, "hello", 5);
+    @endcode
+*/
+class PT_NET_API ReliableUdpChannel : private NonCopyable
+{
+    public:
+        //! @brief Delivery guarantee of a lane
+        enum Delivery
+        {
+            //! Every message is delivered once and in order
+            ReliableOrdered = 0,
+            //! Every message is delivered once in any order
+            ReliableUnordered = 1,
+            //! Only messages newer than the last delivered one
+            UnreliableSequenced = 2
+        };
+
+        //! @brief Maximum number of lanes
+        static const std::size_t MaxLanes = 255;
+
+    public:
+        //! @brief Constructs a closed channel
+        ReliableUdpChannel();
+
+        //! @brief Destructor
+        ~ReliableUdpChannel();
+
+        /** @brief Adds a lane and returns its index
+
+            Lanes must be added before the channel is opened and both
+            peers must use the same lanes.
+        */
+        std::size_t addLane(Delivery delivery);
+
+        //! @brief Returns the number of lanes
+        std::size_t laneCount() const;
+
+        /** @brief Opens the channel
+
+            Binds the socket of the channel to \a local and connects it to
+            \a peer, so that only datagrams of the peer are received.
+        */
+        void open(const Endpoint& local, const Endpoint& peer);
+
+        //! @brief Closes the channel and discards all messages
+        void close();
+
+        //! @brief Returns true if the channel is open
+        bool isOpen() const;
+
+        /** @brief Sets the event loop which updates the channel
+
+            A timer of the event loop calls update() every tickInterval()
+            milliseconds.
+        */
+        void setActive(System::EventLoop& loop);
+
+        //! @brief Detaches the channel from its event loop
+        void detach();
+
+        //! @brief Returns the interval of the update timer in milliseconds
+        std::size_t tickInterval() const;
+
+        //! @brief Sets the interval of the update timer in milliseconds
+        void setTickInterval(std::size_t msecs);
+
+        //! @brief Returns the maximum size of the packets in bytes
+        std::size_t maxPacketSize() const;
+
+        /** @brief Sets the maximum size of the packets in bytes
+
+            The default of 1200 bytes fits into the MTU of most paths.
+            It must be the same for both peers and can only be changed
+            while the channel is closed.
+        */
+        void setMaxPacketSize(std::size_t n);
+
+        //! @brief Returns the timeout for an inactive peer in milliseconds
+        std::size_t timeout() const;
+
+        //! @brief Sets the timeout for an inactive peer in milliseconds
+        void setTimeout(std::size_t msecs);
+
+        /** @brief Queues a message on a lane
+
+            Messages on reliable lanes are copied and kept until they
+            are acknowledged. Messages on unreliable lanes are sent by
+            the next update, if the congestion window allows it, and
+            discarded otherwise. Only reliable messages can be larger
+            than a packet.
+
+            \throw std::logic_error, std::out_of_range, std::length_error
+        */
+        void send(std::size_t lane, const char* data, std::size_t n);
+
+        /** @brief Takes the next received message
+
+            Returns false if no message is available. Otherwise the
+            message is assigned to \a data and its lane to \a lane.
+        */
+        bool receive(std::string& data, std::size_t& lane);
+
+        /** @brief Receives and sends pending packets
+
+            Receives all available packets, detects lost packets,
+            sends queued messages within the limits of the congestion
+            control and sends acknowledgements and keep-alives.
+        */
+        void update();
+
+        //! @brief Returns the smoothed round trip time in microseconds
+        Pt::int64_t roundTripTime() const;
+
+        //! @brief Returns the congestion window in bytes
+        std::size_t congestionWindow() const;
+
+        //! @brief Returns the number of bytes sent but not acknowledged
+        std::size_t bytesInFlight() const;
+
+        //! @brief Returns the number of packets detected as lost
+        Pt::uint64_t packetsLost() const;
+
+        //! @brief Returns the socket of the channel
+        UdpSocket& socket();
+
+        //! @brief Sent by update() when messages were received
+        Signal<ReliableUdpChannel&>& inputReady()
+        { return _inputReady; }
+
+        //! @brief Sent by update() once when the peer timed out
+        Signal<ReliableUdpChannel&>& timedOut()
+        { return _timedOut; }
+
+    private:
+        //! @internal
+        ReliableUdpChannelImpl* _impl;
+
+        //! @internal
+        Signal<ReliableUdpChannel&> _inputReady;
+
+        //! @internal
+        Signal<ReliableUdpChannel&> _timedOut;
+};
+
+} // namespace Net
+
+} // namespace Pt
+
+#endif // Pt_Net_ReliableUdpChannel_h
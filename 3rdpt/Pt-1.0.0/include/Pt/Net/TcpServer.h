@@ -33,6 +33,7 @@
 #include <Pt/System/Selectable.h>
 #include <Pt/Signal.h>
 #include <Pt/Types.h>
+#include <cstddef>
 
 namespace Pt {
 
@@ -43,7 +44,11 @@ namespace Net {
 class PT_NET_API TcpServerOptions
 {
     public:
-        TcpServerOptions(int backlog = 5);
+        /** @brief Constructs the options with a backlog.
+
+            A negative backlog selects the maximum of the system.
+        */
+        TcpServerOptions(int backlog = -1);
 
         TcpServerOptions(const TcpServerOptions& opts);
 
@@ -57,16 +62,101 @@ class PT_NET_API TcpServerOptions
         void setDeferAccept(int n)
         { _deferAccept = n; }
 
+        //! @brief Returns the length of the queue of pending connections.
         int backlog() const
         { return _backlog; }
 
+        /** @brief Sets the length of the queue of pending connections.
+
+            Connections beyond the backlog are refused or retried by the
+            clients, so servers which must accept many connections at once,
+            for example after a restart, need a large backlog. A negative
+            value selects the maximum of the system, which is the default.
+        */
         void setBacklog(int backlog)
         { _backlog = backlog; }
 
+        //! @brief Returns the maximum number of connections accepted at once.
+        std::size_t acceptBatch() const
+        { return _acceptBatch; }
+
+        /** @brief Sets the maximum number of connections accepted at once.
+
+            When the server becomes ready, up to \a n pending connections
+            are accepted and queued, which are then passed to the sockets
+            that accept from the server without waiting again. The default
+            is 32.
+        */
+        void setAcceptBatch(std::size_t n)
+        { _acceptBatch = n > 0 ? n : 1; }
+
+        //! @brief Returns the size of the send buffer in bytes.
+        int sendBufferSize() const
+        { return _sndbufSize; }
+
+        /** @brief Sets the send buffer size of accepted sockets (SO_SNDBUF).
+
+            The size is set on the listening socket and inherited by the
+            accepted connections. A size of 0 keeps the system default.
+        */
+        void setSendBufferSize(int n)
+        { _sndbufSize = n; }
+
+        //! @brief Returns the size of the receive buffer in bytes.
+        int receiveBufferSize() const
+        { return _rcvbufSize; }
+
+        /** @brief Sets the receive buffer size of accepted sockets (SO_RCVBUF).
+
+            The size must be set before listening to take effect on the
+            window scaling of the connections. A size of 0 keeps the system
+            default.
+        */
+        void setReceiveBufferSize(int n)
+        { _rcvbufSize = n; }
+
+        //! @brief Returns the CPU of the connections accepted by the server.
+        int incomingCpu() const
+        { return _incomingCpu; }
+
+        /** @brief Accepts only connections processed on a CPU (SO_INCOMING_CPU).
+
+            Together with reusePort(), servers running in threads bound to
+            different CPUs receive the connections processed by their CPU.
+            A negative value, which is the default, accepts connections
+            from all CPUs. Ignored if not supported.
+        */
+        void setIncomingCpu(int cpu)
+        { _incomingCpu = cpu; }
+
+        //! @brief Returns true if the address can be shared with other servers.
+        bool reusePort() const
+        { return (_flags & ReusePort) != 0; }
+
+        /** @brief Allows other servers to listen on the same address.
+
+            Each server gets its own accept queue and the kernel spreads
+            incoming connections across the servers. This is used to
+            accept connections in several threads in parallel. The
+            option is ignored, if the platform does not support it.
+        */
+        void setReusePort()
+        { _flags |= ReusePort; }
+
     private:
+        //! @internal
+        enum Flags
+        {
+            ReusePort = 1
+        };
+
         Pt::uint32_t _flags;
         int _backlog;
         int _deferAccept;
+        std::size_t _acceptBatch;
+        int _sndbufSize;
+        int _rcvbufSize;
+        int _incomingCpu;
         varint_t _r0;
         varint_t _r1;
         varint_t _r2;
@@ -97,6 +187,14 @@ class PT_NET_API TcpServer : public System::Selectable
         
         void close();
 
+        /** @brief Returns the address the server is bound to.
+
+            If the server listens on port 0, the returned endpoint has the
+            port chosen by the system. The endpoint is cleared if the
+            server does not listen.
+        */
+        void localEndpoint(Endpoint& ep) const;
+
         Signal<TcpServer&>& connectionPending()
         { return _connectionPending; }
 
@@ -32,6 +32,7 @@
 #include <Pt/Net/Api.h>
 #include <Pt/Net/Endpoint.h>
 #include <Pt/System/IODevice.h>
+#include <Pt/System/FileDevice.h>
 #include <Pt/Types.h>
 #include <cstddef>
 
@@ -39,11 +40,11 @@ namespace Pt {
 
 namespace Net {
 
-// TCP_NODELAY
-// SO_KEEPALIVE
-// SO_SNDBUF 
-
 /** @brief TCP socket options.
+
+    The options are applied when a socket is connected or accepted.
+    Sizes and counts of 0 and a negative CPU keep the defaults of the
+    system. Options which are not supported by the platform are ignored.
  */
 class PT_NET_API TcpSocketOptions
 {
@@ -56,15 +57,193 @@ class PT_NET_API TcpSocketOptions
 
         TcpSocketOptions& operator=(const TcpSocketOptions& opts);
 
+        //! @brief Returns true if small segments are sent without delay.
+        bool isNoDelay() const
+        { return (_flags & NoDelay) != 0; }
+
+        /** @brief Disables the Nagle algorithm (TCP_NODELAY).
+
+            Small segments are sent immediately instead of being
+            coalesced until previous data is acknowledged.
+        */
+        void setNoDelay()
+        { _flags |= NoDelay; }
+
+        //! @brief Returns true if acknowledgements are sent immediately.
+        bool isQuickAck() const
+        { return (_flags & QuickAck) != 0; }
+
+        /** @brief Sends acknowledgements immediately (TCP_QUICKACK).
+
+            The system may return to delayed acknowledgements later, so
+            latency sensitive applications should also use
+            TcpSocket::setQuickAck() after reading.
+        */
+        void setQuickAck()
+        { _flags |= QuickAck; }
+
+        //! @brief Returns true if partial segments are held back.
+        bool isCork() const
+        { return (_flags & Cork) != 0; }
+
+        /** @brief Holds back partial segments (TCP_CORK).
+
+            Output is only sent in full segments until the socket is
+            uncorked with TcpSocket::setCork().
+        */
+        void setCork()
+        { _flags |= Cork; }
+
+        //! @brief Returns the size of the send buffer in bytes.
+        int sendBufferSize() const
+        { return _sndbufSize; }
+
+        //! @brief Sets the size of the send buffer in bytes (SO_SNDBUF).
+        void setSendBufferSize(int n)
+        { _sndbufSize = n; }
+
+        //! @brief Returns the size of the receive buffer in bytes.
+        int receiveBufferSize() const
+        { return _rcvbufSize; }
+
+        //! @brief Sets the size of the receive buffer in bytes (SO_RCVBUF).
+        void setReceiveBufferSize(int n)
+        { _rcvbufSize = n; }
+
+        //! @brief Returns the busy polling time in microseconds.
+        int busyPoll() const
+        { return _busyPoll; }
+
+        /** @brief Sets the busy polling time in microseconds (SO_BUSY_POLL).
+
+            Blocking receives poll the device queue for up to \a usecs
+            before they wait for an interrupt. Raising the time above the
+            system default may require privileges.
+        */
+        void setBusyPoll(int usecs)
+        { _busyPoll = usecs; }
+
+        //! @brief Returns the limit of unsent bytes in the send buffer.
+        int notSentLowWatermark() const
+        { return _notSentLowat; }
+
+        /** @brief Sets the limit of unsent bytes (TCP_NOTSENT_LOWAT).
+
+            The socket is only reported writable if fewer than \a n bytes
+            are queued, but not yet sent. This keeps the send buffer short,
+            so that new data is not delayed by stale data.
+        */
+        void setNotSentLowWatermark(int n)
+        { _notSentLowat = n; }
+
+        //! @brief Returns the CPU which should process incoming packets.
+        int incomingCpu() const
+        { return _incomingCpu; }
+
+        //! @brief Sets the CPU which should process incoming packets (SO_INCOMING_CPU).
+        void setIncomingCpu(int cpu)
+        { _incomingCpu = cpu; }
+
+        //! @brief Returns true if keepalive probes are sent.
+        bool isKeepAlive() const
+        { return (_flags & KeepAlive) != 0; }
+
+        /** @brief Sends keepalive probes on idle connections (SO_KEEPALIVE).
+
+            The first probe is sent after \a idle seconds without traffic,
+            following probes every \a interval seconds. The connection is
+            dropped after \a count unanswered probes.
+        */
+        void setKeepAlive(int idle = 0, int interval = 0, int count = 0)
+        {
+            _flags |= KeepAlive;
+            _keepIdle = idle;
+            _keepInterval = interval;
+            _keepCount = count;
+        }
+
+        //! @brief Returns the idle time before keepalive probes in seconds.
+        int keepAliveIdle() const
+        { return _keepIdle; }
+
+        //! @brief Returns the interval of keepalive probes in seconds.
+        int keepAliveInterval() const
+        { return _keepInterval; }
+
+        //! @brief Returns the number of unanswered keepalive probes.
+        int keepAliveCount() const
+        { return _keepCount; }
+
     private:
+        //! @internal
+        enum Flags
+        {
+            NoDelay = 1,
+            QuickAck = 2,
+            Cork = 4,
+            KeepAlive = 8
+        };
+
         Pt::uint32_t _flags;
         int _sndbufSize;
+        int _rcvbufSize;
+        int _busyPoll;
+        int _notSentLowat;
+        int _incomingCpu;
+        int _keepIdle;
+        int _keepInterval;
+        int _keepCount;
         varint_t _r0;
         varint_t _r1;
         varint_t _r2;
 };
 
 
+/** @brief State of a TCP connection.
+
+    Reported by TcpSocket::tcpInfo() from the statistics the system keeps
+    for each connection (TCP_INFO). Values which are not available on the
+    platform are 0.
+*/
+struct TcpInfo
+{
+    TcpInfo()
+    : rtt(0)
+    , rttVariance(0)
+    , congestionWindow(0)
+    , slowStartThreshold(0)
+    , mss(0)
+    , unacked(0)
+    , lost(0)
+    , retransmits(0)
+    { }
+
+    //! @brief Smoothed round trip time in microseconds
+    Pt::uint32_t rtt;
+
+    //! @brief Variance of the round trip time in microseconds
+    Pt::uint32_t rttVariance;
+
+    //! @brief Congestion window in segments
+    Pt::uint32_t congestionWindow;
+
+    //! @brief Slow start threshold in segments
+    Pt::uint32_t slowStartThreshold;
+
+    //! @brief Maximum segment size in bytes
+    Pt::uint32_t mss;
+
+    //! @brief Number of unacknowledged segments
+    Pt::uint32_t unacked;
+
+    //! @brief Number of segments considered lost
+    Pt::uint32_t lost;
+
+    //! @brief Total number of retransmitted segments
+    Pt::uint32_t retransmits;
+};
+
+
 /** @brief TCP client socket.
  */
 class PT_NET_API TcpSocket : public System::IODevice
@@ -118,6 +297,80 @@ class PT_NET_API TcpSocket : public System::IODevice
 
         void remoteEndpoint(Endpoint& ep) const;
 
+        /** @brief Begins to send a part of a file.
+
+            Sends up to \a length bytes of the \a file, starting at
+            \a offset, without copying the data to user space where the
+            system supports it. The operation is completed like a write
+            with endWrite(), which returns the number of bytes sent, so
+            further calls may be needed to send the remaining data. The
+            file must stay open until the operation is completed and
+            wbuf() does not point to data in the meantime.
+
+            On Linux the data is sent with sendfile(), or with splice() if
+            the file is a pipe. If the pipe is empty, the operation waits
+            until it has data, so the pipe must not be read by the event
+            loop in the meantime. Other systems read the file into a
+            buffer, which requires a regular file.
+
+            @throw System::IOError, System::IOPending
+        */
+        void beginSendFile(System::FileDevice& file, Pt::uint64_t offset, std::size_t length);
+
+        /** @brief Sends a part of a file.
+
+            Blocks until a part of the \a length bytes of the \a file at
+            \a offset is sent and returns the number of bytes sent.
+
+            @throw System::IOError, System::IOPending
+        */
+        std::size_t sendFile(System::FileDevice& file, Pt::uint64_t offset, std::size_t length);
+
+        /** @brief Enables or disables the Nagle algorithm.
+
+            @throw System::SystemError if the option can not be set
+        */
+        void setNoDelay(bool on);
+
+        /** @brief Corks or uncorks the socket.
+
+            While corked, only full segments are sent. Uncorking sends the
+            remaining partial segment. This allows to send a response in
+            several writes, but in as few packets as possible. Ignored if
+            not supported.
+
+            @throw System::SystemError if the option can not be set
+        */
+        void setCork(bool on);
+
+        /** @brief Enables or disables immediate acknowledgements.
+
+            The system may return to delayed acknowledgements on its own,
+            so this is typically called again after each read. Ignored if
+            not supported.
+
+            @throw System::SystemError if the option can not be set
+        */
+        void setQuickAck(bool on);
+
+        /** @brief Reads back the options of the socket.
+
+            Assigns the options the system reports for the open socket to
+            \a o. Options the platform does not report keep their
+            defaults. The buffer sizes are reported as the system uses
+            them, which might differ from the requested sizes.
+
+            @throw System::SystemError if the options can not be read
+        */
+        void options(TcpSocketOptions& o) const;
+
+        /** @brief Reports the state of the connection.
+
+            Returns false if the socket is not connected or the platform
+            does not report the state of connections.
+        */
+        bool tcpInfo(TcpInfo& info) const;
+
     protected:
         // inherit doc
         virtual void onClose();
@@ -146,6 +399,24 @@ class PT_NET_API TcpSocket : public System::IODevice
         // inherit doc
         virtual std::size_t onWrite(const char* buffer, std::size_t count);
 
+        // inherit doc
+        virtual std::size_t onBeginReadv(System::EventLoop& loop, System::IOVec* vec, std::size_t count, bool& eof);
+
+        // inherit doc
+        virtual std::size_t onEndReadv(System::EventLoop& loop, System::IOVec* vec, std::size_t count, bool& eof);
+
+        // inherit doc
+        virtual std::size_t onReadv(System::IOVec* vec, std::size_t count, bool& eof);
+
+        // inherit doc
+        virtual std::size_t onBeginWritev(System::EventLoop& loop, const System::IOVec* vec, std::size_t count);
+
+        // inherit doc
+        virtual std::size_t onEndWritev(System::EventLoop& loop, const System::IOVec* vec, std::size_t count);
+
+        // inherit doc
+        virtual std::size_t onWritev(const System::IOVec* vec, std::size_t count);
+
         // inherit doc
         virtual void onCancel();
 
@@ -161,6 +432,12 @@ class PT_NET_API TcpSocket : public System::IODevice
 
         //! @internal
         bool _isConnected;
+
+        //! @internal
+        System::FileDevice* _sendFile;
+
+        //! @internal
+        Pt::uint64_t _sendFileOffset;
 };
 
 } // namespace Net
@@ -64,11 +64,32 @@ class PT_NET_API UdpSocketOptions
         void setHopLimit(int n)
         { _hoplimit = n; }
 
+        /** @brief Returns true if received datagrams may be coalesced.
+        */
+        bool isReceiveOffload() const
+        { return (_flags & ReceiveOffload) != 0; }
+
+        /** @brief Enables coalescing of received datagrams.
+
+            If the system supports generic receive offload (UDP_GRO),
+            consecutive datagrams of the same size from the same source
+            may be received in one buffer by UdpSocket::receive(), which
+            reports the size of the segments. Ignored if not supported.
+
+            Coalesced data can be up to 64KB in size, so the receive
+            buffers should be at least 65535 bytes large. Data that does
+            not fit into a smaller buffer is cut off and the datagram is
+            marked as truncated.
+        */
+        void setReceiveOffload()
+        { _flags |= ReceiveOffload; }
+
     private:
         //! @internal
         enum Flags
         { 
-            Broadcast = 1
+            Broadcast = 1,
+            ReceiveOffload = 2
         };
 
         Pt::uint32_t _flags;
@@ -79,6 +100,63 @@ class PT_NET_API UdpSocketOptions
 };
 
 
+/** @brief Datagram of a batched UDP operation.
+
+    Describes one element of the batches passed to UdpSocket::receive()
+    and UdpSocket::send(). When receiving, \a data points to a buffer of
+    \a size bytes, which is filled with \a received bytes and the source
+    is stored in \a endpoint, if it is not null. When sending, \a size
+    bytes of \a data are sent to \a endpoint, or to the target of the
+    socket if \a endpoint is null.
+
+    A \a segmentSize other than 0 means that the data consists of several
+    datagrams of this size, except for the last one, which may be smaller.
+    Such data is sent with one system call if the system supports generic
+    segmentation offload (UDP_SEGMENT), and as separate datagrams otherwise.
+    Received data is only coalesced if receive offload was enabled in the
+    UdpSocketOptions. A received datagram which was larger than the buffer
+    is cut off to \a size bytes and marked as \a truncated.
+*/
+struct Datagram
+{
+    Datagram()
+    : data(0)
+    , size(0)
+    , received(0)
+    , segmentSize(0)
+    , endpoint(0)
+    , truncated(false)
+    { }
+
+    Datagram(char* d, std::size_t n, Endpoint* ep = 0)
+    : data(d)
+    , size(n)
+    , received(0)
+    , segmentSize(0)
+    , endpoint(ep)
+    , truncated(false)
+    { }
+
+    //! @brief Payload buffer
+    char* data;
+
+    //! @brief Size of the payload or of the receive buffer
+    std::size_t size;
+
+    //! @brief Number of received bytes
+    std::size_t received;
+
+    //! @brief Size of coalesced segments or 0
+    std::size_t segmentSize;
+
+    //! @brief Source or destination, may be null
+    Endpoint* endpoint;
+
+    //! @brief True if the received datagram did not fit into the buffer
+    bool truncated;
+};
+
+
 /** @brief UDP server and client socket.
  */
 class PT_NET_API UdpSocket : public System::IODevice
@@ -132,6 +210,67 @@ class PT_NET_API UdpSocket : public System::IODevice
 
         const Endpoint& remoteEndpoint() const;
 
+        /** @brief Sends a datagram to an endpoint.
+
+            Sends \a n bytes of \a buffer to \a ep, without changing the
+            target of the socket. This allows a server to answer many
+            peers on one socket without calling setTarget() for each
+            datagram. Endpoints with a numeric address or obtained by
+            receiveFrom() are stored in resolved form and are sent to
+            without a lookup. Returns the number of bytes sent.
+
+            \throw IOError, IOPending
+        */
+        std::size_t sendTo(const Endpoint& ep, const char* buffer, std::size_t n);
+
+        /** @brief Begins to send a datagram to an endpoint.
+
+            Like beginWrite(), but sends the datagram to \a ep instead of
+            the target of the socket. The outputReady signal is sent when
+            the operation has completed and endWrite() must be called.
+
+            \throw IOError, IOPending
+        */
+        void beginSendTo(const Endpoint& ep, const char* buffer, std::size_t n);
+
+        /** @brief Receives a datagram and its source.
+
+            Reads a datagram into \a buffer like read() and assigns its
+            source to \a from. The endpoint is assigned in place, so a
+            caller reusing the same endpoint causes no allocation. After
+            an asynchronous read, the source is available from
+            remoteEndpoint(). Returns the number of bytes received.
+
+            \throw IOError, IOPending
+        */
+        std::size_t receiveFrom(char* buffer, std::size_t n, Endpoint& from);
+
+        /** @brief Receives a batch of datagrams.
+
+            Receives up to \a count datagrams that are available without
+            waiting and returns the number of datagrams received, which
+            is 0 if no datagram is available. Multiple datagrams are
+            received with a single system call if supported (recvmmsg).
+            This is typically called when the socket reported input or
+            periodically, for example once per simulation tick.
+
+            \throw IOError, IOPending
+        */
+        std::size_t receive(Datagram* dgrams, std::size_t count);
+
+        /** @brief Sends a batch of datagrams.
+
+            Sends up to \a count datagrams without waiting and returns the
+            number of datagrams that were sent. Fewer datagrams are sent,
+            if the send buffer of the socket is full. Multiple datagrams
+            are sent with a single system call if supported (sendmmsg).
+            Destinations which are not resolved yet are looked up for each
+            call, so endpoints obtained by receive() should be preferred.
+
+            \throw IOError, IOPending
+        */
+        std::size_t send(const Datagram* dgrams, std::size_t count);
+
     protected:
         // inherit doc
         virtual void onClose();
@@ -178,6 +317,9 @@ class PT_NET_API UdpSocket : public System::IODevice
 
         //! @internal
         bool _binding;
+
+        //! @internal
+        bool _sendingTo;
 };
 
 } // namespace Net
@@ -38,28 +38,69 @@
 #include <Pt/ConstMethod.h>
 #include <Pt/Connectable.h>
 #include <map>
+#include <vector>
+#include <cstddef>
 
 namespace Pt {
 
+/** @internal @brief Common base of all signals.
+
+    The connections to the slots of a signal are kept in a contiguous
+    slot table, which caches the callable of each slot. A single slot
+    is stored inline in the signal, so that signals with none or one
+    connected slot never allocate. Connections to other signals, where
+    this signal is the target, are managed by the Connectable base.
+
+    Slots which are disconnected while the signal is sending are only
+    marked invalid, so the indices of the slot table remain stable for
+    nested sends. The table is compacted when the outermost send has
+    finished.
+*/
 class PT_API SignalBase : public Connectable
 {
     public:
-        struct PT_API Sentry
+        struct Sentry
         {
-            Sentry(SignalBase* signal);
+            Sentry(SignalBase* signal)
+            : _signal(signal)
+            , _prev(signal->_sentry)
+            {
+                _signal->_sentry = this;
+                ++_signal->_sending;
+            }
 
-            ~Sentry();
+            ~Sentry()
+            {
+                if( _signal )
+                    this->detach();
+            }
 
-            void detach();
+            void detach()
+            {
+                _signal->_sentry = _prev;
+
+                if( --_signal->_sending == 0 && _signal->_dirty )
+                    _signal->compactSlots();
+
+                _signal = 0;
+            }
 
             bool operator!() const
             { return _signal == 0; }
 
             SignalBase* _signal;
+            Sentry* _prev;
         };
 
         SignalBase();
 
+        /** @brief Copy constructor.
+
+            The slots of @a other are cloned into the own slot table,
+            which might be the inline slot of this signal.
+        */
+        SignalBase(const SignalBase& other);
+
         ~SignalBase();
 
         SignalBase& operator=(const SignalBase& other);
@@ -73,9 +114,43 @@ class PT_API SignalBase : public Connectable
 
         void disconnectSlot(const Slot&);
 
+        //! @brief Returns true if any slots are connected.
+        bool hasSlots() const
+        { return _slotCount != 0; }
+
+        //! @brief Returns the size of the slot table.
+        std::size_t slotCount() const
+        { return _slotCount; }
+
+        //! @brief Returns the callable of the n-th slot or 0 if it was disconnected.
+        const void* slotCallable(std::size_t n) const
+        { return _slots[n].callable; }
+
+    private:
+        //! @internal
+        struct SlotEntry
+        {
+            SlotEntry()
+            : callable(0)
+            { }
+
+            const void* callable;
+            Connection connection;
+        };
+
+        void addSlot(const Connection& c);
+
+        void removeSlot(const Connection& c);
+
+        void compactSlots();
+
     private:
+        SlotEntry* _slots;
+        std::size_t _slotCount;
+        std::size_t _slotCapacity;
+        SlotEntry _localSlot;
         Sentry* _sentry;
-        bool _sending;
+        unsigned _sending;
         bool _dirty;
 };
 
@@ -87,22 +162,48 @@ struct PT_API CompareEventTypeInfo
                      const std::type_info* t2 ) const;
 };
 
+/** @brief Signal for events, which routes events by type.
+
+    Slots for a specific event type are kept in a route table, which is
+    indexed by the type index of the event. Slots for Pt::Event receive
+    all events. Events, which do not provide a type index, are routed by
+    looking up their type info in the registered event types.
+*/
 template <>
 class PT_API Signal<const Pt::Event&> : public Connectable
                                       , protected NonCopyable
 {
-    struct PT_API Sentry
+    struct Sentry
     {
-        Sentry(Signal* signal);
+        Sentry(Signal* signal)
+        : _signal(signal)
+        , _prev(signal->_sentry)
+        {
+            _signal->_sentry = this;
+            ++_signal->_sending;
+        }
 
-        ~Sentry();
+        ~Sentry()
+        {
+            if( _signal )
+                this->detach();
+        }
+
+        void detach()
+        {
+            _signal->_sentry = _prev;
 
-        void detach();
+            if( --_signal->_sending == 0 && _signal->_dirty )
+                _signal->compactRoutes();
+
+            _signal = 0;
+        }
 
         bool operator!() const
         { return _signal == 0; }
 
         Signal* _signal;
+        Sentry* _prev;
     };
 
     class IEventRoute
@@ -141,7 +242,7 @@ class PT_API Signal<const Pt::Event&> : public Connectable
 
             virtual void route(const Pt::Event& ev)
             {
-                typedef Invokable<const Pt::Event&> InvokableT;
+                typedef Invokable<const EventT&> InvokableT;
                 const InvokableT* invokable = static_cast<const InvokableT*>( connection().slot()->callable() );
 
                 const EventT& event = static_cast<const EventT&>(ev);
@@ -149,9 +250,9 @@ class PT_API Signal<const Pt::Event&> : public Connectable
             }
     };
 
-    typedef std::multimap< const std::type_info*,
-                           IEventRoute*,
-                           CompareEventTypeInfo > RouteMap;
+    typedef std::vector<IEventRoute*> RouteList;
+
+    typedef std::vector<RouteList> RouteTable;
 
     public:
         Signal();
@@ -174,7 +275,8 @@ class PT_API Signal<const Pt::Event&> : public Connectable
         template <typename R, typename EventT>
         void disconnect(const BasicSlot<R, const EventT&>& slot)
         {
-            this->removeRoute(slot);
+            EventT* selectRemoveRouteOverload = 0;
+            this->removeRoute(slot, selectRemoveRouteOverload);
         }
 
         virtual void onConnectionOpen(const Connection& c);
@@ -190,20 +292,35 @@ class PT_API Signal<const Pt::Event&> : public Connectable
         template <typename EventT>
         void addRoute(Connection& conn, const EventT*)
         {
-            const std::type_info& ti = typeid(EventT);
-            this->addRoute( &ti, new EventRoute<EventT>(conn) );
+            std::size_t idx = EventType<EventT>::index();
+            this->addRoute( idx, new EventRoute<EventT>(conn) );
         }
 
-        void addRoute(const std::type_info* ti, IEventRoute* route);
+        void addRoute(std::size_t idx, IEventRoute* route);
+
+        void removeRoute(const Slot& slot, const Pt::Event*)
+        {
+            this->removeRoute(0, slot);
+        }
 
-        void removeRoute(const Slot& slot);
+        template <typename EventT>
+        void removeRoute(const Slot& slot, const EventT*)
+        {
+            this->removeRoute(EventType<EventT>::index(), slot);
+        }
+
+        void removeRoute(std::size_t idx, const Slot& slot);
+
+    private:
+        bool routeEvent(std::size_t idx, const Pt::Event& ev, const Sentry& sentry);
 
-        void removeRoute(const std::type_info* ti, const Slot& slot);
+        void compactRoutes();
 
     private:
-        RouteMap _routes;
+        RouteTable _routes;
+        std::size_t _routeCount;
         Sentry* _sentry;
-        bool _sending;
+        unsigned _sending;
         bool _dirty;
 };
 
@@ -34,31 +34,26 @@ class Signal : public SignalBase
 
         inline void send(A1 a1, A2 a2, A3 a3, A4 a4, A5 a5, A6 a6, A7 a7, A8 a8, A9 a9, A10 a10)
         {
-            if(Connectable::connections().empty()) return;
+            if( ! this->hasSlots() ) return;
 
             // The sentry will set the Signal to the sending state and reset it to not-sending upon destruction.
-            // In the sending state, removing connection will leave invalid connections in the connection list
-            // to keep the iterator valid, but mark the Signal dirty. If the Signal is dirty, all invalid connections
-            // will be removed by the Sentry when it destructs.
+            // In the sending state, removed slots are only marked invalid to keep the slot indices stable.
+            // The slot table is compacted when the outermost Sentry destructs.
             SignalBase::Sentry sentry(this);
 
-            std::list<Connection>::const_iterator it   = Connectable::connections().begin();
-            std::list<Connection>::const_iterator last = --Connectable::connections().end();
-            while(true) {
+            const std::size_t count = this->slotCount();
+            for(std::size_t n = 0; n < count; ++n) {
                 // The following scenarios must be considered when the slot is called:
                 // - The slot might get deleted and thus disconnected from this signal
                 // - The slot might delete this signal and we must end calling any slots immediately
-                // - A new Connection might get added to this Signal in the slot
-                if( it->isValid() && it->sender() == this ) {
-                    const InvokableT* invokable = static_cast<const InvokableT*>( it->slot()->callable() );
+                // - A new Connection might get added to this Signal in the slot, which is not called before the next send
+                const InvokableT* invokable = static_cast<const InvokableT*>( this->slotCallable(n) );
+                if(invokable)
                     invokable->invoke(a1,a2,a3,a4,a5,a6,a7,a8,a9,a10);
-                }
+
                 // If this signal gets deleted by the slot, the Sentry will be detached. In this case we bail out immediately
                 if(!sentry) return;
-                // Break if this is the last handler
-                if(it == last) break;
-                ++it;
-            };
+            }
         }
 
         inline void operator()(A1 a1, A2 a2, A3 a3, A4 a4, A5 a5, A6 a6, A7 a7, A8 a8, A9 a9, A10 a10)
@@ -159,31 +154,26 @@ class Signal<A1,A2,A3,A4,A5,A6,A7,A8,A9,Void> : public SignalBase
 
         inline void send(A1 a1, A2 a2, A3 a3, A4 a4, A5 a5, A6 a6, A7 a7, A8 a8, A9 a9)
         {
-            if(Connectable::connections().empty()) return;
+            if( ! this->hasSlots() ) return;
 
             // The sentry will set the Signal to the sending state and reset it to not-sending upon destruction.
-            // In the sending state, removing connection will leave invalid connections in the connection list
-            // to keep the iterator valid, but mark the Signal dirty. If the Signal is dirty, all invalid connections
-            // will be removed by the Sentry when it destructs.
+            // In the sending state, removed slots are only marked invalid to keep the slot indices stable.
+            // The slot table is compacted when the outermost Sentry destructs.
             SignalBase::Sentry sentry(this);
 
-            std::list<Connection>::const_iterator it   = Connectable::connections().begin();
-            std::list<Connection>::const_iterator last = --Connectable::connections().end();
-            while(true) {
+            const std::size_t count = this->slotCount();
+            for(std::size_t n = 0; n < count; ++n) {
                 // The following scenarios must be considered when the slot is called:
                 // - The slot might get deleted and thus disconnected from this signal
                 // - The slot might delete this signal and we must end calling any slots immediately
-                // - A new Connection might get added to this Signal in the slot
-                if( it->isValid() && it->sender() == this ) {
-                    const InvokableT* invokable = static_cast<const InvokableT*>( it->slot()->callable() );
+                // - A new Connection might get added to this Signal in the slot, which is not called before the next send
+                const InvokableT* invokable = static_cast<const InvokableT*>( this->slotCallable(n) );
+                if(invokable)
                     invokable->invoke(a1,a2,a3,a4,a5,a6,a7,a8,a9);
-                }
+
                 // If this signal gets deleted by the slot, the Sentry will be detached. In this case we bail out immediately
                 if(!sentry) return;
-                // Break if this is the last handler
-                if(it == last) break;
-                ++it;
-            };
+            }
         }
 
         inline void operator()(A1 a1, A2 a2, A3 a3, A4 a4, A5 a5, A6 a6, A7 a7, A8 a8, A9 a9)
@@ -225,31 +215,26 @@ class Signal<A1,A2,A3,A4,A5,A6,A7,A8,Void,Void> : public SignalBase
 
         inline void send(A1 a1, A2 a2, A3 a3, A4 a4, A5 a5, A6 a6, A7 a7, A8 a8)
         {
-            if(Connectable::connections().empty()) return;
+            if( ! this->hasSlots() ) return;
 
             // The sentry will set the Signal to the sending state and reset it to not-sending upon destruction.
-            // In the sending state, removing connection will leave invalid connections in the connection list
-            // to keep the iterator valid, but mark the Signal dirty. If the Signal is dirty, all invalid connections
-            // will be removed by the Sentry when it destructs.
+            // In the sending state, removed slots are only marked invalid to keep the slot indices stable.
+            // The slot table is compacted when the outermost Sentry destructs.
             SignalBase::Sentry sentry(this);
 
-            std::list<Connection>::const_iterator it   = Connectable::connections().begin();
-            std::list<Connection>::const_iterator last = --Connectable::connections().end();
-            while(true) {
+            const std::size_t count = this->slotCount();
+            for(std::size_t n = 0; n < count; ++n) {
                 // The following scenarios must be considered when the slot is called:
                 // - The slot might get deleted and thus disconnected from this signal
                 // - The slot might delete this signal and we must end calling any slots immediately
-                // - A new Connection might get added to this Signal in the slot
-                if( it->isValid() && it->sender() == this ) {
-                    const InvokableT* invokable = static_cast<const InvokableT*>( it->slot()->callable() );
+                // - A new Connection might get added to this Signal in the slot, which is not called before the next send
+                const InvokableT* invokable = static_cast<const InvokableT*>( this->slotCallable(n) );
+                if(invokable)
                     invokable->invoke(a1,a2,a3,a4,a5,a6,a7,a8);
-                }
+
                 // If this signal gets deleted by the slot, the Sentry will be detached. In this case we bail out immediately
                 if(!sentry) return;
-                // Break if this is the last handler
-                if(it == last) break;
-                ++it;
-            };
+            }
         }
 
         inline void operator()(A1 a1, A2 a2, A3 a3, A4 a4, A5 a5, A6 a6, A7 a7, A8 a8)
@@ -291,31 +276,26 @@ class Signal<A1,A2,A3,A4,A5,A6,A7,Void,Void,Void> : public SignalBase
 
         inline void send(A1 a1, A2 a2, A3 a3, A4 a4, A5 a5, A6 a6, A7 a7) 
         {
-            if(Connectable::connections().empty()) return;
+            if( ! this->hasSlots() ) return;
 
             // The sentry will set the Signal to the sending state and reset it to not-sending upon destruction.
-            // In the sending state, removing connection will leave invalid connections in the connection list
-            // to keep the iterator valid, but mark the Signal dirty. If the Signal is dirty, all invalid connections
-            // will be removed by the Sentry when it destructs.
+            // In the sending state, removed slots are only marked invalid to keep the slot indices stable.
+            // The slot table is compacted when the outermost Sentry destructs.
             SignalBase::Sentry sentry(this);
 
-            std::list<Connection>::const_iterator it   = Connectable::connections().begin();
-            std::list<Connection>::const_iterator last = --Connectable::connections().end();
-            while(true) {
+            const std::size_t count = this->slotCount();
+            for(std::size_t n = 0; n < count; ++n) {
                 // The following scenarios must be considered when the slot is called:
                 // - The slot might get deleted and thus disconnected from this signal
                 // - The slot might delete this signal and we must end calling any slots immediately
-                // - A new Connection might get added to this Signal in the slot
-                if( it->isValid() && it->sender() == this ) {
-                    const InvokableT* invokable = static_cast<const InvokableT*>( it->slot()->callable() );
+                // - A new Connection might get added to this Signal in the slot, which is not called before the next send
+                const InvokableT* invokable = static_cast<const InvokableT*>( this->slotCallable(n) );
+                if(invokable)
                     invokable->invoke(a1,a2,a3,a4,a5,a6,a7);
-                }
+
                 // If this signal gets deleted by the slot, the Sentry will be detached. In this case we bail out immediately
                 if(!sentry) return;
-                // Break if this is the last handler
-                if(it == last) break;
-                ++it;
-            };
+            }
         }
 
         inline void operator()(A1 a1, A2 a2, A3 a3, A4 a4, A5 a5, A6 a6, A7 a7) 
@@ -357,31 +337,26 @@ class Signal<A1,A2,A3,A4,A5,A6,Void,Void,Void,Void> : public SignalBase
 
         inline void send(A1 a1, A2 a2, A3 a3, A4 a4, A5 a5, A6 a6) 
         {
-            if(Connectable::connections().empty()) return;
+            if( ! this->hasSlots() ) return;
 
             // The sentry will set the Signal to the sending state and reset it to not-sending upon destruction.
-            // In the sending state, removing connection will leave invalid connections in the connection list
-            // to keep the iterator valid, but mark the Signal dirty. If the Signal is dirty, all invalid connections
-            // will be removed by the Sentry when it destructs.
+            // In the sending state, removed slots are only marked invalid to keep the slot indices stable.
+            // The slot table is compacted when the outermost Sentry destructs.
             SignalBase::Sentry sentry(this);
 
-            std::list<Connection>::const_iterator it   = Connectable::connections().begin();
-            std::list<Connection>::const_iterator last = --Connectable::connections().end();
-            while(true) {
+            const std::size_t count = this->slotCount();
+            for(std::size_t n = 0; n < count; ++n) {
                 // The following scenarios must be considered when the slot is called:
                 // - The slot might get deleted and thus disconnected from this signal
                 // - The slot might delete this signal and we must end calling any slots immediately
-                // - A new Connection might get added to this Signal in the slot
-                if( it->isValid() && it->sender() == this ) {
-                    const InvokableT* invokable = static_cast<const InvokableT*>( it->slot()->callable() );
+                // - A new Connection might get added to this Signal in the slot, which is not called before the next send
+                const InvokableT* invokable = static_cast<const InvokableT*>( this->slotCallable(n) );
+                if(invokable)
                     invokable->invoke(a1,a2,a3,a4,a5,a6);
-                }
+
                 // If this signal gets deleted by the slot, the Sentry will be detached. In this case we bail out immediately
                 if(!sentry) return;
-                // Break if this is the last handler
-                if(it == last) break;
-                ++it;
-            };
+            }
         }
 
         inline void operator()(A1 a1, A2 a2, A3 a3, A4 a4, A5 a5, A6 a6) 
@@ -423,31 +398,26 @@ class Signal<A1,A2,A3,A4,A5,Void,Void,Void,Void,Void> : public SignalBase
 
         inline void send(A1 a1, A2 a2, A3 a3, A4 a4, A5 a5) 
         {
-            if(Connectable::connections().empty()) return;
+            if( ! this->hasSlots() ) return;
 
             // The sentry will set the Signal to the sending state and reset it to not-sending upon destruction.
-            // In the sending state, removing connection will leave invalid connections in the connection list
-            // to keep the iterator valid, but mark the Signal dirty. If the Signal is dirty, all invalid connections
-            // will be removed by the Sentry when it destructs.
+            // In the sending state, removed slots are only marked invalid to keep the slot indices stable.
+            // The slot table is compacted when the outermost Sentry destructs.
             SignalBase::Sentry sentry(this);
 
-            std::list<Connection>::const_iterator it   = Connectable::connections().begin();
-            std::list<Connection>::const_iterator last = --Connectable::connections().end();
-            while(true) {
+            const std::size_t count = this->slotCount();
+            for(std::size_t n = 0; n < count; ++n) {
                 // The following scenarios must be considered when the slot is called:
                 // - The slot might get deleted and thus disconnected from this signal
                 // - The slot might delete this signal and we must end calling any slots immediately
-                // - A new Connection might get added to this Signal in the slot
-                if( it->isValid() && it->sender() == this ) {
-                    const InvokableT* invokable = static_cast<const InvokableT*>( it->slot()->callable() );
+                // - A new Connection might get added to this Signal in the slot, which is not called before the next send
+                const InvokableT* invokable = static_cast<const InvokableT*>( this->slotCallable(n) );
+                if(invokable)
                     invokable->invoke(a1,a2,a3,a4,a5);
-                }
+
                 // If this signal gets deleted by the slot, the Sentry will be detached. In this case we bail out immediately
                 if(!sentry) return;
-                // Break if this is the last handler
-                if(it == last) break;
-                ++it;
-            };
+            }
         }
 
         inline void operator()(A1 a1, A2 a2, A3 a3, A4 a4, A5 a5) 
@@ -489,31 +459,26 @@ class Signal<A1,A2,A3,A4,Void,Void,Void,Void,Void,Void> : public SignalBase
 
         inline void send(A1 a1, A2 a2, A3 a3, A4 a4) 
         {
-            if(Connectable::connections().empty()) return;
+            if( ! this->hasSlots() ) return;
 
             // The sentry will set the Signal to the sending state and reset it to not-sending upon destruction.
-            // In the sending state, removing connection will leave invalid connections in the connection list
-            // to keep the iterator valid, but mark the Signal dirty. If the Signal is dirty, all invalid connections
-            // will be removed by the Sentry when it destructs.
+            // In the sending state, removed slots are only marked invalid to keep the slot indices stable.
+            // The slot table is compacted when the outermost Sentry destructs.
             SignalBase::Sentry sentry(this);
 
-            std::list<Connection>::const_iterator it   = Connectable::connections().begin();
-            std::list<Connection>::const_iterator last = --Connectable::connections().end();
-            while(true) {
+            const std::size_t count = this->slotCount();
+            for(std::size_t n = 0; n < count; ++n) {
                 // The following scenarios must be considered when the slot is called:
                 // - The slot might get deleted and thus disconnected from this signal
                 // - The slot might delete this signal and we must end calling any slots immediately
-                // - A new Connection might get added to this Signal in the slot
-                if( it->isValid() && it->sender() == this ) {
-                    const InvokableT* invokable = static_cast<const InvokableT*>( it->slot()->callable() );
+                // - A new Connection might get added to this Signal in the slot, which is not called before the next send
+                const InvokableT* invokable = static_cast<const InvokableT*>( this->slotCallable(n) );
+                if(invokable)
                     invokable->invoke(a1,a2,a3,a4);
-                }
+
                 // If this signal gets deleted by the slot, the Sentry will be detached. In this case we bail out immediately
                 if(!sentry) return;
-                // Break if this is the last handler
-                if(it == last) break;
-                ++it;
-            };
+            }
         }
 
         inline void operator()(A1 a1, A2 a2, A3 a3, A4 a4) 
@@ -555,31 +520,26 @@ class Signal<A1,A2,A3,Void,Void,Void,Void,Void,Void,Void> : public SignalBase
 
         inline void send(A1 a1, A2 a2, A3 a3) 
         {
-            if(Connectable::connections().empty()) return;
+            if( ! this->hasSlots() ) return;
 
             // The sentry will set the Signal to the sending state and reset it to not-sending upon destruction.
-            // In the sending state, removing connection will leave invalid connections in the connection list
-            // to keep the iterator valid, but mark the Signal dirty. If the Signal is dirty, all invalid connections
-            // will be removed by the Sentry when it destructs.
+            // In the sending state, removed slots are only marked invalid to keep the slot indices stable.
+            // The slot table is compacted when the outermost Sentry destructs.
             SignalBase::Sentry sentry(this);
 
-            std::list<Connection>::const_iterator it   = Connectable::connections().begin();
-            std::list<Connection>::const_iterator last = --Connectable::connections().end();
-            while(true) {
+            const std::size_t count = this->slotCount();
+            for(std::size_t n = 0; n < count; ++n) {
                 // The following scenarios must be considered when the slot is called:
                 // - The slot might get deleted and thus disconnected from this signal
                 // - The slot might delete this signal and we must end calling any slots immediately
-                // - A new Connection might get added to this Signal in the slot
-                if( it->isValid() && it->sender() == this ) {
-                    const InvokableT* invokable = static_cast<const InvokableT*>( it->slot()->callable() );
+                // - A new Connection might get added to this Signal in the slot, which is not called before the next send
+                const InvokableT* invokable = static_cast<const InvokableT*>( this->slotCallable(n) );
+                if(invokable)
                     invokable->invoke(a1,a2,a3);
-                }
+
                 // If this signal gets deleted by the slot, the Sentry will be detached. In this case we bail out immediately
                 if(!sentry) return;
-                // Break if this is the last handler
-                if(it == last) break;
-                ++it;
-            };
+            }
         }
 
         inline void operator()(A1 a1, A2 a2, A3 a3) 
@@ -610,7 +570,7 @@ class Signal<A1,A2,Void,Void,Void,Void,Void,Void,Void,Void> : public SignalBase
 
         void disconnect()
         {
-            this->disconnectSlot(); 
+            this->disconnectSlots(); 
         }
 
         template <typename R>
@@ -621,31 +581,26 @@ class Signal<A1,A2,Void,Void,Void,Void,Void,Void,Void,Void> : public SignalBase
 
         inline void send(A1 a1, A2 a2) 
         {
-            if(Connectable::connections().empty()) return;
+            if( ! this->hasSlots() ) return;
 
             // The sentry will set the Signal to the sending state and reset it to not-sending upon destruction.
-            // In the sending state, removing connection will leave invalid connections in the connection list
-            // to keep the iterator valid, but mark the Signal dirty. If the Signal is dirty, all invalid connections
-            // will be removed by the Sentry when it destructs.
+            // In the sending state, removed slots are only marked invalid to keep the slot indices stable.
+            // The slot table is compacted when the outermost Sentry destructs.
             SignalBase::Sentry sentry(this);
 
-            std::list<Connection>::const_iterator it   = Connectable::connections().begin();
-            std::list<Connection>::const_iterator last = --Connectable::connections().end();
-            while(true) {
+            const std::size_t count = this->slotCount();
+            for(std::size_t n = 0; n < count; ++n) {
                 // The following scenarios must be considered when the slot is called:
                 // - The slot might get deleted and thus disconnected from this signal
                 // - The slot might delete this signal and we must end calling any slots immediately
-                // - A new Connection might get added to this Signal in the slot
-                if( it->isValid() && it->sender() == this ) {
-                    const InvokableT* invokable = static_cast<const InvokableT*>( it->slot()->callable() );
+                // - A new Connection might get added to this Signal in the slot, which is not called before the next send
+                const InvokableT* invokable = static_cast<const InvokableT*>( this->slotCallable(n) );
+                if(invokable)
                     invokable->invoke(a1,a2);
-                }
+
                 // If this signal gets deleted by the slot, the Sentry will be detached. In this case we bail out immediately
                 if(!sentry) return;
-                // Break if this is the last handler
-                if(it == last) break;
-                ++it;
-            };
+            }
         }
 
         inline void operator()(A1 a1, A2 a2) 
@@ -688,31 +643,26 @@ class Signal<A1,Void,Void,Void,Void,Void,Void,Void,Void,Void> : public SignalBas
 
         inline void send(A1 a1) 
         {
-            if(Connectable::connections().empty()) return;
+            if( ! this->hasSlots() ) return;
 
             // The sentry will set the Signal to the sending state and reset it to not-sending upon destruction.
-            // In the sending state, removing connection will leave invalid connections in the connection list
-            // to keep the iterator valid, but mark the Signal dirty. If the Signal is dirty, all invalid connections
-            // will be removed by the Sentry when it destructs.
+            // In the sending state, removed slots are only marked invalid to keep the slot indices stable.
+            // The slot table is compacted when the outermost Sentry destructs.
             SignalBase::Sentry sentry(this);
 
-            std::list<Connection>::const_iterator it   = Connectable::connections().begin();
-            std::list<Connection>::const_iterator last = --Connectable::connections().end();
-            while(true) {
+            const std::size_t count = this->slotCount();
+            for(std::size_t n = 0; n < count; ++n) {
                 // The following scenarios must be considered when the slot is called:
                 // - The slot might get deleted and thus disconnected from this signal
                 // - The slot might delete this signal and we must end calling any slots immediately
-                // - A new Connection might get added to this Signal in the slot
-                if( it->isValid() && it->sender() == this ) {
-                    const InvokableT* invokable = static_cast<const InvokableT*>( it->slot()->callable() );
+                // - A new Connection might get added to this Signal in the slot, which is not called before the next send
+                const InvokableT* invokable = static_cast<const InvokableT*>( this->slotCallable(n) );
+                if(invokable)
                     invokable->invoke(a1);
-                }
+
                 // If this signal gets deleted by the slot, the Sentry will be detached. In this case we bail out immediately
                 if(!sentry) return;
-                // Break if this is the last handler
-                if(it == last) break;
-                ++it;
-            };
+            }
         }
 
         inline void operator()(A1 a1) 
@@ -754,40 +704,30 @@ class Signal<Void,Void,Void,Void,Void,Void,Void,Void,Void,Void> : public SignalB
 
         inline void send()
         {
-            if( Connectable::connections().empty() ) 
+            if( ! this->hasSlots() ) 
                 return;
 
             // The sentry will set the Signal to the sending state and reset it to not-sending upon destruction.
-            // In the sending state, removing connection will leave invalid connections in the connection list
-            // to keep the iterator valid, but mark the Signal dirty. If the Signal is dirty, all invalid connections
-            // will be removed by the Sentry when it destructs.
+            // In the sending state, removed slots are only marked invalid to keep the slot indices stable.
+            // The slot table is compacted when the outermost Sentry destructs.
             SignalBase::Sentry sentry(this);
 
-            std::list<Connection>::const_iterator it   = Connectable::connections().begin();
-            std::list<Connection>::const_iterator last = --Connectable::connections().end();
-            while(true) 
+            const std::size_t count = this->slotCount();
+            for(std::size_t n = 0; n < count; ++n) 
             {
                 // The following scenarios must be considered when the slot is called:
                 // - The slot might get deleted and thus disconnected from this signal
                 // - The slot might delete this signal and we must end calling any slots immediately
-                // - A new Connection might get added to this Signal in the slot
+                // - A new Connection might get added to this Signal in the slot, which is not called before the next send
 
-                if( it->isValid() && it->sender() == this ) 
-                {
-                    const InvokableT* invokable = static_cast<const InvokableT*>( it->slot()->callable() );
+                const InvokableT* invokable = static_cast<const InvokableT*>( this->slotCallable(n) );
+                if(invokable) 
                     invokable->invoke();
-                }
                     
                 // If this signal gets deleted by the slot, the Sentry will be detached. In this case we bail out immediately
                 if( ! sentry)
                     return;
-
-                // Break if this is the last handler
-                if(it == last) 
-                    break;
-                    
-                ++it;
-            };
+            }
         }
 
         inline void operator()()
@@ -125,6 +125,16 @@ class PT_SSL_API Context : public NonCopyable
         */
         void addCertificate(const Certificate& cert);
 
+        /** @brief Adds a protocol for application layer protocol negotiation.
+
+            The protocols are offered to the peer in the order they were
+            added, for example "h2" and "http/1.1". A server selects the
+            first of its protocols, which is also offered by the client.
+            The negotiated protocol is reported by the stream buffer, once
+            the handshake is finished.
+        */
+        void addApplicationProtocol(const std::string& name);
+
         //! @internal
         ContextImpl* impl();
 
@@ -34,6 +34,7 @@
 #include <Pt/Ssl/Context.h>
 #include <Pt/StreamBuffer.h>
 #include <ios>
+#include <string>
 #include <cstddef>
 
 namespace Pt {
@@ -67,6 +68,13 @@ class PT_SSL_API StreamBuffer : public BasicStreamBuffer<char>
         */
         const char* currentCipher() const;
 
+        /** @brief Returns the negotiated application protocol.
+
+            An empty string is returned, if no protocol was negotiated or
+            the handshake is not finished yet.
+        */
+        std::string applicationProtocol() const;
+
         /** @brief Closes the stream buffer.
         */
         void close();
@@ -90,6 +90,28 @@ class BasicStreamBuffer : public std::basic_streambuf<CharT, TraitsT>
             return size;
         }
 
+        /** @brief Returns the characters in the get area.
+
+            Stores the number of characters, which can be read without
+            calling underflow, in \a n and returns a pointer to the first
+            one. The characters remain valid until the buffer is read or
+            modified.
+        */
+        const CharT* sview(std::size_t& n) const
+        {
+            n = this->gptr() ? this->egptr() - this->gptr() : 0;
+            return this->gptr();
+        }
+
+        /** @brief Skips \a n characters of the get area.
+
+            At most as many characters as returned by sview() can be skipped.
+        */
+        void sskip(std::size_t n)
+        {
+            this->gbump( static_cast<int>(n) );
+        }
+
         std::streamsize out_avail()
         {
             if( this->pptr() )
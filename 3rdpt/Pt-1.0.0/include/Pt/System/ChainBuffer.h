@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2005-2013 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef Pt_System_ChainBuffer_h
+#define Pt_System_ChainBuffer_h
+
+#include <Pt/System/Api.h>
+#include <Pt/System/IODevice.h>
+#include <Pt/Signal.h>
+#include <Pt/StreamBuffer.h>
+#include <Pt/RefCounted.h>
+#include <vector>
+
+namespace Pt {
+
+namespace System {
+
+class SlabPool;
+
+/** @brief Growable stream buffer for I/O devices.
+
+    The %ChainBuffer is an alternative to the IOBuffer, which keeps its
+    input and output in chains of fixed-size slabs instead of two buffers
+    of fixed size. Slabs are taken from a process-wide pool when more
+    space is needed, so the data is never moved and a message can be
+    larger than a single slab. Written slabs are returned to the pool when
+    the write completes, consumed input slabs when the buffer moves on to
+    the next slab or reads again. A buffer which has no unprocessed data
+    holds no slabs, even while a read is pending. Such a read goes to a
+    small area inside the buffer and its data is moved to a slab when the
+    read completes.
+
+    The interface for asynchronous I/O is the same as for the IOBuffer.
+    All buffered output is written with a single vectored write, which
+    also includes caller-owned data added with queue(). Characters can
+    only be put back within the current slab of the input chain.
+*/
+class PT_SYSTEM_API ChainBuffer : public BasicStreamBuffer<char>
+                                , public Connectable
+{
+    public:
+        //! @brief Size of the slabs in bytes
+        static const std::size_t SlabSize = 4096;
+
+    public:
+        ChainBuffer();
+
+        explicit ChainBuffer(IODevice& ioDevice);
+
+        ~ChainBuffer();
+
+        IODevice* device()
+        { return _ioDevice; }
+
+        Signal<ChainBuffer&>& inputReady()
+        { return _inputReady; }
+
+        Signal<ChainBuffer&>& outputReady()
+        { return _outputReady; }
+
+        void attach(IODevice& ioDevice);
+
+        void detach();
+
+        void reset();
+
+        //! @brief Discards all buffered data and returns the slabs
+        void discard();
+
+        //! @brief Queues caller-owned data for output without copying it
+        /**
+            The \a n bytes at \a data are sent after all data that was
+            written to the buffer so far, data written afterwards follows
+            them. The buffer keeps a reference to \a owner until the data
+            was written, so the memory must stay valid and unchanged for
+            as long as \a owner is alive.
+        */
+        void queue(const char* data, std::size_t n, RefCounted& owner);
+
+        //! @brief Returns the number of queued bytes not written yet
+        std::size_t queued() const
+        { return _oqueued; }
+
+        void beginRead();
+
+        //! @internal
+        void onRead(IODevice& dev);
+
+        std::size_t endRead();
+
+        void beginWrite();
+
+        //! @internal
+        void onWrite(IODevice& dev);
+
+        std::size_t endWrite();
+
+        bool isReading() const;
+
+        bool isWriting() const;
+
+        //! @brief Returns the number of slabs held by the buffer
+        std::size_t slabCount() const;
+
+    protected:
+        virtual std::streamsize showmanyc();
+
+        virtual std::streamsize showfull();
+
+        virtual int sync();
+
+        virtual int_type underflow();
+
+        virtual int_type overflow(int_type ch);
+
+        virtual pos_type seekoff(off_type offset, std::ios::seekdir sd, std::ios::openmode mode);
+
+        virtual pos_type seekpos(pos_type p, std::ios::openmode mode );
+
+        virtual int_type pbackfail(int_type c);
+
+    private:
+        //! @internal
+        struct Segment;
+
+        //! @internal
+        struct Slab;
+
+        //! @internal
+        static const std::size_t IdleReadSize = 512;
+
+        friend class SlabPool;
+
+        //! @internal
+        Slab* inputSlab();
+
+        //! @internal
+        void fillInput(Slab* slab, std::size_t n);
+
+        //! @internal
+        void trimInput();
+
+        //! @internal
+        void appendOutput(Segment* seg);
+
+        //! @internal
+        void releaseOutput(Segment* seg);
+
+        //! @internal
+        void syncOutput();
+
+        //! @internal
+        void consumeOutput(std::size_t n);
+
+        //! @internal
+        void initOutputVector();
+
+        //! @internal
+        void clearInput();
+
+        //! @internal
+        void clearOutput();
+
+    private:
+        Signal<ChainBuffer&> _inputReady;
+        Signal<ChainBuffer&> _outputReady;
+        IODevice* _ioDevice;
+        Slab* _ihead;
+        Slab* _itail;
+        Slab* _iread;
+        bool _ireadIdle;
+        Segment* _ohead;
+        Segment* _otail;
+        Slab* _oput;
+        std::size_t _oqueued;
+        std::vector<IOVec> _ovec;
+        char _iidle[IdleReadSize];
+};
+
+} // namespace System
+
+} // namespace Pt
+
+#endif // Pt_System_ChainBuffer_h
@@ -33,6 +33,7 @@
 #include <Pt/DateTime.h>
 #include <Pt/Timespan.h>
 #include <Pt/NonCopyable.h>
+#include <Pt/Types.h>
 
 namespace Pt {
 
@@ -42,9 +43,28 @@ namespace System {
 
     The clock class can be used like a stop-watch by calling Clock::start()
     and Clock::stop(). The latter method returns the elapsed time.
+
+    The monotonic clock of the system is not affected by changes of the
+    system time and is used to measure intervals and to expire timers.
+    By default, the most precise monotonic clock is used. Programs, which
+    read the clock very often, can choose a coarse clock or, on x86-64
+    Linux, the calibrated time stamp counter of the CPU, if the kernel
+    considers it stable.
 */
 class PT_SYSTEM_API Clock : private NonCopyable
 {
+    public:
+        //! @brief Sources of the monotonic clock.
+        enum MonotonicSource
+        {
+            //! Precise monotonic clock
+            Monotonic = 0,
+            //! Coarse monotonic clock with the resolution of the scheduler tick
+            MonotonicCoarse = 1,
+            //! Calibrated time stamp counter of the CPU
+            TimestampCounter = 2
+        };
+
     public:
         /** @brief Constructs a Clock
         */
@@ -80,6 +100,30 @@ class PT_SYSTEM_API Clock : private NonCopyable
         */
         static Timespan getSystemTicks();
 
+        /** @brief Returns the time of the monotonic clock in nanoseconds
+
+            The monotonic time is counted from an unspecified point in the
+            past and is not affected by changes of the system time.
+        */
+        static Pt::int64_t getMonotonicTime();
+
+        /** @brief Returns the time of the monotonic clock
+
+            The timespan has microsecond resolution.
+        */
+        static Timespan getMonotonicTicks();
+
+        /** @brief Selects the source of the monotonic clock
+
+            The source should be selected once at program start, before
+            any timers are started. The source is switched atomically, so
+            other threads may read the clock meanwhile, but the time might
+            step back by the resolution of the previous source. Returns
+            false, if the source is not supported, in which case the
+            precise monotonic clock is used.
+        */
+        static bool setMonotonicSource(MonotonicSource source);
+
     private:
         class ClockImpl *_impl;
 };
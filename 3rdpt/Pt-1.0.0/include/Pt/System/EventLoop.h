@@ -33,13 +33,13 @@
 #include <Pt/Signal.h>
 #include <Pt/Timespan.h>
 #include <Pt/Allocator.h>
+#include <Pt/Atomicity.h>
 #include <Pt/Connectable.h>
 #include <Pt/System/Api.h>
 #include <Pt/System/Mutex.h>
 #include <Pt/System/Timer.h>
 #include <Pt/System/EventSink.h>
 #include <map>
-#include <deque>
 
 namespace Pt {
 
@@ -88,6 +88,16 @@ class PT_SYSTEM_API EventLoop : public Connectable
         void setReady(Selectable& s)
         { this->onReady(s); }
 
+        /** @brief Returns the time of the current loop iteration.
+
+            The monotonic clock is read once before the timers are
+            processed and once after the loop has waited, when the loop
+            time is first requested. Handlers can use the loop time instead
+            of reading the clock over and over.
+        */
+        Timespan loopTime() const
+        { return this->onLoopTime(); }
+
         //! @ internal
         virtual Selector& selector() = 0;
 
@@ -128,14 +138,36 @@ class PT_SYSTEM_API EventLoop : public Connectable
         //! @internal Mark the selectable as not ready
         virtual void onCancel(Selectable&) = 0;
 
+        /** @internal Returns the cached time of the loop iteration
+
+            The default implementation reads the monotonic clock.
+        */
+        virtual Timespan onLoopTime() const;
+
     private:
         Signal<> _exited;
         Signal<const Event&> _event;
 };
 
-//! @ internal
+/** @internal Multi-producer, single-consumer event queue
+
+    Events are pushed without locking onto an intrusive stack, the
+    consumer takes all pending events in one batch and dispatches them
+    in the order they were added. The list node is allocated in front of
+    each cloned event, so queuing an event needs only one allocation.
+    Custom allocators are not required to be thread-safe, calls to them
+    are serialized by a mutex.
+*/
 class PT_SYSTEM_API EventQueue
 {
+    class NodeAllocator;
+
+    struct Node
+    {
+        Node* next;
+        Event* event;
+    };
+
     public:
         EventQueue();
 
@@ -152,34 +184,106 @@ class PT_SYSTEM_API EventQueue
 
         bool processEvents(Signal<const Event&>& eventSignal);
 
+    private:
+        void destroy(Node* node);
+
     private:
         Mutex _mutex;
         Allocator _allocator;
         Allocator* _usedalloc;
-        std::deque<Event*> _eventQueue;
-        bool _exited;
+        void* volatile _head;
+        Node* _pending;
+        atomic_t _exited;
 };
 
 //! @ internal
 class PT_SYSTEM_API TimerQueue
+{
+    public:
+        virtual ~TimerQueue();
+
+        virtual void addTimer(Timer& timer) = 0;
+
+        virtual void removeTimer(Timer& timer) = 0;
+
+        virtual std::size_t processTimers(const Timespan& now) = 0;
+
+    protected:
+        TimerQueue();
+};
+
+//! @ internal Timer queue ordered by expiry time
+class PT_SYSTEM_API SortedTimerQueue : public TimerQueue
 {
     typedef std::multimap<Timespan, Timer*> TimerMap;
 
     public:
-        TimerQueue();
+        SortedTimerQueue();
 
-        virtual ~TimerQueue();
+        virtual ~SortedTimerQueue();
 
         void addTimer(Timer& timer);
 
         void removeTimer(Timer& timer);
 
-        std::size_t processTimers();
+        std::size_t processTimers(const Timespan& now);
 
     private:
         TimerMap _timers;
 };
 
+/** @internal Hierarchical timing wheel
+
+    Timers are hashed into slots of millisecond resolution. The first
+    level covers 256 ms, each of the four upper levels multiplies the
+    range by 64 and is cascaded down when the level below wraps. Each
+    Timer keeps its own slot handle, so starting, stopping and
+    restarting a timer is O(1). All timers of a slot are expired in one
+    batch when the slot is reached.
+*/
+class PT_SYSTEM_API TimerWheel : public TimerQueue
+{
+    public:
+        TimerWheel();
+
+        virtual ~TimerWheel();
+
+        void addTimer(Timer& timer);
+
+        void removeTimer(Timer& timer);
+
+        std::size_t processTimers(const Timespan& now);
+
+    private:
+        enum
+        {
+            Levels = 5,
+            RootBits = 8,
+            LevelBits = 6,
+            RootSize = 1 << RootBits,
+            LevelSize = 1 << LevelBits,
+            SlotCount = RootSize + (Levels - 1) * LevelSize,
+            ExpiredSlot = SlotCount
+        };
+
+        void place(Timer& timer);
+
+        void link(Timer& timer, int slot);
+
+        void unlink(Timer& timer);
+
+        void cascade(int level);
+
+        Pt::int64_t nextTick() const;
+
+    private:
+        Timer* _slots[SlotCount + 1];
+        Pt::uint64_t _bitmap[RootSize / 64 + Levels - 1];
+        Pt::int64_t _current;
+        std::size_t _count;
+        Timer* _running;
+};
+
 } // namespace System
 
 } // namespace Pt
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef PT_SYSTEM_EVENTLOOPPOOL_H
+#define PT_SYSTEM_EVENTLOOPPOOL_H
+
+#include <Pt/System/Api.h>
+#include <Pt/System/MainLoop.h>
+#include <Pt/NonCopyable.h>
+#include <Pt/Callable.h>
+#include <vector>
+#include <cstddef>
+
+namespace Pt {
+
+namespace System {
+
+/** @brief A pool of event loops, each running in its own thread.
+
+    The %EventLoopPool runs a MainLoop in each of its threads and binds
+    the threads to processors, so that the work of a loop stays on one
+    core. The loops are created with the pool, but only run when start()
+    is called. Selectables and Timers can be added to a loop before the
+    pool is started. Once the pool runs, work is handed to a loop with
+    post(), which invokes a callable in the thread of that loop.
+
+    Servers can distribute connections across the pool by listening on
+    the same address in every loop, using the reuse port option of the
+    Net::TcpServer. The kernel then spreads incoming connections across
+    the loops and no thread is a serial accept bottleneck.
+
+    @code
+    EventLoopPool pool;
+
+    for(std::size_t n = 0; n < pool.size(); ++n)
+    {
+        // add selectables to pool.loop(n)
+    }
+
+    pool.start();
+    pool.post(0, Pt::callable(worker, &Worker::update) );
+    @endcode
+*/
+class PT_SYSTEM_API EventLoopPool : private NonCopyable
+{
+    public:
+        /** @brief Constructs a pool of @a size loops.
+
+            If @a size is 0, one loop per processor is created.
+        */
+        explicit EventLoopPool(std::size_t size = 0);
+
+        //! @brief Constructs a pool of @a size loops with options.
+        EventLoopPool(std::size_t size, const MainLoopOptions& opts);
+
+        /** @brief Destructor
+
+            Stops the pool, if it is still running.
+        */
+        ~EventLoopPool();
+
+        //! @brief Returns the number of loops.
+        std::size_t size() const
+        { return _workers.size(); }
+
+        //! @brief Returns the loop with index @a n.
+        MainLoop& loop(std::size_t n);
+
+        //! @brief Returns true if the loops are running.
+        bool isRunning() const
+        { return _running; }
+
+        /** @brief Starts a thread for each loop.
+
+            The thread of the loop with index n is bound to the processor
+            n modulo the number of processors. Throws a SystemError if a
+            thread can not be started.
+        */
+        void start();
+
+        /** @brief Exits all loops and waits for the threads.
+
+            The loops can not be run again, after they have exited.
+        */
+        void stop();
+
+        /** @brief Invokes a callable in the thread of a loop.
+
+            The callable @a cb is copied and invoked by the loop with
+            index @a n, after all previously posted work. This method
+            is thread-safe.
+        */
+        void post(std::size_t n, const Callable<void>& cb);
+
+    private:
+        //! @internal
+        void init(std::size_t size, const MainLoopOptions& opts);
+
+    private:
+        class Worker;
+        std::vector<Worker*> _workers;
+        bool _running;
+};
+
+} // namespace System
+
+} // namespace Pt
+
+#endif // PT_SYSTEM_EVENTLOOPPOOL_H
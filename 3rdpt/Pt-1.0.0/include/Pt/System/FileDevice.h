@@ -70,6 +70,10 @@ class PT_SYSTEM_API FileDevice : public IODevice
         bool isOpen() const
         { return _isOpen; }
 
+        //! @internal
+        class FileDeviceImpl* impl() const
+        { return _impl; }
+
     protected:
         std::size_t onBeginRead(EventLoop& loop, char* buffer, std::size_t n, bool& eof);
 
@@ -33,6 +33,9 @@
 #include <Pt/System/IODevice.h>
 #include <Pt/Signal.h>
 #include <Pt/StreamBuffer.h>
+#include <Pt/RefCounted.h>
+#include <deque>
+#include <vector>
 
 namespace Pt {
 
@@ -66,6 +69,21 @@ class PT_SYSTEM_API IOBuffer : public BasicStreamBuffer<char>
         void reset();
 
         void discard();
+
+        //! @brief Queues caller-owned data for output without copying it
+        /**
+            The \a n bytes at \a data are sent after all data that was
+            written to the buffer so far, data written afterwards follows
+            them. The buffer keeps a reference to \a owner until the data
+            was written, so the memory must stay valid and unchanged for
+            as long as \a owner is alive. Queued data and buffered data
+            are written together with a vectored write of the I/O device.
+        */
+        void queue(const char* data, std::size_t n, RefCounted& owner);
+
+        //! @brief Returns the number of queued bytes not written yet
+        std::size_t queued() const
+        { return _oqueued; }
         
         void beginRead();
 
@@ -105,6 +123,26 @@ class PT_SYSTEM_API IOBuffer : public BasicStreamBuffer<char>
 
         virtual int_type pbackfail(int_type c);
 
+    private:
+        //! @internal
+        struct OutputRef
+        {
+            // owner of data or 0 for a range of the put area
+            RefCounted* owner;
+            const char* data;
+            std::size_t begin;
+            std::size_t end;
+        };
+
+        //! @internal
+        void initOutputVector();
+
+        //! @internal
+        void consumeOutput(std::size_t n);
+
+        //! @internal
+        void clearQueue();
+
     private:
         Signal<IOBuffer&> _inputReady;
         Signal<IOBuffer&> _outputReady;
@@ -114,6 +152,10 @@ class PT_SYSTEM_API IOBuffer : public BasicStreamBuffer<char>
         std::size_t  _obufferSize;
         char*        _obuffer;
         bool         _oextend;
+        std::deque<OutputRef> _oqueue;
+        std::vector<IOVec> _ovec;
+        std::size_t  _osealed;
+        std::size_t  _oqueued;
 
         static const int _pbmax = 4;
 };
@@ -40,6 +40,36 @@ namespace Pt {
 
 namespace System {
 
+/** @brief Memory segment for scatter/gather I/O
+
+    An %IOVec describes one contiguous region of memory that is read into
+    or written from by the vectored operations of an IODevice. A sequence
+    of segments is transferred in order, as if it was one buffer.
+*/
+struct IOVec
+{
+    IOVec()
+    : base(0)
+    , size(0)
+    { }
+
+    IOVec(char* b, std::size_t n)
+    : base(b)
+    , size(n)
+    { }
+
+    IOVec(const char* b, std::size_t n)
+    : base( const_cast<char*>(b) )
+    , size(n)
+    { }
+
+    //! @brief Start of the memory segment
+    char* base;
+
+    //! @brief Size of the memory segment
+    std::size_t size;
+};
+
 /** @brief Endpoint for I/O operations
 
     This class serves as the base class for all kinds of I/O devices. The
@@ -103,6 +133,58 @@ class PT_SYSTEM_API IODevice : public Selectable
          */
         std::size_t write(const char* buffer, std::size_t n);
 
+        //! @brief Begins to read data into a sequence of buffers
+        /**
+            Starts an asynchronous read, which scatters the received data
+            over the \a count segments of \a vec. The segments must stay
+            valid until the operation is completed with endRead().
+
+            \param vec buffer segments to read into.
+            \param count number of segments.
+            \throw IOError, IOPending
+        */
+        void beginReadv(IOVec* vec, std::size_t count);
+
+        //! @brief Read data into a sequence of buffers
+        /**
+            Reads up to the total size of all segments and stores the data
+            in order. Returns the number of bytes read, which may be less
+            than requested. Devices without native support for vectored
+            I/O read into the first non-empty segment only.
+
+            \param vec buffer segments to read into.
+            \param count number of segments.
+            \return number of bytes read, which may be less than requested.
+            \throw IOError
+        */
+        std::size_t readv(IOVec* vec, std::size_t count);
+
+        //! @brief Begins to write data from a sequence of buffers
+        /**
+            Starts an asynchronous write, which gathers the data of the
+            \a count segments of \a vec without copying it. The segments
+            must stay valid until the operation is completed with endWrite().
+
+            \param vec buffer segments to write.
+            \param count number of segments.
+            \throw IOError, IOPending
+        */
+        void beginWritev(const IOVec* vec, std::size_t count);
+
+        //! @brief Write data from a sequence of buffers
+        /**
+            Writes the segments in order and returns the number of bytes
+            written, which may be less than requested. Devices without
+            native support for vectored I/O write the first non-empty
+            segment only.
+
+            \param vec buffer segments to write.
+            \param count number of segments.
+            \return number of bytes written, which may be less than requested.
+            \throw IOError
+        */
+        std::size_t writev(const IOVec* vec, std::size_t count);
+
         //! @brief Returns true if device is seekable
         /**
             Tests if the device is seekable.
@@ -232,6 +314,24 @@ class PT_SYSTEM_API IODevice : public Selectable
         //! @brief Write bytes to device
         virtual std::size_t onWrite(const char* buffer, std::size_t count) = 0;
 
+        //! @brief Begins a vectored read, reads the first segment by default
+        virtual std::size_t onBeginReadv(EventLoop& loop, IOVec* vec, std::size_t count, bool& eof);
+
+        //! @brief Ends a vectored read, reads the first segment by default
+        virtual std::size_t onEndReadv(EventLoop& loop, IOVec* vec, std::size_t count, bool& eof);
+
+        //! @brief Read into buffer segments, reads the first segment by default
+        virtual std::size_t onReadv(IOVec* vec, std::size_t count, bool& eof);
+
+        //! @brief Begins a vectored write, writes the first segment by default
+        virtual std::size_t onBeginWritev(EventLoop& loop, const IOVec* vec, std::size_t count);
+
+        //! @brief Ends a vectored write, writes the first segment by default
+        virtual std::size_t onEndWritev(EventLoop& loop, const IOVec* vec, std::size_t count);
+
+        //! @brief Write buffer segments, writes the first segment by default
+        virtual std::size_t onWritev(const IOVec* vec, std::size_t count);
+
         //! @brief Read data from I/O device without consuming them
         virtual std::size_t onPeek(char* buffer, std::size_t)
         { return 0; }
@@ -266,6 +366,10 @@ class PT_SYSTEM_API IODevice : public Selectable
         const char* _wbuf;
         std::size_t _wbuflen;
         std::size_t _wavail;
+        IOVec* _rvec;
+        std::size_t _rveclen;
+        const IOVec* _wvec;
+        std::size_t _wveclen;
         Signal<IODevice&> _inputReady;
         Signal<IODevice&> _outputReady;
         Pt::varint_t _reserved;
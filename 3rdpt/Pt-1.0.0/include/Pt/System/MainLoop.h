@@ -31,11 +31,80 @@
 
 #include <Pt/System/Api.h>
 #include <Pt/System/EventLoop.h>
+#include <Pt/Types.h>
 
 namespace Pt {
 
 namespace System {
 
+/** @brief MainLoop options.
+
+    The options select the implementation strategies of a MainLoop. By
+    default, timers are kept in a queue ordered by expiry time. Loops
+    with many timers, which are frequently restarted or stopped, should
+    use a timer wheel, which starts and stops timers in constant time.
+
+    Loops with many long-lived connections can use edge-triggered I/O
+    notification, where each device is registered with the selector only
+    once. On Linux, such loops use an epoll selector instead of the
+    default selector. The option is ignored on other platforms.
+
+    On Linux, loops can use completion-based I/O through io_uring. Reads,
+    writes and accepts of sockets and pipes, which would block, are then
+    submitted to the kernel and completed without a separate readiness
+    notification. If the kernel does not support io_uring, the loop uses
+    an epoll selector.
+*/
+class PT_SYSTEM_API MainLoopOptions
+{
+    public:
+        MainLoopOptions();
+
+        MainLoopOptions(const MainLoopOptions& opts);
+
+        ~MainLoopOptions();
+
+        MainLoopOptions& operator=(const MainLoopOptions& opts);
+
+        //! @brief Returns true if timers are managed by a timer wheel.
+        bool useTimerWheel() const
+        { return (_flags & WheelTimers) != 0; }
+
+        //! @brief Manage timers by a hierarchical timer wheel.
+        void setTimerWheel()
+        { _flags |= WheelTimers; }
+
+        //! @brief Returns true if I/O readiness is edge-triggered.
+        bool isEdgeTriggered() const
+        { return (_flags & EdgeTriggered) != 0; }
+
+        //! @brief Use edge-triggered I/O readiness notification.
+        void setEdgeTriggered()
+        { _flags |= EdgeTriggered; }
+
+        //! @brief Returns true if the selector should use io_uring.
+        bool useIoUring() const
+        { return (_flags & IoUring) != 0; }
+
+        //! @brief Complete I/O operations through io_uring, if available.
+        void setIoUring()
+        { _flags |= IoUring; }
+
+    private:
+        //! @internal
+        enum Flags
+        {
+            WheelTimers = 1,
+            EdgeTriggered = 2,
+            IoUring = 4
+        };
+
+        Pt::uint32_t _flags;
+        varint_t _r0;
+        varint_t _r1;
+        varint_t _r2;
+};
+
 /** @brief Thread-safe event loop supporting I/O multiplexing and Timers.
 
     An %MainLoop can be used to monitor a set of Selectables and Timers
@@ -101,10 +170,20 @@ class PT_SYSTEM_API MainLoop : public EventLoop
 
         MainLoop(Allocator& a);
 
+        /** @brief Constructs the MainLoop with options
+        */
+        explicit MainLoop(const MainLoopOptions& opts);
+
+        MainLoop(Allocator& a, const MainLoopOptions& opts);
+
         /** @brief Destructs the MainLoop
           */
         virtual ~MainLoop();
 
+        //! @brief Returns the options the loop was constructed with.
+        const MainLoopOptions& options() const
+        { return _options; }
+
         //! @internal
         Selector& selector();
 
@@ -134,7 +213,10 @@ class PT_SYSTEM_API MainLoop : public EventLoop
     
         virtual void onDetachTimer(Timer& timer);
 
+        virtual Timespan onLoopTime() const;
+
     private:
+        MainLoopOptions _options;
         class MainLoopImpl* _impl;
 };
 
@@ -0,0 +1,272 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef PT_SYSTEM_MPMCQUEUE_H
+#define PT_SYSTEM_MPMCQUEUE_H
+
+#include <Pt/System/Api.h>
+#include <Pt/System/QueueSignal.h>
+#include <Pt/NonCopyable.h>
+#include <Pt/Atomicity.h>
+#include <cstddef>
+
+namespace Pt {
+
+namespace System {
+
+/** @brief Bounded lock-free queue for many producers and consumers.
+
+    The %MpmcQueue is a fixed size ring buffer, which can be used by any
+    number of threads. Each slot has a sequence number, which tells the
+    producers and consumers whether the slot is free or holds an
+    element, so that only the positions need to be updated with an
+    atomic compare-and-exchange. The non-blocking tryPut() and tryGet()
+    fail if the queue is full or empty. The blocking put() and get()
+    only wait on a condition, when the ring is full or empty.
+
+    The element type must be default constructible and assignable.
+*/
+template <typename T>
+class MpmcQueue : private NonCopyable
+{
+    public:
+        typedef T value_type;
+        typedef std::size_t size_type;
+        typedef const T& const_reference;
+
+    public:
+        /** @brief Constructs a queue for at least @a capacity elements.
+
+            The capacity is rounded up to a power of two.
+        */
+        explicit MpmcQueue(size_type capacity);
+
+        //! @brief Destructor.
+        ~MpmcQueue()
+        { delete [] _cells; }
+
+        //! @brief Adds an element, returns false if the queue is full.
+        bool tryPut(const_reference element);
+
+        //! @brief Takes the next element, returns false if the queue is empty.
+        bool tryGet(value_type& element);
+
+        //! @brief Adds an element and blocks while the queue is full.
+        void put(const_reference element);
+
+        //! @brief Returns the next element and blocks while the queue is empty.
+        value_type get();
+
+        //! @brief Returns true, if the queue is empty.
+        bool empty() const
+        { return size() == 0; }
+
+        //! @brief Returns the approximate number of elements in queue.
+        size_type size() const
+        {
+            int n = ringDiff( atomicGet(_enqueuePos), atomicGet(_dequeuePos) );
+            return n > 0 ? static_cast<size_type>(n) : 0;
+        }
+
+        //! @brief Returns the maximum number of elements.
+        size_type capacity() const
+        { return _mask + 1; }
+
+    private:
+        bool push(const_reference element);
+
+        bool pop(value_type& element);
+
+    private:
+        enum { CacheLine = 64 };
+
+        struct Cell
+        {
+            atomic_t sequence;
+            value_type value;
+        };
+
+        mutable atomic_t _enqueuePos;
+        char _pad0[CacheLine];
+
+        mutable atomic_t _dequeuePos;
+        char _pad1[CacheLine];
+
+        Cell* _cells;
+        size_type _mask;
+        QueueSignal _notEmpty;
+        QueueSignal _notFull;
+};
+
+template <typename T>
+MpmcQueue<T>::MpmcQueue(size_type capacity)
+: _enqueuePos(0)
+, _dequeuePos(0)
+, _cells(0)
+, _mask( ringCapacity(capacity) - 1 )
+{
+    _cells = new Cell[_mask + 1];
+
+    for(size_type n = 0; n <= _mask; ++n)
+        atomicSet(_cells[n].sequence, static_cast<int>(n));
+}
+
+template <typename T>
+bool MpmcQueue<T>::tryPut(const_reference element)
+{
+    if( ! push(element) )
+        return false;
+
+    _notEmpty.notify();
+    return true;
+}
+
+template <typename T>
+bool MpmcQueue<T>::tryGet(value_type& element)
+{
+    if( ! pop(element) )
+        return false;
+
+    _notFull.notify();
+    return true;
+}
+
+template <typename T>
+bool MpmcQueue<T>::push(const_reference element)
+{
+    int pos = atomicGet(_enqueuePos);
+
+    while(true)
+    {
+        Cell& cell = _cells[pos & _mask];
+        int diff = ringDiff( atomicGet(cell.sequence), pos );
+
+        if(diff == 0)
+        {
+            // the slot is free, claim the position
+            int prev = atomicCompareExchange(_enqueuePos, ringIndex(pos, 1), pos);
+            if(prev == pos)
+            {
+                cell.value = element;
+                atomicExchange(cell.sequence, ringIndex(pos, 1));
+                return true;
+            }
+
+            pos = prev;
+        }
+        else if(diff < 0)
+        {
+            // the slot was not consumed yet
+            return false;
+        }
+        else
+        {
+            pos = atomicGet(_enqueuePos);
+        }
+    }
+}
+
+template <typename T>
+bool MpmcQueue<T>::pop(value_type& element)
+{
+    int pos = atomicGet(_dequeuePos);
+
+    while(true)
+    {
+        Cell& cell = _cells[pos & _mask];
+        int diff = ringDiff( atomicGet(cell.sequence), ringIndex(pos, 1) );
+
+        if(diff == 0)
+        {
+            // the slot holds an element, claim the position
+            int prev = atomicCompareExchange(_dequeuePos, ringIndex(pos, 1), pos);
+            if(prev == pos)
+            {
+                element = cell.value;
+                atomicExchange(cell.sequence, ringIndex(pos, static_cast<int>(_mask) + 1));
+                return true;
+            }
+
+            pos = prev;
+        }
+        else if(diff < 0)
+        {
+            // the slot was not produced yet
+            return false;
+        }
+        else
+        {
+            pos = atomicGet(_dequeuePos);
+        }
+    }
+}
+
+template <typename T>
+void MpmcQueue<T>::put(const_reference element)
+{
+    // the signals are notified without holding the other mutex
+    if( ! push(element) )
+    {
+        MutexLock lock( _notFull.mutex() );
+        _notFull.enter();
+
+        while( ! push(element) )
+            _notFull.wait(lock);
+
+        _notFull.leave();
+    }
+
+    _notEmpty.notify();
+}
+
+template <typename T>
+typename MpmcQueue<T>::value_type MpmcQueue<T>::get()
+{
+    value_type element;
+
+    if( ! pop(element) )
+    {
+        MutexLock lock( _notEmpty.mutex() );
+        _notEmpty.enter();
+
+        while( ! pop(element) )
+            _notEmpty.wait(lock);
+
+        _notEmpty.leave();
+    }
+
+    _notFull.notify();
+    return element;
+}
+
+} // namespace System
+
+} // namespace Pt
+
+#endif // PT_SYSTEM_MPMCQUEUE_H
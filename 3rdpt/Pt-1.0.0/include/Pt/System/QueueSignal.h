@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef PT_SYSTEM_QUEUESIGNAL_H
+#define PT_SYSTEM_QUEUESIGNAL_H
+
+#include <Pt/System/Api.h>
+#include <Pt/System/Mutex.h>
+#include <Pt/System/Condition.h>
+#include <Pt/NonCopyable.h>
+#include <Pt/Atomicity.h>
+#include <cstddef>
+
+namespace Pt {
+
+namespace System {
+
+/** @internal
+    @brief Blocks threads on a lock-free queue, which is full or empty.
+
+    Waiting threads register themselves with enter() before they check
+    the queue again and then wait. Threads which change the queue call
+    notify() afterwards, which only locks the mutex, if there are
+    waiting threads. Because both sides use full memory barriers, either
+    the waiting thread sees the change or the notifying thread sees the
+    waiting thread.
+*/
+class QueueSignal : private NonCopyable
+{
+    public:
+        QueueSignal()
+        : _waiters(0)
+        { }
+
+        Mutex& mutex()
+        { return _mutex; }
+
+        void enter()
+        { atomicIncrement(_waiters); }
+
+        void leave()
+        { atomicDecrement(_waiters); }
+
+        void wait(MutexLock& lock)
+        { _cond.wait(lock); }
+
+        void notify()
+        {
+            if( atomicGet(_waiters) > 0 )
+            {
+                MutexLock lock(_mutex);
+                _cond.broadcast();
+            }
+        }
+
+    private:
+        atomic_t _waiters;
+        Mutex _mutex;
+        Condition _cond;
+};
+
+//! @internal
+inline std::size_t ringCapacity(std::size_t n)
+{
+    std::size_t cap = 2;
+    while(cap < n)
+        cap <<= 1;
+
+    return cap;
+}
+
+//! @internal
+inline int ringIndex(int i, int n)
+{
+    return static_cast<int>( static_cast<unsigned>(i) + static_cast<unsigned>(n) );
+}
+
+//! @internal
+inline int ringDiff(int a, int b)
+{
+    return static_cast<int>( static_cast<unsigned>(a) - static_cast<unsigned>(b) );
+}
+
+} // namespace System
+
+} // namespace Pt
+
+#endif // PT_SYSTEM_QUEUESIGNAL_H
@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef PT_SYSTEM_SPSCQUEUE_H
+#define PT_SYSTEM_SPSCQUEUE_H
+
+#include <Pt/System/Api.h>
+#include <Pt/System/QueueSignal.h>
+#include <Pt/NonCopyable.h>
+#include <Pt/Atomicity.h>
+#include <cstddef>
+
+namespace Pt {
+
+namespace System {
+
+/** @brief Bounded lock-free queue for one producer and one consumer.
+
+    The %SpscQueue is a fixed size ring buffer for handing elements from
+    one thread to exactly one other thread. Unlike the Queue, no mutex
+    is locked to put or get an element. The non-blocking tryPut() and
+    tryGet() fail if the queue is full or empty. The blocking put() and
+    get() only wait on a condition, when the ring is full or empty.
+
+    The producer and consumer positions are kept on separate cache
+    lines. The element type must be default constructible and
+    assignable.
+*/
+template <typename T>
+class SpscQueue : private NonCopyable
+{
+    public:
+        typedef T value_type;
+        typedef std::size_t size_type;
+        typedef const T& const_reference;
+
+    public:
+        /** @brief Constructs a queue for at least @a capacity elements.
+
+            The capacity is rounded up to a power of two.
+        */
+        explicit SpscQueue(size_type capacity);
+
+        //! @brief Destructor.
+        ~SpscQueue()
+        { delete [] _slots; }
+
+        /** @brief Adds an element, if the queue is not full.
+
+            Returns false, if the queue is full. Must only be called by
+            the producer.
+        */
+        bool tryPut(const_reference element);
+
+        /** @brief Takes the next element, if the queue is not empty.
+
+            Returns false, if the queue is empty. Must only be called by
+            the consumer.
+        */
+        bool tryGet(value_type& element);
+
+        //! @brief Adds an element and blocks while the queue is full.
+        void put(const_reference element);
+
+        //! @brief Returns the next element and blocks while the queue is empty.
+        value_type get();
+
+        //! @brief Returns true, if the queue is empty.
+        bool empty() const
+        { return size() == 0; }
+
+        //! @brief Returns the number of elements currently in queue.
+        size_type size() const
+        {
+            int n = ringDiff( atomicGet(_tail), atomicGet(_head) );
+            return n > 0 ? static_cast<size_type>(n) : 0;
+        }
+
+        //! @brief Returns the maximum number of elements.
+        size_type capacity() const
+        { return _mask + 1; }
+
+    private:
+        bool push(const_reference element);
+
+        bool pop(value_type& element);
+
+    private:
+        enum { CacheLine = 64 };
+
+        // consumer
+        mutable atomic_t _head;
+        int _tailCache;
+        char _pad0[CacheLine];
+
+        // producer
+        mutable atomic_t _tail;
+        int _headCache;
+        char _pad1[CacheLine];
+
+        value_type* _slots;
+        size_type _mask;
+        QueueSignal _notEmpty;
+        QueueSignal _notFull;
+};
+
+template <typename T>
+SpscQueue<T>::SpscQueue(size_type capacity)
+: _head(0)
+, _tailCache(0)
+, _tail(0)
+, _headCache(0)
+, _slots(0)
+, _mask( ringCapacity(capacity) - 1 )
+{
+    _slots = new value_type[_mask + 1];
+}
+
+template <typename T>
+bool SpscQueue<T>::tryPut(const_reference element)
+{
+    if( ! push(element) )
+        return false;
+
+    _notEmpty.notify();
+    return true;
+}
+
+template <typename T>
+bool SpscQueue<T>::tryGet(value_type& element)
+{
+    if( ! pop(element) )
+        return false;
+
+    _notFull.notify();
+    return true;
+}
+
+template <typename T>
+bool SpscQueue<T>::push(const_reference element)
+{
+    int tail = atomicGet(_tail);
+
+    if( ringDiff(tail, _headCache) > static_cast<int>(_mask) )
+    {
+        _headCache = atomicGet(_head);
+        if( ringDiff(tail, _headCache) > static_cast<int>(_mask) )
+            return false;
+    }
+
+    _slots[tail & _mask] = element;
+    atomicExchange(_tail, ringIndex(tail, 1));
+    return true;
+}
+
+template <typename T>
+bool SpscQueue<T>::pop(value_type& element)
+{
+    int head = atomicGet(_head);
+
+    if( ringDiff(_tailCache, head) <= 0 )
+    {
+        _tailCache = atomicGet(_tail);
+        if( ringDiff(_tailCache, head) <= 0 )
+            return false;
+    }
+
+    element = _slots[head & _mask];
+    atomicExchange(_head, ringIndex(head, 1));
+    return true;
+}
+
+template <typename T>
+void SpscQueue<T>::put(const_reference element)
+{
+    // the signals are notified without holding the other mutex
+    if( ! push(element) )
+    {
+        MutexLock lock( _notFull.mutex() );
+        _notFull.enter();
+
+        while( ! push(element) )
+            _notFull.wait(lock);
+
+        _notFull.leave();
+    }
+
+    _notEmpty.notify();
+}
+
+template <typename T>
+typename SpscQueue<T>::value_type SpscQueue<T>::get()
+{
+    value_type element;
+
+    if( ! pop(element) )
+    {
+        MutexLock lock( _notEmpty.mutex() );
+        _notEmpty.enter();
+
+        while( ! pop(element) )
+            _notEmpty.wait(lock);
+
+        _notEmpty.leave();
+    }
+
+    _notFull.notify();
+    return element;
+}
+
+} // namespace System
+
+} // namespace Pt
+
+#endif // PT_SYSTEM_SPSCQUEUE_H
@@ -0,0 +1,377 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef PT_SYSTEM_TASKPOOL_H
+#define PT_SYSTEM_TASKPOOL_H
+
+#include <Pt/System/Api.h>
+#include <Pt/System/Mutex.h>
+#include <Pt/System/Condition.h>
+#include <Pt/NonCopyable.h>
+#include <Pt/Callable.h>
+#include <Pt/Allocator.h>
+#include <Pt/Atomicity.h>
+#include <Pt/Event.h>
+#include <vector>
+#include <deque>
+#include <cstddef>
+
+namespace Pt {
+
+namespace System {
+
+class EventLoop;
+class TaskGroup;
+class TaskWorker;
+
+/** @internal
+    @brief Unit of work executed by a TaskPool.
+*/
+class PT_SYSTEM_API Task
+{
+    friend class TaskPool;
+    friend class TaskGroup;
+
+    public:
+        Task()
+        : _group(0)
+        { }
+
+        virtual ~Task()
+        { }
+
+        virtual void run() = 0;
+
+    private:
+        TaskGroup* _group;
+};
+
+/** @brief Work-stealing thread pool.
+
+    A %TaskPool runs tasks on a fixed number of worker threads. Each
+    worker keeps its own queue of tasks. Tasks spawned by a worker
+    are put into its own queue, where they are taken in LIFO order,
+    while idle workers steal from the other end of the queues. Tasks
+    spawned by other threads are put into a shared queue.
+
+    Tasks are run as part of a TaskGroup, which can be waited for. A
+    thread waiting for a group runs pending tasks of the pool until
+    the group is finished. The parallelFor() and parallelReduce()
+    helpers split a range of indices into tasks.
+
+    @code
+    TaskPool pool;
+    TaskGroup group(pool);
+
+    group.run( Pt::callable(zoneA, &Zone::update) );
+    group.run( Pt::callable(zoneB, &Zone::update) );
+    group.wait();
+    @endcode
+*/
+class PT_SYSTEM_API TaskPool : private NonCopyable
+{
+    friend class TaskGroup;
+    friend class TaskWorker;
+
+    public:
+        /** @brief Starts a pool with @a threads workers.
+
+            If @a threads is 0, one worker per processor is started.
+        */
+        explicit TaskPool(std::size_t threads = 0);
+
+        /** @brief Destructor
+
+            Waits until all pending tasks are done and the workers have
+            finished.
+        */
+        ~TaskPool();
+
+        //! @brief Returns the number of worker threads.
+        std::size_t size() const
+        { return _workers.size(); }
+
+        /** @brief Runs one pending task in the calling thread.
+
+            Returns false if no task was found.
+        */
+        bool runPending();
+
+        //! @internal
+        void spawn(Task* task);
+
+    private:
+        //! @internal
+        void stop(std::size_t started);
+
+        //! @internal
+        Task* take(TaskWorker* self);
+
+        //! @internal
+        void execute(Task* task);
+
+        //! @internal
+        bool hasWork();
+
+        //! @internal
+        void work(TaskWorker& worker);
+
+    private:
+        std::vector<TaskWorker*> _workers;
+        Mutex _mutex;
+        Condition _wake;
+        std::deque<Task*> _shared;
+        atomic_t _idle;
+        bool _stopped;
+};
+
+/** @brief A group of tasks which can be waited for.
+
+    Tasks are added to a group with run() and executed by the TaskPool
+    of the group. Tasks may add more tasks to their group. When all tasks
+    are finished, wait() returns and an event can be committed to an
+    EventLoop, so that the results are processed in the thread of that
+    loop.
+
+    The destructor waits for all tasks of the group.
+*/
+class PT_SYSTEM_API TaskGroup : private NonCopyable
+{
+    friend class TaskPool;
+
+    public:
+        //! @brief Constructs a group of tasks run by @a pool.
+        explicit TaskGroup(TaskPool& pool);
+
+        //! @brief Waits for all tasks and destructs the group.
+        ~TaskGroup();
+
+        //! @brief Returns the pool, which runs the tasks.
+        TaskPool& pool()
+        { return _pool; }
+
+        //! @brief Runs a copy of the callable @a cb as task.
+        void run(const Callable<void>& cb);
+
+        //! @internal @brief Runs @a task and takes ownership.
+        void run(Task* task);
+
+        /** @brief Waits until all tasks are finished.
+
+            The calling thread runs pending tasks of the pool, while
+            the group is not finished.
+        */
+        void wait();
+
+        //! @brief Returns true if no task of the group is pending.
+        bool isFinished() const;
+
+        /** @brief Commits an event to a loop when the group is finished.
+
+            A copy of @a ev is committed to @a loop once, when the last
+            pending task of the group has finished. If no task is pending,
+            the event is committed immediately.
+        */
+        void commitWhenFinished(EventLoop& loop, const Event& ev);
+
+    private:
+        //! @internal
+        void finishTask();
+
+        //! @internal
+        void clearEvent();
+
+    private:
+        TaskPool& _pool;
+        atomic_t _pending;
+        mutable Mutex _mutex;
+        Condition _finished;
+        bool _busy;
+        EventLoop* _loop;
+        Event* _event;
+        Allocator _allocator;
+};
+
+//! @internal
+template <typename F>
+class ForTask : public Task
+{
+    public:
+        ForTask(TaskGroup& group, F& f, std::size_t begin, std::size_t end, std::size_t grain)
+        : _group(group)
+        , _f(f)
+        , _begin(begin)
+        , _end(end)
+        , _grain(grain)
+        { }
+
+        virtual void run()
+        {
+            // split off the upper halves for other workers to steal
+            while(_end - _begin > _grain)
+            {
+                std::size_t mid = _begin + (_end - _begin) / 2;
+                _group.run( new ForTask(_group, _f, mid, _end, _grain) );
+                _end = mid;
+            }
+
+            for(std::size_t n = _begin; n < _end; ++n)
+                _f(n);
+        }
+
+    private:
+        TaskGroup& _group;
+        F& _f;
+        std::size_t _begin;
+        std::size_t _end;
+        std::size_t _grain;
+};
+
+/** @internal
+    @brief Result of a part of a reduction.
+
+    The results are padded, so that workers writing the results of
+    neighbouring parts do not share a cache line. A plain std::vector<T>
+    would also pack the results of std::vector<bool> into bits.
+*/
+template <typename T>
+struct ReducePart
+{
+    explicit ReducePart(const T& init)
+    : value(init)
+    { }
+
+    T value;
+    char padding[64];
+};
+
+//! @internal
+template <typename T, typename Map, typename Reduce>
+class ReduceTask : public Task
+{
+    public:
+        ReduceTask(T& result, const T& init, Map& map, Reduce& reduce,
+                   std::size_t begin, std::size_t end)
+        : _result(result)
+        , _init(init)
+        , _map(map)
+        , _reduce(reduce)
+        , _begin(begin)
+        , _end(end)
+        { }
+
+        virtual void run()
+        {
+            T acc = _init;
+            for(std::size_t n = _begin; n < _end; ++n)
+                acc = _reduce(acc, _map(n));
+
+            _result = acc;
+        }
+
+    private:
+        T& _result;
+        const T& _init;
+        Map& _map;
+        Reduce& _reduce;
+        std::size_t _begin;
+        std::size_t _end;
+};
+
+//! @internal
+inline std::size_t defaultGrain(const TaskPool& pool, std::size_t count)
+{
+    std::size_t parts = pool.size() * 4;
+    std::size_t grain = parts > 0 ? count / parts : count;
+    return grain > 0 ? grain : 1;
+}
+
+/** @brief Calls @a f for each index in [@a begin, @a end) in parallel.
+
+    The range is split into parts of at least @a grain indices. If
+    @a grain is 0, a size is chosen based on the size of the pool.
+    Returns when @a f was called for all indices.
+*/
+template <typename F>
+void parallelFor(TaskPool& pool, std::size_t begin, std::size_t end, F f,
+                 std::size_t grain = 0)
+{
+    if(begin >= end)
+        return;
+
+    if(grain == 0)
+        grain = defaultGrain(pool, end - begin);
+
+    TaskGroup group(pool);
+    group.run( new ForTask<F>(group, f, begin, end, grain) );
+    group.wait();
+}
+
+/** @brief Maps and reduces the indices in [@a begin, @a end) in parallel.
+
+    Each index is mapped by @a map and the results are combined by
+    @a reduce, starting with the identity value @a init. The range is
+    split into parts of at least @a grain indices. If @a grain is 0,
+    a size is chosen based on the size of the pool.
+*/
+template <typename T, typename Map, typename Reduce>
+T parallelReduce(TaskPool& pool, std::size_t begin, std::size_t end, const T& init,
+                 Map map, Reduce reduce, std::size_t grain = 0)
+{
+    if(begin >= end)
+        return init;
+
+    if(grain == 0)
+        grain = defaultGrain(pool, end - begin);
+
+    std::size_t parts = (end - begin + grain - 1) / grain;
+    std::vector< ReducePart<T> > results( parts, ReducePart<T>(init) );
+
+    TaskGroup group(pool);
+    for(std::size_t n = 0; n < parts; ++n)
+    {
+        std::size_t first = begin + n * grain;
+        std::size_t last = first + grain < end ? first + grain : end;
+        group.run( new ReduceTask<T, Map, Reduce>(results[n].value, init, map, reduce, first, last) );
+    }
+
+    group.wait();
+
+    T acc = init;
+    for(std::size_t n = 0; n < parts; ++n)
+        acc = reduce(acc, results[n].value);
+
+    return acc;
+}
+
+} // namespace System
+
+} // namespace Pt
+
+#endif // PT_SYSTEM_TASKPOOL_H
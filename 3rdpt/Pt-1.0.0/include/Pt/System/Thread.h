@@ -34,6 +34,7 @@
 #include <Pt/Callable.h>
 #include <Pt/Function.h>
 #include <Pt/Method.h>
+#include <cstddef>
 
 namespace Pt {
 
@@ -133,6 +134,14 @@ class PT_SYSTEM_API Thread : protected NonCopyable
         //! @brief Wait for the thread to finish execution.
         void join();
 
+        /** @brief Binds the thread to a processor
+
+            Restricts a running thread to the processor with the index
+            \a cpu. Returns false if the thread is not running or the
+            platform does not support processor affinity.
+        */
+        bool setAffinity(std::size_t cpu);
+
         /** @brief Exits athread.
 
             This function is meant to be called from within a thread to
@@ -156,6 +165,9 @@ class PT_SYSTEM_API Thread : protected NonCopyable
         */
         static void sleep(unsigned int ms);
 
+        //! @brief Returns the number of available processors.
+        static std::size_t processorCount();
+
     protected:
         //! @internal
         bool joinNoThrow();
@@ -70,6 +70,7 @@ namespace System {
 class PT_SYSTEM_API Timer
 {
     class Sentry;
+    friend class TimerWheel;
 
     public:
         /** @brief Default constructor
@@ -149,6 +150,11 @@ class PT_SYSTEM_API Timer
         Timespan    _finished;
         Signal<>    _timeout;
         void*       _reserved;
+
+        // slot handle of the TimerWheel
+        Timer*      _slotNext;
+        Timer*      _slotPrev;
+        int         _slot;
 };
 
 } // namespace System
@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <Pt/Unit/Assertion.h>
+#include <Pt/Unit/TestSuite.h>
+#include <Pt/Unit/RegisterTest.h>
+#include <Pt/Net/TcpServer.h>
+#include <Pt/Net/TcpSocket.h>
+#include <Pt/Net/Endpoint.h>
+#include <Pt/System/ChainBuffer.h>
+#include <Pt/System/MainLoop.h>
+#include <Pt/System/Timer.h>
+#include <Pt/RefCounted.h>
+#include <string>
+
+namespace {
+
+std::string pattern(std::size_t size, int seed)
+{
+    std::string s(size, '\0');
+    for(std::size_t n = 0; n < size; ++n)
+        s[n] = static_cast<char>(n * 31 + seed);
+
+    return s;
+}
+
+
+std::string readAll(Pt::System::ChainBuffer& buffer, std::size_t size)
+{
+    std::string data(size, '\0');
+    std::streamsize n = buffer.sgetn(&data[0], static_cast<std::streamsize>(size));
+    data.resize( static_cast<std::size_t>(n) );
+    return data;
+}
+
+
+class Payload : public Pt::RefCounted
+{
+    public:
+        explicit Payload(const std::string& data)
+        : Pt::RefCounted(1)
+        , data(data)
+        {}
+
+        std::string data;
+};
+
+}
+
+
+class ChainBufferTest : public Pt::Unit::TestSuite
+{
+    public:
+        ChainBufferTest()
+        : Pt::Unit::TestSuite("ChainBufferTest")
+        , _loop(0)
+        , _timedOut(false)
+        {
+            this->registerMethod("idleReadHoldsNoSlabs", *this, &ChainBufferTest::idleReadHoldsNoSlabs);
+            this->registerMethod("largeMessage", *this, &ChainBufferTest::largeMessage);
+            this->registerMethod("queueOutput", *this, &ChainBufferTest::queueOutput);
+        }
+
+        void idleReadHoldsNoSlabs()
+        {
+            Pt::System::MainLoop loop;
+            _loop = &loop;
+
+            Pt::System::Timer guard;
+            guard.timeout() += Pt::slot(*this, &ChainBufferTest::onTimeout);
+            guard.setActive(loop);
+            guard.start(10000);
+
+            Pt::Net::TcpServer server;
+            server.listen( Pt::Net::Endpoint::ip4Loopback(0) );
+
+            Pt::Net::Endpoint ep;
+            server.localEndpoint(ep);
+
+            Pt::Net::TcpSocket client(ep);
+            Pt::Net::TcpSocket peer(server);
+            peer.setActive(loop);
+
+            Pt::System::ChainBuffer reader(peer);
+            reader.inputReady() += Pt::slot(*this, &ChainBufferTest::onInput);
+
+            reader.beginRead();
+            PT_UNIT_ASSERT( reader.isReading() );
+            PT_UNIT_ASSERT_EQUALS(reader.slabCount(), 0u);
+
+            client.write("hello", 5);
+
+            _timedOut = false;
+            loop.run();
+
+            PT_UNIT_ASSERT( ! _timedOut );
+            PT_UNIT_ASSERT_EQUALS(reader.slabCount(), 1u);
+            PT_UNIT_ASSERT_EQUALS(reader.in_avail(), 5);
+            PT_UNIT_ASSERT_EQUALS(readAll(reader, 5), std::string("hello"));
+
+            // the consumed slab is returned before the next read waits
+            reader.beginRead();
+            PT_UNIT_ASSERT_EQUALS(reader.slabCount(), 0u);
+
+            peer.cancel();
+        }
+
+        void largeMessage()
+        {
+            Pt::Net::TcpServer server;
+            server.listen( Pt::Net::Endpoint::ip4Loopback(0) );
+
+            Pt::Net::Endpoint ep;
+            server.localEndpoint(ep);
+
+            Pt::Net::TcpSocket client(ep);
+            Pt::Net::TcpSocket peer(server);
+
+            Pt::System::ChainBuffer writer(client);
+            Pt::System::ChainBuffer reader(peer);
+
+            // larger than a slab and not a multiple of it
+            const std::string message = pattern(5 * Pt::System::ChainBuffer::SlabSize + 123, 1);
+
+            writer.sputn(message.data(), static_cast<std::streamsize>(message.size()));
+            PT_UNIT_ASSERT_EQUALS(writer.slabCount(), 6u);
+            PT_UNIT_ASSERT(writer.out_avail() > 0);
+
+            PT_UNIT_ASSERT_EQUALS(writer.pubsync(), 0);
+            PT_UNIT_ASSERT_EQUALS(writer.slabCount(), 0u);
+
+            PT_UNIT_ASSERT(readAll(reader, message.size()) == message);
+        }
+
+        void queueOutput()
+        {
+            Pt::Net::TcpServer server;
+            server.listen( Pt::Net::Endpoint::ip4Loopback(0) );
+
+            Pt::Net::Endpoint ep;
+            server.localEndpoint(ep);
+
+            Pt::Net::TcpSocket client(ep);
+            Pt::Net::TcpSocket peer(server);
+
+            Pt::System::ChainBuffer writer(client);
+            Pt::System::ChainBuffer reader(peer);
+
+            Payload* payload = new Payload( pattern(10000, 2) );
+
+            writer.sputn("header:", 7);
+            writer.queue(payload->data.data(), payload->data.size(), *payload);
+            writer.sputn(":trailer", 8);
+
+            PT_UNIT_ASSERT_EQUALS(payload->refs(), 2u);
+            PT_UNIT_ASSERT_EQUALS(writer.queued(), payload->data.size());
+
+            // the queued data is not copied into slabs
+            PT_UNIT_ASSERT_EQUALS(writer.slabCount(), 2u);
+
+            PT_UNIT_ASSERT_EQUALS(writer.pubsync(), 0);
+            PT_UNIT_ASSERT_EQUALS(payload->refs(), 1u);
+            PT_UNIT_ASSERT_EQUALS(writer.queued(), 0u);
+            PT_UNIT_ASSERT_EQUALS(writer.slabCount(), 0u);
+
+            const std::string expected = "header:" + payload->data + ":trailer";
+            PT_UNIT_ASSERT(readAll(reader, expected.size()) == expected);
+
+            // a queued reference that was not written is released too
+            writer.queue(payload->data.data(), payload->data.size(), *payload);
+            PT_UNIT_ASSERT_EQUALS(payload->refs(), 2u);
+            PT_UNIT_ASSERT_EQUALS(static_cast<std::size_t>(writer.out_avail()), payload->data.size());
+
+            writer.discard();
+            PT_UNIT_ASSERT_EQUALS(payload->refs(), 1u);
+
+            payload->release();
+        }
+
+    private:
+        void onInput(Pt::System::ChainBuffer& buffer)
+        {
+            buffer.endRead();
+            _loop->exit();
+        }
+
+        void onTimeout()
+        {
+            _timedOut = true;
+            _loop->exit();
+        }
+
+    private:
+        Pt::System::MainLoop* _loop;
+        bool _timedOut;
+};
+
+Pt::Unit::RegisterTest<ChainBufferTest> register_ChainBufferTest;
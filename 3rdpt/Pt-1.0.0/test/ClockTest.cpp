@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <Pt/Unit/Assertion.h>
+#include <Pt/Unit/TestSuite.h>
+#include <Pt/Unit/RegisterTest.h>
+#include <Pt/System/Clock.h>
+#include <Pt/System/Thread.h>
+#include <Pt/Atomicity.h>
+#include <Pt/Types.h>
+
+namespace {
+
+const Pt::int64_t MSecs = 1000000;
+
+// reads the clock until it is stopped and counts times going backwards
+// by more than the resolution of the coarse clock
+struct ClockReader
+{
+    ClockReader()
+    : stopped(0)
+    , reads(0)
+    , steps(0)
+    {}
+
+    void run()
+    {
+        Pt::int64_t last = Pt::System::Clock::getMonotonicTime();
+        while( ! Pt::atomicGet(stopped) )
+        {
+            Pt::int64_t now = Pt::System::Clock::getMonotonicTime();
+            if(now < last - 50 * MSecs)
+                ++steps;
+
+            last = now;
+            ++reads;
+        }
+    }
+
+    Pt::atomic_t stopped;
+    unsigned reads;
+    unsigned steps;
+};
+
+}
+
+
+class ClockTest : public Pt::Unit::TestSuite
+{
+    public:
+        ClockTest()
+        : Pt::Unit::TestSuite("ClockTest")
+        {
+            this->registerMethod("monotonic", *this, &ClockTest::monotonic);
+            this->registerMethod("monotonicCoarse", *this, &ClockTest::monotonicCoarse);
+            this->registerMethod("timestampCounter", *this, &ClockTest::timestampCounter);
+            this->registerMethod("switchWhileReading", *this, &ClockTest::switchWhileReading);
+        }
+
+        void tearDown()
+        {
+            Pt::System::Clock::setMonotonicSource(Pt::System::Clock::Monotonic);
+        }
+
+        void monotonic()
+        {
+            PT_UNIT_ASSERT( Pt::System::Clock::setMonotonicSource(Pt::System::Clock::Monotonic) );
+            checkSource();
+        }
+
+        void monotonicCoarse()
+        {
+            // not supported on all systems, the precise clock is used then
+            Pt::System::Clock::setMonotonicSource(Pt::System::Clock::MonotonicCoarse);
+            checkSource();
+        }
+
+        void timestampCounter()
+        {
+            // only used if the kernel considers the TSC stable
+            Pt::System::Clock::setMonotonicSource(Pt::System::Clock::TimestampCounter);
+            checkSource();
+        }
+
+        void switchWhileReading()
+        {
+            ClockReader reader;
+            Pt::System::AttachedThread thread( Pt::callable(reader, &ClockReader::run) );
+            thread.start();
+
+            const Pt::System::Clock::MonotonicSource sources[] = {
+                Pt::System::Clock::Monotonic,
+                Pt::System::Clock::MonotonicCoarse,
+                Pt::System::Clock::TimestampCounter
+            };
+
+            for(int n = 0; n < 300; ++n)
+            {
+                Pt::System::Clock::setMonotonicSource( sources[n % 3] );
+                Pt::System::Thread::yield();
+            }
+
+            Pt::atomicSet(reader.stopped, 1);
+            thread.join();
+
+            PT_UNIT_ASSERT(reader.reads > 0);
+            PT_UNIT_ASSERT_EQUALS(reader.steps, 0u);
+        }
+
+    private:
+        // the clock must not go backwards and measure a sleep roughly
+        void checkSource()
+        {
+            const Pt::int64_t start = Pt::System::Clock::getMonotonicTime();
+            PT_UNIT_ASSERT(start > 0);
+
+            Pt::int64_t last = start;
+            for(int n = 0; n < 10000; ++n)
+            {
+                Pt::int64_t now = Pt::System::Clock::getMonotonicTime();
+                PT_UNIT_ASSERT(now >= last);
+                last = now;
+            }
+
+            Pt::System::Thread::sleep(50);
+
+            const Pt::int64_t elapsed = Pt::System::Clock::getMonotonicTime() - start;
+            PT_UNIT_ASSERT(elapsed >= 40 * MSecs);
+            PT_UNIT_ASSERT(elapsed < 5000 * MSecs);
+
+            // the ticks are read from the same source
+            const Pt::int64_t ticks = Pt::System::Clock::getMonotonicTicks().toUSecs();
+            const Pt::int64_t time = Pt::System::Clock::getMonotonicTime() / 1000;
+            PT_UNIT_ASSERT(time >= ticks);
+            PT_UNIT_ASSERT(time - ticks < 1000 * 1000);
+
+            // all sources count from the same point in time
+            Pt::System::Clock::setMonotonicSource(Pt::System::Clock::Monotonic);
+            const Pt::int64_t precise = Pt::System::Clock::getMonotonicTime();
+            PT_UNIT_ASSERT(precise - last > -50 * MSecs);
+            PT_UNIT_ASSERT(precise - last < 1000 * MSecs);
+        }
+};
+
+Pt::Unit::RegisterTest<ClockTest> register_ClockTest;
@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include <Pt/Unit/Assertion.h>
+#include <Pt/Unit/TestSuite.h>
+#include <Pt/Unit/RegisterTest.h>
+#include <Pt/System/EventLoop.h>
+#include <Pt/System/Thread.h>
+#include <Pt/Event.h>
+#include <vector>
+
+namespace {
+
+struct SequenceEvent : public Pt::BasicEvent<SequenceEvent>
+{
+    SequenceEvent(std::size_t producer, std::size_t seq)
+    : producer(producer)
+    , seq(seq)
+    {}
+
+    std::size_t producer;
+    std::size_t seq;
+};
+
+
+struct Producer
+{
+    Producer(Pt::System::EventQueue& queue, std::size_t id, std::size_t count)
+    : queue(&queue)
+    , id(id)
+    , count(count)
+    {}
+
+    void run()
+    {
+        for(std::size_t n = 0; n < count; ++n)
+            queue->pushEvent( SequenceEvent(id, n) );
+    }
+
+    Pt::System::EventQueue* queue;
+    std::size_t id;
+    std::size_t count;
+};
+
+}
+
+
+class EventQueueTest : public Pt::Unit::TestSuite
+{
+    public:
+        EventQueueTest()
+        : Pt::Unit::TestSuite("EventQueueTest")
+        {
+            this->registerMethod("keepsOrder", *this, &EventQueueTest::keepsOrder);
+            this->registerMethod("multipleProducers", *this, &EventQueueTest::multipleProducers);
+            this->registerMethod("exitStopsProcessing", *this, &EventQueueTest::exitStopsProcessing);
+        }
+
+        void setUp()
+        {
+            _next.clear();
+            _received = 0;
+            _ordered = true;
+        }
+
+        void keepsOrder()
+        {
+            Pt::System::EventQueue queue;
+            Pt::Signal<const Pt::Event&> signal;
+            signal += Pt::slot(*this, &EventQueueTest::onEvent);
+
+            _next.resize(1, 0);
+            for(std::size_t n = 0; n < 100; ++n)
+                queue.pushEvent( SequenceEvent(0, n) );
+
+            PT_UNIT_ASSERT( queue.processEvents(signal) );
+            PT_UNIT_ASSERT_EQUALS(_received, 100u);
+            PT_UNIT_ASSERT(_ordered);
+
+            // events queued after a drain are dispatched by the next one
+            queue.pushEvent( SequenceEvent(0, 100) );
+            PT_UNIT_ASSERT( queue.processEvents(signal) );
+            PT_UNIT_ASSERT_EQUALS(_received, 101u);
+            PT_UNIT_ASSERT(_ordered);
+        }
+
+        void multipleProducers()
+        {
+            const std::size_t producerCount = 8;
+            const std::size_t eventCount = 20000;
+
+            Pt::System::EventQueue queue;
+            Pt::Signal<const Pt::Event&> signal;
+            signal += Pt::slot(*this, &EventQueueTest::onEvent);
+
+            _next.resize(producerCount, 0);
+
+            std::vector<Producer> producers;
+            for(std::size_t n = 0; n < producerCount; ++n)
+                producers.push_back( Producer(queue, n, eventCount) );
+
+            std::vector<Pt::System::AttachedThread*> threads;
+            for(std::size_t n = 0; n < producerCount; ++n)
+            {
+                threads.push_back( new Pt::System::AttachedThread( Pt::callable(producers[n], &Producer::run) ) );
+                threads.back()->start();
+            }
+
+            // drain while the producers are still pushing
+            while(_received < producerCount * eventCount)
+            {
+                queue.processEvents(signal);
+                Pt::System::Thread::yield();
+            }
+
+            for(std::size_t n = 0; n < producerCount; ++n)
+            {
+                threads[n]->join();
+                delete threads[n];
+            }
+
+            PT_UNIT_ASSERT(_ordered);
+            for(std::size_t n = 0; n < producerCount; ++n)
+                PT_UNIT_ASSERT_EQUALS(_next[n], eventCount);
+        }
+
+        void exitStopsProcessing()
+        {
+            Pt::System::EventQueue queue;
+            Pt::Signal<const Pt::Event&> signal;
+            signal += Pt::slot(*this, &EventQueueTest::onEvent);
+
+            _next.resize(1, 0);
+            queue.pushEvent( SequenceEvent(0, 0) );
+            queue.exit();
+
+            PT_UNIT_ASSERT( ! queue.processEvents(signal) );
+            PT_UNIT_ASSERT_EQUALS(_received, 0u);
+        }
+
+    private:
+        void onEvent(const Pt::Event& ev)
+        {
+            const SequenceEvent& se = static_cast<const SequenceEvent&>(ev);
+            if(se.seq != _next[se.producer])
+                _ordered = false;
+
+            _next[se.producer] = se.seq + 1;
+            ++_received;
+        }
+
+    private:
+        std::vector<std::size_t> _next;
+        std::size_t _received;
+        bool _ordered;
+};
+
+Pt::Unit::RegisterTest<EventQueueTest> register_EventQueueTest;
@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <Pt/Unit/Assertion.h>
+#include <Pt/Unit/TestSuite.h>
+#include <Pt/Unit/RegisterTest.h>
+#include <Pt/Signal.h>
+#include <Pt/Event.h>
+#include <typeinfo>
+
+namespace {
+
+struct FirstEvent : public Pt::BasicEvent<FirstEvent>
+{
+    explicit FirstEvent(int value)
+    : value(value)
+    {}
+
+    int value;
+};
+
+
+struct SecondEvent : public Pt::BasicEvent<SecondEvent>
+{
+};
+
+
+struct UnusedEvent : public Pt::BasicEvent<UnusedEvent>
+{
+};
+
+
+// implements Event directly and has no type index of its own
+class PlainEvent : public Pt::Event
+{
+    protected:
+        virtual Pt::Event& onClone(Pt::Allocator& allocator) const
+        { return Pt::Event::copyConstruct(*this, allocator); }
+
+        virtual void onDestroy(Pt::Allocator& allocator)
+        { Pt::Event::destruct(*this, allocator); }
+
+        virtual const std::type_info& onTypeInfo() const
+        { return typeid(PlainEvent); }
+};
+
+}
+
+
+class EventSignalTest : public Pt::Unit::TestSuite
+{
+    public:
+        EventSignalTest()
+        : Pt::Unit::TestSuite("EventSignalTest")
+        , _signal(0)
+        , _first(0)
+        , _second(0)
+        , _plain(0)
+        , _any(0)
+        , _lastValue(0)
+        {
+            this->registerMethod("typeIndex", *this, &EventSignalTest::typeIndex);
+            this->registerMethod("routeByType", *this, &EventSignalTest::routeByType);
+            this->registerMethod("routeUnindexed", *this, &EventSignalTest::routeUnindexed);
+            this->registerMethod("disconnectRoute", *this, &EventSignalTest::disconnectRoute);
+            this->registerMethod("disconnectWhileSending", *this, &EventSignalTest::disconnectWhileSending);
+        }
+
+        void setUp()
+        {
+            _first = 0;
+            _second = 0;
+            _plain = 0;
+            _any = 0;
+            _lastValue = 0;
+        }
+
+        void typeIndex()
+        {
+            std::size_t first = FirstEvent(0).typeIndex();
+            std::size_t second = SecondEvent().typeIndex();
+
+            PT_UNIT_ASSERT(first != 0);
+            PT_UNIT_ASSERT(second != 0);
+            PT_UNIT_ASSERT(first != second);
+
+            PT_UNIT_ASSERT(Pt::Event::registerType( typeid(FirstEvent) ) == first);
+            PT_UNIT_ASSERT(Pt::Event::findType( typeid(SecondEvent) ) == second);
+            PT_UNIT_ASSERT(Pt::Event::findType( typeid(int) ) == 0);
+        }
+
+        void routeByType()
+        {
+            Pt::Signal<const Pt::Event&> signal;
+            signal += Pt::slot(*this, &EventSignalTest::onFirst);
+            signal += Pt::slot(*this, &EventSignalTest::onAny);
+
+            signal.send( FirstEvent(42) );
+            signal.send( SecondEvent() );
+            signal.send( UnusedEvent() );
+
+            PT_UNIT_ASSERT_EQUALS(_first, 1);
+            PT_UNIT_ASSERT_EQUALS(_lastValue, 42);
+            PT_UNIT_ASSERT_EQUALS(_second, 0);
+            PT_UNIT_ASSERT_EQUALS(_any, 3);
+        }
+
+        void routeUnindexed()
+        {
+            Pt::Signal<const Pt::Event&> signal;
+            signal += Pt::slot(*this, &EventSignalTest::onAny);
+
+            // not registered yet
+            signal.send( PlainEvent() );
+            PT_UNIT_ASSERT_EQUALS(_any, 1);
+            PT_UNIT_ASSERT_EQUALS(_plain, 0);
+
+            // connecting registers the type and the event is found by
+            // its type info
+            signal += Pt::slot(*this, &EventSignalTest::onPlain);
+
+            signal.send( PlainEvent() );
+            PT_UNIT_ASSERT_EQUALS(_any, 2);
+            PT_UNIT_ASSERT_EQUALS(_plain, 1);
+        }
+
+        void disconnectRoute()
+        {
+            Pt::Signal<const Pt::Event&> signal;
+            signal += Pt::slot(*this, &EventSignalTest::onFirst);
+            signal += Pt::slot(*this, &EventSignalTest::onSecond);
+
+            signal -= Pt::slot(*this, &EventSignalTest::onFirst);
+
+            signal.send( FirstEvent(1) );
+            signal.send( SecondEvent() );
+
+            PT_UNIT_ASSERT_EQUALS(_first, 0);
+            PT_UNIT_ASSERT_EQUALS(_second, 1);
+        }
+
+        void disconnectWhileSending()
+        {
+            Pt::Signal<const Pt::Event&> signal;
+            _signal = &signal;
+
+            signal += Pt::slot(*this, &EventSignalTest::onSecondDisconnect);
+            signal += Pt::slot(*this, &EventSignalTest::onAny);
+
+            signal.send( SecondEvent() );
+            signal.send( SecondEvent() );
+
+            PT_UNIT_ASSERT_EQUALS(_second, 1);
+            PT_UNIT_ASSERT_EQUALS(_any, 1);
+        }
+
+    protected:
+        void onFirst(const FirstEvent& ev)
+        {
+            ++_first;
+            _lastValue = ev.value;
+        }
+
+        void onSecond(const SecondEvent&)
+        {
+            ++_second;
+        }
+
+        void onPlain(const PlainEvent&)
+        {
+            ++_plain;
+        }
+
+        void onAny(const Pt::Event&)
+        {
+            ++_any;
+        }
+
+        // removes itself and the slot for all events
+        void onSecondDisconnect(const SecondEvent&)
+        {
+            ++_second;
+
+            *_signal -= Pt::slot(*this, &EventSignalTest::onSecondDisconnect);
+            *_signal -= Pt::slot(*this, &EventSignalTest::onAny);
+        }
+
+    private:
+        Pt::Signal<const Pt::Event&>* _signal;
+        int _first;
+        int _second;
+        int _plain;
+        int _any;
+        int _lastValue;
+};
+
+Pt::Unit::RegisterTest<EventSignalTest> register_EventSignalTest;
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <Pt/Unit/Assertion.h>
+#include <Pt/Unit/TestSuite.h>
+#include <Pt/Unit/RegisterTest.h>
+#include <Pt/System/Thread.h>
+#include <Pt/Event.h>
+#include <typeinfo>
+#include <vector>
+
+namespace {
+
+template <int N>
+struct TypeTag
+{};
+
+const std::type_info* const tagTypes[] =
+{
+    &typeid(TypeTag<0>), &typeid(TypeTag<1>), &typeid(TypeTag<2>), &typeid(TypeTag<3>),
+    &typeid(TypeTag<4>), &typeid(TypeTag<5>), &typeid(TypeTag<6>), &typeid(TypeTag<7>)
+};
+
+const std::size_t tagCount = sizeof(tagTypes) / sizeof(tagTypes[0]);
+
+
+struct Registrar
+{
+    Registrar()
+    : indices(tagCount, 0)
+    , consistent(true)
+    {}
+
+    void run()
+    {
+        for(int round = 0; round < 2000; ++round)
+        {
+            for(std::size_t n = 0; n < tagCount; ++n)
+            {
+                std::size_t idx = Pt::Event::registerType( *tagTypes[n] );
+                if( indices[n] != 0 && indices[n] != idx )
+                    consistent = false;
+
+                indices[n] = idx;
+            }
+        }
+    }
+
+    std::vector<std::size_t> indices;
+    bool consistent;
+};
+
+}
+
+
+class EventTypeTest : public Pt::Unit::TestSuite
+{
+    public:
+        EventTypeTest()
+        : Pt::Unit::TestSuite("EventTypeTest")
+        {
+            this->registerMethod("concurrentRegistration", *this, &EventTypeTest::concurrentRegistration);
+        }
+
+        void concurrentRegistration()
+        {
+            const std::size_t threadCount = 8;
+            std::vector<Registrar> registrars(threadCount);
+
+            std::vector<Pt::System::AttachedThread*> threads;
+            for(std::size_t n = 0; n < threadCount; ++n)
+            {
+                threads.push_back( new Pt::System::AttachedThread( Pt::callable(registrars[n], &Registrar::run) ) );
+                threads.back()->start();
+            }
+
+            for(std::size_t n = 0; n < threadCount; ++n)
+            {
+                threads[n]->join();
+                delete threads[n];
+            }
+
+            // every thread saw the same index for a type and each type
+            // got its own index
+            for(std::size_t n = 0; n < threadCount; ++n)
+            {
+                PT_UNIT_ASSERT( registrars[n].consistent );
+                PT_UNIT_ASSERT( registrars[n].indices == registrars[0].indices );
+            }
+
+            for(std::size_t n = 0; n < tagCount; ++n)
+            {
+                PT_UNIT_ASSERT( registrars[0].indices[n] != 0 );
+                PT_UNIT_ASSERT( registrars[0].indices[n] == Pt::Event::findType(*tagTypes[n]) );
+
+                for(std::size_t m = n + 1; m < tagCount; ++m)
+                    PT_UNIT_ASSERT( registrars[0].indices[n] != registrars[0].indices[m] );
+            }
+        }
+};
+
+Pt::Unit::RegisterTest<EventTypeTest> register_EventTypeTest;
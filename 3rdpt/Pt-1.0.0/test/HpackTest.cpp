@@ -0,0 +1,408 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "Hpack.h"
+#include <Pt/Unit/Assertion.h>
+#include <Pt/Unit/TestSuite.h>
+#include <Pt/Unit/RegisterTest.h>
+#include <string>
+#include <vector>
+
+namespace {
+
+// converts a hex dump like "8286 8441" to binary
+std::string hex(const char* s)
+{
+    std::string out;
+    int hi = -1;
+
+    for( ; *s; ++s)
+    {
+        int v = -1;
+        if(*s >= '0' && *s <= '9')
+            v = *s - '0';
+        else if(*s >= 'a' && *s <= 'f')
+            v = *s - 'a' + 10;
+
+        if(v < 0)
+            continue;
+
+        if(hi < 0)
+        {
+            hi = v;
+        }
+        else
+        {
+            out += static_cast<char>(hi * 16 + v);
+            hi = -1;
+        }
+    }
+
+    return out;
+}
+
+
+// records the decoded fields as "name: value"
+class FieldList : public Pt::Http::HpackDecoder::Event
+{
+    public:
+        void onField(const char* name, std::size_t nameSize,
+                     const char* value, std::size_t valueSize)
+        {
+            fields.push_back( std::string(name, nameSize) + ": " + std::string(value, valueSize) );
+        }
+
+        std::vector<std::string> fields;
+};
+
+
+std::vector<std::string> makeList(const char* const* fields, std::size_t n)
+{
+    return std::vector<std::string>(fields, fields + n);
+}
+
+
+bool decode(Pt::Http::HpackDecoder& decoder, const std::string& block, std::vector<std::string>& fields)
+{
+    FieldList ev;
+    bool ok = decoder.decode(block.data(), block.size(), ev);
+    fields = ev.fields;
+    return ok;
+}
+
+}
+
+
+class HpackTest : public Pt::Unit::TestSuite
+{
+    public:
+        HpackTest()
+        : Pt::Unit::TestSuite("HpackTest")
+        {
+            this->registerMethod("huffmanCode", *this, &HpackTest::huffmanCode);
+            this->registerMethod("huffmanInvalid", *this, &HpackTest::huffmanInvalid);
+            this->registerMethod("dynamicTable", *this, &HpackTest::dynamicTable);
+            this->registerMethod("decodeRequests", *this, &HpackTest::decodeRequests);
+            this->registerMethod("decodeHuffmanRequests", *this, &HpackTest::decodeHuffmanRequests);
+            this->registerMethod("decodeResponses", *this, &HpackTest::decodeResponses);
+            this->registerMethod("decodeInvalid", *this, &HpackTest::decodeInvalid);
+            this->registerMethod("encodeAndDecode", *this, &HpackTest::encodeAndDecode);
+            this->registerMethod("tableSizeUpdate", *this, &HpackTest::tableSizeUpdate);
+        }
+
+        void huffmanCode()
+        {
+            // RFC 7541, C.4.1 and C.4.3
+            std::string out;
+            Pt::Http::HpackHuffman::encode(out, "www.example.com", 15);
+            PT_UNIT_ASSERT(out == hex("f1e3 c2e5 f23a 6ba0 ab90 f4ff"));
+            PT_UNIT_ASSERT_EQUALS(Pt::Http::HpackHuffman::encodedSize("www.example.com", 15), out.size());
+
+            out.clear();
+            Pt::Http::HpackHuffman::encode(out, "custom-value", 12);
+            PT_UNIT_ASSERT(out == hex("25a8 49e9 5bb8 e8b4 bf"));
+
+            // every octet, including those with the longest codes
+            std::string all;
+            for(int n = 0; n < 256; ++n)
+                all += static_cast<char>(n);
+
+            for(std::size_t size = 0; size <= all.size(); size += 17)
+            {
+                const std::string s = all.substr(all.size() - size);
+
+                std::string encoded;
+                Pt::Http::HpackHuffman::encode(encoded, s.data(), s.size());
+                PT_UNIT_ASSERT_EQUALS(Pt::Http::HpackHuffman::encodedSize(s.data(), s.size()), encoded.size());
+
+                std::string decoded;
+                PT_UNIT_ASSERT( Pt::Http::HpackHuffman::decode(decoded, encoded.data(), encoded.size()) );
+                PT_UNIT_ASSERT(decoded == s);
+            }
+        }
+
+        void huffmanInvalid()
+        {
+            std::string out;
+
+            // padding must consist of the most significant bits of EOS
+            const std::string zeroPadding = hex("00");
+            PT_UNIT_ASSERT( ! Pt::Http::HpackHuffman::decode(out, zeroPadding.data(), zeroPadding.size()) );
+
+            // padding longer than 7 bits
+            const std::string longPadding = hex("ff");
+            PT_UNIT_ASSERT( ! Pt::Http::HpackHuffman::decode(out, longPadding.data(), longPadding.size()) );
+
+            // the EOS symbol itself
+            const std::string eos = hex("ffff ffff");
+            PT_UNIT_ASSERT( ! Pt::Http::HpackHuffman::decode(out, eos.data(), eos.size()) );
+        }
+
+        void dynamicTable()
+        {
+            Pt::Http::HpackTable table(100);
+            PT_UNIT_ASSERT_EQUALS(table.maxSize(), 100u);
+
+            // each entry takes name, value and 32 bytes
+            table.add("a", 1, "1234", 4);
+            table.add("b", 1, "5678", 4);
+            PT_UNIT_ASSERT_EQUALS(table.count(), 2u);
+            PT_UNIT_ASSERT_EQUALS(table.size(), 74u);
+            PT_UNIT_ASSERT_EQUALS(table[0].name, "b");
+            PT_UNIT_ASSERT_EQUALS(table[1].name, "a");
+
+            // the oldest entry is evicted
+            table.add("c", 1, "9", 1);
+            PT_UNIT_ASSERT_EQUALS(table.count(), 2u);
+            PT_UNIT_ASSERT_EQUALS(table.size(), 71u);
+            PT_UNIT_ASSERT_EQUALS(table[0].name, "c");
+            PT_UNIT_ASSERT_EQUALS(table[1].name, "b");
+
+            // the name of a new entry may refer to an entry it evicts
+            const Pt::Http::HpackTable::Entry& oldest = table[1];
+            table.add(oldest.name.data(), oldest.name.size(), "0123456789", 10);
+            PT_UNIT_ASSERT_EQUALS(table.count(), 2u);
+            PT_UNIT_ASSERT_EQUALS(table[0].name, "b");
+            PT_UNIT_ASSERT_EQUALS(table[0].value, "0123456789");
+            PT_UNIT_ASSERT_EQUALS(table[1].name, "c");
+
+            table.setMaxSize(50);
+            PT_UNIT_ASSERT_EQUALS(table.count(), 1u);
+            PT_UNIT_ASSERT_EQUALS(table[0].name, "b");
+
+            // an entry larger than the table empties it
+            const std::string large(60, 'x');
+            table.add("d", 1, large.data(), large.size());
+            PT_UNIT_ASSERT_EQUALS(table.count(), 0u);
+            PT_UNIT_ASSERT_EQUALS(table.size(), 0u);
+        }
+
+        void decodeRequests()
+        {
+            // RFC 7541, C.3
+            Pt::Http::HpackDecoder decoder;
+            std::vector<std::string> fields;
+
+            const char* const first[] = {
+                ":method: GET", ":scheme: http", ":path: /", ":authority: www.example.com"
+            };
+            PT_UNIT_ASSERT( decode(decoder, hex("8286 8441 0f77 7777 2e65 7861 6d70 6c65 2e63 6f6d"), fields) );
+            PT_UNIT_ASSERT(fields == makeList(first, 4));
+
+            const char* const second[] = {
+                ":method: GET", ":scheme: http", ":path: /", ":authority: www.example.com",
+                "cache-control: no-cache"
+            };
+            PT_UNIT_ASSERT( decode(decoder, hex("8286 84be 5808 6e6f 2d63 6163 6865"), fields) );
+            PT_UNIT_ASSERT(fields == makeList(second, 5));
+
+            const char* const third[] = {
+                ":method: GET", ":scheme: https", ":path: /index.html", ":authority: www.example.com",
+                "custom-key: custom-value"
+            };
+            PT_UNIT_ASSERT( decode(decoder, hex("8287 85bf 400a 6375 7374 6f6d 2d6b 6579 0c63 7573 746f 6d2d 7661 6c75 65"), fields) );
+            PT_UNIT_ASSERT(fields == makeList(third, 5));
+        }
+
+        void decodeHuffmanRequests()
+        {
+            // RFC 7541, C.4
+            Pt::Http::HpackDecoder decoder;
+            std::vector<std::string> fields;
+
+            const char* const first[] = {
+                ":method: GET", ":scheme: http", ":path: /", ":authority: www.example.com"
+            };
+            PT_UNIT_ASSERT( decode(decoder, hex("8286 8441 8cf1 e3c2 e5f2 3a6b a0ab 90f4 ff"), fields) );
+            PT_UNIT_ASSERT(fields == makeList(first, 4));
+
+            const char* const second[] = {
+                ":method: GET", ":scheme: http", ":path: /", ":authority: www.example.com",
+                "cache-control: no-cache"
+            };
+            PT_UNIT_ASSERT( decode(decoder, hex("8286 84be 5886 a8eb 1064 9cbf"), fields) );
+            PT_UNIT_ASSERT(fields == makeList(second, 5));
+
+            const char* const third[] = {
+                ":method: GET", ":scheme: https", ":path: /index.html", ":authority: www.example.com",
+                "custom-key: custom-value"
+            };
+            PT_UNIT_ASSERT( decode(decoder, hex("8287 85bf 4088 25a8 49e9 5ba9 7d7f 8925 a849 e95b b8e8 b4bf"), fields) );
+            PT_UNIT_ASSERT(fields == makeList(third, 5));
+        }
+
+        void decodeResponses()
+        {
+            // RFC 7541, C.5, the table size of 256 is set by an update
+            Pt::Http::HpackDecoder decoder;
+            std::vector<std::string> fields;
+
+            const char* const first[] = {
+                ":status: 302", "cache-control: private",
+                "date: Mon, 21 Oct 2013 20:13:21 GMT", "location: https://www.example.com"
+            };
+            PT_UNIT_ASSERT( decode(decoder, hex("3fe1 01"
+                "4803 3330 3258 0770 7269 7661 7465 611d 4d6f 6e2c 2032 3120 4f63 7420 3230 3133"
+                "2032 303a 3133 3a32 3120 474d 546e 1768 7474 7073 3a2f 2f77 7777 2e65 7861 6d70"
+                "6c65 2e63 6f6d"), fields) );
+            PT_UNIT_ASSERT(fields == makeList(first, 4));
+
+            // the entry of :status 302 is evicted
+            const char* const second[] = {
+                ":status: 307", "cache-control: private",
+                "date: Mon, 21 Oct 2013 20:13:21 GMT", "location: https://www.example.com"
+            };
+            PT_UNIT_ASSERT( decode(decoder, hex("4803 3330 37c1 c0bf"), fields) );
+            PT_UNIT_ASSERT(fields == makeList(second, 4));
+
+            const char* const third[] = {
+                ":status: 200", "cache-control: private",
+                "date: Mon, 21 Oct 2013 20:13:22 GMT", "location: https://www.example.com",
+                "content-encoding: gzip",
+                "set-cookie: foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600; version=1"
+            };
+            PT_UNIT_ASSERT( decode(decoder, hex(
+                "88c1 611d 4d6f 6e2c 2032 3120 4f63 7420 3230 3133 2032 303a 3133 3a32 3220 474d"
+                "54c0 5a04 677a 6970 7738 666f 6f3d 4153 444a 4b48 514b 425a 584f 5157 454f 5049"
+                "5541 5851 5745 4f49 553b 206d 6178 2d61 6765 3d33 3630 303b 2076 6572 7369 6f6e"
+                "3d31"), fields) );
+            PT_UNIT_ASSERT(fields == makeList(third, 6));
+
+            // three entries are left, the others were evicted
+            PT_UNIT_ASSERT( decode(decoder, hex("c0"), fields) );
+            PT_UNIT_ASSERT_EQUALS(fields[0], "date: Mon, 21 Oct 2013 20:13:22 GMT");
+            PT_UNIT_ASSERT( ! decode(decoder, hex("c1"), fields) );
+        }
+
+        void decodeInvalid()
+        {
+            std::vector<std::string> fields;
+
+            const char* const blocks[] = {
+                "80",                 // index 0
+                "be",                 // empty dynamic table
+                "ff",                 // truncated integer
+                "ff ff ff ff ff ff ff ff ff ff 7f", // integer overflow
+                "40 0a 63 75",        // truncated name
+                "41 85 ff",           // truncated Huffman value
+                "82 3f e1 01",        // table size update after a field
+                "3f e1 3f"            // table size above the limit
+            };
+
+            for(std::size_t n = 0; n < sizeof(blocks) / sizeof(blocks[0]); ++n)
+            {
+                Pt::Http::HpackDecoder decoder;
+                PT_UNIT_ASSERT( ! decode(decoder, hex(blocks[n]), fields) );
+            }
+
+            // a smaller table than announced can not be grown by the peer
+            Pt::Http::HpackDecoder decoder;
+            decoder.setMaxTableSize(100);
+            PT_UNIT_ASSERT( ! decode(decoder, hex("3f e1 01"), fields) );
+            PT_UNIT_ASSERT( decode(decoder, hex("3f 45 82"), fields) );
+        }
+
+        void encodeAndDecode()
+        {
+            Pt::Http::HpackEncoder encoder;
+            Pt::Http::HpackDecoder decoder;
+
+            const char* const fields[][2] = {
+                { ":status", "200" },
+                { "content-type", "application/json" },
+                { "content-length", "1234" },
+                { "x-request-id", "8f2b1c9d4e5a6b7c" },
+                { "set-cookie", "session=abcdef; Path=/" },
+                { "authorization", "Bearer secret-token" },
+                { "server", "Platinum 1.0" }
+            };
+
+            const std::size_t count = sizeof(fields) / sizeof(fields[0]);
+
+            std::vector<std::string> expected;
+            for(std::size_t n = 0; n < count; ++n)
+                expected.push_back( std::string(fields[n][0]) + ": " + fields[n][1] );
+
+            std::size_t firstSize = 0;
+
+            for(std::size_t block = 0; block < 3; ++block)
+            {
+                std::string out;
+                encoder.beginBlock(out);
+                for(std::size_t n = 0; n < count; ++n)
+                    encoder.encode(out, fields[n][0], fields[n][1]);
+
+                std::vector<std::string> decoded;
+                PT_UNIT_ASSERT( decode(decoder, out, decoded) );
+                PT_UNIT_ASSERT(decoded == expected);
+
+                // repeated fields are sent as indices, except the
+                // sensitive and volatile ones
+                if(block == 0)
+                    firstSize = out.size();
+                else
+                    PT_UNIT_ASSERT(out.size() < firstSize);
+            }
+        }
+
+        void tableSizeUpdate()
+        {
+            Pt::Http::HpackEncoder encoder;
+            Pt::Http::HpackDecoder decoder;
+            std::vector<std::string> decoded;
+
+            std::string out;
+            encoder.beginBlock(out);
+            encoder.encode(out, "x-custom", "value-1");
+            PT_UNIT_ASSERT( decode(decoder, out, decoded) );
+
+            // the peer disables the table, which is signalled first
+            encoder.setMaxTableSize(0);
+            decoder.setMaxTableSize(0);
+
+            out.clear();
+            encoder.beginBlock(out);
+            encoder.encode(out, "x-custom", "value-1");
+            PT_UNIT_ASSERT_EQUALS(static_cast<unsigned char>(out[0]), 0x20u);
+
+            PT_UNIT_ASSERT( decode(decoder, out, decoded) );
+            PT_UNIT_ASSERT_EQUALS(decoded.size(), 1u);
+            PT_UNIT_ASSERT_EQUALS(decoded[0], "x-custom: value-1");
+
+            // without a table, no field is indexed anymore
+            std::string again;
+            encoder.beginBlock(again);
+            encoder.encode(again, "x-custom", "value-1");
+            PT_UNIT_ASSERT(again.size() + 1 == out.size());
+
+            PT_UNIT_ASSERT( decode(decoder, again, decoded) );
+            PT_UNIT_ASSERT_EQUALS(decoded[0], "x-custom: value-1");
+        }
+};
+
+Pt::Unit::RegisterTest<HpackTest> register_HpackTest;
@@ -0,0 +1,726 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "Hpack.h"
+#include <Pt/Unit/Assertion.h>
+#include <Pt/Unit/TestSuite.h>
+#include <Pt/Unit/RegisterTest.h>
+#include <Pt/Http/Server.h>
+#include <Pt/Http/Service.h>
+#include <Pt/Http/Servlet.h>
+#include <Pt/Http/Responder.h>
+#include <Pt/Http/Request.h>
+#include <Pt/Http/Reply.h>
+#include <Pt/Net/Endpoint.h>
+#include <Pt/Net/TcpSocket.h>
+#include <Pt/System/MainLoop.h>
+#include <Pt/System/Thread.h>
+#include <Pt/System/Timer.h>
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+enum FrameType
+{
+    DataFrame = 0x0,
+    HeadersFrame = 0x1,
+    ResetStreamFrame = 0x3,
+    SettingsFrame = 0x4,
+    PingFrame = 0x6,
+    GoAwayFrame = 0x7,
+    WindowUpdateFrame = 0x8,
+    ContinuationFrame = 0x9
+};
+
+enum FrameFlag
+{
+    EndStreamFlag = 0x1,
+    AckFlag = 0x1,
+    EndHeadersFlag = 0x4
+};
+
+const Pt::uint32_t RefusedStream = 0x7;
+const Pt::uint32_t CompressionError = 0x9;
+
+const std::size_t MaxFrameSize = 16384;
+
+
+std::string pattern(std::size_t size, int seed)
+{
+    std::string s(size, '\0');
+    for(std::size_t n = 0; n < size; ++n)
+        s[n] = static_cast<char>('a' + (n * 7 + seed) % 26);
+
+    return s;
+}
+
+
+Pt::uint32_t readUInt32(const char* p)
+{
+    const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+    return (Pt::uint32_t(u[0]) << 24) | (Pt::uint32_t(u[1]) << 16) |
+           (Pt::uint32_t(u[2]) << 8) | Pt::uint32_t(u[3]);
+}
+
+
+void appendUInt32(std::string& out, Pt::uint32_t v)
+{
+    out += static_cast<char>(v >> 24);
+    out += static_cast<char>(v >> 16);
+    out += static_cast<char>(v >> 8);
+    out += static_cast<char>(v);
+}
+
+
+// replies with the body of the request
+class EchoResponder : public Pt::Http::Responder
+{
+    public:
+        explicit EchoResponder(Pt::Http::Service& service)
+        : Pt::Http::Responder(service)
+        {}
+
+    protected:
+        void onBeginRequest(Pt::Http::Request& request, Pt::Http::Reply& reply, Pt::System::EventLoop& loop)
+        {
+            _body.clear();
+        }
+
+        void onReadRequest(Pt::Http::Request& request, Pt::Http::Reply& reply, Pt::System::EventLoop& loop)
+        {
+            std::streambuf* sb = request.body().rdbuf();
+
+            char buffer[1024];
+            std::streamsize n = 0;
+            while( (n = sb->in_avail()) > 0 )
+            {
+                n = sb->sgetn(buffer, std::min<std::streamsize>(n, sizeof(buffer)));
+                _body.append(buffer, static_cast<std::size_t>(n));
+            }
+        }
+
+        void onBeginReply(const Pt::Http::Request& request, Pt::Http::Reply& reply, Pt::System::EventLoop& loop)
+        {
+            reply.body().write(_body.data(), static_cast<std::streamsize>(_body.size()));
+            reply.beginSend(true);
+        }
+
+        void onWriteReply(const Pt::Http::Request& request, Pt::Http::Reply& reply, Pt::System::EventLoop& loop)
+        {
+            reply.beginSend(true);
+        }
+
+    private:
+        std::string _body;
+};
+
+
+// client with prior knowledge of HTTP/2, which uses blocking I/O
+class Http2Client : private Pt::Http::HpackDecoder::Event
+{
+    public:
+        struct Stream
+        {
+            Stream()
+            : window(65535)
+            , finished(false)
+            , error(0)
+            {}
+
+            Pt::int64_t window;
+            std::string status;
+            std::string body;
+            bool finished;
+            Pt::uint32_t error;
+        };
+
+    public:
+        Http2Client()
+        : maxStreams(0)
+        , window(65535)
+        , goAway(false)
+        , goAwayError(0)
+        , _fieldStream(0)
+        {}
+
+        void connect(unsigned short port)
+        {
+            _socket.connect( Pt::Net::Endpoint::ip4Loopback(port) );
+            _socket.setTimeout(10000);
+
+            write("PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n");
+            writeFrame(SettingsFrame, 0, 0, std::string());
+
+            // the server announces its settings first
+            while(maxStreams == 0)
+                readFrame();
+        }
+
+        void close()
+        {
+            _socket.close();
+        }
+
+        void sendHeaders(Pt::uint32_t id, const char* method, const char* path, bool endStream)
+        {
+            std::string block;
+            _encoder.beginBlock(block);
+            _encoder.encode(block, ":method", method);
+            _encoder.encode(block, ":scheme", "http");
+            _encoder.encode(block, ":path", path);
+            _encoder.encode(block, ":authority", "localhost");
+
+            sendHeaderBlock(id, block, endStream);
+        }
+
+        void sendHeaderBlock(Pt::uint32_t id, const std::string& block, bool endStream)
+        {
+            streams[id] = Stream();
+
+            unsigned flags = EndHeadersFlag;
+            if(endStream)
+                flags |= EndStreamFlag;
+
+            writeFrame(HeadersFrame, flags, id, block);
+        }
+
+        // sends the data within the flow control windows of the server
+        void sendData(Pt::uint32_t id, const std::string& data, bool endStream)
+        {
+            std::size_t pos = 0;
+
+            do
+            {
+                Stream& s = streams[id];
+
+                std::size_t n = std::min(data.size() - pos, MaxFrameSize);
+                Pt::int64_t avail = std::min(window, s.window);
+
+                if(n > 0 && avail <= 0)
+                {
+                    readFrame();
+                    continue;
+                }
+
+                n = std::min<std::size_t>(n, static_cast<std::size_t>(std::max<Pt::int64_t>(avail, 0)));
+                unsigned flags = (endStream && pos + n == data.size()) ? EndStreamFlag : 0;
+
+                writeFrame(DataFrame, flags, id, data.substr(pos, n));
+                window -= n;
+                s.window -= n;
+                pos += n;
+            }
+            while(pos < data.size());
+        }
+
+        void ping(const std::string& payload)
+        {
+            writeFrame(PingFrame, 0, 0, payload);
+        }
+
+        void waitFor(Pt::uint32_t id)
+        {
+            while( ! streams[id].finished )
+                readFrame();
+        }
+
+        // reads and processes the next frame of the server
+        void readFrame()
+        {
+            char header[9];
+            readExact(header, sizeof(header));
+
+            const unsigned char* h = reinterpret_cast<const unsigned char*>(header);
+            const std::size_t length = (std::size_t(h[0]) << 16) | (std::size_t(h[1]) << 8) | h[2];
+            const unsigned type = h[3];
+            const unsigned flags = h[4];
+            const Pt::uint32_t id = readUInt32(header + 5) & 0x7fffffff;
+
+            std::string payload(length, '\0');
+            if(length > 0)
+                readExact(&payload[0], length);
+
+            switch(type)
+            {
+                case DataFrame:
+                {
+                    Stream& s = streams[id];
+                    s.body += payload;
+
+                    if(length > 0)
+                    {
+                        writeWindowUpdate(0, static_cast<Pt::uint32_t>(length));
+                        if( ! (flags & EndStreamFlag) )
+                            writeWindowUpdate(id, static_cast<Pt::uint32_t>(length));
+                    }
+
+                    if(flags & EndStreamFlag)
+                        s.finished = true;
+
+                    break;
+                }
+
+                case HeadersFrame:
+                case ContinuationFrame:
+                {
+                    _block += payload;
+                    if(type == HeadersFrame)
+                        _blockEndStream = (flags & EndStreamFlag) != 0;
+
+                    if( ! (flags & EndHeadersFlag) )
+                        break;
+
+                    _fieldStream = id;
+                    if( ! _decoder.decode(_block.data(), _block.size(), *this) )
+                        throw std::runtime_error("invalid header block");
+
+                    _block.clear();
+
+                    if(_blockEndStream)
+                        streams[id].finished = true;
+
+                    break;
+                }
+
+                case ResetStreamFrame:
+                {
+                    Stream& s = streams[id];
+                    s.error = readUInt32(payload.data());
+                    s.finished = true;
+                    break;
+                }
+
+                case SettingsFrame:
+                {
+                    if(flags & AckFlag)
+                        break;
+
+                    for(std::size_t n = 0; n + 6 <= payload.size(); n += 6)
+                    {
+                        unsigned setting = (unsigned(static_cast<unsigned char>(payload[n])) << 8) |
+                                           static_cast<unsigned char>(payload[n + 1]);
+                        if(setting == 0x3)
+                            maxStreams = readUInt32(payload.data() + n + 2);
+                    }
+
+                    writeFrame(SettingsFrame, AckFlag, 0, std::string());
+                    break;
+                }
+
+                case PingFrame:
+                {
+                    if(flags & AckFlag)
+                        pingAck = payload;
+
+                    break;
+                }
+
+                case GoAwayFrame:
+                {
+                    goAway = true;
+                    goAwayError = readUInt32(payload.data() + 4);
+                    break;
+                }
+
+                case WindowUpdateFrame:
+                {
+                    Pt::uint32_t increment = readUInt32(payload.data()) & 0x7fffffff;
+                    if(id == 0)
+                        window += increment;
+                    else
+                        streams[id].window += increment;
+
+                    break;
+                }
+
+                default:
+                    break;
+            }
+        }
+
+    public:
+        std::map<Pt::uint32_t, Stream> streams;
+        std::size_t maxStreams;
+        Pt::int64_t window;
+        std::string pingAck;
+        bool goAway;
+        Pt::uint32_t goAwayError;
+
+    private:
+        void onField(const char* name, std::size_t nameSize,
+                     const char* value, std::size_t valueSize)
+        {
+            if(std::string(name, nameSize) == ":status")
+                streams[_fieldStream].status.assign(value, valueSize);
+        }
+
+        void write(const std::string& data)
+        {
+            std::size_t written = 0;
+            while(written < data.size())
+                written += _socket.write(data.data() + written, data.size() - written);
+        }
+
+        void writeFrame(unsigned type, unsigned flags, Pt::uint32_t id, const std::string& payload)
+        {
+            std::string frame;
+            frame += static_cast<char>(payload.size() >> 16);
+            frame += static_cast<char>(payload.size() >> 8);
+            frame += static_cast<char>(payload.size());
+            frame += static_cast<char>(type);
+            frame += static_cast<char>(flags);
+            appendUInt32(frame, id);
+            frame += payload;
+
+            write(frame);
+        }
+
+        void writeWindowUpdate(Pt::uint32_t id, Pt::uint32_t increment)
+        {
+            std::string payload;
+            appendUInt32(payload, increment);
+            writeFrame(WindowUpdateFrame, 0, id, payload);
+        }
+
+        void readExact(char* data, std::size_t n)
+        {
+            while(n > 0)
+            {
+                std::size_t r = _socket.read(data, n);
+                if(r == 0)
+                    throw std::runtime_error("connection lost");
+
+                data += r;
+                n -= r;
+            }
+        }
+
+    private:
+        Pt::Net::TcpSocket _socket;
+        Pt::Http::HpackEncoder _encoder;
+        Pt::Http::HpackDecoder _decoder;
+        std::string _block;
+        bool _blockEndStream;
+        Pt::uint32_t _fieldStream;
+};
+
+}
+
+
+class Http2SessionTest : public Pt::Unit::TestSuite
+{
+    public:
+        typedef void (Http2SessionTest::*Scenario)(Http2Client&);
+
+    public:
+        Http2SessionTest()
+        : Pt::Unit::TestSuite("Http2SessionTest")
+        , _loop(0)
+        , _scenario(0)
+        , _port(0)
+        , _timedOut(false)
+        {
+            this->registerMethod("echoRequest", *this, &Http2SessionTest::echoRequest);
+            this->registerMethod("ping", *this, &Http2SessionTest::ping);
+            this->registerMethod("flowControl", *this, &Http2SessionTest::flowControl);
+            this->registerMethod("concurrentStreams", *this, &Http2SessionTest::concurrentStreams);
+            this->registerMethod("refusedStreams", *this, &Http2SessionTest::refusedStreams);
+            this->registerMethod("compressionError", *this, &Http2SessionTest::compressionError);
+            this->registerMethod("concurrentLoad", *this, &Http2SessionTest::concurrentLoad);
+        }
+
+        void echoRequest()
+        {
+            run(27320, 100, &Http2SessionTest::runEchoRequest);
+        }
+
+        void ping()
+        {
+            run(27321, 100, &Http2SessionTest::runPing);
+        }
+
+        void flowControl()
+        {
+            run(27322, 100, &Http2SessionTest::runFlowControl);
+        }
+
+        void concurrentStreams()
+        {
+            run(27323, 100, &Http2SessionTest::runConcurrentStreams);
+        }
+
+        void refusedStreams()
+        {
+            run(27324, 4, &Http2SessionTest::runRefusedStreams);
+        }
+
+        void compressionError()
+        {
+            run(27325, 100, &Http2SessionTest::runCompressionError);
+        }
+
+        void concurrentLoad()
+        {
+            run(27326, 64, &Http2SessionTest::runConcurrentLoad);
+        }
+
+    private:
+        void runEchoRequest(Http2Client& client)
+        {
+            PT_UNIT_ASSERT_EQUALS(client.maxStreams, 100u);
+
+            client.sendHeaders(1, "POST", "/echo", false);
+            client.sendData(1, "hello", true);
+            client.waitFor(1);
+
+            PT_UNIT_ASSERT_EQUALS(client.streams[1].error, 0u);
+            PT_UNIT_ASSERT_EQUALS(client.streams[1].status, "200");
+            PT_UNIT_ASSERT_EQUALS(client.streams[1].body, "hello");
+
+            // a request without body on the same connection
+            client.sendHeaders(3, "GET", "/missing", true);
+            client.waitFor(3);
+            PT_UNIT_ASSERT_EQUALS(client.streams[3].status, "404");
+        }
+
+        void runPing(Http2Client& client)
+        {
+            client.ping("12345678");
+
+            while( client.pingAck.empty() )
+                client.readFrame();
+
+            PT_UNIT_ASSERT_EQUALS(client.pingAck, "12345678");
+        }
+
+        void runFlowControl(Http2Client& client)
+        {
+            // both bodies exceed the initial windows of the stream and
+            // the connection, so both sides must wait for window updates
+            const std::string body = pattern(300000, 1);
+
+            client.sendHeaders(1, "POST", "/echo", false);
+            client.sendData(1, body, true);
+            client.waitFor(1);
+
+            PT_UNIT_ASSERT_EQUALS(client.streams[1].status, "200");
+            PT_UNIT_ASSERT(client.streams[1].body == body);
+        }
+
+        void runConcurrentStreams(Http2Client& client)
+        {
+            const Pt::uint32_t count = 50;
+
+            // all requests are open before the first body is sent
+            for(Pt::uint32_t n = 0; n < count; ++n)
+                client.sendHeaders(2 * n + 1, "POST", "/echo", false);
+
+            for(Pt::uint32_t n = count; n > 0; --n)
+                client.sendData(2 * n - 1, pattern(100 + n * 37, n), true);
+
+            for(Pt::uint32_t n = 1; n <= count; ++n)
+            {
+                client.waitFor(2 * n - 1);
+
+                const Http2Client::Stream& s = client.streams[2 * n - 1];
+                PT_UNIT_ASSERT_EQUALS(s.error, 0u);
+                PT_UNIT_ASSERT_EQUALS(s.status, "200");
+                PT_UNIT_ASSERT(s.body == pattern(100 + n * 37, n));
+            }
+        }
+
+        void runRefusedStreams(Http2Client& client)
+        {
+            PT_UNIT_ASSERT_EQUALS(client.maxStreams, 4u);
+
+            // the streams stay open until their bodies are sent
+            for(Pt::uint32_t id = 1; id <= 19; id += 2)
+                client.sendHeaders(id, "POST", "/echo", false);
+
+            for(Pt::uint32_t id = 9; id <= 19; id += 2)
+            {
+                client.waitFor(id);
+                PT_UNIT_ASSERT_EQUALS(client.streams[id].error, RefusedStream);
+            }
+
+            for(Pt::uint32_t id = 1; id <= 7; id += 2)
+            {
+                PT_UNIT_ASSERT( ! client.streams[id].finished );
+                client.sendData(id, "accepted", true);
+            }
+
+            for(Pt::uint32_t id = 1; id <= 7; id += 2)
+            {
+                client.waitFor(id);
+                PT_UNIT_ASSERT_EQUALS(client.streams[id].error, 0u);
+                PT_UNIT_ASSERT_EQUALS(client.streams[id].body, "accepted");
+            }
+
+            // refused streams can be retried
+            client.sendHeaders(21, "POST", "/echo", false);
+            client.sendData(21, "retried", true);
+            client.waitFor(21);
+            PT_UNIT_ASSERT_EQUALS(client.streams[21].body, "retried");
+        }
+
+        void runCompressionError(Http2Client& client)
+        {
+            // index 0 is not valid
+            client.sendHeaderBlock(1, std::string(1, '\x80'), true);
+
+            while( ! client.goAway )
+                client.readFrame();
+
+            PT_UNIT_ASSERT_EQUALS(client.goAwayError, CompressionError);
+        }
+
+        void runConcurrentLoad(Http2Client& client)
+        {
+            // new streams are opened as others finish, so the server
+            // serves the maximum number of streams most of the time
+            const std::size_t requests = 2000;
+            const std::size_t window = client.maxStreams;
+
+            std::map<Pt::uint32_t, std::string> open;
+            std::size_t sent = 0;
+            std::size_t done = 0;
+            Pt::uint32_t next = 1;
+
+            while(done < requests)
+            {
+                while(open.size() < window && sent < requests)
+                {
+                    const std::string body = pattern(16 + sent % 500, static_cast<int>(sent));
+                    client.sendHeaders(next, "POST", "/echo", false);
+                    client.sendData(next, body, true);
+
+                    open[next] = body;
+                    next += 2;
+                    ++sent;
+                }
+
+                client.readFrame();
+
+                std::map<Pt::uint32_t, std::string>::iterator it = open.begin();
+                while( it != open.end() )
+                {
+                    const Http2Client::Stream& s = client.streams[it->first];
+                    if( ! s.finished )
+                    {
+                        ++it;
+                        continue;
+                    }
+
+                    PT_UNIT_ASSERT_EQUALS(s.error, 0u);
+                    PT_UNIT_ASSERT_EQUALS(s.status, "200");
+                    PT_UNIT_ASSERT(s.body == it->second);
+
+                    client.streams.erase(it->first);
+                    open.erase(it++);
+                    ++done;
+                }
+            }
+
+            PT_UNIT_ASSERT( ! client.goAway );
+        }
+
+        void clientThread()
+        {
+            try
+            {
+                Http2Client client;
+                client.connect(_port);
+                (this->*_scenario)(client);
+                client.close();
+            }
+            catch(const Pt::Unit::Assertion& a)
+            {
+                const Pt::SourceInfo& si = a.sourceInfo();
+                _error = std::string(si.file()) + ':' + si.line() + ": " + a.what();
+            }
+            catch(const std::exception& e)
+            {
+                _error = e.what();
+            }
+
+            _loop->exit();
+        }
+
+        void run(unsigned short port, std::size_t maxStreams, Scenario scenario)
+        {
+            Pt::System::MainLoop loop;
+            _loop = &loop;
+
+            Pt::System::Timer guard;
+            guard.timeout() += Pt::slot(*this, &Http2SessionTest::onTimeout);
+            guard.setActive(loop);
+            guard.start(30000);
+
+            Pt::Http::BasicService<EchoResponder> service;
+            Pt::Http::MapUrl servlet("/echo", service);
+
+            Pt::Http::Server server(loop, Pt::Net::Endpoint::ip4Loopback(port));
+            server.setMaxConcurrentStreams(maxStreams);
+            server.addServlet(servlet);
+
+            _port = port;
+            _scenario = scenario;
+            _error.clear();
+            _timedOut = false;
+
+            Pt::System::AttachedThread thread( Pt::callable(*this, &Http2SessionTest::clientThread) );
+            thread.start();
+
+            loop.run();
+
+            thread.join();
+            server.removeServlet(servlet);
+
+            PT_UNIT_ASSERT( ! _timedOut );
+            PT_UNIT_ASSERT_EQUALS(_error, "");
+        }
+
+        void onTimeout()
+        {
+            _timedOut = true;
+            _loop->exit();
+        }
+
+    private:
+        Pt::System::MainLoop* _loop;
+        Scenario _scenario;
+        unsigned short _port;
+        std::string _error;
+        bool _timedOut;
+};
+
+Pt::Unit::RegisterTest<Http2SessionTest> register_Http2SessionTest;
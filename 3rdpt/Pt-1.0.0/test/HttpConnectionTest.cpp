@@ -0,0 +1,408 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <Pt/Unit/Assertion.h>
+#include <Pt/Unit/TestSuite.h>
+#include <Pt/Unit/RegisterTest.h>
+#include <Pt/Http/Server.h>
+#include <Pt/Http/Client.h>
+#include <Pt/Http/Service.h>
+#include <Pt/Http/Servlet.h>
+#include <Pt/Http/Responder.h>
+#include <Pt/Http/Request.h>
+#include <Pt/Http/Reply.h>
+#include <Pt/Net/Endpoint.h>
+#include <Pt/Net/TcpSocket.h>
+#include <Pt/System/MainLoop.h>
+#include <Pt/System/Thread.h>
+#include <Pt/System/Timer.h>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cctype>
+
+namespace {
+
+std::string pattern(std::size_t size, int seed)
+{
+    std::string s(size, '\0');
+    for(std::size_t n = 0; n < size; ++n)
+        s[n] = static_cast<char>('a' + (n * 7 + seed) % 26);
+
+    return s;
+}
+
+
+// replies with the body of the request
+class EchoResponder : public Pt::Http::Responder
+{
+    public:
+        explicit EchoResponder(Pt::Http::Service& service)
+        : Pt::Http::Responder(service)
+        {}
+
+    protected:
+        void onBeginRequest(Pt::Http::Request& request, Pt::Http::Reply& reply, Pt::System::EventLoop& loop)
+        {
+            _body.clear();
+        }
+
+        void onReadRequest(Pt::Http::Request& request, Pt::Http::Reply& reply, Pt::System::EventLoop& loop)
+        {
+            std::streambuf* sb = request.body().rdbuf();
+
+            char buffer[1024];
+            std::streamsize n = 0;
+            while( (n = sb->in_avail()) > 0 )
+            {
+                n = sb->sgetn(buffer, std::min<std::streamsize>(n, sizeof(buffer)));
+                _body.append(buffer, static_cast<std::size_t>(n));
+            }
+        }
+
+        void onBeginReply(const Pt::Http::Request& request, Pt::Http::Reply& reply, Pt::System::EventLoop& loop)
+        {
+            reply.body().write(_body.data(), static_cast<std::streamsize>(_body.size()));
+            reply.beginSend(true);
+        }
+
+        void onWriteReply(const Pt::Http::Request& request, Pt::Http::Reply& reply, Pt::System::EventLoop& loop)
+        {
+            reply.beginSend(true);
+        }
+
+    private:
+        std::string _body;
+};
+
+
+struct EchoClient
+{
+    EchoClient(Pt::System::EventLoop& loop, unsigned short port, const std::vector<std::size_t>& sizes)
+    : loop(&loop)
+    , port(port)
+    , sizes(sizes)
+    , failed(0)
+    {}
+
+    void run()
+    {
+        try
+        {
+            // all requests are sent over one kept alive connection
+            Pt::Http::Client client( Pt::Net::Endpoint::ip4Loopback(port) );
+
+            for(std::size_t n = 0; n < sizes.size(); ++n)
+            {
+                const std::string body = pattern(sizes[n], static_cast<int>(n));
+
+                client.request().clear();
+                client.request().setUrl("/echo");
+                client.request().setMethod("POST");
+                client.request().body().write(body.data(), static_cast<std::streamsize>(body.size()));
+                client.send();
+
+                std::istream& is = client.receive();
+                std::string reply( (std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>() );
+
+                if(reply != body)
+                    ++failed;
+            }
+        }
+        catch(const std::exception&)
+        {
+            failed = sizes.size();
+        }
+
+        loop->exit();
+    }
+
+    Pt::System::EventLoop* loop;
+    unsigned short port;
+    std::vector<std::size_t> sizes;
+    std::size_t failed;
+};
+
+
+// sends all requests before reading the first reply
+struct PipelineClient
+{
+    PipelineClient(Pt::System::EventLoop& loop, unsigned short port, const std::vector<std::size_t>& sizes)
+    : loop(&loop)
+    , port(port)
+    , sizes(sizes)
+    , failed(0)
+    {}
+
+    static std::string request(const std::string& body)
+    {
+        std::ostringstream os;
+        os << "POST /echo HTTP/1.1\r\n"
+           << "Host: localhost\r\n"
+           << "Content-Length: " << body.size() << "\r\n"
+           << "\r\n"
+           << body;
+
+        return os.str();
+    }
+
+    void write(const std::string& data)
+    {
+        std::size_t written = 0;
+        while(written < data.size())
+            written += socket.write(data.data() + written, data.size() - written);
+    }
+
+    // reads the body of the next reply, replies have a content length
+    std::string readReply()
+    {
+        std::string::size_type end = std::string::npos;
+        while( (end = input.find("\r\n\r\n")) == std::string::npos )
+            fill();
+
+        std::string header = input.substr(0, end);
+        for(std::size_t n = 0; n < header.size(); ++n)
+            header[n] = static_cast<char>( std::tolower(header[n]) );
+
+        std::size_t size = 0;
+        std::string::size_type pos = header.find("content-length:");
+        if(pos != std::string::npos)
+            std::istringstream( header.substr(pos + 15) ) >> size;
+
+        input.erase(0, end + 4);
+        while(input.size() < size)
+            fill();
+
+        std::string body = input.substr(0, size);
+        input.erase(0, size);
+        return body;
+    }
+
+    void fill()
+    {
+        char buffer[4096];
+        std::size_t n = socket.read(buffer, sizeof(buffer));
+        if(n == 0)
+            throw std::runtime_error("connection lost");
+
+        input.append(buffer, n);
+    }
+
+    void run()
+    {
+        try
+        {
+            socket.connect( Pt::Net::Endpoint::ip4Loopback(port) );
+            socket.setTimeout(5000);
+
+            std::vector<std::string> bodies;
+            std::string requests;
+            for(std::size_t n = 0; n < sizes.size(); ++n)
+            {
+                bodies.push_back( pattern(sizes[n], static_cast<int>(n)) );
+                requests += request(bodies.back());
+            }
+
+            // the header of the last request is incomplete, the replies
+            // of the others must be sent without waiting for it
+            const std::string last = request("last");
+            write(requests + last.substr(0, 20));
+
+            for(std::size_t n = 0; n < bodies.size(); ++n)
+            {
+                if(readReply() != bodies[n])
+                    ++failed;
+            }
+
+            write( last.substr(20) );
+            if(readReply() != "last")
+                ++failed;
+        }
+        catch(const std::exception&)
+        {
+            failed = sizes.size() + 1;
+        }
+
+        socket.close();
+        loop->exit();
+    }
+
+    Pt::System::EventLoop* loop;
+    unsigned short port;
+    std::vector<std::size_t> sizes;
+    Pt::Net::TcpSocket socket;
+    std::string input;
+    std::size_t failed;
+};
+
+}
+
+
+class HttpConnectionTest : public Pt::Unit::TestSuite
+{
+    public:
+        HttpConnectionTest()
+        : Pt::Unit::TestSuite("HttpConnectionTest")
+        , _loop(0)
+        , _timedOut(false)
+        {
+            this->registerMethod("echoSmall", *this, &HttpConnectionTest::echoSmall);
+            this->registerMethod("echoLarge", *this, &HttpConnectionTest::echoLarge);
+            this->registerMethod("pipelined", *this, &HttpConnectionTest::pipelined);
+            this->registerMethod("pipelinedSingle", *this, &HttpConnectionTest::pipelinedSingle);
+            this->registerMethod("pipelinedNoDelay", *this, &HttpConnectionTest::pipelinedNoDelay);
+        }
+
+        void echoSmall()
+        {
+            std::vector<std::size_t> sizes;
+            sizes.push_back(1);
+            sizes.push_back(100);
+            sizes.push_back(1000);
+
+            PT_UNIT_ASSERT_EQUALS(runEcho(27301, sizes), 0u);
+        }
+
+        void echoLarge()
+        {
+            // bodies span several slabs of the connection buffer and are
+            // large enough to be sent without copying
+            std::vector<std::size_t> sizes;
+            sizes.push_back(4096);
+            sizes.push_back(4097);
+            sizes.push_back(100000);
+            sizes.push_back(5);
+            sizes.push_back(1024 * 1024);
+
+            PT_UNIT_ASSERT_EQUALS(runEcho(27302, sizes), 0u);
+        }
+
+        void pipelined()
+        {
+            // more requests than a batch, some replies are queued by reference
+            std::vector<std::size_t> sizes;
+            for(std::size_t n = 0; n < 40; ++n)
+                sizes.push_back(n % 10 == 9 ? 5000 : n * 3);
+
+            PT_UNIT_ASSERT_EQUALS(runPipeline(27303, sizes, 16, true), 0u);
+        }
+
+        void pipelinedSingle()
+        {
+            std::vector<std::size_t> sizes(10, 100);
+            PT_UNIT_ASSERT_EQUALS(runPipeline(27304, sizes, 1, true), 0u);
+        }
+
+        void pipelinedNoDelay()
+        {
+            // replies exceed the size of a batch
+            std::vector<std::size_t> sizes(30, 3000);
+            PT_UNIT_ASSERT_EQUALS(runPipeline(27305, sizes, 16, false), 0u);
+        }
+
+    private:
+        std::size_t runPipeline(unsigned short port, const std::vector<std::size_t>& sizes,
+                                std::size_t maxPipelined, bool noDelay)
+        {
+            Pt::System::MainLoop loop;
+            _loop = &loop;
+
+            Pt::System::Timer guard;
+            guard.timeout() += Pt::slot(*this, &HttpConnectionTest::onTimeout);
+            guard.setActive(loop);
+            guard.start(20000);
+
+            Pt::Http::BasicService<EchoResponder> service;
+            Pt::Http::MapUrl servlet("/echo", service);
+
+            Pt::Http::Server server(loop, Pt::Net::Endpoint::ip4Loopback(port));
+            server.setMaxPipelined(maxPipelined);
+            server.setNoDelay(noDelay);
+            server.addServlet(servlet);
+
+            PT_UNIT_ASSERT_EQUALS(server.maxPipelined(), maxPipelined);
+            PT_UNIT_ASSERT(server.noDelay() == noDelay);
+
+            PipelineClient client(loop, port, sizes);
+            Pt::System::AttachedThread thread( Pt::callable(client, &PipelineClient::run) );
+            thread.start();
+
+            _timedOut = false;
+            loop.run();
+
+            thread.join();
+            server.removeServlet(servlet);
+
+            PT_UNIT_ASSERT( ! _timedOut );
+            return client.failed;
+        }
+
+        std::size_t runEcho(unsigned short port, const std::vector<std::size_t>& sizes)
+        {
+            Pt::System::MainLoop loop;
+            _loop = &loop;
+
+            Pt::System::Timer guard;
+            guard.timeout() += Pt::slot(*this, &HttpConnectionTest::onTimeout);
+            guard.setActive(loop);
+            guard.start(20000);
+
+            Pt::Http::BasicService<EchoResponder> service;
+            Pt::Http::MapUrl servlet("/echo", service);
+
+            Pt::Http::Server server(loop, Pt::Net::Endpoint::ip4Loopback(port));
+            server.addServlet(servlet);
+
+            EchoClient echo(loop, port, sizes);
+            Pt::System::AttachedThread thread( Pt::callable(echo, &EchoClient::run) );
+            thread.start();
+
+            _timedOut = false;
+            loop.run();
+
+            thread.join();
+            server.removeServlet(servlet);
+
+            PT_UNIT_ASSERT( ! _timedOut );
+            return echo.failed;
+        }
+
+        void onTimeout()
+        {
+            _timedOut = true;
+            _loop->exit();
+        }
+
+    private:
+        Pt::System::MainLoop* _loop;
+        bool _timedOut;
+};
+
+Pt::Unit::RegisterTest<HttpConnectionTest> register_HttpConnectionTest;
@@ -0,0 +1,343 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "Parser.h"
+#include "HttpBuffer.h"
+#include <Pt/Unit/Assertion.h>
+#include <Pt/Unit/TestSuite.h>
+#include <Pt/Unit/RegisterTest.h>
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// records the events of a parser as strings
+class RecordingEvent : public Pt::Http::HeaderParser::Event
+{
+    public:
+        void onMethod(const std::string& method)
+        { log.push_back("method " + method); }
+
+        void onUrl(const std::string& url)
+        { log.push_back("url " + url); }
+
+        void onUrlParam(const std::string& q)
+        { log.push_back("param " + q); }
+
+        void onHttpVersion(unsigned major, unsigned minor)
+        {
+            std::ostringstream os;
+            os << "version " << major << "." << minor;
+            log.push_back(os.str());
+        }
+
+        void onKey(const std::string& key)
+        { log.push_back("key " + key); }
+
+        void onValue(const std::string& value)
+        { log.push_back("value " + value); }
+
+        void onHttpReturn(unsigned ret, const std::string& text)
+        {
+            std::ostringstream os;
+            os << "return " << ret << " " << text;
+            log.push_back(os.str());
+        }
+
+        void onEnd()
+        { log.push_back("end"); }
+
+        std::vector<std::string> log;
+};
+
+
+const char* const Requests[] = {
+    "GET /index.html HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+    "Accept-Language: en-US,en;q=0.5\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n",
+
+    "POST /cgi%20bin/a+b?name=a+b&x=%41 HTTP/1.0\r\n"
+    "Content-Length: 5\r\n"
+    "X-Empty:\r\n"
+    "X-Folded: first\r\n"
+    "  second\r\n"
+    "\r\n",
+
+    "GET / HTTP/1.1\n"
+    "Host: a\n"
+    "\n"
+};
+
+const char* const Replies[] = {
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/plain\r\n"
+    "Transfer-Encoding: chunked\r\n"
+    "\r\n",
+
+    "HTTP/1.0 404 Not Found\r\n"
+    "Content-Length: 0\r\n"
+    "\r\n"
+};
+
+
+std::vector<std::string> parseChars(const std::string& msg, bool client)
+{
+    RecordingEvent ev;
+    Pt::Http::HeaderParser parser(ev, client);
+
+    for(std::size_t n = 0; n < msg.size(); ++n)
+    {
+        if( parser.parse(msg[n]) )
+            break;
+    }
+
+    return ev.log;
+}
+
+
+// parses the message in two buffers, which are split at a position
+std::vector<std::string> parseSplit(const std::string& msg, std::size_t split, bool client, std::size_t& used)
+{
+    RecordingEvent ev;
+    Pt::Http::HeaderParser parser(ev, client);
+
+    // the first buffer is modified after parsing, tokens must be copied
+    std::string first = msg.substr(0, split);
+    used = parser.parse(first.data(), first.size());
+    first.assign(first.size(), '#');
+
+    if( ! parser.end() )
+    {
+        std::string second = msg.substr(split);
+        used += parser.parse(second.data(), second.size());
+    }
+
+    return ev.log;
+}
+
+
+std::string decodeChunked(const std::string& body, std::size_t step, bool& complete)
+{
+    Pt::Http::ChunkParser parser;
+    std::string data;
+    std::size_t pos = 0;
+    std::size_t remaining = 0;
+
+    while(pos < body.size() && ! parser.end())
+    {
+        std::size_t n = std::min(step, body.size() - pos);
+
+        if(remaining > 0)
+        {
+            n = std::min(n, remaining);
+            data.append(body, pos, n);
+            remaining -= n;
+            pos += n;
+            continue;
+        }
+
+        pos += parser.parse(body.data() + pos, n);
+
+        if( parser.hasChunk() )
+            remaining = parser.chunkSize();
+    }
+
+    complete = parser.end() && pos == body.size();
+    return data;
+}
+
+}
+
+
+class HttpParserTest : public Pt::Unit::TestSuite
+{
+    public:
+        HttpParserTest()
+        : Pt::Unit::TestSuite("HttpParserTest")
+        {
+            this->registerMethod("parseRequest", *this, &HttpParserTest::parseRequest);
+            this->registerMethod("parseEscapes", *this, &HttpParserTest::parseEscapes);
+            this->registerMethod("parseReply", *this, &HttpParserTest::parseReply);
+            this->registerMethod("splitRequests", *this, &HttpParserTest::splitRequests);
+            this->registerMethod("splitReplies", *this, &HttpParserTest::splitReplies);
+            this->registerMethod("stopAtBody", *this, &HttpParserTest::stopAtBody);
+            this->registerMethod("invalidRequest", *this, &HttpParserTest::invalidRequest);
+            this->registerMethod("chunkedBody", *this, &HttpParserTest::chunkedBody);
+        }
+
+        void parseRequest()
+        {
+            const char* const expected[] = {
+                "method GET",
+                "url /index.html",
+                "version 1.1",
+                "key Host",
+                "value www.example.com",
+                "key User-Agent",
+                "value Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0 Safari/537.36",
+                "key Accept",
+                "value text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8",
+                "key Accept-Language",
+                "value en-US,en;q=0.5",
+                "key Connection",
+                "value keep-alive",
+                "end"
+            };
+
+            const std::string msg = Requests[0];
+            std::size_t used = 0;
+            std::vector<std::string> log = parseSplit(msg, msg.size(), false, used);
+
+            PT_UNIT_ASSERT_EQUALS(used, msg.size());
+            PT_UNIT_ASSERT(log == std::vector<std::string>(expected, expected + sizeof(expected) / sizeof(expected[0])));
+        }
+
+        void parseEscapes()
+        {
+            const char* const expected[] = {
+                "method POST",
+                "url /cgi bin/a b",
+                "param name=a+b&x=%41",
+                "version 1.0",
+                "key Content-Length",
+                "value 5",
+                "key X-Empty",
+                "value ",
+                "key X-Folded",
+                "value first  second",
+                "end"
+            };
+
+            const std::string msg = Requests[1];
+            std::size_t used = 0;
+            std::vector<std::string> log = parseSplit(msg, msg.size(), false, used);
+
+            PT_UNIT_ASSERT_EQUALS(used, msg.size());
+            PT_UNIT_ASSERT(log == std::vector<std::string>(expected, expected + sizeof(expected) / sizeof(expected[0])));
+        }
+
+        void parseReply()
+        {
+            const char* const expected[] = {
+                "version 1.0",
+                "return 404 Not Found",
+                "key Content-Length",
+                "value 0",
+                "end"
+            };
+
+            const std::string msg = Replies[1];
+            std::size_t used = 0;
+            std::vector<std::string> log = parseSplit(msg, msg.size(), true, used);
+
+            PT_UNIT_ASSERT_EQUALS(used, msg.size());
+            PT_UNIT_ASSERT(log == std::vector<std::string>(expected, expected + sizeof(expected) / sizeof(expected[0])));
+        }
+
+        void splitRequests()
+        {
+            for(std::size_t r = 0; r < sizeof(Requests) / sizeof(Requests[0]); ++r)
+            {
+                const std::string msg = Requests[r];
+                const std::vector<std::string> expected = parseChars(msg, false);
+
+                for(std::size_t split = 0; split <= msg.size(); ++split)
+                {
+                    std::size_t used = 0;
+                    PT_UNIT_ASSERT(parseSplit(msg, split, false, used) == expected);
+                    PT_UNIT_ASSERT_EQUALS(used, msg.size());
+                }
+            }
+        }
+
+        void splitReplies()
+        {
+            for(std::size_t r = 0; r < sizeof(Replies) / sizeof(Replies[0]); ++r)
+            {
+                const std::string msg = Replies[r];
+                const std::vector<std::string> expected = parseChars(msg, true);
+
+                for(std::size_t split = 0; split <= msg.size(); ++split)
+                {
+                    std::size_t used = 0;
+                    PT_UNIT_ASSERT(parseSplit(msg, split, true, used) == expected);
+                    PT_UNIT_ASSERT_EQUALS(used, msg.size());
+                }
+            }
+        }
+
+        void stopAtBody()
+        {
+            // parsing stops after the header, the body is left
+            const std::string header = Requests[1];
+            const std::string msg = header + "hello";
+
+            RecordingEvent ev;
+            Pt::Http::HeaderParser parser(ev, false);
+
+            PT_UNIT_ASSERT_EQUALS(parser.parse(msg.data(), msg.size()), header.size());
+            PT_UNIT_ASSERT( parser.end() );
+            PT_UNIT_ASSERT( ! parser.fail() );
+        }
+
+        void invalidRequest()
+        {
+            const std::string msg = "GET /index.html HTTP/x.1\r\n\r\n";
+
+            RecordingEvent ev;
+            Pt::Http::HeaderParser parser(ev, false);
+            parser.parse(msg.data(), msg.size());
+
+            PT_UNIT_ASSERT( parser.fail() );
+        }
+
+        void chunkedBody()
+        {
+            const std::string body = "4;name=value\r\nWiki\r\n"
+                                     "5\r\npedia\r\n"
+                                     "E\r\n in\r\n\r\nchunks.\r\n"
+                                     "0\r\n"
+                                     "Trailer: ignored\r\n"
+                                     "\r\n";
+
+            for(std::size_t step = 1; step <= body.size(); ++step)
+            {
+                bool complete = false;
+                PT_UNIT_ASSERT(decodeChunked(body, step, complete) == "Wikipedia in\r\n\r\nchunks.");
+                PT_UNIT_ASSERT(complete);
+            }
+        }
+};
+
+Pt::Unit::RegisterTest<HttpParserTest> register_HttpParserTest;
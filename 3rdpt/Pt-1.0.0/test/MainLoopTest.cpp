@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include <Pt/Unit/Assertion.h>
+#include <Pt/Unit/TestSuite.h>
+#include <Pt/Unit/RegisterTest.h>
+#include <Pt/System/MainLoop.h>
+#include <Pt/System/Timer.h>
+#include <Pt/System/Pipe.h>
+#include <string>
+
+class MainLoopTest : public Pt::Unit::TestSuite
+{
+    public:
+        MainLoopTest()
+        : Pt::Unit::TestSuite("MainLoopTest")
+        , _loop(0)
+        , _pipe(0)
+        , _writes(0)
+        , _timedOut(false)
+        {
+            this->registerMethod("readPipe", *this, &MainLoopTest::readPipe);
+            this->registerMethod("readPipeEdgeTriggered", *this, &MainLoopTest::readPipeEdgeTriggered);
+            this->registerMethod("readPipeIoUring", *this, &MainLoopTest::readPipeIoUring);
+        }
+
+        void readPipe()
+        {
+            Pt::System::MainLoopOptions opts;
+            runPipe(opts);
+        }
+
+        void readPipeEdgeTriggered()
+        {
+            Pt::System::MainLoopOptions opts;
+            opts.setEdgeTriggered();
+            runPipe(opts);
+        }
+
+        void readPipeIoUring()
+        {
+            Pt::System::MainLoopOptions opts;
+            opts.setIoUring();
+            runPipe(opts);
+        }
+
+    private:
+        void runPipe(const Pt::System::MainLoopOptions& opts)
+        {
+            Pt::System::MainLoop loop(opts);
+            Pt::System::Pipe pipe;
+            _loop = &loop;
+            _pipe = &pipe;
+            _received.clear();
+            _writes = 0;
+
+            Pt::System::Timer guard;
+            guard.timeout() += Pt::slot(*this, &MainLoopTest::onTimeout);
+            guard.setActive(loop);
+            guard.start(5000);
+
+            pipe.out().inputReady() += Pt::slot(*this, &MainLoopTest::onInput);
+            pipe.out().setActive(loop);
+            pipe.out().beginRead(_buffer, sizeof(_buffer));
+
+            writeNext();
+
+            _timedOut = false;
+            loop.run();
+
+            pipe.out().cancel();
+
+            PT_UNIT_ASSERT( ! _timedOut );
+            PT_UNIT_ASSERT_EQUALS(_received, std::string("onetwothree"));
+        }
+
+        void writeNext()
+        {
+            static const char* words[] = { "one", "two", "three" };
+
+            const std::string word = words[_writes++];
+            _pipe->in().write( word.data(), word.size() );
+        }
+
+        void onInput(Pt::System::IODevice& dev)
+        {
+            std::size_t n = dev.endRead();
+            _received.append(_buffer, n);
+
+            if(_writes == 3)
+            {
+                _loop->exit();
+                return;
+            }
+
+            writeNext();
+            dev.beginRead(_buffer, sizeof(_buffer));
+        }
+
+        void onTimeout()
+        {
+            _timedOut = true;
+            _loop->exit();
+        }
+
+    private:
+        Pt::System::MainLoop* _loop;
+        Pt::System::Pipe* _pipe;
+        std::string _received;
+        char _buffer[64];
+        std::size_t _writes;
+        bool _timedOut;
+};
+
+Pt::Unit::RegisterTest<MainLoopTest> register_MainLoopTest;
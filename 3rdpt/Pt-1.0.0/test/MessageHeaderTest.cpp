@@ -0,0 +1,326 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <Pt/Unit/Assertion.h>
+#include <Pt/Unit/TestSuite.h>
+#include <Pt/Unit/RegisterTest.h>
+#include <Pt/Http/Message.h>
+#include <Pt/Http/HttpError.h>
+#include <sstream>
+#include <string>
+#include <cstring>
+
+namespace {
+
+std::string fieldName(std::size_t n)
+{
+    std::ostringstream os;
+    os << "X-Field-" << n;
+    return os.str();
+}
+
+
+std::string fieldValue(std::size_t n)
+{
+    std::ostringstream os;
+    os << "value " << n;
+    return os.str();
+}
+
+
+std::string upper(std::string s)
+{
+    for(std::size_t n = 0; n < s.size(); ++n)
+    {
+        if(s[n] >= 'a' && s[n] <= 'z')
+            s[n] = static_cast<char>(s[n] - ('a' - 'A'));
+    }
+
+    return s;
+}
+
+
+std::size_t countFields(const Pt::Http::MessageHeader& header)
+{
+    std::size_t count = 0;
+    for(Pt::Http::MessageHeader::ConstIterator it = header.begin(); it != header.end(); ++it)
+        ++count;
+
+    return count;
+}
+
+}
+
+
+class MessageHeaderTest : public Pt::Unit::TestSuite
+{
+    public:
+        MessageHeaderTest()
+        : Pt::Unit::TestSuite("MessageHeaderTest")
+        {
+            this->registerMethod("getIgnoresCase", *this, &MessageHeaderTest::getIgnoresCase);
+            this->registerMethod("firstFieldCounts", *this, &MessageHeaderTest::firstFieldCounts);
+            this->registerMethod("removeAndSet", *this, &MessageHeaderTest::removeAndSet);
+            this->registerMethod("manyFields", *this, &MessageHeaderTest::manyFields);
+            this->registerMethod("framingFields", *this, &MessageHeaderTest::framingFields);
+            this->registerMethod("keepAlive", *this, &MessageHeaderTest::keepAlive);
+            this->registerMethod("growAndMaxSize", *this, &MessageHeaderTest::growAndMaxSize);
+            this->registerMethod("clear", *this, &MessageHeaderTest::clear);
+        }
+
+        void getIgnoresCase()
+        {
+            Pt::Http::MessageHeader header;
+            PT_UNIT_ASSERT(header.get("Content-Type") == 0);
+            PT_UNIT_ASSERT(header.begin() == header.end());
+
+            header.add("Content-Type", "text/html");
+
+            // the key and value need not be null-terminated
+            const char raw[] = "Accept-Language: en";
+            header.add(raw, 15, raw + 17, 2);
+
+            PT_UNIT_ASSERT_EQUALS(std::string(header.get("Content-Type")), "text/html");
+            PT_UNIT_ASSERT_EQUALS(std::string(header.get("content-type")), "text/html");
+            PT_UNIT_ASSERT_EQUALS(std::string(header.get("CONTENT-TYPE")), "text/html");
+            PT_UNIT_ASSERT_EQUALS(std::string(header.get("accept-language")), "en");
+
+            // prefixes and extensions of a name do not match
+            PT_UNIT_ASSERT( ! header.has("Content") );
+            PT_UNIT_ASSERT( ! header.has("Content-Type-Options") );
+            PT_UNIT_ASSERT( ! header.has("Accept") );
+
+            PT_UNIT_ASSERT( header.isSet("content-type", "TEXT/HTML") );
+            PT_UNIT_ASSERT( ! header.isSet("content-type", "text") );
+            PT_UNIT_ASSERT( ! header.isSet("Accept", "en") );
+        }
+
+        void firstFieldCounts()
+        {
+            Pt::Http::MessageHeader header;
+            header.add("Set-Cookie", "a=1");
+            header.add("Host", "localhost");
+            header.add("set-cookie", "b=2");
+
+            PT_UNIT_ASSERT_EQUALS(std::string(header.get("Set-Cookie")), "a=1");
+            PT_UNIT_ASSERT_EQUALS(countFields(header), 3u);
+
+            // fields are iterated in the order they were added
+            Pt::Http::MessageHeader::ConstIterator it = header.begin();
+            PT_UNIT_ASSERT_EQUALS(std::string(it->name()), "Set-Cookie");
+            ++it;
+            PT_UNIT_ASSERT_EQUALS(std::string(it->name()), "Host");
+            ++it;
+            PT_UNIT_ASSERT_EQUALS(std::string(it->name()), "set-cookie");
+            PT_UNIT_ASSERT_EQUALS(std::string(it->value()), "b=2");
+            ++it;
+            PT_UNIT_ASSERT(it == header.end());
+        }
+
+        void removeAndSet()
+        {
+            Pt::Http::MessageHeader header;
+            header.add("Set-Cookie", "a=1");
+            header.add("Host", "localhost");
+            header.add("SET-COOKIE", "b=2");
+            header.add("Accept", "*/*");
+
+            // all fields of a name are removed
+            header.remove("set-cookie");
+            PT_UNIT_ASSERT( ! header.has("Set-Cookie") );
+            PT_UNIT_ASSERT_EQUALS(countFields(header), 2u);
+            PT_UNIT_ASSERT_EQUALS(std::string(header.get("host")), "localhost");
+            PT_UNIT_ASSERT_EQUALS(std::string(header.get("accept")), "*/*");
+
+            header.remove("Unknown");
+            PT_UNIT_ASSERT_EQUALS(countFields(header), 2u);
+
+            header.set("HOST", "example.com");
+            PT_UNIT_ASSERT_EQUALS(std::string(header.get("Host")), "example.com");
+            PT_UNIT_ASSERT_EQUALS(countFields(header), 2u);
+
+            PT_UNIT_ASSERT_THROW(header.remove(""), std::invalid_argument);
+            PT_UNIT_ASSERT_THROW(header.add("", "value"), std::invalid_argument);
+        }
+
+        void manyFields()
+        {
+            // more names than the index holds, the rest is searched linearly
+            const std::size_t count = 60;
+
+            Pt::Http::MessageHeader header;
+            header.setMaxSize(16384);
+
+            for(std::size_t n = 0; n < count; ++n)
+                header.add(fieldName(n).c_str(), fieldValue(n).c_str());
+
+            for(std::size_t n = 0; n < count; ++n)
+            {
+                const char* value = header.get( upper(fieldName(n)).c_str() );
+                PT_UNIT_ASSERT(value != 0);
+                PT_UNIT_ASSERT_EQUALS(std::string(value), fieldValue(n));
+            }
+
+            PT_UNIT_ASSERT( ! header.has("X-Field-60") );
+            PT_UNIT_ASSERT( ! header.has("X-Field") );
+
+            // removing rebuilds the index, indexed and linearly searched
+            // names must still be found
+            for(std::size_t n = 0; n < count; n += 3)
+                header.remove( fieldName(n).c_str() );
+
+            for(std::size_t n = 0; n < count; ++n)
+            {
+                const char* value = header.get( fieldName(n).c_str() );
+                if(n % 3 == 0)
+                {
+                    PT_UNIT_ASSERT(value == 0);
+                }
+                else
+                {
+                    PT_UNIT_ASSERT(value != 0);
+                    PT_UNIT_ASSERT_EQUALS(std::string(value), fieldValue(n));
+                }
+            }
+
+            PT_UNIT_ASSERT_EQUALS(countFields(header), count - count / 3);
+
+            // framing fields are resolved after many other fields
+            header.add("content-length", "42");
+            PT_UNIT_ASSERT_EQUALS(header.contentLength(), 42u);
+        }
+
+        void framingFields()
+        {
+            Pt::Http::MessageHeader header;
+            PT_UNIT_ASSERT_EQUALS(header.contentLength(), 0u);
+            PT_UNIT_ASSERT( ! header.isChunked() );
+
+            header.add("Content-Length", "1234");
+            header.add("content-length", "99");
+            header.add("Transfer-Encoding", "Chunked");
+
+            // the first field of a name counts
+            PT_UNIT_ASSERT_EQUALS(header.contentLength(), 1234u);
+            PT_UNIT_ASSERT( header.isChunked() );
+
+            // removing a field moves the others, their values must follow
+            header.remove("Content-Length");
+            PT_UNIT_ASSERT_EQUALS(header.contentLength(), 0u);
+            PT_UNIT_ASSERT( header.isChunked() );
+
+            header.set("TRANSFER-ENCODING", "gzip");
+            PT_UNIT_ASSERT( ! header.isChunked() );
+
+            header.set("Content-Length", "77");
+            PT_UNIT_ASSERT_EQUALS(header.contentLength(), 77u);
+        }
+
+        void keepAlive()
+        {
+            Pt::Http::MessageHeader header;
+
+            header.setVersion(1, 1);
+            PT_UNIT_ASSERT( header.isKeepAlive() );
+
+            header.setVersion(1, 0);
+            PT_UNIT_ASSERT( ! header.isKeepAlive() );
+
+            header.setVersion(2, 0);
+            PT_UNIT_ASSERT( header.isKeepAlive() );
+
+            header.setVersion(1, 0);
+            header.add("Connection", "Keep-Alive");
+            PT_UNIT_ASSERT( header.isKeepAlive() );
+
+            header.setVersion(1, 1);
+            header.set("connection", "close");
+            PT_UNIT_ASSERT( ! header.isKeepAlive() );
+
+            header.remove("CONNECTION");
+            PT_UNIT_ASSERT( header.isKeepAlive() );
+        }
+
+        void growAndMaxSize()
+        {
+            Pt::Http::MessageHeader header;
+            PT_UNIT_ASSERT_EQUALS(header.maxSize(), Pt::Http::MessageHeader::DefaultMaxSize);
+
+            // grows the storage over several blocks
+            const std::string value(600, 'v');
+            for(std::size_t n = 0; n < 6; ++n)
+                header.add(fieldName(n).c_str(), value.c_str());
+
+            for(std::size_t n = 0; n < 6; ++n)
+                PT_UNIT_ASSERT_EQUALS(std::string(header.get(fieldName(n).c_str())), value);
+
+            PT_UNIT_ASSERT_THROW(header.add("X-Large", value.c_str()), Pt::Http::HttpError);
+            PT_UNIT_ASSERT( ! header.has("X-Large") );
+            PT_UNIT_ASSERT_EQUALS(countFields(header), 6u);
+
+            header.setMaxSize(8192);
+            header.add("X-Large", value.c_str());
+            PT_UNIT_ASSERT_EQUALS(std::string(header.get("x-large")), value);
+
+            // fields already added are not affected by a smaller size
+            header.setMaxSize(100);
+            PT_UNIT_ASSERT_EQUALS(countFields(header), 7u);
+            PT_UNIT_ASSERT_THROW(header.add("X", "y"), Pt::Http::HttpError);
+        }
+
+        void clear()
+        {
+            Pt::Http::MessageHeader header;
+            header.setVersion(1, 0);
+            header.add("Content-Length", "10");
+            header.add("Transfer-Encoding", "chunked");
+            header.add("Connection", "close");
+
+            for(std::size_t n = 0; n < 40; ++n)
+                header.add(fieldName(n).c_str(), fieldValue(n).c_str());
+
+            header.clear();
+
+            PT_UNIT_ASSERT(header.begin() == header.end());
+            PT_UNIT_ASSERT( ! header.has("Content-Length") );
+            PT_UNIT_ASSERT( ! header.has("X-Field-30") );
+            PT_UNIT_ASSERT_EQUALS(header.contentLength(), 0u);
+            PT_UNIT_ASSERT( ! header.isChunked() );
+            PT_UNIT_ASSERT( header.isKeepAlive() );
+            PT_UNIT_ASSERT_EQUALS(header.versionMajor(), 1u);
+            PT_UNIT_ASSERT_EQUALS(header.versionMinor(), 1u);
+
+            // the header is reused with a fresh index
+            header.add("x-field-30", "again");
+            PT_UNIT_ASSERT_EQUALS(std::string(header.get("X-Field-30")), "again");
+            PT_UNIT_ASSERT( ! header.has("X-Field-29") );
+            PT_UNIT_ASSERT_EQUALS(countFields(header), 1u);
+        }
+};
+
+Pt::Unit::RegisterTest<MessageHeaderTest> register_MessageHeaderTest;
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <Pt/Unit/Assertion.h>
+#include <Pt/Unit/TestSuite.h>
+#include <Pt/Unit/RegisterTest.h>
+#include <Pt/System/MpmcQueue.h>
+#include <Pt/System/Thread.h>
+#include <vector>
+
+namespace {
+
+struct MpmcProducer
+{
+    MpmcProducer(Pt::System::MpmcQueue<int>& queue, int first, int count)
+    : queue(&queue)
+    , first(first)
+    , count(count)
+    {}
+
+    void run()
+    {
+        for(int n = first; n < first + count; ++n)
+            queue->put(n);
+    }
+
+    Pt::System::MpmcQueue<int>* queue;
+    int first;
+    int count;
+};
+
+
+struct MpmcConsumer
+{
+    MpmcConsumer(Pt::System::MpmcQueue<int>& queue, int count)
+    : queue(&queue)
+    , count(count)
+    {}
+
+    void run()
+    {
+        for(int n = 0; n < count; ++n)
+            values.push_back( queue->get() );
+    }
+
+    Pt::System::MpmcQueue<int>* queue;
+    int count;
+    std::vector<int> values;
+};
+
+}
+
+
+class MpmcQueueTest : public Pt::Unit::TestSuite
+{
+    public:
+        MpmcQueueTest()
+        : Pt::Unit::TestSuite("MpmcQueueTest")
+        {
+            this->registerMethod("fullAndEmpty", *this, &MpmcQueueTest::fullAndEmpty);
+            this->registerMethod("wrapAround", *this, &MpmcQueueTest::wrapAround);
+            this->registerMethod("producersAndConsumers", *this, &MpmcQueueTest::producersAndConsumers);
+        }
+
+        void fullAndEmpty()
+        {
+            Pt::System::MpmcQueue<int> queue(3);
+            PT_UNIT_ASSERT_EQUALS(queue.capacity(), 4u);
+
+            int value = 0;
+            PT_UNIT_ASSERT( ! queue.tryGet(value) );
+
+            for(int n = 0; n < 4; ++n)
+                PT_UNIT_ASSERT( queue.tryPut(n) );
+
+            PT_UNIT_ASSERT( ! queue.tryPut(4) );
+
+            for(int n = 0; n < 4; ++n)
+            {
+                PT_UNIT_ASSERT( queue.tryGet(value) );
+                PT_UNIT_ASSERT_EQUALS(value, n);
+            }
+
+            PT_UNIT_ASSERT( ! queue.tryGet(value) );
+            PT_UNIT_ASSERT( queue.empty() );
+        }
+
+        void wrapAround()
+        {
+            Pt::System::MpmcQueue<int> queue(2);
+
+            for(int n = 0; n < 1000; ++n)
+            {
+                PT_UNIT_ASSERT( queue.tryPut(n) );
+
+                int value = -1;
+                PT_UNIT_ASSERT( queue.tryGet(value) );
+                PT_UNIT_ASSERT_EQUALS(value, n);
+            }
+        }
+
+        void producersAndConsumers()
+        {
+            const int threads = 4;
+            const int count = 20000;
+
+            Pt::System::MpmcQueue<int> queue(64);
+
+            std::vector<MpmcProducer> producers;
+            std::vector<MpmcConsumer> consumers;
+            for(int n = 0; n < threads; ++n)
+            {
+                producers.push_back( MpmcProducer(queue, n * count, count) );
+                consumers.push_back( MpmcConsumer(queue, count) );
+            }
+
+            std::vector<Pt::System::AttachedThread*> running;
+            for(int n = 0; n < threads; ++n)
+            {
+                running.push_back( new Pt::System::AttachedThread( Pt::callable(consumers[n], &MpmcConsumer::run) ) );
+                running.back()->start();
+
+                running.push_back( new Pt::System::AttachedThread( Pt::callable(producers[n], &MpmcProducer::run) ) );
+                running.back()->start();
+            }
+
+            for(std::size_t n = 0; n < running.size(); ++n)
+            {
+                running[n]->join();
+                delete running[n];
+            }
+
+            // each value was taken exactly once and the values of one
+            // producer were taken in order by each consumer
+            std::vector<int> seen(threads * count, 0);
+            bool ordered = true;
+
+            for(int c = 0; c < threads; ++c)
+            {
+                std::vector<int> last(threads, -1);
+                const std::vector<int>& values = consumers[c].values;
+
+                for(std::size_t n = 0; n < values.size(); ++n)
+                {
+                    int value = values[n];
+                    ++seen[value];
+
+                    int producer = value / count;
+                    if(value <= last[producer])
+                        ordered = false;
+
+                    last[producer] = value;
+                }
+            }
+
+            for(std::size_t n = 0; n < seen.size(); ++n)
+                PT_UNIT_ASSERT_EQUALS(seen[n], 1);
+
+            PT_UNIT_ASSERT(ordered);
+            PT_UNIT_ASSERT( queue.empty() );
+        }
+};
+
+Pt::Unit::RegisterTest<MpmcQueueTest> register_MpmcQueueTest;
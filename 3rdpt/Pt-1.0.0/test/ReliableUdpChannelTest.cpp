@@ -0,0 +1,327 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <Pt/Unit/Assertion.h>
+#include <Pt/Unit/TestSuite.h>
+#include <Pt/Unit/RegisterTest.h>
+#include <Pt/Net/ReliableUdpChannel.h>
+#include <Pt/Net/UdpSocket.h>
+#include <Pt/Net/Endpoint.h>
+#include <Pt/System/Thread.h>
+#include <Pt/System/Clock.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+Pt::int64_t now()
+{
+    return Pt::System::Clock::getMonotonicTime() / 1000000;
+}
+
+
+std::string message(std::size_t index, std::size_t size)
+{
+    char buf[16];
+    std::sprintf(buf, "%06u:", static_cast<unsigned>(index));
+
+    std::string msg(buf);
+    msg.resize(std::max(size, msg.size()), static_cast<char>('a' + index % 26));
+    return msg;
+}
+
+
+std::size_t messageIndex(const std::string& msg)
+{
+    return std::strtoul(msg.substr(0, 6).c_str(), 0, 10);
+}
+
+
+// relays the datagrams of two channels over loopback and drops or
+// delays them, channel A sends to endpointA() and channel B to endpointB()
+class LossyLink
+{
+    public:
+        LossyLink(unsigned lossPercent, unsigned latency, unsigned jitter)
+        : _lossPercent(lossPercent)
+        , _latency(latency)
+        , _jitter(jitter)
+        , _dropFromA(0)
+        , _seed(42)
+        {
+            _socketA.bind( Pt::Net::Endpoint::ip4Loopback(0) );
+            _socketB.bind( Pt::Net::Endpoint::ip4Loopback(0) );
+        }
+
+        Pt::Net::Endpoint endpointA() const
+        {
+            Pt::Net::Endpoint ep;
+            _socketA.localEndpoint(ep);
+            return ep;
+        }
+
+        Pt::Net::Endpoint endpointB() const
+        {
+            Pt::Net::Endpoint ep;
+            _socketB.localEndpoint(ep);
+            return ep;
+        }
+
+        void connect(Pt::Net::ReliableUdpChannel& a, Pt::Net::ReliableUdpChannel& b)
+        {
+            a.socket().localEndpoint(_peerA);
+            b.socket().localEndpoint(_peerB);
+        }
+
+        // drops the next n datagrams sent by channel A
+        void dropFromA(std::size_t n)
+        { _dropFromA = n; }
+
+        void pump()
+        {
+            const Pt::int64_t t = now();
+
+            receive(_socketA, _toB, t, true);
+            receive(_socketB, _toA, t, false);
+
+            // the datagrams to A are sent from the socket A is connected to
+            deliver(_socketB, _peerB, _toB, t);
+            deliver(_socketA, _peerA, _toA, t);
+        }
+
+    private:
+        typedef std::multimap<Pt::int64_t, std::string> Queue;
+
+        unsigned random()
+        {
+            _seed = _seed * 1103515245u + 12345u;
+            return (_seed >> 16) & 0x7fff;
+        }
+
+        void receive(Pt::Net::UdpSocket& socket, Queue& queue, Pt::int64_t t, bool fromA)
+        {
+            char buffer[2048];
+            Pt::Net::Datagram dgram(buffer, sizeof(buffer));
+
+            while(socket.receive(&dgram, 1) > 0)
+            {
+                if(fromA && _dropFromA > 0)
+                {
+                    --_dropFromA;
+                    continue;
+                }
+
+                if(random() % 100 < _lossPercent)
+                    continue;
+
+                Pt::int64_t due = t + _latency;
+                if(_jitter > 0)
+                    due += random() % _jitter;
+
+                queue.insert( Queue::value_type(due, std::string(buffer, dgram.received)) );
+            }
+        }
+
+        void deliver(Pt::Net::UdpSocket& socket, const Pt::Net::Endpoint& to, Queue& queue, Pt::int64_t t)
+        {
+            while( ! queue.empty() && queue.begin()->first <= t )
+            {
+                const std::string& data = queue.begin()->second;
+                socket.sendTo(to, data.data(), data.size());
+                queue.erase( queue.begin() );
+            }
+        }
+
+    private:
+        Pt::Net::UdpSocket _socketA;
+        Pt::Net::UdpSocket _socketB;
+        Pt::Net::Endpoint _peerA;
+        Pt::Net::Endpoint _peerB;
+        Queue _toA;
+        Queue _toB;
+        unsigned _lossPercent;
+        unsigned _latency;
+        unsigned _jitter;
+        std::size_t _dropFromA;
+        unsigned _seed;
+};
+
+}
+
+
+class ReliableUdpChannelTest : public Pt::Unit::TestSuite
+{
+    public:
+        ReliableUdpChannelTest()
+        : Pt::Unit::TestSuite("ReliableUdpChannelTest")
+        {
+            this->registerMethod("firstPacketLost", *this, &ReliableUdpChannelTest::firstPacketLost);
+            this->registerMethod("lossAndLatency", *this, &ReliableUdpChannelTest::lossAndLatency);
+        }
+
+        void firstPacketLost()
+        {
+            LossyLink link(0, 0, 0);
+
+            Pt::Net::ReliableUdpChannel a;
+            Pt::Net::ReliableUdpChannel b;
+            std::size_t lane = a.addLane(Pt::Net::ReliableUdpChannel::ReliableOrdered);
+            b.addLane(Pt::Net::ReliableUdpChannel::ReliableOrdered);
+
+            a.open(Pt::Net::Endpoint::ip4Loopback(0), link.endpointA());
+            b.open(Pt::Net::Endpoint::ip4Loopback(0), link.endpointB());
+            link.connect(a, b);
+
+            // the first packet of A is lost, while the first packet of B,
+            // which has not received anything, must not acknowledge it
+            link.dropFromA(1);
+            a.send(lane, "hello", 5);
+            a.update();
+            link.pump();
+
+            std::string data;
+            std::size_t from = 0;
+            bool received = false;
+
+            const Pt::int64_t deadline = now() + 5000;
+            while( ! received && now() < deadline )
+            {
+                b.update();
+                link.pump();
+                a.update();
+                link.pump();
+
+                received = b.receive(data, from);
+                Pt::System::Thread::sleep(1);
+            }
+
+            PT_UNIT_ASSERT(received);
+            PT_UNIT_ASSERT(data == "hello");
+            PT_UNIT_ASSERT(a.packetsLost() > 0);
+        }
+
+        void lossAndLatency()
+        {
+            LossyLink link(10, 5, 5);
+
+            Pt::Net::ReliableUdpChannel a;
+            Pt::Net::ReliableUdpChannel b;
+
+            std::size_t ordered = a.addLane(Pt::Net::ReliableUdpChannel::ReliableOrdered);
+            std::size_t unordered = a.addLane(Pt::Net::ReliableUdpChannel::ReliableUnordered);
+            std::size_t sequenced = a.addLane(Pt::Net::ReliableUdpChannel::UnreliableSequenced);
+            b.addLane(Pt::Net::ReliableUdpChannel::ReliableOrdered);
+            b.addLane(Pt::Net::ReliableUdpChannel::ReliableUnordered);
+            b.addLane(Pt::Net::ReliableUdpChannel::UnreliableSequenced);
+
+            a.open(Pt::Net::Endpoint::ip4Loopback(0), link.endpointA());
+            b.open(Pt::Net::Endpoint::ip4Loopback(0), link.endpointB());
+            link.connect(a, b);
+
+            const std::size_t count = 200;
+            std::size_t sent = 0;
+
+            std::vector<std::size_t> orderedIn;
+            std::set<std::size_t> unorderedIn;
+            std::vector<std::size_t> sequencedIn;
+            std::size_t duplicates = 0;
+            bool corrupt = false;
+
+            const Pt::int64_t deadline = now() + 20000;
+            while( (orderedIn.size() < count || unorderedIn.size() < count) && now() < deadline )
+            {
+                // every tenth reliable message is fragmented
+                for(std::size_t n = 0; n < 4 && sent < count; ++n, ++sent)
+                {
+                    std::size_t size = sent % 10 == 0 ? 3000 : 100;
+                    std::string msg = message(sent, size);
+
+                    a.send(ordered, msg.data(), msg.size());
+                    a.send(unordered, msg.data(), msg.size());
+                    a.send(sequenced, msg.data(), 20);
+                }
+
+                a.update();
+                link.pump();
+                b.update();
+                link.pump();
+
+                std::string data;
+                std::size_t lane = 0;
+                while( b.receive(data, lane) )
+                {
+                    std::size_t index = messageIndex(data);
+
+                    if(lane == ordered)
+                    {
+                        orderedIn.push_back(index);
+                        corrupt |= data != message(index, index % 10 == 0 ? 3000 : 100);
+                    }
+                    else if(lane == unordered)
+                    {
+                        if( ! unorderedIn.insert(index).second )
+                            ++duplicates;
+
+                        corrupt |= data != message(index, index % 10 == 0 ? 3000 : 100);
+                    }
+                    else
+                    {
+                        sequencedIn.push_back(index);
+                        corrupt |= data != message(index, 20);
+                    }
+                }
+
+                Pt::System::Thread::sleep(1);
+            }
+
+            PT_UNIT_ASSERT( ! corrupt );
+            PT_UNIT_ASSERT_EQUALS(duplicates, 0u);
+
+            PT_UNIT_ASSERT_EQUALS(orderedIn.size(), count);
+            for(std::size_t n = 0; n < orderedIn.size(); ++n)
+                PT_UNIT_ASSERT_EQUALS(orderedIn[n], n);
+
+            PT_UNIT_ASSERT_EQUALS(unorderedIn.size(), count);
+
+            // lost sequenced messages are not sent again and older ones
+            // are dropped
+            PT_UNIT_ASSERT( ! sequencedIn.empty() );
+            PT_UNIT_ASSERT(sequencedIn.size() < count);
+            for(std::size_t n = 1; n < sequencedIn.size(); ++n)
+                PT_UNIT_ASSERT(sequencedIn[n] > sequencedIn[n - 1]);
+
+            PT_UNIT_ASSERT(a.packetsLost() > 0);
+        }
+};
+
+Pt::Unit::RegisterTest<ReliableUdpChannelTest> register_ReliableUdpChannelTest;
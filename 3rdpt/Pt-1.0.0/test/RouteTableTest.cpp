@@ -0,0 +1,535 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RouteTable.h"
+#include "Connection.h"
+#include <Pt/Unit/Assertion.h>
+#include <Pt/Unit/TestSuite.h>
+#include <Pt/Unit/RegisterTest.h>
+#include <Pt/Http/Server.h>
+#include <Pt/Http/Client.h>
+#include <Pt/Http/Service.h>
+#include <Pt/Http/Servlet.h>
+#include <Pt/Http/Responder.h>
+#include <Pt/Http/Request.h>
+#include <Pt/Http/Reply.h>
+#include <Pt/Net/Endpoint.h>
+#include <Pt/System/MainLoop.h>
+#include <Pt/System/Thread.h>
+#include <Pt/System/Timer.h>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// replies with the URL of the request
+class UrlResponder : public Pt::Http::Responder
+{
+    public:
+        explicit UrlResponder(Pt::Http::Service& service)
+        : Pt::Http::Responder(service)
+        {}
+
+    protected:
+        void onBeginRequest(Pt::Http::Request& request, Pt::Http::Reply& reply, Pt::System::EventLoop& loop)
+        {}
+
+        void onReadRequest(Pt::Http::Request& request, Pt::Http::Reply& reply, Pt::System::EventLoop& loop)
+        {
+            request.body().ignore( request.body().rdbuf()->in_avail() );
+        }
+
+        void onBeginReply(const Pt::Http::Request& request, Pt::Http::Reply& reply, Pt::System::EventLoop& loop)
+        {
+            reply.body() << request.url();
+            reply.beginSend(true);
+        }
+
+        void onWriteReply(const Pt::Http::Request& request, Pt::Http::Reply& reply, Pt::System::EventLoop& loop)
+        {
+            reply.beginSend(true);
+        }
+};
+
+
+// servlet without a route, which counts how often it was asked
+class CountingServlet : public Pt::Http::Servlet
+{
+    public:
+        CountingServlet(const std::string& url, Pt::Http::Service& s)
+        : Pt::Http::Servlet(s)
+        , _url(url)
+        , _asked(0)
+        {}
+
+        std::size_t asked() const
+        { return _asked; }
+
+    protected:
+        bool onRequest(const Pt::Http::Request& request) const
+        {
+            ++_asked;
+            return request.url() == _url;
+        }
+
+    private:
+        std::string _url;
+        mutable std::size_t _asked;
+};
+
+
+// overrides the URL match of MapUrl
+class PrefixUrl : public Pt::Http::MapUrl
+{
+    public:
+        PrefixUrl(const std::string& prefix, Pt::Http::Service& s)
+        : Pt::Http::MapUrl(prefix, s)
+        , _prefix(prefix)
+        {}
+
+    protected:
+        bool onRequest(const Pt::Http::Request& request) const
+        { return request.url().compare(0, _prefix.size(), _prefix) == 0; }
+
+    private:
+        std::string _prefix;
+};
+
+
+struct ChurnClient
+{
+    ChurnClient(Pt::System::EventLoop& loop, unsigned short port)
+    : loop(&loop)
+    , port(port)
+    , received(0)
+    , failed(0)
+    {}
+
+    void run()
+    {
+        try
+        {
+            // several connections, so that more than one worker is used
+            for(std::size_t c = 0; c < 4; ++c)
+            {
+                Pt::Http::Client client( Pt::Net::Endpoint::ip4Loopback(port) );
+
+                for(std::size_t n = 0; n < 50; ++n)
+                {
+                    client.request().clear();
+                    client.request().setUrl("/stable");
+                    client.send();
+
+                    std::istream& is = client.receive();
+                    std::string reply( (std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>() );
+
+                    if(reply != "/stable")
+                        ++failed;
+
+                    ++received;
+                }
+            }
+        }
+        catch(const std::exception&)
+        {
+            ++failed;
+        }
+
+        loop->exit();
+    }
+
+    Pt::System::EventLoop* loop;
+    unsigned short port;
+    std::size_t received;
+    std::size_t failed;
+};
+
+} // namespace
+
+
+class RouteTableTest : public Pt::Unit::TestSuite
+{
+    public:
+        RouteTableTest()
+        : Pt::Unit::TestSuite("RouteTableTest")
+        , _server(0)
+        , _churn(0)
+        , _loop(0)
+        , _swaps(0)
+        , _timedOut(false)
+        {
+            this->registerMethod("exactPath", *this, &RouteTableTest::exactPath);
+            this->registerMethod("methodRoute", *this, &RouteTableTest::methodRoute);
+            this->registerMethod("paramRoute", *this, &RouteTableTest::paramRoute);
+            this->registerMethod("wildcardRoute", *this, &RouteTableTest::wildcardRoute);
+            this->registerMethod("firstAddedWins", *this, &RouteTableTest::firstAddedWins);
+            this->registerMethod("fallbackOrder", *this, &RouteTableTest::fallbackOrder);
+            this->registerMethod("overriddenMapUrl", *this, &RouteTableTest::overriddenMapUrl);
+            this->registerMethod("publishRoutes", *this, &RouteTableTest::publishRoutes);
+            this->registerMethod("swapWhileServing", *this, &RouteTableTest::swapWhileServing);
+        }
+
+        void exactPath()
+        {
+            Pt::Http::BasicService<UrlResponder> service;
+            Pt::Http::MapUrl a("/a", service);
+            Pt::Http::MapUrl b("/b/c", service);
+            Pt::Http::MapRoute c("/c/d", service);
+
+            Pt::Http::RouteTable table;
+            table.addServlet(a);
+            table.addServlet(b);
+            table.addServlet(c);
+
+            // more paths than the smallest hash index holds
+            std::vector<Pt::Http::MapUrl*> more;
+            for(std::size_t n = 0; n < 20; ++n)
+            {
+                std::string url = "/more/";
+                url += static_cast<char>('a' + n);
+                more.push_back( new Pt::Http::MapUrl(url, service) );
+                table.addServlet( *more.back() );
+            }
+
+            table.commit();
+
+            PT_UNIT_ASSERT( find(table, "/a") == &a );
+            PT_UNIT_ASSERT( find(table, "/b/c") == &b );
+            PT_UNIT_ASSERT( find(table, "/c/d") == &c );
+            PT_UNIT_ASSERT( find(table, "/more/k") == more[10] );
+            PT_UNIT_ASSERT( find(table, "/a/") == 0 );
+            PT_UNIT_ASSERT( find(table, "/b") == 0 );
+            PT_UNIT_ASSERT( find(table, "/x") == 0 );
+            PT_UNIT_ASSERT( find(table, "") == 0 );
+
+            for(std::size_t n = 0; n < more.size(); ++n)
+                delete more[n];
+        }
+
+        void methodRoute()
+        {
+            Pt::Http::BasicService<UrlResponder> service;
+            Pt::Http::MapRoute post("POST", "/a", service);
+            Pt::Http::MapUrl any("/a", service);
+            Pt::Http::MapRoute put("PUT", "/b/{id}", service);
+
+            Pt::Http::RouteTable table;
+            table.addServlet(post);
+            table.addServlet(any);
+            table.addServlet(put);
+            table.commit();
+
+            PT_UNIT_ASSERT( find(table, "/a", "POST") == &post );
+            PT_UNIT_ASSERT( find(table, "/a", "GET") == &any );
+            PT_UNIT_ASSERT( find(table, "/b/1", "PUT") == &put );
+            PT_UNIT_ASSERT( find(table, "/b/1", "GET") == 0 );
+        }
+
+        void paramRoute()
+        {
+            Pt::Http::BasicService<UrlResponder> service;
+            Pt::Http::MapRoute inventory("/player/{id}/inventory", service);
+            Pt::Http::MapRoute item("/player/{id}/item/{item}", service);
+
+            Pt::Http::RouteTable table;
+            table.addServlet(inventory);
+            table.addServlet(item);
+            table.commit();
+
+            Pt::Http::Connection conn;
+            Pt::Http::Request request(conn, "/player/42/inventory");
+            PT_UNIT_ASSERT( table.find(request) == &inventory );
+            PT_UNIT_ASSERT_EQUALS( request.pathParam("id"), "42" );
+
+            request.setUrl("/player/7/item/sword");
+            PT_UNIT_ASSERT( table.find(request) == &item );
+            PT_UNIT_ASSERT_EQUALS( request.pathParam("id"), "7" );
+            PT_UNIT_ASSERT_EQUALS( request.pathParam("item"), "sword" );
+
+            // parameters do not match empty segments
+            PT_UNIT_ASSERT( find(table, "/player//inventory") == 0 );
+            PT_UNIT_ASSERT( find(table, "/player/42") == 0 );
+            PT_UNIT_ASSERT( find(table, "/player/42/inventory/x") == 0 );
+            PT_UNIT_ASSERT( find(table, "/player/7/item/") == 0 );
+
+            PT_UNIT_ASSERT_THROW( Pt::Http::MapRoute("/a/{}", service), std::invalid_argument );
+            PT_UNIT_ASSERT_THROW( Pt::Http::MapRoute("/a/*/b", service), std::invalid_argument );
+            PT_UNIT_ASSERT_THROW( Pt::Http::MapRoute("a/b", service), std::invalid_argument );
+        }
+
+        void wildcardRoute()
+        {
+            Pt::Http::BasicService<UrlResponder> service;
+            Pt::Http::MapRoute files("/static/*", service);
+            Pt::Http::MapRoute user("/user/{name}/*", service);
+
+            Pt::Http::RouteTable table;
+            table.addServlet(files);
+            table.addServlet(user);
+            table.commit();
+
+            Pt::Http::Connection conn;
+            Pt::Http::Request request(conn, "/static/css/site.css");
+            PT_UNIT_ASSERT( table.find(request) == &files );
+            PT_UNIT_ASSERT_EQUALS( request.pathParam("*"), "css/site.css" );
+
+            request.setUrl("/user/bob/files/a.txt");
+            PT_UNIT_ASSERT( table.find(request) == &user );
+            PT_UNIT_ASSERT_EQUALS( request.pathParam("name"), "bob" );
+            PT_UNIT_ASSERT_EQUALS( request.pathParam("*"), "files/a.txt" );
+
+            PT_UNIT_ASSERT( find(table, "/stat") == 0 );
+            PT_UNIT_ASSERT( find(table, "/user") == 0 );
+        }
+
+        void firstAddedWins()
+        {
+            Pt::Http::BasicService<UrlResponder> service;
+
+            // a route added later is not selected, even if it is more
+            // specific, and subtrees of later routes are skipped
+            Pt::Http::MapRoute api("/api/*", service);
+            Pt::Http::MapRoute id("/api/{id}", service);
+            Pt::Http::MapUrl users("/api/users", service);
+            Pt::Http::MapRoute deep("/api/{id}/{sub}/x", service);
+
+            Pt::Http::RouteTable first;
+            first.addServlet(api);
+            first.addServlet(id);
+            first.addServlet(users);
+            first.addServlet(deep);
+            first.commit();
+
+            PT_UNIT_ASSERT( find(first, "/api/users") == &api );
+            PT_UNIT_ASSERT( find(first, "/api/7") == &api );
+            PT_UNIT_ASSERT( find(first, "/api/7/8/x") == &api );
+
+            Pt::Http::RouteTable last;
+            last.addServlet(users);
+            last.addServlet(deep);
+            last.addServlet(id);
+            last.addServlet(api);
+            last.commit();
+
+            PT_UNIT_ASSERT( find(last, "/api/users") == &users );
+            PT_UNIT_ASSERT( find(last, "/api/7") == &id );
+            PT_UNIT_ASSERT( find(last, "/api/7/8/x") == &deep );
+            PT_UNIT_ASSERT( find(last, "/api/7/8/y") == &api );
+
+            // a pattern added before an exact URL is found in the trie,
+            // although the hash index has a match
+            Pt::Http::MapRoute param("/q/{x}", service);
+            Pt::Http::MapUrl exact("/q/1", service);
+
+            Pt::Http::RouteTable mixed;
+            mixed.addServlet(param);
+            mixed.addServlet(exact);
+            mixed.commit();
+
+            PT_UNIT_ASSERT( find(mixed, "/q/1") == &param );
+        }
+
+        void fallbackOrder()
+        {
+            Pt::Http::BasicService<UrlResponder> service;
+            Pt::Http::MapUrl a("/a", service);
+            CountingServlet counting("/b", service);
+            Pt::Http::MapUrl b("/b", service);
+            Pt::Http::MapAny any(service);
+            Pt::Http::MapUrl c("/c", service);
+
+            Pt::Http::RouteTable table;
+            table.addServlet(a);
+            table.addServlet(counting);
+            table.addServlet(b);
+            table.addServlet(any);
+            table.addServlet(c);
+            table.commit();
+
+            // servlets without a route, which were added after the
+            // matching route, are not asked
+            PT_UNIT_ASSERT( find(table, "/a") == &a );
+            PT_UNIT_ASSERT_EQUALS( counting.asked(), 0u );
+
+            PT_UNIT_ASSERT( find(table, "/b") == &counting );
+            PT_UNIT_ASSERT_EQUALS( counting.asked(), 1u );
+
+            // fallbacks are asked in the order they were added
+            PT_UNIT_ASSERT( find(table, "/c") == &any );
+            PT_UNIT_ASSERT( find(table, "/x") == &any );
+            PT_UNIT_ASSERT_EQUALS( counting.asked(), 3u );
+        }
+
+        void overriddenMapUrl()
+        {
+            Pt::Http::BasicService<UrlResponder> service;
+            PrefixUrl prefix("/prefix", service);
+            Pt::Http::MapUrl exact("/prefix/b", service);
+
+            Pt::Http::RouteTable table;
+            table.addServlet(prefix);
+            table.addServlet(exact);
+            table.commit();
+
+            // the derived class is asked by onRequest()
+            PT_UNIT_ASSERT( find(table, "/prefix") == &prefix );
+            PT_UNIT_ASSERT( find(table, "/prefix/a") == &prefix );
+            PT_UNIT_ASSERT( find(table, "/prefix/b") == &prefix );
+        }
+
+        void publishRoutes()
+        {
+            Pt::Http::BasicService<UrlResponder> service;
+            Pt::Http::MapUrl a("/a", service);
+            Pt::Http::MapUrl b("/b", service);
+            Pt::Http::MapAny any(service);
+
+            Pt::Http::Server server;
+            PT_UNIT_ASSERT( find(server, "/a") == 0 );
+
+            server.addServlet(a);
+            server.addServlet(any);
+            PT_UNIT_ASSERT( find(server, "/a") == &a );
+            PT_UNIT_ASSERT( find(server, "/b") == &any );
+
+            server.addServlet(b);
+            PT_UNIT_ASSERT( find(server, "/b") == &any );
+
+            server.shutdownServlet(any, true);
+            PT_UNIT_ASSERT( find(server, "/b") == &b );
+            PT_UNIT_ASSERT( find(server, "/x") == 0 );
+
+            server.shutdownServlet(any, false);
+            PT_UNIT_ASSERT( find(server, "/b") == &any );
+
+            server.removeServlet(a);
+            PT_UNIT_ASSERT( find(server, "/a") == &any );
+
+            server.removeServlet(any);
+            PT_UNIT_ASSERT( find(server, "/a") == 0 );
+            PT_UNIT_ASSERT( find(server, "/b") == &b );
+        }
+
+        void swapWhileServing()
+        {
+            // the worker threads look up routes, while the tables are
+            // replaced and freed by the loop of the server
+            const unsigned short port = 27311;
+
+            Pt::System::MainLoop loop;
+            _loop = &loop;
+
+            Pt::System::Timer guard;
+            guard.timeout() += Pt::slot(*this, &RouteTableTest::onTimeout);
+            guard.setActive(loop);
+            guard.start(20000);
+
+            Pt::Http::BasicService<UrlResponder> service;
+            Pt::Http::MapUrl stable("/stable", service);
+            Pt::Http::MapUrl churn("/churn", service);
+
+            Pt::Http::Server server(loop);
+            server.setMaxThreads(3);
+            server.listen( Pt::Net::Endpoint::ip4Loopback(port) );
+            server.addServlet(stable);
+
+            _server = &server;
+            _churn = &churn;
+            _swaps = 0;
+
+            Pt::System::Timer swapper;
+            swapper.timeout() += Pt::slot(*this, &RouteTableTest::onSwap);
+            swapper.setActive(loop);
+            swapper.start(1);
+
+            ChurnClient client(loop, port);
+            Pt::System::AttachedThread thread( Pt::callable(client, &ChurnClient::run) );
+            thread.start();
+
+            _timedOut = false;
+            loop.run();
+
+            thread.join();
+            swapper.stop();
+
+            if(_swaps % 4 != 0)
+                server.removeServlet(churn);
+
+            server.removeServlet(stable);
+
+            PT_UNIT_ASSERT( ! _timedOut );
+            PT_UNIT_ASSERT( _swaps > 0 );
+            PT_UNIT_ASSERT_EQUALS( client.received, 200u );
+            PT_UNIT_ASSERT_EQUALS( client.failed, 0u );
+        }
+
+    private:
+        static Pt::Http::Servlet* find(const Pt::Http::RouteTable& table,
+                                       const char* url, const char* method = "GET")
+        {
+            Pt::Http::Connection conn;
+            Pt::Http::Request request(conn, url);
+            request.setMethod(method);
+            return table.find(request);
+        }
+
+        static Pt::Http::Servlet* find(Pt::Http::Server& server, const char* url)
+        {
+            Pt::Http::Connection conn;
+            Pt::Http::Request request(conn, url);
+            return server.getServlet(request);
+        }
+
+        void onSwap()
+        {
+            // each change publishes a new table
+            switch(_swaps++ % 4)
+            {
+                case 0: _server->addServlet(*_churn); break;
+                case 1: _server->shutdownServlet(*_churn, true); break;
+                case 2: _server->shutdownServlet(*_churn, false); break;
+                case 3: _server->removeServlet(*_churn); break;
+            }
+        }
+
+        void onTimeout()
+        {
+            _timedOut = true;
+            _loop->exit();
+        }
+
+    private:
+        Pt::Http::Server* _server;
+        Pt::Http::MapUrl* _churn;
+        Pt::System::MainLoop* _loop;
+        std::size_t _swaps;
+        bool _timedOut;
+};
+
+Pt::Unit::RegisterTest<RouteTableTest> register_RouteTableTest;
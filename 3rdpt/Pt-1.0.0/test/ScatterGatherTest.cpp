@@ -0,0 +1,356 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <Pt/Unit/Assertion.h>
+#include <Pt/Unit/TestSuite.h>
+#include <Pt/Unit/RegisterTest.h>
+#include <Pt/Net/TcpServer.h>
+#include <Pt/Net/TcpSocket.h>
+#include <Pt/Net/Endpoint.h>
+#include <Pt/System/MainLoop.h>
+#include <Pt/System/IOBuffer.h>
+#include <Pt/System/Timer.h>
+#include <Pt/RefCounted.h>
+#include <string>
+#include <vector>
+
+namespace {
+
+// skips n transferred bytes of a segment sequence
+void advance(std::vector<Pt::System::IOVec>& vec, std::size_t& first, std::size_t n)
+{
+    while(n > 0 && first < vec.size())
+    {
+        Pt::System::IOVec& seg = vec[first];
+        if(n < seg.size)
+        {
+            seg.base += n;
+            seg.size -= n;
+            return;
+        }
+
+        n -= seg.size;
+        seg.size = 0;
+        ++first;
+    }
+}
+
+
+std::string pattern(std::size_t size, int seed)
+{
+    std::string s(size, '\0');
+    for(std::size_t n = 0; n < size; ++n)
+        s[n] = static_cast<char>(n * 31 + seed);
+
+    return s;
+}
+
+
+std::string readAll(Pt::Net::TcpSocket& socket, std::size_t size)
+{
+    std::string data;
+    char buffer[4096];
+
+    while(data.size() < size)
+    {
+        std::size_t n = socket.read(buffer, sizeof(buffer));
+        if(n == 0)
+            break;
+
+        data.append(buffer, n);
+    }
+
+    return data;
+}
+
+
+class Payload : public Pt::RefCounted
+{
+    public:
+        explicit Payload(const std::string& data)
+        : Pt::RefCounted(1)
+        , data(data)
+        {}
+
+        std::string data;
+};
+
+}
+
+
+class ScatterGatherTest : public Pt::Unit::TestSuite
+{
+    public:
+        ScatterGatherTest()
+        : Pt::Unit::TestSuite("ScatterGatherTest")
+        , _loop(0)
+        , _timedOut(false)
+        {
+            this->registerMethod("writev", *this, &ScatterGatherTest::writev);
+            this->registerMethod("readv", *this, &ScatterGatherTest::readv);
+            this->registerMethod("beginWritev", *this, &ScatterGatherTest::beginWritev);
+            this->registerMethod("beginWritevIoUring", *this, &ScatterGatherTest::beginWritevIoUring);
+            this->registerMethod("queueOutput", *this, &ScatterGatherTest::queueOutput);
+        }
+
+        void writev()
+        {
+            Pt::Net::TcpServer server;
+            server.listen( Pt::Net::Endpoint::ip4Loopback(0) );
+
+            Pt::Net::Endpoint ep;
+            server.localEndpoint(ep);
+
+            Pt::Net::TcpSocket client(ep);
+            Pt::Net::TcpSocket peer(server);
+
+            const std::string header = "HEAD";
+            const std::string payload = pattern(10000, 1);
+            const std::string trailer = "TAIL";
+
+            std::vector<Pt::System::IOVec> vec;
+            vec.push_back( Pt::System::IOVec(header.data(), header.size()) );
+            vec.push_back( Pt::System::IOVec() );
+            vec.push_back( Pt::System::IOVec(payload.data(), payload.size()) );
+            vec.push_back( Pt::System::IOVec(trailer.data(), trailer.size()) );
+
+            const std::size_t total = header.size() + payload.size() + trailer.size();
+
+            std::size_t first = 0;
+            std::size_t written = 0;
+            while(written < total)
+            {
+                std::size_t n = client.writev(&vec[first], vec.size() - first);
+                advance(vec, first, n);
+                written += n;
+            }
+
+            PT_UNIT_ASSERT(readAll(peer, total) == header + payload + trailer);
+        }
+
+        void readv()
+        {
+            Pt::Net::TcpServer server;
+            server.listen( Pt::Net::Endpoint::ip4Loopback(0) );
+
+            Pt::Net::Endpoint ep;
+            server.localEndpoint(ep);
+
+            Pt::Net::TcpSocket client(ep);
+            Pt::Net::TcpSocket peer(server);
+
+            const std::string data = pattern(3000, 2);
+            std::size_t written = 0;
+            while(written < data.size())
+                written += client.write(data.data() + written, data.size() - written);
+
+            // the data is scattered over segments of different size
+            std::string a(7, '\0');
+            std::string b(1000, '\0');
+            std::string c(1993, '\0');
+
+            std::vector<Pt::System::IOVec> vec;
+            vec.push_back( Pt::System::IOVec(&a[0], a.size()) );
+            vec.push_back( Pt::System::IOVec(&b[0], b.size()) );
+            vec.push_back( Pt::System::IOVec(&c[0], c.size()) );
+
+            std::size_t first = 0;
+            std::size_t received = 0;
+            while(received < data.size())
+            {
+                std::size_t n = peer.readv(&vec[first], vec.size() - first);
+                PT_UNIT_ASSERT(n > 0);
+
+                advance(vec, first, n);
+                received += n;
+            }
+
+            PT_UNIT_ASSERT(a + b + c == data);
+        }
+
+        void beginWritev()
+        {
+            runBeginWritev( Pt::System::MainLoopOptions() );
+        }
+
+        void beginWritevIoUring()
+        {
+            Pt::System::MainLoopOptions opts;
+            opts.setIoUring();
+            runBeginWritev(opts);
+        }
+
+        void queueOutput()
+        {
+            Pt::Net::TcpServer server;
+            server.listen( Pt::Net::Endpoint::ip4Loopback(0) );
+
+            Pt::Net::Endpoint ep;
+            server.localEndpoint(ep);
+
+            Pt::Net::TcpSocket client(ep);
+            Pt::Net::TcpSocket peer(server);
+
+            Payload* payload = new Payload( pattern(20000, 6) );
+
+            Pt::System::IOBuffer buffer(client, 1024);
+            buffer.sputn("header:", 7);
+            buffer.queue(payload->data.data(), payload->data.size(), *payload);
+            buffer.sputn(":trailer", 8);
+
+            PT_UNIT_ASSERT_EQUALS(payload->refs(), 2u);
+            PT_UNIT_ASSERT_EQUALS(buffer.queued(), payload->data.size());
+
+            // the payload is written between the buffered bytes and
+            // released once it was sent
+            PT_UNIT_ASSERT_EQUALS(buffer.pubsync(), 0);
+            PT_UNIT_ASSERT_EQUALS(payload->refs(), 1u);
+            PT_UNIT_ASSERT_EQUALS(buffer.queued(), 0u);
+
+            const std::string expected = "header:" + payload->data + ":trailer";
+            PT_UNIT_ASSERT(readAll(peer, expected.size()) == expected);
+
+            // a queued reference that was not written is released too
+            buffer.queue(payload->data.data(), payload->data.size(), *payload);
+            PT_UNIT_ASSERT_EQUALS(payload->refs(), 2u);
+
+            buffer.discard();
+            PT_UNIT_ASSERT_EQUALS(payload->refs(), 1u);
+
+            payload->release();
+        }
+
+    private:
+        void runBeginWritev(const Pt::System::MainLoopOptions& opts)
+        {
+            Pt::System::MainLoop loop(opts);
+            _loop = &loop;
+
+            Pt::System::Timer guard;
+            guard.timeout() += Pt::slot(*this, &ScatterGatherTest::onTimeout);
+            guard.setActive(loop);
+            guard.start(10000);
+
+            Pt::Net::TcpServer server;
+            server.listen( Pt::Net::Endpoint::ip4Loopback(0) );
+
+            Pt::Net::Endpoint ep;
+            server.localEndpoint(ep);
+
+            Pt::Net::TcpSocket client(ep);
+            Pt::Net::TcpSocket peer(server);
+            client.setActive(loop);
+            peer.setActive(loop);
+
+            // larger than the socket buffers, so both sides complete
+            // several partial operations
+            _header = pattern(100, 3);
+            _payload = pattern(512 * 1024, 4);
+            _trailer = pattern(100, 5);
+            _expected = _header + _payload + _trailer;
+
+            _wvec.clear();
+            _wvec.push_back( Pt::System::IOVec(_header.data(), _header.size()) );
+            _wvec.push_back( Pt::System::IOVec(_payload.data(), _payload.size()) );
+            _wvec.push_back( Pt::System::IOVec(_trailer.data(), _trailer.size()) );
+            _wfirst = 0;
+            _written = 0;
+
+            _received.assign(_expected.size(), '\0');
+            _rvec.clear();
+            _rvec.push_back( Pt::System::IOVec(&_received[0], 1000) );
+            _rvec.push_back( Pt::System::IOVec(&_received[1000], _received.size() - 1000) );
+            _rfirst = 0;
+            _read = 0;
+
+            client.outputReady() += Pt::slot(*this, &ScatterGatherTest::onOutput);
+            peer.inputReady() += Pt::slot(*this, &ScatterGatherTest::onInput);
+
+            client.beginWritev(&_wvec[0], _wvec.size());
+            peer.beginReadv(&_rvec[0], _rvec.size());
+
+            _timedOut = false;
+            loop.run();
+
+            PT_UNIT_ASSERT( ! _timedOut );
+            PT_UNIT_ASSERT_EQUALS(_written, _expected.size());
+            PT_UNIT_ASSERT_EQUALS(_read, _expected.size());
+            PT_UNIT_ASSERT(_received == _expected);
+        }
+
+        void onOutput(Pt::System::IODevice& dev)
+        {
+            std::size_t n = dev.endWrite();
+            advance(_wvec, _wfirst, n);
+            _written += n;
+
+            if(_wfirst < _wvec.size())
+                dev.beginWritev(&_wvec[_wfirst], _wvec.size() - _wfirst);
+        }
+
+        void onInput(Pt::System::IODevice& dev)
+        {
+            std::size_t n = dev.endRead();
+            if(dev.isEof())
+            {
+                _loop->exit();
+                return;
+            }
+
+            advance(_rvec, _rfirst, n);
+            _read += n;
+
+            if(_rfirst < _rvec.size())
+                dev.beginReadv(&_rvec[_rfirst], _rvec.size() - _rfirst);
+            else
+                _loop->exit();
+        }
+
+        void onTimeout()
+        {
+            _timedOut = true;
+            _loop->exit();
+        }
+
+    private:
+        Pt::System::MainLoop* _loop;
+        std::string _header;
+        std::string _payload;
+        std::string _trailer;
+        std::string _expected;
+        std::string _received;
+        std::vector<Pt::System::IOVec> _wvec;
+        std::vector<Pt::System::IOVec> _rvec;
+        std::size_t _wfirst;
+        std::size_t _rfirst;
+        std::size_t _written;
+        std::size_t _read;
+        bool _timedOut;
+};
+
+Pt::Unit::RegisterTest<ScatterGatherTest> register_ScatterGatherTest;
@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <Pt/Unit/Assertion.h>
+#include <Pt/Unit/TestSuite.h>
+#include <Pt/Unit/RegisterTest.h>
+#include <Pt/Net/TcpServer.h>
+#include <Pt/Net/TcpSocket.h>
+#include <Pt/Net/Endpoint.h>
+#include <Pt/System/FileDevice.h>
+#include <Pt/System/MainLoop.h>
+#include <Pt/System/Thread.h>
+#include <Pt/System/Timer.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+std::string pattern(std::size_t size)
+{
+    std::string s(size, '\0');
+    for(std::size_t n = 0; n < size; ++n)
+        s[n] = static_cast<char>(n * 13 + n / 4096);
+
+    return s;
+}
+
+
+std::string tempPath(const char* name)
+{
+    std::ostringstream os;
+    os << "/tmp/" << name << "." << ::getpid();
+    return os.str();
+}
+
+
+struct Drain
+{
+    Drain(Pt::Net::TcpSocket& socket, std::size_t size)
+    : socket(&socket)
+    , size(size)
+    {}
+
+    void run()
+    {
+        char buffer[65536];
+        while(data.size() < size)
+        {
+            std::size_t n = socket->read(buffer, sizeof(buffer));
+            if(n == 0)
+                break;
+
+            data.append(buffer, n);
+        }
+    }
+
+    Pt::Net::TcpSocket* socket;
+    std::size_t size;
+    std::string data;
+};
+
+}
+
+
+class SendFileTest : public Pt::Unit::TestSuite
+{
+    public:
+        SendFileTest()
+        : Pt::Unit::TestSuite("SendFileTest")
+        , _loop(0)
+        , _fifo(-1)
+        , _sent(0)
+        , _outputs(0)
+        , _timedOut(false)
+        {
+            this->registerMethod("sendRegularFile", *this, &SendFileTest::sendRegularFile);
+#if defined(__linux__)
+            this->registerMethod("sendEmptyPipe", *this, &SendFileTest::sendEmptyPipe);
+#endif
+        }
+
+        void sendRegularFile()
+        {
+            const std::string path = tempPath("SendFileTest");
+            const std::string content = pattern(1024 * 1024 + 17);
+
+            {
+                std::ofstream os(path.c_str(), std::ios::binary);
+                os.write(content.data(), static_cast<std::streamsize>(content.size()));
+            }
+
+            Pt::Net::TcpServer server;
+            server.listen( Pt::Net::Endpoint::ip4Loopback(0) );
+
+            Pt::Net::Endpoint ep;
+            server.localEndpoint(ep);
+
+            Pt::Net::TcpSocket client(ep);
+            Pt::Net::TcpSocket peer(server);
+
+            // the file is larger than the socket buffers
+            Drain drain(peer, content.size() - 100);
+            Pt::System::AttachedThread thread( Pt::callable(drain, &Drain::run) );
+            thread.start();
+
+            Pt::System::FileDevice file(path, std::ios::in);
+
+            std::size_t sent = 0;
+            while(sent < content.size() - 100)
+                sent += client.sendFile(file, 100 + sent, content.size() - 100 - sent);
+
+            thread.join();
+            file.close();
+            std::remove( path.c_str() );
+
+            PT_UNIT_ASSERT(drain.data == content.substr(100));
+        }
+
+#if defined(__linux__)
+        void sendEmptyPipe()
+        {
+            const std::string path = tempPath("SendFileTestFifo");
+            std::remove( path.c_str() );
+            PT_UNIT_ASSERT_EQUALS(::mkfifo(path.c_str(), 0600), 0);
+
+            // opened for writing first, so that the reader does not block
+            _fifo = ::open(path.c_str(), O_RDWR);
+            PT_UNIT_ASSERT(_fifo >= 0);
+
+            Pt::System::FileDevice file(path, std::ios::in);
+
+            Pt::System::MainLoop loop;
+            _loop = &loop;
+
+            Pt::System::Timer guard;
+            guard.timeout() += Pt::slot(*this, &SendFileTest::onTimeout);
+            guard.setActive(loop);
+            guard.start(5000);
+
+            // the pipe is filled after the send has begun
+            Pt::System::Timer fill;
+            fill.timeout() += Pt::slot(*this, &SendFileTest::onFill);
+            fill.setActive(loop);
+            fill.start(50);
+
+            Pt::Net::TcpServer server;
+            server.listen( Pt::Net::Endpoint::ip4Loopback(0) );
+
+            Pt::Net::Endpoint ep;
+            server.localEndpoint(ep);
+
+            Pt::Net::TcpSocket client(ep);
+            Pt::Net::TcpSocket peer(server);
+            client.setActive(loop);
+            client.outputReady() += Pt::slot(*this, &SendFileTest::onOutput);
+
+            _sent = 0;
+            _outputs = 0;
+            _timedOut = false;
+            client.beginSendFile(file, 0, 5);
+            loop.run();
+
+            client.cancel();
+            file.close();
+            ::close(_fifo);
+            std::remove( path.c_str() );
+
+            PT_UNIT_ASSERT( ! _timedOut );
+            PT_UNIT_ASSERT_EQUALS(_outputs, 1u);
+            PT_UNIT_ASSERT_EQUALS(_sent, 5u);
+
+            char buffer[5];
+            std::size_t received = 0;
+            while(received < sizeof(buffer))
+                received += peer.read(buffer + received, sizeof(buffer) - received);
+
+            PT_UNIT_ASSERT(std::string(buffer, 5) == "hello");
+        }
+#endif
+
+    private:
+        void onFill()
+        {
+            ssize_t ret = ::write(_fifo, "hello", 5);
+            (void) ret;
+        }
+
+        void onOutput(Pt::System::IODevice& dev)
+        {
+            ++_outputs;
+            _sent = dev.endWrite();
+            _loop->exit();
+        }
+
+        void onTimeout()
+        {
+            _timedOut = true;
+            _loop->exit();
+        }
+
+    private:
+        Pt::System::MainLoop* _loop;
+        int _fifo;
+        std::size_t _sent;
+        std::size_t _outputs;
+        bool _timedOut;
+};
+
+Pt::Unit::RegisterTest<SendFileTest> register_SendFileTest;
@@ -0,0 +1,359 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <Pt/Unit/Assertion.h>
+#include <Pt/Unit/TestSuite.h>
+#include <Pt/Unit/RegisterTest.h>
+#include <Pt/Signal.h>
+#include <Pt/Connectable.h>
+#include <vector>
+
+namespace {
+
+class Receiver : public Pt::Connectable
+{
+    public:
+        Receiver(std::vector<int>& calls, int id)
+        : _calls(&calls)
+        , _id(id)
+        {}
+
+        void onSignal(int value)
+        {
+            _calls->push_back(_id * 1000 + value);
+        }
+
+    private:
+        std::vector<int>* _calls;
+        int _id;
+};
+
+}
+
+
+class SignalTest : public Pt::Unit::TestSuite
+{
+    public:
+        SignalTest()
+        : Pt::Unit::TestSuite("SignalTest")
+        , _signal(0)
+        , _calls(0)
+        , _other(0)
+        , _deleteSignal(0)
+        {
+            this->registerMethod("sendWithoutSlots", *this, &SignalTest::sendWithoutSlots);
+            this->registerMethod("sendToSlots", *this, &SignalTest::sendToSlots);
+            this->registerMethod("disconnectSlot", *this, &SignalTest::disconnectSlot);
+            this->registerMethod("receiverDestroyed", *this, &SignalTest::receiverDestroyed);
+            this->registerMethod("disconnectWhileSending", *this, &SignalTest::disconnectWhileSending);
+            this->registerMethod("connectWhileSending", *this, &SignalTest::connectWhileSending);
+            this->registerMethod("nestedSend", *this, &SignalTest::nestedSend);
+            this->registerMethod("deleteWhileSending", *this, &SignalTest::deleteWhileSending);
+            this->registerMethod("chainSignals", *this, &SignalTest::chainSignals);
+            this->registerMethod("copySignal", *this, &SignalTest::copySignal);
+            this->registerMethod("copyInlineSlot", *this, &SignalTest::copyInlineSlot);
+        }
+
+        void sendWithoutSlots()
+        {
+            Pt::Signal<int> signal;
+            signal.send(1);
+            signal(2);
+        }
+
+        void sendToSlots()
+        {
+            std::vector<int> calls;
+            std::vector<Receiver*> receivers;
+
+            // enough slots to move out of the inline slot
+            Pt::Signal<int> signal;
+            for(int n = 0; n < 9; ++n)
+            {
+                receivers.push_back( new Receiver(calls, n) );
+                signal += Pt::slot(*receivers.back(), &Receiver::onSignal);
+            }
+
+            signal.send(7);
+
+            PT_UNIT_ASSERT_EQUALS(calls.size(), 9u);
+            for(int n = 0; n < 9; ++n)
+                PT_UNIT_ASSERT_EQUALS(calls[n], n * 1000 + 7);
+
+            for(std::size_t n = 0; n < receivers.size(); ++n)
+                delete receivers[n];
+        }
+
+        void disconnectSlot()
+        {
+            std::vector<int> calls;
+            Receiver a(calls, 1);
+            Receiver b(calls, 2);
+            Receiver c(calls, 3);
+
+            Pt::Signal<int> signal;
+            signal += Pt::slot(a, &Receiver::onSignal);
+            signal += Pt::slot(b, &Receiver::onSignal);
+            signal += Pt::slot(c, &Receiver::onSignal);
+
+            signal -= Pt::slot(b, &Receiver::onSignal);
+            signal.send(0);
+
+            PT_UNIT_ASSERT_EQUALS(calls.size(), 2u);
+            PT_UNIT_ASSERT_EQUALS(calls[0], 1000);
+            PT_UNIT_ASSERT_EQUALS(calls[1], 3000);
+
+            signal -= Pt::slot(a, &Receiver::onSignal);
+            signal -= Pt::slot(c, &Receiver::onSignal);
+
+            calls.clear();
+            signal.send(0);
+            PT_UNIT_ASSERT( calls.empty() );
+        }
+
+        void receiverDestroyed()
+        {
+            std::vector<int> calls;
+            Pt::Signal<int> signal;
+
+            {
+                Receiver a(calls, 1);
+                signal += Pt::slot(a, &Receiver::onSignal);
+            }
+
+            Receiver b(calls, 2);
+            signal += Pt::slot(b, &Receiver::onSignal);
+
+            signal.send(5);
+
+            PT_UNIT_ASSERT_EQUALS(calls.size(), 1u);
+            PT_UNIT_ASSERT_EQUALS(calls[0], 2005);
+        }
+
+        void disconnectWhileSending()
+        {
+            std::vector<int> calls;
+            Receiver a(calls, 1);
+            Receiver c(calls, 3);
+
+            Pt::Signal<int> signal;
+            _signal = &signal;
+            _calls = &calls;
+            _other = &c;
+
+            // the first slot removes itself and the last slot
+            signal += Pt::slot(*this, &SignalTest::disconnectSelf);
+            signal += Pt::slot(a, &Receiver::onSignal);
+            signal += Pt::slot(c, &Receiver::onSignal);
+
+            signal.send(1);
+
+            PT_UNIT_ASSERT_EQUALS(calls.size(), 2u);
+            PT_UNIT_ASSERT_EQUALS(calls[0], 1);
+            PT_UNIT_ASSERT_EQUALS(calls[1], 1001);
+
+            calls.clear();
+            signal.send(2);
+
+            PT_UNIT_ASSERT_EQUALS(calls.size(), 1u);
+            PT_UNIT_ASSERT_EQUALS(calls[0], 1002);
+        }
+
+        void connectWhileSending()
+        {
+            std::vector<int> calls;
+            Receiver a(calls, 1);
+
+            Pt::Signal<int> signal;
+            _signal = &signal;
+            _calls = &calls;
+            _other = &a;
+
+            signal += Pt::slot(*this, &SignalTest::connectOther);
+
+            // the new slot is only called by the next send
+            signal.send(1);
+            PT_UNIT_ASSERT_EQUALS(calls.size(), 1u);
+            PT_UNIT_ASSERT_EQUALS(calls[0], 1);
+
+            calls.clear();
+            signal.send(2);
+            PT_UNIT_ASSERT_EQUALS(calls.size(), 2u);
+            PT_UNIT_ASSERT_EQUALS(calls[0], 2);
+            PT_UNIT_ASSERT_EQUALS(calls[1], 1002);
+        }
+
+        void nestedSend()
+        {
+            std::vector<int> calls;
+            Receiver a(calls, 1);
+
+            Pt::Signal<int> signal;
+            _signal = &signal;
+            _calls = &calls;
+            _other = &a;
+
+            signal += Pt::slot(*this, &SignalTest::sendAgain);
+            signal += Pt::slot(a, &Receiver::onSignal);
+
+            // the inner send removes the receiver, the outer send must
+            // skip it and the table is compacted afterwards
+            signal.send(2);
+
+            PT_UNIT_ASSERT_EQUALS(calls.size(), 3u);
+            PT_UNIT_ASSERT_EQUALS(calls[0], 2);
+            PT_UNIT_ASSERT_EQUALS(calls[1], 1);
+            PT_UNIT_ASSERT_EQUALS(calls[2], 0);
+
+            calls.clear();
+            signal.send(0);
+            PT_UNIT_ASSERT_EQUALS(calls.size(), 1u);
+            PT_UNIT_ASSERT_EQUALS(calls[0], 0);
+        }
+
+        void deleteWhileSending()
+        {
+            std::vector<int> calls;
+            Receiver a(calls, 1);
+
+            _deleteSignal = new Pt::Signal<int>;
+            _calls = &calls;
+
+            *_deleteSignal += Pt::slot(*this, &SignalTest::deleteSignal);
+            *_deleteSignal += Pt::slot(a, &Receiver::onSignal);
+
+            _deleteSignal->send(3);
+
+            PT_UNIT_ASSERT( _deleteSignal == 0 );
+            PT_UNIT_ASSERT_EQUALS(calls.size(), 1u);
+            PT_UNIT_ASSERT_EQUALS(calls[0], 3);
+        }
+
+        void chainSignals()
+        {
+            std::vector<int> calls;
+            Receiver a(calls, 1);
+
+            Pt::Signal<int> second;
+            Pt::Signal<int> first;
+            first += Pt::slot(second);
+            second += Pt::slot(a, &Receiver::onSignal);
+
+            first.send(4);
+            PT_UNIT_ASSERT_EQUALS(calls.size(), 1u);
+            PT_UNIT_ASSERT_EQUALS(calls[0], 1004);
+        }
+
+        void copySignal()
+        {
+            std::vector<int> calls;
+            Receiver a(calls, 1);
+            Receiver b(calls, 2);
+
+            Pt::Signal<int> signal;
+            signal += Pt::slot(a, &Receiver::onSignal);
+            signal += Pt::slot(b, &Receiver::onSignal);
+
+            Pt::Signal<int> copy(signal);
+            copy.send(6);
+
+            PT_UNIT_ASSERT_EQUALS(calls.size(), 2u);
+            PT_UNIT_ASSERT_EQUALS(calls[0], 1006);
+            PT_UNIT_ASSERT_EQUALS(calls[1], 2006);
+        }
+
+        void copyInlineSlot()
+        {
+            std::vector<int> calls;
+            Receiver a(calls, 1);
+            Receiver b(calls, 2);
+
+            // a single slot is kept inline, the copies must not share it
+            Pt::Signal<int>* signal = new Pt::Signal<int>;
+            *signal += Pt::slot(a, &Receiver::onSignal);
+
+            Pt::Signal<int> copy(*signal);
+            Pt::Signal<int> assigned;
+            assigned += Pt::slot(b, &Receiver::onSignal);
+            assigned = *signal;
+
+            *signal -= Pt::slot(a, &Receiver::onSignal);
+            delete signal;
+
+            copy.send(1);
+            assigned.send(2);
+
+            PT_UNIT_ASSERT_EQUALS(calls.size(), 2u);
+            PT_UNIT_ASSERT_EQUALS(calls[0], 1001);
+            PT_UNIT_ASSERT_EQUALS(calls[1], 1002);
+        }
+
+    protected:
+        void disconnectSelf(int value)
+        {
+            _calls->push_back(value);
+
+            *_signal -= Pt::slot(*this, &SignalTest::disconnectSelf);
+            *_signal -= Pt::slot(*_other, &Receiver::onSignal);
+        }
+
+        void connectOther(int value)
+        {
+            _calls->push_back(value);
+
+            if(value == 1)
+                *_signal += Pt::slot(*_other, &Receiver::onSignal);
+        }
+
+        void sendAgain(int value)
+        {
+            _calls->push_back(value);
+
+            if(value > 0)
+            {
+                *_signal -= Pt::slot(*_other, &Receiver::onSignal);
+                _signal->send(value - 1);
+            }
+        }
+
+        void deleteSignal(int value)
+        {
+            _calls->push_back(value);
+
+            delete _deleteSignal;
+            _deleteSignal = 0;
+        }
+
+    private:
+        Pt::Signal<int>* _signal;
+        std::vector<int>* _calls;
+        Receiver* _other;
+        Pt::Signal<int>* _deleteSignal;
+};
+
+Pt::Unit::RegisterTest<SignalTest> register_SignalTest;
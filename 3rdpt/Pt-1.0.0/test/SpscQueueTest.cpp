@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <Pt/Unit/Assertion.h>
+#include <Pt/Unit/TestSuite.h>
+#include <Pt/Unit/RegisterTest.h>
+#include <Pt/System/SpscQueue.h>
+#include <Pt/System/Thread.h>
+
+namespace {
+
+struct SpscProducer
+{
+    SpscProducer(Pt::System::SpscQueue<int>& queue, int count)
+    : queue(&queue)
+    , count(count)
+    {}
+
+    void run()
+    {
+        for(int n = 0; n < count; ++n)
+            queue->put(n);
+    }
+
+    Pt::System::SpscQueue<int>* queue;
+    int count;
+};
+
+}
+
+
+class SpscQueueTest : public Pt::Unit::TestSuite
+{
+    public:
+        SpscQueueTest()
+        : Pt::Unit::TestSuite("SpscQueueTest")
+        {
+            this->registerMethod("capacity", *this, &SpscQueueTest::capacity);
+            this->registerMethod("fullAndEmpty", *this, &SpscQueueTest::fullAndEmpty);
+            this->registerMethod("wrapAround", *this, &SpscQueueTest::wrapAround);
+            this->registerMethod("blockingHandoff", *this, &SpscQueueTest::blockingHandoff);
+        }
+
+        void capacity()
+        {
+            Pt::System::SpscQueue<int> queue(5);
+            PT_UNIT_ASSERT_EQUALS(queue.capacity(), 8u);
+            PT_UNIT_ASSERT( queue.empty() );
+        }
+
+        void fullAndEmpty()
+        {
+            Pt::System::SpscQueue<int> queue(4);
+
+            int value = 0;
+            PT_UNIT_ASSERT( ! queue.tryGet(value) );
+
+            for(int n = 0; n < 4; ++n)
+                PT_UNIT_ASSERT( queue.tryPut(n) );
+
+            PT_UNIT_ASSERT( ! queue.tryPut(4) );
+            PT_UNIT_ASSERT_EQUALS(queue.size(), 4u);
+
+            for(int n = 0; n < 4; ++n)
+            {
+                PT_UNIT_ASSERT( queue.tryGet(value) );
+                PT_UNIT_ASSERT_EQUALS(value, n);
+            }
+
+            PT_UNIT_ASSERT( ! queue.tryGet(value) );
+            PT_UNIT_ASSERT( queue.empty() );
+        }
+
+        void wrapAround()
+        {
+            Pt::System::SpscQueue<int> queue(4);
+
+            // the indices run many times around the ring
+            int next = 0;
+            for(int n = 0; n < 1000; ++n)
+            {
+                PT_UNIT_ASSERT( queue.tryPut(2 * n) );
+                PT_UNIT_ASSERT( queue.tryPut(2 * n + 1) );
+
+                int value = -1;
+                PT_UNIT_ASSERT( queue.tryGet(value) );
+                PT_UNIT_ASSERT_EQUALS(value, next++);
+                PT_UNIT_ASSERT( queue.tryGet(value) );
+                PT_UNIT_ASSERT_EQUALS(value, next++);
+            }
+
+            PT_UNIT_ASSERT( queue.empty() );
+        }
+
+        void blockingHandoff()
+        {
+            const int count = 100000;
+
+            // a small ring makes both sides block
+            Pt::System::SpscQueue<int> queue(16);
+            SpscProducer producer(queue, count);
+
+            Pt::System::AttachedThread thread( Pt::callable(producer, &SpscProducer::run) );
+            thread.start();
+
+            bool ordered = true;
+            for(int n = 0; n < count; ++n)
+            {
+                if(queue.get() != n)
+                    ordered = false;
+            }
+
+            thread.join();
+
+            PT_UNIT_ASSERT(ordered);
+            PT_UNIT_ASSERT( queue.empty() );
+        }
+};
+
+Pt::Unit::RegisterTest<SpscQueueTest> register_SpscQueueTest;
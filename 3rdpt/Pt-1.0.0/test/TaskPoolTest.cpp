@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <Pt/Unit/Assertion.h>
+#include <Pt/Unit/TestSuite.h>
+#include <Pt/Unit/RegisterTest.h>
+#include <Pt/System/TaskPool.h>
+#include <Pt/System/MainLoop.h>
+#include <Pt/System/Timer.h>
+#include <Pt/Atomicity.h>
+#include <Pt/Event.h>
+#include <Pt/Types.h>
+#include <vector>
+#include <typeinfo>
+
+namespace {
+
+struct FinishedEvent : public Pt::BasicEvent<FinishedEvent>
+{
+};
+
+
+struct Visit
+{
+    explicit Visit(std::vector<int>& hits)
+    : hits(&hits)
+    {}
+
+    void operator()(std::size_t n)
+    { ++(*hits)[n]; }
+
+    std::vector<int>* hits;
+};
+
+
+struct Identity
+{
+    Pt::uint64_t operator()(std::size_t n) const
+    { return n; }
+};
+
+
+struct Sum
+{
+    Pt::uint64_t operator()(Pt::uint64_t a, Pt::uint64_t b) const
+    { return a + b; }
+};
+
+
+struct IsBelow
+{
+    explicit IsBelow(std::size_t limit)
+    : limit(limit)
+    {}
+
+    bool operator()(std::size_t n) const
+    { return n < limit; }
+
+    std::size_t limit;
+};
+
+
+struct And
+{
+    bool operator()(bool a, bool b) const
+    { return a && b; }
+};
+
+
+// adds more tasks to its group, until the depth is reached
+struct Spawner
+{
+    Spawner(Pt::System::TaskGroup& group, Pt::atomic_t& count, int depth)
+    : group(&group)
+    , count(&count)
+    , depth(depth)
+    {}
+
+    void run()
+    {
+        Pt::atomicIncrement(*count);
+
+        if(depth == 0)
+            return;
+
+        for(int n = 0; n < 2; ++n)
+        {
+            Spawner* child = new Spawner(*group, *count, depth - 1);
+            children.push_back(child);
+            group->run( Pt::callable(*child, &Spawner::run) );
+        }
+    }
+
+    ~Spawner()
+    {
+        for(std::size_t n = 0; n < children.size(); ++n)
+            delete children[n];
+    }
+
+    Pt::System::TaskGroup* group;
+    Pt::atomic_t* count;
+    int depth;
+    std::vector<Spawner*> children;
+};
+
+}
+
+
+class TaskPoolTest : public Pt::Unit::TestSuite
+{
+    public:
+        TaskPoolTest()
+        : Pt::Unit::TestSuite("TaskPoolTest")
+        , _loop(0)
+        , _finished(false)
+        {
+            this->registerMethod("parallelFor", *this, &TaskPoolTest::parallelFor);
+            this->registerMethod("parallelReduce", *this, &TaskPoolTest::parallelReduce);
+            this->registerMethod("parallelReduceBool", *this, &TaskPoolTest::parallelReduceBool);
+            this->registerMethod("nestedTasks", *this, &TaskPoolTest::nestedTasks);
+            this->registerMethod("commitWhenFinished", *this, &TaskPoolTest::commitWhenFinished);
+        }
+
+        void parallelFor()
+        {
+            Pt::System::TaskPool pool(4);
+
+            std::vector<int> hits(10000, 0);
+            Pt::System::parallelFor(pool, 0, hits.size(), Visit(hits));
+
+            for(std::size_t n = 0; n < hits.size(); ++n)
+                PT_UNIT_ASSERT_EQUALS(hits[n], 1);
+
+            // a single index and an empty range
+            std::vector<int> one(1, 0);
+            Pt::System::parallelFor(pool, 0, 1, Visit(one));
+            Pt::System::parallelFor(pool, 1, 1, Visit(one));
+            PT_UNIT_ASSERT_EQUALS(one[0], 1);
+        }
+
+        void parallelReduce()
+        {
+            Pt::System::TaskPool pool(4);
+
+            const std::size_t count = 100000;
+            Pt::uint64_t sum = Pt::System::parallelReduce(pool, 0, count, Pt::uint64_t(0), Identity(), Sum());
+            PT_UNIT_ASSERT(sum == Pt::uint64_t(count) * (count - 1) / 2);
+
+            // the grain does not divide the range
+            sum = Pt::System::parallelReduce(pool, 0, 1001, Pt::uint64_t(0), Identity(), Sum(), 7);
+            PT_UNIT_ASSERT(sum == Pt::uint64_t(1001) * 1000 / 2);
+
+            sum = Pt::System::parallelReduce(pool, 5, 5, Pt::uint64_t(42), Identity(), Sum());
+            PT_UNIT_ASSERT(sum == 42);
+        }
+
+        void parallelReduceBool()
+        {
+            Pt::System::TaskPool pool(4);
+
+            bool all = Pt::System::parallelReduce(pool, 0, 10000, true, IsBelow(10000), And());
+            PT_UNIT_ASSERT(all);
+
+            all = Pt::System::parallelReduce(pool, 0, 10000, true, IsBelow(9999), And());
+            PT_UNIT_ASSERT( ! all );
+        }
+
+        void nestedTasks()
+        {
+            Pt::System::TaskPool pool(4);
+            Pt::atomic_t count(0);
+
+            {
+                Pt::System::TaskGroup group(pool);
+                Spawner root(group, count, 8);
+                group.run( Pt::callable(root, &Spawner::run) );
+                group.wait();
+
+                PT_UNIT_ASSERT( group.isFinished() );
+            }
+
+            // a full binary tree of depth 8
+            PT_UNIT_ASSERT_EQUALS(Pt::atomicGet(count), 511);
+        }
+
+        void commitWhenFinished()
+        {
+            Pt::System::TaskPool pool(2);
+            Pt::System::MainLoop loop;
+            _loop = &loop;
+            _finished = false;
+
+            loop.eventReceived() += Pt::slot(*this, &TaskPoolTest::onEvent);
+
+            Pt::System::Timer guard;
+            guard.timeout() += Pt::slot(*this, &TaskPoolTest::onTimeout);
+            guard.setActive(loop);
+            guard.start(5000);
+
+            Pt::System::TaskGroup group(pool);
+            for(std::size_t n = 0; n < 1000; ++n)
+                group.run( Pt::callable(*this, &TaskPoolTest::touch) );
+
+            group.commitWhenFinished( loop, FinishedEvent() );
+            loop.run();
+
+            PT_UNIT_ASSERT(_finished);
+            PT_UNIT_ASSERT( group.isFinished() );
+        }
+
+    private:
+        void touch()
+        { }
+
+        void onEvent(const Pt::Event& ev)
+        {
+            if( ev.typeInfo() == typeid(FinishedEvent) )
+            {
+                _finished = true;
+                _loop->exit();
+            }
+        }
+
+        void onTimeout()
+        {
+            _loop->exit();
+        }
+
+    private:
+        Pt::System::MainLoop* _loop;
+        bool _finished;
+};
+
+Pt::Unit::RegisterTest<TaskPoolTest> register_TaskPoolTest;
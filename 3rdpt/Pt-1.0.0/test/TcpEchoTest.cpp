@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <Pt/Unit/Assertion.h>
+#include <Pt/Unit/TestSuite.h>
+#include <Pt/Unit/RegisterTest.h>
+#include <Pt/Net/TcpServer.h>
+#include <Pt/Net/TcpSocket.h>
+#include <Pt/Net/Endpoint.h>
+#include <Pt/System/MainLoop.h>
+#include <Pt/System/Timer.h>
+#include <string>
+#include <vector>
+
+class TcpEchoTest : public Pt::Unit::TestSuite
+{
+    public:
+        TcpEchoTest()
+        : Pt::Unit::TestSuite("TcpEchoTest")
+        , _loop(0)
+        , _peer(0)
+        , _client(0)
+        , _timedOut(false)
+        {
+            this->registerMethod("echo", *this, &TcpEchoTest::echo);
+            this->registerMethod("echoEdgeTriggered", *this, &TcpEchoTest::echoEdgeTriggered);
+            this->registerMethod("echoIoUring", *this, &TcpEchoTest::echoIoUring);
+        }
+
+        void echo()
+        {
+            Pt::System::MainLoopOptions opts;
+            runEcho(opts, 27101);
+        }
+
+        void echoEdgeTriggered()
+        {
+            Pt::System::MainLoopOptions opts;
+            opts.setEdgeTriggered();
+            runEcho(opts, 27102);
+        }
+
+        void echoIoUring()
+        {
+            Pt::System::MainLoopOptions opts;
+            opts.setIoUring();
+            runEcho(opts, 27103);
+        }
+
+    private:
+        static const std::size_t Rounds = 50;
+        static const std::size_t MessageSize = 256 * 1024;
+
+        void runEcho(const Pt::System::MainLoopOptions& opts, unsigned short port)
+        {
+            Pt::System::MainLoop loop(opts);
+            _loop = &loop;
+
+            _message.resize(MessageSize);
+            for(std::size_t n = 0; n < _message.size(); ++n)
+                _message[n] = static_cast<char>(n * 31 + n / 251);
+
+            _reply.assign(MessageSize, 0);
+            _peerBuffer.resize(16 * 1024);
+            _rounds = 0;
+            _failed = false;
+
+            Pt::System::Timer guard;
+            guard.timeout() += Pt::slot(*this, &TcpEchoTest::onTimeout);
+            guard.setActive(loop);
+            guard.start(10000);
+
+            Pt::Net::Endpoint ep = Pt::Net::Endpoint::ip4Loopback(port);
+
+            Pt::Net::TcpServer server(loop);
+            server.listen(ep);
+            server.connectionPending() += Pt::slot(*this, &TcpEchoTest::onPending);
+            server.beginAccept();
+
+            Pt::Net::TcpSocket peer(loop);
+            peer.inputReady() += Pt::slot(*this, &TcpEchoTest::onPeerInput);
+            peer.outputReady() += Pt::slot(*this, &TcpEchoTest::onPeerOutput);
+            _peer = &peer;
+
+            Pt::Net::TcpSocket client(loop);
+            client.connected() += Pt::slot(*this, &TcpEchoTest::onConnected);
+            client.inputReady() += Pt::slot(*this, &TcpEchoTest::onClientInput);
+            client.outputReady() += Pt::slot(*this, &TcpEchoTest::onClientOutput);
+            client.beginConnect(ep);
+            _client = &client;
+
+            _timedOut = false;
+            loop.run();
+
+            client.close();
+            peer.close();
+            server.close();
+
+            PT_UNIT_ASSERT( ! _timedOut );
+            PT_UNIT_ASSERT( ! _failed );
+            PT_UNIT_ASSERT(_rounds == Rounds);
+        }
+
+        void onPending(Pt::Net::TcpServer& server)
+        {
+            _peer->accept(server);
+            _peer->beginRead(&_peerBuffer[0], _peerBuffer.size());
+        }
+
+        void onPeerInput(Pt::System::IODevice& dev)
+        {
+            std::size_t n = dev.endRead();
+            if(dev.isEof())
+                return;
+
+            _peerPending = n;
+            _peerWritten = 0;
+            dev.beginWrite(&_peerBuffer[0], n);
+        }
+
+        void onPeerOutput(Pt::System::IODevice& dev)
+        {
+            _peerWritten += dev.endWrite();
+            if(_peerWritten < _peerPending)
+            {
+                dev.beginWrite(&_peerBuffer[_peerWritten], _peerPending - _peerWritten);
+                return;
+            }
+
+            dev.beginRead(&_peerBuffer[0], _peerBuffer.size());
+        }
+
+        void onConnected(Pt::Net::TcpSocket& socket)
+        {
+            socket.endConnect();
+            beginRound();
+        }
+
+        void beginRound()
+        {
+            _written = 0;
+            _received = 0;
+            _client->beginWrite(&_message[0], _message.size());
+        }
+
+        void onClientOutput(Pt::System::IODevice& dev)
+        {
+            _written += dev.endWrite();
+            if(_written < _message.size())
+            {
+                dev.beginWrite(&_message[_written], _message.size() - _written);
+                return;
+            }
+
+            dev.beginRead(&_reply[0], _reply.size());
+        }
+
+        void onClientInput(Pt::System::IODevice& dev)
+        {
+            _received += dev.endRead();
+            if(dev.isEof())
+            {
+                _failed = true;
+                _loop->exit();
+                return;
+            }
+
+            if(_received < _reply.size())
+            {
+                dev.beginRead(&_reply[_received], _reply.size() - _received);
+                return;
+            }
+
+            if(_reply != _message)
+            {
+                _failed = true;
+                _loop->exit();
+                return;
+            }
+
+            if(++_rounds == Rounds)
+            {
+                _loop->exit();
+                return;
+            }
+
+            beginRound();
+        }
+
+        void onTimeout()
+        {
+            _timedOut = true;
+            _loop->exit();
+        }
+
+    private:
+        Pt::System::MainLoop* _loop;
+        Pt::Net::TcpSocket* _peer;
+        Pt::Net::TcpSocket* _client;
+        std::vector<char> _message;
+        std::vector<char> _reply;
+        std::vector<char> _peerBuffer;
+        std::size_t _peerPending;
+        std::size_t _peerWritten;
+        std::size_t _written;
+        std::size_t _received;
+        std::size_t _rounds;
+        bool _failed;
+        bool _timedOut;
+};
+
+Pt::Unit::RegisterTest<TcpEchoTest> register_TcpEchoTest;
@@ -0,0 +1,283 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <Pt/Unit/Assertion.h>
+#include <Pt/Unit/TestSuite.h>
+#include <Pt/Unit/RegisterTest.h>
+#include <Pt/Net/TcpServer.h>
+#include <Pt/Net/TcpSocket.h>
+#include <Pt/Net/Endpoint.h>
+#include <Pt/Net/AddressInUse.h>
+#include <Pt/System/MainLoop.h>
+#include <Pt/System/Timer.h>
+#include <Pt/System/IOError.h>
+#include <vector>
+
+class TcpServerTest : public Pt::Unit::TestSuite
+{
+    public:
+        TcpServerTest()
+        : Pt::Unit::TestSuite("TcpServerTest")
+        , _loop(0)
+        , _limit(0)
+        , _timedOut(false)
+        {
+            this->registerMethod("localEndpoint", *this, &TcpServerTest::localEndpoint);
+            this->registerMethod("reuseBoundPort", *this, &TcpServerTest::reuseBoundPort);
+            this->registerMethod("acceptStorm", *this, &TcpServerTest::acceptStorm);
+            this->registerMethod("closeWithQueuedConnections", *this, &TcpServerTest::closeWithQueuedConnections);
+            this->registerMethod("copySocketOptions", *this, &TcpServerTest::copySocketOptions);
+        }
+
+        void tearDown()
+        {
+            for(std::size_t n = 0; n < _clients.size(); ++n)
+                delete _clients[n];
+
+            for(std::size_t n = 0; n < _accepted.size(); ++n)
+                delete _accepted[n];
+
+            _clients.clear();
+            _accepted.clear();
+        }
+
+        void localEndpoint()
+        {
+            Pt::Net::TcpServer server;
+
+            Pt::Net::Endpoint ep;
+            server.localEndpoint(ep);
+            PT_UNIT_ASSERT_EQUALS(ep.toString(), Pt::Net::Endpoint().toString());
+
+            server.listen( Pt::Net::Endpoint::ip4Loopback(0) );
+            server.localEndpoint(ep);
+
+            // the port chosen by the system accepts connections
+            Pt::Net::TcpSocket client(ep);
+            Pt::Net::TcpSocket peer(server);
+            PT_UNIT_ASSERT( client.isConnected() );
+        }
+
+        void reuseBoundPort()
+        {
+            Pt::Net::TcpServerOptions opts;
+            opts.setReusePort();
+
+            Pt::Net::TcpServer first;
+            first.listen(Pt::Net::Endpoint::ip4Loopback(0), opts);
+
+            Pt::Net::Endpoint ep;
+            first.localEndpoint(ep);
+
+            Pt::Net::TcpServer second;
+            second.listen(ep, opts);
+
+            Pt::Net::Endpoint secondEp;
+            second.localEndpoint(secondEp);
+            PT_UNIT_ASSERT_EQUALS(secondEp.toString(), ep.toString());
+
+            // the port is only shared, if requested
+            Pt::Net::TcpServer third;
+            PT_UNIT_ASSERT_THROW(third.listen(ep), Pt::Net::AddressInUse);
+        }
+
+        void acceptStorm()
+        {
+            Pt::System::MainLoop loop;
+            _loop = &loop;
+
+            Pt::System::Timer guard;
+            guard.timeout() += Pt::slot(*this, &TcpServerTest::onTimeout);
+            guard.setActive(loop);
+            guard.start(10000);
+
+            // fewer connections are accepted per wakeup than are pending
+            Pt::Net::TcpServerOptions opts;
+            opts.setAcceptBatch(8);
+
+            Pt::Net::TcpServer server(loop);
+            server.listen(Pt::Net::Endpoint::ip4Loopback(0), opts);
+            server.connectionPending() += Pt::slot(*this, &TcpServerTest::onConnectionPending);
+
+            Pt::Net::Endpoint ep;
+            server.localEndpoint(ep);
+
+            const std::size_t count = 100;
+            for(std::size_t n = 0; n < count; ++n)
+                _clients.push_back( new Pt::Net::TcpSocket(ep) );
+
+            _limit = count;
+            _timedOut = false;
+            server.beginAccept();
+            loop.run();
+
+            PT_UNIT_ASSERT( ! _timedOut );
+            PT_UNIT_ASSERT_EQUALS(_accepted.size(), count);
+
+            // every connection was accepted exactly once
+            for(std::size_t n = 0; n < count; ++n)
+            {
+                char ch = static_cast<char>(n);
+                _clients[n]->write(&ch, 1);
+            }
+
+            std::vector<bool> seen(count, false);
+            for(std::size_t n = 0; n < count; ++n)
+            {
+                char ch = 0;
+                PT_UNIT_ASSERT_EQUALS(_accepted[n]->read(&ch, 1), 1u);
+
+                std::size_t index = static_cast<unsigned char>(ch);
+                PT_UNIT_ASSERT( ! seen[index] );
+                seen[index] = true;
+            }
+        }
+
+        void closeWithQueuedConnections()
+        {
+            Pt::System::MainLoop loop;
+            _loop = &loop;
+
+            Pt::System::Timer guard;
+            guard.timeout() += Pt::slot(*this, &TcpServerTest::onTimeout);
+            guard.setActive(loop);
+            guard.start(10000);
+
+            Pt::Net::TcpServer server(loop);
+            server.listen( Pt::Net::Endpoint::ip4Loopback(0) );
+            server.connectionPending() += Pt::slot(*this, &TcpServerTest::onConnectionPending);
+
+            Pt::Net::Endpoint ep;
+            server.localEndpoint(ep);
+
+            const std::size_t count = 4;
+            for(std::size_t n = 0; n < count; ++n)
+            {
+                _clients.push_back( new Pt::Net::TcpSocket(ep) );
+                _clients.back()->setTimeout(5000);
+            }
+
+            // all connections are queued by the first accept
+            _limit = 1;
+            _timedOut = false;
+            server.beginAccept();
+            loop.run();
+
+            PT_UNIT_ASSERT( ! _timedOut );
+            PT_UNIT_ASSERT_EQUALS(_accepted.size(), 1u);
+
+            // the queued connections are closed with the server, the
+            // accepted one stays open
+            server.close();
+            _accepted[0]->write("x", 1);
+
+            std::size_t open = 0;
+            std::size_t closed = 0;
+            for(std::size_t n = 0; n < count; ++n)
+            {
+                char ch = 0;
+                try
+                {
+                    if(_clients[n]->read(&ch, 1) == 0)
+                        ++closed;
+                    else
+                        ++open;
+                }
+                catch(const Pt::System::IOError&)
+                {
+                    ++closed;
+                }
+            }
+
+            PT_UNIT_ASSERT_EQUALS(open, 1u);
+            PT_UNIT_ASSERT_EQUALS(closed, count - 1);
+        }
+
+        void copySocketOptions()
+        {
+            Pt::Net::TcpSocketOptions opts;
+            opts.setNoDelay();
+            opts.setSendBufferSize(65536);
+
+            Pt::Net::TcpSocketOptions copy(opts);
+            PT_UNIT_ASSERT( copy.isNoDelay() );
+            PT_UNIT_ASSERT_EQUALS(copy.sendBufferSize(), 65536);
+
+            Pt::Net::TcpSocketOptions assigned;
+            assigned = opts;
+            PT_UNIT_ASSERT( assigned.isNoDelay() );
+            PT_UNIT_ASSERT_EQUALS(assigned.sendBufferSize(), 65536);
+
+            // the options are applied to connected and accepted sockets
+            Pt::Net::TcpServer server;
+            server.listen( Pt::Net::Endpoint::ip4Loopback(0) );
+
+            Pt::Net::Endpoint ep;
+            server.localEndpoint(ep);
+
+            Pt::Net::TcpSocket client;
+            client.connect(ep, opts);
+
+            Pt::Net::TcpSocket peer;
+            peer.accept(server, opts);
+
+            client.write("x", 1);
+
+            char ch = 0;
+            PT_UNIT_ASSERT_EQUALS(peer.read(&ch, 1), 1u);
+            PT_UNIT_ASSERT_EQUALS(ch, 'x');
+        }
+
+    private:
+        void onConnectionPending(Pt::Net::TcpServer& server)
+        {
+            Pt::Net::TcpSocket* socket = new Pt::Net::TcpSocket();
+            _accepted.push_back(socket);
+            socket->accept(server);
+
+            if(_accepted.size() < _limit)
+                server.beginAccept();
+            else
+                _loop->exit();
+        }
+
+        void onTimeout()
+        {
+            _timedOut = true;
+            _loop->exit();
+        }
+
+    private:
+        Pt::System::MainLoop* _loop;
+        std::vector<Pt::Net::TcpSocket*> _clients;
+        std::vector<Pt::Net::TcpSocket*> _accepted;
+        std::size_t _limit;
+        bool _timedOut;
+};
+
+Pt::Unit::RegisterTest<TcpServerTest> register_TcpServerTest;
@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <Pt/Unit/Assertion.h>
+#include <Pt/Unit/TestSuite.h>
+#include <Pt/Unit/RegisterTest.h>
+#include <Pt/Net/TcpServer.h>
+#include <Pt/Net/TcpSocket.h>
+#include <Pt/Net/Endpoint.h>
+#include <string>
+
+class TcpSocketOptionsTest : public Pt::Unit::TestSuite
+{
+    public:
+        TcpSocketOptionsTest()
+        : Pt::Unit::TestSuite("TcpSocketOptionsTest")
+        {
+            this->registerMethod("defaultOptions", *this, &TcpSocketOptionsTest::defaultOptions);
+            this->registerMethod("connectOptions", *this, &TcpSocketOptionsTest::connectOptions);
+            this->registerMethod("acceptOptions", *this, &TcpSocketOptionsTest::acceptOptions);
+            this->registerMethod("setNoDelay", *this, &TcpSocketOptionsTest::setNoDelay);
+            this->registerMethod("tcpInfo", *this, &TcpSocketOptionsTest::tcpInfo);
+        }
+
+        void defaultOptions()
+        {
+            Pt::Net::TcpServer server;
+            server.listen( Pt::Net::Endpoint::ip4Loopback(0) );
+
+            Pt::Net::Endpoint ep;
+            server.localEndpoint(ep);
+
+            Pt::Net::TcpSocket client(ep);
+            Pt::Net::TcpSocket peer(server);
+
+            Pt::Net::TcpSocketOptions opts;
+            client.options(opts);
+
+            PT_UNIT_ASSERT( ! opts.isNoDelay() );
+            PT_UNIT_ASSERT( ! opts.isKeepAlive() );
+            PT_UNIT_ASSERT(opts.sendBufferSize() > 0);
+            PT_UNIT_ASSERT(opts.receiveBufferSize() > 0);
+        }
+
+        void connectOptions()
+        {
+            Pt::Net::TcpServer server;
+            server.listen( Pt::Net::Endpoint::ip4Loopback(0) );
+
+            Pt::Net::Endpoint ep;
+            server.localEndpoint(ep);
+
+            Pt::Net::TcpSocketOptions opts;
+            opts.setNoDelay();
+            opts.setKeepAlive(30, 5, 3);
+
+            Pt::Net::TcpSocket client;
+            client.connect(ep, opts);
+            Pt::Net::TcpSocket peer(server);
+
+            Pt::Net::TcpSocketOptions read;
+            client.options(read);
+
+            PT_UNIT_ASSERT( read.isNoDelay() );
+            PT_UNIT_ASSERT( read.isKeepAlive() );
+
+            // windows can not read back the keepalive times
+#if ! defined(_WIN32)
+            PT_UNIT_ASSERT_EQUALS(read.keepAliveIdle(), 30);
+            PT_UNIT_ASSERT_EQUALS(read.keepAliveInterval(), 5);
+            PT_UNIT_ASSERT_EQUALS(read.keepAliveCount(), 3);
+#endif
+
+            // the accepted socket was not given any options
+            peer.options(read);
+            PT_UNIT_ASSERT( ! read.isNoDelay() );
+            PT_UNIT_ASSERT( ! read.isKeepAlive() );
+        }
+
+        void acceptOptions()
+        {
+            Pt::Net::TcpServer server;
+            server.listen( Pt::Net::Endpoint::ip4Loopback(0) );
+
+            Pt::Net::Endpoint ep;
+            server.localEndpoint(ep);
+
+            Pt::Net::TcpSocketOptions opts;
+            opts.setNoDelay();
+            opts.setKeepAlive(60);
+
+            Pt::Net::TcpSocket client(ep);
+            Pt::Net::TcpSocket peer;
+            peer.accept(server, opts);
+
+            Pt::Net::TcpSocketOptions read;
+            peer.options(read);
+
+            PT_UNIT_ASSERT( read.isNoDelay() );
+            PT_UNIT_ASSERT( read.isKeepAlive() );
+
+#if ! defined(_WIN32)
+            PT_UNIT_ASSERT_EQUALS(read.keepAliveIdle(), 60);
+
+            // the interval and count keep the defaults of the system
+            PT_UNIT_ASSERT(read.keepAliveInterval() > 0);
+            PT_UNIT_ASSERT(read.keepAliveCount() > 0);
+#endif
+        }
+
+        void setNoDelay()
+        {
+            Pt::Net::TcpServer server;
+            server.listen( Pt::Net::Endpoint::ip4Loopback(0) );
+
+            Pt::Net::Endpoint ep;
+            server.localEndpoint(ep);
+
+            Pt::Net::TcpSocket client(ep);
+            Pt::Net::TcpSocket peer(server);
+
+            Pt::Net::TcpSocketOptions read;
+
+            client.setNoDelay(true);
+            client.options(read);
+            PT_UNIT_ASSERT( read.isNoDelay() );
+
+            client.setNoDelay(false);
+            client.options(read);
+            PT_UNIT_ASSERT( ! read.isNoDelay() );
+        }
+
+        void tcpInfo()
+        {
+            Pt::Net::TcpSocket unconnected;
+            Pt::Net::TcpInfo info;
+            PT_UNIT_ASSERT( ! unconnected.tcpInfo(info) );
+
+            Pt::Net::TcpServer server;
+            server.listen( Pt::Net::Endpoint::ip4Loopback(0) );
+
+            Pt::Net::Endpoint ep;
+            server.localEndpoint(ep);
+
+            Pt::Net::TcpSocketOptions opts;
+            opts.setNoDelay();
+
+            Pt::Net::TcpSocket client;
+            client.connect(ep, opts);
+            Pt::Net::TcpSocket peer(server);
+            peer.setTimeout(2000);
+
+            // exchange some data, so the connection has round trip samples
+            const std::string data(64 * 1024, 'x');
+            char buffer[4096];
+            for(int round = 0; round < 4; ++round)
+            {
+                std::size_t written = 0;
+                while(written < data.size())
+                    written += client.write(data.data() + written, data.size() - written);
+
+                std::size_t received = 0;
+                while(received < data.size())
+                {
+                    std::size_t n = peer.read(buffer, sizeof(buffer));
+                    PT_UNIT_ASSERT(n > 0);
+                    received += n;
+                }
+            }
+
+#if defined(__linux__) || defined(_WIN32)
+            PT_UNIT_ASSERT( client.tcpInfo(info) );
+
+            // a loopback connection has a large segment size, a short
+            // round trip time and no losses
+            PT_UNIT_ASSERT(info.mss >= 536);
+            PT_UNIT_ASSERT(info.mss <= 65536);
+            PT_UNIT_ASSERT(info.rtt < 1000000);
+            PT_UNIT_ASSERT(info.congestionWindow > 0);
+            PT_UNIT_ASSERT_EQUALS(info.lost, 0u);
+#endif
+        }
+};
+
+Pt::Unit::RegisterTest<TcpSocketOptionsTest> register_TcpSocketOptionsTest;
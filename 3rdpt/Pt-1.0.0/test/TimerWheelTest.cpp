@@ -0,0 +1,311 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <Pt/Unit/Assertion.h>
+#include <Pt/Unit/TestSuite.h>
+#include <Pt/Unit/RegisterTest.h>
+#include <Pt/System/EventLoop.h>
+#include <Pt/System/Clock.h>
+#include <Pt/System/Timer.h>
+#include <Pt/Connectable.h>
+#include <Pt/Timespan.h>
+#include <vector>
+#include <cstddef>
+
+namespace {
+
+struct Expiry
+{
+    Expiry(int i, const Pt::Timespan& d, const Pt::Timespan& t)
+    : id(i), deadline(d), at(t)
+    {}
+
+    int id;
+    Pt::Timespan deadline;
+    Pt::Timespan at;
+};
+
+// One-shot timer driven by a TimerQueue without an event loop. The
+// loop usually adds and removes timers, so this is done here instead.
+class TimerProbe : public Pt::Connectable
+{
+    public:
+        TimerProbe(int id, Pt::System::TimerQueue& queue,
+                   std::vector<Expiry>& log, const Pt::Timespan& now)
+        : _id(id)
+        , _queue(&queue)
+        , _log(&log)
+        , _now(&now)
+        , _other(0)
+        {
+            _timer.timeout() += Pt::slot(*this, &TimerProbe::onTimeout);
+        }
+
+        ~TimerProbe()
+        {
+            _queue->removeTimer(_timer);
+        }
+
+        void start(std::size_t interval)
+        {
+            _queue->removeTimer(_timer);
+            _timer.start(interval);
+            _deadline = _timer.finished();
+            _queue->addTimer(_timer);
+        }
+
+        void stop()
+        {
+            _timer.stop();
+            _queue->removeTimer(_timer);
+        }
+
+        void stopOnTimeout(TimerProbe& other)
+        { _other = &other; }
+
+        const Pt::Timespan& deadline() const
+        { return _deadline; }
+
+    private:
+        void onTimeout()
+        {
+            _log->push_back( Expiry(_id, _deadline, *_now) );
+            this->stop();
+
+            if(_other)
+                _other->stop();
+        }
+
+    private:
+        int _id;
+        Pt::System::Timer _timer;
+        Pt::System::TimerQueue* _queue;
+        std::vector<Expiry>* _log;
+        const Pt::Timespan* _now;
+        TimerProbe* _other;
+        Pt::Timespan _deadline;
+};
+
+// intervals around the level boundaries of the TimerWheel
+const std::size_t intervals[] = { 1, 5, 255, 256, 257, 300, 1000, 4096,
+                                  16383, 16384, 16385, 16400, 20000 };
+
+const std::size_t intervalCount = sizeof(intervals) / sizeof(intervals[0]);
+
+}
+
+class TimerWheelTest : public Pt::Unit::TestSuite
+{
+    public:
+        TimerWheelTest()
+        : Pt::Unit::TestSuite("TimerWheelTest")
+        {
+            this->registerMethod("cascade", *this, &TimerWheelTest::cascade);
+            this->registerMethod("stopUpperLevel", *this, &TimerWheelTest::stopUpperLevel);
+            this->registerMethod("restartUpperLevel", *this, &TimerWheelTest::restartUpperLevel);
+            this->registerMethod("stopFromHandler", *this, &TimerWheelTest::stopFromHandler);
+            this->registerMethod("sameTickOrder", *this, &TimerWheelTest::sameTickOrder);
+        }
+
+        void cascade()
+        {
+            Pt::System::SortedTimerQueue sorted;
+            runCascade(sorted);
+
+            Pt::System::TimerWheel wheel;
+            runCascade(wheel);
+        }
+
+        void stopUpperLevel()
+        {
+            Pt::Timespan now = Pt::System::Clock::getMonotonicTicks();
+            std::vector<Expiry> log;
+
+            Pt::System::TimerWheel wheel;
+            TimerProbe early(1, wheel, log, now);
+            TimerProbe stopped(2, wheel, log, now);
+            TimerProbe late(3, wheel, log, now);
+
+            early.start(100);
+            stopped.start(1000);
+            late.start(20000);
+            stopped.stop();
+
+            const Pt::Timespan end = now + Pt::Timespan(21000 * 1000);
+            advance(wheel, now, end);
+
+            PT_UNIT_ASSERT_EQUALS(log.size(), std::size_t(2));
+            PT_UNIT_ASSERT_EQUALS(log[0].id, 1);
+            PT_UNIT_ASSERT_EQUALS(log[1].id, 3);
+            assertOnTime(log);
+        }
+
+        void restartUpperLevel()
+        {
+            Pt::Timespan now = Pt::System::Clock::getMonotonicTicks();
+            std::vector<Expiry> log;
+
+            Pt::System::TimerWheel wheel;
+            TimerProbe shortened(1, wheel, log, now);
+            TimerProbe extended(2, wheel, log, now);
+
+            shortened.start(20000);
+            extended.start(600);
+
+            // move past one cascade of the first upper level
+            advance(wheel, now, now + Pt::Timespan(300 * 1000));
+            PT_UNIT_ASSERT( log.empty() );
+
+            // timers start from the real clock, which is behind
+            shortened.start(300 + 50);
+            extended.start(300 + 17000);
+
+            advance(wheel, now, now + Pt::Timespan(18000 * 1000));
+
+            PT_UNIT_ASSERT_EQUALS(log.size(), std::size_t(2));
+            PT_UNIT_ASSERT_EQUALS(log[0].id, 1);
+            PT_UNIT_ASSERT_EQUALS(log[1].id, 2);
+            PT_UNIT_ASSERT(log[0].deadline == shortened.deadline());
+            PT_UNIT_ASSERT(log[1].deadline == extended.deadline());
+            assertOnTime(log);
+        }
+
+        void stopFromHandler()
+        {
+            Pt::Timespan now = Pt::System::Clock::getMonotonicTicks();
+            std::vector<Expiry> log;
+
+            Pt::System::TimerWheel wheel;
+            TimerProbe first(1, wheel, log, now);
+            TimerProbe upper(2, wheel, log, now);
+
+            first.stopOnTimeout(upper);
+            first.start(200);
+            upper.start(5000);
+
+            advance(wheel, now, now + Pt::Timespan(6000 * 1000));
+
+            PT_UNIT_ASSERT_EQUALS(log.size(), std::size_t(1));
+            PT_UNIT_ASSERT_EQUALS(log[0].id, 1);
+            assertOnTime(log);
+        }
+
+        void sameTickOrder()
+        {
+            Pt::System::SortedTimerQueue sorted;
+            runSameTick(sorted, 200);
+            runSameTick(sorted, 400);
+
+            // due in the root level and cascaded from the upper level
+            Pt::System::TimerWheel wheel;
+            runSameTick(wheel, 200);
+            runSameTick(wheel, 400);
+        }
+
+    private:
+        // advances the simulated time in steps of one millisecond
+        void advance(Pt::System::TimerQueue& queue, Pt::Timespan& now,
+                     const Pt::Timespan& end)
+        {
+            const Pt::Timespan step(1000);
+            while(now < end)
+            {
+                now += step;
+                queue.processTimers(now);
+            }
+        }
+
+        void assertOnTime(const std::vector<Expiry>& log)
+        {
+            const Pt::Timespan step(1000);
+            for(std::size_t n = 0; n < log.size(); ++n)
+            {
+                PT_UNIT_ASSERT(log[n].at >= log[n].deadline);
+                PT_UNIT_ASSERT(log[n].at - step < log[n].deadline);
+            }
+        }
+
+        void runCascade(Pt::System::TimerQueue& queue)
+        {
+            Pt::Timespan now = Pt::System::Clock::getMonotonicTicks();
+            std::vector<Expiry> log;
+
+            std::vector<TimerProbe*> probes;
+            for(std::size_t n = 0; n < intervalCount; ++n)
+            {
+                probes.push_back( new TimerProbe(static_cast<int>(n), queue, log, now) );
+                probes.back()->start(intervals[n]);
+            }
+
+            const Pt::Timespan end = now + Pt::Timespan(21000 * 1000);
+            advance(queue, now, end);
+
+            for(std::size_t n = 0; n < probes.size(); ++n)
+                delete probes[n];
+
+            PT_UNIT_ASSERT_EQUALS(log.size(), intervalCount);
+            for(std::size_t n = 0; n < log.size(); ++n)
+                PT_UNIT_ASSERT_EQUALS(log[n].id, static_cast<int>(n));
+
+            assertOnTime(log);
+        }
+
+        // timers due in the same tick fire in order of their expiry time
+        // like with the SortedTimerQueue, timers with equal expiry time
+        // may fire in any order
+        void runSameTick(Pt::System::TimerQueue& queue, std::size_t interval)
+        {
+            Pt::Timespan now = Pt::System::Clock::getMonotonicTicks();
+            std::vector<Expiry> log;
+
+            // timers started one after another usually share a tick,
+            // wait for the clock to move on so the expiry times differ
+            std::vector<TimerProbe*> probes;
+            for(int n = 0; n < 8; ++n)
+            {
+                const Pt::Timespan started = Pt::System::Clock::getMonotonicTicks();
+                while(Pt::System::Clock::getMonotonicTicks() == started)
+                    ;
+
+                probes.push_back( new TimerProbe(n, queue, log, now) );
+                probes.back()->start(interval);
+            }
+
+            // all timers expire within one step
+            now += Pt::Timespan( Pt::int64_t(interval + 100) * 1000 );
+            queue.processTimers(now);
+
+            for(std::size_t n = 0; n < probes.size(); ++n)
+                delete probes[n];
+
+            PT_UNIT_ASSERT_EQUALS(log.size(), std::size_t(8));
+            for(std::size_t n = 1; n < log.size(); ++n)
+                PT_UNIT_ASSERT(log[n - 1].deadline <= log[n].deadline);
+        }
+};
+
+Pt::Unit::RegisterTest<TimerWheelTest> register_TimerWheelTest;
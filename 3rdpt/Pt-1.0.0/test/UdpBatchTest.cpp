@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <Pt/Unit/Assertion.h>
+#include <Pt/Unit/TestSuite.h>
+#include <Pt/Unit/RegisterTest.h>
+#include <Pt/Net/UdpSocket.h>
+#include <Pt/Net/Endpoint.h>
+#include <Pt/System/Thread.h>
+#include <string>
+#include <vector>
+
+namespace {
+
+// receives until count datagrams arrived or no more data shows up
+std::size_t receiveAll(Pt::Net::UdpSocket& socket, Pt::Net::Datagram* dgrams, std::size_t count)
+{
+    std::size_t received = 0;
+    for(int retry = 0; received < count && retry < 100; ++retry)
+    {
+        std::size_t n = socket.receive(dgrams + received, count - received);
+        if(n == 0)
+            Pt::System::Thread::sleep(10);
+
+        received += n;
+    }
+
+    return received;
+}
+
+}
+
+
+class UdpBatchTest : public Pt::Unit::TestSuite
+{
+    public:
+        UdpBatchTest()
+        : Pt::Unit::TestSuite("UdpBatchTest")
+        {
+            this->registerMethod("sendAndReceive", *this, &UdpBatchTest::sendAndReceive);
+            this->registerMethod("segmentedSend", *this, &UdpBatchTest::segmentedSend);
+            this->registerMethod("truncatedDatagram", *this, &UdpBatchTest::truncatedDatagram);
+        }
+
+        void sendAndReceive()
+        {
+            Pt::Net::UdpSocket server;
+            server.bind( Pt::Net::Endpoint::ip4Loopback(0) );
+
+            Pt::Net::Endpoint ep;
+            server.localEndpoint(ep);
+
+            // bound to the loopback address, so it matches the source
+            Pt::Net::UdpSocket client;
+            client.bind( Pt::Net::Endpoint::ip4Loopback(0) );
+            client.setTarget(ep);
+
+            std::vector<std::string> payloads;
+            std::vector<Pt::Net::Datagram> out;
+            for(std::size_t n = 0; n < 10; ++n)
+                payloads.push_back( std::string(n * 100 + 1, static_cast<char>('a' + n)) );
+
+            for(std::size_t n = 0; n < payloads.size(); ++n)
+                out.push_back( Pt::Net::Datagram(&payloads[n][0], payloads[n].size()) );
+
+            PT_UNIT_ASSERT_EQUALS(client.send(&out[0], out.size()), out.size());
+
+            std::vector<std::string> buffers(out.size(), std::string(2000, '\0'));
+            std::vector<Pt::Net::Endpoint> sources(out.size());
+            std::vector<Pt::Net::Datagram> in;
+            for(std::size_t n = 0; n < buffers.size(); ++n)
+                in.push_back( Pt::Net::Datagram(&buffers[n][0], buffers[n].size(), &sources[n]) );
+
+            PT_UNIT_ASSERT_EQUALS(receiveAll(server, &in[0], in.size()), in.size());
+
+            Pt::Net::Endpoint local;
+            client.localEndpoint(local);
+
+            for(std::size_t n = 0; n < in.size(); ++n)
+            {
+                PT_UNIT_ASSERT( ! in[n].truncated );
+                PT_UNIT_ASSERT_EQUALS(in[n].received, payloads[n].size());
+                PT_UNIT_ASSERT(buffers[n].compare(0, in[n].received, payloads[n]) == 0);
+                PT_UNIT_ASSERT_EQUALS(sources[n].toString(), local.toString());
+            }
+        }
+
+        void segmentedSend()
+        {
+            Pt::Net::UdpSocket server;
+            server.bind( Pt::Net::Endpoint::ip4Loopback(0) );
+
+            Pt::Net::Endpoint ep;
+            server.localEndpoint(ep);
+
+            Pt::Net::UdpSocket client;
+            client.setTarget(ep);
+
+            // three datagrams of 100, 100 and 50 bytes
+            std::string data(250, '\0');
+            for(std::size_t n = 0; n < data.size(); ++n)
+                data[n] = static_cast<char>(n);
+
+            Pt::Net::Datagram out(&data[0], data.size());
+            out.segmentSize = 100;
+
+            PT_UNIT_ASSERT_EQUALS(client.send(&out, 1), 1u);
+
+            std::string buffers[3];
+            Pt::Net::Datagram in[3];
+            for(std::size_t n = 0; n < 3; ++n)
+            {
+                buffers[n].assign(200, '\0');
+                in[n] = Pt::Net::Datagram(&buffers[n][0], buffers[n].size());
+            }
+
+            PT_UNIT_ASSERT_EQUALS(receiveAll(server, in, 3), 3u);
+            PT_UNIT_ASSERT_EQUALS(in[0].received, 100u);
+            PT_UNIT_ASSERT_EQUALS(in[1].received, 100u);
+            PT_UNIT_ASSERT_EQUALS(in[2].received, 50u);
+
+            std::string received = buffers[0].substr(0, 100)
+                                 + buffers[1].substr(0, 100)
+                                 + buffers[2].substr(0, 50);
+            PT_UNIT_ASSERT(received == data);
+        }
+
+        void truncatedDatagram()
+        {
+            Pt::Net::UdpSocket server;
+            server.bind( Pt::Net::Endpoint::ip4Loopback(0) );
+
+            Pt::Net::Endpoint ep;
+            server.localEndpoint(ep);
+
+            Pt::Net::UdpSocket client;
+            client.setTarget(ep);
+
+            std::string large(100, 'x');
+            std::string small(10, 'y');
+
+            Pt::Net::Datagram out[2];
+            out[0] = Pt::Net::Datagram(&large[0], large.size());
+            out[1] = Pt::Net::Datagram(&small[0], small.size());
+            PT_UNIT_ASSERT_EQUALS(client.send(out, 2), 2u);
+
+            // the first datagram does not fit, the second one does
+            char buffers[2][20];
+            Pt::Net::Datagram in[2];
+            in[0] = Pt::Net::Datagram(buffers[0], sizeof(buffers[0]));
+            in[1] = Pt::Net::Datagram(buffers[1], sizeof(buffers[1]));
+
+            PT_UNIT_ASSERT_EQUALS(receiveAll(server, in, 2), 2u);
+
+            PT_UNIT_ASSERT(in[0].truncated);
+            PT_UNIT_ASSERT_EQUALS(in[0].received, 20u);
+            PT_UNIT_ASSERT(std::string(buffers[0], 20) == large.substr(0, 20));
+
+            PT_UNIT_ASSERT( ! in[1].truncated );
+            PT_UNIT_ASSERT_EQUALS(in[1].received, 10u);
+            PT_UNIT_ASSERT(std::string(buffers[1], 10) == small);
+        }
+};
+
+Pt::Unit::RegisterTest<UdpBatchTest> register_UdpBatchTest;
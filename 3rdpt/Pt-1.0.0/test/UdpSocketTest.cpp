@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <Pt/Unit/Assertion.h>
+#include <Pt/Unit/TestSuite.h>
+#include <Pt/Unit/RegisterTest.h>
+#include <Pt/Net/UdpSocket.h>
+#include <Pt/Net/Endpoint.h>
+#include <Pt/System/MainLoop.h>
+#include <Pt/System/Timer.h>
+#include <string>
+
+namespace {
+
+std::string receiveString(Pt::Net::UdpSocket& socket, Pt::Net::Endpoint& from)
+{
+    char buffer[256];
+    std::size_t n = socket.receiveFrom(buffer, sizeof(buffer), from);
+    return std::string(buffer, n);
+}
+
+}
+
+
+class UdpSocketTest : public Pt::Unit::TestSuite
+{
+    public:
+        UdpSocketTest()
+        : Pt::Unit::TestSuite("UdpSocketTest")
+        , _loop(0)
+        , _timedOut(false)
+        , _written(0)
+        {
+            this->registerMethod("sendToKeepsTarget", *this, &UdpSocketTest::sendToKeepsTarget);
+            this->registerMethod("answerReceivedFrom", *this, &UdpSocketTest::answerReceivedFrom);
+            this->registerMethod("beginSendTo", *this, &UdpSocketTest::beginSendTo);
+        }
+
+        void sendToKeepsTarget()
+        {
+            Pt::Net::UdpSocket server;
+            server.bind( Pt::Net::Endpoint::ip4Loopback(0) );
+
+            Pt::Net::Endpoint serverEp;
+            server.localEndpoint(serverEp);
+
+            Pt::Net::UdpSocket a;
+            a.bind( Pt::Net::Endpoint::ip4Loopback(0) );
+            a.setTimeout(2000);
+
+            Pt::Net::UdpSocket b;
+            b.bind( Pt::Net::Endpoint::ip4Loopback(0) );
+            b.setTimeout(2000);
+
+            Pt::Net::Endpoint aEp;
+            a.localEndpoint(aEp);
+
+            Pt::Net::Endpoint bEp;
+            b.localEndpoint(bEp);
+
+            server.setTarget(aEp);
+
+            PT_UNIT_ASSERT_EQUALS(server.sendTo(bEp, "to b", 4), 4u);
+            PT_UNIT_ASSERT_EQUALS(server.write("to a", 4), 4u);
+
+            Pt::Net::Endpoint from;
+            PT_UNIT_ASSERT_EQUALS(receiveString(b, from), std::string("to b"));
+            PT_UNIT_ASSERT_EQUALS(from.toString(), serverEp.toString());
+
+            PT_UNIT_ASSERT_EQUALS(receiveString(a, from), std::string("to a"));
+            PT_UNIT_ASSERT_EQUALS(from.toString(), serverEp.toString());
+        }
+
+        void answerReceivedFrom()
+        {
+            Pt::Net::UdpSocket server;
+            server.bind( Pt::Net::Endpoint::ip4Loopback(0) );
+            server.setTimeout(2000);
+
+            Pt::Net::Endpoint serverEp;
+            server.localEndpoint(serverEp);
+
+            Pt::Net::UdpSocket clients[3];
+            for(int n = 0; n < 3; ++n)
+            {
+                clients[n].bind( Pt::Net::Endpoint::ip4Loopback(0) );
+                clients[n].setTimeout(2000);
+
+                const std::string ping = "ping" + std::string(1, '0' + n);
+                PT_UNIT_ASSERT_EQUALS(clients[n].sendTo(serverEp, ping.data(), ping.size()), ping.size());
+            }
+
+            // the same endpoint is reused for all peers
+            Pt::Net::Endpoint peer;
+            for(int n = 0; n < 3; ++n)
+            {
+                std::string ping = receiveString(server, peer);
+                PT_UNIT_ASSERT_EQUALS(ping.size(), 5u);
+
+                const std::string pong = "pong" + ping.substr(4);
+                PT_UNIT_ASSERT_EQUALS(server.sendTo(peer, pong.data(), pong.size()), pong.size());
+            }
+
+            for(int n = 0; n < 3; ++n)
+            {
+                Pt::Net::Endpoint from;
+                const std::string pong = "pong" + std::string(1, '0' + n);
+                PT_UNIT_ASSERT_EQUALS(receiveString(clients[n], from), pong);
+                PT_UNIT_ASSERT_EQUALS(from.toString(), serverEp.toString());
+            }
+        }
+
+        void beginSendTo()
+        {
+            Pt::System::MainLoop loop;
+            _loop = &loop;
+
+            Pt::System::Timer guard;
+            guard.timeout() += Pt::slot(*this, &UdpSocketTest::onTimeout);
+            guard.setActive(loop);
+            guard.start(5000);
+
+            Pt::Net::UdpSocket server(loop);
+            server.bind( Pt::Net::Endpoint::ip4Loopback(0) );
+            server.outputReady() += Pt::slot(*this, &UdpSocketTest::onOutput);
+
+            Pt::Net::Endpoint serverEp;
+            server.localEndpoint(serverEp);
+
+            Pt::Net::UdpSocket a;
+            a.bind( Pt::Net::Endpoint::ip4Loopback(0) );
+            a.setTimeout(2000);
+
+            Pt::Net::UdpSocket b;
+            b.bind( Pt::Net::Endpoint::ip4Loopback(0) );
+            b.setTimeout(2000);
+
+            Pt::Net::Endpoint aEp;
+            a.localEndpoint(aEp);
+
+            Pt::Net::Endpoint bEp;
+            b.localEndpoint(bEp);
+
+            server.setTarget(aEp);
+            server.beginSendTo(bEp, "async to b", 10);
+
+            _timedOut = false;
+            _written = 0;
+            loop.run();
+
+            PT_UNIT_ASSERT( ! _timedOut );
+            PT_UNIT_ASSERT_EQUALS(_written, 10u);
+
+            // the following write goes to the target again
+            server.beginWrite("async to a", 10);
+
+            _written = 0;
+            loop.run();
+
+            PT_UNIT_ASSERT( ! _timedOut );
+            PT_UNIT_ASSERT_EQUALS(_written, 10u);
+
+            Pt::Net::Endpoint from;
+            PT_UNIT_ASSERT_EQUALS(receiveString(b, from), std::string("async to b"));
+            PT_UNIT_ASSERT_EQUALS(from.toString(), serverEp.toString());
+
+            PT_UNIT_ASSERT_EQUALS(receiveString(a, from), std::string("async to a"));
+            PT_UNIT_ASSERT_EQUALS(from.toString(), serverEp.toString());
+        }
+
+    private:
+        void onOutput(Pt::System::IODevice& dev)
+        {
+            _written = dev.endWrite();
+            _loop->exit();
+        }
+
+        void onTimeout()
+        {
+            _timedOut = true;
+            _loop->exit();
+        }
+
+    private:
+        Pt::System::EventLoop* _loop;
+        bool _timedOut;
+        std::size_t _written;
+};
+
+Pt::Unit::RegisterTest<UdpSocketTest> register_UdpSocketTest;
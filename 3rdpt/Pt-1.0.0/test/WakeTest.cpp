@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2006-2010 Marc Boris Duerner
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <Pt/Unit/Assertion.h>
+#include <Pt/Unit/TestSuite.h>
+#include <Pt/Unit/RegisterTest.h>
+#include <Pt/System/Thread.h>
+#include <Pt/Atomicity.h>
+#include "posix/MainLoopImpl.h"
+#include <poll.h>
+#include <vector>
+
+namespace {
+
+const int WakeThreads = 4;
+const int WakesPerThread = 20000;
+
+// long enough to never expire unless a wake is lost
+const int WakeTimeout = 5000;
+
+// queues work by counting it and wakes the consumer
+template <typename W>
+struct WakeProducer
+{
+    WakeProducer(W& waker, Pt::atomic_t& queued)
+    : waker(&waker)
+    , queued(&queued)
+    {}
+
+    void run()
+    {
+        for(int n = 0; n < WakesPerThread; ++n)
+        {
+            Pt::atomicIncrement(*queued);
+            waker->wake();
+
+            if(n % 64 == 0)
+                Pt::System::Thread::yield();
+        }
+    }
+
+    W* waker;
+    Pt::atomic_t* queued;
+};
+
+// waits on the read fd of a Waker like a selector does
+template <typename W>
+struct WakerWait
+{
+    WakerWait(W& waker)
+    : waker(&waker)
+    {}
+
+    bool waitForWake(int msecs)
+    {
+        pollfd pfd;
+        pfd.fd = waker->readFd();
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+
+        if(::poll(&pfd, 1, msecs) <= 0)
+            return false;
+
+        return waker->isReady();
+    }
+
+    W* waker;
+};
+
+}
+
+
+class WakeTest : public Pt::Unit::TestSuite
+{
+    public:
+        WakeTest()
+        : Pt::Unit::TestSuite("WakeTest")
+        {
+            this->registerMethod("wakePipe", *this, &WakeTest::wakePipe);
+            this->registerMethod("wakeEventFd", *this, &WakeTest::wakeEventFd);
+            this->registerMethod("selector", *this, &WakeTest::selector);
+            this->registerMethod("epollSelector", *this, &WakeTest::epollSelector);
+        }
+
+        void wakePipe()
+        {
+            Pt::System::WakePipe waker;
+            WakerWait<Pt::System::WakePipe> wait(waker);
+            hammer(waker, wait);
+        }
+
+        void wakeEventFd()
+        {
+#if defined(PT_WITH_LINUX_EVENTFD)
+            Pt::System::WakeEventFd waker;
+            WakerWait<Pt::System::WakeEventFd> wait(waker);
+            hammer(waker, wait);
+#endif
+        }
+
+        void selector()
+        {
+            Pt::System::SelectorImpl selector;
+            hammer(selector, selector);
+        }
+
+        void epollSelector()
+        {
+#if defined(PT_WITH_LINUX_EPOLL_OPTION)
+            Pt::System::EpollSelector selector;
+            hammer(selector, selector);
+#endif
+        }
+
+    private:
+        // several threads queue work and wake, the consumer takes all
+        // queued work after each wake. A lost wake leaves work queued
+        // until the wait times out.
+        template <typename W, typename S>
+        void hammer(W& waker, S& selector)
+        {
+            Pt::atomic_t queued(0);
+
+            std::vector<WakeProducer<W>*> producers;
+            std::vector<Pt::System::AttachedThread*> threads;
+            for(int n = 0; n < WakeThreads; ++n)
+            {
+                producers.push_back( new WakeProducer<W>(waker, queued) );
+                threads.push_back( new Pt::System::AttachedThread( Pt::callable(*producers.back(), &WakeProducer<W>::run) ) );
+                threads.back()->start();
+            }
+
+            const int expected = WakeThreads * WakesPerThread;
+            int received = 0;
+            bool lost = false;
+
+            while(received < expected)
+            {
+                if( ! selector.waitForWake(WakeTimeout) )
+                {
+                    lost = true;
+                    break;
+                }
+
+                received += Pt::atomicExchange(queued, 0);
+            }
+
+            for(std::size_t n = 0; n < threads.size(); ++n)
+            {
+                threads[n]->join();
+                delete threads[n];
+                delete producers[n];
+            }
+
+            PT_UNIT_ASSERT( ! lost );
+            PT_UNIT_ASSERT_EQUALS(received, expected);
+            PT_UNIT_ASSERT_EQUALS(Pt::atomicGet(queued), 0);
+        }
+};
+
+Pt::Unit::RegisterTest<WakeTest> register_WakeTest;
@@ -0,0 +1,193 @@
+/*
+ * This file is part of project 'Frayon'
+ * Copyright © 2014 Victor ADASCALITEI [3Nigma @ github]
+ * License: GNU GPL v3 [More @ http://www.gnu.org/licenses/gpl.html]
+ * Short description: Fixed-rate simulation tick scheduler driven by a Pt::System::MainLoop.
+ */
+
+#include "TickScheduler.h"
+#include "Pt/System/Clock.h"
+#include <stdexcept>
+
+namespace {
+
+// Runs a phase hook for a tick as task of a group
+class HookTask : public Pt::System::Task
+{
+    public:
+        HookTask(const Pt::Callable<void, const Frayon::Tick&>& hook, const Frayon::Tick& tick)
+        : _hook(hook)
+        , _tick(tick)
+        { }
+
+        virtual void run()
+        { _hook.invoke(_tick); }
+
+    private:
+        const Pt::Callable<void, const Frayon::Tick&>& _hook;
+        Frayon::Tick _tick;
+};
+
+}
+
+namespace Frayon {
+
+TickScheduler::TickScheduler(Pt::System::EventLoop& loop, unsigned rate)
+: _loop(&loop)
+, _pool(0)
+, _rate(rate)
+, _maxCatchUp(5)
+, _running(false)
+, _next(0)
+{
+    if(rate == 0 || rate > 1000000)
+        throw std::invalid_argument("invalid tick rate");
+
+    _timer.timeout() += Pt::slot(*this, &TickScheduler::onTimer);
+    _timer.setActive(loop);
+}
+
+
+TickScheduler::~TickScheduler()
+{
+    for(std::size_t phase = 0; phase < PhaseCount; ++phase)
+        this->clearHooks( static_cast<Phase>(phase) );
+}
+
+
+void TickScheduler::setMaxCatchUp(std::size_t ticks)
+{
+    _maxCatchUp = ticks > 0 ? ticks : 1;
+}
+
+
+void TickScheduler::addHook(Phase phase, const Pt::Callable<void, const Tick&>& hook)
+{
+    _hooks[phase].push_back( hook.clone() );
+}
+
+
+void TickScheduler::clearHooks(Phase phase)
+{
+    std::vector<Hook*>& hooks = _hooks[phase];
+
+    for(std::size_t n = 0; n < hooks.size(); ++n)
+        delete hooks[n];
+
+    hooks.clear();
+}
+
+
+void TickScheduler::start()
+{
+    _running = true;
+    _start = Pt::System::Clock::getMonotonicTicks();
+    _next = 0;
+
+    this->schedule();
+}
+
+
+void TickScheduler::stop()
+{
+    _running = false;
+    _timer.stop();
+}
+
+
+Pt::Timespan TickScheduler::deadline(Pt::uint64_t tick) const
+{
+    // computed from the tick number, so that rounding errors of the
+    // step do not accumulate
+    Pt::uint64_t usecs = (tick / _rate) * 1000000 + ((tick % _rate) * 1000000) / _rate;
+    return _start + Pt::Timespan( static_cast<Pt::int64_t>(usecs) );
+}
+
+
+void TickScheduler::onTimer()
+{
+    const Pt::Timespan step( static_cast<Pt::int64_t>(1000000 / _rate) );
+    Pt::Timespan now = _loop->loopTime();
+
+    std::size_t count = 0;
+    while( _running )
+    {
+        // the previous ticks might have taken a while, so the lateness
+        // of each tick is measured from a fresh clock reading
+        if(count > 0)
+            now = Pt::System::Clock::getMonotonicTicks();
+
+        Pt::Timespan due = this->deadline(_next);
+        if(due > now)
+            break;
+
+        if(count == _maxCatchUp)
+        {
+            // drop the ticks, which are still due
+            Pt::uint64_t behind = static_cast<Pt::uint64_t>( (now - _start).toUSecs() ) * _rate / 1000000 + 1;
+            _stats.skip(behind - _next);
+            _next = behind;
+            break;
+        }
+
+        Tick tick;
+        tick.number = _next;
+        tick.deadline = due;
+        tick.step = step;
+        tick.lateness = now - due;
+
+        _stats.record(tick.lateness);
+        ++_next;
+        ++count;
+
+        this->runTick(tick);
+    }
+
+    if(_running)
+        this->schedule();
+}
+
+
+void TickScheduler::runTick(const Tick& tick)
+{
+    for(std::size_t phase = 0; phase < PhaseCount && _running; ++phase)
+        this->runPhase(phase, tick);
+}
+
+
+void TickScheduler::runPhase(std::size_t phase, const Tick& tick)
+{
+    std::vector<Hook*>& hooks = _hooks[phase];
+
+    if( ! _pool || hooks.size() < 2 )
+    {
+        for(std::size_t n = 0; n < hooks.size(); ++n)
+            hooks[n]->invoke(tick);
+
+        return;
+    }
+
+    Pt::System::TaskGroup group(*_pool);
+
+    for(std::size_t n = 0; n < hooks.size(); ++n)
+        group.run( new HookTask(*hooks[n], tick) );
+
+    group.wait();
+}
+
+
+void TickScheduler::schedule()
+{
+    // the ticks might have taken a while, so the clock is read again
+    Pt::Timespan now = Pt::System::Clock::getMonotonicTicks();
+    Pt::int64_t remaining = (this->deadline(_next) - now).toUSecs();
+
+    // the timer has millisecond resolution, round up to not wake early
+    std::size_t msecs = 1;
+    if(remaining > 1000)
+        msecs = static_cast<std::size_t>( (remaining + 999) / 1000 );
+
+    _timer.start(msecs);
+}
+
+} // namespace Frayon
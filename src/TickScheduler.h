@@ -0,0 +1,214 @@
+/*
+ * This file is part of project 'Frayon'
+ * Copyright © 2014 Victor ADASCALITEI [3Nigma @ github]
+ * License: GNU GPL v3 [More @ http://www.gnu.org/licenses/gpl.html]
+ * Short description: Fixed-rate simulation tick scheduler driven by a Pt::System::MainLoop.
+ */
+
+#ifndef FRAYON_TICKSCHEDULER_H
+#define FRAYON_TICKSCHEDULER_H
+
+#include "Pt/Callable.h"
+#include "Pt/Connectable.h"
+#include "Pt/Timespan.h"
+#include "Pt/Types.h"
+#include "Pt/NonCopyable.h"
+#include "Pt/System/EventLoop.h"
+#include "Pt/System/Timer.h"
+#include "Pt/System/TaskPool.h"
+#include <vector>
+#include <cstddef>
+
+namespace Frayon {
+
+/** @brief Describes the tick being run.
+*/
+struct Tick
+{
+    //! @brief Number of the tick, counted from 0 when the scheduler started.
+    Pt::uint64_t number;
+
+    //! @brief Monotonic time at which the tick was due.
+    Pt::Timespan deadline;
+
+    //! @brief Fixed simulation time step.
+    Pt::Timespan step;
+
+    //! @brief Delay between the deadline and the start of the tick.
+    Pt::Timespan lateness;
+};
+
+/** @brief Lateness statistics of a TickScheduler.
+*/
+class TickStatistics
+{
+    public:
+        TickStatistics()
+        { this->reset(); }
+
+        //! @brief Number of ticks run.
+        Pt::uint64_t ticks() const
+        { return _ticks; }
+
+        //! @brief Number of ticks dropped because of the catch-up limit.
+        Pt::uint64_t skipped() const
+        { return _skipped; }
+
+        //! @brief Lateness of the last tick.
+        Pt::Timespan lastLateness() const
+        { return Pt::Timespan(_last); }
+
+        //! @brief Largest lateness of all ticks.
+        Pt::Timespan maxLateness() const
+        { return Pt::Timespan(_max); }
+
+        //! @brief Mean lateness of all ticks.
+        Pt::Timespan meanLateness() const
+        { return Pt::Timespan( _ticks ? _total / static_cast<Pt::int64_t>(_ticks) : 0 ); }
+
+        //! @brief Resets all counters.
+        void reset()
+        {
+            _ticks = 0;
+            _skipped = 0;
+            _last = 0;
+            _max = 0;
+            _total = 0;
+        }
+
+        //! @internal
+        void record(const Pt::Timespan& lateness)
+        {
+            _last = lateness.toUSecs();
+            _total += _last;
+
+            if(_last > _max)
+                _max = _last;
+
+            ++_ticks;
+        }
+
+        //! @internal
+        void skip(Pt::uint64_t count)
+        { _skipped += count; }
+
+    private:
+        Pt::uint64_t _ticks;
+        Pt::uint64_t _skipped;
+        Pt::int64_t _last;
+        Pt::int64_t _max;
+        Pt::int64_t _total;
+};
+
+/** @brief Runs fixed-rate simulation ticks on an event loop.
+
+    The tick deadlines are computed from the start time and the tick
+    number, so the schedule does not drift, even though the underlying
+    timer has millisecond resolution. If the loop falls behind, due
+    ticks are run back to back, up to the catch-up limit. The remaining
+    due ticks are dropped and counted as skipped.
+
+    Each tick runs the hooks of the input, simulate and replicate phase
+    in this order. Without a task pool, the hooks of a phase run in the
+    order they were added. With a task pool, the hooks of a phase run in
+    parallel and must not depend on each other, but a phase only starts
+    when all hooks of the previous phase have finished.
+
+    @code
+    TickScheduler ticks(app.loop(), 60);
+    ticks.addHook(TickScheduler::Simulate, Pt::callable(world, &World::step));
+    ticks.start();
+    @endcode
+*/
+class TickScheduler : public Pt::Connectable
+                    , private Pt::NonCopyable
+{
+    public:
+        //! @brief Phases of a tick.
+        enum Phase
+        {
+            Input = 0,
+            Simulate = 1,
+            Replicate = 2
+        };
+
+        static const std::size_t PhaseCount = 3;
+
+    public:
+        //! @brief Constructs a scheduler running @a rate ticks per second on @a loop.
+        TickScheduler(Pt::System::EventLoop& loop, unsigned rate);
+
+        //! @brief Destructor.
+        ~TickScheduler();
+
+        //! @brief Returns the number of ticks per second.
+        unsigned rate() const
+        { return _rate; }
+
+        //! @brief Returns the maximum number of due ticks run in one pass.
+        std::size_t maxCatchUp() const
+        { return _maxCatchUp; }
+
+        //! @brief Sets the maximum number of due ticks run in one pass.
+        void setMaxCatchUp(std::size_t ticks);
+
+        /** @brief Runs the hooks of each phase in parallel on @a pool.
+
+            Passing a null pointer runs all hooks in the loop thread.
+        */
+        void setTaskPool(Pt::System::TaskPool* pool)
+        { _pool = pool; }
+
+        //! @brief Adds a copy of @a hook to the hooks of @a phase.
+        void addHook(Phase phase, const Pt::Callable<void, const Tick&>& hook);
+
+        //! @brief Removes all hooks of @a phase, must not be called by a hook of the phase.
+        void clearHooks(Phase phase);
+
+        //! @brief Starts running ticks, beginning with tick 0 now.
+        void start();
+
+        //! @brief Stops running ticks.
+        void stop();
+
+        //! @brief Returns true if the scheduler is running.
+        bool isRunning() const
+        { return _running; }
+
+        //! @brief Returns the lateness statistics.
+        const TickStatistics& statistics() const
+        { return _stats; }
+
+        //! @brief Resets the lateness statistics.
+        void resetStatistics()
+        { _stats.reset(); }
+
+    private:
+        typedef Pt::Callable<void, const Tick&> Hook;
+
+        Pt::Timespan deadline(Pt::uint64_t tick) const;
+
+        void onTimer();
+
+        void runTick(const Tick& tick);
+
+        void runPhase(std::size_t phase, const Tick& tick);
+
+        void schedule();
+
+    private:
+        Pt::System::EventLoop* _loop;
+        Pt::System::Timer _timer;
+        Pt::System::TaskPool* _pool;
+        unsigned _rate;
+        std::size_t _maxCatchUp;
+        bool _running;
+        Pt::Timespan _start;
+        Pt::uint64_t _next;
+        std::vector<Hook*> _hooks[PhaseCount];
+        TickStatistics _stats;
+};
+
+} // namespace Frayon
+
+#endif // FRAYON_TICKSCHEDULER_H
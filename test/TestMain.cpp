@@ -0,0 +1,8 @@
+/*
+ * This file is part of project 'Frayon'
+ * Copyright © 2014 Victor ADASCALITEI [3Nigma @ github]
+ * License: GNU GPL v3 [More @ http://www.gnu.org/licenses/gpl.html]
+ * Short description: Runs all registered unit tests.
+ */
+
+#include <Pt/Unit/TestMain.h>
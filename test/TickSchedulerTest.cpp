@@ -0,0 +1,306 @@
+/*
+ * This file is part of project 'Frayon'
+ * Copyright © 2014 Victor ADASCALITEI [3Nigma @ github]
+ * License: GNU GPL v3 [More @ http://www.gnu.org/licenses/gpl.html]
+ * Short description: Unit tests of the TickScheduler.
+ */
+
+#include "TickScheduler.h"
+#include "Pt/Unit/Assertion.h"
+#include "Pt/Unit/TestSuite.h"
+#include "Pt/Unit/RegisterTest.h"
+#include "Pt/System/MainLoop.h"
+#include "Pt/System/Clock.h"
+#include "Pt/System/Thread.h"
+#include "Pt/System/Mutex.h"
+#include "Pt/System/TaskPool.h"
+#include <string>
+#include <vector>
+
+namespace {
+
+// Records the hooks of a tick and stops the loop after the last tick
+class TickRecorder : public Pt::Connectable
+{
+    public:
+        struct Call
+        {
+            char hook;
+            Frayon::Tick tick;
+            Pt::Timespan started;
+        };
+
+    public:
+        TickRecorder(Pt::System::EventLoop& loop, Frayon::TickScheduler& scheduler, Pt::uint64_t lastTick)
+        : _loop(&loop)
+        , _scheduler(&scheduler)
+        , _lastTick(lastTick)
+        , _delay(0)
+        , _stallTick(0)
+        , _stall(0)
+        {}
+
+        // sleeps in every simulate hook
+        void setDelay(unsigned msecs)
+        { _delay = msecs; }
+
+        // sleeps once in the simulate hook of @a tick
+        void setStall(Pt::uint64_t tick, unsigned msecs)
+        {
+            _stallTick = tick;
+            _stall = msecs;
+        }
+
+        void input1(const Frayon::Tick& tick)
+        { this->record('i', tick); }
+
+        void input2(const Frayon::Tick& tick)
+        { this->record('j', tick); }
+
+        void simulate(const Frayon::Tick& tick)
+        {
+            this->record('s', tick);
+
+            if(_delay)
+                Pt::System::Thread::sleep(_delay);
+
+            if(_stall && tick.number == _stallTick)
+                Pt::System::Thread::sleep(_stall);
+        }
+
+        void replicate(const Frayon::Tick& tick)
+        {
+            this->record('r', tick);
+
+            if(tick.number >= _lastTick)
+            {
+                _scheduler->stop();
+                _loop->exit();
+            }
+        }
+
+        const std::vector<Call>& calls() const
+        { return _calls; }
+
+    private:
+        void record(char hook, const Frayon::Tick& tick)
+        {
+            Call call;
+            call.hook = hook;
+            call.tick = tick;
+            call.started = Pt::System::Clock::getMonotonicTicks();
+
+            // the input hooks might run in parallel
+            Pt::System::MutexLock lock(_mutex);
+            _calls.push_back(call);
+        }
+
+    private:
+        Pt::System::EventLoop* _loop;
+        Frayon::TickScheduler* _scheduler;
+        Pt::uint64_t _lastTick;
+        unsigned _delay;
+        Pt::uint64_t _stallTick;
+        unsigned _stall;
+        Pt::System::Mutex _mutex;
+        std::vector<Call> _calls;
+};
+
+}
+
+
+class TickSchedulerTest : public Pt::Unit::TestSuite
+{
+    public:
+        TickSchedulerTest()
+        : Pt::Unit::TestSuite("TickSchedulerTest")
+        , _loop(0)
+        , _timedOut(false)
+        {
+            this->registerMethod("phaseOrder", *this, &TickSchedulerTest::phaseOrder);
+            this->registerMethod("phaseOrderTaskPool", *this, &TickSchedulerTest::phaseOrderTaskPool);
+            this->registerMethod("catchUp", *this, &TickSchedulerTest::catchUp);
+            this->registerMethod("lateness", *this, &TickSchedulerTest::lateness);
+        }
+
+        void phaseOrder()
+        {
+            Pt::System::MainLoop loop;
+            Frayon::TickScheduler scheduler(loop, 100);
+            TickRecorder recorder(loop, scheduler, 4);
+
+            addHooks(scheduler, recorder);
+            run(loop, scheduler);
+
+            // every tick runs all hooks in the order they were added
+            const std::vector<TickRecorder::Call>& calls = recorder.calls();
+            PT_UNIT_ASSERT_EQUALS(calls.size(), std::size_t(5 * 4));
+
+            for(std::size_t n = 0; n < calls.size(); ++n)
+            {
+                PT_UNIT_ASSERT_EQUALS(calls[n].hook, "ijsr"[n % 4]);
+                PT_UNIT_ASSERT_EQUALS(calls[n].tick.number, Pt::uint64_t(n / 4));
+                PT_UNIT_ASSERT_EQUALS(calls[n].tick.step.toUSecs(), Pt::int64_t(10000));
+            }
+
+            PT_UNIT_ASSERT_EQUALS(scheduler.statistics().ticks(), Pt::uint64_t(5));
+            PT_UNIT_ASSERT_EQUALS(scheduler.statistics().skipped(), Pt::uint64_t(0));
+        }
+
+        void phaseOrderTaskPool()
+        {
+            Pt::System::TaskPool pool(2);
+            Pt::System::MainLoop loop;
+            Frayon::TickScheduler scheduler(loop, 100);
+            scheduler.setTaskPool(&pool);
+            TickRecorder recorder(loop, scheduler, 4);
+
+            addHooks(scheduler, recorder);
+            run(loop, scheduler);
+
+            // the input hooks run in any order, but before the next phase
+            const std::vector<TickRecorder::Call>& calls = recorder.calls();
+            PT_UNIT_ASSERT_EQUALS(calls.size(), std::size_t(5 * 4));
+
+            for(std::size_t n = 0; n < calls.size(); n += 4)
+            {
+                const std::string inputs = std::string(1, calls[n].hook) + calls[n + 1].hook;
+                PT_UNIT_ASSERT(inputs == "ij" || inputs == "ji");
+                PT_UNIT_ASSERT_EQUALS(calls[n + 2].hook, 's');
+                PT_UNIT_ASSERT_EQUALS(calls[n + 3].hook, 'r');
+
+                for(std::size_t m = n; m < n + 4; ++m)
+                    PT_UNIT_ASSERT_EQUALS(calls[m].tick.number, Pt::uint64_t(n / 4));
+            }
+        }
+
+        void catchUp()
+        {
+            Pt::System::MainLoop loop;
+            Frayon::TickScheduler scheduler(loop, 100);
+            scheduler.setMaxCatchUp(3);
+            TickRecorder recorder(loop, scheduler, 20);
+
+            // tick 1 falls behind by about 10 ticks
+            recorder.setStall(1, 100);
+
+            addHooks(scheduler, recorder);
+            run(loop, scheduler);
+
+            const std::vector<TickRecorder::Call> ticks = simulated(recorder);
+            PT_UNIT_ASSERT(ticks.size() > 4);
+
+            // the stalled tick and the two following ticks make up one
+            // pass of three ticks, which run back to back
+            PT_UNIT_ASSERT_EQUALS(ticks[0].tick.number, Pt::uint64_t(0));
+            PT_UNIT_ASSERT_EQUALS(ticks[1].tick.number, Pt::uint64_t(1));
+            for(std::size_t n = 2; n < 4; ++n)
+            {
+                PT_UNIT_ASSERT_EQUALS(ticks[n].tick.number, Pt::uint64_t(n));
+                PT_UNIT_ASSERT(ticks[n].tick.lateness.toUSecs() >= 50000);
+
+                if(n > 2)
+                    PT_UNIT_ASSERT(ticks[n].started - ticks[n - 1].started < Pt::Timespan(10000));
+            }
+
+            // the remaining due ticks are dropped and counted
+            const Frayon::TickStatistics& stats = scheduler.statistics();
+            PT_UNIT_ASSERT(stats.skipped() > 0);
+            PT_UNIT_ASSERT_EQUALS(ticks[4].tick.number, 4 + stats.skipped());
+            PT_UNIT_ASSERT_EQUALS(stats.ticks() + stats.skipped(), ticks.back().tick.number + 1);
+            PT_UNIT_ASSERT(stats.maxLateness().toUSecs() >= 90000);
+        }
+
+        void lateness()
+        {
+            Pt::System::MainLoop loop;
+            Frayon::TickScheduler scheduler(loop, 100);
+            scheduler.setMaxCatchUp(10);
+            TickRecorder recorder(loop, scheduler, 12);
+
+            // each tick takes 15 ms at 10 ms per tick, so the scheduler
+            // falls behind and catches up in every pass
+            recorder.setDelay(15);
+
+            addHooks(scheduler, recorder);
+            run(loop, scheduler);
+
+            // the lateness is measured when each tick starts, not when
+            // the pass of due ticks started
+            const std::vector<TickRecorder::Call> ticks = simulated(recorder);
+            PT_UNIT_ASSERT(ticks.size() > 2);
+
+            Pt::int64_t last = 0;
+            for(std::size_t n = 0; n < ticks.size(); ++n)
+            {
+                const Frayon::Tick& tick = ticks[n].tick;
+                const Pt::Timespan measured = ticks[n].started - tick.deadline;
+
+                PT_UNIT_ASSERT(tick.lateness.toUSecs() >= 0);
+                PT_UNIT_ASSERT(tick.lateness <= measured);
+                PT_UNIT_ASSERT(measured.toUSecs() - tick.lateness.toUSecs() < 5000);
+
+                if(n > 0 && ticks[n - 1].tick.number + 1 == tick.number)
+                    PT_UNIT_ASSERT(tick.lateness.toUSecs() > last);
+
+                last = tick.lateness.toUSecs();
+            }
+
+            const Frayon::TickStatistics& stats = scheduler.statistics();
+            PT_UNIT_ASSERT(stats.lastLateness().toUSecs() == last);
+            PT_UNIT_ASSERT(stats.maxLateness().toUSecs() >= last);
+            PT_UNIT_ASSERT(stats.meanLateness() <= stats.maxLateness());
+        }
+
+    private:
+        void addHooks(Frayon::TickScheduler& scheduler, TickRecorder& recorder)
+        {
+            scheduler.addHook(Frayon::TickScheduler::Replicate, Pt::callable(recorder, &TickRecorder::replicate));
+            scheduler.addHook(Frayon::TickScheduler::Input, Pt::callable(recorder, &TickRecorder::input1));
+            scheduler.addHook(Frayon::TickScheduler::Simulate, Pt::callable(recorder, &TickRecorder::simulate));
+            scheduler.addHook(Frayon::TickScheduler::Input, Pt::callable(recorder, &TickRecorder::input2));
+        }
+
+        void run(Pt::System::MainLoop& loop, Frayon::TickScheduler& scheduler)
+        {
+            _loop = &loop;
+            _timedOut = false;
+
+            Pt::System::Timer guard;
+            guard.timeout() += Pt::slot(*this, &TickSchedulerTest::onTimeout);
+            guard.setActive(loop);
+            guard.start(5000);
+
+            scheduler.start();
+            loop.run();
+            scheduler.stop();
+
+            PT_UNIT_ASSERT( ! _timedOut );
+        }
+
+        std::vector<TickRecorder::Call> simulated(const TickRecorder& recorder)
+        {
+            std::vector<TickRecorder::Call> ticks;
+
+            const std::vector<TickRecorder::Call>& calls = recorder.calls();
+            for(std::size_t n = 0; n < calls.size(); ++n)
+            {
+                if(calls[n].hook == 's')
+                    ticks.push_back(calls[n]);
+            }
+
+            return ticks;
+        }
+
+        void onTimeout()
+        {
+            _timedOut = true;
+            _loop->exit();
+        }
+
+    private:
+        Pt::System::EventLoop* _loop;
+        bool _timedOut;
+};
+
+Pt::Unit::RegisterTest<TickSchedulerTest> register_TickSchedulerTest;